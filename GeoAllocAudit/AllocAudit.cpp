@@ -0,0 +1,428 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// AllocAudit.cpp: Heap allocations made by Geocoder::CodeAddress().
+//
+//	allocaudit [-warmup N] [-max N] [-baseline File] [-slack N] [-top N] [-depth N]
+//		<tableDir> <databaseDir> <addressFile>
+//
+// Replaces malloc, calloc and realloc (which operator new calls) with
+// versions that count the calls made on the main thread while auditing is
+// on, keyed by the stack above them.  The addresses are coded -warmup times
+// to fill the caches and grow the reused buffers, then once more with
+// auditing on.  Prints the allocations per address and the call sites that
+// made the most.  With -max, exits with status 1 if the average number of
+// allocations per address is above the limit, for use as a regression check.
+// With -baseline, the limit is the average recorded in the file plus -slack;
+// if the file does not exist yet, the average is written to it instead.
+//
+// The address file has one address per line: street address, a tab, then
+// city, state and ZIP.  Blank lines and lines starting with # are skipped.
+//
+// Linux/glibc only: the hooks forward to glibc's __libc_malloc and friends.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "../geocoder/Geocoder.h"
+
+using namespace PortfolioExplorer;
+
+///////////////////////////////////////////////////////////////////////////////
+// Allocation hooks.  Nothing here may allocate: the site table is a fixed
+// array, and only the thread that turned auditing on is counted.
+///////////////////////////////////////////////////////////////////////////////
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+}
+
+// Frames kept per call site, and frames to skip (RecordAllocation and the hook)
+enum { MaxFrames = 16, SkipFrames = 2 };
+// Distinct call sites kept; must be a power of 2
+enum { MaxSites = 8192 };
+
+struct AllocSite {
+	uintptr_t hash;
+	int nbrFrames;
+	void* frames[MaxFrames];
+	long count;
+	long bytes;
+};
+
+static AllocSite allocSites[MaxSites];
+static long nbrSitesDropped = 0;
+
+static __thread bool auditing = false;
+static __thread bool inHook = false;
+static __thread long nbrAllocations = 0;
+static __thread long nbrBytes = 0;
+
+static void RecordAllocation(size_t size)
+{
+	if (!auditing || inHook) {
+		return;
+	}
+	inHook = true;
+	nbrAllocations++;
+	nbrBytes += long(size);
+
+	void* frames[MaxFrames + SkipFrames];
+	int nbrFrames = backtrace(frames, MaxFrames + SkipFrames) - SkipFrames;
+	if (nbrFrames < 0) {
+		nbrFrames = 0;
+	}
+	void** sitesFrames = frames + SkipFrames;
+	uintptr_t hash = 0;
+	for (int i = 0; i < nbrFrames; i++) {
+		hash = hash * 31 + uintptr_t(sitesFrames[i]);
+	}
+	hash |= 1;		// 0 marks an empty slot
+
+	unsigned idx = unsigned(hash) & (MaxSites - 1);
+	for (int probe = 0; ; probe++, idx = (idx + 1) & (MaxSites - 1)) {
+		AllocSite& site = allocSites[idx];
+		if (probe == MaxSites) {
+			nbrSitesDropped++;
+			break;
+		}
+		if (site.hash == 0) {
+			site.hash = hash;
+			site.nbrFrames = nbrFrames;
+			memcpy(site.frames, sitesFrames, nbrFrames * sizeof(void*));
+		} else if (
+			site.hash != hash ||
+			site.nbrFrames != nbrFrames ||
+			memcmp(site.frames, sitesFrames, nbrFrames * sizeof(void*)) != 0
+		) {
+			continue;
+		}
+		site.count++;
+		site.bytes += long(size);
+		break;
+	}
+	inHook = false;
+}
+
+extern "C" void* malloc(size_t size)
+{
+	RecordAllocation(size);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	RecordAllocation(count * size);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	RecordAllocation(size);
+	return __libc_realloc(ptr, size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reporting
+///////////////////////////////////////////////////////////////////////////////
+
+// Name of the function containing a code address; needs -rdynamic for
+// functions in the executable.  Static functions have no dynamic symbol, so
+// are shown as file+offset, for addr2line.
+static std::string FrameName(void* frame)
+{
+	Dl_info info;
+	if (dladdr(frame, &info) == 0) {
+		char buf[32];
+		sprintf(buf, "%p", frame);
+		return buf;
+	}
+	if (info.dli_sname == 0) {
+		const char* file = info.dli_fname != 0 ? info.dli_fname : "?";
+		const char* slash = strrchr(file, '/');
+		char buf[32];
+		sprintf(buf, "+0x%lx", (unsigned long)((char*)frame - (char*)info.dli_fbase));
+		return std::string(slash != 0 ? slash + 1 : file) + buf;
+	}
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(info.dli_sname, 0, 0, &status);
+	std::string name = (status == 0 && demangled != 0) ? demangled : info.dli_sname;
+	free(demangled);
+	return name;
+}
+
+static bool StartsWith(const std::string& str, const char* prefix)
+{
+	return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// True for the allocator and the standard library frames above the code
+// that asked for memory.
+static bool IsAllocatorFrame(void* frame, const std::string& name)
+{
+	Dl_info info;
+	if (dladdr(frame, &info) != 0 && info.dli_fname != 0 && strstr(info.dli_fname, "libstdc++") != 0) {
+		return true;
+	}
+	return
+		StartsWith(name, "operator new") ||
+		StartsWith(name, "std::") ||
+		StartsWith(name, "void std::") ||
+		StartsWith(name, "__gnu_cxx::") ||
+		StartsWith(name, "void __gnu_cxx::") ||
+		StartsWith(name, "PortfolioExplorer::VectorNoDestruct");
+}
+
+// A call site described by the first frame outside the allocator and the
+// frames that called it.
+struct SiteReport {
+	std::string where;
+	long count;
+	long bytes;
+};
+
+static bool MoreAllocations(const SiteReport& lhs, const SiteReport& rhs)
+{
+	return lhs.count > rhs.count;
+}
+
+static void ReportSites(int top, int depth)
+{
+	std::vector<SiteReport> reports;
+	for (int i = 0; i < MaxSites; i++) {
+		const AllocSite& site = allocSites[i];
+		if (site.hash == 0 || site.count == 0) {
+			continue;
+		}
+		SiteReport report;
+		report.count = site.count;
+		report.bytes = site.bytes;
+		int shown = 0;
+		for (int f = 0; f < site.nbrFrames && shown < depth; f++) {
+			std::string name = FrameName(site.frames[f]);
+			if (shown == 0 && IsAllocatorFrame(site.frames[f], name)) {
+				continue;
+			}
+			report.where += (shown == 0 ? "" : "\n\t\t\t\t<- ") + name;
+			shown++;
+		}
+		// Merge stacks that differ only below the frames shown.
+		std::vector<SiteReport>::iterator it;
+		for (it = reports.begin(); it != reports.end() && it->where != report.where; ++it) {}
+		if (it == reports.end()) {
+			reports.push_back(report);
+		} else {
+			it->count += report.count;
+			it->bytes += report.bytes;
+		}
+	}
+	std::stable_sort(reports.begin(), reports.end(), MoreAllocations);
+	std::cout << "\n   count\t   bytes\tcall site\n";
+	for (int i = 0; i < int(reports.size()) && i < top; i++) {
+		std::cout << std::setw(8) << reports[i].count << "\t" << std::setw(8) << reports[i].bytes
+			<< "\t" << reports[i].where << "\n";
+	}
+	if (nbrSitesDropped != 0) {
+		std::cout << nbrSitesDropped << " allocations not attributed: site table full\n";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Driver
+///////////////////////////////////////////////////////////////////////////////
+
+class AuditGeocoder : public Geocoder {
+public:
+	AuditGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << message << "\n";
+	}
+};
+
+struct Address {
+	std::string line1;
+	std::string line2;
+};
+
+static bool ReadAddresses(const char* filename, std::vector<Address>& addresses)
+{
+	std::ifstream in(filename);
+	if (!in) {
+		std::cerr << "Cannot open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		Address address;
+		size_t tab = line.find('\t');
+		address.line1 = line.substr(0, tab);
+		if (tab != std::string::npos) {
+			address.line2 = line.substr(tab + 1);
+		}
+		addresses.push_back(address);
+	}
+	return true;
+}
+
+// Code one address and fetch every candidate, as a caller would.
+static void CodeOne(Geocoder& geocoder, const Address& address, Geocoder::GeocodeResults& results)
+{
+	geocoder.CodeAddress(address.line1.c_str(), address.line2.c_str());
+	while (geocoder.GetNextCandidate(results)) {}
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] <tableDir> <databaseDir> <addressFile>\n"
+		"  -warmup N      passes over the addresses before auditing (default 2)\n"
+		"  -max N         fail if allocations per address exceed N\n"
+		"  -baseline F    fail if they exceed the average recorded in F plus the\n"
+		"                 slack; record the average in F if it does not exist\n"
+		"  -slack N       allowance over the baseline (default 0.1)\n"
+		"  -top N         call sites to list (default 20)\n"
+		"  -depth N       frames shown per call site (default 3)\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int warmup = 2;
+	double maxPerAddress = -1;
+	const char* baselineFile = 0;
+	double slack = 0.1;
+	int top = 20;
+	int depth = 3;
+	std::vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-warmup" && hasValue) {
+			warmup = atoi(argv[++i]);
+		} else if (arg == "-max" && hasValue) {
+			maxPerAddress = atof(argv[++i]);
+		} else if (arg == "-baseline" && hasValue) {
+			baselineFile = argv[++i];
+		} else if (arg == "-slack" && hasValue) {
+			slack = atof(argv[++i]);
+		} else if (arg == "-top" && hasValue) {
+			top = atoi(argv[++i]);
+		} else if (arg == "-depth" && hasValue) {
+			depth = atoi(argv[++i]);
+		} else if (arg[0] == '-') {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	if (args.size() != 3 || warmup < 0 || depth < 1) {
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Address> addresses;
+	if (!ReadAddresses(args[2], addresses)) {
+		return 1;
+	}
+	if (addresses.empty()) {
+		std::cerr << "No addresses in " << args[2] << "\n";
+		return 1;
+	}
+
+	AuditGeocoder geocoder(args[0], args[1]);
+	if (!geocoder.Open()) {
+		return 1;
+	}
+
+	// The first backtrace() loads the unwinder, which allocates.
+	void* frame;
+	backtrace(&frame, 1);
+
+	Geocoder::GeocodeResults results;
+	for (int pass = 0; pass < warmup; pass++) {
+		for (size_t i = 0; i < addresses.size(); i++) {
+			CodeOne(geocoder, addresses[i], results);
+		}
+	}
+
+	long maxAllocations = 0;
+	size_t nbrAllocating = 0;
+	auditing = true;
+	for (size_t i = 0; i < addresses.size(); i++) {
+		long before = nbrAllocations;
+		CodeOne(geocoder, addresses[i], results);
+		long made = nbrAllocations - before;
+		maxAllocations = std::max(maxAllocations, made);
+		if (made != 0) {
+			nbrAllocating++;
+		}
+	}
+	auditing = false;
+
+	double perAddress = double(nbrAllocations) / addresses.size();
+	std::cout << addresses.size() << " addresses after " << warmup << " warm-up passes: "
+		<< nbrAllocations << " allocations, " << nbrBytes << " bytes\n"
+		<< std::fixed << std::setprecision(2) << perAddress << " allocations per address, "
+		<< "at most " << maxAllocations << ", " << nbrAllocating << " addresses allocated\n";
+	if (nbrAllocations != 0) {
+		ReportSites(top, depth);
+	}
+
+	if (maxPerAddress < 0 && baselineFile != 0) {
+		std::ifstream in(baselineFile);
+		double baseline;
+		if (in >> baseline) {
+			maxPerAddress = baseline + slack;
+		} else {
+			std::ofstream out(baselineFile);
+			out << std::fixed << std::setprecision(2) << perAddress << "\n";
+			if (!out) {
+				std::cerr << "Cannot write " << baselineFile << "\n";
+				return 1;
+			}
+			std::cout << "Recorded " << perAddress << " allocations per address as the baseline in " << baselineFile << "\n";
+		}
+	}
+	if (maxPerAddress >= 0 && perAddress > maxPerAddress) {
+		std::cout << "FAIL: " << perAddress << " allocations per address, limit " << maxPerAddress << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,252 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// ParseBench.cpp: Latency of address parsing and of CodeAddress().
+//
+//	parsebench [-passes N] [-profile] <tableDir> <databaseDir> <addressFile>
+//
+// Parses every address of the file with AddressParserFirstLine and
+// AddressParserLastLine, then codes it with Geocoder, timing each call.
+// The file is gone through once to warm up and then -passes times; the
+// mean, median and 99th percentile of each kind of call are printed in
+// microseconds.  Run it on the same machine before and after a change.
+// With -profile, Geocoder's own profiling is turned on for the timed passes
+// and the time per phase, the records decoded per table and the hit rate of
+// each cache are printed as well.
+//
+// The address file has one address per line: street address, a tab, then
+// city, state and ZIP.  Blank lines and lines starting with # are skipped.
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "../global/AddressParserFirstLine.h"
+#include "../global/AddressParserLastLine.h"
+#include "../geocoder/Geocoder.h"
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+class BenchGeocoder : public Geocoder {
+public:
+	BenchGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << message << "\n";
+	}
+};
+
+struct Address {
+	std::string line1;
+	std::string line2;
+};
+
+static bool ReadAddresses(const char* filename, std::vector<Address>& addresses)
+{
+	std::ifstream in(filename);
+	if (!in) {
+		std::cerr << "Cannot open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		Address address;
+		size_t tab = line.find('\t');
+		address.line1 = line.substr(0, tab);
+		if (tab != std::string::npos) {
+			address.line2 = line.substr(tab + 1);
+		}
+		addresses.push_back(address);
+	}
+	return true;
+}
+
+// Call times of one kind, in microseconds
+class Timings {
+public:
+	Timings(const char* name_) : name(name_) {}
+
+	void Add(Clock::time_point start) {
+		times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+	}
+
+	void Print() {
+		std::cout << std::left << std::setw(16) << name << std::right;
+		if (times.empty()) {
+			std::cout << "no calls\n";
+			return;
+		}
+		std::sort(times.begin(), times.end());
+		double sum = 0;
+		for (size_t i = 0; i < times.size(); i++) {
+			sum += times[i];
+		}
+		std::cout << std::fixed << std::setprecision(2)
+			<< "mean " << std::setw(9) << sum / times.size()
+			<< "  p50 " << std::setw(9) << Percentile(0.50)
+			<< "  p99 " << std::setw(9) << Percentile(0.99)
+			<< "  usec, " << times.size() << " calls\n";
+	}
+
+private:
+	double Percentile(double fraction) const {
+		size_t idx = size_t(fraction * (times.size() - 1) + 0.5);
+		return times[idx];
+	}
+
+	const char* name;
+	std::vector<double> times;
+};
+
+// Geocoder's profile of the timed passes
+static void PrintProfile(Geocoder& geocoder)
+{
+	Geocoder::RequestStats totals;
+	long nbrRequests;
+	geocoder.GetProfileTotals(totals, nbrRequests);
+	if (nbrRequests == 0) {
+		return;
+	}
+	std::cout << "\nprofile of " << nbrRequests << " requests\n" << std::fixed << std::setprecision(2);
+	for (int phase = 0; phase <= Geocoder::ProfileTotal; phase++) {
+		Geocoder::LatencyHistogram histogram;
+		geocoder.GetLatencyHistogram(phase, histogram);
+		double usec = phase == Geocoder::ProfileTotal ? totals.totalMicroseconds : totals.phaseMicroseconds[phase];
+		std::cout << std::left << std::setw(18) << Geocoder::GetProfilePhaseName(phase) << std::right
+			<< "mean " << std::setw(9) << usec / nbrRequests
+			<< "  p99 <" << std::setw(8) << histogram.Percentile(0.99)
+			<< "  usec, in " << histogram.nbrSamples << " requests\n";
+	}
+	for (int table = 0; table < Geocoder::NbrProfileTables; table++) {
+		std::cout << std::left << std::setw(28) << Geocoder::GetProfileTableName(table) << std::right
+			<< std::setw(10) << double(totals.recordsDecoded[table]) / nbrRequests << " records/request\n";
+	}
+	for (int cache = 0; cache < Geocoder::NbrProfileCaches; cache++) {
+		long lookups = totals.cacheHits[cache] + totals.cacheMisses[cache];
+		if (lookups != 0) {
+			std::cout << std::left << std::setw(34) << Geocoder::GetProfileCacheName(cache) << std::right
+				<< std::setw(7) << 100.0 * totals.cacheHits[cache] / lookups << "% hits of "
+				<< lookups << "\n";
+		}
+	}
+	std::cout << std::setw(10) << totals.bitsDecoded / nbrRequests << " bits decoded/request\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int passes = 5;
+	bool profile = false;
+	std::vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-passes" && i + 1 < argc) {
+			passes = atoi(argv[++i]);
+		} else if (arg == "-profile") {
+			profile = true;
+		} else if (arg[0] == '-') {
+			args.clear();
+			break;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	if (args.size() != 3 || passes <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [-passes N] [-profile] <tableDir> <databaseDir> <addressFile>\n";
+		return 1;
+	}
+
+	std::vector<Address> addresses;
+	if (!ReadAddresses(args[2], addresses)) {
+		return 1;
+	}
+
+	const char* errorMsg;
+	AddressParserFirstLine firstLineParser;
+	if (!firstLineParser.Open(args[0], errorMsg)) {
+		std::cerr << errorMsg << "\n";
+		return 1;
+	}
+	AddressParserLastLine lastLineParser;
+	if (!lastLineParser.Open(args[0], errorMsg)) {
+		std::cerr << errorMsg << "\n";
+		return 1;
+	}
+	BenchGeocoder geocoder(args[0], args[1]);
+	if (!geocoder.Open()) {
+		return 1;
+	}
+
+	Timings firstLineTimes("first-line parse");
+	Timings lastLineTimes("last-line parse");
+	Timings codeTimes("CodeAddress");
+	AddressParserFirstLine::ParseCandidate firstLineCandidate;
+	AddressParserLastLine::ParseCandidate lastLineCandidate;
+	Geocoder::GeocodeResults results;
+
+	// Pass 0 warms up the caches and is not counted.
+	for (int pass = 0; pass <= passes; pass++) {
+		if (pass == 1 && profile) {
+			geocoder.SetProfiling(true);
+		}
+		for (size_t i = 0; i < addresses.size(); i++) {
+			const Address& address = addresses[i];
+			Clock::time_point start = Clock::now();
+			firstLineParser.Parse(address.line1.c_str(), firstLineCandidate, true);
+			if (pass != 0) {
+				firstLineTimes.Add(start);
+			}
+			start = Clock::now();
+			lastLineParser.Parse(address.line2.c_str(), lastLineCandidate, true);
+			if (pass != 0) {
+				lastLineTimes.Add(start);
+			}
+			start = Clock::now();
+			geocoder.CodeAddress(address.line1.c_str(), address.line2.c_str());
+			while (geocoder.GetNextCandidate(results)) {}
+			if (pass != 0) {
+				codeTimes.Add(start);
+			}
+		}
+	}
+
+	std::cout << addresses.size() << " addresses, " << passes << " passes\n";
+	firstLineTimes.Print();
+	lastLineTimes.Print();
+	codeTimes.Print();
+	if (profile) {
+		PrintProfile(geocoder);
+	}
+	return 0;
+}
@@ -0,0 +1,369 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// SuiteBench.cpp: The benchmark suite over the synthetic dataset.
+//
+//	geobench [-passes N] [-json] <tableDir> <databaseDir> <workloadDir>
+//
+// Times opening the Geocoder, then codes each workload of workloadDir
+// (clean, typo, cityonly, intersection, postcode, ambiguous; missing ones
+// are skipped) once to warm up and then -passes times, timing every
+// CodeAddress() with its GetNextCandidate() calls.  For each workload it
+// reports the throughput, the mean, median, 99th percentile and maximum
+// latency in microseconds, the candidates per address, the share of
+// addresses matched and coded as a single best result, and, where
+// <name>.expected gives a point, the share whose best candidate is within
+// Tolerance degrees of it.  The peak resident set size is reported after
+// opening and at the end.  With -json the report is one JSON object, for
+// comparing runs by script.
+//
+// The workloads and the database are made by
+//	geocoder_loaders [-packed] Synthetic NbrCities WorkDir
+
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../geocoder/Geocoder.h"
+#include "../geocoder/GeocoderVersion.h"
+
+#if defined(WIN32)
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+// Degrees a best candidate may be from the expected point and still count
+static const double Tolerance = 0.0005;
+
+static const char* const workloadNames[] = {
+	"clean", "typo", "cityonly", "intersection", "postcode", "ambiguous"
+};
+static const int nbrWorkloadNames = sizeof(workloadNames) / sizeof(workloadNames[0]);
+
+class BenchGeocoder : public Geocoder {
+public:
+	BenchGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << message << "\n";
+	}
+};
+
+struct Address {
+	std::string line1;
+	std::string line2;
+	bool haveExpected;
+	double latitude;
+	double longitude;
+};
+
+struct WorkloadResult {
+	std::string name;
+	size_t nbrAddresses;
+	double addressesPerSecond;
+	double meanMicroseconds;
+	double p50Microseconds;
+	double p99Microseconds;
+	double maxMicroseconds;
+	double candidatesPerAddress;
+	double matchedPercent;
+	double singlePercent;
+	size_t nbrExpected;
+	double correctPercent;
+};
+
+// Peak resident set size of the process, in kilobytes
+static long PeakRssKilobytes()
+{
+#if defined(WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return long(counters.PeakWorkingSetSize / 1024);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+	return usage.ru_maxrss;
+#endif
+}
+
+static std::string ReadLine(std::istream& in, bool& ok)
+{
+	std::string line;
+	ok = bool(std::getline(in, line));
+	if (!line.empty() && line[line.size() - 1] == '\r') {
+		line.erase(line.size() - 1);
+	}
+	return line;
+}
+
+// <name>.txt and, if present, <name>.expected, line for line.  Returns
+// false if there is no <name>.txt.
+static bool ReadWorkload(const std::string& basename, std::vector<Address>& addresses)
+{
+	std::ifstream in((basename + ".txt").c_str());
+	if (!in) {
+		return false;
+	}
+	std::ifstream expected((basename + ".expected").c_str());
+	bool haveExpectedFile = bool(expected);
+	bool ok;
+	for (std::string line = ReadLine(in, ok); ok; line = ReadLine(in, ok)) {
+		Address address;
+		size_t tab = line.find('\t');
+		address.line1 = line.substr(0, tab);
+		if (tab != std::string::npos) {
+			address.line2 = line.substr(tab + 1);
+		}
+		address.haveExpected = false;
+		if (haveExpectedFile) {
+			bool expectedOk;
+			std::istringstream point(ReadLine(expected, expectedOk));
+			address.haveExpected = expectedOk && bool(point >> address.latitude >> address.longitude);
+		}
+		addresses.push_back(address);
+	}
+	return true;
+}
+
+static WorkloadResult RunWorkload(Geocoder& geocoder, const std::string& name, const std::vector<Address>& addresses, int passes)
+{
+	std::vector<double> times;
+	times.reserve(addresses.size() * passes);
+	size_t nbrCandidates = 0;
+	size_t nbrMatched = 0;
+	size_t nbrSingle = 0;
+	size_t nbrExpected = 0;
+	size_t nbrCorrect = 0;
+	Geocoder::GeocodeResults results;
+
+	// Pass 0 warms up the caches and is not counted; the candidates are
+	// checked on it, as every pass codes the same.
+	double totalMicroseconds = 0;
+	for (int pass = 0; pass <= passes; pass++) {
+		for (size_t i = 0; i < addresses.size(); i++) {
+			const Address& address = addresses[i];
+			Clock::time_point start = Clock::now();
+			Geocoder::GlobalStatus status = geocoder.CodeAddress(address.line1.c_str(), address.line2.c_str());
+			if (pass != 0) {
+				while (geocoder.GetNextCandidate(results)) {}
+				double usec = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+				times.push_back(usec);
+				totalMicroseconds += usec;
+				continue;
+			}
+			bool first = true;
+			bool correct = false;
+			while (geocoder.GetNextCandidate(results)) {
+				if (first && status != Geocoder::GlobalFailure && address.haveExpected) {
+					correct =
+						fabs(results.GetLatitude() - address.latitude) <= Tolerance &&
+						fabs(results.GetLongitude() - address.longitude) <= Tolerance;
+				}
+				first = false;
+				nbrCandidates++;
+			}
+			nbrMatched += (status != Geocoder::GlobalFailure);
+			nbrSingle += (status == Geocoder::GlobalSingle);
+			nbrExpected += address.haveExpected;
+			nbrCorrect += correct;
+		}
+	}
+
+	WorkloadResult result;
+	result.name = name;
+	result.nbrAddresses = addresses.size();
+	std::sort(times.begin(), times.end());
+	result.addressesPerSecond = totalMicroseconds > 0 ? times.size() * 1e6 / totalMicroseconds : 0;
+	result.meanMicroseconds = times.empty() ? 0 : totalMicroseconds / times.size();
+	result.p50Microseconds = times.empty() ? 0 : times[size_t(0.50 * (times.size() - 1) + 0.5)];
+	result.p99Microseconds = times.empty() ? 0 : times[size_t(0.99 * (times.size() - 1) + 0.5)];
+	result.maxMicroseconds = times.empty() ? 0 : times.back();
+	double nbr = addresses.empty() ? 1 : double(addresses.size());
+	result.candidatesPerAddress = nbrCandidates / nbr;
+	result.matchedPercent = 100.0 * nbrMatched / nbr;
+	result.singlePercent = 100.0 * nbrSingle / nbr;
+	result.nbrExpected = nbrExpected;
+	result.correctPercent = nbrExpected == 0 ? 0 : 100.0 * nbrCorrect / nbrExpected;
+	return result;
+}
+
+// Backslashes and quotes escaped; the paths are the only free text.
+static std::string JsonString(const std::string& str)
+{
+	std::string result = "\"";
+	for (size_t i = 0; i < str.size(); i++) {
+		if (str[i] == '"' || str[i] == '\\') {
+			result += '\\';
+		}
+		result += str[i];
+	}
+	return result + "\"";
+}
+
+static void PrintJson(
+	const char* databaseDir,
+	int passes,
+	double openMilliseconds,
+	long openPeakRss,
+	long peakRss,
+	const std::vector<WorkloadResult>& results
+) {
+	std::cout << std::fixed << std::setprecision(2)
+		<< "{\n"
+		<< "  \"tool\": \"geobench\",\n"
+		<< "  \"version\": " << JsonString(APP_VERSION) << ",\n"
+		<< "  \"databaseDir\": " << JsonString(databaseDir) << ",\n"
+		<< "  \"passes\": " << passes << ",\n"
+		<< "  \"openMilliseconds\": " << openMilliseconds << ",\n"
+		<< "  \"peakRssKilobytesAfterOpen\": " << openPeakRss << ",\n"
+		<< "  \"peakRssKilobytes\": " << peakRss << ",\n"
+		<< "  \"workloads\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const WorkloadResult& r = results[i];
+		std::cout << (i == 0 ? "\n" : ",\n")
+			<< "    {\"name\": " << JsonString(r.name)
+			<< ", \"addresses\": " << r.nbrAddresses
+			<< ", \"addressesPerSecond\": " << r.addressesPerSecond
+			<< ", \"meanMicroseconds\": " << r.meanMicroseconds
+			<< ", \"p50Microseconds\": " << r.p50Microseconds
+			<< ", \"p99Microseconds\": " << r.p99Microseconds
+			<< ", \"maxMicroseconds\": " << r.maxMicroseconds
+			<< ", \"candidatesPerAddress\": " << r.candidatesPerAddress
+			<< ", \"matchedPercent\": " << r.matchedPercent
+			<< ", \"singlePercent\": " << r.singlePercent
+			<< ", \"expected\": " << r.nbrExpected
+			<< ", \"correctPercent\": " << r.correctPercent
+			<< "}";
+	}
+	std::cout << "\n  ]\n}\n";
+}
+
+static void PrintTable(
+	int passes,
+	double openMilliseconds,
+	long openPeakRss,
+	long peakRss,
+	const std::vector<WorkloadResult>& results
+) {
+	std::cout << std::fixed << std::setprecision(2)
+		<< "open " << openMilliseconds << " msec, peak RSS " << openPeakRss << " KB after open, "
+		<< peakRss << " KB at end, " << passes << " passes\n"
+		<< std::left << std::setw(14) << "workload" << std::right
+		<< std::setw(10) << "addr/sec"
+		<< std::setw(9) << "mean"
+		<< std::setw(9) << "p50"
+		<< std::setw(9) << "p99"
+		<< std::setw(10) << "max"
+		<< std::setw(7) << "cand"
+		<< std::setw(9) << "match%"
+		<< std::setw(9) << "single%"
+		<< std::setw(10) << "correct%" << "\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const WorkloadResult& r = results[i];
+		std::cout << std::left << std::setw(14) << r.name << std::right
+			<< std::setw(10) << std::setprecision(0) << r.addressesPerSecond << std::setprecision(2)
+			<< std::setw(9) << r.meanMicroseconds
+			<< std::setw(9) << r.p50Microseconds
+			<< std::setw(9) << r.p99Microseconds
+			<< std::setw(10) << r.maxMicroseconds
+			<< std::setw(7) << r.candidatesPerAddress
+			<< std::setw(9) << r.matchedPercent
+			<< std::setw(9) << r.singlePercent;
+		if (r.nbrExpected != 0) {
+			std::cout << std::setw(10) << r.correctPercent;
+		} else {
+			std::cout << std::setw(10) << "-";
+		}
+		std::cout << "\n";
+	}
+	std::cout << "latencies in usec\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int passes = 5;
+	bool json = false;
+	std::vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-passes" && i + 1 < argc) {
+			passes = atoi(argv[++i]);
+		} else if (arg == "-json") {
+			json = true;
+		} else if (arg[0] == '-') {
+			args.clear();
+			break;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	if (args.size() != 3 || passes <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [-passes N] [-json] <tableDir> <databaseDir> <workloadDir>\n";
+		return 1;
+	}
+
+	Clock::time_point openStart = Clock::now();
+	BenchGeocoder geocoder(args[0], args[1]);
+	if (!geocoder.Open()) {
+		return 1;
+	}
+	double openMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - openStart).count();
+	long openPeakRss = PeakRssKilobytes();
+
+	std::vector<WorkloadResult> results;
+	for (int i = 0; i < nbrWorkloadNames; i++) {
+		std::vector<Address> addresses;
+		if (!ReadWorkload(std::string(args[2]) + "/" + workloadNames[i], addresses)) {
+			continue;
+		}
+		results.push_back(RunWorkload(geocoder, workloadNames[i], addresses, passes));
+	}
+	if (results.empty()) {
+		std::cerr << "No workloads found in " << args[2] << "\n";
+		return 1;
+	}
+
+	long peakRss = PeakRssKilobytes();
+	if (json) {
+		PrintJson(args[1], passes, openMilliseconds, openPeakRss, peakRss, results);
+	} else {
+		PrintTable(passes, openMilliseconds, openPeakRss, peakRss, results);
+	}
+	return 0;
+}
@@ -0,0 +1,221 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// TrieBench.cpp: Lookup speed of the node and frozen forms of Trie.
+//
+//	triebench [-passes N] [-keys N] [csvFile ...]
+//
+// Loads the first field of every line of the given CSV files as the keys of
+// a Trie, or, with no files, -keys made-up street names.  The queries are
+// every prefix of every key, and every key followed by " ST".  Each query
+// is looked up with Find(), FindTriePrefix() and FindKeyPrefix(), first on
+// the node form and then after Freeze(), -passes times each, and the
+// lookups per second of each are reported.  The answers of the two forms
+// are compared, and any difference is reported and fails the run.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "../global/Trie.h"
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+// Answers to every query, for comparing the two forms
+struct Answers {
+	std::vector<int> found;
+	std::vector<int> triePrefix;
+	std::vector<int> keyPrefix;
+};
+
+// Lookups per second of each method
+struct Speeds {
+	double find;
+	double triePrefix;
+	double keyPrefix;
+};
+
+static bool ReadKeys(const char* filename, std::vector<std::string>& keys)
+{
+	std::ifstream in(filename);
+	if (!in) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		std::string key = line.substr(0, line.find(','));
+		if (!key.empty() && key[0] != '#') {
+			keys.push_back(key);
+		}
+	}
+	return true;
+}
+
+static void MakeKeys(int nbrKeys, std::vector<std::string>& keys)
+{
+	static const char* const syllables[] = {
+		"MA", "PLE", "OAK", "RID", "GE", "WIL", "LOW", "CE", "DAR", "HILL",
+		"SPRING", "FIELD", "BROOK", "WOOD", "LAND", "MILL", "STONE", "RIVER"
+	};
+	static const int nbrSyllables = sizeof(syllables) / sizeof(syllables[0]);
+	unsigned int seed = 12345;
+	for (int i = 0; i < nbrKeys; i++) {
+		std::string key;
+		int length = 1 + i % 4;
+		for (int j = 0; j < length; j++) {
+			seed = seed * 1103515245 + 12345;
+			key += syllables[(seed >> 16) % nbrSyllables];
+		}
+		keys.push_back(key);
+	}
+}
+
+static double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static Speeds RunQueries(Trie<int>& trie, const std::vector<std::string>& queries, int passes, Answers& answers)
+{
+	size_t nbrQueries = queries.size();
+	answers.found.assign(nbrQueries, 0);
+	answers.triePrefix.assign(nbrQueries, 0);
+	answers.keyPrefix.assign(nbrQueries, 0);
+	double lookups = double(nbrQueries) * passes;
+	Speeds speeds;
+
+	Clock::time_point start = Clock::now();
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < nbrQueries; i++) {
+			answers.found[i] = trie.Find(queries[i].c_str());
+		}
+	}
+	speeds.find = lookups / Seconds(start);
+
+	// An answer is the length found, or -1 for not found.
+	start = Clock::now();
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < nbrQueries; i++) {
+			int length = 0;
+			answers.triePrefix[i] = trie.FindTriePrefix(queries[i].c_str(), length) ? length : -1;
+		}
+	}
+	speeds.triePrefix = lookups / Seconds(start);
+
+	start = Clock::now();
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < nbrQueries; i++) {
+			int length = 0;
+			answers.keyPrefix[i] = trie.FindKeyPrefix(queries[i].c_str(), length) ? length : -1;
+		}
+	}
+	speeds.keyPrefix = lookups / Seconds(start);
+	return speeds;
+}
+
+static int CompareAnswers(const char* method, const std::vector<int>& nodes, const std::vector<int>& frozen, const std::vector<std::string>& queries)
+{
+	int differences = 0;
+	for (size_t i = 0; i < queries.size(); i++) {
+		if (nodes[i] != frozen[i]) {
+			if (differences < 10) {
+				std::cerr << method << "(\"" << queries[i] << "\"): " << nodes[i] << " before Freeze(), " << frozen[i] << " after\n";
+			}
+			differences++;
+		}
+	}
+	return differences;
+}
+
+int main(int argc, char* argv[])
+{
+	int passes = 5;
+	int nbrKeys = 20000;
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-passes" && i + 1 < argc) {
+			passes = atoi(argv[++i]);
+		} else if (arg == "-keys" && i + 1 < argc) {
+			nbrKeys = atoi(argv[++i]);
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+	if (passes <= 0 || nbrKeys <= 0) {
+		std::cerr << "Usage: triebench [-passes N] [-keys N] [csvFile ...]\n";
+		return 1;
+	}
+
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (!ReadKeys(files[i], keys)) {
+			std::cerr << "Cannot open " << files[i] << "\n";
+			return 1;
+		}
+	}
+	if (files.empty()) {
+		MakeKeys(nbrKeys, keys);
+	}
+
+	Trie<int> trie;
+	std::vector<std::string> queries;
+	for (size_t i = 0; i < keys.size(); i++) {
+		trie.Insert(keys[i].c_str(), int(i) + 1);
+		for (size_t length = 1; length <= keys[i].size(); length++) {
+			queries.push_back(keys[i].substr(0, length));
+		}
+		queries.push_back(keys[i] + " ST");
+	}
+
+	Answers nodeAnswers;
+	Speeds nodeSpeeds = RunQueries(trie, queries, passes, nodeAnswers);
+	trie.Freeze();
+	Answers frozenAnswers;
+	Speeds frozenSpeeds = RunQueries(trie, queries, passes, frozenAnswers);
+
+	std::cout << keys.size() << " keys, " << queries.size() << " queries, " << passes << " passes\n";
+	std::cout << std::fixed << std::setprecision(0)
+		<< std::setw(16) << "lookups/sec" << std::setw(16) << "nodes" << std::setw(16) << "frozen" << "\n"
+		<< std::setw(16) << "Find" << std::setw(16) << nodeSpeeds.find << std::setw(16) << frozenSpeeds.find << "\n"
+		<< std::setw(16) << "FindTriePrefix" << std::setw(16) << nodeSpeeds.triePrefix << std::setw(16) << frozenSpeeds.triePrefix << "\n"
+		<< std::setw(16) << "FindKeyPrefix" << std::setw(16) << nodeSpeeds.keyPrefix << std::setw(16) << frozenSpeeds.keyPrefix << "\n";
+
+	int differences =
+		CompareAnswers("Find", nodeAnswers.found, frozenAnswers.found, queries) +
+		CompareAnswers("FindTriePrefix", nodeAnswers.triePrefix, frozenAnswers.triePrefix, queries) +
+		CompareAnswers("FindKeyPrefix", nodeAnswers.keyPrefix, frozenAnswers.keyPrefix, queries);
+	if (differences != 0) {
+		std::cerr << differences << " answers differ between the node and frozen forms\n";
+		return 1;
+	}
+	return 0;
+}
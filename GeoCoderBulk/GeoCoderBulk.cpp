@@ -0,0 +1,780 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// GeoCoderBulk.cpp: Streaming bulk geocoder for CSV/TSV files.
+//
+// Records flow through a pipeline of threads connected by bounded queues:
+//
+//	reader --> parse workers --> geocode workers --> ordered writer
+//
+// The reader splits the input into records, parse workers split records into
+// fields and assemble the two address lines, and each geocode worker owns its
+// own Geocoder.  The writer restores input order before writing.  The number
+// of records between the reader and the writer is capped, so memory use does
+// not depend on the size of the input.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "../geocoder/Geocoder.h"
+#include "../global/MPMCQueue.h"
+
+using namespace PortfolioExplorer;
+
+///////////////////////////////////////////////////////////////////////////////
+// Command-line settings
+///////////////////////////////////////////////////////////////////////////////
+struct BulkOptions {
+	BulkOptions() :
+		delimiter(0), header(true), keepInput(false),
+		parseThreads(1), geocodeThreads(0), queueSize(1024)
+	{}
+
+	std::string tableDir;
+	std::string databaseDir;
+	std::string inputFile;
+	std::string outputFile;
+
+	// Field delimiter; zero means "guess from the input file extension"
+	char delimiter;
+	// Does the input start with a header record?
+	bool header;
+	// Copy the input fields to the front of each output record?
+	bool keepInput;
+
+	// Column names (or 1-based numbers) of the address components.
+	// Either line2Column or some of city/state/postcode are used.
+	std::string idColumn;
+	std::string line1Column;
+	std::string line2Column;
+	std::string cityColumn;
+	std::string stateColumn;
+	std::string postcodeColumn;
+
+	int parseThreads;
+	int geocodeThreads;
+	// Capacity of each queue.  At most four times this many records are in
+	// the pipeline at once.
+	int queueSize;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// One input record as it moves through the pipeline
+///////////////////////////////////////////////////////////////////////////////
+struct BulkRecord {
+	// Position in the input, starting at zero
+	long sequence;
+	// The raw record text
+	std::string text;
+	// Address lines and id assembled by the parse stage
+	std::string id;
+	std::string line1;
+	std::string line2;
+	// Input fields, kept only with -keep
+	std::vector<std::string> fields;
+	// Formatted output record, without the terminating newline
+	std::string output;
+	// Did the geocoder produce a match?
+	bool matched;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A blocking queue with fixed capacity, closed when its last producer is
+// done.  Push() waits while the queue is full, which is what throttles the
+// stages upstream of a slow one.
+///////////////////////////////////////////////////////////////////////////////
+template <class T> class BulkQueue {
+public:
+	BulkQueue(size_t capacity) : queue(capacity), producers(0) {}
+
+	// Register a producer thread.  The queue is closed once every
+	// registered producer has called Done().
+	void AddProducer() { producers++; }
+
+	void Done() {
+		if (--producers == 0) {
+			queue.Close();
+		}
+	}
+
+	void Push(const T& item) { queue.Push(item); }
+
+	// Returns false when the queue is empty and closed.
+	bool Pop(T& item) { return queue.Pop(item); }
+
+	// Pop up to maxCount items, waiting for at least one.  Returns 0 when
+	// the queue is empty and closed.
+	size_t PopBatch(T* items, size_t maxCount) { return queue.PopBatch(items, maxCount); }
+
+private:
+	MPMCQueue<T> queue;
+	std::atomic<int> producers;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocoder that reports its errors on stderr
+///////////////////////////////////////////////////////////////////////////////
+class BulkGeocoder final : public Geocoder {
+public:
+	BulkGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << "Geocoder: " << message << std::endl;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads records, which may span lines if a quoted field contains a newline.
+// A quote left open for MaxRecordLines lines or MaxRecordBytes bytes, or at
+// the end of the input, is taken to be a stray: the line it started on is
+// reported and skipped, and reading starts again on the next line, so one
+// bad quote cannot swallow the rest of the file.
+///////////////////////////////////////////////////////////////////////////////
+class RecordReader {
+public:
+	enum { MaxRecordLines = 64, MaxRecordBytes = 64 * 1024 };
+
+	RecordReader(std::istream& is_) : is(is_), lineNumber(0) {}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Read the next record.
+	// Return value:
+	//	bool		false at end of input.
+	///////////////////////////////////////////////////////////////////////////
+	bool Read(std::string& record);
+
+private:
+	struct Line {
+		long number;
+		std::string text;
+	};
+
+	// The next line, from those given back by a resync or from the input
+	bool NextLine(Line& line);
+
+	std::istream& is;
+	std::deque<Line> pending;
+	long lineNumber;
+};
+
+bool RecordReader::NextLine(Line& line)
+{
+	if (!pending.empty()) {
+		line = pending.front();
+		pending.pop_front();
+		return true;
+	}
+	if (!std::getline(is, line.text)) {
+		return false;
+	}
+	if (!line.text.empty() && line.text[line.text.size() - 1] == '\r') {
+		line.text.resize(line.text.size() - 1);
+	}
+	line.number = ++lineNumber;
+	return true;
+}
+
+bool RecordReader::Read(std::string& record)
+{
+	std::vector<Line> lines;
+	Line line;
+	for (;;) {
+		record.clear();
+		lines.clear();
+		bool inQuotes = false;
+		bool atEnd = false;
+		for (;;) {
+			if (!NextLine(line)) {
+				atEnd = true;
+				break;
+			}
+			for (size_t i = 0; i < line.text.size(); i++) {
+				if (line.text[i] == '"') {
+					inQuotes = !inQuotes;
+				}
+			}
+			if (!lines.empty()) {
+				record += '\n';
+			}
+			record += line.text;
+			lines.push_back(line);
+			if (!inQuotes) {
+				return true;
+			}
+			if (lines.size() >= MaxRecordLines || record.size() >= MaxRecordBytes) {
+				break;
+			}
+		}
+		if (lines.empty()) {
+			return false;
+		}
+		// Unbalanced quote: skip its line and read the others again.
+		std::cerr << "Line " << lines[0].number << ": unbalanced quote, line skipped" << std::endl;
+		pending.insert(pending.begin(), lines.begin() + 1, lines.end());
+		if (atEnd && pending.empty()) {
+			return false;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Split a record into fields, removing quotes.  Doubled quotes inside a
+// quoted field stand for one quote.
+///////////////////////////////////////////////////////////////////////////////
+static void SplitRecord(
+	const std::string& record,
+	char delimiter,
+	std::vector<std::string>& fields
+) {
+	fields.clear();
+	fields.push_back(std::string());
+	bool inQuotes = false;
+	for (size_t i = 0; i < record.size(); i++) {
+		char c = record[i];
+		if (inQuotes) {
+			if (c == '"') {
+				if (i + 1 < record.size() && record[i + 1] == '"') {
+					fields.back() += '"';
+					i++;
+				} else {
+					inQuotes = false;
+				}
+			} else {
+				fields.back() += c;
+			}
+		} else if (c == '"') {
+			inQuotes = true;
+		} else if (c == delimiter) {
+			fields.push_back(std::string());
+		} else {
+			fields.back() += c;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Append a field to an output record, quoting it if necessary.
+///////////////////////////////////////////////////////////////////////////////
+static void AppendField(std::string& record, const std::string& value, char delimiter)
+{
+	if (!record.empty()) {
+		record += delimiter;
+	}
+	if (value.find_first_of(std::string("\"\r\n") + delimiter) == std::string::npos) {
+		record += value;
+		return;
+	}
+	record += '"';
+	for (size_t i = 0; i < value.size(); i++) {
+		if (value[i] == '"') {
+			record += '"';
+		}
+		record += value[i];
+	}
+	record += '"';
+}
+
+template <class T> static void AppendValue(std::string& record, T value, char delimiter)
+{
+	std::ostringstream os;
+	os.precision(10);
+	os << value;
+	AppendField(record, os.str(), delimiter);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Resolve a column given by name (using the header) or by 1-based number.
+// Return value:
+//	int		The 0-based column index, or -1 if the column is not specified.
+///////////////////////////////////////////////////////////////////////////////
+static int ResolveColumn(
+	const std::string& column,
+	const std::vector<std::string>& header
+) {
+	if (column.empty()) {
+		return -1;
+	}
+	for (size_t i = 0; i < header.size(); i++) {
+		if (header[i] == column) {
+			return (int)i;
+		}
+	}
+	int number = atoi(column.c_str());
+	if (number <= 0) {
+		throw std::string("Unknown column \"") + column + "\"";
+	}
+	return number - 1;
+}
+
+// Names of the output columns, in the order written by FormatResults()
+static const char* resultColumns[] = {
+	"GlobalStatus", "MatchScore", "MatchStatus", "GeoStatus",
+	"AddrNbr", "Prefix", "Predir", "Street", "Suffix", "Postdir", "UnitDes", "Unit",
+	"City", "State", "StateAbbr", "CountryCode", "CountyCode", "CensusTract", "CensusBlock",
+	"Postcode", "PostcodeExt", "Latitude", "Longitude",
+	"Prefix2", "Predir2", "Street2", "Suffix2", "Postdir2",
+	0
+};
+
+static const char* globalStatusNames[] = { "Single", "Multiple", "Failure" };
+
+///////////////////////////////////////////////////////////////////////////////
+// Append every GeocodeResults field of the best candidate.
+///////////////////////////////////////////////////////////////////////////////
+static void FormatResults(
+	std::string& record,
+	Geocoder::GlobalStatus status,
+	Geocoder::GeocodeResults* results,
+	char delimiter
+) {
+	AppendField(record, globalStatusNames[status], delimiter);
+	if (results == 0) {
+		// Leave the remaining columns empty.
+		for (int i = 1; resultColumns[i] != 0; i++) {
+			record += delimiter;
+		}
+		return;
+	}
+	AppendValue(record, results->GetMatchScore(), delimiter);
+	AppendValue(record, results->GetMatchStatus(), delimiter);
+	AppendValue(record, results->GetGeoStatus(), delimiter);
+	AppendField(record, results->GetAddrNbr(), delimiter);
+	AppendField(record, results->GetPrefix(), delimiter);
+	AppendField(record, results->GetPredir(), delimiter);
+	AppendField(record, results->GetStreet(), delimiter);
+	AppendField(record, results->GetSuffix(), delimiter);
+	AppendField(record, results->GetPostdir(), delimiter);
+	AppendField(record, results->GetUnitDes(), delimiter);
+	AppendField(record, results->GetUnit(), delimiter);
+	AppendField(record, results->GetCity(), delimiter);
+	AppendValue(record, results->GetState(), delimiter);
+	AppendField(record, results->GetStateAbbr(), delimiter);
+	AppendField(record, results->GetCountryCode(), delimiter);
+	AppendValue(record, results->GetCountyCode(), delimiter);
+	AppendField(record, results->GetCensusTract(), delimiter);
+	AppendField(record, results->GetCensusBlock(), delimiter);
+	AppendField(record, results->GetPostcode(), delimiter);
+	AppendField(record, results->GetPostcodeExt(), delimiter);
+	AppendValue(record, results->GetLatitude(), delimiter);
+	AppendValue(record, results->GetLongitude(), delimiter);
+	AppendField(record, results->GetPrefix2(), delimiter);
+	AppendField(record, results->GetPredir2(), delimiter);
+	AppendField(record, results->GetStreet2(), delimiter);
+	AppendField(record, results->GetSuffix2(), delimiter);
+	AppendField(record, results->GetPostdir2(), delimiter);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pipeline state shared by all stages
+///////////////////////////////////////////////////////////////////////////////
+class BulkPipeline {
+public:
+	BulkPipeline(const BulkOptions& options_) :
+		options(options_),
+		readQueue(options_.queueSize),
+		parsedQueue(options_.queueSize),
+		codedQueue(options_.queueSize),
+		inFlight(0),
+		recordsRead(0),
+		recordsMatched(0)
+	{}
+
+	int Run();
+
+private:
+	void Reader(RecordReader& reader);
+	void ParseWorker();
+	void GeocodeWorker(Geocoder* geocoder);
+	void Writer(std::ostream& os);
+	void ReportProgress(long written, bool final);
+
+	const BulkOptions& options;
+
+	// Column indexes, resolved from the header
+	int idIndex;
+	int line1Index;
+	int line2Index;
+	int cityIndex;
+	int stateIndex;
+	int postcodeIndex;
+	char delimiter;
+	std::vector<std::string> header;
+
+	BulkQueue<BulkRecord*> readQueue;
+	BulkQueue<BulkRecord*> parsedQueue;
+	BulkQueue<BulkRecord*> codedQueue;
+
+	// Records between the reader and the writer, capped at maxInFlight
+	long inFlight;
+	long maxInFlight;
+	std::mutex inFlightMutex;
+	std::condition_variable inFlightChanged;
+
+	std::atomic<long> recordsRead;
+	std::atomic<long> recordsMatched;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point lastReport;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Reader stage: split the input into records.
+///////////////////////////////////////////////////////////////////////////////
+void BulkPipeline::Reader(RecordReader& reader)
+{
+	std::string text;
+	long sequence = 0;
+	while (reader.Read(text)) {
+		{
+			std::unique_lock<std::mutex> lock(inFlightMutex);
+			inFlightChanged.wait(lock, [this] { return inFlight < maxInFlight; });
+			inFlight++;
+		}
+		BulkRecord* record = new BulkRecord;
+		record->sequence = sequence++;
+		record->text.swap(text);
+		record->matched = false;
+		recordsRead++;
+		readQueue.Push(record);
+	}
+	readQueue.Done();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Parse stage: split records into fields and build the address lines.
+///////////////////////////////////////////////////////////////////////////////
+void BulkPipeline::ParseWorker()
+{
+	std::vector<std::string> fields;
+	BulkRecord* record;
+	while (readQueue.Pop(record)) {
+		SplitRecord(record->text, delimiter, fields);
+		record->text.clear();
+		fields.resize(header.size() > fields.size() ? header.size() : fields.size());
+
+		if (idIndex >= 0 && idIndex < (int)fields.size()) {
+			record->id = fields[idIndex];
+		}
+		if (line1Index < (int)fields.size()) {
+			record->line1 = fields[line1Index];
+		}
+		if (line2Index >= 0) {
+			if (line2Index < (int)fields.size()) {
+				record->line2 = fields[line2Index];
+			}
+		} else {
+			// "city, state postcode"
+			if (cityIndex >= 0 && cityIndex < (int)fields.size()) {
+				record->line2 = fields[cityIndex];
+			}
+			if (stateIndex >= 0 && stateIndex < (int)fields.size() && !fields[stateIndex].empty()) {
+				record->line2 += (record->line2.empty() ? "" : ", ") + fields[stateIndex];
+			}
+			if (postcodeIndex >= 0 && postcodeIndex < (int)fields.size() && !fields[postcodeIndex].empty()) {
+				record->line2 += (record->line2.empty() ? "" : " ") + fields[postcodeIndex];
+			}
+		}
+		if (options.keepInput) {
+			record->fields.swap(fields);
+		}
+		parsedQueue.Push(record);
+	}
+	parsedQueue.Done();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocode stage: each worker owns one Geocoder.
+///////////////////////////////////////////////////////////////////////////////
+void BulkPipeline::GeocodeWorker(Geocoder* geocoder)
+{
+	Geocoder::GeocodeResults results;
+	BulkRecord* record;
+	while (parsedQueue.Pop(record)) {
+		Geocoder::GlobalStatus status = 
+			geocoder->CodeAddress(record->line1.c_str(), record->line2.c_str());
+		bool haveResults = geocoder->GetNextCandidate(results);
+		record->matched = status != Geocoder::GlobalFailure;
+
+		for (size_t i = 0; i < record->fields.size(); i++) {
+			AppendField(record->output, record->fields[i], delimiter);
+		}
+		record->fields.clear();
+		if (idIndex >= 0) {
+			AppendField(record->output, record->id, delimiter);
+		}
+		FormatResults(record->output, status, haveResults ? &results : 0, delimiter);
+		codedQueue.Push(record);
+	}
+	codedQueue.Done();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writer stage: restore input order and write.
+///////////////////////////////////////////////////////////////////////////////
+void BulkPipeline::Writer(std::ostream& os)
+{
+	std::map<long, BulkRecord*> pending;
+	long next = 0;
+	BulkRecord* records[64];
+	size_t nbrRecords;
+	while ((nbrRecords = codedQueue.PopBatch(records, 64)) != 0) {
+		for (size_t i = 0; i < nbrRecords; i++) {
+			pending[records[i]->sequence] = records[i];
+		}
+		while (!pending.empty() && pending.begin()->first == next) {
+			BulkRecord* record = pending.begin()->second;
+			pending.erase(pending.begin());
+			os << record->output << '\n';
+			if (record->matched) {
+				recordsMatched++;
+			}
+			delete record;
+			next++;
+			{
+				std::lock_guard<std::mutex> lock(inFlightMutex);
+				inFlight--;
+			}
+			inFlightChanged.notify_one();
+			ReportProgress(next, false);
+		}
+	}
+	os.flush();
+	ReportProgress(next, true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Print progress and throughput to stderr, at most every two seconds.
+///////////////////////////////////////////////////////////////////////////////
+void BulkPipeline::ReportProgress(long written, bool final)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!final && now - lastReport < std::chrono::seconds(2)) {
+		return;
+	}
+	lastReport = now;
+	double seconds = std::chrono::duration<double>(now - startTime).count();
+	std::cerr 
+		<< (final ? "Done: " : "Progress: ")
+		<< written << " records written, "
+		<< recordsRead << " read, "
+		<< recordsMatched << " matched, "
+		<< (long)(seconds > 0 ? written / seconds : 0) << " records/sec, "
+		<< (long)seconds << " sec elapsed" 
+		<< std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Open the files and geocoders, run every stage, and wait for the end.
+///////////////////////////////////////////////////////////////////////////////
+int BulkPipeline::Run()
+{
+	std::ifstream is(options.inputFile.c_str(), std::ios::in | std::ios::binary);
+	if (!is) {
+		std::cerr << "Cannot open input file " << options.inputFile << std::endl;
+		return 1;
+	}
+	std::ofstream os(options.outputFile.c_str(), std::ios::out | std::ios::binary);
+	if (!os) {
+		std::cerr << "Cannot create output file " << options.outputFile << std::endl;
+		return 1;
+	}
+
+	delimiter = options.delimiter;
+	if (delimiter == 0) {
+		size_t length = options.inputFile.size();
+		bool tsv = 
+			length > 4 && 
+			(options.inputFile.compare(length - 4, 4, ".tsv") == 0 ||
+			 options.inputFile.compare(length - 4, 4, ".txt") == 0);
+		delimiter = tsv ? '\t' : ',';
+	}
+
+	// Resolve columns
+	RecordReader reader(is);
+	std::string text;
+	if (options.header && reader.Read(text)) {
+		SplitRecord(text, delimiter, header);
+	}
+	try {
+		idIndex = ResolveColumn(options.idColumn, header);
+		line1Index = ResolveColumn(options.line1Column, header);
+		line2Index = ResolveColumn(options.line2Column, header);
+		cityIndex = ResolveColumn(options.cityColumn, header);
+		stateIndex = ResolveColumn(options.stateColumn, header);
+		postcodeIndex = ResolveColumn(options.postcodeColumn, header);
+	} catch (const std::string& message) {
+		std::cerr << message << std::endl;
+		return 1;
+	}
+	if (line1Index < 0) {
+		std::cerr << "The street address column (-line1) is required" << std::endl;
+		return 1;
+	}
+
+	// Output header
+	std::string outputHeader;
+	if (options.keepInput) {
+		for (size_t i = 0; i < header.size(); i++) {
+			AppendField(outputHeader, header[i], delimiter);
+		}
+	}
+	if (idIndex >= 0) {
+		AppendField(outputHeader, options.idColumn, delimiter);
+	}
+	for (int i = 0; resultColumns[i] != 0; i++) {
+		AppendField(outputHeader, resultColumns[i], delimiter);
+	}
+	os << outputHeader << '\n';
+
+	// Open the geocoders one at a time; Open() is not meant to run concurrently.
+	int geocodeThreads = options.geocodeThreads;
+	if (geocodeThreads <= 0) {
+		geocodeThreads = (int)std::thread::hardware_concurrency();
+		if (geocodeThreads <= 0) {
+			geocodeThreads = 1;
+		}
+	}
+	std::vector<BulkGeocoder*> geocoders;
+	for (int i = 0; i < geocodeThreads; i++) {
+		BulkGeocoder* geocoder = new BulkGeocoder(options.tableDir.c_str(), options.databaseDir.c_str());
+		geocoders.push_back(geocoder);
+		if (!geocoder->Open()) {
+			std::cerr << "Cannot open the geocoder; check the table and database directories" << std::endl;
+			for (size_t j = 0; j < geocoders.size(); j++) {
+				delete geocoders[j];
+			}
+			return 1;
+		}
+	}
+
+	maxInFlight = 4L * options.queueSize;
+	startTime = lastReport = std::chrono::steady_clock::now();
+
+	readQueue.AddProducer();
+	for (int i = 0; i < options.parseThreads; i++) {
+		parsedQueue.AddProducer();
+	}
+	for (int i = 0; i < geocodeThreads; i++) {
+		codedQueue.AddProducer();
+	}
+
+	std::vector<std::thread> threads;
+	threads.push_back(std::thread(&BulkPipeline::Reader, this, std::ref(reader)));
+	for (int i = 0; i < options.parseThreads; i++) {
+		threads.push_back(std::thread(&BulkPipeline::ParseWorker, this));
+	}
+	for (int i = 0; i < geocodeThreads; i++) {
+		threads.push_back(std::thread(&BulkPipeline::GeocodeWorker, this, geocoders[i]));
+	}
+	Writer(os);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	for (size_t i = 0; i < geocoders.size(); i++) {
+		delete geocoders[i];
+	}
+	return os ? 0 : 1;
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << 
+		"Usage: " << program << " [options] <tableDir> <databaseDir> <input> <output>\n"
+		"Address columns (header name or 1-based number):\n"
+		"  -line1 COL        street address (required)\n"
+		"  -line2 COL        city, state and postcode in one column, or\n"
+		"  -city COL  -state COL  -postcode COL\n"
+		"  -id COL           column copied to the output to identify records\n"
+		"Other options:\n"
+		"  -delim C          field delimiter: a character, or 'tab'\n"
+		"                    (default: tab for .tsv/.txt input, comma otherwise)\n"
+		"  -noheader         input has no header record; columns must be numbers\n"
+		"  -keep             copy all input fields to the output\n"
+		"  -parsers N        number of parse threads (default 1)\n"
+		"  -threads N        number of geocode threads (default: one per CPU)\n"
+		"  -queue N          capacity of each pipeline queue (default 1024)\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+	BulkOptions options;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-noheader") {
+			options.header = false;
+		} else if (arg == "-keep") {
+			options.keepInput = true;
+		} else if (arg == "-line1" && hasValue) {
+			options.line1Column = argv[++i];
+		} else if (arg == "-line2" && hasValue) {
+			options.line2Column = argv[++i];
+		} else if (arg == "-city" && hasValue) {
+			options.cityColumn = argv[++i];
+		} else if (arg == "-state" && hasValue) {
+			options.stateColumn = argv[++i];
+		} else if (arg == "-postcode" && hasValue) {
+			options.postcodeColumn = argv[++i];
+		} else if (arg == "-id" && hasValue) {
+			options.idColumn = argv[++i];
+		} else if (arg == "-delim" && hasValue) {
+			std::string delim = argv[++i];
+			options.delimiter = (delim == "tab") ? '\t' : delim[0];
+		} else if (arg == "-parsers" && hasValue) {
+			options.parseThreads = atoi(argv[++i]);
+		} else if (arg == "-threads" && hasValue) {
+			options.geocodeThreads = atoi(argv[++i]);
+		} else if (arg == "-queue" && hasValue) {
+			options.queueSize = atoi(argv[++i]);
+		} else if (!arg.empty() && arg[0] == '-') {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() != 4 || options.parseThreads <= 0 || options.queueSize <= 0) {
+		Usage(argv[0]);
+		return 1;
+	}
+	options.tableDir = positional[0];
+	options.databaseDir = positional[1];
+	options.inputFile = positional[2];
+	options.outputFile = positional[3];
+
+	BulkPipeline pipeline(options);
+	return pipeline.Run();
+}
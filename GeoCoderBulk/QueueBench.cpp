@@ -0,0 +1,220 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// QueueBench.cpp: Throughput of the queues between pipeline threads.
+//
+//	queuebench [-producers N] [-consumers N] [-items N] [-capacity N] [-batch N]
+//
+// Moves the given number of items from the producer threads to the consumer
+// threads through ThreadSafeFIFO, MPMCQueue one item at a time, and
+// MPMCQueue a batch at a time, and reports items per second for each.  The
+// sum of the items received is checked against the sum sent.
+
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "../global/ThreadSafeFifo.h"
+#include "../global/MPMCQueue.h"
+
+using namespace PortfolioExplorer;
+
+struct BenchOptions {
+	BenchOptions() : producers(4), consumers(4), items(4000000), capacity(1024), batch(32) {}
+	int producers;
+	int consumers;
+	long items;
+	int capacity;
+	int batch;
+};
+
+// Items sent by one producer: the values first..last, step nbrProducers.
+struct ProducerRange {
+	long first;
+	long step;
+	long last;
+};
+
+static std::vector<ProducerRange> SplitItems(const BenchOptions& options)
+{
+	std::vector<ProducerRange> ranges(options.producers);
+	for (int p = 0; p < options.producers; p++) {
+		ranges[p].first = p + 1;
+		ranges[p].step = options.producers;
+		ranges[p].last = options.items;
+	}
+	return ranges;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadSafeFIFO: unbounded, so producers never wait.  Consumers poll.
+///////////////////////////////////////////////////////////////////////////////
+static long RunFifo(const BenchOptions& options)
+{
+	ThreadSafeFIFO<long> fifo;
+	std::atomic<long> received(0);
+	std::atomic<long> sum(0);
+	std::vector<std::thread> threads;
+	std::vector<ProducerRange> ranges = SplitItems(options);
+	for (int p = 0; p < options.producers; p++) {
+		threads.push_back(std::thread([&fifo, &ranges, p] {
+			for (long value = ranges[p].first; value <= ranges[p].last; value += ranges[p].step) {
+				fifo.add(value);
+			}
+		}));
+	}
+	for (int c = 0; c < options.consumers; c++) {
+		threads.push_back(std::thread([&fifo, &received, &sum, &options] {
+			long localSum = 0;
+			long value;
+			while (received.load(std::memory_order_relaxed) < options.items) {
+				if (fifo.try_remove(value)) {
+					localSum += value;
+					received++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+			sum += localSum;
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MPMCQueue, batch items at a time (one at a time when batch is 1).
+///////////////////////////////////////////////////////////////////////////////
+static long RunMPMC(const BenchOptions& options, int batch)
+{
+	MPMCQueue<long> queue(options.capacity);
+	std::atomic<int> producersLeft(options.producers);
+	std::atomic<long> sum(0);
+	std::vector<std::thread> threads;
+	std::vector<ProducerRange> ranges = SplitItems(options);
+	for (int p = 0; p < options.producers; p++) {
+		threads.push_back(std::thread([&queue, &producersLeft, &ranges, p, batch] {
+			std::vector<long> buffer;
+			for (long value = ranges[p].first; value <= ranges[p].last; value += ranges[p].step) {
+				if (batch == 1) {
+					queue.Push(value);
+					continue;
+				}
+				buffer.push_back(value);
+				if ((int)buffer.size() == batch) {
+					queue.PushBatch(&buffer[0], buffer.size());
+					buffer.clear();
+				}
+			}
+			if (!buffer.empty()) {
+				queue.PushBatch(&buffer[0], buffer.size());
+			}
+			if (--producersLeft == 0) {
+				queue.Close();
+			}
+		}));
+	}
+	for (int c = 0; c < options.consumers; c++) {
+		threads.push_back(std::thread([&queue, &sum, batch] {
+			long localSum = 0;
+			std::vector<long> buffer(batch);
+			size_t n;
+			while ((n = queue.PopBatch(&buffer[0], buffer.size())) != 0) {
+				for (size_t i = 0; i < n; i++) {
+					localSum += buffer[i];
+				}
+			}
+			sum += localSum;
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	return sum;
+}
+
+static bool Report(const char* name, const BenchOptions& options, long sum, std::chrono::steady_clock::time_point start)
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	long expected = options.items * (options.items + 1) / 2;
+	std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+		<< std::setprecision(3) << std::setw(8) << seconds << " sec  "
+		<< std::setprecision(2) << std::setw(8) << (seconds > 0 ? options.items / seconds / 1e6 : 0.0) << " M items/sec"
+		<< (sum == expected ? "" : "  WRONG SUM") << std::endl;
+	return sum == expected;
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+		"  -producers N      producer threads (default 4)\n"
+		"  -consumers N      consumer threads (default 4)\n"
+		"  -items N          items to move (default 4000000)\n"
+		"  -capacity N       MPMCQueue capacity (default 1024)\n"
+		"  -batch N          items per PushBatch/PopBatch (default 32)\n";
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-producers" && hasValue) {
+			options.producers = atoi(argv[++i]);
+		} else if (arg == "-consumers" && hasValue) {
+			options.consumers = atoi(argv[++i]);
+		} else if (arg == "-items" && hasValue) {
+			options.items = atol(argv[++i]);
+		} else if (arg == "-capacity" && hasValue) {
+			options.capacity = atoi(argv[++i]);
+		} else if (arg == "-batch" && hasValue) {
+			options.batch = atoi(argv[++i]);
+		} else {
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (options.producers <= 0 || options.consumers <= 0 || options.items <= 0 ||
+		options.capacity <= 0 || options.batch <= 0
+	) {
+		Usage(argv[0]);
+		return 1;
+	}
+	std::cout << options.producers << " producers, " << options.consumers << " consumers, "
+		<< options.items << " items" << std::endl;
+
+	bool ok = true;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ok &= Report("ThreadSafeFIFO", options, RunFifo(options), start);
+	start = std::chrono::steady_clock::now();
+	ok &= Report("MPMCQueue", options, RunMPMC(options, 1), start);
+	start = std::chrono::steady_clock::now();
+	ok &= Report("MPMCQueue batch", options, RunMPMC(options, options.batch), start);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// LoadGenerator.cpp: Load generator for the geocoding daemon.
+//
+// Opens several connections to GeoCoderServer and keeps a fixed number of
+// requests outstanding on each, cycling through a file of addresses.  When
+// done, it reports throughput and the latency distribution, which is what
+// is needed to size a deployment.
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+///////////////////////////////////////////////////////////////////////////////
+// Command-line settings
+///////////////////////////////////////////////////////////////////////////////
+struct LoadOptions {
+	LoadOptions() : 
+		socketPath("/tmp/geocoder.sock"), port(0),
+		connections(4), depth(16), requests(0)
+	{}
+	std::string socketPath;
+	int port;
+	int connections;
+	// Requests outstanding on each connection
+	int depth;
+	// Total requests to send; zero means one pass over the address file
+	long requests;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Results gathered by one connection
+///////////////////////////////////////////////////////////////////////////////
+struct LoadResults {
+	LoadResults() : errors(0) {}
+	// Latency of every request, in microseconds
+	std::vector<double> latencies;
+	// Replies by GlobalStatus name
+	std::map<std::string, long> statusCounts;
+	// Connection or protocol failures
+	long errors;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Connect to the server.
+// Return value:
+//	int		The socket, or -1 on error.
+///////////////////////////////////////////////////////////////////////////////
+static int Connect(const LoadOptions& options)
+{
+	int fd;
+	if (options.port == 0) {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	} else {
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(options.port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+			close(fd);
+			fd = -1;
+		} else if (fd >= 0) {
+			int on = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		}
+	}
+	return fd;
+}
+
+static bool SendAll(int fd, const std::string& buffer)
+{
+	size_t offset = 0;
+	while (offset < buffer.size()) {
+		ssize_t count = send(fd, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		offset += count;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Drive one connection.  Request numbers connection, connection+stride, ...
+// below "total" are sent, keeping at most options.depth outstanding.
+///////////////////////////////////////////////////////////////////////////////
+static void RunConnection(
+	const LoadOptions& options,
+	const std::vector<std::string>& addresses,
+	int connection,
+	long total,
+	LoadResults& results
+) {
+	int fd = Connect(options);
+	if (fd < 0) {
+		std::cerr << "Cannot connect: " << strerror(errno) << std::endl;
+		results.errors++;
+		return;
+	}
+	long stride = options.connections;
+	long next = connection;
+	long outstanding = 0;
+	std::map<long, Clock::time_point> sendTimes;
+	std::string request;
+	std::string pending;
+	char buffer[16384];
+
+	while (next < total || outstanding > 0) {
+		// Top up the pipeline
+		request.clear();
+		while (next < total && outstanding < options.depth) {
+			char id[32];
+			sprintf(id, "%ld\t", next);
+			request += id;
+			request += addresses[next % addresses.size()];
+			request += '\n';
+			sendTimes[next] = Clock::now();
+			next += stride;
+			outstanding++;
+		}
+		if (!request.empty() && !SendAll(fd, request)) {
+			results.errors++;
+			break;
+		}
+
+		// Collect replies
+		ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			std::cerr << "Connection closed by server" << std::endl;
+			results.errors++;
+			break;
+		}
+		Clock::time_point now = Clock::now();
+		pending.append(buffer, count);
+		size_t start = 0;
+		size_t end;
+		while ((end = pending.find('\n', start)) != std::string::npos) {
+			size_t tab1 = pending.find('\t', start);
+			size_t tab2 = tab1 < end ? pending.find('\t', tab1 + 1) : std::string::npos;
+			if (tab2 == std::string::npos || tab2 > end) {
+				results.errors++;
+			} else {
+				long id = atol(pending.c_str() + start);
+				std::map<long, Clock::time_point>::iterator iter = sendTimes.find(id);
+				if (iter == sendTimes.end()) {
+					results.errors++;
+				} else {
+					results.latencies.push_back(
+						std::chrono::duration<double, std::micro>(now - iter->second).count()
+					);
+					sendTimes.erase(iter);
+					outstanding--;
+				}
+				results.statusCounts[pending.substr(tab1 + 1, tab2 - tab1 - 1)]++;
+			}
+			start = end + 1;
+		}
+		pending.erase(0, start);
+	}
+	close(fd);
+}
+
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << 
+		"Usage: " << program << " [options] <addressFile>\n"
+		"The address file holds one address per line: line1 TAB line2\n"
+		"  -socket PATH      connect to a Unix domain socket (default /tmp/geocoder.sock)\n"
+		"  -port N           connect to localhost TCP port N instead\n"
+		"  -connections N    number of connections (default 4)\n"
+		"  -depth N          requests outstanding per connection (default 16)\n"
+		"  -requests N       total requests (default: one pass over the file)\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+	LoadOptions options;
+	std::string addressFile;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-socket" && hasValue) {
+			options.socketPath = argv[++i];
+			options.port = 0;
+		} else if (arg == "-port" && hasValue) {
+			options.port = atoi(argv[++i]);
+		} else if (arg == "-connections" && hasValue) {
+			options.connections = atoi(argv[++i]);
+		} else if (arg == "-depth" && hasValue) {
+			options.depth = atoi(argv[++i]);
+		} else if (arg == "-requests" && hasValue) {
+			options.requests = atol(argv[++i]);
+		} else if (arg.empty() || arg[0] == '-' || !addressFile.empty()) {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			addressFile = arg;
+		}
+	}
+	if (addressFile.empty() || options.connections <= 0 || options.depth <= 0) {
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> addresses;
+	std::ifstream is(addressFile.c_str());
+	std::string line;
+	while (std::getline(is, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.resize(line.size() - 1);
+		}
+		if (!line.empty()) {
+			addresses.push_back(line);
+		}
+	}
+	if (addresses.empty()) {
+		std::cerr << "No addresses in " << addressFile << std::endl;
+		return 1;
+	}
+	long total = options.requests > 0 ? options.requests : (long)addresses.size();
+	signal(SIGPIPE, SIG_IGN);
+
+	std::vector<LoadResults> results(options.connections);
+	std::vector<std::thread> threads;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < options.connections; i++) {
+		threads.push_back(std::thread(
+			RunConnection, std::cref(options), std::cref(addresses), i, total, std::ref(results[i])
+		));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// Merge
+	std::vector<double> latencies;
+	std::map<std::string, long> statusCounts;
+	long errors = 0;
+	for (size_t i = 0; i < results.size(); i++) {
+		latencies.insert(latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+		for (std::map<std::string, long>::iterator iter = results[i].statusCounts.begin(); iter != results[i].statusCounts.end(); ++iter) {
+			statusCounts[iter->first] += iter->second;
+		}
+		errors += results[i].errors;
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	std::cout.setf(std::ios::fixed);
+	std::cout.precision(3);
+	std::cout << "Requests:     " << latencies.size() << " in " << seconds << " sec\n";
+	std::cout << "Connections:  " << options.connections << " x depth " << options.depth << "\n";
+	std::cout << "QPS:          " << (seconds > 0 ? latencies.size() / seconds : 0) << "\n";
+	std::cout << "Latency (ms): p50 " << Percentile(latencies, 0.50) / 1000
+		<< "  p90 " << Percentile(latencies, 0.90) / 1000
+		<< "  p99 " << Percentile(latencies, 0.99) / 1000
+		<< "  p99.9 " << Percentile(latencies, 0.999) / 1000
+		<< "  max " << (latencies.empty() ? 0 : latencies.back()) / 1000 << "\n";
+	std::cout << "Status:      ";
+	for (std::map<std::string, long>::iterator iter = statusCounts.begin(); iter != statusCounts.end(); ++iter) {
+		std::cout << " " << iter->first << "=" << iter->second;
+	}
+	std::cout << "\nErrors:       " << errors << std::endl;
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,571 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// GeoCoderServer.cpp: Geocoding daemon.
+//
+// Opening a Geocoder loads the parser tables, the Huffman tables and the
+// XML configuration, which costs far more than coding one address.  This
+// program opens the dataset once, then serves requests on a Unix domain
+// socket or a localhost TCP port.
+//
+// The protocol is line-delimited; see ReadMe.txt.  A client may send any
+// number of requests without waiting for replies.  Each connection has a
+// reader thread that collects whatever complete requests have arrived into
+// a batch and queues it for the worker pool.  Each worker owns one Geocoder
+// and writes the replies of a batch with a single write().  Replies carry
+// the request id and may be returned out of order.
+//
+// SIGHUP reloads the database directory without stopping service.  A
+// background thread checks the data version, opens and warms a complete
+// set of geocoders, and then swaps it in.  Each batch holds a reference to
+// the dataset it started on, so batches in flight finish on the old data,
+// which is released when the last of them is done.
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "../geocoder/Geocoder.h"
+#include "../global/CritSec.h"
+#include "../global/MPMCQueue.h"
+
+using namespace PortfolioExplorer;
+
+// Most requests placed in one batch
+static const size_t MaxBatchSize = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+// A client connection, shared by its reader thread and by the workers that
+// hold its batches.  The socket is closed when the last reference goes away.
+///////////////////////////////////////////////////////////////////////////////
+struct ServerConnection {
+	ServerConnection(int fd_) : fd(fd_), failed(false) {}
+	~ServerConnection() { close(fd); }
+
+	// Write the whole buffer.  After a failure the connection is dead and
+	// later writes are ignored.
+	void Write(const std::string& buffer) {
+		std::lock_guard<std::mutex> lock(writeMutex);
+		size_t offset = 0;
+		while (!failed && offset < buffer.size()) {
+			ssize_t count = send(fd, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+			if (count < 0 && errno == EINTR) {
+				continue;
+			}
+			if (count <= 0) {
+				failed = true;
+				break;
+			}
+			offset += count;
+		}
+	}
+
+	int fd;
+	bool failed;
+	std::mutex writeMutex;
+};
+
+typedef std::shared_ptr<ServerConnection> ServerConnectionRef;
+
+///////////////////////////////////////////////////////////////////////////////
+// Requests read from one connection, to be coded by one worker
+///////////////////////////////////////////////////////////////////////////////
+struct ServerBatch {
+	ServerConnectionRef connection;
+	std::vector<std::string> requests;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Blocking FIFO of batches.  Connection readers block in Push() when the
+// workers fall behind, which in turn stops them reading from their sockets.
+///////////////////////////////////////////////////////////////////////////////
+typedef MPMCQueue<ServerBatch*> ServerQueue;
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocoder that reports its errors on stderr
+///////////////////////////////////////////////////////////////////////////////
+class ServerGeocoder : public Geocoder {
+public:
+	ServerGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual ~ServerGeocoder() {}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << "Geocoder: " << message << std::endl;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// One opened copy of the database: a geocoder for each worker.  Workers
+// hold it through DatasetRef only while coding a batch, so an old dataset
+// closes as soon as the last batch using it is done.
+///////////////////////////////////////////////////////////////////////////////
+struct ServerDataset {
+	ServerDataset(int generation_) : generation(generation_) {}
+	~ServerDataset() {
+		for (size_t i = 0; i < geocoders.size(); i++) {
+			delete geocoders[i];
+		}
+	}
+
+	int generation;
+	std::vector<ServerGeocoder*> geocoders;
+};
+
+typedef std::shared_ptr<ServerDataset> DatasetRef;
+
+///////////////////////////////////////////////////////////////////////////////
+// The dataset that new batches should use.  Workers fetch it for each
+// batch.  The lock is read-mostly, so workers share it and only a reload
+// excludes them.
+///////////////////////////////////////////////////////////////////////////////
+class DatasetSlot {
+public:
+	DatasetSlot() : lock("DatasetSlot"), generation(0) {}
+
+	DatasetRef Get() {
+		SharedCritSec critSec(lock);
+		return current;
+	}
+	void Set(const DatasetRef& dataset) {
+		ExclusiveCritSec critSec(lock);
+		current = dataset;
+		generation.store(dataset->generation, std::memory_order_release);
+	}
+	int GetGeneration() const {
+		return generation.load(std::memory_order_acquire);
+	}
+
+private:
+	RWCritSecInfo lock;
+	DatasetRef current;
+	std::atomic<int> generation;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Settings needed to open a dataset
+///////////////////////////////////////////////////////////////////////////////
+struct DatasetOptions {
+	std::string tableDir;
+	std::string databaseDir;
+	int threads;
+	// Addresses ("line1 TAB line2" per line) coded by each new geocoder
+	// before it takes traffic.  Empty for none.
+	std::string warmupFile;
+};
+
+static const char* globalStatusNames[] = { "Single", "Multiple", "Failure" };
+
+///////////////////////////////////////////////////////////////////////////////
+// Code one request line and append the reply line to "reply".
+// Request:	id TAB line1 TAB line2
+// Reply:	id TAB status TAB candidates [TAB best-candidate fields]
+///////////////////////////////////////////////////////////////////////////////
+static void CodeRequest(
+	Geocoder& geocoder,
+	Geocoder::GeocodeResults& results,
+	const std::string& request,
+	std::string& reply
+) {
+	size_t tab1 = request.find('\t');
+	if (tab1 == std::string::npos) {
+		reply += request + "\tError\t0\n";
+		return;
+	}
+	size_t tab2 = request.find('\t', tab1 + 1);
+	std::string line1, line2;
+	if (tab2 == std::string::npos) {
+		line1 = request.substr(tab1 + 1);
+	} else {
+		line1 = request.substr(tab1 + 1, tab2 - tab1 - 1);
+		line2 = request.substr(tab2 + 1);
+	}
+
+	Geocoder::GlobalStatus status = geocoder.CodeAddress(line1.c_str(), line2.c_str());
+	bool haveBest = geocoder.GetNextCandidate(results);
+	std::ostringstream os;
+	os.precision(10);
+	os << request.substr(0, tab1) << '\t' << globalStatusNames[status];
+	if (!haveBest) {
+		os << "\t0\n";
+		reply += os.str();
+		return;
+	}
+	int candidates = 1;
+	Geocoder::GeocodeResults other;
+	while (geocoder.GetNextCandidate(other)) {
+		candidates++;
+	}
+	os << '\t' << candidates
+		<< '\t' << results.GetMatchScore()
+		<< '\t' << results.GetLatitude()
+		<< '\t' << results.GetLongitude()
+		<< '\t' << results.GetAddrNbr()
+		<< '\t' << results.GetPrefix()
+		<< '\t' << results.GetPredir()
+		<< '\t' << results.GetStreet()
+		<< '\t' << results.GetSuffix()
+		<< '\t' << results.GetPostdir()
+		<< '\t' << results.GetUnitDes()
+		<< '\t' << results.GetUnit()
+		<< '\t' << results.GetCity()
+		<< '\t' << results.GetStateAbbr()
+		<< '\t' << results.GetPostcode()
+		<< '\t' << results.GetPostcodeExt()
+		<< '\t' << results.GetCountyCode()
+		<< '\t' << results.GetCensusTract()
+		<< '\t' << results.GetCensusBlock()
+		<< '\n';
+	reply += os.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Worker thread: code batches until the process exits.
+///////////////////////////////////////////////////////////////////////////////
+static void Worker(ServerQueue* queue, DatasetSlot* slot, int workerIndex)
+{
+	Geocoder::GeocodeResults results;
+	std::string reply;
+	ServerBatch* batch;
+	while (queue->Pop(batch)) {
+		// Take the current dataset for this batch only.  A worker waiting
+		// for work holds no dataset, so after a reload the old one closes
+		// once its in-flight batches are done, however idle the server is.
+		DatasetRef dataset = slot->Get();
+		Geocoder* geocoder = dataset->geocoders[workerIndex];
+		reply.clear();
+		for (size_t i = 0; i < batch->requests.size(); i++) {
+			CodeRequest(*geocoder, results, batch->requests[i], reply);
+		}
+		batch->connection->Write(reply);
+		delete batch;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Open a complete dataset, one geocoder per worker, and warm each geocoder
+// by coding the warm-up addresses so that its caches and the file pages are
+// loaded before it sees traffic.
+// Return value:
+//	DatasetRef		The dataset, or null on failure.
+///////////////////////////////////////////////////////////////////////////////
+static DatasetRef OpenDataset(const DatasetOptions& options, int generation)
+{
+	if (!Geocoder::CheckDataVersion(options.databaseDir.c_str())) {
+		std::cerr << "Data in " << options.databaseDir 
+			<< " is missing or does not match this geocoder version" << std::endl;
+		return DatasetRef();
+	}
+
+	std::vector<std::string> warmup;
+	if (!options.warmupFile.empty()) {
+		std::ifstream in(options.warmupFile.c_str());
+		if (!in) {
+			std::cerr << "Cannot read " << options.warmupFile << std::endl;
+			return DatasetRef();
+		}
+		std::string line;
+		while (std::getline(in, line)) {
+			if (!line.empty()) {
+				warmup.push_back("warmup\t" + line);
+			}
+		}
+	}
+
+	// Open the geocoders one at a time; Open() is not meant to run concurrently.
+	DatasetRef dataset(new ServerDataset(generation));
+	Geocoder::GeocodeResults results;
+	std::string reply;
+	for (int i = 0; i < options.threads; i++) {
+		ServerGeocoder* geocoder = new ServerGeocoder(options.tableDir.c_str(), options.databaseDir.c_str());
+		dataset->geocoders.push_back(geocoder);
+		if (!geocoder->Open()) {
+			std::cerr << "Cannot open the geocoder; check the table and database directories" << std::endl;
+			return DatasetRef();
+		}
+		for (size_t j = 0; j < warmup.size(); j++) {
+			reply.clear();
+			CodeRequest(*geocoder, results, warmup[j], reply);
+		}
+	}
+	return dataset;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Log the contention counters of the library's named locks, most contended
+// first.
+///////////////////////////////////////////////////////////////////////////////
+static void PrintLockStats()
+{
+	std::vector<LockStats> stats;
+	LockCounters::GetAllStats(stats);
+	std::cerr << "Lock\tacquired\tcontended\twaits\tshared\tsharedContended" << std::endl;
+	for (size_t i = 0; i < stats.size(); i++) {
+		std::cerr << stats[i].name << '\t' << stats[i].acquisitions << '\t' << stats[i].contended 
+			<< '\t' << stats[i].waits << '\t' << stats[i].sharedAcquisitions 
+			<< '\t' << stats[i].sharedContended << std::endl;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reload thread: on each SIGHUP, open and warm a new dataset and swap it in.
+// Traffic keeps flowing on the current dataset while this runs; if the new
+// one cannot be opened, the current one stays.  SIGUSR1 logs lock counters.
+///////////////////////////////////////////////////////////////////////////////
+static void Reloader(DatasetSlot* slot, DatasetOptions options, sigset_t signals)
+{
+	for (;;) {
+		int signalNumber;
+		if (sigwait(&signals, &signalNumber) != 0) {
+			continue;
+		}
+		if (signalNumber == SIGUSR1) {
+			PrintLockStats();
+			continue;
+		}
+		int generation = slot->GetGeneration() + 1;
+		std::cerr << "Reloading " << options.databaseDir << std::endl;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		DatasetRef dataset = OpenDataset(options, generation);
+		if (!dataset) {
+			std::cerr << "Reload failed; still serving generation " << slot->GetGeneration() << std::endl;
+			continue;
+		}
+		slot->Set(dataset);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cerr << "Serving generation " << generation << ", loaded in " << seconds << "s" << std::endl;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Connection reader thread: split the input into request lines and queue
+// them in batches of whatever has arrived.
+///////////////////////////////////////////////////////////////////////////////
+static void ConnectionReader(ServerQueue* queue, ServerConnectionRef connection)
+{
+	std::string pending;
+	char buffer[16384];
+	for (;;) {
+		ssize_t count = recv(connection->fd, buffer, sizeof(buffer), 0);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			break;
+		}
+		pending.append(buffer, count);
+
+		ServerBatch* batch = 0;
+		size_t start = 0;
+		size_t end;
+		while ((end = pending.find('\n', start)) != std::string::npos) {
+			size_t length = end - start;
+			if (length > 0 && pending[end - 1] == '\r') {
+				length--;
+			}
+			if (batch == 0) {
+				batch = new ServerBatch;
+				batch->connection = connection;
+			}
+			batch->requests.push_back(pending.substr(start, length));
+			start = end + 1;
+			if (batch->requests.size() == MaxBatchSize) {
+				queue->Push(batch);
+				batch = 0;
+			}
+		}
+		if (batch != 0) {
+			queue->Push(batch);
+		}
+		pending.erase(0, start);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Create the listening socket.
+// Return value:
+//	int		The socket, or -1 on error.
+///////////////////////////////////////////////////////////////////////////////
+static int Listen(const std::string& socketPath, int port)
+{
+	int fd;
+	if (!socketPath.empty()) {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path)) {
+			std::cerr << "Socket path is too long: " << socketPath << std::endl;
+			return -1;
+		}
+		strcpy(address.sun_path, socketPath.c_str());
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		unlink(socketPath.c_str());
+		if (fd < 0 || bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+			std::cerr << "Cannot bind " << socketPath << ": " << strerror(errno) << std::endl;
+			return -1;
+		}
+	} else {
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (fd < 0 || bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+			std::cerr << "Cannot bind port " << port << ": " << strerror(errno) << std::endl;
+			return -1;
+		}
+	}
+	if (listen(fd, 128) != 0) {
+		std::cerr << "listen failed: " << strerror(errno) << std::endl;
+		return -1;
+	}
+	return fd;
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << 
+		"Usage: " << program << " [options] <tableDir> <databaseDir>\n"
+		"  -socket PATH      listen on a Unix domain socket (default /tmp/geocoder.sock)\n"
+		"  -port N           listen on localhost TCP port N instead\n"
+		"  -threads N        number of worker threads (default: one per CPU)\n"
+		"  -queue N          most batches waiting for a worker (default 256)\n"
+		"  -warmup FILE      addresses (line1 TAB line2) to code on each geocoder\n"
+		"                    before it serves, at startup and on reload\n"
+		"Send SIGHUP to reload <databaseDir> without interrupting service.\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+	std::string socketPath = "/tmp/geocoder.sock";
+	int port = 0;
+	int threads = 0;
+	int queueSize = 256;
+	std::string warmupFile;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-socket" && hasValue) {
+			socketPath = argv[++i];
+			port = 0;
+		} else if (arg == "-port" && hasValue) {
+			port = atoi(argv[++i]);
+			socketPath.clear();
+		} else if (arg == "-threads" && hasValue) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "-queue" && hasValue) {
+			queueSize = atoi(argv[++i]);
+		} else if (arg == "-warmup" && hasValue) {
+			warmupFile = argv[++i];
+		} else if (!arg.empty() && arg[0] == '-') {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() != 2 || queueSize <= 0 || (socketPath.empty() && port <= 0)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+		if (threads <= 0) {
+			threads = 1;
+		}
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	// SIGHUP and SIGUSR1 are taken by the reload thread; block them before any
+	// thread starts so that every thread inherits the mask.
+	sigset_t reloadSignals;
+	sigemptyset(&reloadSignals);
+	sigaddset(&reloadSignals, SIGHUP);
+	sigaddset(&reloadSignals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &reloadSignals, 0);
+
+	DatasetOptions datasetOptions;
+	datasetOptions.tableDir = positional[0];
+	datasetOptions.databaseDir = positional[1];
+	datasetOptions.threads = threads;
+	datasetOptions.warmupFile = warmupFile;
+	DatasetRef dataset = OpenDataset(datasetOptions, 1);
+	if (!dataset) {
+		return 1;
+	}
+	DatasetSlot slot;
+	slot.Set(dataset);
+	dataset.reset();
+
+	int listenFd = Listen(socketPath, port);
+	if (listenFd < 0) {
+		return 1;
+	}
+
+	ServerQueue queue(queueSize);
+	for (int i = 0; i < threads; i++) {
+		std::thread(Worker, &queue, &slot, i).detach();
+	}
+	std::thread(Reloader, &slot, datasetOptions, reloadSignals).detach();
+	std::cerr << "Listening on " << (socketPath.empty() ? "port " : "") 
+		<< (socketPath.empty() ? std::to_string(port) : socketPath)
+		<< " with " << threads << " workers" << std::endl;
+
+	for (;;) {
+		int fd = accept(listenFd, 0, 0);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			std::cerr << "accept failed: " << strerror(errno) << std::endl;
+			return 1;
+		}
+		if (socketPath.empty()) {
+			int on = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		}
+		std::thread(ConnectionReader, &queue, ServerConnectionRef(new ServerConnection(fd))).detach();
+	}
+}
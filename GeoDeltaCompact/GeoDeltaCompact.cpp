@@ -0,0 +1,823 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoDeltaCompact.cpp: Folds a delta overlay into loader input files.
+//
+// The database is read through QueryImp with its delta applied, and the
+// StreetName, StreetSegment, Coordinate, StreetNameSoundex and
+// StreetIntersectionSoundex tables are written as the CSV files that
+// geocoder_loaders reads.  Deleted records are dropped and the surviving
+// records are renumbered, so every ID reference in those tables is
+// rewritten.  Running "geocoder_loaders All" on the output produces a new
+// base for those tables; the other tables are unaffected by a delta.
+//
+// With -reorder, the records are also laid out for locality of reference:
+// street names in StreetNameSoundex (finance number, soundex) order, the
+// segments of each street by address range, and the points of the
+// segments in the same order.  A geocoding query reads the street names of
+// one finance number and soundex, so their segments and points then share
+// chunks instead of being spread across the files.  -hilbert further orders
+// the finance numbers along a Hilbert curve through their centroids, so
+// that neighbouring areas are stored near each other.
+
+// The StreetNameSoundex and StreetIntersectionSoundex records are private
+// to QueryImp unless this is defined.
+#define COMPILE_GEOBROWSE
+
+#include "../geocommon/Geocoder_Headers.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+#include "../geocoder/GeoQueryImp.h"
+
+using namespace PortfolioExplorer;
+
+///////////////////////////////////////////////////////////////////////////////
+// QueryImp that reports its error messages
+///////////////////////////////////////////////////////////////////////////////
+class CompactQuery : public QueryImp {
+public:
+	CompactQuery(const TsString& tableDir, const TsString& databaseDir) :
+		QueryImp(tableDir, databaseDir, Geocoder::MemUseLarge)
+	{}
+	virtual void ErrorMessage(const TsString& msg) {
+		std::cerr << msg << "\n";
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A CSV output file.  Fields are quoted only when they must be.
+///////////////////////////////////////////////////////////////////////////////
+class CsvOutput {
+public:
+	CsvOutput() : fp(0), atLineStart(true), records(0) {}
+	~CsvOutput() { Close(); }
+
+	bool Open(const std::string& filename, const char* header) {
+		fp = fopen(filename.c_str(), "wb");
+		if (fp == 0) {
+			std::cerr << "Cannot create " << filename << "\n";
+			return false;
+		}
+		fprintf(fp, "%s\n", header);
+		return true;
+	}
+	bool Close() {
+		bool ok = true;
+		if (fp != 0) {
+			ok = !ferror(fp);
+			ok = fclose(fp) == 0 && ok;
+			fp = 0;
+		}
+		return ok;
+	}
+
+	CsvOutput& Int(int value) {
+		Separator();
+		fprintf(fp, "%d", value);
+		return *this;
+	}
+	CsvOutput& Degrees(double value) {
+		Separator();
+		fprintf(fp, "%.5f", value);
+		return *this;
+	}
+	CsvOutput& Str(const char* value) {
+		Separator();
+		if (strpbrk(value, ",\"") == 0) {
+			fputs(value, fp);
+		} else {
+			fputc('"', fp);
+			for (const char* p = value; *p != 0; p++) {
+				if (*p == '"') {
+					fputc('"', fp);
+				}
+				fputc(*p, fp);
+			}
+			fputc('"', fp);
+		}
+		return *this;
+	}
+	void EndRecord() {
+		fputc('\n', fp);
+		atLineStart = true;
+		records++;
+	}
+	int GetRecordCount() const { return records; }
+
+private:
+	void Separator() {
+		if (!atLineStart) {
+			fputc(',', fp);
+		}
+		atLineStart = false;
+	}
+
+	FILE* fp;
+	bool atLineStart;
+	int records;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A StreetNameSoundex entry, renumbered
+///////////////////////////////////////////////////////////////////////////////
+struct SoundexEntry {
+	char financeNumber[7];
+	char streetSoundex[5];
+	int streetNameID;
+	bool operator<(const SoundexEntry& rhs) const {
+		int cmp = strcmp(financeNumber, rhs.financeNumber);
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		cmp = strcmp(streetSoundex, rhs.streetSoundex);
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		return streetNameID < rhs.streetNameID;
+	}
+	bool operator==(const SoundexEntry& rhs) const {
+		return
+			strcmp(financeNumber, rhs.financeNumber) == 0 &&
+			strcmp(streetSoundex, rhs.streetSoundex) == 0 &&
+			streetNameID == rhs.streetNameID;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The chunks touched while reading the segments or points of one street,
+// in reading order.  QueryImp decodes a chunk whenever a read falls in a
+// different chunk from the previous read.
+///////////////////////////////////////////////////////////////////////////////
+struct ChunkSpan {
+	ChunkSpan() : firstChunk(-1), lastChunk(-1), switches(0) {}
+	void Add(int chunk) {
+		if (firstChunk < 0) {
+			firstChunk = chunk;
+		} else if (chunk != lastChunk) {
+			switches++;
+		}
+		lastChunk = chunk;
+	}
+	int firstChunk;
+	int lastChunk;
+	int switches;		// chunk changes after the first chunk
+};
+
+// Number of chunk decodes to read a span, given the chunk read last.
+static int CountDecodes(const ChunkSpan& span, int& lastChunk)
+{
+	if (span.firstChunk < 0) {
+		return 0;
+	}
+	int decodes = span.switches + (span.firstChunk != lastChunk ? 1 : 0);
+	lastChunk = span.lastChunk;
+	return decodes;
+}
+
+// Chunk spans of one street in the old and new layouts.
+struct StreetLocality {
+	ChunkSpan oldSegments;
+	ChunkSpan oldCoordinates;
+	ChunkSpan newSegments;
+	ChunkSpan newCoordinates;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Renumbering of the StreetName and StreetSegment tables
+///////////////////////////////////////////////////////////////////////////////
+struct Renumbering {
+	// New StreetName ID by old ID; -1 if dropped
+	std::vector<int> streetNameID;
+	// New offset within its StreetName by old StreetSegment ID; -1 if dropped
+	std::vector<int> streetSegmentOffset;
+	// Chunk spans by old StreetName ID; only filled when reordering
+	std::vector<StreetLocality> locality;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Orders segments by address range, then side of the street.  Address
+// ranges are compared by their leading house numbers, so that "99" sorts
+// before "100".
+///////////////////////////////////////////////////////////////////////////////
+struct SegmentAddressLess {
+	bool operator()(const StreetSegment& lhs, const StreetSegment& rhs) const {
+		int cmp = CompareAddress(lhs.addrLow, rhs.addrLow);
+		if (cmp == 0) {
+			cmp = CompareAddress(lhs.addrHigh, rhs.addrHigh);
+		}
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		return !lhs.isRightSide && rhs.isRightSide;
+	}
+	static int CompareAddress(const char* lhs, const char* rhs) {
+		long lhsNumber = atol(lhs);
+		long rhsNumber = atol(rhs);
+		if (lhsNumber != rhsNumber) {
+			return lhsNumber < rhsNumber ? -1 : 1;
+		}
+		return strcmp(lhs, rhs);
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Write StreetName, StreetSegment and Coordinate, dropping deleted records.
+// Street names are written in the given order, each followed by its
+// segments, and each segment by its points.  Segments of a street that
+// share a point range (the two sides of a street) keep sharing it.
+// Inputs:
+//	const std::vector<int>&	streetNameOrder	Old StreetName IDs in output order
+//	bool					reorder			Sort segments by address range and
+//											record chunk spans
+///////////////////////////////////////////////////////////////////////////////
+static bool WriteStreets(
+	CompactQuery& query,
+	const std::string& outDir,
+	const std::vector<int>& streetNameOrder,
+	bool reorder,
+	Renumbering& renumbering
+) {
+	CsvOutput streetNameOut, streetSegmentOut, coordinateOut;
+	if (
+		!streetNameOut.Open(outDir + "/StreetName.csv",
+			"CITY_STATE_POSTCODE_ID,STREET_NAME_ID,PREFIX,PREDIR,NAME,SUFFIX,POSTDIR,STREET_SEGMENT_ID_FIRST,STREET_SEGMENT_COUNT") ||
+		!streetSegmentOut.Open(outDir + "/StreetSegment.csv",
+			"STREET_SEGMENT_ID,ADDR_LOW,ADDR_HIGH,LEFT_RIGHT,COUNTY,CENSUS_TRACT,CENSUS_BLOCK,POSTCODE_EXT,COORDINATE_ID,COORDINATE_COUNT") ||
+		!coordinateOut.Open(outDir + "/Coordinate.csv",
+			"COORDINATE_ID,LATITUDE,LONGITUDE")
+	) {
+		return false;
+	}
+
+	const GeoDelta* delta = query.GetDelta();
+	int streetNameCount = query.GetStreetNameCount();
+	renumbering.streetNameID.assign(streetNameCount, -1);
+	renumbering.streetSegmentOffset.assign(query.GetStreetSegmentCount(), -1);
+	if (reorder) {
+		renumbering.locality.assign(streetNameCount, StreetLocality());
+	}
+
+	// New point ranges of the current street, by old point range.
+	typedef std::map<std::pair<int, int>, std::pair<int, int> > CoordinateRangeMap;
+	CoordinateRangeMap coordinateRanges;
+
+	StreetName streetName;
+	StreetSegment streetSegment;
+	CoordinatePoint coordinate;
+	std::vector<StreetSegment> segments;
+
+	for (unsigned orderIdx = 0; orderIdx < streetNameOrder.size(); orderIdx++) {
+		int streetNameID = streetNameOrder[orderIdx];
+		if (delta != 0 && delta->IsStreetNameDeleted(streetNameID)) {
+			continue;
+		}
+		if (!query.GetStreetNameByID(streetNameID, streetName)) {
+			std::cerr << "Cannot read StreetName " << streetNameID << "\n";
+			return false;
+		}
+
+		// Collect the surviving segments.
+		segments.clear();
+		QueryImp::StreetSegmentFromStreetNameIterator segmentIter =
+			query.LookupStreetSegmentFromStreetName(streetName);
+		while (segmentIter.Next(streetSegment)) {
+			segments.push_back(streetSegment);
+		}
+		if (segments.empty()) {
+			// Nothing left to geocode against.
+			continue;
+		}
+		if (reorder) {
+			StreetLocality& locality = renumbering.locality[streetNameID];
+			for (unsigned i = 0; i < segments.size(); i++) {
+				locality.oldSegments.Add(segments[i].ID / GeoUtil::StreetSegmentChunkSize);
+				locality.oldCoordinates.Add(segments[i].coordinateID / GeoUtil::CoordinateChunkSize);
+				locality.oldCoordinates.Add((segments[i].coordinateID + segments[i].coordinateCount - 1) / GeoUtil::CoordinateChunkSize);
+			}
+			std::stable_sort(segments.begin(), segments.end(), SegmentAddressLess());
+		}
+		for (unsigned i = 0; i < segments.size(); i++) {
+			renumbering.streetSegmentOffset[segments[i].ID] = int(i);
+		}
+
+		int newStreetNameID = streetNameOut.GetRecordCount();
+		renumbering.streetNameID[streetNameID] = newStreetNameID;
+		streetNameOut
+			.Int(streetName.cityStatePostcodeID)
+			.Int(newStreetNameID)
+			.Str(streetName.prefix)
+			.Str(streetName.predir)
+			.Str(streetName.street)
+			.Str(streetName.suffix)
+			.Str(streetName.postdir)
+			.Int(streetSegmentOut.GetRecordCount())
+			.Int(int(segments.size()))
+			.EndRecord();
+
+		coordinateRanges.clear();
+		for (unsigned i = 0; i < segments.size(); i++) {
+			const StreetSegment& segment = segments[i];
+			std::pair<int, int> oldRange(segment.coordinateID, segment.coordinateCount);
+			CoordinateRangeMap::iterator rangeIter = coordinateRanges.find(oldRange);
+			if (rangeIter == coordinateRanges.end()) {
+				int newCoordinateID = coordinateOut.GetRecordCount();
+				QueryImp::CoordinatePointsFromStreetSegmentIterator coordinateIter =
+					query.LookupCoordinatePointsFromStreetSegment(segment);
+				while (coordinateIter.Next(coordinate)) {
+					coordinateOut
+						.Int(coordinateOut.GetRecordCount())
+						.Degrees(coordinate.latitude)
+						.Degrees(coordinate.longitude)
+						.EndRecord();
+				}
+				std::pair<int, int> newRange(newCoordinateID, coordinateOut.GetRecordCount() - newCoordinateID);
+				rangeIter = coordinateRanges.insert(CoordinateRangeMap::value_type(oldRange, newRange)).first;
+			}
+			int newCoordinateID = rangeIter->second.first;
+			int newCoordinateCount = rangeIter->second.second;
+
+			if (reorder) {
+				StreetLocality& locality = renumbering.locality[streetNameID];
+				locality.newSegments.Add(streetSegmentOut.GetRecordCount() / GeoUtil::StreetSegmentChunkSize);
+				locality.newCoordinates.Add(newCoordinateID / GeoUtil::CoordinateChunkSize);
+				locality.newCoordinates.Add((newCoordinateID + newCoordinateCount - 1) / GeoUtil::CoordinateChunkSize);
+			}
+
+			streetSegmentOut
+				.Int(streetSegmentOut.GetRecordCount())
+				.Str(segment.addrLow)
+				.Str(segment.addrHigh)
+				.Int(segment.isRightSide ? 1 : 0)
+				.Int(segment.countyCode)
+				.Str(segment.censusTract)
+				.Str(segment.censusBlock)
+				.Str(segment.postcodeExt)
+				.Int(newCoordinateID)
+				.Int(newCoordinateCount)
+				.EndRecord();
+		}
+	}
+
+	std::cout << "StreetName: " << streetNameOut.GetRecordCount() << " records\n";
+	std::cout << "StreetSegment: " << streetSegmentOut.GetRecordCount() << " records\n";
+	std::cout << "Coordinate: " << coordinateOut.GetRecordCount() << " records\n";
+
+	if (!streetNameOut.Close() || !streetSegmentOut.Close() || !coordinateOut.Close()) {
+		std::cerr << "Error writing to " << outDir << "\n";
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Collect the surviving base StreetNameSoundex entries plus those added by
+// the delta, with their original street name IDs, sorted.
+// Outputs:
+//	std::vector<SoundexEntry>&	entriesReturn	The entries
+// Return value:
+//	bool		true on success, false on error.
+///////////////////////////////////////////////////////////////////////////////
+static bool CollectStreetNameSoundex(
+	CompactQuery& query,
+	std::vector<SoundexEntry>& entriesReturn
+) {
+	entriesReturn.clear();
+	SoundexEntry entry;
+
+	int baseCount = query.GetStreetNameSoundexCount();
+	QueryImp::StreetNameSoundex streetNameSoundex;
+	for (int i = 0; i < baseCount; i++) {
+		if (!query.GetStreetNameSoundexByID(i, streetNameSoundex)) {
+			std::cerr << "Cannot read StreetNameSoundex " << i << "\n";
+			return false;
+		}
+		if (query.IsStreetNameSoundexDeleted(streetNameSoundex)) {
+			continue;
+		}
+		entry.streetNameID = streetNameSoundex.streetNameID;
+		strcpy(entry.financeNumber, streetNameSoundex.financeNumber);
+		strcpy(entry.streetSoundex, streetNameSoundex.streetSoundex);
+		entriesReturn.push_back(entry);
+	}
+
+	const GeoDelta* delta = query.GetDelta();
+	if (delta != 0) {
+		for (int i = 0; i < delta->GetStreetNameSoundexCount(); i++) {
+			const GeoDelta::StreetNameSoundexEntry& added = delta->GetStreetNameSoundex(i);
+			entry.streetNameID = added.streetNameID;
+			strcpy(entry.financeNumber, added.financeNumber);
+			strcpy(entry.streetSoundex, added.streetSoundex);
+			entriesReturn.push_back(entry);
+		}
+	}
+
+	std::sort(entriesReturn.begin(), entriesReturn.end());
+	entriesReturn.erase(std::unique(entriesReturn.begin(), entriesReturn.end()), entriesReturn.end());
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Distance along a Hilbert curve filling an n by n grid (n a power of two).
+///////////////////////////////////////////////////////////////////////////////
+static __uint64 HilbertDistance(unsigned n, unsigned x, unsigned y)
+{
+	__uint64 d = 0;
+	for (unsigned s = n / 2; s > 0; s /= 2) {
+		unsigned rx = (x & s) != 0 ? 1 : 0;
+		unsigned ry = (y & s) != 0 ? 1 : 0;
+		d += __uint64(s) * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant so the curve is continuous.
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			unsigned t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return d;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A StreetNameSoundex entry with the Hilbert curve position of its
+// finance number.
+///////////////////////////////////////////////////////////////////////////////
+struct HilbertEntry {
+	__uint64 hilbert;
+	SoundexEntry entry;
+	bool operator<(const HilbertEntry& rhs) const {
+		if (hilbert != rhs.hilbert) {
+			return hilbert < rhs.hilbert;
+		}
+		return entry < rhs.entry;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the order in which to write the street names: by finance number
+// and soundex (or, with hilbert, by the Hilbert curve position of the
+// finance number's centroid, then soundex).  A street name indexed under
+// several soundex keys goes with its first.  Street names without an index
+// entry follow in their original order.
+// Outputs:
+//	std::vector<int>&	orderReturn		Old StreetName IDs in output order
+// Return value:
+//	bool		true on success, false on error.
+///////////////////////////////////////////////////////////////////////////////
+static bool ComputeLocalityOrder(
+	CompactQuery& query,
+	bool hilbert,
+	std::vector<int>& orderReturn
+) {
+	std::vector<SoundexEntry> entries;
+	if (!CollectStreetNameSoundex(query, entries)) {
+		return false;
+	}
+
+	const GeoDelta* delta = query.GetDelta();
+	int streetNameCount = query.GetStreetNameCount();
+	std::vector<bool> placed(streetNameCount, false);
+	orderReturn.clear();
+
+	if (hilbert) {
+		// The centroid of a finance number is the mean of the first point
+		// of each of its streets.
+		std::vector<HilbertEntry> hilbertEntries(entries.size());
+		StreetName streetName;
+		StreetSegment streetSegment;
+		CoordinatePoint coordinate;
+		unsigned begin = 0;
+		while (begin < entries.size()) {
+			unsigned end = begin;
+			double latSum = 0.0;
+			double lonSum = 0.0;
+			int points = 0;
+			while (end < entries.size() && strcmp(entries[end].financeNumber, entries[begin].financeNumber) == 0) {
+				int streetNameID = entries[end].streetNameID;
+				if (
+					streetNameID >= 0 &&
+					streetNameID < streetNameCount &&
+					!(delta != 0 && delta->IsStreetNameDeleted(streetNameID)) &&
+					query.GetStreetNameByIDCached(streetNameID, streetName)
+				) {
+					QueryImp::StreetSegmentFromStreetNameIterator segmentIter =
+						query.LookupStreetSegmentFromStreetName(streetName);
+					if (segmentIter.Next(streetSegment)) {
+						QueryImp::CoordinatePointsFromStreetSegmentIterator coordinateIter =
+							query.LookupCoordinatePointsFromStreetSegment(streetSegment);
+						if (coordinateIter.Next(coordinate)) {
+							latSum += coordinate.latitude;
+							lonSum += coordinate.longitude;
+							points++;
+						}
+					}
+				}
+				end++;
+			}
+
+			const unsigned gridSize = 65536;
+			__uint64 d = 0;
+			if (points > 0) {
+				double lat = latSum / points;
+				double lon = lonSum / points;
+				unsigned x = unsigned((lon + 180.0) / 360.0 * (gridSize - 1));
+				unsigned y = unsigned((lat + 90.0) / 180.0 * (gridSize - 1));
+				d = HilbertDistance(gridSize, JHMIN(x, gridSize - 1), JHMIN(y, gridSize - 1));
+			}
+			for (unsigned i = begin; i < end; i++) {
+				hilbertEntries[i].hilbert = d;
+				hilbertEntries[i].entry = entries[i];
+			}
+			begin = end;
+		}
+		std::sort(hilbertEntries.begin(), hilbertEntries.end());
+		for (unsigned i = 0; i < hilbertEntries.size(); i++) {
+			entries[i] = hilbertEntries[i].entry;
+		}
+	}
+
+	for (unsigned i = 0; i < entries.size(); i++) {
+		int streetNameID = entries[i].streetNameID;
+		if (streetNameID >= 0 && streetNameID < streetNameCount && !placed[streetNameID]) {
+			placed[streetNameID] = true;
+			orderReturn.push_back(streetNameID);
+		}
+	}
+	for (int streetNameID = 0; streetNameID < streetNameCount; streetNameID++) {
+		if (!placed[streetNameID]) {
+			orderReturn.push_back(streetNameID);
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Estimate the chunk decodes that looking up every StreetNameSoundex entry
+// in turn would cost in the old and new layouts, and print them.  Each
+// street's segments and points are read in the order the geocoder reads
+// them, and a decode is counted whenever a read leaves the current chunk.
+///////////////////////////////////////////////////////////////////////////////
+static bool ReportLocality(
+	CompactQuery& query,
+	const Renumbering& renumbering
+) {
+	std::vector<SoundexEntry> entries;
+	if (!CollectStreetNameSoundex(query, entries)) {
+		return false;
+	}
+
+	__int64 oldSegmentDecodes = 0;
+	__int64 oldCoordinateDecodes = 0;
+	__int64 newSegmentDecodes = 0;
+	__int64 newCoordinateDecodes = 0;
+	int oldSegmentChunk = -1;
+	int oldCoordinateChunk = -1;
+	int newSegmentChunk = -1;
+	int newCoordinateChunk = -1;
+
+	for (unsigned i = 0; i < entries.size(); i++) {
+		int streetNameID = entries[i].streetNameID;
+		if (streetNameID < 0 || streetNameID >= int(renumbering.locality.size())) {
+			continue;
+		}
+		const StreetLocality& locality = renumbering.locality[streetNameID];
+		if (locality.oldSegments.firstChunk < 0) {
+			// Dropped
+			continue;
+		}
+		oldSegmentDecodes += CountDecodes(locality.oldSegments, oldSegmentChunk);
+		oldCoordinateDecodes += CountDecodes(locality.oldCoordinates, oldCoordinateChunk);
+		newSegmentDecodes += CountDecodes(locality.newSegments, newSegmentChunk);
+		newCoordinateDecodes += CountDecodes(locality.newCoordinates, newCoordinateChunk);
+	}
+
+	std::cout
+		<< "Chunk decodes for a scan of StreetNameSoundex (old -> new):\n"
+		<< "  StreetSegment: " << oldSegmentDecodes << " -> " << newSegmentDecodes << "\n"
+		<< "  Coordinate: " << oldCoordinateDecodes << " -> " << newCoordinateDecodes << "\n";
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write StreetNameSoundex: the surviving base entries plus those added by
+// the delta, renumbered and re-sorted.
+///////////////////////////////////////////////////////////////////////////////
+static bool WriteStreetNameSoundex(
+	CompactQuery& query,
+	const std::string& outDir,
+	const Renumbering& renumbering
+) {
+	std::vector<SoundexEntry> entries;
+	if (!CollectStreetNameSoundex(query, entries)) {
+		return false;
+	}
+	unsigned kept = 0;
+	for (unsigned i = 0; i < entries.size(); i++) {
+		int streetNameID = entries[i].streetNameID;
+		if (streetNameID < 0 || streetNameID >= int(renumbering.streetNameID.size())) {
+			continue;
+		}
+		entries[i].streetNameID = renumbering.streetNameID[streetNameID];
+		if (entries[i].streetNameID >= 0) {
+			entries[kept++] = entries[i];
+		}
+	}
+	entries.resize(kept);
+	std::sort(entries.begin(), entries.end());
+	entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+	CsvOutput out;
+	if (!out.Open(outDir + "/StreetNameSoundex.csv", "STREET_INDEX_ID,FINANCE_NUMBER,STREET_SOUNDEX,STREET_NAME_ID")) {
+		return false;
+	}
+	for (unsigned i = 0; i < entries.size(); i++) {
+		out
+			.Int(int(i))
+			.Str(entries[i].financeNumber)
+			.Str(entries[i].streetSoundex)
+			.Int(entries[i].streetNameID)
+			.EndRecord();
+	}
+	std::cout << "StreetNameSoundex: " << out.GetRecordCount() << " records\n";
+	if (!out.Close()) {
+		std::cerr << "Error writing to " << outDir << "\n";
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Map a StreetIntersectionSoundex street reference to the new numbering.
+// Return value:
+//	bool	false if the street or segment was dropped.
+///////////////////////////////////////////////////////////////////////////////
+static bool RenumberIntersectionStreet(
+	CompactQuery& query,
+	const Renumbering& renumbering,
+	int& streetNameID,
+	int& streetSegmentOffset
+) {
+	StreetName streetName;
+	if (
+		streetNameID < 0 ||
+		streetNameID >= int(renumbering.streetNameID.size()) ||
+		renumbering.streetNameID[streetNameID] < 0 ||
+		!query.GetStreetNameByIDCached(streetNameID, streetName) ||
+		streetSegmentOffset < 0 ||
+		streetSegmentOffset >= streetName.streetSegmentCount
+	) {
+		return false;
+	}
+	int newOffset = renumbering.streetSegmentOffset[streetName.streetSegmentIDFirst + streetSegmentOffset];
+	if (newOffset < 0) {
+		return false;
+	}
+	streetNameID = renumbering.streetNameID[streetNameID];
+	streetSegmentOffset = newOffset;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write StreetIntersectionSoundex in its original order, dropping the
+// intersections whose streets or segments no longer exist.
+///////////////////////////////////////////////////////////////////////////////
+static bool WriteStreetIntersectionSoundex(
+	CompactQuery& query,
+	const std::string& outDir,
+	const Renumbering& renumbering
+) {
+	CsvOutput out;
+	if (!out.Open(
+		outDir + "/StreetIntersectionSoundex.csv",
+		"STATE,SOUNDEX1,STREET_NAME_ID1,STREET_SEGMENT_OFFSET1,SOUNDEX2,STREET_NAME_ID2,STREET_SEGMENT_OFFSET2"
+	)) {
+		return false;
+	}
+
+	int count = query.GetStreetIntersectionSoundexCount();
+	QueryImp::StreetIntersectionSoundex intersection;
+	for (int i = 0; i < count; i++) {
+		if (!query.GetStreetIntersectionSoundexByID(i, intersection)) {
+			std::cerr << "Cannot read StreetIntersectionSoundex " << i << "\n";
+			return false;
+		}
+		if (
+			!RenumberIntersectionStreet(query, renumbering, intersection.streetNameID1, intersection.streetSegmentOffset1) ||
+			!RenumberIntersectionStreet(query, renumbering, intersection.streetNameID2, intersection.streetSegmentOffset2)
+		) {
+			continue;
+		}
+		out
+			.Int(intersection.state)
+			.Str(intersection.streetSoundex1)
+			.Int(intersection.streetNameID1)
+			.Int(intersection.streetSegmentOffset1)
+			.Str(intersection.streetSoundex2)
+			.Int(intersection.streetNameID2)
+			.Int(intersection.streetSegmentOffset2)
+			.EndRecord();
+	}
+	std::cout << "StreetIntersectionSoundex: " << out.GetRecordCount() << " records\n";
+	if (!out.Close()) {
+		std::cerr << "Error writing to " << outDir << "\n";
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Main
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	bool reorder = false;
+	bool hilbert = false;
+	int argIdx = 1;
+	for (; argIdx < argc && argv[argIdx][0] == '-'; argIdx++) {
+		if (strcmp(argv[argIdx], "-reorder") == 0) {
+			reorder = true;
+		} else if (strcmp(argv[argIdx], "-hilbert") == 0) {
+			reorder = true;
+			hilbert = true;
+		} else {
+			break;
+		}
+	}
+
+	if (argc - argIdx != 3) {
+		std::cerr <<
+			"Usage: " << argv[0] << " [-reorder] [-hilbert] <tableDir> <databaseDir> <outputDir>\n"
+			"Writes the StreetName, StreetSegment, Coordinate, StreetNameSoundex and\n"
+			"StreetIntersectionSoundex tables of <databaseDir>, with its delta file\n"
+			"applied, as loader input files in <outputDir>.  Then run\n"
+			"  geocoder_loaders All <outputDir> <newDatabaseDir>\n"
+			"and copy the remaining files of <databaseDir> except the delta file.\n"
+			"  -reorder  Lay out streets by finance number and soundex, and segments\n"
+			"            by address range, for locality of reference\n"
+			"  -hilbert  As -reorder, with finance numbers along a Hilbert curve\n";
+		return 1;
+	}
+	const char* tableDir = argv[argIdx];
+	const char* databaseDir = argv[argIdx + 1];
+	const char* outputDir = argv[argIdx + 2];
+
+	CompactQuery query(tableDir, databaseDir);
+	if (!query.Open()) {
+		std::cerr << "Cannot open database " << databaseDir << "\n";
+		return 1;
+	}
+	const GeoDelta* delta = query.GetDelta();
+	std::cout << "Delta records: " << (delta != 0 ? delta->GetRecordCount() : 0) << "\n";
+
+	clock_t start = clock();
+	std::vector<int> streetNameOrder;
+	if (reorder) {
+		if (!ComputeLocalityOrder(query, hilbert, streetNameOrder)) {
+			return 1;
+		}
+	} else {
+		for (int i = 0; i < query.GetStreetNameCount(); i++) {
+			streetNameOrder.push_back(i);
+		}
+	}
+
+	Renumbering renumbering;
+	if (
+		!WriteStreets(query, outputDir, streetNameOrder, reorder, renumbering) ||
+		!WriteStreetNameSoundex(query, outputDir, renumbering) ||
+		!WriteStreetIntersectionSoundex(query, outputDir, renumbering) ||
+		(reorder && !ReportLocality(query, renumbering))
+	) {
+		return 1;
+	}
+	std::cout << "Done in " << double(clock() - start) / CLOCKS_PER_SEC << " seconds\n";
+	return 0;
+}
@@ -0,0 +1,448 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoDiff.cpp: Checks that an optimized configuration of Geocoder codes
+// every address exactly as the reference configuration does.
+//
+//	geodiff [options] <refTableDir> <refDatabaseDir> <optTableDir> <optDatabaseDir> <addressFile>
+//
+// Each thread opens one Geocoder of each configuration and codes its share
+// of the addresses with both.  The GlobalStatus, the number of candidates
+// and every field of every candidate, in order, must be the same; latitude
+// and longitude may differ by -tolerance degrees (default 0).  The first
+// -max addresses that differ, in file order, are printed with every field
+// of the first candidate that differs.  The exit status is 0 if nothing
+// differs, 1 if something does and 2 on error.
+//
+// The address file is the one parsebench and allocaudit read: street
+// address, a tab, then the last line.  Blank lines and lines starting with
+// # are skipped.
+
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../geocoder/Geocoder.h"
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+// Addresses handed to a thread at a time
+static const size_t ChunkSize = 64;
+
+class DiffGeocoder : public Geocoder {
+public:
+	DiffGeocoder(const char* tableDir, const char* databaseDir, MemUse memUse) :
+		Geocoder(tableDir, databaseDir, memUse)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << message << "\n";
+	}
+};
+
+struct Address {
+	std::string line1;
+	std::string line2;
+};
+
+static bool ReadAddresses(const char* filename, std::vector<Address>& addresses)
+{
+	std::ifstream in(filename);
+	if (!in) {
+		std::cerr << "Cannot open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		Address address;
+		size_t tab = line.find('\t');
+		address.line1 = line.substr(0, tab);
+		if (tab != std::string::npos) {
+			address.line2 = line.substr(tab + 1);
+		}
+		addresses.push_back(address);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The fields of one candidate, as text, in the order of fieldNames.  The
+// coordinates are kept as numbers as well, for the tolerance.
+///////////////////////////////////////////////////////////////////////////////
+static const char* const fieldNames[] = {
+	"AddrNbr", "Prefix", "Predir", "Street", "Suffix", "Postdir", "UnitDes", "Unit",
+	"City", "State", "StateAbbr", "CountryCode", "CountyCode", "CensusTract", "CensusBlock",
+	"Postcode", "PostcodeExt", "Latitude", "Longitude", "MatchScore", "MatchStatus", "GeoStatus",
+	"Prefix2", "Predir2", "Street2", "Suffix2", "Postdir2"
+};
+enum { NbrFields = sizeof(fieldNames) / sizeof(fieldNames[0]), LatitudeField = 17, LongitudeField = 18 };
+
+struct Candidate {
+	std::string fields[NbrFields];
+	double latitude;
+	double longitude;
+};
+
+static std::string Text(const char* str)
+{
+	return str == 0 ? std::string() : std::string(str);
+}
+
+static std::string Number(double value)
+{
+	std::ostringstream out;
+	out.precision(17);
+	out << value;
+	return out.str();
+}
+
+static std::string Flags(int value)
+{
+	std::ostringstream out;
+	out << "0x" << std::hex << unsigned(value);
+	return out.str();
+}
+
+static void GetCandidate(Geocoder::GeocodeResults& results, Candidate& candidate)
+{
+	std::string* field = candidate.fields;
+	*field++ = Text(results.GetAddrNbr());
+	*field++ = Text(results.GetPrefix());
+	*field++ = Text(results.GetPredir());
+	*field++ = Text(results.GetStreet());
+	*field++ = Text(results.GetSuffix());
+	*field++ = Text(results.GetPostdir());
+	*field++ = Text(results.GetUnitDes());
+	*field++ = Text(results.GetUnit());
+	*field++ = Text(results.GetCity());
+	*field++ = Number(results.GetState());
+	*field++ = Text(results.GetStateAbbr());
+	*field++ = Text(results.GetCountryCode());
+	*field++ = Number(results.GetCountyCode());
+	*field++ = Text(results.GetCensusTract());
+	*field++ = Text(results.GetCensusBlock());
+	*field++ = Text(results.GetPostcode());
+	*field++ = Text(results.GetPostcodeExt());
+	candidate.latitude = results.GetLatitude();
+	*field++ = Number(candidate.latitude);
+	candidate.longitude = results.GetLongitude();
+	*field++ = Number(candidate.longitude);
+	*field++ = Number(results.GetMatchScore());
+	*field++ = Flags(results.GetMatchStatus());
+	*field++ = Flags(results.GetGeoStatus());
+	*field++ = Text(results.GetPrefix2());
+	*field++ = Text(results.GetPredir2());
+	*field++ = Text(results.GetStreet2());
+	*field++ = Text(results.GetSuffix2());
+	*field++ = Text(results.GetPostdir2());
+}
+
+// The outcome of coding one address with one configuration
+struct Coding {
+	Geocoder::GlobalStatus status;
+	std::vector<Candidate> candidates;
+};
+
+static void Code(Geocoder& geocoder, Geocoder::GeocodeResults& results, const Address& address, Coding& coding)
+{
+	coding.status = geocoder.CodeAddress(address.line1.c_str(), address.line2.c_str());
+	coding.candidates.clear();
+	while (geocoder.GetNextCandidate(results)) {
+		coding.candidates.push_back(Candidate());
+		GetCandidate(results, coding.candidates.back());
+	}
+}
+
+static const char* StatusName(Geocoder::GlobalStatus status)
+{
+	switch (status) {
+	case Geocoder::GlobalSingle: return "Single";
+	case Geocoder::GlobalMultiple: return "Multiple";
+	default: return "Failure";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// An address coded differently, with the report of how
+///////////////////////////////////////////////////////////////////////////////
+struct Divergence {
+	size_t addressIdx;
+	std::string report;
+	bool operator<(const Divergence& rhs) const { return addressIdx < rhs.addressIdx; }
+};
+
+static bool FieldsDiffer(const Candidate& ref, const Candidate& opt, int field, double tolerance)
+{
+	if (field == LatitudeField) {
+		return fabs(ref.latitude - opt.latitude) > tolerance;
+	}
+	if (field == LongitudeField) {
+		return fabs(ref.longitude - opt.longitude) > tolerance;
+	}
+	return ref.fields[field] != opt.fields[field];
+}
+
+// Compare the two codings.  Returns true and fills in the report if they
+// differ.
+static bool Compare(const Coding& ref, const Coding& opt, double tolerance, std::string& report)
+{
+	std::ostringstream out;
+	bool differ = false;
+	if (ref.status != opt.status) {
+		out << "  GlobalStatus: reference " << StatusName(ref.status) << ", optimized " << StatusName(opt.status) << "\n";
+		differ = true;
+	}
+	if (ref.candidates.size() != opt.candidates.size()) {
+		out << "  candidates: reference " << ref.candidates.size() << ", optimized " << opt.candidates.size() << "\n";
+		differ = true;
+	}
+	size_t nbrCandidates = std::min(ref.candidates.size(), opt.candidates.size());
+	for (size_t c = 0; c < nbrCandidates; c++) {
+		const Candidate& refCandidate = ref.candidates[c];
+		const Candidate& optCandidate = opt.candidates[c];
+		bool candidateDiffers = false;
+		for (int f = 0; f < NbrFields; f++) {
+			if (FieldsDiffer(refCandidate, optCandidate, f, tolerance)) {
+				out << "  candidate " << c << " " << fieldNames[f] << ": reference \"" << refCandidate.fields[f]
+					<< "\", optimized \"" << optCandidate.fields[f] << "\"\n";
+				candidateDiffers = true;
+			}
+		}
+		if (candidateDiffers) {
+			differ = true;
+			break;
+		}
+	}
+	report = out.str();
+	return differ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// One thread's pair of Geocoders and what it found.  The chunks are handed
+// out in file order, so each thread's first maxReports divergences are its
+// earliest, and the earliest overall are among them.
+///////////////////////////////////////////////////////////////////////////////
+struct Worker {
+	std::unique_ptr<DiffGeocoder> reference;
+	std::unique_ptr<DiffGeocoder> optimized;
+	std::vector<Divergence> divergences;
+	size_t nbrDiverged;
+	size_t nbrCandidates;
+	double refSeconds;
+	double optSeconds;
+
+	Worker() : nbrDiverged(0), nbrCandidates(0), refSeconds(0), optSeconds(0) {}
+
+	void Run(
+		const std::vector<Address>& addresses,
+		std::atomic<size_t>& next,
+		double tolerance,
+		size_t maxReports
+	) {
+		Geocoder::GeocodeResults results;
+		Coding refCoding;
+		Coding optCoding;
+		std::string report;
+		for (size_t first; (first = next.fetch_add(ChunkSize)) < addresses.size(); ) {
+			size_t end = std::min(first + ChunkSize, addresses.size());
+			for (size_t i = first; i < end; i++) {
+				Clock::time_point start = Clock::now();
+				Code(*reference, results, addresses[i], refCoding);
+				Clock::time_point middle = Clock::now();
+				Code(*optimized, results, addresses[i], optCoding);
+				refSeconds += std::chrono::duration<double>(middle - start).count();
+				optSeconds += std::chrono::duration<double>(Clock::now() - middle).count();
+				nbrCandidates += refCoding.candidates.size();
+				if (Compare(refCoding, optCoding, tolerance, report)) {
+					nbrDiverged++;
+					if (divergences.size() < maxReports) {
+						Divergence divergence;
+						divergence.addressIdx = i;
+						divergence.report = report;
+						divergences.push_back(divergence);
+					}
+				}
+			}
+		}
+	}
+};
+
+static bool ParseMemUse(const std::string& str, Geocoder::MemUse& memUse)
+{
+	if (str == "small") {
+		memUse = Geocoder::MemUseSmall;
+	} else if (str == "normal") {
+		memUse = Geocoder::MemUseNormal;
+	} else if (str == "large") {
+		memUse = Geocoder::MemUseLarge;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static void Usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] <refTableDir> <refDatabaseDir> <optTableDir> <optDatabaseDir> <addressFile>\n"
+		"  -threads N         coding threads (default: one per processor)\n"
+		"  -max N             divergences to print (default 10)\n"
+		"  -tolerance D       degrees latitude and longitude may differ (default 0)\n"
+		"  -ref-memuse M      cache size of the reference: small, normal or large (default normal)\n"
+		"  -opt-memuse M      cache size of the optimized configuration (default normal)\n"
+		"  -opt-verify MODE   verify mode of the optimized configuration: none, open or lazy (default none)\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int nbrThreads = int(std::thread::hardware_concurrency());
+	size_t maxReports = 10;
+	double tolerance = 0;
+	Geocoder::MemUse refMemUse = Geocoder::MemUseNormal;
+	Geocoder::MemUse optMemUse = Geocoder::MemUseNormal;
+	Geocoder::VerifyMode optVerifyMode = Geocoder::VerifyNone;
+	std::vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool ok = true;
+		if (arg == "-threads" && i + 1 < argc) {
+			nbrThreads = atoi(argv[++i]);
+		} else if (arg == "-max" && i + 1 < argc) {
+			maxReports = size_t(atoi(argv[++i]));
+		} else if (arg == "-tolerance" && i + 1 < argc) {
+			tolerance = atof(argv[++i]);
+		} else if (arg == "-ref-memuse" && i + 1 < argc) {
+			ok = ParseMemUse(argv[++i], refMemUse);
+		} else if (arg == "-opt-memuse" && i + 1 < argc) {
+			ok = ParseMemUse(argv[++i], optMemUse);
+		} else if (arg == "-opt-verify" && i + 1 < argc) {
+			std::string mode = argv[++i];
+			if (mode == "none") {
+				optVerifyMode = Geocoder::VerifyNone;
+			} else if (mode == "open") {
+				optVerifyMode = Geocoder::VerifyAtOpen;
+			} else if (mode == "lazy") {
+				optVerifyMode = Geocoder::VerifyLazy;
+			} else {
+				ok = false;
+			}
+		} else if (arg[0] == '-') {
+			ok = false;
+		} else {
+			args.push_back(argv[i]);
+		}
+		if (!ok) {
+			args.clear();
+			break;
+		}
+	}
+	if (args.size() != 5 || tolerance < 0) {
+		Usage(argv[0]);
+		return 2;
+	}
+	if (nbrThreads < 1) {
+		nbrThreads = 1;
+	}
+
+	std::vector<Address> addresses;
+	if (!ReadAddresses(args[4], addresses)) {
+		return 2;
+	}
+	if (size_t(nbrThreads) > addresses.size() / ChunkSize + 1) {
+		nbrThreads = int(addresses.size() / ChunkSize + 1);
+	}
+
+	// Two Geocoders per thread; they are opened one at a time.
+	std::vector<std::unique_ptr<Worker> > workers;
+	for (int i = 0; i < nbrThreads; i++) {
+		std::unique_ptr<Worker> worker(new Worker);
+		worker->reference.reset(new DiffGeocoder(args[0], args[1], refMemUse));
+		worker->optimized.reset(new DiffGeocoder(args[2], args[3], optMemUse));
+		worker->optimized->SetVerifyMode(optVerifyMode);
+		if (!worker->reference->Open()) {
+			std::cerr << "Cannot open the reference configuration\n";
+			return 2;
+		}
+		if (!worker->optimized->Open()) {
+			std::cerr << "Cannot open the optimized configuration\n";
+			return 2;
+		}
+		workers.push_back(std::move(worker));
+	}
+
+	Clock::time_point start = Clock::now();
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < workers.size(); i++) {
+		Worker* worker = workers[i].get();
+		threads.push_back(std::thread([&, worker]() {
+			worker->Run(addresses, next, tolerance, maxReports);
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::vector<Divergence> divergences;
+	size_t nbrDiverged = 0;
+	size_t nbrCandidates = 0;
+	double refSeconds = 0;
+	double optSeconds = 0;
+	for (size_t i = 0; i < workers.size(); i++) {
+		const Worker& worker = *workers[i];
+		divergences.insert(divergences.end(), worker.divergences.begin(), worker.divergences.end());
+		nbrDiverged += worker.nbrDiverged;
+		nbrCandidates += worker.nbrCandidates;
+		refSeconds += worker.refSeconds;
+		optSeconds += worker.optSeconds;
+	}
+	std::sort(divergences.begin(), divergences.end());
+	if (divergences.size() > maxReports) {
+		divergences.resize(maxReports);
+	}
+
+	for (size_t i = 0; i < divergences.size(); i++) {
+		const Divergence& divergence = divergences[i];
+		const Address& address = addresses[divergence.addressIdx];
+		std::cout << "address " << divergence.addressIdx + 1 << ": \"" << address.line1 << "\" \""
+			<< address.line2 << "\"\n" << divergence.report;
+	}
+	std::cout << addresses.size() << " addresses, " << nbrCandidates << " reference candidates, "
+		<< nbrDiverged << " differ; " << nbrThreads << " threads, " << seconds << " sec\n"
+		<< "coding time: reference " << refSeconds << " sec, optimized " << optSeconds << " sec\n";
+	return nbrDiverged == 0 ? 0 : 1;
+}
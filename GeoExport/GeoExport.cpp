@@ -0,0 +1,1030 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoExport.cpp: Decodes every table of a database, delta included, into
+// CSV or packed columnar shards, and writes a summary of the tables, their
+// chunk sizes and the code lengths of each Huffman coder.
+//
+//	geoexport [options] <tableDir> <databaseDir> <outputDir>
+//
+// The ID range of each table is cut into shards on chunk boundaries (the
+// entries of the position index), so that no two threads decode the same
+// chunk, and the shards are handed out to the threads largest table first.
+// Each thread has its own QueryImp.
+
+// The StreetNameSoundex and StreetIntersectionSoundex records are private
+// to QueryImp unless this is defined.
+#define COMPILE_GEOBROWSE
+
+#include "../geocommon/Geocoder_Headers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../geocoder/GeoQueryImp.h"
+#include "../geocommon/GeoDataInput.h"
+#include "../geocommon/GeoFreqTable.h"
+#include "../geocommon/GeoHuffman.h"
+#include "../geocommon/GeoPackedTable.h"
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+///////////////////////////////////////////////////////////////////////////////
+// QueryImp that reports its error messages
+///////////////////////////////////////////////////////////////////////////////
+class ExportQuery : public QueryImp {
+public:
+	ExportQuery(const TsString& tableDir, const TsString& databaseDir) :
+		QueryImp(tableDir, databaseDir, Geocoder::MemUseSmall)
+	{}
+	virtual void ErrorMessage(const TsString& msg) {
+		std::cerr << msg << "\n";
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Columns of an exported table
+///////////////////////////////////////////////////////////////////////////////
+enum ColumnType {
+	ColumnInt,			// integer
+	ColumnID,			// integer that rises from record to record; delta coded
+	ColumnChar,			// null-terminated string of at most width-1 characters
+	ColumnDegrees		// latitude or longitude, held as 1/100000 degree
+};
+
+struct Column {
+	const char* name;
+	ColumnType type;
+	int width;			// ColumnChar only: size of the field, with the null
+};
+
+static const char* ColumnTypeName(ColumnType type)
+{
+	switch (type) {
+	case ColumnInt: return "int";
+	case ColumnID: return "id";
+	case ColumnChar: return "char";
+	case ColumnDegrees: return "degrees";
+	}
+	return "?";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Receives the records of one shard, a field at a time.
+///////////////////////////////////////////////////////////////////////////////
+class ShardWriter {
+public:
+	virtual ~ShardWriter() {}
+	virtual void Int(int value) = 0;
+	virtual void Str(const char* value) = 0;
+	virtual void Degrees(double value) = 0;
+	virtual void EndRecord() = 0;
+	// Flush and close the shard; returns false on a write error.
+	virtual bool Close() = 0;
+	// Bytes written, valid after Close().
+	virtual __int64 GetBytesWritten() const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a CSV shard with a header line.  Fields are quoted only when they
+// must be.
+///////////////////////////////////////////////////////////////////////////////
+class CsvShardWriter : public ShardWriter {
+public:
+	CsvShardWriter() : fp(0), atLineStart(true), bytes(0) {}
+	virtual ~CsvShardWriter() { Close(); }
+
+	bool Open(const std::string& filename_, const std::vector<Column>& columns) {
+		filename = filename_;
+		fp = fopen(filename.c_str(), "wb");
+		if (fp == 0) {
+			std::cerr << "Cannot create " << filename << "\n";
+			return false;
+		}
+		for (size_t i = 0; i < columns.size(); i++) {
+			fprintf(fp, "%s%s", i == 0 ? "" : ",", columns[i].name);
+		}
+		fputc('\n', fp);
+		return true;
+	}
+	virtual void Int(int value) {
+		Separator();
+		fprintf(fp, "%d", value);
+	}
+	virtual void Degrees(double value) {
+		Separator();
+		fprintf(fp, "%.5f", value);
+	}
+	virtual void Str(const char* value) {
+		Separator();
+		if (strpbrk(value, ",\"") == 0) {
+			fputs(value, fp);
+		} else {
+			fputc('"', fp);
+			for (const char* p = value; *p != 0; p++) {
+				if (*p == '"') {
+					fputc('"', fp);
+				}
+				fputc(*p, fp);
+			}
+			fputc('"', fp);
+		}
+	}
+	virtual void EndRecord() {
+		fputc('\n', fp);
+		atLineStart = true;
+	}
+	virtual bool Close() {
+		bool ok = true;
+		if (fp != 0) {
+			ok = !ferror(fp);
+			bytes = ftell(fp);
+			ok = fclose(fp) == 0 && ok;
+			fp = 0;
+			if (!ok) {
+				std::cerr << "Error writing " << filename << "\n";
+			}
+		}
+		return ok;
+	}
+	virtual __int64 GetBytesWritten() const { return bytes; }
+
+private:
+	void Separator() {
+		if (!atLineStart) {
+			fputc(',', fp);
+		}
+		atLineStart = false;
+	}
+
+	std::string filename;
+	FILE* fp;
+	bool atLineStart;
+	__int64 bytes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Writes a shard as a packed table (see GeoPackedTable.h): each block of
+// GeoUtil::PackedBlockSize records holds the columns in schema order, ID
+// columns delta coded, degrees as integers in 1/100000 degree.
+///////////////////////////////////////////////////////////////////////////////
+class ColumnarShardWriter : public ShardWriter {
+public:
+	ColumnarShardWriter() : ok(true), column(0), rows(0), bytes(0) {}
+	virtual ~ColumnarShardWriter() {}
+
+	bool Open(const std::string& filename_, const std::vector<Column>& columns_) {
+		filename = filename_;
+		columns = columns_;
+		intValues.assign(columns.size(), std::vector<int>());
+		charValues.assign(columns.size(), std::vector<char>());
+		if (!writer.Open(filename, GeoUtil::PackedBlockSize)) {
+			std::cerr << "Cannot create " << filename << "\n";
+			return false;
+		}
+		return true;
+	}
+	virtual void Int(int value) {
+		intValues[column++].push_back(value);
+	}
+	virtual void Degrees(double value) {
+		intValues[column++].push_back(int(floor(value * 100000.0 + 0.5)));
+	}
+	virtual void Str(const char* value) {
+		std::vector<char>& field = charValues[column];
+		size_t pos = field.size();
+		field.resize(pos + columns[column].width, 0);
+		strncpy(&field[pos], value, columns[column].width - 1);
+		column++;
+	}
+	virtual void EndRecord() {
+		column = 0;
+		if (++rows == GeoUtil::PackedBlockSize) {
+			FlushBlock();
+		}
+	}
+	virtual bool Close() {
+		if (rows > 0) {
+			FlushBlock();
+		}
+		ok = writer.Close() && ok;
+		if (!ok) {
+			std::cerr << "Error writing " << filename << "\n";
+		}
+		FILE* fp = fopen(filename.c_str(), "rb");
+		if (fp != 0) {
+			fseek(fp, 0, SEEK_END);
+			bytes = ftell(fp);
+			fclose(fp);
+		}
+		return ok;
+	}
+	virtual __int64 GetBytesWritten() const { return bytes; }
+
+private:
+	void FlushBlock() {
+		block.Clear();
+		for (size_t i = 0; i < columns.size(); i++) {
+			switch (columns[i].type) {
+			case ColumnID:
+				block.AddDeltaColumn(&intValues[i][0], rows);
+				break;
+			case ColumnInt:
+			case ColumnDegrees:
+				block.AddIntColumn(&intValues[i][0], rows);
+				break;
+			case ColumnChar:
+				block.AddCharColumn(&charValues[i][0], columns[i].width, rows);
+				break;
+			}
+			intValues[i].clear();
+			charValues[i].clear();
+		}
+		ok = writer.WriteBlock(block, rows) && ok;
+		rows = 0;
+	}
+
+	std::string filename;
+	std::vector<Column> columns;
+	PackedTableWriter writer;
+	PackedBlockWriter block;
+	std::vector<std::vector<int> > intValues;
+	std::vector<std::vector<char> > charValues;
+	bool ok;
+	size_t column;
+	int rows;
+	__int64 bytes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The exported tables.  Each has its columns, the number of IDs in a chunk
+// of its data file (1 for fixed-length records) or of a packed block, and functions giving the
+// record count and writing one record.  A record that cannot be read, such
+// as one deleted by the delta, is skipped.
+///////////////////////////////////////////////////////////////////////////////
+struct TableDef {
+	const char* name;
+	std::vector<Column> columns;
+	int chunkSize;
+	const char* packedFile;		// file that replaces the table in packed databases
+	int (*count)(ExportQuery& query);
+	bool (*exportRecord)(ExportQuery& query, int ID, ShardWriter& out);
+};
+
+static std::vector<TableDef> MakeTableDefs()
+{
+	std::vector<TableDef> tables;
+	{
+		TableDef t = { "CityStatePostcode", {
+			{ "ID", ColumnID, 0 },
+			{ "COUNTRY", ColumnChar, 3 },
+			{ "STATE", ColumnInt, 0 },
+			{ "STATE_ABBR", ColumnChar, 4 },
+			{ "CITY", ColumnChar, 41 },
+			{ "POSTCODE", ColumnChar, 7 },
+			{ "FINANCE_NUMBER", ColumnChar, 7 },
+			{ "STREET_NAME_ID_FIRST", ColumnID, 0 },
+			{ "STREET_NAME_ID_LAST", ColumnID, 0 }
+		}, 1, 0,
+		[](ExportQuery& q) { return q.GetCityStatePostcodeCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			CityStatePostcode r;
+			if (!q.GetCityStatePostcodeByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.country); out.Int(r.state); out.Str(r.stateAbbr);
+			out.Str(r.city); out.Str(r.postcode); out.Str(r.financeNumber);
+			out.Int(r.streetNameIDFirst); out.Int(r.streetNameIDLast);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "CityStatePostcodeFaIndex", {
+			{ "ID", ColumnID, 0 },
+			{ "FINANCE_NUMBER", ColumnChar, 7 },
+			{ "CITY_STATE_POSTCODE_ID", ColumnInt, 0 }
+		}, 1, 0,
+		[](ExportQuery& q) { return q.GetCityStatePostcodeFaIndexCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			CityStatePostcodeFaIndex r;
+			if (!q.GetCityStatePostcodeFaIndexByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.financeNumber); out.Int(r.cityStatePostcodeID);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "CitySoundex", {
+			{ "ID", ColumnID, 0 },
+			{ "STATE", ColumnInt, 0 },
+			{ "CITY_SOUNDEX", ColumnChar, 5 },
+			{ "CITY_STATE_POSTCODE_ID", ColumnInt, 0 }
+		}, 1, 0,
+		[](ExportQuery& q) { return q.GetCityStatePostcodeSoundexCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			QueryImp::CityStatePostcodeSoundex r;
+			if (!q.GetCityStatePostcodeSoundexByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Int(r.state); out.Str(r.citySoundex); out.Int(r.cityStatePostcodeID);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "StreetName", {
+			{ "ID", ColumnID, 0 },
+			{ "CITY_STATE_POSTCODE_ID", ColumnInt, 0 },
+			{ "PREFIX", ColumnChar, 7 },
+			{ "PREDIR", ColumnChar, 3 },
+			{ "NAME", ColumnChar, 41 },
+			{ "SUFFIX", ColumnChar, 7 },
+			{ "POSTDIR", ColumnChar, 3 },
+			{ "STREET_SEGMENT_ID_FIRST", ColumnInt, 0 },
+			{ "STREET_SEGMENT_COUNT", ColumnInt, 0 }
+		}, GeoUtil::StreetNameChunkSize, GeoUtil::STREET_NAME_PACKED_FILE,
+		[](ExportQuery& q) { return q.GetStreetNameCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			StreetName r;
+			if (!q.GetStreetNameByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Int(r.cityStatePostcodeID); out.Str(r.prefix); out.Str(r.predir);
+			out.Str(r.street); out.Str(r.suffix); out.Str(r.postdir);
+			out.Int(r.streetSegmentIDFirst); out.Int(r.streetSegmentCount);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "StreetNameSoundex", {
+			{ "ID", ColumnID, 0 },
+			{ "FINANCE_NUMBER", ColumnChar, 7 },
+			{ "STREET_SOUNDEX", ColumnChar, 5 },
+			{ "STREET_NAME_ID", ColumnInt, 0 }
+		}, 1, 0,
+		[](ExportQuery& q) { return q.GetStreetNameSoundexCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			QueryImp::StreetNameSoundex r;
+			if (!q.GetStreetNameSoundexByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.financeNumber); out.Str(r.streetSoundex); out.Int(r.streetNameID);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "StreetSegment", {
+			{ "ID", ColumnID, 0 },
+			{ "ADDR_LOW", ColumnChar, 11 },
+			{ "ADDR_HIGH", ColumnChar, 11 },
+			{ "RIGHT_SIDE", ColumnInt, 0 },
+			{ "COUNTY", ColumnInt, 0 },
+			{ "CENSUS_TRACT", ColumnChar, 7 },
+			{ "CENSUS_BLOCK", ColumnChar, 5 },
+			{ "POSTCODE_EXT", ColumnChar, 5 },
+			{ "COORDINATE_ID", ColumnInt, 0 },
+			{ "COORDINATE_COUNT", ColumnInt, 0 }
+		}, GeoUtil::StreetSegmentChunkSize, GeoUtil::STREET_SEGMENT_PACKED_FILE,
+		[](ExportQuery& q) { return q.GetStreetSegmentCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			StreetSegment r;
+			if (!q.GetStreetSegmentByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.addrLow); out.Str(r.addrHigh); out.Int(r.isRightSide ? 1 : 0);
+			out.Int(r.countyCode); out.Str(r.censusTract); out.Str(r.censusBlock); out.Str(r.postcodeExt);
+			out.Int(r.coordinateID); out.Int(r.coordinateCount);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "Coordinate", {
+			{ "ID", ColumnID, 0 },
+			{ "LATITUDE", ColumnDegrees, 0 },
+			{ "LONGITUDE", ColumnDegrees, 0 }
+		}, GeoUtil::CoordinateChunkSize, GeoUtil::COORDINATE_PACKED_FILE,
+		[](ExportQuery& q) { return q.GetCoordinateCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			CoordinatePoint r;
+			if (!q.GetCoordinateByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Degrees(r.latitude); out.Degrees(r.longitude);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "StreetIntersectionSoundex", {
+			{ "ID", ColumnID, 0 },
+			{ "STATE", ColumnInt, 0 },
+			{ "STREET_SOUNDEX1", ColumnChar, 5 },
+			{ "STREET_NAME_ID1", ColumnInt, 0 },
+			{ "STREET_SEGMENT_OFFSET1", ColumnInt, 0 },
+			{ "STREET_SOUNDEX2", ColumnChar, 5 },
+			{ "STREET_NAME_ID2", ColumnInt, 0 },
+			{ "STREET_SEGMENT_OFFSET2", ColumnInt, 0 }
+		}, GeoUtil::StreetIntersectionSoundexChunkSize, 0,
+		[](ExportQuery& q) { return q.GetStreetIntersectionSoundexCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			QueryImp::StreetIntersectionSoundex r;
+			if (!q.GetStreetIntersectionSoundexByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Int(r.state);
+			out.Str(r.streetSoundex1); out.Int(r.streetNameID1); out.Int(r.streetSegmentOffset1);
+			out.Str(r.streetSoundex2); out.Int(r.streetNameID2); out.Int(r.streetSegmentOffset2);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "PostcodeAlias", {
+			{ "ID", ColumnID, 0 },
+			{ "POSTCODE", ColumnChar, 7 },
+			{ "POSTCODE_GROUP", ColumnChar, 7 }
+		}, 1, 0,
+		[](ExportQuery& q) { return int(q.GetPostcodeAliasCount()); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			PostcodeAlias r;
+			if (!q.GetPostcodeAliasByPostcodeID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.postcode); out.Str(r.postcodeGroup);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	{
+		TableDef t = { "PostcodeCentroid", {
+			{ "ID", ColumnID, 0 },
+			{ "POSTCODE", ColumnChar, 7 },
+			{ "LATITUDE", ColumnDegrees, 0 },
+			{ "LONGITUDE", ColumnDegrees, 0 }
+		}, 1, 0,
+		[](ExportQuery& q) { return q.GetPostcodeCentroidCount(); },
+		[](ExportQuery& q, int ID, ShardWriter& out) {
+			PostcodeCentroid r;
+			if (!q.GetPostcodeCentroidByID(ID, r)) {
+				return false;
+			}
+			out.Int(ID); out.Str(r.postcode); out.Degrees(r.latitude); out.Degrees(r.longitude);
+			return true;
+		} };
+		tables.push_back(t);
+	}
+	return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A run of IDs of one table, exported to one shard file
+///////////////////////////////////////////////////////////////////////////////
+struct Shard {
+	size_t tableIdx;
+	int shardNbr;
+	int firstID;
+	int endID;			// one past the last ID
+	// Results
+	bool ok;
+	int records;		// records written
+	int missing;		// IDs that could not be read
+	__int64 bytes;		// size of the shard file
+};
+
+static std::string ShardFilename(
+	const std::string& outputDir,
+	const char* table,
+	int shardNbr,
+	bool columnar
+) {
+	char buf[32];
+	sprintf(buf, ".%04d.%s", shardNbr, columnar ? "gpk" : "csv");
+	return outputDir + "/" + table + buf;
+}
+
+static void ExportShard(
+	ExportQuery& query,
+	const TableDef& table,
+	const std::string& outputDir,
+	bool columnar,
+	Shard& shard
+) {
+	std::string filename = ShardFilename(outputDir, table.name, shard.shardNbr, columnar);
+	std::unique_ptr<ShardWriter> out;
+	if (columnar) {
+		ColumnarShardWriter* writer = new ColumnarShardWriter;
+		out.reset(writer);
+		shard.ok = writer->Open(filename, table.columns);
+	} else {
+		CsvShardWriter* writer = new CsvShardWriter;
+		out.reset(writer);
+		shard.ok = writer->Open(filename, table.columns);
+	}
+	if (!shard.ok) {
+		return;
+	}
+	// IDs are read in order, so each chunk is decoded once.
+	for (int ID = shard.firstID; ID < shard.endID; ID++) {
+		if (table.exportRecord(query, ID, *out)) {
+			out->EndRecord();
+			shard.records++;
+		} else {
+			shard.missing++;
+		}
+	}
+	shard.ok = out->Close();
+	shard.bytes = out->GetBytesWritten();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Size distribution of the chunks (or packed blocks) of a data file
+///////////////////////////////////////////////////////////////////////////////
+struct ChunkStats {
+	std::string table;
+	std::string source;		// file the sizes were taken from
+	std::vector<unsigned int> bytes;
+};
+
+// Chunk sizes of a Huffman-coded table, from the bit offsets in its
+// position index.  The last 32 bits of the index hold the record count.
+static bool ChunkSizesFromIndex(
+	const std::string& databaseDir,
+	const char* dataFile,
+	const char* indexFile,
+	int bitSize,
+	std::vector<unsigned int>& bytesReturn
+) {
+	DataInput data, index;
+	if (
+		!data.Open(databaseDir + "/" + dataFile) ||
+		!index.Open(databaseDir + "/" + indexFile)
+	) {
+		return false;
+	}
+	__int64 dataBits = __int64(data.GetFileSize()) * 8;
+	int entries = int((__int64(index.GetFileSize()) * 8 - 32) / bitSize);
+	int prev = 0;
+	for (int i = 0; i < entries; i++) {
+		int offset;
+		if (
+			!index.GetBitStream().Seek(__int64(i) * bitSize) ||
+			!index.GetBitStream().ReadBitsIntoInt(bitSize, offset)
+		) {
+			return false;
+		}
+		if (i > 0) {
+			bytesReturn.push_back(unsigned(offset - prev + 7) / 8);
+		}
+		prev = offset;
+	}
+	if (entries > 0) {
+		bytesReturn.push_back(unsigned(dataBits - prev + 7) / 8);
+	}
+	return true;
+}
+
+static bool BlockSizesFromPackedFile(
+	const std::string& databaseDir,
+	const char* packedFile,
+	std::vector<unsigned int>& bytesReturn
+) {
+	PackedTableReader reader;
+	if (!reader.Open(databaseDir + "/" + packedFile)) {
+		return false;
+	}
+	for (int i = 0; i < reader.GetBlockCount(); i++) {
+		bytesReturn.push_back(reader.GetBlockLength(i));
+	}
+	return true;
+}
+
+static std::vector<ChunkStats> CollectChunkStats(const std::string& databaseDir)
+{
+	struct ChunkedTable {
+		const char* table;
+		const char* dataFile;
+		const char* indexFile;
+		int bitSize;
+		const char* packedFile;		// 0 if the table is never packed
+	} chunkedTables[] = {
+		{ "StreetName", GeoUtil::STREET_NAME_FILE, GeoUtil::STREET_NAME_POSITION_INDEX_FILE,
+			GeoUtil::StreetNamePositionIndexBitSize, GeoUtil::STREET_NAME_PACKED_FILE },
+		{ "StreetSegment", GeoUtil::STREET_SEGMENT_FILE, GeoUtil::STREET_SEGMENT_POSITION_INDEX_FILE,
+			GeoUtil::StreetSegmentPositionIndexBitSize, GeoUtil::STREET_SEGMENT_PACKED_FILE },
+		{ "Coordinate", GeoUtil::COORDINATE_FILE, GeoUtil::COORDINATE_POSITION_INDEX_FILE,
+			GeoUtil::CoordinatePositionIndexBitSize, GeoUtil::COORDINATE_PACKED_FILE },
+		{ "StreetIntersectionSoundex", GeoUtil::STREET_INTERSECTION_SOUNDEX_FILE,
+			GeoUtil::STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE,
+			GeoUtil::StreetIntersectionPositionIndexBitSize, 0 }
+	};
+	std::vector<ChunkStats> result;
+	for (size_t i = 0; i < sizeof(chunkedTables) / sizeof(chunkedTables[0]); i++) {
+		const ChunkedTable& t = chunkedTables[i];
+		ChunkStats stats;
+		stats.table = t.table;
+		if (t.packedFile != 0 && BlockSizesFromPackedFile(databaseDir, t.packedFile, stats.bytes)) {
+			stats.source = t.packedFile;
+		} else if (ChunkSizesFromIndex(databaseDir, t.dataFile, t.indexFile, t.bitSize, stats.bytes)) {
+			stats.source = t.dataFile;
+		} else {
+			continue;
+		}
+		result.push_back(stats);
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Code-length distribution of one Huffman coder
+///////////////////////////////////////////////////////////////////////////////
+struct CoderStats {
+	std::string file;			// frequency table name, as in GeoUtil
+	std::string source;			// "code lengths", "frequencies" or "missing"
+	int symbols;
+	std::map<int, int> symbolsByLength;
+	// Frequency tables only: the number of values coded, and the total bits.
+	__int64 codedValues;
+	__int64 codedBits;
+};
+
+// Load a coder the way QueryImp does: the code-length table if there is
+// one, else the frequency table.  Values' lengths go into the stats.
+template <class T, class FT> static void LoadCoderStats(
+	const std::string& databaseDir,
+	const char* filename,
+	CoderStats& stats
+) {
+	stats.file = filename;
+	stats.source = "missing";
+	stats.symbols = 0;
+	stats.codedValues = 0;
+	stats.codedBits = 0;
+
+	HuffmanCoder<T, std::less<T> > coder;
+	std::fstream fs;
+	std::string path = databaseDir + "/" + GeoUtil::CodeLengthFilename(filename);
+	fs.open(path.c_str(), std::ios_base::in | std::ios_base::binary);
+	if (!fs.fail()) {
+		if (GeoUtil::LoadCodeLengths(coder, fs)) {
+			std::vector<T> values;
+			std::vector<int> lengths;
+			coder.GetCodeLengths(values, lengths);
+			stats.source = "code lengths";
+			stats.symbols = int(values.size());
+			for (size_t i = 0; i < lengths.size(); i++) {
+				stats.symbolsByLength[lengths[i]]++;
+			}
+		}
+		return;
+	}
+	fs.clear();
+	path = databaseDir + "/" + filename;
+	fs.open(path.c_str(), std::ios_base::in);
+	FT freqTable;
+	if (fs.fail() || !freqTable.Load(fs)) {
+		return;
+	}
+	coder.AddEntries(freqTable);
+	coder.MakeCodes();
+	stats.source = "frequencies";
+	for (typename FT::const_iterator iter = freqTable.begin(); iter != freqTable.end(); ++iter) {
+		unsigned char code[64];
+		int length;
+		if (!coder.GetCode(iter->first, code, length)) {
+			continue;
+		}
+		stats.symbols++;
+		stats.symbolsByLength[length]++;
+		stats.codedValues += iter->second;
+		stats.codedBits += __int64(iter->second) * length;
+	}
+}
+
+static std::vector<CoderStats> CollectCoderStats(const std::string& databaseDir)
+{
+	const char* intCoderFiles[] = {
+		GeoUtil::STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE,
+		GeoUtil::STREET_NAME_NAME_HUFF_FILE,
+		GeoUtil::STREET_NAME_STREET_SEGMENT_ID_FIRST_HUFF_FILE,
+		GeoUtil::STREET_NAME_STREET_SEGMENT_COUNT_HUFF_FILE,
+		GeoUtil::STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_ADDR_HIGH_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_ADDR_HIGH_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_COUNTY_KEY_HUFF_FILE,
+		GeoUtil::STREET_SEGMENT_COUNTY_NONKEY_HUFF_FILE,
+		GeoUtil::STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_POSTCODE_EXT_KEY_HUFF_FILE,
+		GeoUtil::STREET_SEGMENT_POSTCODE_EXT_NONKEY_HUFF_FILE,
+		GeoUtil::STREET_SEGMENT_COORDINATE_ID_HUFF_FILE1,
+		GeoUtil::STREET_SEGMENT_COORDINATE_ID_HUFF_FILE2,
+		GeoUtil::STREET_SEGMENT_COORDINATE_COUNT_HUFF_FILE,
+		GeoUtil::COORDINATE_LATITUDE_HUFF_FILE1,
+		GeoUtil::COORDINATE_LATITUDE_HUFF_FILE2,
+		GeoUtil::COORDINATE_LONGITUDE_HUFF_FILE1,
+		GeoUtil::COORDINATE_LONGITUDE_HUFF_FILE2,
+		GeoUtil::STREET_INTERSECTION_STATE_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_SOUNDEX1_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_STREET_NAME_ID1_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_STREET_SEGMENT_OFFSET1_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_SOUNDEX2_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_STREET_NAME_ID2_HUFF_FILE,
+		GeoUtil::STREET_INTERSECTION_STREET_SEGMENT_OFFSET2_HUFF_FILE
+	};
+	const char* stringCoderFiles[] = {
+		GeoUtil::STREET_NAME_PREFIX_HUFF_FILE,
+		GeoUtil::STREET_NAME_PREDIR_HUFF_FILE,
+		GeoUtil::STREET_NAME_SUFFIX_HUFF_FILE,
+		GeoUtil::STREET_NAME_POSTDIR_HUFF_FILE
+	};
+	std::vector<CoderStats> result;
+	for (size_t i = 0; i < sizeof(intCoderFiles) / sizeof(intCoderFiles[0]); i++) {
+		CoderStats stats;
+		LoadCoderStats<int, FreqTable<int> >(databaseDir, intCoderFiles[i], stats);
+		result.push_back(stats);
+	}
+	for (size_t i = 0; i < sizeof(stringCoderFiles) / sizeof(stringCoderFiles[0]); i++) {
+		CoderStats stats;
+		LoadCoderStats<TsString, StringFreqTable>(databaseDir, stringCoderFiles[i], stats);
+		result.push_back(stats);
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The summary report
+///////////////////////////////////////////////////////////////////////////////
+static void WriteSummary(
+	std::ostream& os,
+	const std::vector<TableDef>& tables,
+	const std::vector<Shard>& shards,
+	const std::vector<ChunkStats>& chunkStats,
+	const std::vector<CoderStats>& coderStats,
+	bool decoded,
+	double seconds
+) {
+	os << "Tables\n";
+	os << "table\tIDs\trecords\tmissing\tshards\tbytes\n";
+	__int64 totalRecords = 0;
+	for (size_t t = 0; t < tables.size(); t++) {
+		__int64 IDs = 0, records = 0, missing = 0, bytes = 0;
+		int nbrShards = 0;
+		for (size_t s = 0; s < shards.size(); s++) {
+			if (shards[s].tableIdx == t) {
+				IDs += shards[s].endID - shards[s].firstID;
+				records += shards[s].records;
+				missing += shards[s].missing;
+				bytes += shards[s].bytes;
+				nbrShards++;
+			}
+		}
+		if (nbrShards == 0) {
+			continue;
+		}
+		totalRecords += records;
+		os << tables[t].name << "\t" << IDs << "\t" << records << "\t" << missing << "\t"
+			<< nbrShards << "\t" << bytes << "\n";
+	}
+	if (decoded) {
+		os << totalRecords << " records in " << seconds << " sec\n";
+	} else {
+		os << "Records not decoded (-summary)\n";
+	}
+
+	os << "\nChunk sizes in bytes\n";
+	os << "table\tfile\tchunks\tmin\tmean\tmedian\tp90\tmax\n";
+	for (size_t i = 0; i < chunkStats.size(); i++) {
+		std::vector<unsigned int> bytes = chunkStats[i].bytes;
+		os << chunkStats[i].table << "\t" << chunkStats[i].source << "\t" << bytes.size();
+		if (bytes.empty()) {
+			os << "\n";
+			continue;
+		}
+		std::sort(bytes.begin(), bytes.end());
+		__int64 total = 0;
+		for (size_t j = 0; j < bytes.size(); j++) {
+			total += bytes[j];
+		}
+		os << "\t" << bytes.front() << "\t" << double(total) / bytes.size()
+			<< "\t" << bytes[bytes.size() / 2] << "\t" << bytes[bytes.size() * 9 / 10]
+			<< "\t" << bytes.back() << "\n";
+	}
+
+	os << "\nHuffman code lengths (symbols of each length)\n";
+	os << "coder\tsource\tsymbols\tbits/value\tlengths\n";
+	for (size_t i = 0; i < coderStats.size(); i++) {
+		const CoderStats& stats = coderStats[i];
+		os << stats.file << "\t" << stats.source << "\t" << stats.symbols << "\t";
+		if (stats.codedValues > 0) {
+			os << double(stats.codedBits) / stats.codedValues;
+		} else {
+			os << "-";
+		}
+		os << "\t";
+		for (std::map<int, int>::const_iterator iter = stats.symbolsByLength.begin(); iter != stats.symbolsByLength.end(); ++iter) {
+			os << (iter == stats.symbolsByLength.begin() ? "" : " ") << iter->first << ":" << iter->second;
+		}
+		os << "\n";
+	}
+}
+
+static void WriteSchema(const std::string& outputDir, const TableDef& table)
+{
+	std::ofstream os((outputDir + "/" + table.name + ".schema.txt").c_str());
+	for (size_t i = 0; i < table.columns.size(); i++) {
+		os << table.columns[i].name << "\t" << ColumnTypeName(table.columns[i].type);
+		if (table.columns[i].type == ColumnChar) {
+			os << "\t" << table.columns[i].width;
+		}
+		os << "\n";
+	}
+}
+
+static void Usage(const char* argv0)
+{
+	std::cerr <<
+		"Usage: " << argv0 << " [options] <tableDir> <databaseDir> <outputDir>\n"
+		"  -threads N     decoding threads (default: one per processor)\n"
+		"  -shards N      most shards per table (default: 4 per thread)\n"
+		"  -columnar      write packed columnar shards (.gpk) instead of CSV\n"
+		"  -tables A,B    export only the named tables\n"
+		"  -summary       write only the summary report\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int nbrThreads = int(std::thread::hardware_concurrency());
+	int maxShards = 0;
+	bool columnar = false;
+	bool summaryOnly = false;
+	std::string tableList;
+	int argIdx = 1;
+	for (; argIdx < argc && argv[argIdx][0] == '-'; argIdx++) {
+		std::string opt = argv[argIdx];
+		if (opt == "-threads" && argIdx + 1 < argc) {
+			nbrThreads = atoi(argv[++argIdx]);
+		} else if (opt == "-shards" && argIdx + 1 < argc) {
+			maxShards = atoi(argv[++argIdx]);
+		} else if (opt == "-columnar") {
+			columnar = true;
+		} else if (opt == "-tables" && argIdx + 1 < argc) {
+			tableList = "," + std::string(argv[++argIdx]) + ",";
+		} else if (opt == "-summary") {
+			summaryOnly = true;
+		} else {
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (argc - argIdx != 3) {
+		Usage(argv[0]);
+		return 1;
+	}
+	std::string tableDir = argv[argIdx];
+	std::string databaseDir = argv[argIdx + 1];
+	std::string outputDir = argv[argIdx + 2];
+	if (nbrThreads < 1) {
+		nbrThreads = 1;
+	}
+	if (maxShards < 1) {
+		maxShards = nbrThreads * 4;
+	}
+
+	std::vector<TableDef> tables = MakeTableDefs();
+	Clock::time_point start = Clock::now();
+
+	// One QueryImp per thread; they are opened one at a time.
+	std::vector<std::unique_ptr<ExportQuery> > queries;
+	for (int i = 0; i < (summaryOnly ? 1 : nbrThreads); i++) {
+		queries.push_back(std::unique_ptr<ExportQuery>(new ExportQuery(tableDir, databaseDir)));
+		if (!queries.back()->Open()) {
+			std::cerr << "Cannot open database " << databaseDir << "\n";
+			return 1;
+		}
+	}
+
+	// Cut each table into shards of whole chunks.
+	std::vector<Shard> shards;
+	for (size_t t = 0; t < tables.size(); t++) {
+		if (!tableList.empty() && tableList.find("," + std::string(tables[t].name) + ",") == std::string::npos) {
+			continue;
+		}
+		int count = tables[t].count(*queries[0]);
+		int chunkSize = tables[t].chunkSize;
+		if (tables[t].packedFile != 0) {
+			PackedTableReader reader;
+			if (reader.Open(databaseDir + "/" + tables[t].packedFile)) {
+				chunkSize = reader.GetBlockSize();
+			}
+		}
+		int chunks = (count + chunkSize - 1) / chunkSize;
+		int nbrShards = summaryOnly ? 1 : std::max(1, std::min(maxShards, chunks));
+		for (int s = 0; s < nbrShards; s++) {
+			Shard shard;
+			shard.tableIdx = t;
+			shard.shardNbr = s;
+			shard.firstID = int(__int64(chunks) * s / nbrShards) * chunkSize;
+			shard.endID = std::min(count, int(__int64(chunks) * (s + 1) / nbrShards) * chunkSize);
+			shard.ok = true;
+			shard.records = 0;
+			shard.missing = 0;
+			shard.bytes = 0;
+			shards.push_back(shard);
+		}
+		if (columnar && !summaryOnly) {
+			WriteSchema(outputDir, tables[t]);
+		}
+	}
+
+	if (!summaryOnly) {
+		// Hand out the largest shards first so the threads finish together.
+		std::vector<size_t> order(shards.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return shards[a].endID - shards[a].firstID > shards[b].endID - shards[b].firstID;
+		});
+		std::atomic<size_t> next(0);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < nbrThreads; i++) {
+			ExportQuery* query = queries[i].get();
+			threads.push_back(std::thread([&, query]() {
+				for (size_t idx; (idx = next++) < order.size(); ) {
+					Shard& shard = shards[order[idx]];
+					ExportShard(*query, tables[shard.tableIdx], outputDir, columnar, shard);
+				}
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	bool ok = true;
+	for (size_t i = 0; i < shards.size(); i++) {
+		ok = ok && shards[i].ok;
+	}
+
+	std::vector<ChunkStats> chunkStats = CollectChunkStats(databaseDir);
+	std::vector<CoderStats> coderStats = CollectCoderStats(databaseDir);
+	std::ostringstream summary;
+	WriteSummary(summary, tables, shards, chunkStats, coderStats, !summaryOnly, seconds);
+	std::cout << summary.str();
+	std::ofstream summaryFile((outputDir + "/Summary.txt").c_str());
+	summaryFile << summary.str();
+	if (!summaryFile) {
+		std::cerr << "Cannot write " << outputDir << "/Summary.txt\n";
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
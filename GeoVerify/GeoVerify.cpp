@@ -0,0 +1,172 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoVerify.cpp: Writes and checks the checksum manifest of a database, and
+// measures how fast a database can be verified.
+//
+//	verify build <databaseDir>
+//		Write the manifest, for databases built before the loaders wrote one.
+//	verify check <databaseDir> [threads...]
+//		Check every file once for each thread count, and report MB/s.
+//	verify open <tableDir> <databaseDir>
+//		Time opening a Geocoder with each verify mode.
+
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include "../geocommon/Geocoder_Headers.h"
+#include "../geocommon/GeoChecksum.h"
+#include "../geocommon/GeoUtil.h"
+#include "../geocoder/Geocoder.h"
+
+using namespace PortfolioExplorer;
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double MBPerSec(__int64 bytes, double seconds)
+{
+	return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocoder that prints its error messages
+///////////////////////////////////////////////////////////////////////////////
+class VerifyGeocoder : public Geocoder {
+public:
+	VerifyGeocoder(const char* tableDir, const char* databaseDir) :
+		Geocoder(tableDir, databaseDir)
+	{}
+	virtual void ErrorMessage(const char* message) {
+		std::cerr << message << "\n";
+	}
+};
+
+static int Build(const std::string& databaseDir)
+{
+	Clock::time_point start = Clock::now();
+	ChecksumManifest manifest;
+	TsString errorMsg;
+	if (
+		!manifest.Build(databaseDir, errorMsg) ||
+		!manifest.WriteToFile(databaseDir + "/" + GeoUtil::CHECKSUM_MANIFEST_FILE, errorMsg)
+	) {
+		std::cerr << errorMsg << "\n";
+		return 1;
+	}
+	double seconds = SecondsSince(start);
+	std::cout << manifest.GetFileCount() << " files, "
+		<< manifest.GetTotalSize() / (1024 * 1024) << " MB checksummed in "
+		<< seconds << " sec, " << MBPerSec(manifest.GetTotalSize(), seconds) << " MB/s\n";
+	return 0;
+}
+
+static int Check(const std::string& databaseDir, std::vector<int> threadCounts)
+{
+	ChecksumManifest manifest;
+	TsString errorMsg;
+	if (!manifest.LoadFromFile(databaseDir + "/" + GeoUtil::CHECKSUM_MANIFEST_FILE, errorMsg)) {
+		std::cerr << errorMsg << "\n";
+		return 1;
+	}
+	if (threadCounts.empty()) {
+		threadCounts.push_back(1);
+		if (ChecksumManifest::GetProcessorCount() > 1) {
+			threadCounts.push_back(ChecksumManifest::GetProcessorCount());
+		}
+	}
+
+	// The first pass may read from disk and later ones from the page cache;
+	// run the thread counts twice, or drop caches, to compare like with like.
+	std::set<TsString> noFiles;
+	std::cout << manifest.GetFileCount() << " files, " << manifest.GetTotalSize() / (1024 * 1024) << " MB\n";
+	for (size_t i = 0; i < threadCounts.size(); i++) {
+		Clock::time_point start = Clock::now();
+		if (!manifest.Verify(databaseDir, threadCounts[i], noFiles, errorMsg)) {
+			std::cerr << errorMsg << "\n";
+			return 1;
+		}
+		double seconds = SecondsSince(start);
+		std::cout << threadCounts[i] << " threads: " << seconds << " sec, "
+			<< MBPerSec(manifest.GetTotalSize(), seconds) << " MB/s\n";
+	}
+	std::cout << "OK\n";
+	return 0;
+}
+
+static int TimeOpen(const std::string& tableDir, const std::string& databaseDir)
+{
+	struct ModeName {
+		Geocoder::VerifyMode mode;
+		const char* name;
+	} modes[] = {
+		{ Geocoder::VerifyNone, "none" },
+		{ Geocoder::VerifyLazy, "lazy" },
+		{ Geocoder::VerifyAtOpen, "at open" }
+	};
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		VerifyGeocoder geocoder(tableDir.c_str(), databaseDir.c_str());
+		geocoder.SetVerifyMode(modes[i].mode);
+		Clock::time_point start = Clock::now();
+		if (!geocoder.Open()) {
+			std::cerr << "Open failed with verify mode " << modes[i].name << "\n";
+			return 1;
+		}
+		std::cout << "Open, verify " << modes[i].name << ": " << SecondsSince(start) << " sec\n";
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 3 && strcmp(argv[1], "build") == 0) {
+		return Build(argv[2]);
+	}
+	if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+		std::vector<int> threadCounts;
+		for (int i = 3; i < argc; i++) {
+			threadCounts.push_back(atoi(argv[i]));
+		}
+		return Check(argv[2], threadCounts);
+	}
+	if (argc == 4 && strcmp(argv[1], "open") == 0) {
+		return TimeOpen(argv[2], argv[3]);
+	}
+	std::cerr <<
+		"Usage:\n"
+		"  " << argv[0] << " build <databaseDir>\n"
+		"      Write <databaseDir>/Checksums.txt\n"
+		"  " << argv[0] << " check <databaseDir> [threads...]\n"
+		"      Check every file against the manifest and report MB/s for each\n"
+		"      thread count (default: 1 and one per processor)\n"
+		"  " << argv[0] << " open <tableDir> <databaseDir>\n"
+		"      Time opening a Geocoder with each verify mode\n";
+	return 1;
+}
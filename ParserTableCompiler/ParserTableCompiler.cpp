@@ -0,0 +1,91 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// ParserTableCompiler.cpp: Offline compiler for the address parser tables.
+// Reads the CSV tables and XML pattern configuration in a table directory
+// and writes them to a single binary image (see global/ParserTableImage.h)
+// that the parsers load at Open() instead.
+
+#include <stdlib.h>
+#include <iostream>
+#include <xercesc/util/PlatformUtils.hpp>
+#include "../global/Global_Headers.h"
+#include "../global/ParserTableImage.h"
+#include "../global/AddressParserFirstLineImp.h"
+#include "../global/AddressParserLastLineImp.h"
+
+XERCES_CPP_NAMESPACE_USE
+
+using namespace PortfolioExplorer;
+
+int
+main(int argc, char *argv[])
+{
+	if (argc != 2) {
+		std::cerr << "Usage: " << argv[0] << " <table directory>" << std::endl;
+		return 1;
+	}
+	TsString tableDir(argv[1]);
+
+	try {
+		XMLPlatformUtils::Initialize();
+	} catch (const XMLException&) {
+		std::cerr << "Xerces XML initialization failed" << std::endl;
+		return 1;
+	}
+
+	// Open every parser configuration once, recording each table it loads.
+	ParserTableImageRef image = new ParserTableImage;
+	image->Record(tableDir);
+	TsString errorMsg;
+	int result = 0;
+
+	refcnt_ptr<AddressParserLastLineImp> lastLine = new AddressParserLastLineImp;
+	refcnt_ptr<AddressParserFirstLineImp> firstLine = new AddressParserFirstLineImp;
+	if (
+		!lastLine->Open(tableDir, errorMsg, image) ||
+		!firstLine->Open(tableDir, errorMsg, image)
+	) {
+		std::cerr << "Cannot load parser tables: " << errorMsg << std::endl;
+		result = 1;
+	} else {
+		// The Puerto Rico tables are optional.
+		refcnt_ptr<AddressParserFirstLineImp> firstLinePr = new AddressParserFirstLineImp;
+		firstLinePr->SetForPuertoRico(true);
+		if (!firstLinePr->Open(tableDir, errorMsg, image)) {
+			std::cerr << "Puerto Rico tables not compiled: " << errorMsg << std::endl;
+		}
+
+		TsString imageFile = tableDir + "/" + ParserTableImage::FileName;
+		if (!image->Write(imageFile, errorMsg)) {
+			std::cerr << errorMsg << std::endl;
+			result = 1;
+		} else {
+			std::cout << "Wrote " << imageFile << std::endl;
+		}
+	}
+
+	lastLine = 0;
+	firstLine = 0;
+	XMLPlatformUtils::Terminate();
+	return result;
+}
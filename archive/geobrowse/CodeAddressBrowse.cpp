@@ -84,6 +84,9 @@ void CCodeAddressBrowse::Initialize()
 	Registry::GetString("HKEY_LOCAL_MACHINE\\Software\\DataLever\\geobrowse\\TableDirectory", tableDir);
 	Registry::GetString("HKEY_LOCAL_MACHINE\\Software\\DataLever\\geobrowse\\DatabaseDirectory", databaseDir);
 	geocoder = new Geocoder_Notify(tableDir, databaseDir);
+#ifndef NDEBUG
+	geocoder->SetTrace(true);
+#endif
 	if (!geocoder->Open()) {
 		AfxMessageBox("Cannot open geocoder");
 	}
@@ -0,0 +1,503 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoDelta.cpp: Overlay of added, changed and deleted reference records.
+
+#ifdef WIN32
+#pragma warning(disable:4786)
+#endif
+
+#include "../geocommon/Geocoder_Headers.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "GeoDelta.h"
+#include "../global/Utility.h"
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////
+	// Copy a field into a fixed-size character array.
+	// Return value:
+	//	bool	false if the field does not fit.
+	///////////////////////////////////////////////////////////////////////
+	static bool CopyField(char* dest, size_t destSize, const TsString& field)
+	{
+		if (field.size() >= destSize) {
+			return false;
+		}
+		strcpy(dest, field.c_str());
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Scan a coordinate in degrees, rounded the same way as the loaders
+	// round the base Coordinate table.
+	///////////////////////////////////////////////////////////////////////
+	static bool ScanDegrees(const TsString& field, double& retval)
+	{
+		char* end;
+		double value = strtod(field.c_str(), &end);
+		if (field.empty() || *end != 0) {
+			return false;
+		}
+		int scaled = int(value * 100000.0 + (value < 0 ? -0.5 : 0.5));
+		retval = (double)scaled / 100000.0;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Ordering of soundex entries: FA, then soundex, then StreetName ID.
+	///////////////////////////////////////////////////////////////////////
+	bool GeoDelta::StreetNameSoundexEntry::operator<(const StreetNameSoundexEntry& rhs) const
+	{
+		int cmp = strcmp(financeNumber, rhs.financeNumber);
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		cmp = strcmp(streetSoundex, rhs.streetSoundex);
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		return streetNameID < rhs.streetNameID;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Constructor
+	///////////////////////////////////////////////////////////////////////
+	GeoDelta::GeoDelta() :
+		streetNameCount(0),
+		streetSegmentCount(0),
+		coordinateCount(0)
+	{}
+
+	///////////////////////////////////////////////////////////////////////
+	// Destructor
+	///////////////////////////////////////////////////////////////////////
+	GeoDelta::~GeoDelta()
+	{}
+
+	///////////////////////////////////////////////////////////////////////
+	// Load the delta from a file and check it against the base tables.
+	// Inputs:
+	//	const TsString&	filename				Path to the delta file
+	//	unsigned		streetNameBaseCount		Number of base StreetName records
+	//	unsigned		streetSegmentBaseCount	Number of base StreetSegment records
+	//	unsigned		coordinateBaseCount		Number of base Coordinate records
+	// Outputs:
+	//	TsString&		errorMsg				If false is returned, this is the error message.
+	// Return value:
+	//	bool		true on success, false on error.
+	///////////////////////////////////////////////////////////////////////
+	bool GeoDelta::LoadFromFile(
+		const TsString& filename,
+		unsigned streetNameBaseCount,
+		unsigned streetSegmentBaseCount,
+		unsigned coordinateBaseCount,
+		TsString& errorMsg
+	) {
+		errorMsg = "";
+		std::ifstream fs(filename.c_str());
+		if (fs.fail()) {
+			errorMsg = "Cannot open delta file '" + filename + "'";
+			return false;
+		}
+
+		bool haveHeader = false;
+		int lineNumber = 0;
+		std::string line;
+		std::vector<TsString> fields;
+		while (std::getline(fs, line)) {
+			lineNumber++;
+			if (!line.empty() && line[line.size() - 1] == '\r') {
+				line.erase(line.size() - 1);
+			}
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+
+			// Split into tab-separated fields.
+			fields.clear();
+			std::string::size_type start = 0;
+			while (true) {
+				std::string::size_type tab = line.find('\t', start);
+				if (tab == std::string::npos) {
+					fields.push_back(line.substr(start).c_str());
+					break;
+				}
+				fields.push_back(line.substr(start, tab - start).c_str());
+				start = tab + 1;
+			}
+
+			if (!haveHeader) {
+				int version;
+				if (fields.size() != 2 || fields[0] != "GEODELTA" || !ScanInteger(fields[1].c_str(), version)) {
+					errorMsg = "Delta file '" + filename + "' does not start with a GEODELTA header";
+					return false;
+				}
+				if (version != Version) {
+					errorMsg = "Delta file '" + filename + "' has version " + FormatInteger(version) +
+						", expected " + FormatInteger(int(Version));
+					return false;
+				}
+				haveHeader = true;
+				continue;
+			}
+
+			if (!ParseLine(fields, errorMsg)) {
+				errorMsg = "Error on line " + FormatInteger(lineNumber) + " of delta file '" + filename + "': " + errorMsg;
+				return false;
+			}
+		}
+
+		if (!haveHeader) {
+			errorMsg = "Delta file '" + filename + "' does not start with a GEODELTA header";
+			return false;
+		}
+
+		std::sort(streetNameSoundex.begin(), streetNameSoundex.end());
+
+		if (!Validate(streetNameBaseCount, streetSegmentBaseCount, coordinateBaseCount, errorMsg)) {
+			errorMsg = "Delta file '" + filename + "': " + errorMsg;
+			return false;
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Parse one record line that has been split into fields.
+	///////////////////////////////////////////////////////////////////////
+	bool GeoDelta::ParseLine(
+		const std::vector<TsString>& fields,
+		TsString& errorMsg
+	) {
+		if (fields.size() < 3 || fields[1].size() != 1) {
+			errorMsg = "expected record type, operation and ID";
+			return false;
+		}
+		const TsString& table = fields[0];
+		char op = fields[1][0];
+		if (op != 'A' && op != 'C' && op != 'D') {
+			errorMsg = "unknown operation '" + fields[1] + "'";
+			return false;
+		}
+
+		if (table == "STREET_NAME_SOUNDEX") {
+			StreetNameSoundexEntry entry;
+			if (
+				op == 'C' ||
+				fields.size() != 5 ||
+				!CopyField(entry.financeNumber, sizeof(entry.financeNumber), fields[2]) ||
+				fields[3].size() != 4 ||
+				!CopyField(entry.streetSoundex, sizeof(entry.streetSoundex), fields[3]) ||
+				!ScanInteger(fields[4].c_str(), entry.streetNameID)
+			) {
+				errorMsg = "bad STREET_NAME_SOUNDEX record";
+				return false;
+			}
+			if (op == 'A') {
+				streetNameSoundex.push_back(entry);
+			} else {
+				deletedStreetNameSoundex.insert(entry);
+			}
+			return true;
+		}
+
+		int ID;
+		if (!ScanInteger(fields[2].c_str(), ID) || ID < 0) {
+			errorMsg = "bad record ID '" + fields[2] + "'";
+			return false;
+		}
+
+		if (table == "STREET_NAME") {
+			if (op == 'D') {
+				deletedStreetNames.insert(ID);
+				return true;
+			}
+			StreetName streetName;
+			memset(&streetName, 0, sizeof(streetName));
+			streetName.ID = ID;
+			if (
+				fields.size() != 11 ||
+				!ScanInteger(fields[3].c_str(), streetName.cityStatePostcodeID) ||
+				!CopyField(streetName.prefix, sizeof(streetName.prefix), fields[4]) ||
+				!CopyField(streetName.predir, sizeof(streetName.predir), fields[5]) ||
+				!CopyField(streetName.street, sizeof(streetName.street), fields[6]) ||
+				!CopyField(streetName.suffix, sizeof(streetName.suffix), fields[7]) ||
+				!CopyField(streetName.postdir, sizeof(streetName.postdir), fields[8]) ||
+				!ScanInteger(fields[9].c_str(), streetName.streetSegmentIDFirst) ||
+				!ScanInteger(fields[10].c_str(), streetName.streetSegmentCount)
+			) {
+				errorMsg = "bad STREET_NAME record";
+				return false;
+			}
+			streetNames[ID] = streetName;
+		} else if (table == "STREET_SEGMENT") {
+			if (op == 'D') {
+				deletedStreetSegments.insert(ID);
+				return true;
+			}
+			StreetSegment streetSegment;
+			memset(&streetSegment, 0, sizeof(streetSegment));
+			streetSegment.ID = ID;
+			int countyCode;
+			if (
+				fields.size() != 12 ||
+				!CopyField(streetSegment.addrLow, sizeof(streetSegment.addrLow), fields[3]) ||
+				!CopyField(streetSegment.addrHigh, sizeof(streetSegment.addrHigh), fields[4]) ||
+				fields[5].empty() ||
+				!ScanInteger(fields[6].c_str(), countyCode) ||
+				!CopyField(streetSegment.censusTract, sizeof(streetSegment.censusTract), fields[7]) ||
+				!CopyField(streetSegment.censusBlock, sizeof(streetSegment.censusBlock), fields[8]) ||
+				!CopyField(streetSegment.postcodeExt, sizeof(streetSegment.postcodeExt), fields[9]) ||
+				!ScanInteger(fields[10].c_str(), streetSegment.coordinateID) ||
+				!ScanInteger(fields[11].c_str(), streetSegment.coordinateCount)
+			) {
+				errorMsg = "bad STREET_SEGMENT record";
+				return false;
+			}
+			// Same convention as the loader's LEFT_RIGHT field.
+			char c = fields[5][0];
+			streetSegment.isRightSide = (c != '0' && isdigit((unsigned char)c)) || c == 'T' || c == 't';
+			streetSegment.countyCode = (short)countyCode;
+			streetSegments[ID] = streetSegment;
+		} else if (table == "COORDINATE") {
+			if (op == 'D') {
+				deletedCoordinates.insert(ID);
+				return true;
+			}
+			CoordinatePoint coordinate;
+			if (
+				fields.size() != 5 ||
+				!ScanDegrees(fields[3], coordinate.latitude) ||
+				!ScanDegrees(fields[4], coordinate.longitude)
+			) {
+				errorMsg = "bad COORDINATE record";
+				return false;
+			}
+			coordinates[ID] = coordinate;
+		} else {
+			errorMsg = "unknown record type '" + table + "'";
+			return false;
+		}
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Check the ID ranges of one table.  Added IDs must continue the base
+	// table without gaps; changed and deleted IDs must be base records.
+	///////////////////////////////////////////////////////////////////////
+	template <class T> static bool ValidateTable(
+		const char* tableName,
+		const std::map<int, T>& records,
+		const std::set<int>& deleted,
+		unsigned baseCount,
+		unsigned& countReturn,
+		TsString& errorMsg
+	) {
+		countReturn = baseCount;
+		typename std::map<int, T>::const_iterator iter = records.lower_bound(int(baseCount));
+		for (; iter != records.end(); ++iter) {
+			if (unsigned(iter->first) != countReturn) {
+				errorMsg = TsString("added ") + tableName + " IDs must continue from " +
+					FormatInteger(countReturn) + " without gaps";
+				return false;
+			}
+			countReturn++;
+		}
+		if (!deleted.empty() && unsigned(*deleted.rbegin()) >= baseCount) {
+			errorMsg = TsString("cannot delete ") + tableName + " ID " +
+				FormatInteger(*deleted.rbegin()) + ", which is not in the base table";
+			return false;
+		}
+		{for (std::set<int>::const_iterator delIter = deleted.begin(); delIter != deleted.end(); ++delIter) {
+			if (records.find(*delIter) != records.end()) {
+				errorMsg = TsString(tableName) + " ID " + FormatInteger(*delIter) + " is both changed and deleted";
+				return false;
+			}
+		}}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Check ID ranges against the base tables after loading.
+	///////////////////////////////////////////////////////////////////////
+	bool GeoDelta::Validate(
+		unsigned streetNameBaseCount,
+		unsigned streetSegmentBaseCount,
+		unsigned coordinateBaseCount,
+		TsString& errorMsg
+	) {
+		if (
+			!ValidateTable("StreetName", streetNames, deletedStreetNames, streetNameBaseCount, streetNameCount, errorMsg) ||
+			!ValidateTable("StreetSegment", streetSegments, deletedStreetSegments, streetSegmentBaseCount, streetSegmentCount, errorMsg) ||
+			!ValidateTable("Coordinate", coordinates, deletedCoordinates, coordinateBaseCount, coordinateCount, errorMsg)
+		) {
+			return false;
+		}
+
+		// Child ranges must lie within the tables.
+		{for (std::map<int, StreetName>::const_iterator iter = streetNames.begin(); iter != streetNames.end(); ++iter) {
+			const StreetName& streetName = iter->second;
+			if (
+				streetName.streetSegmentIDFirst < 0 ||
+				streetName.streetSegmentCount < 0 ||
+				unsigned(streetName.streetSegmentIDFirst + streetName.streetSegmentCount) > streetSegmentCount
+			) {
+				errorMsg = "StreetName ID " + FormatInteger(iter->first) + " refers to StreetSegment records that do not exist";
+				return false;
+			}
+		}}
+		{for (std::map<int, StreetSegment>::const_iterator iter = streetSegments.begin(); iter != streetSegments.end(); ++iter) {
+			const StreetSegment& streetSegment = iter->second;
+			if (
+				streetSegment.coordinateID < 0 ||
+				streetSegment.coordinateCount < 0 ||
+				unsigned(streetSegment.coordinateID + streetSegment.coordinateCount) > coordinateCount
+			) {
+				errorMsg = "StreetSegment ID " + FormatInteger(iter->first) + " refers to Coordinate records that do not exist";
+				return false;
+			}
+		}}
+		{for (unsigned i = 0; i < streetNameSoundex.size(); i++) {
+			if (streetNameSoundex[i].streetNameID < 0 || unsigned(streetNameSoundex[i].streetNameID) >= streetNameCount) {
+				errorMsg = "StreetNameSoundex entry refers to StreetName ID " +
+					FormatInteger(streetNameSoundex[i].streetNameID) + ", which does not exist";
+				return false;
+			}
+		}}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Look up a StreetName record.
+	///////////////////////////////////////////////////////////////////////
+	GeoDelta::Status GeoDelta::FindStreetName(
+		int streetNameID,
+		StreetName& streetNameReturn
+	) const {
+		std::map<int, StreetName>::const_iterator iter = streetNames.find(streetNameID);
+		if (iter != streetNames.end()) {
+			streetNameReturn = iter->second;
+			return Replaced;
+		}
+		return IsStreetNameDeleted(streetNameID) ? Deleted : NotInDelta;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Look up a StreetSegment record.
+	///////////////////////////////////////////////////////////////////////
+	GeoDelta::Status GeoDelta::FindStreetSegment(
+		int streetSegmentID,
+		StreetSegment& streetSegmentReturn
+	) const {
+		std::map<int, StreetSegment>::const_iterator iter = streetSegments.find(streetSegmentID);
+		if (iter != streetSegments.end()) {
+			streetSegmentReturn = iter->second;
+			return Replaced;
+		}
+		return IsStreetSegmentDeleted(streetSegmentID) ? Deleted : NotInDelta;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Look up a Coordinate record.
+	///////////////////////////////////////////////////////////////////////
+	GeoDelta::Status GeoDelta::FindCoordinate(
+		int coordinateID,
+		CoordinatePoint& coordinateReturn
+	) const {
+		std::map<int, CoordinatePoint>::const_iterator iter = coordinates.find(coordinateID);
+		if (iter != coordinates.end()) {
+			coordinateReturn = iter->second;
+			return Replaced;
+		}
+		return IsCoordinateDeleted(coordinateID) ? Deleted : NotInDelta;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Has a base StreetNameSoundex entry been deleted?
+	///////////////////////////////////////////////////////////////////////
+	bool GeoDelta::IsStreetNameSoundexDeleted(
+		const char* financeNumber,
+		const char* streetSoundex,
+		int streetNameID
+	) const {
+		if (deletedStreetNameSoundex.empty()) {
+			return false;
+		}
+		StreetNameSoundexEntry entry;
+		if (
+			!CopyField(entry.financeNumber, sizeof(entry.financeNumber), financeNumber) ||
+			!CopyField(entry.streetSoundex, sizeof(entry.streetSoundex), streetSoundex)
+		) {
+			return false;
+		}
+		entry.streetNameID = streetNameID;
+		return deletedStreetNameSoundex.find(entry) != deletedStreetNameSoundex.end();
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Find the first added StreetNameSoundex entry for an FA and soundex.
+	// Return value:
+	//	int		Index of the entry, or -1 if there are none.
+	///////////////////////////////////////////////////////////////////////
+	int GeoDelta::FindStreetNameSoundex(
+		const char* financeNumber,
+		const char* streetSoundex
+	) const {
+		StreetNameSoundexEntry key;
+		if (
+			!CopyField(key.financeNumber, sizeof(key.financeNumber), financeNumber) ||
+			!CopyField(key.streetSoundex, sizeof(key.streetSoundex), streetSoundex)
+		) {
+			return -1;
+		}
+		key.streetNameID = INT_MIN;
+		std::vector<StreetNameSoundexEntry>::const_iterator iter =
+			std::lower_bound(streetNameSoundex.begin(), streetNameSoundex.end(), key);
+		if (
+			iter == streetNameSoundex.end() ||
+			strcmp(iter->financeNumber, financeNumber) != 0 ||
+			strcmp(iter->streetSoundex, streetSoundex) != 0
+		) {
+			return -1;
+		}
+		return int(iter - streetNameSoundex.begin());
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Number of records of all kinds in the delta.
+	///////////////////////////////////////////////////////////////////////
+	int GeoDelta::GetRecordCount() const
+	{
+		return int(
+			streetNames.size() + streetSegments.size() + coordinates.size() +
+			deletedStreetNames.size() + deletedStreetSegments.size() + deletedCoordinates.size() +
+			streetNameSoundex.size() + deletedStreetNameSoundex.size()
+		);
+	}
+
+}
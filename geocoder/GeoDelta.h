@@ -0,0 +1,204 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoDelta.h: Overlay of added, changed and deleted reference records
+// that is consulted before the compressed database files.
+//
+// The delta is a tab-separated text file (GeoUtil::DELTA_FILE) in the
+// database directory.  The first non-comment line is "GEODELTA <version>".
+// Each following line is one of:
+//
+//	STREET_NAME		A|C	ID	CITY_STATE_POSTCODE_ID	PREFIX	PREDIR	NAME	SUFFIX	POSTDIR	STREET_SEGMENT_ID_FIRST	STREET_SEGMENT_COUNT
+//	STREET_SEGMENT	A|C	ID	ADDR_LOW	ADDR_HIGH	LEFT_RIGHT	COUNTY	CENSUS_TRACT	CENSUS_BLOCK	POSTCODE_EXT	COORDINATE_ID	COORDINATE_COUNT
+//	COORDINATE		A|C	ID	LATITUDE	LONGITUDE
+//	STREET_NAME|STREET_SEGMENT|COORDINATE	D	ID
+//	STREET_NAME_SOUNDEX	A|D	FINANCE_NUMBER	STREET_SOUNDEX	STREET_NAME_ID
+//
+// A = add, C = change, D = delete.  A and C both set the record; an ID past
+// the end of the base table is an addition.  Added records are appended to
+// the ID space, so their IDs must continue contiguously from the end of the
+// base table.  Deleted records must exist in the base files.  Because
+// StreetName and StreetSegment refer to their children by ID range, a
+// changed child range must be re-added at the end of the child table;
+// for street names, see the restriction below.
+//
+// StreetIntersectionSoundex is not overlaid.  It locates each intersection's
+// segment by its offset from the street name's STREET_SEGMENT_ID_FIRST, so a
+// changed base street name must keep its STREET_SEGMENT_ID_FIRST and the
+// order of its segments; change or delete the segments in place instead.
+// To move a street's segments, delete the street name and add a new one;
+// the old street's intersections are then skipped, as are those of deleted
+// segments.  This is not checked, as the base records are not at hand when
+// the delta is loaded.
+//
+// Added street names are only found by address if they are also given a
+// STREET_NAME_SOUNDEX entry.  Lines starting with '#' are comments.
+
+#ifndef INCL_GEODELTA_H
+#define INCL_GEODELTA_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "../global/TsString.h"
+#include "../global/RefPtr.h"
+#include "GeoQueryItf.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace PortfolioExplorer {
+
+	class GeoDelta : public VRefCount {
+	public:
+		// Version of the delta file format.
+		enum { Version = 1 };
+
+		// Result of looking up a record in the delta.
+		enum Status {
+			NotInDelta,		// Use the base record
+			Replaced,		// Record was added or changed; use the returned value
+			Deleted			// Record was deleted
+		};
+
+		// StreetNameSoundex index entries added to the base index
+		struct StreetNameSoundexEntry {
+			char financeNumber[7];
+			char streetSoundex[5];
+			int streetNameID;
+			bool operator<(const StreetNameSoundexEntry& rhs) const;
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// Construction and destruction
+		///////////////////////////////////////////////////////////////////////
+		GeoDelta();
+		virtual ~GeoDelta();
+
+		///////////////////////////////////////////////////////////////////////
+		// Load the delta from a file and check it against the base tables.
+		// Inputs:
+		//	const TsString&	filename				Path to the delta file
+		//	unsigned		streetNameBaseCount		Number of base StreetName records
+		//	unsigned		streetSegmentBaseCount	Number of base StreetSegment records
+		//	unsigned		coordinateBaseCount		Number of base Coordinate records
+		// Outputs:
+		//	TsString&		errorMsg				If false is returned, this is the error message.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool LoadFromFile(
+			const TsString& filename,
+			unsigned streetNameBaseCount,
+			unsigned streetSegmentBaseCount,
+			unsigned coordinateBaseCount,
+			TsString& errorMsg
+		);
+
+		///////////////////////////////////////////////////////////////////////
+		// Record counts including records added by the delta.
+		///////////////////////////////////////////////////////////////////////
+		unsigned GetStreetNameCount() const { return streetNameCount; }
+		unsigned GetStreetSegmentCount() const { return streetSegmentCount; }
+		unsigned GetCoordinateCount() const { return coordinateCount; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Look up records by ID.
+		// Return value:
+		//	Status	NotInDelta, Replaced (the record is returned) or Deleted
+		///////////////////////////////////////////////////////////////////////
+		Status FindStreetName(int streetNameID, StreetName& streetNameReturn) const;
+		Status FindStreetSegment(int streetSegmentID, StreetSegment& streetSegmentReturn) const;
+		Status FindCoordinate(int coordinateID, CoordinatePoint& coordinateReturn) const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Deletion tests used by the iterators to skip deleted records.
+		///////////////////////////////////////////////////////////////////////
+		bool IsStreetNameDeleted(int streetNameID) const {
+			return !deletedStreetNames.empty() && deletedStreetNames.find(streetNameID) != deletedStreetNames.end();
+		}
+		bool IsStreetSegmentDeleted(int streetSegmentID) const {
+			return !deletedStreetSegments.empty() && deletedStreetSegments.find(streetSegmentID) != deletedStreetSegments.end();
+		}
+		bool IsCoordinateDeleted(int coordinateID) const {
+			return !deletedCoordinates.empty() && deletedCoordinates.find(coordinateID) != deletedCoordinates.end();
+		}
+		bool IsStreetNameSoundexDeleted(
+			const char* financeNumber,
+			const char* streetSoundex,
+			int streetNameID
+		) const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Added StreetNameSoundex entries, sorted by FA and soundex.
+		// FindStreetNameSoundex() returns the index of the first entry
+		// matching the FA and soundex, or -1 if there are none.
+		///////////////////////////////////////////////////////////////////////
+		int GetStreetNameSoundexCount() const { return int(streetNameSoundex.size()); }
+		const StreetNameSoundexEntry& GetStreetNameSoundex(int idx) const { return streetNameSoundex[idx]; }
+		int FindStreetNameSoundex(const char* financeNumber, const char* streetSoundex) const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Number of records of all kinds in the delta.
+		///////////////////////////////////////////////////////////////////////
+		int GetRecordCount() const;
+
+	private:
+		// Parse one record line that has been split into fields.
+		bool ParseLine(
+			const std::vector<TsString>& fields,
+			TsString& errorMsg
+		);
+
+		// Check ID ranges against the base tables after loading.
+		bool Validate(
+			unsigned streetNameBaseCount,
+			unsigned streetSegmentBaseCount,
+			unsigned coordinateBaseCount,
+			TsString& errorMsg
+		);
+
+		// Added and changed records, by ID
+		std::map<int, StreetName> streetNames;
+		std::map<int, StreetSegment> streetSegments;
+		std::map<int, CoordinatePoint> coordinates;
+
+		// Deleted records
+		std::set<int> deletedStreetNames;
+		std::set<int> deletedStreetSegments;
+		std::set<int> deletedCoordinates;
+
+		// Added and deleted soundex index entries
+		std::vector<StreetNameSoundexEntry> streetNameSoundex;
+		std::set<StreetNameSoundexEntry> deletedStreetNameSoundex;
+
+		// Counts including added records.
+		unsigned streetNameCount;
+		unsigned streetSegmentCount;
+		unsigned coordinateCount;
+	};
+	typedef refcnt_ptr<GeoDelta> GeoDeltaRef;
+
+}
+
+#endif
@@ -0,0 +1,312 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoProfiler.cpp: Per-phase timing and counters of Geocoder requests.
+
+#include "../geocommon/Geocoder_Headers.h"
+#include "GeoProfiler.h"
+#include <float.h>
+#include <string.h>
+
+#if !defined(WIN32)
+	#include <time.h>
+#endif
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////
+	// Names for reports, in the order of the enums.
+	///////////////////////////////////////////////////////////////////////
+	static const char* const phaseNames[Geocoder::NbrProfilePhases + 1] = {
+		"LastLineParse",
+		"ChooseLastLine",
+		"FirstLineParse",
+		"StreetNameFetch",
+		"SegmentScoring",
+		"SortResults",
+		"CodeResult",
+		"Other",
+		"Total"
+	};
+
+	static const char* const tableNames[Geocoder::NbrProfileTables] = {
+		"CityStatePostcode",
+		"CityStatePostcodeFaIndex",
+		"CitySoundex",
+		"StreetName",
+		"StreetNameSoundex",
+		"StreetSegment",
+		"Coordinate",
+		"StreetIntersectionSoundex",
+		"PostcodeAlias",
+		"PostcodeCentroid"
+	};
+
+	static const char* const cacheNames[Geocoder::NbrProfileCaches] = {
+		"CityStatePostcodeByID",
+		"CityStatePostcodeSoundexByID",
+		"CityStatePostcodeFaIndexByID",
+		"CityStatePostcodeFaIndexFromFa",
+		"StreetNameByID",
+		"StreetNameSoundexByID",
+		"StreetNameSoundexFaSoundex",
+		"StreetSegmentByID",
+		"CoordinateByID",
+		"StreetIntersectionSoundexByID",
+		"PostcodeAliasByPostcodeID",
+		"PostcodeAliasByGroupID",
+		"PostcodeGroupFromPostcode",
+		"PostcodeGroupIDFromPostcodeGroup",
+		"PostcodeCentroidByID",
+		"PostcodeCentroidFromPostcode"
+	};
+
+	const char* Geocoder::GetProfilePhaseName(int phase)
+	{
+		return (phase >= 0 && phase <= ProfileTotal) ? phaseNames[phase] : "";
+	}
+
+	const char* Geocoder::GetProfileTableName(int table)
+	{
+		return (table >= 0 && table < NbrProfileTables) ? tableNames[table] : "";
+	}
+
+	const char* Geocoder::GetProfileCacheName(int cache)
+	{
+		return (cache >= 0 && cache < NbrProfileCaches) ? cacheNames[cache] : "";
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// RequestStats
+	///////////////////////////////////////////////////////////////////////
+	void Geocoder::RequestStats::Clear()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void Geocoder::RequestStats::Add(const RequestStats& rhs)
+	{
+		{for (int i = 0; i < NbrProfilePhases; i++) {
+			phaseMicroseconds[i] += rhs.phaseMicroseconds[i];
+		}}
+		totalMicroseconds += rhs.totalMicroseconds;
+		{for (int i = 0; i < NbrProfileTables; i++) {
+			recordsDecoded[i] += rhs.recordsDecoded[i];
+		}}
+		{for (int i = 0; i < NbrProfileCaches; i++) {
+			cacheHits[i] += rhs.cacheHits[i];
+			cacheMisses[i] += rhs.cacheMisses[i];
+		}}
+		bitsDecoded += rhs.bitsDecoded;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// LatencyHistogram
+	///////////////////////////////////////////////////////////////////////
+	void Geocoder::LatencyHistogram::Clear()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void Geocoder::LatencyHistogram::Add(double microseconds)
+	{
+		int bucket = 0;
+		for (double limit = 1.0; bucket < NbrBuckets - 1 && microseconds >= limit; limit *= 2.0) {
+			bucket++;
+		}
+		counts[bucket]++;
+		nbrSamples++;
+		totalMicroseconds += microseconds;
+	}
+
+	double Geocoder::LatencyHistogram::BucketLimit(int bucket)
+	{
+		if (bucket >= NbrBuckets - 1) {
+			return DBL_MAX;
+		}
+		double limit = 1.0;
+		for (int i = 0; i < bucket; i++) {
+			limit *= 2.0;
+		}
+		return limit;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// The upper limit of the bucket holding the given fraction of the
+	// samples, or the lower limit if that is the last bucket.
+	///////////////////////////////////////////////////////////////////////
+	double Geocoder::LatencyHistogram::Percentile(double fraction) const
+	{
+		if (nbrSamples == 0) {
+			return 0.0;
+		}
+		double wanted = fraction * nbrSamples;
+		long sum = 0;
+		for (int i = 0; i < NbrBuckets - 1; i++) {
+			sum += counts[i];
+			if (sum >= wanted) {
+				return BucketLimit(i);
+			}
+		}
+		return BucketLimit(NbrBuckets - 2);
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// GeoProfiler
+	///////////////////////////////////////////////////////////////////////
+	GeoProfiler::GeoProfiler() :
+		enabled(false),
+		requestOpen(false),
+		currentPhase(NoPhase),
+		phaseStart(0),
+		haveLast(false),
+		nbrRequests(0)
+	{
+		memset(phaseEntered, 0, sizeof(phaseEntered));
+	}
+
+	double GeoProfiler::Now()
+	{
+	#if defined(WIN32)
+		static double ticksPerMicrosecond = 0;
+		LARGE_INTEGER count;
+		if (ticksPerMicrosecond == 0) {
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			ticksPerMicrosecond = (double)frequency.QuadPart / 1e6;
+		}
+		QueryPerformanceCounter(&count);
+		return (double)count.QuadPart / ticksPerMicrosecond;
+	#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+	#endif
+	}
+
+	void GeoProfiler::Enter(int phase)
+	{
+		if (!enabled || !requestOpen) {
+			return;
+		}
+		double now = Now();
+		if (currentPhase != NoPhase) {
+			current.phaseMicroseconds[currentPhase] += now - phaseStart;
+		}
+		if (phase != NoPhase) {
+			phaseEntered[phase] = true;
+		}
+		currentPhase = phase;
+		phaseStart = now;
+	}
+
+	void GeoProfiler::SetEnabled(bool enabled_)
+	{
+		enabled = enabled_;
+		requestOpen = false;
+		currentPhase = NoPhase;
+	}
+
+	void GeoProfiler::BeginRequest(const Geocoder::RequestStats& counters)
+	{
+		if (requestOpen) {
+			EndRequest(counters);
+		}
+		current.Clear();
+		memset(phaseEntered, 0, sizeof(phaseEntered));
+		startCounters = counters;
+		currentPhase = NoPhase;
+		requestOpen = true;
+	}
+
+	void GeoProfiler::EndRequest(const Geocoder::RequestStats& counters)
+	{
+		if (!requestOpen) {
+			return;
+		}
+		// Charge a phase still running.
+		if (currentPhase != NoPhase) {
+			double now = Now();
+			current.phaseMicroseconds[currentPhase] += now - phaseStart;
+			phaseStart = now;
+		}
+		requestOpen = false;
+
+		{for (int i = 0; i < Geocoder::NbrProfileTables; i++) {
+			current.recordsDecoded[i] = counters.recordsDecoded[i] - startCounters.recordsDecoded[i];
+		}}
+		{for (int i = 0; i < Geocoder::NbrProfileCaches; i++) {
+			current.cacheHits[i] = counters.cacheHits[i] - startCounters.cacheHits[i];
+			current.cacheMisses[i] = counters.cacheMisses[i] - startCounters.cacheMisses[i];
+		}}
+		current.bitsDecoded = counters.bitsDecoded - startCounters.bitsDecoded;
+		current.totalMicroseconds = 0;
+		{for (int i = 0; i < Geocoder::NbrProfilePhases; i++) {
+			current.totalMicroseconds += current.phaseMicroseconds[i];
+			if (phaseEntered[i]) {
+				histograms[i].Add(current.phaseMicroseconds[i]);
+			}
+		}}
+		histograms[Geocoder::ProfileTotal].Add(current.totalMicroseconds);
+
+		last = current;
+		haveLast = true;
+		totals.Add(current);
+		nbrRequests++;
+	}
+
+	bool GeoProfiler::GetRequestStats(Geocoder::RequestStats& statsReturn) const
+	{
+		if (!haveLast) {
+			statsReturn.Clear();
+			return false;
+		}
+		statsReturn = last;
+		return true;
+	}
+
+	void GeoProfiler::GetTotals(Geocoder::RequestStats& totalsReturn, long& nbrRequestsReturn) const
+	{
+		totalsReturn = totals;
+		nbrRequestsReturn = nbrRequests;
+	}
+
+	bool GeoProfiler::GetLatencyHistogram(int phase, Geocoder::LatencyHistogram& histogramReturn) const
+	{
+		if (phase < 0 || phase > Geocoder::ProfileTotal) {
+			histogramReturn.Clear();
+			return false;
+		}
+		histogramReturn = histograms[phase];
+		return true;
+	}
+
+	void GeoProfiler::Reset()
+	{
+		totals.Clear();
+		nbrRequests = 0;
+		{for (int i = 0; i <= Geocoder::ProfileTotal; i++) {
+			histograms[i].Clear();
+		}}
+	}
+
+}
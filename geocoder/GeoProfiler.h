@@ -0,0 +1,144 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoProfiler.h: Per-phase timing and counters of the requests made to
+// a Geocoder.
+//
+// The time of a request is charged to one phase at a time.  Entering a
+// phase (with a Scope) charges the time since the last change to the
+// phase that was running, so nested phases are not counted twice.  The
+// record, cache and bit counters are kept by QueryImp for its lifetime;
+// the profiler takes the difference between their values at the start
+// and end of the request.
+
+#ifndef INCL_GEOPROFILER_H
+#define INCL_GEOPROFILER_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "Geocoder.h"
+
+namespace PortfolioExplorer {
+
+	class GeoProfiler {
+	public:
+		GeoProfiler();
+
+		///////////////////////////////////////////////////////////////////////
+		// Enter a phase for the life of the object, then go back to the
+		// phase that was running.  Does nothing unless profiling is on.
+		///////////////////////////////////////////////////////////////////////
+		class Scope {
+		public:
+			Scope(GeoProfiler& profiler_, Geocoder::ProfilePhase phase) :
+				profiler(profiler_),
+				active(profiler_.enabled)
+			{
+				if (active) {
+					prevPhase = profiler.currentPhase;
+					profiler.Enter(phase);
+				}
+			}
+			~Scope() {
+				if (active) {
+					profiler.Enter(prevPhase);
+				}
+			}
+		private:
+			Scope(const Scope&);
+			Scope& operator=(const Scope&);
+			GeoProfiler& profiler;
+			bool active;
+			int prevPhase;
+		};
+		friend class Scope;
+
+		///////////////////////////////////////////////////////////////////////
+		// Turn profiling on or off.  Turning it off drops the open request.
+		///////////////////////////////////////////////////////////////////////
+		void SetEnabled(bool enabled_);
+		bool IsEnabled() const { return enabled; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Start a request, ending the open one.
+		// Inputs:
+		//	const Geocoder::RequestStats&	counters	QueryImp's counters now
+		///////////////////////////////////////////////////////////////////////
+		void BeginRequest(const Geocoder::RequestStats& counters);
+
+		///////////////////////////////////////////////////////////////////////
+		// End the open request: keep its stats and add them to the totals
+		// and histograms.
+		// Inputs:
+		//	const Geocoder::RequestStats&	counters	QueryImp's counters now
+		///////////////////////////////////////////////////////////////////////
+		void EndRequest(const Geocoder::RequestStats& counters);
+		bool IsRequestOpen() const { return requestOpen; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Results of the ended requests.
+		///////////////////////////////////////////////////////////////////////
+		bool GetRequestStats(Geocoder::RequestStats& statsReturn) const;
+		void GetTotals(Geocoder::RequestStats& totalsReturn, long& nbrRequestsReturn) const;
+		bool GetLatencyHistogram(int phase, Geocoder::LatencyHistogram& histogramReturn) const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Clear the totals and histograms.
+		///////////////////////////////////////////////////////////////////////
+		void Reset();
+
+	private:
+		enum { NoPhase = -1 };
+
+		// Charge the time since the last change to the running phase, and
+		// make the given phase the running one.
+		void Enter(int phase);
+
+		// Monotonic clock, in microseconds.
+		static double Now();
+
+		bool enabled;
+		bool requestOpen;
+		int currentPhase;
+		double phaseStart;
+
+		// The open request: its times so far, which phases it has
+		// entered, and the counters at its start.
+		Geocoder::RequestStats current;
+		bool phaseEntered[Geocoder::NbrProfilePhases];
+		Geocoder::RequestStats startCounters;
+
+		// The latest ended request
+		Geocoder::RequestStats last;
+		bool haveLast;
+
+		// Sums over the ended requests since Reset()
+		Geocoder::RequestStats totals;
+		long nbrRequests;
+		Geocoder::LatencyHistogram histograms[Geocoder::NbrProfilePhases + 1];
+	};
+
+}
+
+#endif
@@ -32,8 +32,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fstream>
 #include "GeoQueryImp.h"
 #include "../geocommon/GeoUtil.h"
+#include "../global/Utility.h"
 #include <algorithm>
 #include <stdlib.h>
+#include <string.h>
 
 namespace PortfolioExplorer {
 
@@ -52,8 +54,14 @@ namespace PortfolioExplorer {
 		isOpen(false),
 		databaseDir(databaseDir_),
 		tableDir(tableDir_),
+		verifyMode(Geocoder::VerifyNone),
+		verifyThreads(0),
+		packedData(false),
+		packedBitsRead(0),
 		memUse(memUse_)
-	{}
+	{
+		memset(recordsDecoded, 0, sizeof(recordsDecoded));
+	}
 
 	///////////////////////////////////////////////////////////////////////////
 	// Destructor
@@ -86,137 +94,188 @@ namespace PortfolioExplorer {
 			return false;
 		}
 
-		// Read all of the Huffman-coder frequency table files
-		// and initialize the associated Huffman coders.
-
-		// This is for integer coders
-		struct IntCoderFiledef {
-			IntCoderFiledef(
-				HuffmanCoder<int, std::less<int> >& coder_,
-				const char* filename_
-			) : coder(coder_), filename(filename_)
-			{}
-			HuffmanCoder<int, std::less<int> >& coder;
-			TsString filename;
-		} intCoderFiledefs[] = {
-			// StreetName
-			IntCoderFiledef(streetNameCityStatePostcodeIDCoder,STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE),
-			IntCoderFiledef(streetNameNameCoder,STREET_NAME_NAME_HUFF_FILE),
-			IntCoderFiledef(streetNameStreetSegmentIDFirstCoder,STREET_NAME_STREET_SEGMENT_ID_FIRST_HUFF_FILE),
-			IntCoderFiledef(streetNameStreetSegmentCountCoder,STREET_NAME_STREET_SEGMENT_COUNT_HUFF_FILE),
-			// StreetSegment
-			IntCoderFiledef(streetSegmentAddrLowKeyCoder1, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentAddrLowKeyCoder2, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentAddrLowNonkeyCoder1, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentAddrLowNonkeyCoder2, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentAddrHighCoder1, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentAddrHighCoder2, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentCountyKeyCoder, STREET_SEGMENT_COUNTY_KEY_HUFF_FILE),
-			IntCoderFiledef(streetSegmentCountyNonkeyCoder, STREET_SEGMENT_COUNTY_NONKEY_HUFF_FILE),
-			IntCoderFiledef(streetSegmentCensusTractKeyCoder1, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentCensusTractKeyCoder2, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentCensusTractNonkeyCoder1, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentCensusTractNonkeyCoder2, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentCensusBlockKeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentCensusBlockKeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentCensusBlockNonkeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentCensusBlockNonkeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentPostcodeExtKeyCoder, STREET_SEGMENT_POSTCODE_EXT_KEY_HUFF_FILE),
-			IntCoderFiledef(streetSegmentPostcodeExtNonkeyCoder, STREET_SEGMENT_POSTCODE_EXT_NONKEY_HUFF_FILE),
-			IntCoderFiledef(streetSegmentCoordinateIDCoder1, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE1),
-			IntCoderFiledef(streetSegmentCoordinateIDCoder2, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE2),
-			IntCoderFiledef(streetSegmentCoordinateCountCoder, STREET_SEGMENT_COORDINATE_COUNT_HUFF_FILE),
-			// Coordinate
-			IntCoderFiledef(coordinateLatitudeCoder1, COORDINATE_LATITUDE_HUFF_FILE1),
-			IntCoderFiledef(coordinateLatitudeCoder2, COORDINATE_LATITUDE_HUFF_FILE2),
-			IntCoderFiledef(coordinateLongitudeCoder1, COORDINATE_LONGITUDE_HUFF_FILE1),
-			IntCoderFiledef(coordinateLongitudeCoder2, COORDINATE_LONGITUDE_HUFF_FILE2),
-			// StreetIntersection
-			IntCoderFiledef(streetIntersectionStateCoder, STREET_INTERSECTION_STATE_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionSoundex1Coder, STREET_INTERSECTION_SOUNDEX1_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionStreetNameID1Coder,STREET_INTERSECTION_STREET_NAME_ID1_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionStreetSegmentOffset1Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET1_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionSoundex2Coder, STREET_INTERSECTION_SOUNDEX2_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionStreetNameID2Coder, STREET_INTERSECTION_STREET_NAME_ID2_HUFF_FILE),
-			IntCoderFiledef(streetIntersectionStreetSegmentOffset2Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET2_HUFF_FILE)
-		};
+		// Check the files before anything is decoded from them.
+		if (!LoadChecksums()) {
+			return false;
+		}
 
-		for (
-			unsigned int intCoderIdx = 0; 
-			intCoderIdx < sizeof(intCoderFiledefs)/sizeof(intCoderFiledefs[0]); 
-			intCoderIdx++
-		) {
-			std::fstream fs;
-			TsString filename = databaseDir + "/" + intCoderFiledefs[intCoderIdx].filename;
-			fs.open(filename.c_str(), std::ios_base::in);
-			FreqTable<int> freqTable;
-			if (fs.fail() || !freqTable.Load(fs)) {
-				ErrorMessage("Cannot load huffman frequency table " + filename);
-				return false;
+		// Packed databases hold the StreetName, StreetSegment and Coordinate
+		// tables in packed files instead of Huffman-coded ones.
+		packedData = IsPackedDatabase();
+
+		// Read all of the Huffman code tables and initialize the associated
+		// Huffman coders.  Current databases hold canonical code-length tables;
+		// older ones hold frequency tables from which the original code tree
+		// is rebuilt.  Coders for packed tables are skipped in packed databases.
+		// Coders shared with other query objects are read only by the first
+		// to open.
+		coders = sharedCoders != 0 ? sharedCoders : new QueryCoders;
+		if (!coders->loaded) {
+			// This is for integer coders
+			struct IntCoderFiledef {
+				IntCoderFiledef(
+					HuffmanCoder<int, std::less<int> >& coder_,
+					const char* filename_,
+					bool inPackedTable_ = false
+				) : coder(coder_), filename(filename_), inPackedTable(inPackedTable_)
+				{}
+				HuffmanCoder<int, std::less<int> >& coder;
+				TsString filename;
+				bool inPackedTable;
+			} intCoderFiledefs[] = {
+				// StreetName
+				IntCoderFiledef(coders->streetNameCityStatePostcodeIDCoder, STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetNameNameCoder, STREET_NAME_NAME_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetNameStreetSegmentIDFirstCoder, STREET_NAME_STREET_SEGMENT_ID_FIRST_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetNameStreetSegmentCountCoder, STREET_NAME_STREET_SEGMENT_COUNT_HUFF_FILE, true),
+				// StreetSegment
+				IntCoderFiledef(coders->streetSegmentAddrLowKeyCoder1, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentAddrLowKeyCoder2, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentAddrLowNonkeyCoder1, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentAddrLowNonkeyCoder2, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentAddrHighCoder1, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentAddrHighCoder2, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentCountyKeyCoder, STREET_SEGMENT_COUNTY_KEY_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetSegmentCountyNonkeyCoder, STREET_SEGMENT_COUNTY_NONKEY_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetSegmentCensusTractKeyCoder1, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentCensusTractKeyCoder2, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentCensusTractNonkeyCoder1, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentCensusTractNonkeyCoder2, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentCensusBlockKeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentCensusBlockKeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentCensusBlockNonkeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentCensusBlockNonkeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentPostcodeExtKeyCoder, STREET_SEGMENT_POSTCODE_EXT_KEY_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetSegmentPostcodeExtNonkeyCoder, STREET_SEGMENT_POSTCODE_EXT_NONKEY_HUFF_FILE, true),
+				IntCoderFiledef(coders->streetSegmentCoordinateIDCoder1, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE1, true),
+				IntCoderFiledef(coders->streetSegmentCoordinateIDCoder2, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE2, true),
+				IntCoderFiledef(coders->streetSegmentCoordinateCountCoder, STREET_SEGMENT_COORDINATE_COUNT_HUFF_FILE, true),
+				// Coordinate
+				IntCoderFiledef(coders->coordinateLatitudeCoder1, COORDINATE_LATITUDE_HUFF_FILE1, true),
+				IntCoderFiledef(coders->coordinateLatitudeCoder2, COORDINATE_LATITUDE_HUFF_FILE2, true),
+				IntCoderFiledef(coders->coordinateLongitudeCoder1, COORDINATE_LONGITUDE_HUFF_FILE1, true),
+				IntCoderFiledef(coders->coordinateLongitudeCoder2, COORDINATE_LONGITUDE_HUFF_FILE2, true),
+				// StreetIntersection
+				IntCoderFiledef(coders->streetIntersectionStateCoder, STREET_INTERSECTION_STATE_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionSoundex1Coder, STREET_INTERSECTION_SOUNDEX1_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionStreetNameID1Coder,STREET_INTERSECTION_STREET_NAME_ID1_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionStreetSegmentOffset1Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET1_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionSoundex2Coder, STREET_INTERSECTION_SOUNDEX2_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionStreetNameID2Coder, STREET_INTERSECTION_STREET_NAME_ID2_HUFF_FILE),
+				IntCoderFiledef(coders->streetIntersectionStreetSegmentOffset2Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET2_HUFF_FILE)
+			};
+
+			for (
+				unsigned int intCoderIdx = 0; 
+				intCoderIdx < sizeof(intCoderFiledefs)/sizeof(intCoderFiledefs[0]); 
+				intCoderIdx++
+			) {
+				if (packedData && intCoderFiledefs[intCoderIdx].inPackedTable) {
+					continue;
+				}
+				std::fstream fs;
+				TsString filename = databaseDir + "/" + GeoUtil::CodeLengthFilename(intCoderFiledefs[intCoderIdx].filename.c_str());
+				fs.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+				if (!fs.fail()) {
+					if (!GeoUtil::LoadCodeLengths(intCoderFiledefs[intCoderIdx].coder, fs)) {
+						ErrorMessage("Cannot load huffman code length table " + filename);
+						return false;
+					}
+					fs.close();
+					continue;
+				}
+				fs.clear();
+				filename = databaseDir + "/" + intCoderFiledefs[intCoderIdx].filename;
+				fs.open(filename.c_str(), std::ios_base::in);
+				FreqTable<int> freqTable;
+				if (fs.fail() || !freqTable.Load(fs)) {
+					ErrorMessage("Cannot load huffman frequency table " + filename);
+					return false;
+				}
+				intCoderFiledefs[intCoderIdx].coder.Clear();
+				intCoderFiledefs[intCoderIdx].coder.AddEntries(freqTable);
+				intCoderFiledefs[intCoderIdx].coder.MakeCodes();
+				fs.close();
 			}
-			intCoderFiledefs[intCoderIdx].coder.Clear();
-			intCoderFiledefs[intCoderIdx].coder.AddEntries(freqTable);
-			intCoderFiledefs[intCoderIdx].coder.MakeCodes();
-			fs.close();
-		}
-
-		// This is for string coders
-		struct StringCoderFiledef {
-			StringCoderFiledef(
-				HuffmanCoder<TsString, std::less<TsString> >& coder_,
-				const char* filename_
-			) : coder(coder_), filename(filename_)
-			{}
-			HuffmanCoder<TsString, std::less<TsString> >& coder;
-			TsString filename;
-		} stringCoderFiledefs[] = {
-			// StreetName
-			StringCoderFiledef(streetNamePrefixCoder, STREET_NAME_PREFIX_HUFF_FILE),
-			StringCoderFiledef(streetNamePredirCoder, STREET_NAME_PREDIR_HUFF_FILE),
-			StringCoderFiledef(streetNameSuffixCoder, STREET_NAME_SUFFIX_HUFF_FILE),
-			StringCoderFiledef(streetNamePostdirCoder, STREET_NAME_POSTDIR_HUFF_FILE)
-		};
-		for (
-			unsigned int stringCoderIdx = 0; 
-			stringCoderIdx < sizeof(stringCoderFiledefs)/sizeof(stringCoderFiledefs[0]); 
-			stringCoderIdx++
-		) {
-			std::fstream fs;
-			TsString filename = databaseDir + "/" + stringCoderFiledefs[stringCoderIdx].filename;
-			fs.open(filename.c_str(), std::ios_base::in);
-			StringFreqTable freqTable;
-			if (fs.fail() || !freqTable.Load(fs)) {
-				ErrorMessage("Cannot load huffman frequency table " + filename);
-				return false;
+
+			// This is for string coders
+			struct StringCoderFiledef {
+				StringCoderFiledef(
+					HuffmanCoder<TsString, std::less<TsString> >& coder_,
+					const char* filename_,
+					bool inPackedTable_ = false
+				) : coder(coder_), filename(filename_), inPackedTable(inPackedTable_)
+				{}
+				HuffmanCoder<TsString, std::less<TsString> >& coder;
+				TsString filename;
+				bool inPackedTable;
+			} stringCoderFiledefs[] = {
+				// StreetName
+				StringCoderFiledef(coders->streetNamePrefixCoder, STREET_NAME_PREFIX_HUFF_FILE, true),
+				StringCoderFiledef(coders->streetNamePredirCoder, STREET_NAME_PREDIR_HUFF_FILE, true),
+				StringCoderFiledef(coders->streetNameSuffixCoder, STREET_NAME_SUFFIX_HUFF_FILE, true),
+				StringCoderFiledef(coders->streetNamePostdirCoder, STREET_NAME_POSTDIR_HUFF_FILE, true)
+			};
+			for (
+				unsigned int stringCoderIdx = 0; 
+				stringCoderIdx < sizeof(stringCoderFiledefs)/sizeof(stringCoderFiledefs[0]); 
+				stringCoderIdx++
+			) {
+				if (packedData && stringCoderFiledefs[stringCoderIdx].inPackedTable) {
+					continue;
+				}
+				std::fstream fs;
+				TsString filename = databaseDir + "/" + GeoUtil::CodeLengthFilename(stringCoderFiledefs[stringCoderIdx].filename.c_str());
+				fs.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+				if (!fs.fail()) {
+					if (!GeoUtil::LoadCodeLengths(stringCoderFiledefs[stringCoderIdx].coder, fs)) {
+						ErrorMessage("Cannot load huffman code length table " + filename);
+						return false;
+					}
+					fs.close();
+					continue;
+				}
+				fs.clear();
+				filename = databaseDir + "/" + stringCoderFiledefs[stringCoderIdx].filename;
+				fs.open(filename.c_str(), std::ios_base::in);
+				StringFreqTable freqTable;
+				if (fs.fail() || !freqTable.Load(fs)) {
+					ErrorMessage("Cannot load huffman frequency table " + filename);
+					return false;
+				}
+				stringCoderFiledefs[stringCoderIdx].coder.Clear();
+				stringCoderFiledefs[stringCoderIdx].coder.AddEntries(freqTable);
+				stringCoderFiledefs[stringCoderIdx].coder.MakeCodes();
+				fs.close();
 			}
-			stringCoderFiledefs[stringCoderIdx].coder.Clear();
-			stringCoderFiledefs[stringCoderIdx].coder.AddEntries(freqTable);
-			stringCoderFiledefs[stringCoderIdx].coder.MakeCodes();
-			fs.close();
+			coders->loaded = true;
 		}
 
 		// Open all data files.
 		struct InputFileDef {
 			InputFileDef(
 				DataInput& dataInput_,
-				TsString filename_
+				TsString filename_,
+				bool inPackedTable_ = false
 			) : 
 				dataInput(dataInput_),
-				filename(filename_)
+				filename(filename_),
+				inPackedTable(inPackedTable_)
 			{}
 			DataInput& dataInput;
 			TsString filename;
+			bool inPackedTable;
 		} inputFiledefs[] = {
 			InputFileDef(cityStatePostcodeInput, CITY_STATE_POSTCODE_FILE ),
 			InputFileDef(cityStatePostcodeFaIndexInput, CITY_STATE_POSTCODE_FA_INDEX_FILE ),
 			InputFileDef(citySoundexInput, CITY_SOUNDEX_FILE ),
-			InputFileDef(streetNameInput, STREET_NAME_FILE ),
-			InputFileDef(streetNamePositionIndexInput, STREET_NAME_POSITION_INDEX_FILE ),
+			InputFileDef(streetNameInput, STREET_NAME_FILE, true),
+			InputFileDef(streetNamePositionIndexInput, STREET_NAME_POSITION_INDEX_FILE, true),
 			InputFileDef(streetNameSoundexInput, STREET_NAME_SOUNDEX_FILE ),
-			InputFileDef(streetSegmentInput, STREET_SEGMENT_FILE ),
-			InputFileDef(streetSegmentPositionIndexInput, STREET_SEGMENT_POSITION_INDEX_FILE ),
-			InputFileDef(coordinateInput, COORDINATE_FILE ),
-			InputFileDef(coordinatePositionIndexInput, COORDINATE_POSITION_INDEX_FILE ),
+			InputFileDef(streetSegmentInput, STREET_SEGMENT_FILE, true),
+			InputFileDef(streetSegmentPositionIndexInput, STREET_SEGMENT_POSITION_INDEX_FILE, true),
+			InputFileDef(coordinateInput, COORDINATE_FILE, true),
+			InputFileDef(coordinatePositionIndexInput, COORDINATE_POSITION_INDEX_FILE, true),
 			InputFileDef(streetIntersectionSoundexInput, STREET_INTERSECTION_SOUNDEX_FILE ),
 			InputFileDef(streetIntersectionSoundexPositionIndexInput, STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE ),
 			InputFileDef(postcodeAliasByPostcodeInput, POSTCODE_ALIAS_BY_POSTCODE_FILE ),
@@ -224,12 +283,26 @@ namespace PortfolioExplorer {
 			InputFileDef(postcodeCentroidInput, POSTCODE_CENTROID_FILE )
 		};
 		{for (unsigned int fileIdx = 0; fileIdx < sizeof(inputFiledefs)/sizeof(inputFiledefs[0]); fileIdx++) {
+			if (packedData && inputFiledefs[fileIdx].inPackedTable) {
+				continue;
+			}
 			TsString filename = databaseDir + "/" + inputFiledefs[fileIdx].filename;
 			if (!inputFiledefs[fileIdx].dataInput.Open(filename)) {
 				Close();
 				ErrorMessage("Cannot open data file " + inputFiledefs[fileIdx].filename);
 				return false;
 			}
+			if (verifyMode == Geocoder::VerifyLazy) {
+				LazyChecksumRef checksums = MakeLazyChecksum(
+					inputFiledefs[fileIdx].filename,
+					inputFiledefs[fileIdx].dataInput.GetFileSize()
+				);
+				if (checksums.get() == 0) {
+					Close();
+					return false;
+				}
+				inputFiledefs[fileIdx].dataInput.SetChecksums(checksums);
+			}
 		}}
 
 		// Determine the number of CityStatePostcode records.
@@ -253,41 +326,86 @@ namespace PortfolioExplorer {
 		}
 		cityStatePostcodeFaIndexCount = cityStatePostcodeFaIndexInput.GetFileSize() / GeoUtil::CityStatePostcodeFaIndexRecordLength;
 
-		// StreetName table.
-		// Read the number of StreetName records from the position index.
-		if (
-			!streetNamePositionIndexInput.GetBitStream().Seek((__int64)streetNamePositionIndexInput.GetFileSize() * 8 - 32) ||
-			!streetNamePositionIndexInput.GetBitStream().ReadBitsIntoInt(32, streetNameCount) ||
-			!streetNamePositionIndexInput.Seek(0)
-		) {
-			ErrorMessage("Error reading StreetName position index");
-			return false;
-		}
+		if (packedData) {
+			// Open the packed tables and take the record counts from them.
+			struct PackedFileDef {
+				PackedFileDef(
+					PackedTableReader& reader_,
+					TsString filename_,
+					unsigned& count_
+				) :
+					reader(reader_),
+					filename(filename_),
+					count(count_)
+				{}
+				PackedTableReader& reader;
+				TsString filename;
+				unsigned& count;
+			} packedFiledefs[] = {
+				PackedFileDef(streetNamePacked, STREET_NAME_PACKED_FILE, streetNameCount),
+				PackedFileDef(streetSegmentPacked, STREET_SEGMENT_PACKED_FILE, streetSegmentCount),
+				PackedFileDef(coordinatePacked, COORDINATE_PACKED_FILE, coordinateCount)
+			};
+			for (unsigned int fileIdx = 0; fileIdx < sizeof(packedFiledefs)/sizeof(packedFiledefs[0]); fileIdx++) {
+				TsString filename = databaseDir + "/" + packedFiledefs[fileIdx].filename;
+				if (!packedFiledefs[fileIdx].reader.Open(filename)) {
+					Close();
+					ErrorMessage("Cannot open packed data file " + packedFiledefs[fileIdx].filename);
+					return false;
+				}
+				packedFiledefs[fileIdx].count = packedFiledefs[fileIdx].reader.GetRecordCount();
+				if (verifyMode == Geocoder::VerifyLazy) {
+					LazyChecksumRef checksums = MakeLazyChecksum(
+						packedFiledefs[fileIdx].filename,
+						packedFiledefs[fileIdx].reader.GetFileSize()
+					);
+					if (checksums.get() == 0) {
+						Close();
+						return false;
+					}
+					packedFiledefs[fileIdx].reader.SetChecksums(checksums);
+				}
+			}
+			packedStreetNameBlock = -1;
+			packedStreetSegmentBlock = -1;
+			packedCoordinateBlock = -1;
+		} else {
+			// StreetName table.
+			// Read the number of StreetName records from the position index.
+			if (
+				!streetNamePositionIndexInput.GetBitStream().Seek((__int64)streetNamePositionIndexInput.GetFileSize() * 8 - 32) ||
+				!streetNamePositionIndexInput.GetBitStream().ReadBitsIntoInt(32, streetNameCount) ||
+				!streetNamePositionIndexInput.Seek(0)
+			) {
+				ErrorMessage("Error reading StreetName position index");
+				return false;
+			}
 
-		// Determine the number of records in the StreetNameSoundex index.
-		streetNameSoundexCount = streetNameSoundexInput.GetFileSize() * 8 / GeoUtil::StreetNameSoundexRecordBitSize;
+			// Determine the number of records in the StreetSegment table
+			// by reading the position index
+			if (
+				!streetSegmentPositionIndexInput.GetBitStream().Seek((__int64)streetSegmentPositionIndexInput.GetFileSize() * 8 - 32) ||
+				!streetSegmentPositionIndexInput.GetBitStream().ReadBitsIntoInt(32, streetSegmentCount) ||
+				!streetSegmentPositionIndexInput.GetBitStream().Seek(0)
+			) {
+				ErrorMessage("Error reading StreetSegment position index");
+				return false;
+			}
 
-		// Determine the number of records in the StreetSegment table
-		// by reading the position index
-		if (
-			!streetSegmentPositionIndexInput.GetBitStream().Seek((__int64)streetSegmentPositionIndexInput.GetFileSize() * 8 - 32) ||
-			!streetSegmentPositionIndexInput.GetBitStream().ReadBitsIntoInt(32, streetSegmentCount) ||
-			!streetSegmentPositionIndexInput.GetBitStream().Seek(0)
-		) {
-			ErrorMessage("Error reading StreetSegment position index");
-			return false;
+			// Determine the number of records in the Coordinate table
+			// by reading the position index
+			if (
+				!coordinatePositionIndexInput.GetBitStream().Seek((__int64)coordinatePositionIndexInput.GetFileSize() * 8 - 32) ||
+				!coordinatePositionIndexInput.GetBitStream().ReadBitsIntoInt(32, coordinateCount) ||
+				!coordinatePositionIndexInput.GetBitStream().Seek(0)
+			) {
+				ErrorMessage("Error reading Coordinate position index");
+				return false;
+			}
 		}
 
-		// Determine the number of records in the Coordinate table
-		// by reading the position index
-		if (
-			!coordinatePositionIndexInput.GetBitStream().Seek((__int64)coordinatePositionIndexInput.GetFileSize() * 8 - 32) ||
-			!coordinatePositionIndexInput.GetBitStream().ReadBitsIntoInt(32, coordinateCount) ||
-			!coordinatePositionIndexInput.GetBitStream().Seek(0)
-		) {
-			ErrorMessage("Error reading Coordinate position index");
-			return false;
-		}
+		// Determine the number of records in the StreetNameSoundex index.
+		streetNameSoundexCount = streetNameSoundexInput.GetFileSize() * 8 / GeoUtil::StreetNameSoundexRecordBitSize;
 
 		// Determine the number of records in the StreetIntersection table
 		// by reading the position index
@@ -314,6 +432,32 @@ namespace PortfolioExplorer {
 		}
 		postcodeCentroidCount = postcodeCentroidInput.GetFileSize() / GeoUtil::PostcodeCentroidRecordLength;
 
+		// In lazy mode, the files that are not read through a checker are
+		// checked in full now.  These are the small tables.
+		if (verifyMode == Geocoder::VerifyLazy) {
+			if (!checksumManifest->Verify(databaseDir, verifyThreads, lazyChecksumFiles, errorMsg)) {
+				Close();
+				ErrorMessage(errorMsg);
+				return false;
+			}
+		}
+
+		// Load the delta overlay, if the database has one.
+		delta = 0;
+		{
+			TsString deltaFilename = databaseDir + "/" + DELTA_FILE;
+			std::ifstream deltaFs(deltaFilename.c_str());
+			if (!deltaFs.fail()) {
+				deltaFs.close();
+				delta = new GeoDelta;
+				if (!delta->LoadFromFile(deltaFilename, streetNameCount, streetSegmentCount, coordinateCount, errorMsg)) {
+					delta = 0;
+					ErrorMessage(errorMsg);
+					return false;
+				}
+			}
+		}
+
 		// Initialize MRU objects
 		// Make sure these don't point to the same chunk as a valid item.
 		prevStreetNameID = -10000;
@@ -400,6 +544,9 @@ namespace PortfolioExplorer {
 			streetSegmentPositionIndexInput.Close();
 			coordinateInput.Close();
 			coordinatePositionIndexInput.Close();
+			streetNamePacked.Close();
+			streetSegmentPacked.Close();
+			coordinatePacked.Close();
 			streetIntersectionSoundexInput.Close();
 			streetIntersectionSoundexPositionIndexInput.Close();
 
@@ -419,10 +566,15 @@ namespace PortfolioExplorer {
 			postcodeGroupIDFromPostcodeGroupCache = 0;
 			postcodeCentroidByIDCache = 0;
 			postcodeCentroidFromPostcodeCache = 0;
+			checksumManifest = 0;
+			lazyChecksumFiles.clear();
 
+			coders = 0;
 			stateAbbrToFipsTable = 0;
 			stateFipsToAbbrTable = 0;
 
+			delta = 0;
+
 			isOpen = false;
 		}
 	}
@@ -570,6 +722,9 @@ namespace PortfolioExplorer {
 	) {
 		StreetNameSoundex streetNameSoundexTmp;
 
+		// Entries added by the delta overlay are returned after the base entries.
+		int deltaFirst = delta.get() != 0 ? delta->FindStreetNameSoundex(financeNumber, streetSoundex) : -1;
+
 		// StreetName is sorted by postal code.
 		// Binary search to find the lower bound
 		int first = 0;
@@ -599,22 +754,48 @@ namespace PortfolioExplorer {
 
 		// When we get here, first will be the index of the first item whose
 		// postal code is >= the given postal code.
-		if (first == streetNameSoundexCount) {
-			// No records sort >= this fa/soundex.
-			return StreetNameFromFaStreetIterator(this);
-		}
-		
 		if (
+			first == streetNameSoundexCount ||
 			!GetStreetNameSoundexByIDCached(first, streetNameSoundexTmp) ||
 			strcmp(streetNameSoundexTmp.financeNumber, financeNumber) != 0 ||
 			strcmp(streetNameSoundexTmp.streetSoundex, streetSoundex) != 0
 		) {
-			// No records equal this Fa/soundex
-			return StreetNameFromFaStreetIterator(this);
+			// No base records equal this Fa/soundex
+			if (deltaFirst < 0) {
+				return StreetNameFromFaStreetIterator(this);
+			}
+			return StreetNameFromFaStreetIterator(this, financeNumber, streetSoundex, -1, deltaFirst);
 		}
 
 		// We've found the first StreetName with a FA == this one.
-		return StreetNameFromFaStreetIterator(this, financeNumber, streetSoundex, first);
+		return StreetNameFromFaStreetIterator(this, financeNumber, streetSoundex, first, deltaFirst);
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Get the next StreetName from the soundex entries added by the delta.
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::NextDeltaStreetName(
+		const char* financeNumber,
+		const char* streetSoundex,
+		int& deltaCurrent,
+		StreetName& streetNameReturn
+	) {
+		while (deltaCurrent >= 0 && deltaCurrent < delta->GetStreetNameSoundexCount()) {
+			const GeoDelta::StreetNameSoundexEntry& entry = delta->GetStreetNameSoundex(deltaCurrent);
+			if (
+				strcmp(entry.financeNumber, financeNumber) != 0 ||
+				strcmp(entry.streetSoundex, streetSoundex) != 0
+			) {
+				break;
+			}
+			deltaCurrent++;
+			if (delta->IsStreetNameDeleted(entry.streetNameID)) {
+				continue;
+			}
+			return GetStreetNameByIDCached(entry.streetNameID, streetNameReturn);
+		}
+		deltaCurrent = -1;
+		return false;
 	}
 
 	///////////////////////////////////////////////////////////////////////
@@ -717,6 +898,7 @@ namespace PortfolioExplorer {
 		) {
 			return false;
 		}
+		recordsDecoded[Geocoder::ProfileCityStatePostcodeFaIndex]++;
 
 		return true;
 	}
@@ -796,6 +978,7 @@ namespace PortfolioExplorer {
 		) {
 			return false;
 		}
+		recordsDecoded[Geocoder::ProfileCityStatePostcode]++;
 
 		// Get State abbreviation
 		const char *stateAbbr;
@@ -826,6 +1009,7 @@ namespace PortfolioExplorer {
 			postcodeAliasByGroupInput.Read(GeoUtil::PostcodeAliasPostcodeFieldLength, postcodeAliasReturn.postcode) &&
 			postcodeAliasByGroupInput.Read(GeoUtil::PostcodeAliasGroupFieldLength, postcodeAliasReturn.postcodeGroup)
 		) {
+			recordsDecoded[Geocoder::ProfilePostcodeAlias]++;
 			// Null-termination
 			postcodeAliasReturn.postcode[sizeof(postcodeAliasReturn.postcode)-1] = 0;
 			postcodeAliasReturn.postcodeGroup[sizeof(postcodeAliasReturn.postcodeGroup)-1] = 0;
@@ -855,6 +1039,7 @@ namespace PortfolioExplorer {
 			postcodeAliasByPostcodeInput.Read(GeoUtil::PostcodeAliasPostcodeFieldLength, postcodeAliasReturn.postcode) &&
 			postcodeAliasByPostcodeInput.Read(GeoUtil::PostcodeAliasGroupFieldLength, postcodeAliasReturn.postcodeGroup)
 		) {
+			recordsDecoded[Geocoder::ProfilePostcodeAlias]++;
 			// Cache results.
 			postcodeAliasByPostcodeIDCache->Enter(IntKey(postcodeAliasID), postcodeAliasReturn);
 			return true;
@@ -980,6 +1165,7 @@ namespace PortfolioExplorer {
 			return false;
 		}
 
+		recordsDecoded[Geocoder::ProfileCitySoundex]++;
 		GeoUtil::UnpackSoundex(cityStatePostcodeSoundexReturn.citySoundex, soundexValue);
 		// Cache results.
 		cityStatePostcodeSoundexIDCache->Enter(
@@ -997,10 +1183,31 @@ namespace PortfolioExplorer {
 		int streetNameID,
 		StreetName& streetNameReturn
 	) {
+		// Records in the delta overlay take precedence over the base file.
+		if (delta.get() != 0) {
+			switch (delta->FindStreetName(streetNameID, streetNameReturn)) {
+			case GeoDelta::Replaced: return true;
+			case GeoDelta::Deleted: return false;
+			case GeoDelta::NotInDelta: break;
+			}
+		}
+
 		if (streetNameID < 0 || unsigned(streetNameID) >= streetNameCount) {
 			return false;
 		}
 
+		if (packedData) {
+			// Decode the whole block holding the record.
+			int blockSize = streetNamePacked.GetBlockSize();
+			int blockIdx = streetNameID / blockSize;
+			if (blockIdx != packedStreetNameBlock && !ReadPackedStreetNameBlock(blockIdx)) {
+				return false;
+			}
+			streetNameReturn = packedStreetNames[streetNameID - blockIdx * blockSize];
+			streetNameIDCache->Enter(IntKey(streetNameID), streetNameReturn);
+			return true;
+		}
+
 		// If the same as the previous item, then return it.
 		if (streetNameID == prevStreetNameID) {
 			streetNameReturn = prevStreetName;
@@ -1042,18 +1249,19 @@ namespace PortfolioExplorer {
 			//
 			if (
 				!streetNameInput.ReadBitsIntoInt(GeoUtil::StreetNameCityStatePostcodeIDBitSize, (unsigned int&)streetNameReturn.cityStatePostcodeID) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.prefix, sizeof(streetNameReturn.prefix), streetNamePrefixCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.predir, sizeof(streetNameReturn.predir), streetNamePredirCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.street, sizeof(streetNameReturn.street), streetNameNameCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.suffix, sizeof(streetNameReturn.suffix), streetNameSuffixCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.postdir, sizeof(streetNameReturn.postdir), streetNamePostdirCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.prefix, sizeof(streetNameReturn.prefix), coders->streetNamePrefixCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.predir, sizeof(streetNameReturn.predir), coders->streetNamePredirCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.street, sizeof(streetNameReturn.street), coders->streetNameNameCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.suffix, sizeof(streetNameReturn.suffix), coders->streetNameSuffixCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.postdir, sizeof(streetNameReturn.postdir), coders->streetNamePostdirCoder) ||
 				!streetNameInput.ReadBitsIntoInt(GeoUtil::StreetNameStreetSegmentIDFirstBitSize, (unsigned int&)streetNameReturn.streetSegmentIDFirst) ||
-				!streetNameInput.ReadVarLengthCodedInt((unsigned int&)streetNameReturn.streetSegmentCount, streetNameStreetSegmentCountCoder)
+				!streetNameInput.ReadVarLengthCodedInt((unsigned int&)streetNameReturn.streetSegmentCount, coders->streetNameStreetSegmentCountCoder)
 			) {
 				prevStreetNameID = -10000;
 				return false;
 			}
 
+			recordsDecoded[Geocoder::ProfileStreetName]++;
 			prevStreetName = streetNameReturn;
 			prevChunkOffset = 0;
 		}
@@ -1063,20 +1271,21 @@ namespace PortfolioExplorer {
 			int cityStatePostcodeIDDiff;
 			int streetSegmentIDFirstDiff;
 			if (
-				!streetNameInput.ReadIntFromCoder(cityStatePostcodeIDDiff, streetNameCityStatePostcodeIDCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.prefix, sizeof(streetNameReturn.prefix), streetNamePrefixCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.predir, sizeof(streetNameReturn.predir), streetNamePredirCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.street, sizeof(streetNameReturn.street), streetNameNameCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.suffix, sizeof(streetNameReturn.suffix), streetNameSuffixCoder) ||
-				!streetNameInput.ReadStringFromCoder(streetNameReturn.postdir, sizeof(streetNameReturn.postdir), streetNamePostdirCoder) ||
-				!streetNameInput.ReadVarLengthCodedInt(streetSegmentIDFirstDiff, streetNameStreetSegmentIDFirstCoder) ||
-				!streetNameInput.ReadVarLengthCodedInt((unsigned int&)streetNameReturn.streetSegmentCount, streetNameStreetSegmentCountCoder)
+				!streetNameInput.ReadIntFromCoder(cityStatePostcodeIDDiff, coders->streetNameCityStatePostcodeIDCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.prefix, sizeof(streetNameReturn.prefix), coders->streetNamePrefixCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.predir, sizeof(streetNameReturn.predir), coders->streetNamePredirCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.street, sizeof(streetNameReturn.street), coders->streetNameNameCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.suffix, sizeof(streetNameReturn.suffix), coders->streetNameSuffixCoder) ||
+				!streetNameInput.ReadStringFromCoder(streetNameReturn.postdir, sizeof(streetNameReturn.postdir), coders->streetNamePostdirCoder) ||
+				!streetNameInput.ReadVarLengthCodedInt(streetSegmentIDFirstDiff, coders->streetNameStreetSegmentIDFirstCoder) ||
+				!streetNameInput.ReadVarLengthCodedInt((unsigned int&)streetNameReturn.streetSegmentCount, coders->streetNameStreetSegmentCountCoder)
 			) {
 				prevStreetNameID = -10000;
 				return false;
 			}
 			streetNameReturn.cityStatePostcodeID = prevStreetName.cityStatePostcodeID + cityStatePostcodeIDDiff;
 			streetNameReturn.streetSegmentIDFirst = prevStreetName.streetSegmentIDFirst + streetSegmentIDFirstDiff;
+			recordsDecoded[Geocoder::ProfileStreetName]++;
 			prevStreetName = streetNameReturn;
 		}}
 
@@ -1109,6 +1318,7 @@ namespace PortfolioExplorer {
 		) {
 			return false;
 		}
+		recordsDecoded[Geocoder::ProfileStreetNameSoundex]++;
 		GeoUtil::UnpackSoundex(streetNameSoundexReturn.streetSoundex, packedSoundex);
 		GeoUtil::UnpackFa(streetNameSoundexReturn.financeNumber, packedFa);
 
@@ -1188,10 +1398,31 @@ namespace PortfolioExplorer {
 		int streetSegmentID,
 		StreetSegment& streetSegmentReturn
 	) {
+		// Records in the delta overlay take precedence over the base file.
+		if (delta.get() != 0) {
+			switch (delta->FindStreetSegment(streetSegmentID, streetSegmentReturn)) {
+			case GeoDelta::Replaced: return true;
+			case GeoDelta::Deleted: return false;
+			case GeoDelta::NotInDelta: break;
+			}
+		}
+
 		if (streetSegmentID < 0 || unsigned(streetSegmentID) >= streetSegmentCount) {
 			return false;
 		}
 
+		if (packedData) {
+			// Decode the whole block holding the record.
+			int blockSize = streetSegmentPacked.GetBlockSize();
+			int blockIdx = streetSegmentID / blockSize;
+			if (blockIdx != packedStreetSegmentBlock && !ReadPackedStreetSegmentBlock(blockIdx)) {
+				return false;
+			}
+			streetSegmentReturn = packedStreetSegments[streetSegmentID - blockIdx * blockSize];
+			streetSegmentIDCache->Enter(IntKey(streetSegmentID), streetSegmentReturn);
+			return true;
+		}
+
 		// If the same as the previous item, then return it.
 		if (streetSegmentID == prevStreetSegmentID) {
 			streetSegmentReturn = prevStreetSegment;
@@ -1235,21 +1466,22 @@ namespace PortfolioExplorer {
 			// Read the chunk start record
 			//
 			if (
-				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.addrLow, sizeof(streetSegmentReturn.addrLow), streetSegmentAddrLowKeyCoder1, streetSegmentAddrLowKeyCoder2, '0') ||
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrHigh, sizeof(streetSegmentReturn.addrHigh), streetSegmentAddrHighCoder1, streetSegmentAddrHighCoder2, streetSegmentReturn.addrLow, '0') ||
+				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.addrLow, sizeof(streetSegmentReturn.addrLow), coders->streetSegmentAddrLowKeyCoder1, coders->streetSegmentAddrLowKeyCoder2, '0') ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrHigh, sizeof(streetSegmentReturn.addrHigh), coders->streetSegmentAddrHighCoder1, coders->streetSegmentAddrHighCoder2, streetSegmentReturn.addrLow, '0') ||
 				!streetSegmentInput.GetBitStream().ReadBitsIntoInt(GeoUtil::StreetSegmentLeftRightBitSize, isRightSide) ||
-				!streetSegmentInput.ReadIntFromCoder(countyCode, streetSegmentCountyKeyCoder) ||
-				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.censusTract, sizeof(streetSegmentReturn.censusTract), streetSegmentCensusTractKeyCoder1, streetSegmentCensusTractKeyCoder2, '0') ||
-				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.censusBlock, sizeof(streetSegmentReturn.censusBlock), streetSegmentCensusBlockKeyCoder1, streetSegmentCensusBlockKeyCoder2, '0') ||
-				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.postcodeExt, sizeof(streetSegmentReturn.postcodeExt), streetSegmentPostcodeExtKeyCoder, '0') ||
+				!streetSegmentInput.ReadIntFromCoder(countyCode, coders->streetSegmentCountyKeyCoder) ||
+				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.censusTract, sizeof(streetSegmentReturn.censusTract), coders->streetSegmentCensusTractKeyCoder1, coders->streetSegmentCensusTractKeyCoder2, '0') ||
+				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.censusBlock, sizeof(streetSegmentReturn.censusBlock), coders->streetSegmentCensusBlockKeyCoder1, coders->streetSegmentCensusBlockKeyCoder2, '0') ||
+				!streetSegmentInput.ReadRLECompressedStr(streetSegmentReturn.postcodeExt, sizeof(streetSegmentReturn.postcodeExt), coders->streetSegmentPostcodeExtKeyCoder, '0') ||
 				!streetSegmentInput.ReadBitsIntoInt(GeoUtil::StreetSegmentCoordinateIDBitSize, (unsigned int&)streetSegmentReturn.coordinateID) ||
-				!streetSegmentInput.ReadIntFromCoder(streetSegmentReturn.coordinateCount, streetSegmentCoordinateCountCoder)
+				!streetSegmentInput.ReadIntFromCoder(streetSegmentReturn.coordinateCount, coders->streetSegmentCoordinateCountCoder)
 			) {
 				prevStreetSegmentID = -10000;
 				return false;
 			}
 			streetSegmentReturn.isRightSide = isRightSide != 0;
 			streetSegmentReturn.countyCode = countyCode;
+			recordsDecoded[Geocoder::ProfileStreetSegment]++;
 			prevStreetSegment = streetSegmentReturn;
 			prevChunkOffset = 0;
 		}
@@ -1259,14 +1491,14 @@ namespace PortfolioExplorer {
 			int coordinateIDDiff;
 			int countyCodeDiff;
 			if (
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrLow, sizeof(streetSegmentReturn.addrLow), streetSegmentAddrLowNonkeyCoder1, streetSegmentAddrLowNonkeyCoder2, prevStreetSegment.addrLow, '0') ||
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrHigh, sizeof(streetSegmentReturn.addrHigh), streetSegmentAddrHighCoder1, streetSegmentAddrHighCoder2, streetSegmentReturn.addrLow, '0') ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrLow, sizeof(streetSegmentReturn.addrLow), coders->streetSegmentAddrLowNonkeyCoder1, coders->streetSegmentAddrLowNonkeyCoder2, prevStreetSegment.addrLow, '0') ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.addrHigh, sizeof(streetSegmentReturn.addrHigh), coders->streetSegmentAddrHighCoder1, coders->streetSegmentAddrHighCoder2, streetSegmentReturn.addrLow, '0') ||
 				!streetSegmentInput.GetBitStream().ReadBitsIntoInt(GeoUtil::StreetSegmentLeftRightBitSize, isRightSide) ||
-				!streetSegmentInput.ReadIntFromCoder(countyCodeDiff, streetSegmentCountyNonkeyCoder) ||
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.censusTract, sizeof(streetSegmentReturn.censusTract), streetSegmentCensusTractNonkeyCoder1, streetSegmentCensusTractNonkeyCoder2, prevStreetSegment.censusTract, '0') ||
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.censusBlock, sizeof(streetSegmentReturn.censusBlock), streetSegmentCensusBlockNonkeyCoder1, streetSegmentCensusBlockNonkeyCoder2, prevStreetSegment.censusBlock, '0') ||
-				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.postcodeExt, sizeof(streetSegmentReturn.postcodeExt), streetSegmentPostcodeExtNonkeyCoder, prevStreetSegment.postcodeExt, '0') ||
-				!streetSegmentInput.ReadVarLengthCodedInt(coordinateIDDiff, streetSegmentCoordinateIDCoder1, streetSegmentCoordinateIDCoder2)
+				!streetSegmentInput.ReadIntFromCoder(countyCodeDiff, coders->streetSegmentCountyNonkeyCoder) ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.censusTract, sizeof(streetSegmentReturn.censusTract), coders->streetSegmentCensusTractNonkeyCoder1, coders->streetSegmentCensusTractNonkeyCoder2, prevStreetSegment.censusTract, '0') ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.censusBlock, sizeof(streetSegmentReturn.censusBlock), coders->streetSegmentCensusBlockNonkeyCoder1, coders->streetSegmentCensusBlockNonkeyCoder2, prevStreetSegment.censusBlock, '0') ||
+				!streetSegmentInput.ReadRLECompressedStrDiff(streetSegmentReturn.postcodeExt, sizeof(streetSegmentReturn.postcodeExt), coders->streetSegmentPostcodeExtNonkeyCoder, prevStreetSegment.postcodeExt, '0') ||
+				!streetSegmentInput.ReadVarLengthCodedInt(coordinateIDDiff, coders->streetSegmentCoordinateIDCoder1, coders->streetSegmentCoordinateIDCoder2)
 			) {
 				prevStreetSegmentID = -10000;
 				return false;
@@ -1274,13 +1506,14 @@ namespace PortfolioExplorer {
 			if (coordinateIDDiff == 0) {
 				// The coordinate count will also be the same as previous count.
 				streetSegmentReturn.coordinateCount = prevStreetSegment.coordinateCount;
-			} else if (!streetSegmentInput.ReadIntFromCoder(streetSegmentReturn.coordinateCount, streetSegmentCoordinateCountCoder)) {
+			} else if (!streetSegmentInput.ReadIntFromCoder(streetSegmentReturn.coordinateCount, coders->streetSegmentCoordinateCountCoder)) {
 				prevStreetSegmentID = -10000;
 				return false;
 			}
 			streetSegmentReturn.isRightSide = isRightSide != 0;
 			streetSegmentReturn.countyCode = prevStreetSegment.countyCode + countyCodeDiff;
 			streetSegmentReturn.coordinateID = prevStreetSegment.coordinateID + coordinateIDDiff;
+			recordsDecoded[Geocoder::ProfileStreetSegment]++;
 			prevStreetSegment = streetSegmentReturn;
 		}}
 
@@ -1297,10 +1530,33 @@ namespace PortfolioExplorer {
 		int coordinateID,
 		CoordinatePoint& coordinateReturn
 	) {
+		// Records in the delta overlay take precedence over the base file.
+		if (delta.get() != 0) {
+			switch (delta->FindCoordinate(coordinateID, coordinateReturn)) {
+			case GeoDelta::Replaced: return true;
+			case GeoDelta::Deleted: return false;
+			case GeoDelta::NotInDelta: break;
+			}
+		}
+
 		if (coordinateID < 0 || unsigned(coordinateID) >= coordinateCount) {
 			return false;
 		}
 
+		if (packedData) {
+			// Decode the whole block holding the record.
+			int blockSize = coordinatePacked.GetBlockSize();
+			int blockIdx = coordinateID / blockSize;
+			if (blockIdx != packedCoordinateBlock && !ReadPackedCoordinateBlock(blockIdx)) {
+				return false;
+			}
+			int blockOffset = coordinateID - blockIdx * blockSize;
+			coordinateReturn.latitude = (double)packedLatitudes[blockOffset] / 100000.0;
+			coordinateReturn.longitude = (double)packedLongitudes[blockOffset] / 100000.0;
+			coordinateIDCache->Enter(IntKey(coordinateID), coordinateReturn);
+			return true;
+		}
+
 		// If the same as the previous item, then return it.
 		if (coordinateID == prevCoordinateID) {
 			coordinateReturn.latitude = (double)prevCoordinateLat / 100000.0;
@@ -1346,6 +1602,7 @@ namespace PortfolioExplorer {
 			}
 			coordinateReturn.latitude = (double)prevCoordinateLat / 100000.0;
 			coordinateReturn.longitude = (double)prevCoordinateLon / 100000.0;
+			recordsDecoded[Geocoder::ProfileCoordinate]++;
 			prevChunkOffset = 0;
 		}
 
@@ -1354,14 +1611,15 @@ namespace PortfolioExplorer {
 			int latDiff;
 			int lonDiff;
 			if (
-				!coordinateInput.ReadVarLengthCodedInt(latDiff, coordinateLatitudeCoder1, coordinateLatitudeCoder2) ||
-				!coordinateInput.ReadVarLengthCodedInt(lonDiff, coordinateLongitudeCoder1, coordinateLongitudeCoder2)
+				!coordinateInput.ReadVarLengthCodedInt(latDiff, coders->coordinateLatitudeCoder1, coders->coordinateLatitudeCoder2) ||
+				!coordinateInput.ReadVarLengthCodedInt(lonDiff, coders->coordinateLongitudeCoder1, coders->coordinateLongitudeCoder2)
 			) {
 				prevCoordinateID = -10000;
 				return false;
 			}
 			prevCoordinateLat += latDiff;
 			prevCoordinateLon += lonDiff;
+			recordsDecoded[Geocoder::ProfileCoordinate]++;
 			coordinateReturn.latitude = (double)prevCoordinateLat / 100000.0;
 			coordinateReturn.longitude = (double)prevCoordinateLon / 100000.0;
 		}}
@@ -1372,6 +1630,325 @@ namespace PortfolioExplorer {
 	}
 
 
+	///////////////////////////////////////////////////////////////////////
+	// Hits and misses of a cache, which is null while closed.
+	///////////////////////////////////////////////////////////////////////
+	template <class CacheRef> static void GetCacheCounters(
+		const CacheRef& cache,
+		long& hitsReturn,
+		long& missesReturn
+	) {
+		if (cache.get() != 0) {
+			hitsReturn = cache->GetHits();
+			missesReturn = cache->GetMisses();
+		} else {
+			hitsReturn = 0;
+			missesReturn = 0;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Get the counters kept for profiling.
+	///////////////////////////////////////////////////////////////////////
+	void QueryImp::GetProfileCounters(Geocoder::RequestStats& countersReturn)
+	{
+		countersReturn.Clear();
+		{for (int i = 0; i < Geocoder::NbrProfileTables; i++) {
+			countersReturn.recordsDecoded[i] = recordsDecoded[i];
+		}}
+
+		long* hits = countersReturn.cacheHits;
+		long* misses = countersReturn.cacheMisses;
+		GetCacheCounters(cityStatePostcodeByIDCache, hits[Geocoder::ProfileCacheCityStatePostcodeByID], misses[Geocoder::ProfileCacheCityStatePostcodeByID]);
+		GetCacheCounters(cityStatePostcodeSoundexIDCache, hits[Geocoder::ProfileCacheCityStatePostcodeSoundexByID], misses[Geocoder::ProfileCacheCityStatePostcodeSoundexByID]);
+		GetCacheCounters(cityStatePostcodeFaIndexByIDCache, hits[Geocoder::ProfileCacheCityStatePostcodeFaIndexByID], misses[Geocoder::ProfileCacheCityStatePostcodeFaIndexByID]);
+		GetCacheCounters(cityStatePostcodeFaIndexFromFaCache, hits[Geocoder::ProfileCacheCityStatePostcodeFaIndexFromFa], misses[Geocoder::ProfileCacheCityStatePostcodeFaIndexFromFa]);
+		GetCacheCounters(streetNameIDCache, hits[Geocoder::ProfileCacheStreetNameByID], misses[Geocoder::ProfileCacheStreetNameByID]);
+		GetCacheCounters(streetNameSoundexIDCache, hits[Geocoder::ProfileCacheStreetNameSoundexByID], misses[Geocoder::ProfileCacheStreetNameSoundexByID]);
+		GetCacheCounters(streetNameSoundexFaSoundexCache, hits[Geocoder::ProfileCacheStreetNameSoundexFaSoundex], misses[Geocoder::ProfileCacheStreetNameSoundexFaSoundex]);
+		GetCacheCounters(streetSegmentIDCache, hits[Geocoder::ProfileCacheStreetSegmentByID], misses[Geocoder::ProfileCacheStreetSegmentByID]);
+		GetCacheCounters(coordinateIDCache, hits[Geocoder::ProfileCacheCoordinateByID], misses[Geocoder::ProfileCacheCoordinateByID]);
+		GetCacheCounters(streetIntersectionSoundexIDCache, hits[Geocoder::ProfileCacheStreetIntersectionSoundexByID], misses[Geocoder::ProfileCacheStreetIntersectionSoundexByID]);
+		GetCacheCounters(postcodeAliasByPostcodeIDCache, hits[Geocoder::ProfileCachePostcodeAliasByPostcodeID], misses[Geocoder::ProfileCachePostcodeAliasByPostcodeID]);
+		GetCacheCounters(postcodeAliasByGroupIDCache, hits[Geocoder::ProfileCachePostcodeAliasByGroupID], misses[Geocoder::ProfileCachePostcodeAliasByGroupID]);
+		GetCacheCounters(postcodeGroupFromPostcodeCache, hits[Geocoder::ProfileCachePostcodeGroupFromPostcode], misses[Geocoder::ProfileCachePostcodeGroupFromPostcode]);
+		GetCacheCounters(postcodeGroupIDFromPostcodeGroupCache, hits[Geocoder::ProfileCachePostcodeGroupIDFromPostcodeGroup], misses[Geocoder::ProfileCachePostcodeGroupIDFromPostcodeGroup]);
+		GetCacheCounters(postcodeCentroidByIDCache, hits[Geocoder::ProfileCachePostcodeCentroidByID], misses[Geocoder::ProfileCachePostcodeCentroidByID]);
+		GetCacheCounters(postcodeCentroidFromPostcodeCache, hits[Geocoder::ProfileCachePostcodeCentroidFromPostcode], misses[Geocoder::ProfileCachePostcodeCentroidFromPostcode]);
+
+		// The bit-coded files; the others are read a byte at a time.
+		__int64 bits = packedBitsRead;
+		bits += streetNameInput.GetBitStream().GetBitsRead();
+		bits += streetNamePositionIndexInput.GetBitStream().GetBitsRead();
+		bits += streetNameSoundexInput.GetBitStream().GetBitsRead();
+		bits += streetSegmentInput.GetBitStream().GetBitsRead();
+		bits += streetSegmentPositionIndexInput.GetBitStream().GetBitsRead();
+		bits += coordinateInput.GetBitStream().GetBitsRead();
+		bits += coordinatePositionIndexInput.GetBitStream().GetBitsRead();
+		bits += streetIntersectionSoundexInput.GetBitStream().GetBitsRead();
+		bits += streetIntersectionSoundexPositionIndexInput.GetBitStream().GetBitsRead();
+		countersReturn.bitsDecoded = (double)bits;
+	}
+
+
+	///////////////////////////////////////////////////////////////////////
+	// Load the checksum manifest and, for VerifyAtOpen, check every file.
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::LoadChecksums()
+	{
+		checksumManifest = 0;
+		lazyChecksumFiles.clear();
+		if (verifyMode == Geocoder::VerifyNone) {
+			return true;
+		}
+
+		TsString errorMsg;
+		checksumManifest = new ChecksumManifest;
+		if (!checksumManifest->LoadFromFile(databaseDir + "/" + CHECKSUM_MANIFEST_FILE, errorMsg)) {
+			checksumManifest = 0;
+			ErrorMessage(errorMsg);
+			return false;
+		}
+		if (verifyMode == Geocoder::VerifyAtOpen) {
+			std::set<TsString> noFiles;
+			if (!checksumManifest->Verify(databaseDir, verifyThreads, noFiles, errorMsg)) {
+				ErrorMessage(errorMsg);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Make the checker for a data file that is verified as it is read.
+	///////////////////////////////////////////////////////////////////////
+	LazyChecksumRef QueryImp::MakeLazyChecksum(const TsString& filename, int fileSize)
+	{
+		const ChecksumManifest::FileEntry* entry = checksumManifest->FindFile(filename);
+		if (entry == 0) {
+			ErrorMessage("Data file " + filename + " is not in the checksum manifest");
+			return 0;
+		}
+		if (unsigned(fileSize) != entry->size) {
+			ErrorMessage(
+				"Size of data file " + filename + " is " + FormatInteger(fileSize) +
+				" bytes, expected " + FormatInteger(entry->size)
+			);
+			return 0;
+		}
+		lazyChecksumFiles.insert(filename);
+		return new LazyChecksum(*entry, checksumManifest->GetGroupSize(), this);
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Determine whether the database was written in the packed format.
+	// The version file holds the data version, optionally followed by
+	// GeoUtil::PACKED_FORMAT_FLAG.
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::IsPackedDatabase()
+	{
+		TsString filename = databaseDir + "/" + VERSION_FILE;
+		FILE* fp = fopen(filename.c_str(), "r");
+		if (fp == 0) {
+			return false;
+		}
+		char buf[48];
+		bool retVal = false;
+		if (fgets(buf, sizeof(buf), fp) != NULL) {
+			int version;
+			char flag[16];
+			retVal = 
+				sscanf(buf, "%d %15s", &version, flag) == 2 &&
+				strcmp(flag, PACKED_FORMAT_FLAG) == 0;
+		}
+		fclose(fp);
+		return retVal;
+	}
+
+
+	///////////////////////////////////////////////////////////////////////
+	// Read a fixed-width string column of a packed block into a field of
+	// each record.  Fields are stored with their terminators.
+	// Inputs:
+	//	PackedBlockReader&	reader		Reader for the block
+	//	std::vector<char>&	scratch		Temporary space
+	//	int					stride		Size of a record in bytes
+	//	int					width		Size of the field in bytes
+	//	int					count		Number of records
+	// Outputs:
+	//	char*				field		The field of the first record
+	// Return value:
+	//	bool	true on success, false on error.
+	///////////////////////////////////////////////////////////////////////
+	static bool ReadPackedCharField(
+		PackedBlockReader& reader,
+		std::vector<char>& scratch,
+		char* field,
+		int stride,
+		int width,
+		int count
+	) {
+		scratch.resize(count * width);
+		if (!reader.ReadCharColumn(&scratch[0], width, count)) {
+			return false;
+		}
+		for (int i = 0; i < count; i++, field += stride) {
+			memcpy(field, &scratch[i * width], width);
+			field[width - 1] = 0;
+		}
+		return true;
+	}
+
+
+	///////////////////////////////////////////////////////////////////////
+	// Read and decode a block of the packed StreetName table.
+	// Columns: cityStatePostcodeID (delta), prefix, predir, street, suffix,
+	// postdir (fixed width), streetSegmentIDFirst (delta), 
+	// streetSegmentCount.
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::ReadPackedStreetNameBlock(int blockIdx)
+	{
+		packedStreetNameBlock = -1;
+		int blockSize = streetNamePacked.GetBlockSize();
+		int first = blockIdx * blockSize;
+		int count = JHMIN(blockSize, int(streetNameCount) - first);
+		if (count <= 0 || !streetNamePacked.ReadBlock(blockIdx, packedBytes)) {
+			return false;
+		}
+		PackedBlockReader reader(packedBytes.empty() ? 0 : &packedBytes[0], unsigned(packedBytes.size()));
+		packedStreetNames.resize(count);
+		packedColumn.resize(count);
+		StreetName* records = &packedStreetNames[0];
+		int* column = &packedColumn[0];
+		const int stride = sizeof(StreetName);
+
+		if (!reader.ReadDeltaColumn(column, count)) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].ID = first + i;
+			records[i].cityStatePostcodeID = column[i];
+		}}
+		if (
+			!ReadPackedCharField(reader, packedChars, records[0].prefix, stride, sizeof(records[0].prefix), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].predir, stride, sizeof(records[0].predir), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].street, stride, sizeof(records[0].street), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].suffix, stride, sizeof(records[0].suffix), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].postdir, stride, sizeof(records[0].postdir), count) ||
+			!reader.ReadDeltaColumn(column, count)
+		) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].streetSegmentIDFirst = column[i];
+		}}
+		if (!reader.ReadIntColumn(column, count)) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].streetSegmentCount = column[i];
+		}}
+
+		recordsDecoded[Geocoder::ProfileStreetName] += count;
+		packedBitsRead += (__int64)packedBytes.size() * 8;
+		packedStreetNameBlock = blockIdx;
+		return true;
+	}
+
+
+	///////////////////////////////////////////////////////////////////////
+	// Read and decode a block of the packed StreetSegment table.
+	// Columns: addrLow, addrHigh (fixed width), isRightSide, countyCode,
+	// censusTract, censusBlock, postcodeExt (fixed width), 
+	// coordinateID (delta), coordinateCount.
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::ReadPackedStreetSegmentBlock(int blockIdx)
+	{
+		packedStreetSegmentBlock = -1;
+		int blockSize = streetSegmentPacked.GetBlockSize();
+		int first = blockIdx * blockSize;
+		int count = JHMIN(blockSize, int(streetSegmentCount) - first);
+		if (count <= 0 || !streetSegmentPacked.ReadBlock(blockIdx, packedBytes)) {
+			return false;
+		}
+		PackedBlockReader reader(packedBytes.empty() ? 0 : &packedBytes[0], unsigned(packedBytes.size()));
+		packedStreetSegments.resize(count);
+		packedColumn.resize(count);
+		StreetSegment* records = &packedStreetSegments[0];
+		int* column = &packedColumn[0];
+		const int stride = sizeof(StreetSegment);
+
+		if (
+			!ReadPackedCharField(reader, packedChars, records[0].addrLow, stride, sizeof(records[0].addrLow), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].addrHigh, stride, sizeof(records[0].addrHigh), count) ||
+			!reader.ReadIntColumn(column, count)
+		) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].ID = first + i;
+			records[i].isRightSide = column[i] != 0;
+		}}
+		if (!reader.ReadIntColumn(column, count)) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].countyCode = short(column[i]);
+		}}
+		if (
+			!ReadPackedCharField(reader, packedChars, records[0].censusTract, stride, sizeof(records[0].censusTract), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].censusBlock, stride, sizeof(records[0].censusBlock), count) ||
+			!ReadPackedCharField(reader, packedChars, records[0].postcodeExt, stride, sizeof(records[0].postcodeExt), count) ||
+			!reader.ReadDeltaColumn(column, count)
+		) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].coordinateID = column[i];
+		}}
+		if (!reader.ReadIntColumn(column, count)) {
+			return false;
+		}
+		{for (int i = 0; i < count; i++) {
+			records[i].coordinateCount = column[i];
+		}}
+
+		recordsDecoded[Geocoder::ProfileStreetSegment] += count;
+		packedBitsRead += (__int64)packedBytes.size() * 8;
+		packedStreetSegmentBlock = blockIdx;
+		return true;
+	}
+
+
+	///////////////////////////////////////////////////////////////////////
+	// Read and decode a block of the packed Coordinate table.
+	// Columns: latitude, longitude (delta, in 1/100000 degree).
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::ReadPackedCoordinateBlock(int blockIdx)
+	{
+		packedCoordinateBlock = -1;
+		int blockSize = coordinatePacked.GetBlockSize();
+		int first = blockIdx * blockSize;
+		int count = JHMIN(blockSize, int(coordinateCount) - first);
+		if (count <= 0 || !coordinatePacked.ReadBlock(blockIdx, packedBytes)) {
+			return false;
+		}
+		PackedBlockReader reader(packedBytes.empty() ? 0 : &packedBytes[0], unsigned(packedBytes.size()));
+		packedLatitudes.resize(count);
+		packedLongitudes.resize(count);
+		if (
+			!reader.ReadDeltaColumn(&packedLatitudes[0], count) ||
+			!reader.ReadDeltaColumn(&packedLongitudes[0], count)
+		) {
+			return false;
+		}
+		recordsDecoded[Geocoder::ProfileCoordinate] += count;
+		packedBitsRead += (__int64)packedBytes.size() * 8;
+		packedCoordinateBlock = blockIdx;
+		return true;
+	}
+
+
 	///////////////////////////////////////////////////////////////////////
 	// Get a StreetIntersectionSoundex record by ID, uncached version.
 	///////////////////////////////////////////////////////////////////////
@@ -1425,16 +2002,17 @@ namespace PortfolioExplorer {
 				!streetIntersectionSoundexInput.ReadBitsIntoInt(GeoUtil::StreetIntersectionStateBitSize, (unsigned int&)streetIntersectionSoundexReturn.state) ||
 				!streetIntersectionSoundexInput.ReadBitsIntoInt(GeoUtil::StreetIntersectionSoundexBitSize, soundexValue1) ||
 				!streetIntersectionSoundexInput.ReadBitsIntoInt(GeoUtil::StreetIntersectionStreetNameIDBitSize, (unsigned int&)streetIntersectionSoundexReturn.streetNameID1) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset1, streetIntersectionStreetSegmentOffset1Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset1, coders->streetIntersectionStreetSegmentOffset1Coder) ||
 				!streetIntersectionSoundexInput.ReadBitsIntoInt(GeoUtil::StreetIntersectionSoundexBitSize, soundexValue2) ||
 				!streetIntersectionSoundexInput.ReadBitsIntoInt(GeoUtil::StreetIntersectionStreetNameIDBitSize, (unsigned int&)streetIntersectionSoundexReturn.streetNameID2) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset2, streetIntersectionStreetSegmentOffset2Coder)
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset2, coders->streetIntersectionStreetSegmentOffset2Coder)
 			) {
 				prevStreetIntersectionSoundexID = -10000;
 				return false;
 			}
 			GeoUtil::UnpackSoundex(streetIntersectionSoundexReturn.streetSoundex1, soundexValue1);
 			GeoUtil::UnpackSoundex(streetIntersectionSoundexReturn.streetSoundex2, soundexValue2);
+			recordsDecoded[Geocoder::ProfileStreetIntersectionSoundex]++;
 
 			prevStreetIntersectionSoundex = streetIntersectionSoundexReturn;
 			prevChunkOffset = 0;
@@ -1446,13 +2024,13 @@ namespace PortfolioExplorer {
 			int streetNameID1Diff, streetNameID2Diff;
 			int stateDiff;
 			if (
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(stateDiff, streetIntersectionStateCoder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(soundex1Diff, streetIntersectionSoundex1Coder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(streetNameID1Diff, streetIntersectionStreetNameID1Coder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset1, streetIntersectionStreetSegmentOffset1Coder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(soundex2Diff, streetIntersectionSoundex2Coder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(streetNameID2Diff, streetIntersectionStreetNameID2Coder) ||
-				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset2, streetIntersectionStreetSegmentOffset2Coder)
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(stateDiff, coders->streetIntersectionStateCoder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(soundex1Diff, coders->streetIntersectionSoundex1Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(streetNameID1Diff, coders->streetIntersectionStreetNameID1Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset1, coders->streetIntersectionStreetSegmentOffset1Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(soundex2Diff, coders->streetIntersectionSoundex2Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt(streetNameID2Diff, coders->streetIntersectionStreetNameID2Coder) ||
+				!streetIntersectionSoundexInput.ReadVarLengthCodedInt((unsigned int&)streetIntersectionSoundexReturn.streetSegmentOffset2, coders->streetIntersectionStreetSegmentOffset2Coder)
 			) {
 				prevStreetIntersectionSoundexID = -10000;
 				return false;
@@ -1469,6 +2047,7 @@ namespace PortfolioExplorer {
 			);
 			streetIntersectionSoundexReturn.streetNameID1 = prevStreetIntersectionSoundex.streetNameID1 + streetNameID1Diff;
 			streetIntersectionSoundexReturn.streetNameID2 = prevStreetIntersectionSoundex.streetNameID2 + streetNameID2Diff;
+			recordsDecoded[Geocoder::ProfileStreetIntersectionSoundex]++;
 			// Save as prev value
 			prevStreetIntersectionSoundex = streetIntersectionSoundexReturn;
 		}}
@@ -1482,6 +2061,34 @@ namespace PortfolioExplorer {
 	}
 
 
+	///////////////////////////////////////////////////////////////////////
+	// Has the delta overlay deleted either street of an intersection, or
+	// the segment it refers to?  Segments are located through the street
+	// names as the delta leaves them (see GeoDelta.h).
+	///////////////////////////////////////////////////////////////////////
+	bool QueryImp::IsStreetIntersectionSoundexDeleted(
+		const StreetIntersectionSoundex& streetIntersectionSoundex
+	) {
+		if (delta.get() == 0) {
+			return false;
+		}
+		if (
+			delta->IsStreetNameDeleted(streetIntersectionSoundex.streetNameID1) ||
+			delta->IsStreetNameDeleted(streetIntersectionSoundex.streetNameID2)
+		) {
+			return true;
+		}
+		StreetName streetName;
+		return
+			(
+				GetStreetNameByIDCached(streetIntersectionSoundex.streetNameID1, streetName) &&
+				delta->IsStreetSegmentDeleted(streetName.streetSegmentIDFirst + streetIntersectionSoundex.streetSegmentOffset1)
+			) || (
+				GetStreetNameByIDCached(streetIntersectionSoundex.streetNameID2, streetName) &&
+				delta->IsStreetSegmentDeleted(streetName.streetSegmentIDFirst + streetIntersectionSoundex.streetSegmentOffset2)
+			);
+	}
+
 	///////////////////////////////////////////////////////////////////////
 	// Given a StreetIntersectionSoundex record, build the associated
 	// StreetIntersection record.
@@ -1571,6 +2178,7 @@ namespace PortfolioExplorer {
 				memcpy(&lon, clon, 4);
 			}
 
+			recordsDecoded[Geocoder::ProfilePostcodeCentroid]++;
 			postcodeCentroidReturn.postcode[GeoUtil::PostcodeCentroidPostcodeFieldLength] = 0;
 			postcodeCentroidReturn.latitude = (double)lat / 100000.0;
 			postcodeCentroidReturn.longitude = (double)lon / 100000.0;
@@ -34,15 +34,76 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../global/LookupTable.h"
 #include "GeoQueryItf.h"
 #include "../geocommon/GeoDataInput.h"
+#include "../geocommon/GeoPackedTable.h"
+#include "../geocommon/GeoChecksum.h"
+#include "GeoDelta.h"
 #include "../global/SetAssocCache.h"
 
 namespace PortfolioExplorer {
+	///////////////////////////////////////////////////////////////////////////
+	// The Huffman coders used for decoding records.  They are filled by the
+	// first QueryImp::Open() and only read after that, so query objects on
+	// the same database may share them (see QueryImp::SetSharedCoders).
+	///////////////////////////////////////////////////////////////////////////
+	struct QueryCoders : public VRefCount {
+		QueryCoders() : loaded(false) {}
+
+		// Have the code tables been read?
+		bool loaded;
+
+		// StreetName
+		HuffmanCoder<int, std::less<int> > streetNameCityStatePostcodeIDCoder;
+		HuffmanCoder<TsString, std::less<TsString> > streetNamePrefixCoder;
+		HuffmanCoder<TsString, std::less<TsString> > streetNamePredirCoder;
+		HuffmanCoder<int, std::less<int> > streetNameNameCoder;
+		HuffmanCoder<TsString, std::less<TsString> > streetNameSuffixCoder;
+		HuffmanCoder<TsString, std::less<TsString> > streetNamePostdirCoder;
+		HuffmanCoder<int, std::less<int> > streetNameStreetSegmentIDFirstCoder;
+		HuffmanCoder<int, std::less<int> > streetNameStreetSegmentCountCoder;
+		// StreetSegment
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowKeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowKeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowNonkeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowNonkeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrHighCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentAddrHighCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentCountyKeyCoder;
+		HuffmanCoder<int, std::less<int> > streetSegmentCountyNonkeyCoder;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractKeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractKeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractNonkeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractNonkeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockKeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockKeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockNonkeyCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockNonkeyCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentPostcodeExtKeyCoder;
+		HuffmanCoder<int, std::less<int> > streetSegmentPostcodeExtNonkeyCoder;
+		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateIDCoder1;
+		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateIDCoder2;
+		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateCountCoder;
+		// Coordinate
+		HuffmanCoder<int, std::less<int> > coordinateLatitudeCoder1;
+		HuffmanCoder<int, std::less<int> > coordinateLatitudeCoder2;
+		HuffmanCoder<int, std::less<int> > coordinateLongitudeCoder1;
+		HuffmanCoder<int, std::less<int> > coordinateLongitudeCoder2;
+		// StreetIntersection
+		HuffmanCoder<int, std::less<int> > streetIntersectionStateCoder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionSoundex1Coder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionStreetNameID1Coder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionStreetSegmentOffset1Coder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionSoundex2Coder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionStreetNameID2Coder;
+		HuffmanCoder<int, std::less<int> > streetIntersectionStreetSegmentOffset2Coder;
+	};
+	typedef refcnt_ptr<QueryCoders> QueryCodersRef;
+
 	///////////////////////////////////////////////////////////////////////////
 	// Internal query interface class.  Provides a query interface to the 
 	// geocoder that can be implemented using any of several methods.
 	// This implementation is built upon an indexed compressed file structure.
 	///////////////////////////////////////////////////////////////////////////
-	class QueryImp : public GeoUtil, public VRefCount {
+	class QueryImp : public GeoUtil, public VRefCount, public ChecksumErrorListener {
 
 	public:
 		// nested forward decl and friends.
@@ -104,6 +165,27 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////
 		bool IsOpen() const { return isOpen; }
 
+		///////////////////////////////////////////////////////////////////////
+		// Use Huffman coders shared with other query objects on the same
+		// database.  The first Open() of any of them reads the code tables;
+		// the others use them as they are.  Opens must not overlap until
+		// one has succeeded.  Call before Open().
+		///////////////////////////////////////////////////////////////////////
+		void SetSharedCoders(QueryCodersRef coders_) { sharedCoders = coders_; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Set how the database files are checked against the checksum
+		// manifest by Open().
+		// Inputs:
+		//	Geocoder::VerifyMode	mode		How to check the files
+		//	int						nbrThreads	Threads for VerifyAtOpen; 0 for
+		//										one per processor
+		///////////////////////////////////////////////////////////////////////
+		void SetVerifyMode(Geocoder::VerifyMode mode, int nbrThreads) {
+			verifyMode = mode;
+			verifyThreads = nbrThreads;
+		}
+
 		///////////////////////////////////////////////////////////////////////
 		// Close the reference query interface.
 		///////////////////////////////////////////////////////////////////////
@@ -314,22 +396,35 @@ namespace PortfolioExplorer {
 		public:
 			StreetNameFromFaStreetIterator() {}
 			bool Next(StreetName& streetNameReturn) {
-				if (
-					!queryImp->GetStreetNameSoundexByIDCached(current, streetNameSoundexTmp) ||
-					strcmp(streetNameSoundexTmp.financeNumber, financeNumber) != 0 ||
-					strcmp(streetNameSoundexTmp.streetSoundex, soundex) != 0
-				) {
-					// Ran out of matching soundex entries.
-					return false;
-				}
-				if (
-					!queryImp->GetStreetNameByIDCached(streetNameSoundexTmp.streetNameID, streetNameReturn)
-				) {
-					// Cannot read indexed entry.  This is a pretty bad problem.
-					return false;
+				// Base soundex entries come first.
+				while (current >= 0) {
+					if (
+						!queryImp->GetStreetNameSoundexByIDCached(current, streetNameSoundexTmp) ||
+						strcmp(streetNameSoundexTmp.financeNumber, financeNumber) != 0 ||
+						strcmp(streetNameSoundexTmp.streetSoundex, soundex) != 0
+					) {
+						// Ran out of matching soundex entries.
+						current = -1;
+						break;
+					}
+					if (queryImp->IsStreetNameSoundexDeleted(streetNameSoundexTmp)) {
+						// Removed by the delta overlay.
+						current++;
+						continue;
+					}
+					if (
+						!queryImp->GetStreetNameByIDCached(streetNameSoundexTmp.streetNameID, streetNameReturn)
+					) {
+						// Cannot read indexed entry.  This is a pretty bad problem.
+						return false;
+					}
+					current++;
+					return true;
 				}
-				current++;
-				return true;
+				// Then the entries added by the delta overlay.
+				return 
+					deltaCurrent >= 0 &&
+					queryImp->NextDeltaStreetName(financeNumber, soundex, deltaCurrent, streetNameReturn);
 			}
 		private:
 			// Valid iterator
@@ -337,10 +432,12 @@ namespace PortfolioExplorer {
 				QueryImp* queryImp_,
 				const char* financeNumber_,
 				const char* streetSoundex_,
-				int current_
+				int current_,
+				int deltaCurrent_ = -1
 			) :
 				queryImp(queryImp_),
-				current(current_)
+				current(current_),
+				deltaCurrent(deltaCurrent_)
 			{
 				assert(strlen(streetSoundex_) == 4);
 				strcpy(soundex, streetSoundex_);
@@ -350,7 +447,8 @@ namespace PortfolioExplorer {
 			// Invalid iterator
 			StreetNameFromFaStreetIterator(QueryImp* queryImp_) :
 				queryImp(queryImp_),
-				current(-1)
+				current(-1),
+				deltaCurrent(-1)
 			{
 				strcpy(soundex, "");
 			}
@@ -358,7 +456,8 @@ namespace PortfolioExplorer {
 			QueryImp* queryImp;
 			char financeNumber[7];		// finance number being searched
 			char soundex[5];			// soundex value
-			int current;				// the current StreetNameID
+			int current;				// the current StreetNameSoundex ID, or -1 when done
+			int deltaCurrent;			// the current delta soundex entry, or -1 when done
 			StreetNameSoundex streetNameSoundexTmp;
 		};
 
@@ -379,6 +478,10 @@ namespace PortfolioExplorer {
 		public:
 			StreetSegmentFromStreetNameIterator() {}
 			bool Next(StreetSegment& streetSegmentReturn) {
+				// Skip segments removed by the delta overlay.
+				while (current < last && queryImp->IsStreetSegmentDeleted(current)) {
+					current++;
+				}
 				if (current >= last) {
 					return false;
 				}
@@ -430,6 +533,10 @@ namespace PortfolioExplorer {
 		public:
 			CoordinatePointsFromStreetSegmentIterator() {}
 			bool Next(CoordinatePoint& coordinateReturn) {
+				// Skip points removed by the delta overlay.
+				while (current < last && queryImp->IsCoordinateDeleted(current)) {
+					current++;
+				}
 				if (current >= last) {
 					return false;
 				}
@@ -481,22 +588,29 @@ namespace PortfolioExplorer {
 		public:
 			StreetIntersectionIterator() {}
 			bool Next(StreetIntersection& streetIntersectionReturn) {
-				if (
-					!queryImp->GetStreetIntersectionSoundexByIDCached(current, intersectionSoundexTmp) ||
-					strcmp(intersectionSoundexTmp.streetSoundex1, soundex1) != 0 ||
-					strcmp(intersectionSoundexTmp.streetSoundex2, soundex2) != 0
-				) {
-					// Ran out of matching soundex entries.
-					return false;
-				}
-				if (
-					!queryImp->GetStreetIntersectionFromStreetIntersectionSoundex(intersectionSoundexTmp, streetIntersectionReturn)
-				) {
-					// Cannot read indexed entry.  This is a pretty bad problem.
-					return false;
+				while (true) {
+					if (
+						!queryImp->GetStreetIntersectionSoundexByIDCached(current, intersectionSoundexTmp) ||
+						strcmp(intersectionSoundexTmp.streetSoundex1, soundex1) != 0 ||
+						strcmp(intersectionSoundexTmp.streetSoundex2, soundex2) != 0
+					) {
+						// Ran out of matching soundex entries.
+						return false;
+					}
+					if (queryImp->IsStreetIntersectionSoundexDeleted(intersectionSoundexTmp)) {
+						// A street or segment was removed by the delta overlay.
+						current++;
+						continue;
+					}
+					if (
+						!queryImp->GetStreetIntersectionFromStreetIntersectionSoundex(intersectionSoundexTmp, streetIntersectionReturn)
+					) {
+						// Cannot read indexed entry.  This is a pretty bad problem.
+						return false;
+					}
+					current++;
+					return true;
 				}
-				current++;
-				return true;
 			}
 		private:
 			// Valid iterator 
@@ -710,6 +824,13 @@ namespace PortfolioExplorer {
 			}
 		}
 
+		///////////////////////////////////////////////////////////////////////
+		// Get the number of CityStatePostcodeFaIndex records.
+		///////////////////////////////////////////////////////////////////////
+		int GetCityStatePostcodeFaIndexCount() const {
+			return cityStatePostcodeFaIndexCount;
+		}
+
 		///////////////////////////////////////////////////////////////////////
 		// Given the ID (postition) of a CityStatePostcodeFaIndex record, get the record.
 		// Cached and non-cached versions.
@@ -850,6 +971,13 @@ namespace PortfolioExplorer {
 			}
 		}
 
+		///////////////////////////////////////////////////////////////////////
+		// Get the number of PostcodeCentroid records.
+		///////////////////////////////////////////////////////////////////////
+		int GetPostcodeCentroidCount() const {
+			return postcodeCentroidCount;
+		}
+
 		///////////////////////////////////////////////////////////////////////
 		// Read a centroid given its positional ID.
 		///////////////////////////////////////////////////////////////////////
@@ -923,7 +1051,7 @@ namespace PortfolioExplorer {
 		// Get the number of StreetName records.
 		///////////////////////////////////////////////////////////////////////
 		int GetStreetNameCount() {
-			return streetNameCount;
+			return delta.get() != 0 ? delta->GetStreetNameCount() : streetNameCount;
 		}
 
 		///////////////////////////////////////////////////////////////////////
@@ -1005,7 +1133,7 @@ namespace PortfolioExplorer {
 		// Get the number of StreetSegment records.
 		///////////////////////////////////////////////////////////////////////
 		int GetStreetSegmentCount() {
-			return streetSegmentCount;
+			return delta.get() != 0 ? delta->GetStreetSegmentCount() : streetSegmentCount;
 		}
 
 		///////////////////////////////////////////////////////////////////////
@@ -1032,7 +1160,7 @@ namespace PortfolioExplorer {
 		// Get the number of Coordinate records
 		///////////////////////////////////////////////////////////////////////
 		int GetCoordinateCount() {
-			return coordinateCount;
+			return delta.get() != 0 ? delta->GetCoordinateCount() : coordinateCount;
 		}
 
 		///////////////////////////////////////////////////////////////////////
@@ -1096,12 +1224,113 @@ namespace PortfolioExplorer {
 			StreetIntersection& streetIntersectionReturn
 		);
 
+		///////////////////////////////////////////////////////////////////////
+		// The delta overlay loaded from the database directory, or null
+		// if there is none.
+		///////////////////////////////////////////////////////////////////////
+		const GeoDelta* GetDelta() const {
+			return delta.get();
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Has the delta overlay deleted a record?  The iterators skip these.
+		///////////////////////////////////////////////////////////////////////
+		bool IsStreetSegmentDeleted(int streetSegmentID) const {
+			return delta.get() != 0 && delta->IsStreetSegmentDeleted(streetSegmentID);
+		}
+		bool IsCoordinateDeleted(int coordinateID) const {
+			return delta.get() != 0 && delta->IsCoordinateDeleted(coordinateID);
+		}
+		bool IsStreetIntersectionSoundexDeleted(const StreetIntersectionSoundex& streetIntersectionSoundex);
+		bool IsStreetNameSoundexDeleted(const StreetNameSoundex& streetNameSoundex) const {
+			return delta.get() != 0 && (
+				delta->IsStreetNameDeleted(streetNameSoundex.streetNameID) ||
+				delta->IsStreetNameSoundexDeleted(
+					streetNameSoundex.financeNumber,
+					streetNameSoundex.streetSoundex,
+					streetNameSoundex.streetNameID
+				)
+			);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the next StreetName from the soundex entries added by the delta.
+		// Inputs:
+		//	const char*		financeNumber	The finance number being searched
+		//	const char*		streetSoundex	The soundex being searched
+		// Outputs:
+		//	int&			deltaCurrent	Position in the delta's soundex
+		//									entries; set to -1 when done.
+		//	StreetName&		streetNameReturn	The next StreetName
+		// Return value:
+		//	bool	true if a StreetName was returned.
+		///////////////////////////////////////////////////////////////////////
+		bool NextDeltaStreetName(
+			const char* financeNumber,
+			const char* streetSoundex,
+			int& deltaCurrent,
+			StreetName& streetNameReturn
+		);
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the counters kept for profiling since the object was made: the
+		// records decoded per table, the bits decoded and, since Open(), the
+		// hits and misses of each cache.  The phase times are not set.
+		// Outputs:
+		//	Geocoder::RequestStats&		countersReturn	The counters
+		///////////////////////////////////////////////////////////////////////
+		void GetProfileCounters(Geocoder::RequestStats& countersReturn);
+
 		///////////////////////////////////////////////////////////////////////
 		// Override this to get error messages
 		///////////////////////////////////////////////////////////////////////
 		virtual void ErrorMessage(const TsString& msg) {}
 
+		///////////////////////////////////////////////////////////////////////
+		// Checksum failures found while reading are reported as errors.
+		///////////////////////////////////////////////////////////////////////
+		virtual void ChecksumError(const TsString& msg) { ErrorMessage(msg); }
+
 	private:
+		///////////////////////////////////////////////////////////////////////
+		// Load the checksum manifest and, for VerifyAtOpen, check every file
+		// against it.
+		// Return value:
+		//	bool	true on success, false on error (reported via ErrorMessage).
+		///////////////////////////////////////////////////////////////////////
+		bool LoadChecksums();
+
+		///////////////////////////////////////////////////////////////////////
+		// For VerifyLazy, make the checker for a data file that verifies its
+		// parts as they are read.  The file size is checked immediately.
+		// Inputs:
+		//	const TsString&		filename	Name of the file in the database
+		//	int					fileSize	Actual size of the file
+		// Return value:
+		//	LazyChecksumRef		The checker, or 0 on error (reported via
+		//						ErrorMessage).
+		///////////////////////////////////////////////////////////////////////
+		LazyChecksumRef MakeLazyChecksum(const TsString& filename, int fileSize);
+
+		///////////////////////////////////////////////////////////////////////
+		// Determine whether the database was written in the packed format,
+		// by looking for GeoUtil::PACKED_FORMAT_FLAG after the data version
+		// in the version file.
+		///////////////////////////////////////////////////////////////////////
+		bool IsPackedDatabase();
+
+		///////////////////////////////////////////////////////////////////////
+		// Read and decode a block of a packed table into the decoded-block
+		// members below.  The column order must match the loaders.
+		// Inputs:
+		//	int		blockIdx	The block to read
+		// Return value:
+		//	bool	true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool ReadPackedStreetNameBlock(int blockIdx);
+		bool ReadPackedStreetSegmentBlock(int blockIdx);
+		bool ReadPackedCoordinateBlock(int blockIdx);
+
 		// Is the query object open?
 		bool isOpen;
 
@@ -1109,53 +1338,10 @@ namespace PortfolioExplorer {
 		TsString databaseDir;
 		TsString tableDir;
 
-		///////////////////////////////////////////////////////////////////////
-		// Huffman coders used for decoding various records
-		///////////////////////////////////////////////////////////////////////
-		// StreetName
-		HuffmanCoder<int, std::less<int> > streetNameCityStatePostcodeIDCoder;
-		HuffmanCoder<TsString, std::less<TsString> > streetNamePrefixCoder;
-		HuffmanCoder<TsString, std::less<TsString> > streetNamePredirCoder;
-		HuffmanCoder<int, std::less<int> > streetNameNameCoder;
-		HuffmanCoder<TsString, std::less<TsString> > streetNameSuffixCoder;
-		HuffmanCoder<TsString, std::less<TsString> > streetNamePostdirCoder;
-		HuffmanCoder<int, std::less<int> > streetNameStreetSegmentIDFirstCoder;
-		HuffmanCoder<int, std::less<int> > streetNameStreetSegmentCountCoder;
-		// StreetSegment
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowKeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowKeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowNonkeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrLowNonkeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrHighCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentAddrHighCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentCountyKeyCoder;
-		HuffmanCoder<int, std::less<int> > streetSegmentCountyNonkeyCoder;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractKeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractKeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractNonkeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusTractNonkeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockKeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockKeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockNonkeyCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentCensusBlockNonkeyCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentPostcodeExtKeyCoder;
-		HuffmanCoder<int, std::less<int> > streetSegmentPostcodeExtNonkeyCoder;
-		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateIDCoder1;
-		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateIDCoder2;
-		HuffmanCoder<int, std::less<int> > streetSegmentCoordinateCountCoder;
-		// Coordinate
-		HuffmanCoder<int, std::less<int> > coordinateLatitudeCoder1;
-		HuffmanCoder<int, std::less<int> > coordinateLatitudeCoder2;
-		HuffmanCoder<int, std::less<int> > coordinateLongitudeCoder1;
-		HuffmanCoder<int, std::less<int> > coordinateLongitudeCoder2;
-		// StreetIntersection
-		HuffmanCoder<int, std::less<int> > streetIntersectionStateCoder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionSoundex1Coder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionStreetNameID1Coder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionStreetSegmentOffset1Coder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionSoundex2Coder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionStreetNameID2Coder;
-		HuffmanCoder<int, std::less<int> > streetIntersectionStreetSegmentOffset2Coder;
+		// Huffman coders used for decoding various records.  They are shared
+		// when set by SetSharedCoders(), and otherwise belong to this object.
+		QueryCodersRef coders;
+		QueryCodersRef sharedCoders;
 
 		// Inputs for reading reference data files.
 		DataInput cityStatePostcodeInput;
@@ -1174,6 +1360,39 @@ namespace PortfolioExplorer {
 		DataInput postcodeAliasByGroupInput;
 		DataInput postcodeCentroidInput;
 
+		// Checking of the files against the checksum manifest.
+		Geocoder::VerifyMode verifyMode;
+		int verifyThreads;
+		ChecksumManifestRef checksumManifest;
+		// Files checked as they are read in VerifyLazy mode.
+		std::set<TsString> lazyChecksumFiles;
+
+		// Packed tables, used instead of the StreetName, StreetSegment and
+		// Coordinate data files when the database is in the packed format.
+		bool packedData;
+		PackedTableReader streetNamePacked;
+		PackedTableReader streetSegmentPacked;
+		PackedTableReader coordinatePacked;
+
+		// Most recently decoded block of each packed table.
+		int packedStreetNameBlock;
+		std::vector<StreetName> packedStreetNames;
+		int packedStreetSegmentBlock;
+		std::vector<StreetSegment> packedStreetSegments;
+		int packedCoordinateBlock;
+		std::vector<int> packedLatitudes;
+		std::vector<int> packedLongitudes;
+		// Scratch space for reading packed blocks.
+		std::vector<unsigned char> packedBytes;
+		std::vector<int> packedColumn;
+		std::vector<char> packedChars;
+
+		// Records decoded from each table, and bits of packed blocks read,
+		// for GetProfileCounters().  Bits read from the bit-coded files are
+		// counted by their BitStreamReads.
+		long recordsDecoded[Geocoder::NbrProfileTables];
+		__int64 packedBitsRead;
+
 		// Counts of the number of records.
 		unsigned cityStatePostcodeCount;
 		unsigned cityStatePostcodeSoundexCount;
@@ -1186,6 +1405,10 @@ namespace PortfolioExplorer {
 		unsigned postcodeAliasCount;
 		unsigned postcodeCentroidCount;
 
+		// Added, changed and deleted records that override the base files.
+		// Null if the database has no delta file.
+		GeoDeltaRef delta;
+
 		// General-purpose temporaries.
 		// Putting here avoids reconstruction.
 		TsString tmpStr;
@@ -69,6 +69,14 @@ namespace PortfolioExplorer {
 	void Geocoder::TraceMessage(const char* message)
 	{
 	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Turn trace messages on or off.
+	///////////////////////////////////////////////////////////////////////
+	void Geocoder::SetTrace(bool trace)
+	{
+		imp->SetTrace(trace);
+	}
 #endif
 
 	// Open the Geocoder instance using the given query interface.
@@ -103,6 +111,23 @@ namespace PortfolioExplorer {
 		return imp->CodeAddress(line1, line2);
 	}
 
+	///////////////////////////////////////////////////////////////////////
+	// Code an address whose components have already been separated.
+	// Call GetNextCandidate() to check results.
+	// Inputs:
+	//	const AddressFields&	fields			address components
+	//	bool					replaceAliases	substitute standard aliases
+	// Return value:
+	//	GlobalStatus		A status code indicating the overall result of
+	//						the geocoding process
+	///////////////////////////////////////////////////////////////////////
+	Geocoder::GlobalStatus Geocoder::CodeAddressFields(
+		const AddressFields& fields,
+		bool replaceAliases
+	) {
+		return imp->CodeAddressFields(fields, replaceAliases);
+	}
+
 	///////////////////////////////////////////////////////////////////////
 	// Fetch candidate address interpretations for the last
 	// call to CodeAddress().  The candidates will be returned in 
@@ -127,6 +152,14 @@ namespace PortfolioExplorer {
 		imp->SetMatchThreshold(threshold);
 	}
 
+	///////////////////////////////////////////////////////////////////////
+	// Set how the database files are checked against their checksums.
+	///////////////////////////////////////////////////////////////////////
+	void Geocoder::SetVerifyMode(VerifyMode mode, int nbrThreads)
+	{
+		imp->SetVerifyMode(mode, nbrThreads);
+	}
+
 	///////////////////////////////////////////////////////////////////////
 	// Set the score delta that determines a multiple (0-1000)
 	///////////////////////////////////////////////////////////////////////
@@ -226,5 +259,38 @@ namespace PortfolioExplorer {
 	{
 		return GeocoderImp::CheckDataVersion(pDataDir);
 	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Profiling of the phases of each request.
+	///////////////////////////////////////////////////////////////////////
+	void Geocoder::SetProfiling(bool profiling)
+	{
+		imp->SetProfiling(profiling);
+	}
+
+	bool Geocoder::GetProfiling() const
+	{
+		return imp->GetProfiling();
+	}
+
+	bool Geocoder::GetRequestStats(RequestStats& statsReturn)
+	{
+		return imp->GetRequestStats(statsReturn);
+	}
+
+	void Geocoder::GetProfileTotals(RequestStats& totalsReturn, long& nbrRequestsReturn)
+	{
+		imp->GetProfileTotals(totalsReturn, nbrRequestsReturn);
+	}
+
+	bool Geocoder::GetLatencyHistogram(int phase, LatencyHistogram& histogramReturn)
+	{
+		return imp->GetLatencyHistogram(phase, histogramReturn);
+	}
+
+	void Geocoder::ResetProfile()
+	{
+		imp->ResetProfile();
+	}
 }
 
@@ -55,6 +55,14 @@ namespace PortfolioExplorer {
 			MemUseLarge			// 3x normal ~= 27MB
 		};
 
+		// Checking of the database files against the checksum manifest
+		// written by the loaders.
+		enum VerifyMode {
+			VerifyNone,			// DEFAULT; trust the files
+			VerifyAtOpen,		// Check every file when opening, using several threads
+			VerifyLazy			// Check each part of a data file when it is first read
+		};
+
 		// Possible global status return values from CodeAddress().
 		enum GlobalStatus {
 			GlobalSingle,		// There is a distinguished "best" result
@@ -193,6 +201,98 @@ namespace PortfolioExplorer {
 												// owner (because three-letter postcode granularity holds several cities).
 		};
 
+		// Phases of coding an address, for profiling.  Time spent in
+		// CodeAddress() and GetNextCandidate() outside the named phases is
+		// counted as ProfileOther.
+		enum ProfilePhase {
+			ProfileLastLineParse,		// parsing the city/state/postcode line
+			ProfileChooseLastLine,		// ChooseBestLastLine(): finding the City/State/Postcode records
+			ProfileFirstLineParse,		// parsing the street address line
+			ProfileStreetNameFetch,		// looking up street names and intersections
+			ProfileSegmentScoring,		// reading and scoring street segments
+			ProfileSortResults,			// sorting the candidates and removing duplicates
+			ProfileCodeResult,			// interpolating the coordinates of a candidate
+			ProfileOther,
+			NbrProfilePhases,
+			ProfileTotal = NbrProfilePhases	// the whole request, for GetLatencyHistogram()
+		};
+
+		// Database tables, for counting the records decoded while profiling.
+		enum ProfileTable {
+			ProfileCityStatePostcode,
+			ProfileCityStatePostcodeFaIndex,
+			ProfileCitySoundex,
+			ProfileStreetName,
+			ProfileStreetNameSoundex,
+			ProfileStreetSegment,
+			ProfileCoordinate,
+			ProfileStreetIntersectionSoundex,
+			ProfilePostcodeAlias,
+			ProfilePostcodeCentroid,
+			NbrProfileTables
+		};
+
+		// Record caches, for counting the hits and misses while profiling.
+		enum ProfileCache {
+			ProfileCacheCityStatePostcodeByID,
+			ProfileCacheCityStatePostcodeSoundexByID,
+			ProfileCacheCityStatePostcodeFaIndexByID,
+			ProfileCacheCityStatePostcodeFaIndexFromFa,
+			ProfileCacheStreetNameByID,
+			ProfileCacheStreetNameSoundexByID,
+			ProfileCacheStreetNameSoundexFaSoundex,
+			ProfileCacheStreetSegmentByID,
+			ProfileCacheCoordinateByID,
+			ProfileCacheStreetIntersectionSoundexByID,
+			ProfileCachePostcodeAliasByPostcodeID,
+			ProfileCachePostcodeAliasByGroupID,
+			ProfileCachePostcodeGroupFromPostcode,
+			ProfileCachePostcodeGroupIDFromPostcodeGroup,
+			ProfileCachePostcodeCentroidByID,
+			ProfileCachePostcodeCentroidFromPostcode,
+			NbrProfileCaches
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// Counters for one request (a CodeAddress() or CodeAddressFields()
+		// call and the GetNextCandidate() calls that follow it), or summed
+		// over many.  Records decoded counts every record read from a file
+		// or unpacked, including those passed over to reach the one wanted;
+		// bits decoded counts the bits read from the bit-coded files and
+		// the packed blocks.
+		///////////////////////////////////////////////////////////////////////
+		struct RequestStats {
+			RequestStats() { Clear(); }
+			void Clear();
+			void Add(const RequestStats& rhs);
+			double phaseMicroseconds[NbrProfilePhases];
+			double totalMicroseconds;
+			long recordsDecoded[NbrProfileTables];
+			long cacheHits[NbrProfileCaches];
+			long cacheMisses[NbrProfileCaches];
+			double bitsDecoded;
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// Latency histogram with power-of-two buckets: bucket 0 counts the
+		// requests under 1 microsecond, bucket i those from 2^(i-1) up to
+		// 2^i microseconds, and the last bucket everything longer.
+		///////////////////////////////////////////////////////////////////////
+		struct LatencyHistogram {
+			enum { NbrBuckets = 24 };
+			LatencyHistogram() { Clear(); }
+			void Clear();
+			void Add(double microseconds);
+			// Upper bound of a bucket, in microseconds; the last is unbounded.
+			static double BucketLimit(int bucket);
+			// Estimate the latency below which the given fraction (0-1) of
+			// the samples fall, from the bucket limits.
+			double Percentile(double fraction) const;
+			long counts[NbrBuckets];
+			long nbrSamples;
+			double totalMicroseconds;
+		};
+
 		///////////////////////////////////////////////////////////////////////
 		// Constructor.  
 		// Inputs:
@@ -225,6 +325,13 @@ namespace PortfolioExplorer {
 		// Override this to intercept human-readable debug trace messages.
 		///////////////////////////////////////////////////////////////////////
 		virtual void TraceMessage(const char* message);
+
+		///////////////////////////////////////////////////////////////////////
+		// Turn trace messages on or off.  They are off by default, debug
+		// builds included, so TraceMessage() is not called until this is
+		// called with true.  While off, the messages are not formatted at all.
+		///////////////////////////////////////////////////////////////////////
+		void SetTrace(bool trace);
 #endif
 
 		///////////////////////////////////////////////////////////////////////
@@ -255,6 +362,48 @@ namespace PortfolioExplorer {
 			const char* line2					// city, state, zip
 		);
 
+		///////////////////////////////////////////////////////////////////////
+		// Address components for CodeAddressFields().  Any member may be
+		// null or empty.  The strings must remain valid for the duration of 
+		// the call only.
+		///////////////////////////////////////////////////////////////////////
+		struct AddressFields {
+			AddressFields() :
+				addrNbr(0), predir(0), street(0), suffix(0), postdir(0),
+				unitDes(0), unit(0), city(0), state(0), postcode(0)
+			{}
+			const char* addrNbr;		// address number
+			const char* predir;			// predirectional
+			const char* street;			// street name
+			const char* suffix;			// street suffix
+			const char* postdir;		// postdirectional
+			const char* unitDes;		// unit designator
+			const char* unit;			// unit
+			const char* city;			// city name
+			const char* state;			// state name or abbreviation
+			const char* postcode;		// ZIP, ZIP+4 or Canadian postal code
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// Code an address whose components have already been separated.
+		// This bypasses the address parsers, which is much faster than 
+		// CodeAddress() when the input is already parsed.  The components
+		// are matched as given; only standard aliases are substituted
+		// (e.g. NORTH --> N, STREET --> ST, APARTMENT --> APT, 
+		// COLORADO --> CO) unless replaceAliases is false.
+		// Call GetNextCandidate() to check results.
+		// Inputs:
+		//	const AddressFields&	fields			address components
+		//	bool					replaceAliases	substitute standard aliases
+		// Return value:
+		//	GlobalStatus		A status code indicating the overall result of
+		//						the geocoding process
+		///////////////////////////////////////////////////////////////////////
+		GlobalStatus CodeAddressFields(
+			const AddressFields& fields,
+			bool replaceAliases = true
+		);
+
 		///////////////////////////////////////////////////////////////////////
 		// Fetch candidate address interpretations for the last
 		// call to CodeAddress().  The candidates will be returned in 
@@ -274,6 +423,19 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////
 		void SetMatchThreshold(int threshold);
 
+		///////////////////////////////////////////////////////////////////////
+		// Set how the database files are checked against their checksums.
+		// Call before Open().  With VerifyAtOpen, Open() fails if any file
+		// does not match.  With VerifyLazy, Open() checks the file sizes and
+		// the small files, and lookups in a part of a data file that does
+		// not match fail and are reported through ErrorMessage().
+		// Inputs:
+		//	VerifyMode		mode		How to check the files
+		//	int				nbrThreads	Threads for VerifyAtOpen; 0 for one
+		//								per processor
+		///////////////////////////////////////////////////////////////////////
+		void SetVerifyMode(VerifyMode mode, int nbrThreads = 0);
+
 		///////////////////////////////////////////////////////////////////////
 		// Set the score delta that determines a multiple (0-1000)
 		///////////////////////////////////////////////////////////////////////
@@ -351,7 +513,58 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////
 		static bool CheckDataVersion(const char * pDataDir);
 
+		///////////////////////////////////////////////////////////////////////
+		// Turn profiling on or off; it is off by default.  While on, each
+		// request is split into the ProfilePhase phases and timed, and its
+		// counters are kept for GetRequestStats() and added to the totals.
+		// While off, the cost is a test per phase.
+		///////////////////////////////////////////////////////////////////////
+		void SetProfiling(bool profiling);
+		bool GetProfiling() const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the counters of the latest request made while profiling.
+		// Outputs:
+		//	RequestStats&	statsReturn		The counters
+		// Return value:
+		//	bool		false if no request has been profiled.
+		///////////////////////////////////////////////////////////////////////
+		bool GetRequestStats(RequestStats& statsReturn);
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the counters summed over all requests profiled since the last
+		// ResetProfile().
+		// Outputs:
+		//	RequestStats&	totalsReturn		The summed counters
+		//	long&			nbrRequestsReturn	The number of requests
+		///////////////////////////////////////////////////////////////////////
+		void GetProfileTotals(RequestStats& totalsReturn, long& nbrRequestsReturn);
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the histogram of a phase's time per request, or of the whole
+		// request's for ProfileTotal, since the last ResetProfile().
+		// Requests that do not enter a phase are not counted in its histogram.
+		// Return value:
+		//	bool		false if the phase is out of range.
+		///////////////////////////////////////////////////////////////////////
+		bool GetLatencyHistogram(int phase, LatencyHistogram& histogramReturn);
+
+		///////////////////////////////////////////////////////////////////////
+		// Clear the totals and histograms.
+		///////////////////////////////////////////////////////////////////////
+		void ResetProfile();
+
+		///////////////////////////////////////////////////////////////////////
+		// Names of the phases, tables and caches for reports; "" if out of range.
+		///////////////////////////////////////////////////////////////////////
+		static const char* GetProfilePhaseName(int phase);
+		static const char* GetProfileTableName(int table);
+		static const char* GetProfileCacheName(int cache);
+
 	private:
+		// GeocoderPool hands its geocoders shared tables before Open().
+		friend class GeocoderPoolImp;
+
 		// The implementation class that really does all the work.
 		// It contains methods that are an exact reflection of the 
 		// external interface methods.
@@ -36,7 +36,6 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 #endif
 
-#include <xercesc/util/PlatformUtils.hpp>
 
 #include "../global/Soundex.h"
 #include "GeocoderImp.h"
@@ -45,11 +44,12 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GeoDataVersion.h"
 #include "../global/Filesys.h"
 
-XERCES_CPP_NAMESPACE_USE
 
-// Debug tracing
+// Debug tracing.  The message is only built when tracing is on.
 #ifdef NDEBUG
 	#define GEOTRACE(x)
+#else
+	#define GEOTRACE(x) if (!traceEnabled) {} else Trace(x)
 #endif
 
 namespace PortfolioExplorer {
@@ -94,6 +94,9 @@ namespace PortfolioExplorer {
 		minInterpolation(-1.0),
 		maxInterpolation(2.0),
 		streetOwnerTreatment(Geocoder::ChooseStreetOwnerCountrySpecific),
+#ifndef NDEBUG
+		traceEnabled(false),
+#endif
 		m_LastLineThresholdZipOnly(900),
 		m_LastLineCityWeight(334),
 		m_LastLineStateWeight(333),
@@ -120,8 +123,7 @@ namespace PortfolioExplorer {
 		m_FirstLineRangeAlphaWeight(100),
 		m_FirstLineRangeEvenOddWeight(300),
 		m_FirstLineRangeEvenOddUnknownWeight(30),
-		m_FirstLineOutOfRangeWeight(400),
-		m_bXmlInitialized(false)
+		m_FirstLineOutOfRangeWeight(400)
 	{
 		bulkAllocator = new BulkAllocator;
 		queryItf = new QueryImpErrorMsg(tableDir, databaseDir, memUse, geocoder_);
@@ -142,19 +144,6 @@ namespace PortfolioExplorer {
 	///////////////////////////////////////////////////////////////////////
 	bool GeocoderImp::Open()
 	{
-		// Initialize the XML4C system
-		// We put this here to prevent callers from needing to deal with XML stuff.
-		try
-		{
-			XMLPlatformUtils::Initialize();
-			m_bXmlInitialized = true;
-		}
-		catch (const XMLException& )
-		{
-			geocoder.ErrorMessage("Xerces XML initialization failed");
-			return false;
-		}
-
 		try {
 			// Before opening any interfaces, test for file existence and produce
 			// a better human-readable error message than sucomponents will.
@@ -183,6 +172,22 @@ namespace PortfolioExplorer {
 			}
 			const char* errorPtr;
 			TsString errorMsg;
+			// The parsers allocate from the same arena as the rest of a
+			// CodeAddress() call, and ClearResults() resets it.
+			addressParserFirstLine.SetBulkAllocator(bulkAllocator);
+			addressParserLastLine.SetBulkAllocator(bulkAllocator);
+			// Both parsers and the tokenizer load their tables through one
+			// ParserTableImage, which may be shared with other geocoders.
+			// Without a valid image file the tables are read from the source
+			// files, so a failure to open it is not an error.
+			ParserTableImageRef parserTableImage = sharedParserTables;
+			if (parserTableImage == 0) {
+				parserTableImage = new ParserTableImage;
+				TsString imageErrorMsg;
+				parserTableImage->Open(tableDir, imageErrorMsg);
+			}
+			addressParserFirstLine.SetParserTableImage(parserTableImage);
+			addressParserLastLine.SetParserTableImage(parserTableImage);
 			if (
 				!addressParserFirstLine.Open(tableDir.c_str(), errorPtr) ||
 				!addressParserLastLine.Open(tableDir.c_str(), errorPtr)
@@ -201,9 +206,6 @@ namespace PortfolioExplorer {
 				throw 1;
 			}
 		} catch (int) {
-			// Cleanup XML parsing
-			XMLPlatformUtils::Terminate();
-			m_bXmlInitialized = false;
 			return false;
 		}
 		// Read the ini file last.
@@ -386,9 +388,6 @@ namespace PortfolioExplorer {
 		addressParserFirstLine.Close();
 		addressParserLastLine.Close();
 		cityReplacementTable = 0;
-		// Cleanup XML parsing
-		if (m_bXmlInitialized)
-			XMLPlatformUtils::Terminate();
 	}
 
 	///////////////////////////////////////////////////////////////////////
@@ -405,54 +404,172 @@ namespace PortfolioExplorer {
 		const char* line2
 	) {
 		// Clear out information from last coding
-		bulkAllocator->Reset();
-		lastLineParseCandidates.clear();
-		firstLineParseCandidates.clear();
-		geocodeResults.clear();
-		sortedGeocodeResults.clear();
-		resultsCandidateIdx = 0;
-		resultsGlobalStatus = Geocoder::GlobalFailure;
+		ClearResults();
+		BeginProfiledRequest();
+		GeoProfiler::Scope requestScope(profiler, Geocoder::ProfileOther);
 
-		// Parse the last-line address.
-		if (!addressParserLastLine.Parse(line2, lastLineParseCandidates.UseExtraOnEnd(), true)) {
-			// No last line candidate was found
-			resultsGlobalStatus = Geocoder::GlobalFailure;
-			return resultsGlobalStatus; // Without a last line, we can't do anything (not even centroids). So, just get out;
-		}
-		addressParserLastLine.PermuteAddress(~0);
+		{
+			GeoProfiler::Scope parseScope(profiler, Geocoder::ProfileLastLineParse);
 
-		// Retrieve last-line parse permutations.
-		while (true) {
-			AddressParserLastLine::ParseCandidate& candidate = lastLineParseCandidates.UseExtraOnEnd();
-			if (!addressParserLastLine.NextAddressPermutation(candidate, true)) {
-				lastLineParseCandidates.pop_back();
-				break;
+			// Parse the last-line address.
+			if (!addressParserLastLine.Parse(line2, lastLineParseCandidates.UseExtraOnEnd(), true)) {
+				// No last line candidate was found
+				resultsGlobalStatus = Geocoder::GlobalFailure;
+				return resultsGlobalStatus; // Without a last line, we can't do anything (not even centroids). So, just get out;
+			}
+			addressParserLastLine.PermuteAddress(~0);
+
+			// Retrieve last-line parse permutations.
+			while (true) {
+				AddressParserLastLine::ParseCandidate& candidate = lastLineParseCandidates.UseExtraOnEnd();
+				if (!addressParserLastLine.NextAddressPermutation(candidate, true)) {
+					lastLineParseCandidates.pop_back();
+					break;
+				}
+				GEOTRACE(TsString("Parsed last-line candidate: (") + candidate.city + ") (" + candidate.state + ") (" + candidate.postcode + ")");
 			}
-			GEOTRACE(TsString("Parsed last-line candidate: (") + candidate.city + ") (" + candidate.state + ") (" + candidate.postcode + ")");
 		}
 
 		// Parse the first-line address and get the first candidate.
 		// Now parsing this BEFORE choosing a last line candidate, should that fail.
 		// This is so the user will know that the failure wasn't because we didn't look at
 		// their first line data (even though failing last line data aborts the process anyway).
-		AddressParserFirstLine::ParseCandidate& candidate = firstLineParseCandidates.UseExtraOnEnd();
-		if (!addressParserFirstLine.Parse(line1, candidate, true)) {
-			firstLineParseCandidates.pop_back();
-		} else {
-			GEOTRACE(TsString("Parsed first-line candidate: (") + candidate.number + ") (" + candidate.predir + ") (" + candidate.street + ") (" + candidate.suffix +") (" + candidate.postdir +") (" + candidate.unitDesignator +") (" + candidate.unitNumber + ") (" + candidate.street2 + ")");
+		{
+			GeoProfiler::Scope parseScope(profiler, Geocoder::ProfileFirstLineParse);
+
+			AddressParserFirstLine::ParseCandidate& candidate = firstLineParseCandidates.UseExtraOnEnd();
+			if (!addressParserFirstLine.Parse(line1, candidate, true)) {
+				firstLineParseCandidates.pop_back();
+			} else {
+				GEOTRACE(TsString("Parsed first-line candidate: (") + candidate.number + ") (" + candidate.predir + ") (" + candidate.street + ") (" + candidate.suffix +") (" + candidate.postdir +") (" + candidate.unitDesignator +") (" + candidate.unitNumber + ") (" + candidate.street2 + ")");
+			}
+
+			// Retrieve permutations of first-line parse candidates, using all available permutations.
+			addressParserFirstLine.PermuteAddress(~0);
+			while (true) {
+				AddressParserFirstLine::ParseCandidate& candidate = firstLineParseCandidates.UseExtraOnEnd();
+				if (!addressParserFirstLine.NextAddressPermutation(candidate, true)) {
+					firstLineParseCandidates.pop_back();
+					break;
+				}
+				GEOTRACE(TsString("Parsed first-line candidate: (") + candidate.number + ") (" + candidate.predir + ") (" + candidate.street + ") (" + candidate.suffix +") (" + candidate.postdir +") (" + candidate.unitDesignator +") (" + candidate.unitNumber + ") (" + candidate.street2 + ")");
+			}
 		}
 
-		// Retrieve permutations of first-line parse candidates, using all available permutations.
-		addressParserFirstLine.PermuteAddress(~0);
-		while (true) {
+		return CodeParseCandidates();
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Code an address whose components have already been separated.
+	// The components are used as the only parse candidates; the address
+	// parsers are bypassed except for alias substitution.
+	// Call GetNextCandidate() to check results.
+	// Inputs:
+	//	const AddressFields&	fields			address components
+	//	bool					replaceAliases	substitute standard aliases for
+	//											directionals, suffix, unit
+	//											designator and state
+	// Return value:
+	//	GlobalStatus		A status code indicating the overall result of
+	//						the geocoding process
+	///////////////////////////////////////////////////////////////////////
+	Geocoder::GlobalStatus GeocoderImp::CodeAddressFields(
+		const Geocoder::AddressFields& fields,
+		bool replaceAliases
+	) {
+		// Clear out information from last coding
+		ClearResults();
+		BeginProfiledRequest();
+		GeoProfiler::Scope requestScope(profiler, Geocoder::ProfileOther);
+
+		{
+			GeoProfiler::Scope parseScope(profiler, Geocoder::ProfileLastLineParse);
+
+			AddressParserLastLine::ParseCandidate& lastLineCandidate = lastLineParseCandidates.UseExtraOnEnd();
+			if (!addressParserLastLine.ParseFields(
+					fields.city,
+					fields.state,
+					fields.postcode,
+					lastLineCandidate,
+					replaceAliases
+			)) {
+				// Without a last line, we can't do anything (not even centroids).
+				lastLineParseCandidates.pop_back();
+				return resultsGlobalStatus;
+			}
+			GEOTRACE(TsString("Last-line fields: (") + lastLineCandidate.city + ") (" + lastLineCandidate.state + ") (" + lastLineCandidate.postcode + ")");
+		}
+
+		{
+			GeoProfiler::Scope parseScope(profiler, Geocoder::ProfileFirstLineParse);
+
 			AddressParserFirstLine::ParseCandidate& candidate = firstLineParseCandidates.UseExtraOnEnd();
-			if (!addressParserFirstLine.NextAddressPermutation(candidate, true)) {
+			if (!addressParserFirstLine.ParseFields(
+					fields.addrNbr,
+					fields.predir,
+					fields.street,
+					fields.suffix,
+					fields.postdir,
+					fields.unitDes,
+					fields.unit,
+					candidate,
+					replaceAliases
+			)) {
 				firstLineParseCandidates.pop_back();
-				break;
+			} else {
+				GEOTRACE(TsString("First-line fields: (") + candidate.number + ") (" + candidate.predir + ") (" + candidate.street + ") (" + candidate.suffix +") (" + candidate.postdir +") (" + candidate.unitDesignator +") (" + candidate.unitNumber + ")");
 			}
-			GEOTRACE(TsString("Parsed first-line candidate: (") + candidate.number + ") (" + candidate.predir + ") (" + candidate.street + ") (" + candidate.suffix +") (" + candidate.postdir +") (" + candidate.unitDesignator +") (" + candidate.unitNumber + ") (" + candidate.street2 + ")");
 		}
 
+		return CodeParseCandidates();
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Clear out all information from the last coding.
+	///////////////////////////////////////////////////////////////////////
+	void GeocoderImp::ClearResults()
+	{
+		bulkAllocator->Reset();
+		lastLineParseCandidates.clear();
+		firstLineParseCandidates.clear();
+		geocodeResults.clear();
+		sortedGeocodeResults.clear();
+		resultsCandidateIdx = 0;
+		resultsGlobalStatus = Geocoder::GlobalFailure;
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Start a profiled request, ending the previous one.
+	///////////////////////////////////////////////////////////////////////
+	void GeocoderImp::BeginProfiledRequest()
+	{
+		if (profiler.IsEnabled()) {
+			queryItf->GetProfileCounters(profileCounters);
+			profiler.BeginRequest(profileCounters);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// End the profiled request, if one is open.
+	///////////////////////////////////////////////////////////////////////
+	void GeocoderImp::EndProfiledRequest()
+	{
+		if (profiler.IsRequestOpen()) {
+			queryItf->GetProfileCounters(profileCounters);
+			profiler.EndRequest(profileCounters);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////
+	// Match the parse candidates in lastLineParseCandidates and 
+	// firstLineParseCandidates against the database, and fill in the 
+	// sorted results.  There must be at least one last-line candidate.
+	// Return value:
+	//	GlobalStatus		A status code indicating the overall result of
+	//						the geocoding process
+	///////////////////////////////////////////////////////////////////////
+	Geocoder::GlobalStatus GeocoderImp::CodeParseCandidates()
+	{
 		// Best last-line chosen and associated information.
 		CityStatePostcode bestCityStatePostcode;
 		int bestLastLineScore = 0;
@@ -508,6 +625,8 @@ namespace PortfolioExplorer {
 			}
 
 
+			GeoProfiler::Scope sortScope(profiler, Geocoder::ProfileSortResults);
+
 			// Dedupe results by street name
 			{
 				// Get pointers to results
@@ -544,6 +663,7 @@ namespace PortfolioExplorer {
 				// We have to actually go get the coding results to do this.
 				// This will cause some redundant processing, but intersections are
 				// less common than street addresses.
+				GeoProfiler::Scope codeScope(profiler, Geocoder::ProfileCodeResult);
 				for (unsigned i = 0; i < sortedGeocodeResults.size(); i++) {
 					CodeResult(*sortedGeocodeResults[i]);
 				}
@@ -680,6 +800,7 @@ namespace PortfolioExplorer {
 		Geocoder::GeocodeResults& resultsReturn
 	) {
 		if (unsigned(resultsCandidateIdx) < sortedGeocodeResults.size()) {
+			GeoProfiler::Scope codeScope(profiler, Geocoder::ProfileCodeResult);
 			CodeResult(*sortedGeocodeResults[resultsCandidateIdx]);
 			resultsReturn.GetResultsInternal() = sortedGeocodeResults[resultsCandidateIdx]->results;
 			resultsCandidateIdx++;
@@ -697,6 +818,14 @@ namespace PortfolioExplorer {
 		matchThreshold = threshold;
 	}
 
+	///////////////////////////////////////////////////////////////////////
+	// Set how the database files are checked against their checksums.
+	///////////////////////////////////////////////////////////////////////
+	void GeocoderImp::SetVerifyMode(Geocoder::VerifyMode mode, int nbrThreads)
+	{
+		queryItf->SetVerifyMode(mode, nbrThreads);
+	}
+
 	///////////////////////////////////////////////////////////////////////
 	// Set the score delta that determines a multiple (0-1000)
 	///////////////////////////////////////////////////////////////////////
@@ -2021,7 +2150,7 @@ namespace PortfolioExplorer {
 	}
 
 	#ifndef NDEBUG
-		void GeocoderImp::GEOTRACE(const TsString& x) {
+		void GeocoderImp::Trace(const TsString& x) {
 			geocoder.TraceMessage(x.c_str());
 		}
 	#endif
@@ -2047,6 +2176,8 @@ namespace PortfolioExplorer {
 		int& bestLastLineCandidateIdx,
 		int& bestLastLineFlags
 	) {
+		GeoProfiler::Scope scope(profiler, Geocoder::ProfileChooseLastLine);
+
 		bestLastLineScore = -1;
 		bestLastLineCandidateIdx = -1;
 		bestLastLineFlags = 0;
@@ -2185,6 +2316,9 @@ namespace PortfolioExplorer {
 		int bestLastLineCandidateIdx,
 		int bestLastLineFlags
 	) {
+		// Time not spent fetching street names goes to scoring.
+		GeoProfiler::Scope scope(profiler, Geocoder::ProfileSegmentScoring);
+
 		// Presence of postal code in last-line affects scoring.
 		bool haveLastLinePostcode = (lastLineParseCandidates[bestLastLineCandidateIdx].postcode[0] != 0);
 
@@ -2204,13 +2338,16 @@ namespace PortfolioExplorer {
 				for (int loop = 0; loop < 2; loop++) {
 					QueryImp::StreetIntersectionIterator iter;
 					// Query the database
-					if (loop == 0) {
-						GEOTRACE(TsString("\tIntersection search on (") + FormatInteger(bestCityStatePostcode.state) + ") (" + soundex1 + ") (" + soundex2 + ")");
-						iter = queryItf->LookupStreetIntersection(bestCityStatePostcode.state, soundex1, soundex2);
-					} else {
-						// Swap first/second soundex on second pass.
-						GEOTRACE(TsString("\tIntersection search on (") + FormatInteger(bestCityStatePostcode.state) + ") (" + soundex2 + ") (" + soundex1 + ")");
-						iter = queryItf->LookupStreetIntersection(bestCityStatePostcode.state, soundex2, soundex1);
+					{
+						GeoProfiler::Scope fetchScope(profiler, Geocoder::ProfileStreetNameFetch);
+						if (loop == 0) {
+							GEOTRACE(TsString("\tIntersection search on (") + FormatInteger(bestCityStatePostcode.state) + ") (" + soundex1 + ") (" + soundex2 + ")");
+							iter = queryItf->LookupStreetIntersection(bestCityStatePostcode.state, soundex1, soundex2);
+						} else {
+							// Swap first/second soundex on second pass.
+							GEOTRACE(TsString("\tIntersection search on (") + FormatInteger(bestCityStatePostcode.state) + ") (" + soundex2 + ") (" + soundex1 + ")");
+							iter = queryItf->LookupStreetIntersection(bestCityStatePostcode.state, soundex2, soundex1);
+						}
 					}
 
 					// Score retrieved intersections against the parse candidate.
@@ -2218,7 +2355,7 @@ namespace PortfolioExplorer {
 					// In the process of finding the intersection, we may choose the CityStatePostcode that
 					// actually contains the intersection.
 					CityStatePostcode newCityStatePostcode;
-					while (iter.Next(streetIntersection)) {
+					while (FetchNext(iter, streetIntersection)) {
 						GEOTRACE(TsString("\tRetrieved intersection (") + FormatInteger(streetIntersection.cityStatePostcode1.state) + ") (" + streetIntersection.cityStatePostcode1.city + ") (" + streetIntersection.streetName1.street + ") (" + streetIntersection.streetSegment1.addrLow + "-" + streetIntersection.streetSegment1.addrHigh + ") (" + streetIntersection.streetName2.street + ") (" + streetIntersection.streetSegment2.addrLow + "-" + streetIntersection.streetSegment2.addrHigh + ")");
 						int firstLineFlags = 0;
 						int streetScore = ScoreStreetIntersection(
@@ -2289,8 +2426,11 @@ namespace PortfolioExplorer {
 					const char* financeArea = uniqueFAList[uniqueFAIdx];
 					// Query the database
 					GEOTRACE(TsString("\tStreet name search on FINANCE=(") + financeArea + "), SOUNDEX=(" + soundex + ")");
-					QueryImp::StreetNameFromFaStreetIterator iter = 
-						queryItf->LookupStreetNameFromFaStreet(financeArea, soundex);
+					QueryImp::StreetNameFromFaStreetIterator iter;
+					{
+						GeoProfiler::Scope fetchScope(profiler, Geocoder::ProfileStreetNameFetch);
+						iter = queryItf->LookupStreetNameFromFaStreet(financeArea, soundex);
+					}
 
 					// Score retrieved street names against the parse candidate.
 
@@ -2298,7 +2438,7 @@ namespace PortfolioExplorer {
 					// locate the containing CityStatePostcode record.
 					CityStatePostcode newCityStatePostcode;
 
-					while (iter.Next(streetName)) {
+					while (FetchNext(iter, streetName)) {
 						GEOTRACE("\tRetrieved StreetName[" + FormatInteger(streetName.ID) + "]:  (" + streetName.predir + ") (" + streetName.street + ") (" + streetName.suffix +") (" + streetName.postdir + ")");
 						int firstLineFlags = 0;
 						int streetNameScore = ScoreStreetName(
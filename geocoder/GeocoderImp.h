@@ -42,6 +42,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 //#include "GeocoderItf.h"
 #include "GeoResultsInternal.h"
 #include "GeoAddressTemplate.h"
+#include "GeoProfiler.h"
 
 namespace PortfolioExplorer {
 
@@ -102,6 +103,21 @@ namespace PortfolioExplorer {
 			const char* line2
 		);
 
+		///////////////////////////////////////////////////////////////////////
+		// Code an address whose components have already been separated.
+		// Call GetNextCandidate() to check results.
+		// Inputs:
+		//	const AddressFields&	fields			address components
+		//	bool					replaceAliases	substitute standard aliases
+		// Return value:
+		//	GlobalStatus		A status code indicating the overall result of
+		//						the geocoding process
+		///////////////////////////////////////////////////////////////////////
+		Geocoder::GlobalStatus CodeAddressFields(
+			const Geocoder::AddressFields& fields,
+			bool replaceAliases
+		);
+
 		///////////////////////////////////////////////////////////////////////
 		// Fetch candidate address interpretations for the last
 		// call to CodeAddress().  The candidates will be returned in 
@@ -121,6 +137,12 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////
 		void SetMatchThreshold(int threshold);
 
+		///////////////////////////////////////////////////////////////////////
+		// Set how the database files are checked against their checksums.
+		// Call before Open().
+		///////////////////////////////////////////////////////////////////////
+		void SetVerifyMode(Geocoder::VerifyMode mode, int nbrThreads);
+
 		///////////////////////////////////////////////////////////////////////
 		// Set the score delta that determines a multiple (0-1000)
 		///////////////////////////////////////////////////////////////////////
@@ -164,6 +186,14 @@ namespace PortfolioExplorer {
 		void SetMaxInterpolation(double _maxInterpolation)
 		{ maxInterpolation = _maxInterpolation; }
 
+#ifndef NDEBUG
+		///////////////////////////////////////////////////////////////////////
+		// Turn trace messages on or off
+		///////////////////////////////////////////////////////////////////////
+		void SetTrace(bool trace)
+		{ traceEnabled = trace; }
+#endif
+
 		///////////////////////////////////////////////////////////////////////
 		// Inputs:
 		//	const CityStatePostcode&	cityStatePostcode		The current last-line record
@@ -186,6 +216,48 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////
 		static bool CheckDataVersion(TsString dataDir);
 
+		///////////////////////////////////////////////////////////////////////
+		// Use read-only tables shared with other geocoders on the same
+		// directories: the parser tables loaded through parserTables, and the
+		// query interface's Huffman coders.  Either may be zero.  Call before
+		// Open(); opens of geocoders sharing tables must not overlap until
+		// one has succeeded.
+		///////////////////////////////////////////////////////////////////////
+		void SetSharedTables(const ParserTableImageRef& parserTables, const QueryCodersRef& queryCoders)
+		{
+			sharedParserTables = parserTables;
+			queryItf->SetSharedCoders(queryCoders);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Profiling; see Geocoder.h.  Reading the results ends the open
+		// request, so read them after its last GetNextCandidate().
+		///////////////////////////////////////////////////////////////////////
+		void SetProfiling(bool profiling)
+		{ profiler.SetEnabled(profiling); }
+		bool GetProfiling() const
+		{ return profiler.IsEnabled(); }
+		bool GetRequestStats(Geocoder::RequestStats& statsReturn)
+		{
+			EndProfiledRequest();
+			return profiler.GetRequestStats(statsReturn);
+		}
+		void GetProfileTotals(Geocoder::RequestStats& totalsReturn, long& nbrRequestsReturn)
+		{
+			EndProfiledRequest();
+			profiler.GetTotals(totalsReturn, nbrRequestsReturn);
+		}
+		bool GetLatencyHistogram(int phase, Geocoder::LatencyHistogram& histogramReturn)
+		{
+			EndProfiledRequest();
+			return profiler.GetLatencyHistogram(phase, histogramReturn);
+		}
+		void ResetProfile()
+		{
+			EndProfiledRequest();
+			profiler.Reset();
+		}
+
 		///////////////////////////////////////////////////////////////////////
 		// Convert a state abbreviation to a state FIPS code
 		// Inputs:
@@ -220,9 +292,26 @@ namespace PortfolioExplorer {
 
 	private:
 		#ifndef NDEBUG
-			void GEOTRACE(const TsString& x);
+			void Trace(const TsString& x);
 		#endif
 
+		///////////////////////////////////////////////////////////////////////
+		// Start and end the profiled request, taking the query counters.
+		// They do nothing unless profiling is on.
+		///////////////////////////////////////////////////////////////////////
+		void BeginProfiledRequest();
+		void EndProfiledRequest();
+
+		///////////////////////////////////////////////////////////////////////
+		// Call Next() on a street name or intersection iterator, timing it
+		// as ProfileStreetNameFetch.
+		///////////////////////////////////////////////////////////////////////
+		template <class Iterator, class Record> bool FetchNext(Iterator& iter, Record& record)
+		{
+			GeoProfiler::Scope scope(profiler, Geocoder::ProfileStreetNameFetch);
+			return iter.Next(record);
+		}
+
 		///////////////////////////////////////////////////////////////////////
 		///////////////////////////////////////////////////////////////////////
 		// Subclass of QueryImp to forward error messages.
@@ -256,6 +345,17 @@ namespace PortfolioExplorer {
 			Geocoder& geocoder;
 		};
 
+		///////////////////////////////////////////////////////////////////////
+		// Clear out all information from the last coding.
+		///////////////////////////////////////////////////////////////////////
+		void ClearResults();
+
+		///////////////////////////////////////////////////////////////////////
+		// Match the current first-line and last-line parse candidates 
+		// against the database.  Shared by CodeAddress() and 
+		// CodeAddressFields().
+		///////////////////////////////////////////////////////////////////////
+		Geocoder::GlobalStatus CodeParseCandidates();
 
 
 		///////////////////////////////////////////////////////////////////////
@@ -800,6 +900,9 @@ namespace PortfolioExplorer {
 		AddressParserFirstLine addressParserFirstLine;
 		AddressParserLastLine addressParserLastLine;
 
+		// Parser tables shared with other geocoders, if set
+		ParserTableImageRef sharedParserTables;
+
 		// Match threshold controls minumim quality of match.
 		int matchThreshold;
 
@@ -946,7 +1049,9 @@ namespace PortfolioExplorer {
 		// Index into sortedGeocodeResults that points to the next result.
 		int resultsCandidateIdx;
 
-		// Bulk allocator used to allocate string objects
+		// Bulk allocator used to allocate string objects.  The address
+		// parsers share it, so it holds everything allocated while coding
+		// one address; ClearResults() resets it.
 		BulkAllocatorRef bulkAllocator;
 
 		// Offset of coded address from side and end of street.
@@ -962,6 +1067,15 @@ namespace PortfolioExplorer {
 		// the entered last-line.
 		Geocoder::StreetOwnerTreatment streetOwnerTreatment;
 
+#ifndef NDEBUG
+		// True to format trace messages and pass them to TraceMessage()
+		bool traceEnabled;
+#endif
+
+		// Phase timing of the requests, and the query counters it is given.
+		GeoProfiler profiler;
+		Geocoder::RequestStats profileCounters;
+
 		// Weight values, setup with default values in the constructor, possibly overriden
 		// with corresponding values read in from the ini file;
 		int m_LastLineThresholdZipOnly;			// A zip-only query producing this score or better
@@ -1016,8 +1130,6 @@ namespace PortfolioExplorer {
 		int m_ReplaceLastLinePostcodeWeight;
 		int m_ReplaceLastLineFinanceWeightSameCity;
 		int m_ReplaceLastLineFinanceWeightNewCity;
-
-		bool m_bXmlInitialized;
 	};
 
 }
@@ -0,0 +1,767 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeocoderPool.cpp: Worker threads, work-stealing queues and processor
+// binding for GeocoderPool.
+
+#include "../geocommon/Geocoder_Headers.h"
+#include "GeocoderPool.h"
+#include "GeocoderImp.h"
+#include "../global/AtomicOps.h"
+#include "../global/CritSec.h"
+#include "../global/ParserTableImage.h"
+#include <deque>
+#include <set>
+#include <vector>
+#include <stdio.h>
+
+#if defined(WIN32)
+	#include <process.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+	#if defined(__linux__)
+		#include <sched.h>
+	#endif
+#endif
+
+namespace PortfolioExplorer {
+
+	// Forward declaration
+	struct PoolWorker;
+
+	///////////////////////////////////////////////////////////////////////////
+	// A batch being coded.  It lives on the stack of the CodeBatch() caller,
+	// which waits until remaining reaches zero.
+	///////////////////////////////////////////////////////////////////////////
+	struct PoolBatch {
+		const char* const* line1;
+		const char* const* line2;
+		GeocoderPool::ResultCallback* callback;
+		AtomicLong remaining;		// addresses not yet coded
+	};
+
+	// A run of consecutive addresses of a batch: the unit of work and of theft.
+	struct PoolChunk {
+		PoolBatch* batch;
+		int first;
+		int count;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// The read-only tables shared by the geocoders of the workers on one
+	// NUMA node: the parser tables and the Huffman coders.  The first worker
+	// on the node to open loads them, on that node; the others use them as
+	// they are.  Everything a geocoder changes while coding (file positions,
+	// caches, parser scratch) stays per worker.
+	///////////////////////////////////////////////////////////////////////////
+	struct PoolNode {
+		PoolNode() : loaded(false), openLock("GeocoderPool") {}
+
+		ParserTableImageRef parserTables;
+		QueryCodersRef queryCoders;
+		// A geocoder has opened with these tables
+		bool loaded;
+		// Held while the tables are being loaded
+		CritSecInfo openLock;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// The geocoder made by the default CreateGeocoder().  It passes its error
+	// messages to the pool.
+	///////////////////////////////////////////////////////////////////////////
+	class PoolGeocoder : public Geocoder {
+	public:
+		PoolGeocoder(GeocoderPool& pool, const char* tableDir, const char* databaseDir, MemUse memUse) :
+			Geocoder(tableDir, databaseDir, memUse),
+			pool(pool)
+		{}
+		virtual ~PoolGeocoder() {}
+		virtual void ErrorMessage(const char* message) { pool.ReportError(message); }
+	private:
+		GeocoderPool& pool;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Implementation of GeocoderPool
+	///////////////////////////////////////////////////////////////////////////
+	class GeocoderPoolImp {
+	public:
+		GeocoderPoolImp(
+			GeocoderPool& pool,
+			const char* tableDir,
+			const char* databaseDir,
+			Geocoder::MemUse memUse,
+			int nbrThreads,
+			bool pinThreads
+		);
+		~GeocoderPoolImp();
+
+		bool Open();
+		void Close();
+		bool CodeBatch(const char* const* line1, const char* const* line2, int count, GeocoderPool::ResultCallback& callback);
+		void RunWorker(PoolWorker& worker);
+
+		GeocoderPool& pool;
+		TsString tableDir;
+		TsString databaseDir;
+		Geocoder::MemUse memUse;
+		int nbrThreadsWanted;
+		bool pinThreads;
+		int chunkSize;
+		CritSecInfo errorLock;
+
+		// Geocoders made by the default CreateGeocoder() and not yet deleted
+		CritSecInfo geocodersLock;
+		std::set<Geocoder*> geocoders;
+
+		std::vector<PoolNode*> nodes;
+		std::vector<PoolWorker*> workers;
+		// Worker chosen for the first chunk of the next batch
+		AtomicLong nextWorker;
+		// Chunks in the workers' queues.  May briefly go negative, since a
+		// chunk can be taken before it is counted.
+		AtomicLong queuedChunks;
+		AtomicLong stopping;
+		// Workers that have finished opening their geocoders
+		AtomicLong nbrStarted;
+		AtomicLong chunksRun;
+		AtomicLong chunksStolen;
+		// Signalled when chunks are queued, and when stopping
+		EventCount workAvailable;
+		// Signalled when a batch is finished, and when a worker has started
+		EventCount progress;
+
+	private:
+		bool OpenGeocoder(PoolWorker& worker);
+		bool TakeChunk(PoolWorker& worker, PoolChunk& chunkReturn);
+		void RunChunk(PoolWorker& worker, const PoolChunk& chunk);
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// One worker thread, its geocoder and its queue of chunks.  The owner
+	// takes chunks from the front, in address order; thieves take from the
+	// back, furthest from where the owner is working.
+	///////////////////////////////////////////////////////////////////////////
+	struct PoolWorker {
+		PoolWorker(GeocoderPoolImp& imp, int number, int cpu, PoolNode& node) :
+			imp(imp), number(number), cpu(cpu), node(node), geocoder(0), opened(false), started(false),
+			lock("GeocoderPool")
+		{}
+
+		GeocoderPoolImp& imp;
+		int number;
+		int cpu;					// processor to bind to; -1 for any
+		PoolNode& node;				// shares its tables with these workers
+		Geocoder* geocoder;
+		bool opened;
+		bool started;				// the thread was created
+#if defined(WIN32)
+		HANDLE thread;
+#else
+		pthread_t thread;
+#endif
+		CritSecInfo lock;
+		std::deque<PoolChunk> chunks;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Processor topology.  Each element is a NUMA node and lists the
+	// processors this process may use on it.  Without NUMA information
+	// there is one node holding every processor.
+	///////////////////////////////////////////////////////////////////////////
+	typedef std::vector<std::vector<int> > CpuNodes;
+
+#if defined(__linux__)
+	// Parse a sysfs processor list such as "0-3,8-11".
+	static void ParseCpuList(const char* text, const cpu_set_t& allowed, std::vector<int>& cpusReturn)
+	{
+		const char* p = text;
+		while (*p != 0) {
+			char* end;
+			long first = strtol(p, &end, 10);
+			if (end == p) {
+				break;
+			}
+			long last = first;
+			p = end;
+			if (*p == '-') {
+				last = strtol(p + 1, &end, 10);
+				p = end;
+			}
+			for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(int(cpu), &allowed)) {
+					cpusReturn.push_back(int(cpu));
+				}
+			}
+			if (*p == ',') {
+				p++;
+			} else {
+				break;
+			}
+		}
+	}
+#endif
+
+	static void GetCpuNodes(CpuNodes& nodesReturn)
+	{
+		nodesReturn.clear();
+#if defined(WIN32)
+		ULONG highestNode = 0;
+		if (::GetNumaHighestNodeNumber(&highestNode)) {
+			for (ULONG node = 0; node <= highestNode; node++) {
+				ULONGLONG mask = 0;
+				if (!::GetNumaNodeProcessorMask(UCHAR(node), &mask)) {
+					continue;
+				}
+				std::vector<int> cpus;
+				for (int cpu = 0; cpu < int(sizeof(DWORD_PTR) * 8); cpu++) {
+					if ((mask & (ULONGLONG(1) << cpu)) != 0) {
+						cpus.push_back(cpu);
+					}
+				}
+				if (!cpus.empty()) {
+					nodesReturn.push_back(cpus);
+				}
+			}
+		}
+		if (nodesReturn.empty()) {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			nodesReturn.resize(1);
+			for (int cpu = 0; cpu < int(systemInfo.dwNumberOfProcessors); cpu++) {
+				nodesReturn[0].push_back(cpu);
+			}
+		}
+#elif defined(__linux__)
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				CPU_SET(cpu, &allowed);
+			}
+		}
+		// Node numbers may have gaps, so look at every possible one.
+		for (int node = 0; node < 1024; node++) {
+			char path[64];
+			sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+			FILE* fp = fopen(path, "r");
+			if (fp == 0) {
+				continue;
+			}
+			char text[1024];
+			std::vector<int> cpus;
+			if (fgets(text, sizeof(text), fp) != 0) {
+				ParseCpuList(text, allowed, cpus);
+			}
+			fclose(fp);
+			if (!cpus.empty()) {
+				nodesReturn.push_back(cpus);
+			}
+		}
+		if (nodesReturn.empty()) {
+			nodesReturn.resize(1);
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &allowed)) {
+					nodesReturn[0].push_back(cpu);
+				}
+			}
+		}
+#else
+		nodesReturn.resize(1);
+		for (int cpu = 0; cpu < int(sysconf(_SC_NPROCESSORS_ONLN)); cpu++) {
+			nodesReturn[0].push_back(cpu);
+		}
+#endif
+		if (nodesReturn.empty() || nodesReturn[0].empty()) {
+			nodesReturn.assign(1, std::vector<int>(1, 0));
+		}
+	}
+
+	static int CountCpus(const CpuNodes& nodes)
+	{
+		int nbrCpus = 0;
+		for (unsigned i = 0; i < nodes.size(); i++) {
+			nbrCpus += int(nodes[i].size());
+		}
+		return nbrCpus;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Bind the calling thread to a processor.  Not supported on every
+	// platform; the thread then runs anywhere.
+	///////////////////////////////////////////////////////////////////////////
+	static void BindToCpu(int cpu)
+	{
+#if defined(WIN32)
+		::SetThreadAffinityMask(::GetCurrentThread(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+		(void)cpu;
+#endif
+	}
+
+#if defined(WIN32)
+	static unsigned __stdcall WorkerThreadProc(void* arg)
+	{
+		PoolWorker* worker = (PoolWorker*)arg;
+		worker->imp.RunWorker(*worker);
+		return 0;
+	}
+#else
+	static void* WorkerThreadProc(void* arg)
+	{
+		PoolWorker* worker = (PoolWorker*)arg;
+		worker->imp.RunWorker(*worker);
+		return 0;
+	}
+#endif
+
+	GeocoderPoolImp::GeocoderPoolImp(
+		GeocoderPool& pool,
+		const char* tableDir,
+		const char* databaseDir,
+		Geocoder::MemUse memUse,
+		int nbrThreads,
+		bool pinThreads
+	) :
+		pool(pool),
+		tableDir(tableDir),
+		databaseDir(databaseDir),
+		memUse(memUse),
+		nbrThreadsWanted(nbrThreads),
+		pinThreads(pinThreads),
+		chunkSize(GeocoderPool::DefaultChunkSize),
+		nextWorker(0),
+		queuedChunks(0),
+		stopping(0),
+		nbrStarted(0),
+		chunksRun(0),
+		chunksStolen(0)
+	{
+	}
+
+	GeocoderPoolImp::~GeocoderPoolImp()
+	{
+		Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Start the workers and wait for their geocoders to open.  Workers are
+	// dealt to the NUMA nodes in turn, so that a small pool is spread over
+	// the nodes' memory controllers.  Pinned workers share tables with the
+	// others on their node; unpinned ones run anywhere, and all share one
+	// set.
+	///////////////////////////////////////////////////////////////////////////
+	bool GeocoderPoolImp::Open()
+	{
+		if (!workers.empty()) {
+			return true;
+		}
+		CpuNodes cpuNodes;
+		GetCpuNodes(cpuNodes);
+		int nbrThreads = nbrThreadsWanted > 0 ? nbrThreadsWanted : CountCpus(cpuNodes);
+
+		AtomicStoreRelease(stopping, 0);
+		AtomicStoreRelease(nbrStarted, 0);
+		AtomicStoreRelease(queuedChunks, 0);
+		AtomicStoreRelease(chunksRun, 0);
+		AtomicStoreRelease(chunksStolen, 0);
+		for (unsigned n = 0; n < (pinThreads ? cpuNodes.size() : 1); n++) {
+			nodes.push_back(new PoolNode);
+		}
+		for (int w = 0; w < nbrThreads; w++) {
+			int cpu = -1;
+			PoolNode* node = nodes[0];
+			if (pinThreads) {
+				const std::vector<int>& cpus = cpuNodes[w % cpuNodes.size()];
+				cpu = cpus[(w / cpuNodes.size()) % cpus.size()];
+				node = nodes[w % cpuNodes.size()];
+			}
+			workers.push_back(new PoolWorker(*this, w, cpu, *node));
+		}
+
+		bool ok = true;
+		for (int w = 0; w < nbrThreads; w++) {
+			PoolWorker& worker = *workers[w];
+#if defined(WIN32)
+			worker.thread = (HANDLE)_beginthreadex(0, 0, WorkerThreadProc, &worker, 0, 0);
+			worker.started = worker.thread != 0;
+#else
+			worker.started = pthread_create(&worker.thread, 0, WorkerThreadProc, &worker) == 0;
+#endif
+			if (!worker.started) {
+				pool.ReportError("GeocoderPool: cannot create worker thread");
+				ok = false;
+				break;
+			}
+		}
+
+		// Wait for the started workers to open their geocoders.
+		long nbrThreadsStarted = 0;
+		for (int w = 0; w < nbrThreads; w++) {
+			nbrThreadsStarted += workers[w]->started ? 1 : 0;
+		}
+		while (AtomicLoadAcquire(nbrStarted) < nbrThreadsStarted) {
+			long key = progress.PrepareWait();
+			if (AtomicLoadAcquire(nbrStarted) >= nbrThreadsStarted) {
+				progress.CancelWait();
+				break;
+			}
+			progress.Wait(key);
+		}
+		for (int w = 0; w < nbrThreads && ok; w++) {
+			ok = workers[w]->opened;
+		}
+		if (!ok) {
+			Close();
+		}
+		return ok;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Stop the workers, once they have run out of work, and close their
+	// geocoders.
+	///////////////////////////////////////////////////////////////////////////
+	void GeocoderPoolImp::Close()
+	{
+		if (workers.empty()) {
+			return;
+		}
+		AtomicStoreRelease(stopping, 1);
+		workAvailable.NotifyAll();
+		for (unsigned w = 0; w < workers.size(); w++) {
+			PoolWorker* worker = workers[w];
+			if (worker->started) {
+#if defined(WIN32)
+				WaitForSingleObject(worker->thread, INFINITE);
+				CloseHandle(worker->thread);
+#else
+				pthread_join(worker->thread, 0);
+#endif
+			}
+			delete worker;
+		}
+		workers.clear();
+		for (unsigned n = 0; n < nodes.size(); n++) {
+			delete nodes[n];
+		}
+		nodes.clear();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Body of a worker thread.  The geocoder is made here, after binding,
+	// so that its tables and caches are first touched on this thread's node.
+	///////////////////////////////////////////////////////////////////////////
+	void GeocoderPoolImp::RunWorker(PoolWorker& worker)
+	{
+		if (worker.cpu >= 0) {
+			BindToCpu(worker.cpu);
+		}
+		worker.geocoder = pool.CreateGeocoder(tableDir.c_str(), databaseDir.c_str(), memUse);
+		worker.opened = worker.geocoder != 0 && OpenGeocoder(worker);
+		AtomicFetchAdd(nbrStarted, 1);
+		progress.NotifyAll();
+
+		while (worker.opened) {
+			PoolChunk chunk;
+			if (TakeChunk(worker, chunk)) {
+				RunChunk(worker, chunk);
+				continue;
+			}
+			long key = workAvailable.PrepareWait();
+			if (AtomicLoadAcquire(queuedChunks) > 0) {
+				workAvailable.CancelWait();
+				continue;
+			}
+			if (AtomicLoadAcquire(stopping) != 0) {
+				workAvailable.CancelWait();
+				break;
+			}
+			workAvailable.Wait(key);
+		}
+
+		if (worker.geocoder != 0) {
+			pool.DeleteGeocoder(worker.geocoder);
+			worker.geocoder = 0;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Open a worker's geocoder with its node's shared tables.  Until one
+	// geocoder on the node has opened, opens on the node are serialized, so
+	// the tables are loaded once; after that they proceed side by side.
+	///////////////////////////////////////////////////////////////////////////
+	bool GeocoderPoolImp::OpenGeocoder(PoolWorker& worker)
+	{
+		PoolNode& node = worker.node;
+		{
+			CritSec critSec(node.openLock);
+			if (!node.loaded) {
+				if (node.parserTables == 0) {
+					// No image file is fine; tables are read from their files.
+					TsString imageErrorMsg;
+					node.parserTables = new ParserTableImage;
+					node.parserTables->Open(tableDir, imageErrorMsg);
+					node.queryCoders = new QueryCoders;
+				}
+				worker.geocoder->imp->SetSharedTables(node.parserTables, node.queryCoders);
+				node.loaded = worker.geocoder->Open();
+				return node.loaded;
+			}
+		}
+		worker.geocoder->imp->SetSharedTables(node.parserTables, node.queryCoders);
+		return worker.geocoder->Open();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Take a chunk from the worker's own queue, or failing that steal one
+	// from another worker, trying them in turn from the next one up.
+	///////////////////////////////////////////////////////////////////////////
+	bool GeocoderPoolImp::TakeChunk(PoolWorker& worker, PoolChunk& chunkReturn)
+	{
+		{
+			CritSec critSec(worker.lock);
+			if (!worker.chunks.empty()) {
+				chunkReturn = worker.chunks.front();
+				worker.chunks.pop_front();
+				AtomicFetchAdd(queuedChunks, -1);
+				return true;
+			}
+		}
+		int nbrWorkers = int(workers.size());
+		for (int i = 1; i < nbrWorkers; i++) {
+			PoolWorker& victim = *workers[(worker.number + i) % nbrWorkers];
+			CritSec critSec(victim.lock);
+			if (!victim.chunks.empty()) {
+				chunkReturn = victim.chunks.back();
+				victim.chunks.pop_back();
+				AtomicFetchAdd(queuedChunks, -1);
+				AtomicFetchAdd(chunksStolen, 1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void GeocoderPoolImp::RunChunk(PoolWorker& worker, const PoolChunk& chunk)
+	{
+		PoolBatch& batch = *chunk.batch;
+		for (int i = chunk.first; i < chunk.first + chunk.count; i++) {
+			const char* line2 = batch.line2 != 0 && batch.line2[i] != 0 ? batch.line2[i] : "";
+			Geocoder::GlobalStatus status = worker.geocoder->CodeAddress(batch.line1[i], line2);
+			batch.callback->AddressCoded(i, status, *worker.geocoder);
+		}
+		AtomicFetchAdd(chunksRun, 1);
+		// The batch may be gone once the count reaches zero, so it is not
+		// touched again; the caller is woken through the pool.
+		if (AtomicFetchAdd(batch.remaining, -chunk.count) == chunk.count) {
+			progress.NotifyAll();
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Cut a batch into chunks and deal each worker a run of consecutive
+	// chunks, then wait for the workers to finish them.
+	///////////////////////////////////////////////////////////////////////////
+	bool GeocoderPoolImp::CodeBatch(
+		const char* const* line1,
+		const char* const* line2,
+		int count,
+		GeocoderPool::ResultCallback& callback
+	) {
+		if (workers.empty()) {
+			pool.ReportError("GeocoderPool is not open");
+			return false;
+		}
+		if (count <= 0) {
+			return true;
+		}
+		PoolBatch batch;
+		batch.line1 = line1;
+		batch.line2 = line2;
+		batch.callback = &callback;
+		AtomicStoreRelease(batch.remaining, count);
+
+		int nbrWorkers = int(workers.size());
+		int nbrChunks = (count + chunkSize - 1) / chunkSize;
+		// Start the deal at a different worker for each batch, so that
+		// small batches do not all land on the first few workers.
+		int firstWorker = int((unsigned long)AtomicFetchAdd(nextWorker, 1) % (unsigned long)nbrWorkers);
+		int chunksPerWorker = nbrChunks / nbrWorkers;
+		int nbrExtraChunks = nbrChunks % nbrWorkers;
+		for (int w = 0; w < nbrWorkers; w++) {
+			int firstChunk = w * chunksPerWorker + JHMIN(w, nbrExtraChunks);
+			int endChunk = firstChunk + chunksPerWorker + (w < nbrExtraChunks ? 1 : 0);
+			if (firstChunk == endChunk) {
+				break;
+			}
+			PoolWorker& worker = *workers[(firstWorker + w) % nbrWorkers];
+			{
+				CritSec critSec(worker.lock);
+				for (int c = firstChunk; c < endChunk; c++) {
+					PoolChunk chunk;
+					chunk.batch = &batch;
+					chunk.first = c * chunkSize;
+					chunk.count = JHMIN(chunkSize, count - chunk.first);
+					worker.chunks.push_back(chunk);
+				}
+			}
+			AtomicFetchAdd(queuedChunks, endChunk - firstChunk);
+		}
+		workAvailable.NotifyAll();
+
+		while (AtomicLoadAcquire(batch.remaining) != 0) {
+			long key = progress.PrepareWait();
+			if (AtomicLoadAcquire(batch.remaining) == 0) {
+				progress.CancelWait();
+				break;
+			}
+			progress.Wait(key);
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Callback that fills an ordered results buffer.  Each address has its
+	// own slot, so the workers need no lock.
+	///////////////////////////////////////////////////////////////////////////
+	class OrderedResultCallback : public GeocoderPool::ResultCallback {
+	public:
+		OrderedResultCallback(GeocoderPool::Result* results) : results(results) {}
+		virtual void AddressCoded(int index, Geocoder::GlobalStatus status, Geocoder& geocoder) {
+			GeocoderPool::Result& result = results[index];
+			result.status = status;
+			result.haveCandidate = geocoder.GetNextCandidate(result.best);
+		}
+	private:
+		GeocoderPool::Result* results;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// GeocoderPool
+	///////////////////////////////////////////////////////////////////////////
+	GeocoderPool::GeocoderPool(
+		const char* tableDir,
+		const char* databaseDir,
+		Geocoder::MemUse memUse,
+		int nbrThreads,
+		bool pinThreads
+	) {
+		imp = new GeocoderPoolImp(*this, tableDir, databaseDir, memUse, nbrThreads, pinThreads);
+	}
+
+	GeocoderPool::~GeocoderPool()
+	{
+		Close();
+		delete imp;
+		imp = 0;
+	}
+
+	void GeocoderPool::ErrorMessage(const char* message)
+	{
+		// Default implementation does nothing
+	}
+
+	void GeocoderPool::ReportError(const char* message)
+	{
+		CritSec critSec(imp->errorLock);
+		ErrorMessage(message);
+	}
+
+	Geocoder* GeocoderPool::CreateGeocoder(
+		const char* tableDir,
+		const char* databaseDir,
+		Geocoder::MemUse memUse
+	) {
+		PoolGeocoder* geocoder = new PoolGeocoder(*this, tableDir, databaseDir, memUse);
+		CritSec critSec(imp->geocodersLock);
+		imp->geocoders.insert(geocoder);
+		return geocoder;
+	}
+
+	void GeocoderPool::DeleteGeocoder(Geocoder* geocoder)
+	{
+		// Only a PoolGeocoder made by this pool can be deleted through its
+		// own type; Geocoder's destructor is not virtual.
+		bool owned;
+		{
+			CritSec critSec(imp->geocodersLock);
+			owned = imp->geocoders.erase(geocoder) != 0;
+		}
+		if (!owned) {
+			ReportError("GeocoderPool: DeleteGeocoder() was given a geocoder not made by CreateGeocoder(); override both");
+			return;
+		}
+		delete static_cast<PoolGeocoder*>(geocoder);
+	}
+
+	bool GeocoderPool::Open()
+	{
+		return imp->Open();
+	}
+
+	void GeocoderPool::Close()
+	{
+		imp->Close();
+	}
+
+	void GeocoderPool::SetChunkSize(int chunkSize)
+	{
+		imp->chunkSize = JHMAX(chunkSize, 1);
+	}
+
+	bool GeocoderPool::CodeBatch(
+		const char* const* line1,
+		const char* const* line2,
+		int count,
+		ResultCallback& callback
+	) {
+		return imp->CodeBatch(line1, line2, count, callback);
+	}
+
+	bool GeocoderPool::CodeBatch(
+		const char* const* line1,
+		const char* const* line2,
+		int count,
+		Result* resultsReturn
+	) {
+		OrderedResultCallback callback(resultsReturn);
+		return imp->CodeBatch(line1, line2, count, callback);
+	}
+
+	int GeocoderPool::GetThreadCount() const
+	{
+		return int(imp->workers.size());
+	}
+
+	void GeocoderPool::GetChunkCounts(long& chunksReturn, long& stolenReturn) const
+	{
+		chunksReturn = AtomicLoadRelaxed(imp->chunksRun);
+		stolenReturn = AtomicLoadRelaxed(imp->chunksStolen);
+	}
+
+}
@@ -0,0 +1,218 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeocoderPool.h: Public interface for coding batches of addresses on
+// several threads.
+//
+// The pool owns a set of worker threads, each with its own Geocoder opened
+// on the same database.  The geocoders on one NUMA node share one copy of
+// the read-only tables (parser tables and Huffman code tables); each keeps
+// its own file positions, caches and parser scratch.
+//
+// A batch is cut into small chunks of consecutive addresses, which are
+// dealt out to the workers' queues.  A worker that empties its own queue
+// steals chunks from the others, so a thread that draws a run of slow,
+// ambiguous addresses does not hold up the batch.
+
+#ifndef INCL_GeocoderPool_H
+#define INCL_GeocoderPool_H
+
+#include "Geocoder.h"
+
+namespace PortfolioExplorer {
+
+	// Forward declaration of implementation class
+	class GeocoderPoolImp;
+
+#if defined(UNIX)
+	class GeocoderPool
+#else
+	class __declspec(dllexport) GeocoderPool
+#endif
+	{
+	public:
+		// Default number of addresses in a unit of work
+		enum { DefaultChunkSize = 16 };
+
+		///////////////////////////////////////////////////////////////////////
+		// Receives each coded address of a batch.  AddressCoded() is called
+		// on the worker thread that coded the address, right after
+		// CodeAddress(); call GetNextCandidate() on the geocoder to fetch
+		// the candidates.  Calls for one batch are made from several threads
+		// at once and in no particular order, and must not throw.
+		///////////////////////////////////////////////////////////////////////
+		class ResultCallback {
+		public:
+			virtual ~ResultCallback() {}
+			virtual void AddressCoded(
+				int index,						// position of the address in the batch
+				Geocoder::GlobalStatus status,	// return value of CodeAddress()
+				Geocoder& geocoder				// the worker's geocoder
+			) = 0;
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// The best candidate for one address of a batch, for CodeBatch()
+		// with an ordered results buffer.
+		///////////////////////////////////////////////////////////////////////
+		struct Result {
+			Result() : status(Geocoder::GlobalFailure), haveCandidate(false) {}
+			Geocoder::GlobalStatus status;		// return value of CodeAddress()
+			bool haveCandidate;					// false if there were no candidates
+			Geocoder::GeocodeResults best;		// the first candidate, if any
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		// Constructor.
+		// Inputs:
+		//	const char*			tableDir	The geocoder directory containing the
+		//									lookup tables for the address parser.
+		//	const char*			databaseDir	The geocoder directory containing the
+		//									geocoder database files.
+		//	MemUse				memUse		Memory to use for caching, per thread
+		//	int					nbrThreads	Worker threads; 0 for one per processor
+		//	bool				pinThreads	Bind each worker to one processor,
+		//									spreading them over the NUMA nodes.
+		///////////////////////////////////////////////////////////////////////
+		GeocoderPool(
+			const char* tableDir,
+			const char* databaseDir,
+			Geocoder::MemUse memUse = Geocoder::MemUseNormal,
+			int nbrThreads = 0,
+			bool pinThreads = false
+		);
+
+		///////////////////////////////////////////////////////////////////////
+		// Destructor.  Calls Close(), which is too late for a subclass's
+		// overrides; see CreateGeocoder().
+		///////////////////////////////////////////////////////////////////////
+		virtual ~GeocoderPool();
+
+		///////////////////////////////////////////////////////////////////////
+		// Error-message-receiving method.
+		// Override this to intercept human-readable error messages.  Messages
+		// from the workers' geocoders come here too, one at a time.
+		///////////////////////////////////////////////////////////////////////
+		virtual void ErrorMessage(const char* message);
+
+		///////////////////////////////////////////////////////////////////////
+		// Create and destroy the geocoder of a worker thread.  They are called
+		// on that thread, so with pinning its memory is allocated on the
+		// thread's NUMA node.  Override CreateGeocoder() to set thresholds
+		// or use a subclass of Geocoder; the pool calls Open() on the result.
+		// A subclass's ErrorMessage() should pass its messages to
+		// ReportError().  Override both, or neither: the default
+		// DeleteGeocoder() deletes only geocoders made by the default
+		// CreateGeocoder() of this pool, and reports any other.
+		// A subclass that overrides them, or ErrorMessage(), must call
+		// Close() in its own destructor: the workers delete their geocoders
+		// as they stop, and by the time ~GeocoderPool() stops them the
+		// subclass is gone.
+		///////////////////////////////////////////////////////////////////////
+		virtual Geocoder* CreateGeocoder(
+			const char* tableDir,
+			const char* databaseDir,
+			Geocoder::MemUse memUse
+		);
+		virtual void DeleteGeocoder(Geocoder* geocoder);
+
+		///////////////////////////////////////////////////////////////////////
+		// Pass a message to ErrorMessage(), one thread at a time.
+		///////////////////////////////////////////////////////////////////////
+		void ReportError(const char* message);
+
+		///////////////////////////////////////////////////////////////////////
+		// Start the worker threads and open their geocoders.
+		// Returns true on success, false on failure.
+		// Override ErrorMessage() to get message text.
+		///////////////////////////////////////////////////////////////////////
+		bool Open();
+
+		///////////////////////////////////////////////////////////////////////
+		// Stop the worker threads and close their geocoders.  Must not be
+		// called while a CodeBatch() is in progress.
+		///////////////////////////////////////////////////////////////////////
+		void Close();
+
+		///////////////////////////////////////////////////////////////////////
+		// Set the number of consecutive addresses in a unit of work.  Smaller
+		// chunks balance the load better; larger ones cost less to hand out.
+		///////////////////////////////////////////////////////////////////////
+		void SetChunkSize(int chunkSize);
+
+		///////////////////////////////////////////////////////////////////////
+		// Code a batch of addresses, passing each to a callback.  Returns when
+		// every address has been coded.  Several threads may code batches at
+		// once; the workers share them out.  Must not be called from a
+		// callback.
+		// Inputs:
+		//	const char* const*	line1		street addresses
+		//	const char* const*	line2		city, state, zip; null for none
+		//	int					count		number of addresses
+		//	ResultCallback&		callback	receives the results
+		// Return value:
+		//	bool		false if the pool is not open.
+		///////////////////////////////////////////////////////////////////////
+		bool CodeBatch(
+			const char* const* line1,
+			const char* const* line2,
+			int count,
+			ResultCallback& callback
+		);
+
+		///////////////////////////////////////////////////////////////////////
+		// Code a batch of addresses into a buffer, in the order given.
+		// Outputs:
+		//	Result*				resultsReturn	count results
+		// Return value:
+		//	bool		false if the pool is not open.
+		///////////////////////////////////////////////////////////////////////
+		bool CodeBatch(
+			const char* const* line1,
+			const char* const* line2,
+			int count,
+			Result* resultsReturn
+		);
+
+		///////////////////////////////////////////////////////////////////////
+		// Number of worker threads; 0 if not open.
+		///////////////////////////////////////////////////////////////////////
+		int GetThreadCount() const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Get the number of chunks coded since Open(), and how many of them
+		// were stolen from another worker's queue.
+		///////////////////////////////////////////////////////////////////////
+		void GetChunkCounts(long& chunksReturn, long& stolenReturn) const;
+
+	private:
+		// Copy ctor and op= are not implemented.
+		GeocoderPool(const GeocoderPool&);
+		GeocoderPool& operator=(const GeocoderPool&);
+
+		// The implementation class that really does all the work.
+		GeocoderPoolImp* imp;
+	};
+
+}
+
+#endif
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../geocommon/Geocoder_Headers.h"
 #include "Geocoder.h"
+#include "GeocoderPool.h"
 #include "Geocoder_C.h"
 
 namespace PortfolioExplorer {
@@ -39,6 +40,84 @@ namespace PortfolioExplorer {
 			m_strLastError = message;
 		}
 		GeocodeResults m_lastResults;
+
+		// The latest request's counters, or the totals, for the GEO_PROFILE_ functions
+		RequestStats m_profileStats;
+		const RequestStats& GetProfileStats(int bTotals)
+		{
+			if (bTotals) {
+				long nbrRequests;
+				GetProfileTotals(m_profileStats, nbrRequests);
+			} else {
+				GetRequestStats(m_profileStats);
+			}
+			return m_profileStats;
+		}
+	};
+
+	// The pool's geocoders are Geocoder_C_Helper objects, so that the pool callback
+	// can hand them to the GEO_RESULT_ functions.
+	struct Geocoder_C_PoolHelper : public GeocoderPool
+	{
+		Geocoder_C_PoolHelper(const char* tableDir, const char* databaseDir, int memUse, int nThreads, bool bPinThreads)
+			: GeocoderPool(tableDir, databaseDir, (Geocoder::MemUse)memUse, nThreads, bPinThreads)
+		{
+		}
+		// The workers are stopped here, while DeleteGeocoder() and ErrorMessage()
+		// are still this class's.
+		virtual ~Geocoder_C_PoolHelper()
+		{
+			Close();
+		}
+
+		TsString m_strLastError;
+		virtual void ErrorMessage(const char* message)
+		{
+			m_strLastError = message;
+		}
+		virtual Geocoder* CreateGeocoder(const char* tableDir, const char* databaseDir, Geocoder::MemUse memUse);
+		virtual void DeleteGeocoder(Geocoder* geocoder);
+	};
+
+	struct Geocoder_C_PoolWorker : public Geocoder_C_Helper
+	{
+		Geocoder_C_PoolWorker(Geocoder_C_PoolHelper& pool, const char* tableDir, const char* databaseDir, int memUse)
+			: Geocoder_C_Helper(tableDir, databaseDir, memUse), m_pool(pool)
+		{
+		}
+
+		Geocoder_C_PoolHelper& m_pool;
+		virtual void ErrorMessage(const char* message)
+		{
+			m_strLastError = message;
+			m_pool.ReportError(message);
+		}
+	};
+
+	Geocoder* Geocoder_C_PoolHelper::CreateGeocoder(const char* tableDir, const char* databaseDir, Geocoder::MemUse memUse)
+	{
+		return new Geocoder_C_PoolWorker(*this, tableDir, databaseDir, memUse);
+	}
+
+	void Geocoder_C_PoolHelper::DeleteGeocoder(Geocoder* geocoder)
+	{
+		delete static_cast<Geocoder_C_PoolWorker*>(geocoder);
+	}
+
+	struct Geocoder_C_PoolCallback : public GeocoderPool::ResultCallback
+	{
+		Geocoder_C_PoolCallback(GEO_POOL_CALLBACK pCallback, void* pContext)
+			: m_pCallback(pCallback), m_pContext(pContext)
+		{
+		}
+
+		GEO_POOL_CALLBACK m_pCallback;
+		void* m_pContext;
+		virtual void AddressCoded(int index, Geocoder::GlobalStatus status, Geocoder& geocoder)
+		{
+			Geocoder_C_Helper* pGeocoder = static_cast<Geocoder_C_Helper*>(&geocoder);
+			m_pCallback(m_pContext, index, status, reinterpret_cast<intptr_t>(pGeocoder));
+		}
 	};
 }
 
@@ -68,6 +147,26 @@ GEO_EXPORT(int) GEO_CodeAddress(intptr_t nHandle, const char* line1, const char*
 	return pGeocoder->CodeAddress(line1, line2);
 }
 
+GEO_EXPORT(int) GEO_CodeAddressFields(intptr_t nHandle,
+	const char* addrNbr, const char* predir, const char* street, const char* suffix, const char* postdir,
+	const char* unitDes, const char* unit, const char* city, const char* state, const char* postcode,
+	int normalizeAliases)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	PortfolioExplorer::Geocoder::AddressFields fields;
+	fields.addrNbr = addrNbr;
+	fields.predir = predir;
+	fields.street = street;
+	fields.suffix = suffix;
+	fields.postdir = postdir;
+	fields.unitDes = unitDes;
+	fields.unit = unit;
+	fields.city = city;
+	fields.state = state;
+	fields.postcode = postcode;
+	return pGeocoder->CodeAddressFields(fields, normalizeAliases != 0);
+}
+
 GEO_EXPORT(int) GEO_GetNextCandidate(intptr_t nHandle)
 {
 	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
@@ -213,3 +312,121 @@ GEO_EXPORT(const char*) GEO_RESULT_GetPostdir2(intptr_t nHandle)
 	return pGeocoder->m_lastResults.GetPostdir2();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Profiling
+GEO_EXPORT(void) GEO_SetProfiling(intptr_t nHandle, int bEnable)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	pGeocoder->SetProfiling(bEnable != 0);
+}
+GEO_EXPORT(double) GEO_PROFILE_GetPhaseMicroseconds(intptr_t nHandle, int bTotals, int nPhase)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	const PortfolioExplorer::Geocoder::RequestStats& stats = pGeocoder->GetProfileStats(bTotals);
+	if (nPhase == PortfolioExplorer::Geocoder::ProfileTotal) {
+		return stats.totalMicroseconds;
+	}
+	return (nPhase >= 0 && nPhase < PortfolioExplorer::Geocoder::NbrProfilePhases) ? stats.phaseMicroseconds[nPhase] : 0.0;
+}
+GEO_EXPORT(int) GEO_PROFILE_GetRecordsDecoded(intptr_t nHandle, int bTotals, int nTable)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	const PortfolioExplorer::Geocoder::RequestStats& stats = pGeocoder->GetProfileStats(bTotals);
+	return (nTable >= 0 && nTable < PortfolioExplorer::Geocoder::NbrProfileTables) ? int(stats.recordsDecoded[nTable]) : 0;
+}
+GEO_EXPORT(int) GEO_PROFILE_GetCacheHits(intptr_t nHandle, int bTotals, int nCache)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	const PortfolioExplorer::Geocoder::RequestStats& stats = pGeocoder->GetProfileStats(bTotals);
+	return (nCache >= 0 && nCache < PortfolioExplorer::Geocoder::NbrProfileCaches) ? int(stats.cacheHits[nCache]) : 0;
+}
+GEO_EXPORT(int) GEO_PROFILE_GetCacheMisses(intptr_t nHandle, int bTotals, int nCache)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	const PortfolioExplorer::Geocoder::RequestStats& stats = pGeocoder->GetProfileStats(bTotals);
+	return (nCache >= 0 && nCache < PortfolioExplorer::Geocoder::NbrProfileCaches) ? int(stats.cacheMisses[nCache]) : 0;
+}
+GEO_EXPORT(double) GEO_PROFILE_GetBitsDecoded(intptr_t nHandle, int bTotals)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	return pGeocoder->GetProfileStats(bTotals).bitsDecoded;
+}
+GEO_EXPORT(int) GEO_PROFILE_GetRequestCount(intptr_t nHandle)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	long nbrRequests;
+	pGeocoder->GetProfileTotals(pGeocoder->m_profileStats, nbrRequests);
+	return int(nbrRequests);
+}
+GEO_EXPORT(int) GEO_PROFILE_GetHistogram(intptr_t nHandle, int nPhase, int* pCounts, int nMaxBuckets)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	PortfolioExplorer::Geocoder::LatencyHistogram histogram;
+	if (!pGeocoder->GetLatencyHistogram(nPhase, histogram)) {
+		return 0;
+	}
+	int nBuckets = PortfolioExplorer::Geocoder::LatencyHistogram::NbrBuckets;
+	if (nBuckets > nMaxBuckets) {
+		nBuckets = nMaxBuckets;
+	}
+	for (int i = 0; i < nBuckets; i++) {
+		pCounts[i] = int(histogram.counts[i]);
+	}
+	return nBuckets;
+}
+GEO_EXPORT(void) GEO_PROFILE_Reset(intptr_t nHandle)
+{
+	PortfolioExplorer::Geocoder_C_Helper *pGeocoder = reinterpret_cast<PortfolioExplorer::Geocoder_C_Helper *>(nHandle);
+	pGeocoder->ResetProfile();
+}
+GEO_EXPORT(const char*) GEO_PROFILE_GetPhaseName(int nPhase)
+{
+	return PortfolioExplorer::Geocoder::GetProfilePhaseName(nPhase);
+}
+GEO_EXPORT(const char*) GEO_PROFILE_GetTableName(int nTable)
+{
+	return PortfolioExplorer::Geocoder::GetProfileTableName(nTable);
+}
+GEO_EXPORT(const char*) GEO_PROFILE_GetCacheName(int nCache)
+{
+	return PortfolioExplorer::Geocoder::GetProfileCacheName(nCache);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocoder pool
+GEO_EXPORT(intptr_t) GEO_PoolOpen(const char* tableDir, const char* databaseDir, int nMemUse,
+	int nThreads, int bPinThreads, char *pErrorReturn)
+{
+	PortfolioExplorer::Geocoder_C_PoolHelper *pPool =
+		new PortfolioExplorer::Geocoder_C_PoolHelper(tableDir, databaseDir, nMemUse, nThreads, bPinThreads != 0);
+	if (!pPool->Open())
+	{
+		strncpy(pErrorReturn, pPool->m_strLastError.c_str(), 256);
+		pErrorReturn[255] = 0;
+		delete pPool;
+		return NULL;
+	}
+
+	return reinterpret_cast<intptr_t>(pPool);
+}
+
+GEO_EXPORT(void) GEO_PoolClose(intptr_t hPool)
+{
+	PortfolioExplorer::Geocoder_C_PoolHelper *pPool = reinterpret_cast<PortfolioExplorer::Geocoder_C_PoolHelper *>(hPool);
+	delete pPool;
+}
+
+GEO_EXPORT(void) GEO_PoolSetChunkSize(intptr_t hPool, int nChunkSize)
+{
+	PortfolioExplorer::Geocoder_C_PoolHelper *pPool = reinterpret_cast<PortfolioExplorer::Geocoder_C_PoolHelper *>(hPool);
+	pPool->SetChunkSize(nChunkSize);
+}
+
+GEO_EXPORT(int) GEO_PoolCodeBatch(intptr_t hPool, int nCount,
+	const char* const* line1, const char* const* line2,
+	GEO_POOL_CALLBACK pCallback, void* pContext)
+{
+	PortfolioExplorer::Geocoder_C_PoolHelper *pPool = reinterpret_cast<PortfolioExplorer::Geocoder_C_PoolHelper *>(hPool);
+	PortfolioExplorer::Geocoder_C_PoolCallback callback(pCallback, pContext);
+	return pPool->CodeBatch(line1, line2, nCount, callback) ? 1 : 0;
+}
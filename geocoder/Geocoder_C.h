@@ -120,6 +120,52 @@ const int GEO_ChooseStreetOwnerCountrySpecific = 2;	// DEFAULT
 									// owner (because three-letter postcode granularity holds several cities).
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Phases, tables and caches for the GEO_PROFILE_ functions
+const int GEO_ProfileLastLineParse = 0;		// parsing the city/state/postcode line
+const int GEO_ProfileChooseLastLine = 1;		// finding the City/State/Postcode records
+const int GEO_ProfileFirstLineParse = 2;		// parsing the street address line
+const int GEO_ProfileStreetNameFetch = 3;		// looking up street names and intersections
+const int GEO_ProfileSegmentScoring = 4;		// reading and scoring street segments
+const int GEO_ProfileSortResults = 5;			// sorting the candidates and removing duplicates
+const int GEO_ProfileCodeResult = 6;			// interpolating the coordinates of a candidate
+const int GEO_ProfileOther = 7;
+const int GEO_ProfileTotal = 8;				// the whole request
+const int GEO_NbrProfilePhases = 8;
+
+const int GEO_ProfileCityStatePostcode = 0;
+const int GEO_ProfileCityStatePostcodeFaIndex = 1;
+const int GEO_ProfileCitySoundex = 2;
+const int GEO_ProfileStreetName = 3;
+const int GEO_ProfileStreetNameSoundex = 4;
+const int GEO_ProfileStreetSegment = 5;
+const int GEO_ProfileCoordinate = 6;
+const int GEO_ProfileStreetIntersectionSoundex = 7;
+const int GEO_ProfilePostcodeAlias = 8;
+const int GEO_ProfilePostcodeCentroid = 9;
+const int GEO_NbrProfileTables = 10;
+
+const int GEO_ProfileCacheCityStatePostcodeByID = 0;
+const int GEO_ProfileCacheCityStatePostcodeSoundexByID = 1;
+const int GEO_ProfileCacheCityStatePostcodeFaIndexByID = 2;
+const int GEO_ProfileCacheCityStatePostcodeFaIndexFromFa = 3;
+const int GEO_ProfileCacheStreetNameByID = 4;
+const int GEO_ProfileCacheStreetNameSoundexByID = 5;
+const int GEO_ProfileCacheStreetNameSoundexFaSoundex = 6;
+const int GEO_ProfileCacheStreetSegmentByID = 7;
+const int GEO_ProfileCacheCoordinateByID = 8;
+const int GEO_ProfileCacheStreetIntersectionSoundexByID = 9;
+const int GEO_ProfileCachePostcodeAliasByPostcodeID = 10;
+const int GEO_ProfileCachePostcodeAliasByGroupID = 11;
+const int GEO_ProfileCachePostcodeGroupFromPostcode = 12;
+const int GEO_ProfileCachePostcodeGroupIDFromPostcodeGroup = 13;
+const int GEO_ProfileCachePostcodeCentroidByID = 14;
+const int GEO_ProfileCachePostcodeCentroidFromPostcode = 15;
+const int GEO_NbrProfileCaches = 16;
+
+const int GEO_ProfileHistogramBuckets = 24;
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // pErrorReturn MUST point to a 256 character buffer and will receive any error message
 // if this fails (returns NULL)
@@ -132,6 +178,24 @@ GEO_EXPORT(int) GEO_CodeAddress(intptr_t nHandle,
 	const char* line2					// city, state, zip
 );
 
+// Same as GEO_CodeAddress, for addresses whose components are already separated.
+// Any component may be NULL.  If normalizeAliases is nonzero, standard aliases are
+// substituted for directionals, suffix, unit designator and state.
+// returns the status flags
+GEO_EXPORT(int) GEO_CodeAddressFields(intptr_t nHandle,
+	const char* addrNbr,				// address number
+	const char* predir,					// predirectional
+	const char* street,					// street name
+	const char* suffix,					// street suffix
+	const char* postdir,				// postdirectional
+	const char* unitDes,				// unit designator
+	const char* unit,					// unit
+	const char* city,					// city name
+	const char* state,					// state name or abbreviation
+	const char* postcode,				// ZIP, ZIP+4 or Canadian postal code
+	int normalizeAliases
+);
+
 // returns 1 if there is a next candidate, 0 if none
 GEO_EXPORT(int) GEO_GetNextCandidate(intptr_t nHandle);
 
@@ -169,6 +233,76 @@ GEO_EXPORT(const char*) GEO_RESULT_GetStreet2(intptr_t nHandle);		// intersectin
 GEO_EXPORT(const char*) GEO_RESULT_GetSuffix2(intptr_t nHandle);		// intersecting street suffix
 GEO_EXPORT(const char*) GEO_RESULT_GetPostdir2(intptr_t nHandle);		// intersecting street postdirectional
 
+///////////////////////////////////////////////////////////////////////////////
+// Profiling: timing of the phases of each request (a GEO_CodeAddress call and the
+// GEO_GetNextCandidate calls after it) and counts of the records decoded, cache
+// hits and misses and bits decoded.  See Geocoder.h.
+// Off by default; bEnable nonzero turns it on.
+GEO_EXPORT(void) GEO_SetProfiling(intptr_t nHandle, int bEnable);
+
+// The following return the counters of the latest request if bTotals is zero,
+// or the sums since GEO_PROFILE_Reset if it is nonzero.  Reading them ends the
+// request, so read them after its last GEO_GetNextCandidate.
+GEO_EXPORT(double) GEO_PROFILE_GetPhaseMicroseconds(intptr_t nHandle, int bTotals, int nPhase);	// nPhase may be GEO_ProfileTotal
+GEO_EXPORT(int) GEO_PROFILE_GetRecordsDecoded(intptr_t nHandle, int bTotals, int nTable);
+GEO_EXPORT(int) GEO_PROFILE_GetCacheHits(intptr_t nHandle, int bTotals, int nCache);
+GEO_EXPORT(int) GEO_PROFILE_GetCacheMisses(intptr_t nHandle, int bTotals, int nCache);
+GEO_EXPORT(double) GEO_PROFILE_GetBitsDecoded(intptr_t nHandle, int bTotals);
+
+// Number of requests profiled since GEO_PROFILE_Reset
+GEO_EXPORT(int) GEO_PROFILE_GetRequestCount(intptr_t nHandle);
+
+// Copies the latency histogram of a phase (or GEO_ProfileTotal) into pCounts.
+// Bucket 0 counts the requests under 1 microsecond, bucket i those from 2^(i-1)
+// up to 2^i microseconds, and the last bucket everything longer.
+// returns the number of buckets copied, at most nMaxBuckets
+GEO_EXPORT(int) GEO_PROFILE_GetHistogram(intptr_t nHandle, int nPhase, int* pCounts, int nMaxBuckets);
+
+// Clears the sums and histograms
+GEO_EXPORT(void) GEO_PROFILE_Reset(intptr_t nHandle);
+
+// Names for reports; "" if out of range
+GEO_EXPORT(const char*) GEO_PROFILE_GetPhaseName(int nPhase);
+GEO_EXPORT(const char*) GEO_PROFILE_GetTableName(int nTable);
+GEO_EXPORT(const char*) GEO_PROFILE_GetCacheName(int nCache);
+
+///////////////////////////////////////////////////////////////////////////////
+// Geocoder pool: codes batches of addresses on several threads, each with its
+// own geocoder.  See GeocoderPool.h.
+
+// Called once for each address of a batch, on one of the pool's threads, with
+// several calls running at once and in no particular order.  hGeocoder is that
+// thread's geocoder, as after GEO_CodeAddress: call GEO_GetNextCandidate and the
+// GEO_RESULT_ functions on it to read the candidates.  It is valid only until
+// the callback returns.
+typedef void (__stdcall *GEO_POOL_CALLBACK)(
+	void* pContext,						// as passed to GEO_PoolCodeBatch
+	int nIndex,							// position of the address in the batch
+	int nGlobalStatus,					// the return value of GEO_CodeAddress
+	intptr_t hGeocoder
+);
+
+// nThreads may be 0 for one thread per processor.  If bPinThreads is nonzero,
+// each thread is bound to one processor, spread over the NUMA nodes.
+// pErrorReturn MUST point to a 256 character buffer and will receive any error message
+// if this fails (returns NULL)
+GEO_EXPORT(intptr_t) GEO_PoolOpen(const char* tableDir, const char* databaseDir, int nMemUse,
+	int nThreads, int bPinThreads, char *pErrorReturn);
+GEO_EXPORT(void) GEO_PoolClose(intptr_t hPool);
+
+// Number of consecutive addresses handed to a thread at a time
+GEO_EXPORT(void) GEO_PoolSetChunkSize(intptr_t hPool, int nChunkSize);
+
+// Codes nCount addresses and returns once pCallback has been called for each.
+// line2 may be NULL if there are no second lines.
+// returns 1 on success, 0 if the pool is not open
+GEO_EXPORT(int) GEO_PoolCodeBatch(intptr_t hPool, int nCount,
+	const char* const* line1,			// street addresses
+	const char* const* line2,			// city, state, zip
+	GEO_POOL_CALLBACK pCallback,
+	void* pContext
+);
+
 
 
 
@@ -35,6 +35,7 @@ namespace PortfolioExplorer {
 
 	GeoLoadBase::GeoLoadBase()
 		: numberOfOutputRecords(0)
+		, packedOutput(false)
 	{
 	}
 
@@ -57,4 +58,34 @@ namespace PortfolioExplorer {
 		}
 
 	}
+
+	void GeoLoadBase::OpenPackedTable(PackedTableWriter& writer, const char* filename)
+	{
+		TsString path = outdir + "/" + filename;
+		if (!writer.Open(path, PackedBlockSize)) {
+			throw TsString("Cannot open file " + path + " for output");
+		}
+	}
+
+	void GeoLoadBase::WritePackedBlock(PackedTableWriter& writer, const PackedBlockWriter& block, int nbrRecords)
+	{
+		if (!writer.WriteBlock(block, nbrRecords)) {
+			throw TsString("Error writing packed table block");
+		}
+	}
+
+	void GeoLoadBase::ClosePackedTable(PackedTableWriter& writer, const char* filename)
+	{
+		if (!writer.Close()) {
+			throw TsString("Cannot write " + outdir + "/" + filename);
+		}
+	}
+
+	void GeoLoadBase::AppendCharField(std::vector<char>& column, const TsString& value, int width)
+	{
+		size_t start = column.size();
+		column.resize(start + width, 0);
+		size_t length = value.size() < size_t(width - 1) ? value.size() : size_t(width - 1);
+		memcpy(&column[start], value.data(), length);
+	}
 } // namespace
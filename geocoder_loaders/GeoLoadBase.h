@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 #include "ReadCSV.h"
 #include "../geocommon/geoutil.h"
+#include "../geocommon/GeoPackedTable.h"
 #include "GeoloadUtilities.h"
 #include "math.h"
 
@@ -42,9 +43,27 @@ namespace PortfolioExplorer {
 		void Open(const char * pFileName, const char *pOutputDir);
 		virtual void Process() = 0;
 
+		// Write the StreetName, StreetSegment and Coordinate tables as
+		// packed tables instead of Huffman-coded ones.  Other loaders
+		// ignore this.
+		void SetPackedOutput(bool packedOutput_) { packedOutput = packedOutput_; }
+
 	protected:
 		virtual std::vector<TsString> GetFieldParameters() = 0;
 
+		// Open a packed table in the output directory.  Throws on error.
+		void OpenPackedTable(PackedTableWriter& writer, const char* filename);
+
+		// Append a block to a packed table.  Throws on error.
+		void WritePackedBlock(PackedTableWriter& writer, const PackedBlockWriter& block, int nbrRecords);
+
+		// Finish a packed table.  Throws on error.
+		void ClosePackedTable(PackedTableWriter& writer, const char* filename);
+
+		// Append a string to a fixed-width column, truncating it to leave
+		// room for the terminator and padding it with nulls.
+		static void AppendCharField(std::vector<char>& column, const TsString& value, int width);
+
 		class FieldAccessor
 		{
 		public:
@@ -62,13 +81,14 @@ namespace PortfolioExplorer {
 				return m_pParent->m_readCSV.GetValue(m_nFieldNum);
 			}
 
+			// Parsed in place from the input buffer
 			int GetAsInt()
 			{
-				return atol(GetAsString().c_str());
+				return m_pParent->m_readCSV.GetAsInt(m_nFieldNum);
 			}
 			double GetAsDouble()
 			{
-				return atof(GetAsString().c_str());
+				return m_pParent->m_readCSV.GetAsDouble(m_nFieldNum);
 			}
 
 			bool IsValidDouble()
@@ -78,7 +98,8 @@ namespace PortfolioExplorer {
 
 			bool GetAsBoolean()
 			{
-				char c = GetAsString()[0];
+				const ReadCSV::Field& field = m_pParent->m_readCSV.GetField(m_nFieldNum);
+				char c = (field.len != 0) ? field.ptr[0] : 0;
 				return (c!='0' && iswdigit(c)) || 'T'==towupper(c);
 			}
 		};
@@ -92,8 +113,12 @@ namespace PortfolioExplorer {
 
 		// The number of records that have been written to the output.
 		int numberOfOutputRecords;
+
+		// Write packed tables?
+		bool packedOutput;
 	public:
 		int GetNumberOfOutputRecords() const { return numberOfOutputRecords; }
+		__int64 GetInputSize() const { return m_readCSV.GetFileSize(); }
 	};
 }
 
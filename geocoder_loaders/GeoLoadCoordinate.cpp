@@ -31,82 +31,338 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include "BitStreamAdaptor.h"
+#include "GeoLoadParallel.h"
 
 namespace PortfolioExplorer {
 
+	// One coordinate, converted to integers
+	struct CoordinateRecord {
+		int latitude;
+		int longitude;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Reads the records of one shard from the input file, on its own view of
+	// the file, so that shards can be read on different threads.
+	///////////////////////////////////////////////////////////////////////////////
+	class CoordinateShardReader {
+	public:
+		// Shard readers map 4MB views instead of the default 64MB, since
+		// one is open on each thread.
+		enum { ViewSize = 0x400000 };
+
+		CoordinateShardReader(
+			const TsString& filename,
+			__int64 offset,
+			int latitudeField_,
+			int longitudeField_
+		) : latitudeField(latitudeField_), longitudeField(longitudeField_) {
+			reader.SetViewSize(ViewSize);
+			reader.Open(filename);
+			reader.Seek(offset);
+		}
+
+		// Read the next record of the shard.
+		void Next(CoordinateRecord& record) {
+			if (!reader.ReadRecord()) {
+				throw TsString("Coordinate input changed while loading");
+			}
+			record.latitude = int(reader.GetAsDouble(latitudeField) * 100000 + 0.5);
+			record.longitude = int(reader.GetAsDouble(longitudeField) * 100000 + 0.5);
+		}
+
+	private:
+		ReadCSV reader;
+		int latitudeField;
+		int longitudeField;
+	};
+
+	// Where the input of the shards is
+	struct CoordinateInput {
+		TsString filename;
+		// Byte offset of the first record of each chunk
+		std::vector<__int64> chunkStarts;
+		int latitudeField;
+		int longitudeField;
+
+		__int64 ShardStart(const GeoLoadShard& shard) const {
+			return chunkStarts[shard.firstRecord / GeoUtil::CoordinateChunkSize];
+		}
+	};
+
+	// Frequency tables for one shard
+	struct CoordinateFreqTables {
+		FreqTable<int> latitude1;
+		FreqTable<int> latitude2;
+		FreqTable<int> longitude1;
+		FreqTable<int> longitude2;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Count the frequencies of one shard.
+	///////////////////////////////////////////////////////////////////////////////
+	class CoordinateCountTask {
+	public:
+		CoordinateCountTask(
+			const CoordinateInput& input_,
+			const std::vector<GeoLoadShard>& shards_,
+			std::vector<CoordinateFreqTables>& freqTables_
+		) : input(input_), shards(shards_), freqTables(freqTables_) {}
+
+		void operator()(int shardIdx) {
+			const GeoLoadShard& shard = shards[shardIdx];
+			CoordinateFreqTables& tables = freqTables[shardIdx];
+			CoordinateShardReader reader(input.filename, input.ShardStart(shard), input.latitudeField, input.longitudeField);
+			unsigned char tmpBuf[100];
+			int varIntLength;
+			CoordinateRecord record = { 0, 0 };
+			CoordinateRecord prev = record;
+			for (int recordIdx = shard.firstRecord; recordIdx < shard.endRecord; recordIdx++) {
+				prev = record;
+				reader.Next(record);
+				if (recordIdx % GeoUtil::CoordinateChunkSize == 0) {
+					// Key-record 
+					continue;
+				}
+
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.latitude - prev.latitude, tmpBuf);
+				tables.latitude1.Count(tmpBuf[0]);
+				{for (int i = 1; i < varIntLength; i++) {
+					tables.latitude2.Count(tmpBuf[i]);
+				}}
+
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.longitude - prev.longitude, tmpBuf);
+				tables.longitude1.Count(tmpBuf[0]);
+				{for (int i = 1; i < varIntLength; i++) {
+					tables.longitude2.Count(tmpBuf[i]);
+				}}
+			}
+		}
+
+	private:
+		const CoordinateInput& input;
+		const std::vector<GeoLoadShard>& shards;
+		std::vector<CoordinateFreqTables>& freqTables;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Encode one shard into memory.  The coders are only read, so they
+	// may be shared by all threads.
+	///////////////////////////////////////////////////////////////////////////////
+	class CoordinateEncodeTask {
+	public:
+		typedef HuffmanCoder<int, std::less<int> > Coder;
+
+		CoordinateEncodeTask(
+			const CoordinateInput& input_,
+			std::vector<GeoLoadShard>& shards_,
+			Coder& latitudeCoder1_,
+			Coder& latitudeCoder2_,
+			Coder& longitudeCoder1_,
+			Coder& longitudeCoder2_
+		) : 
+			input(input_), shards(shards_),
+			latitudeCoder1(latitudeCoder1_), latitudeCoder2(latitudeCoder2_),
+			longitudeCoder1(longitudeCoder1_), longitudeCoder2(longitudeCoder2_)
+		{}
+
+		void operator()(int shardIdx) {
+			GeoLoadShard& shard = shards[shardIdx];
+			BitStreamWrite dataBitStream(new MemoryBitStreamAdaptor(shard.bytes));
+			CoordinateShardReader reader(input.filename, input.ShardStart(shard), input.latitudeField, input.longitudeField);
+			unsigned char tmpBuf[100];
+			int varIntLength;
+			CoordinateRecord record = { 0, 0 };
+			CoordinateRecord prev = record;
+
+			for (int recordIdx = shard.firstRecord; recordIdx < shard.endRecord; recordIdx++) {
+				prev = record;
+				reader.Next(record);
+				bool keyRecord = (recordIdx % GeoUtil::CoordinateChunkSize == 0);
+				if (keyRecord) {
+					shard.chunkOffsets.push_back(dataBitStream.GetNumberOfBitsWritten());
+				}
+
+				// Latitude
+				if (keyRecord) {
+					dataBitStream.WriteBitsFromInt(GeoUtil::CoordinateLatitudeBitSize, record.latitude);
+				} else {
+					varIntLength = GeoUtil::IntToVarLengthBuf(record.latitude - prev.latitude, tmpBuf);
+					if (!latitudeCoder1.WriteCode(tmpBuf[0], dataBitStream)) {
+						throw TsString("Error in huffman code table");
+					}
+					for (int i = 1; i < varIntLength; i++) {
+						if (!latitudeCoder2.WriteCode(tmpBuf[i], dataBitStream)) {
+							throw TsString("Error in huffman code table");
+						}
+					}
+				}
+
+				// Longitude
+				if (keyRecord) {
+					dataBitStream.WriteBitsFromInt(GeoUtil::CoordinateLongitudeBitSize, record.longitude);
+				} else {
+					varIntLength = GeoUtil::IntToVarLengthBuf(record.longitude - prev.longitude, tmpBuf);
+					if (!longitudeCoder1.WriteCode(tmpBuf[0], dataBitStream)) {
+						throw TsString("Error in huffman code table");
+					}
+					for (int i = 1; i < varIntLength; i++) {
+						if (!longitudeCoder2.WriteCode(tmpBuf[i], dataBitStream)) {
+							throw TsString("Error in huffman code table");
+						}
+					}
+				}
+			}
+			shard.nbrBits = dataBitStream.GetNumberOfBitsWritten();
+			dataBitStream.Flush();
+		}
+
+	private:
+		const CoordinateInput& input;
+		std::vector<GeoLoadShard>& shards;
+		Coder& latitudeCoder1;
+		Coder& latitudeCoder2;
+		Coder& longitudeCoder1;
+		Coder& longitudeCoder2;
+	};
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Process the records for a terminal node.
+	// The input is scanned once to check it and find where each chunk starts.
+	// Counting and encoding then run in parallel over shards of whole chunks,
+	// each reading its own records from the file, so the records are never
+	// all in memory.  What is held is 8 bytes per chunk of offsets, and the
+	// encoded shards, about the size of the output file, until they are
+	// written.
 	// Return value:
 	//	bool		true on success, false on error or abort
 	///////////////////////////////////////////////////////////////////////////////
 	void GeoLoadCoordinate::Process()
 	{
+		GeoLoadStageTimer timer("Coordinate");
 		numberOfOutputRecords = 0;
 
-		bool inputOK = m_readCSV.ReadRecord();
+		// Get local variable equivalents of bound fields.
+		FieldAccessor coordinateIDValue = m_mapFieldAccessors["COORDINATE_ID"];
+		FieldAccessor latitudeValue = m_mapFieldAccessors["LATITUDE"];
+		FieldAccessor longitudeValue = m_mapFieldAccessors["LONGITUDE"];
+
+		if (packedOutput) {
+			// Write blocks of delta-coded latitude and longitude columns
+			// as the records are read.
+			PackedTableWriter writer;
+			OpenPackedTable(writer, COORDINATE_PACKED_FILE);
+			PackedBlockWriter block;
+			std::vector<int> latitudes;
+			std::vector<int> longitudes;
+			int nbrRecords = 0;
+			for (;;) {
+				bool inputOK = m_readCSV.ReadRecord();
+				if (inputOK) {
+					// Check validity of data
+					if (coordinateIDValue.GetAsInt() != nbrRecords) {
+						throw TsString("Coordinate ID is out of sequence");
+					}
+					latitudes.push_back(int(latitudeValue.GetAsDouble() * 100000 + 0.5));
+					longitudes.push_back(int(longitudeValue.GetAsDouble() * 100000 + 0.5));
+					nbrRecords++;
+				}
+				if (!latitudes.empty() && (!inputOK || int(latitudes.size()) == PackedBlockSize)) {
+					int count = int(latitudes.size());
+					block.Clear();
+					block.AddDeltaColumn(&latitudes[0], count);
+					block.AddDeltaColumn(&longitudes[0], count);
+					WritePackedBlock(writer, block, count);
+					latitudes.clear();
+					longitudes.clear();
+				}
+				if (!inputOK) {
+					break;
+				}
+			}
+			if (nbrRecords == 0) {
+				throw TsString("No records to read");
+			}
+			ClosePackedTable(writer, COORDINATE_PACKED_FILE);
+			numberOfOutputRecords = nbrRecords;
+			timer.EndStage("write");
+			timer.EndLoader();
+			return;
+		}
 
-		if (!inputOK)
+		// Check the records, and note where each chunk starts.
+		CoordinateInput input;
+		input.filename = m_readCSV.GetFileName();
+		input.latitudeField = latitudeValue.m_nFieldNum;
+		input.longitudeField = longitudeValue.m_nFieldNum;
+		int nbrRecords = 0;
+		for (;;) {
+			__int64 position = m_readCSV.GetFilePosition();
+			if (!m_readCSV.ReadRecord()) {
+				break;
+			}
+			if (coordinateIDValue.GetAsInt() != nbrRecords) {
+				throw TsString("Coordinate ID is out of sequence");
+			}
+			if (nbrRecords % CoordinateChunkSize == 0) {
+				input.chunkStarts.push_back(position);
+			}
+			nbrRecords++;
+		}
+		if (nbrRecords == 0) {
 			throw TsString("No records to read");
+		}
+		timer.EndStage("read");
+
+		std::vector<GeoLoadShard> shards;
+		MakeShards(nbrRecords, CoordinateChunkSize, shards);
 
-		// Frequency-counting tables.
+		// Analyze frequency counts for Huffman coding, then merge the shards.
 		FreqTable<int> latitudeFreqTable1;
 		FreqTable<int> latitudeFreqTable2;
 		FreqTable<int> longitudeFreqTable1;
 		FreqTable<int> longitudeFreqTable2;
-
-
-		// Used to convert lat/lon to integers.
-		int const100000 = 100000;
-
-		// Variables used inside loops
-		int tmpLongitude;
-		int tmpLatitude;
-		int prevLongitude;
-		int prevLatitude;
-		unsigned char tmpBuf[100];
-		int varIntLength;
-
-		// Get local variable equivalents of bound fields.
-		FieldAccessor coordinateIDValue = m_mapFieldAccessors["COORDINATE_ID"];
-		FieldAccessor latitudeValue = m_mapFieldAccessors["LATITUDE"];
-		FieldAccessor longitudeValue = m_mapFieldAccessors["LONGITUDE"];
-
-		// Read all records and analyze frequency counts for Huffman coding.
 		{
-			int chunkCount = 0;
+			std::vector<CoordinateFreqTables> shardFreqTables(shards.size());
+			CoordinateCountTask countTask(input, shards, shardFreqTables);
+			RunParallel(countTask, int(shards.size()));
+			for (unsigned i = 0; i < shardFreqTables.size(); i++) {
+				MergeFreqTable(latitudeFreqTable1, shardFreqTables[i].latitude1);
+				MergeFreqTable(latitudeFreqTable2, shardFreqTables[i].latitude2);
+				MergeFreqTable(longitudeFreqTable1, shardFreqTables[i].longitude1);
+				MergeFreqTable(longitudeFreqTable2, shardFreqTables[i].longitude2);
+			}
+		}
+		timer.EndStage("count frequencies");
 
-			do {
-				tmpLatitude = int(latitudeValue.GetAsDouble() * const100000 + 0.5);
-				tmpLongitude = int(longitudeValue.GetAsDouble() * const100000 + 0.5);
+		// Set up Huffman coding.
+		HuffmanCoder<int, std::less<int> > latitudeCoder1;
+		HuffmanCoder<int, std::less<int> > latitudeCoder2;
+		HuffmanCoder<int, std::less<int> > longitudeCoder1;
+		HuffmanCoder<int, std::less<int> > longitudeCoder2;
 
-				if (chunkCount == 0) {
-					// Key-record 
-				} else {
-					// Non-key-record
-					varIntLength = IntToVarLengthBuf(tmpLatitude - prevLatitude, tmpBuf);
-					latitudeFreqTable1.Count(tmpBuf[0]);
-					{for (int i = 1; i < varIntLength; i++) {
-						latitudeFreqTable2.Count(tmpBuf[i]);
-					}}
-
-					varIntLength = IntToVarLengthBuf(tmpLongitude - prevLongitude, tmpBuf);
-					longitudeFreqTable1.Count(tmpBuf[0]);
-					{for (int i = 1; i < varIntLength; i++) {
-						longitudeFreqTable2.Count(tmpBuf[i]);
-					}}
-				}
+		// Populate the huffman coder tables 
+		latitudeCoder1.AddEntries(latitudeFreqTable1);
+		latitudeCoder2.AddEntries(latitudeFreqTable2);
+		longitudeCoder1.AddEntries(longitudeFreqTable1);
+		longitudeCoder2.AddEntries(longitudeFreqTable2);
 
-				// Save previous values
-				prevLatitude = tmpLatitude;
-				prevLongitude = tmpLongitude;
+		// Generate Huffman codes
+		latitudeCoder1.MakeCanonicalCodes();
+		latitudeCoder2.MakeCanonicalCodes();
+		longitudeCoder1.MakeCanonicalCodes();
+		longitudeCoder2.MakeCanonicalCodes();
+		timer.EndStage("make codes");
 
-				chunkCount++;
-				if (chunkCount == CoordinateChunkSize) {
-					chunkCount = 0;
-				}
-			} while (m_readCSV.ReadRecord());
+		// Encode the shards
+		{
+			CoordinateEncodeTask encodeTask(
+				input, shards,
+				latitudeCoder1, latitudeCoder2, longitudeCoder1, longitudeCoder2
+			);
+			RunParallel(encodeTask, int(shards.size()));
 		}
-
+		timer.EndStage("encode");
 
 		// Open files
 		File dataFile;
@@ -130,104 +386,9 @@ namespace PortfolioExplorer {
 		// Create an output BitStream for the position-index file
 		BitStreamWrite positionIndexBitStream(new FileBitStreamAdaptor(positionIndexFile));
 
-		// Set up Huffman coding.
-		HuffmanCoder<int, std::less<int> > latitudeCoder1;
-		HuffmanCoder<int, std::less<int> > latitudeCoder2;
-		HuffmanCoder<int, std::less<int> > longitudeCoder1;
-		HuffmanCoder<int, std::less<int> > longitudeCoder2;
-
-		// Populate the huffman coder tables 
-		latitudeCoder1.AddEntries(latitudeFreqTable1);
-		latitudeCoder2.AddEntries(latitudeFreqTable2);
-		longitudeCoder1.AddEntries(longitudeFreqTable1);
-		longitudeCoder2.AddEntries(longitudeFreqTable2);
-
-		// Generate Huffman codes
-		latitudeCoder1.MakeCodes();
-		latitudeCoder2.MakeCodes();
-		longitudeCoder1.MakeCodes();
-		longitudeCoder2.MakeCodes();
-
-		int chunkCount = 0;
-
-		m_readCSV.ReOpen();
-		m_readCSV.ReadRecord();
-
-
-		while (m_readCSV.ReadRecord()) 
-		{
-
-
-			// Write position-index records.
-			// Must be written before the data file, to get the correct bit offset.
-			if (chunkCount == 0) {
-				__int64 bitsWritten = dataBitStream.GetNumberOfBitsWritten();
-
-				if (bitsWritten >= ((__int64)1 << CoordinatePositionIndexBitSize)) {
-					throw TsString("Coordinate position index uses " + FormatInteger(CoordinatePositionIndexBitSize) + " bits but must be larger");
-				}
-
-				if (CoordinatePositionIndexBitSize > 32) {
-					throw TsString("Coordinate position index uses " + FormatInteger(CoordinatePositionIndexBitSize) + " bits; must recode to use __int64 variables");
-				}
-
-				positionIndexBitStream.WriteBitsFromInt(CoordinatePositionIndexBitSize, (int)bitsWritten);
-			}
-
-
-			// Check validity of data
-			int coordinateID = (int)coordinateIDValue.GetAsInt();
-			
-			if (coordinateID != numberOfOutputRecords) {
-				throw TsString("Coordinate ID is out of sequence");
-			}
-
-			// Write the fields of the data record.
-
-			tmpLatitude = int(latitudeValue.GetAsDouble() * const100000 + 0.5);
-			tmpLongitude = int(longitudeValue.GetAsDouble() * const100000 + 0.5);
-
-			// Latitude
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(CoordinateLatitudeBitSize, tmpLatitude);
-			} else {
-				varIntLength = IntToVarLengthBuf(tmpLatitude - prevLatitude, tmpBuf);
-				if (!latitudeCoder1.WriteCode(tmpBuf[0], dataBitStream)) {
-					throw TsString("Error in huffman code table");
-				}
-				for (int i = 1; i < varIntLength; i++) {
-					if (!latitudeCoder2.WriteCode(tmpBuf[i], dataBitStream)) {
-						throw TsString("Error in huffman code table");
-					}
-				}
-			}
-
-			// Latitude
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(CoordinateLongitudeBitSize, tmpLongitude);
-			} else {
-				varIntLength = IntToVarLengthBuf(tmpLongitude - prevLongitude, tmpBuf);
-				if (!longitudeCoder1.WriteCode(tmpBuf[0], dataBitStream)) {
-					throw TsString("Error in huffman code table");
-				}
-				for (int i = 1; i < varIntLength; i++) {
-					if (!longitudeCoder2.WriteCode(tmpBuf[i], dataBitStream)) {
-						throw TsString("Error in huffman code table");
-					}
-				}
-			}
-
-			// Save previous values
-			prevLatitude = tmpLatitude;
-			prevLongitude = tmpLongitude;
-
-			chunkCount++;
-			numberOfOutputRecords++;
-			if (chunkCount == CoordinateChunkSize) {
-				chunkCount = 0;
-			}
-
-		}
+		// Stitch the shards together, writing position-index records as we go.
+		StitchShards(shards, CoordinatePositionIndexBitSize, "Coordinate", dataBitStream, positionIndexBitStream);
+		numberOfOutputRecords = nbrRecords;
 
 		// Flush bitstream to byte-align it.
 		positionIndexBitStream.Flush();
@@ -239,35 +400,37 @@ namespace PortfolioExplorer {
 		dataBitStream.Flush();
 		dataFile.Close();
 
-		// Write out the huffman code tables.
-		struct FreqTableFiledef {
-			FreqTableFiledef(
-				FreqTable<int>& table_,
-				TsString filename_
-			) : table(table_), filename(filename_)
+		// Write out the huffman code-length tables.
+		struct CoderFiledef {
+			CoderFiledef(
+				HuffmanCoder<int, std::less<int> >& coder_,
+				const char* filename_
+			) : coder(coder_), filename(GeoUtil::CodeLengthFilename(filename_))
 			{}
-			FreqTable<int>& table;
+			HuffmanCoder<int, std::less<int> >& coder;
 			TsString filename;
-		} freqTableFiledefs[] = {
-			FreqTableFiledef(latitudeFreqTable1, COORDINATE_LATITUDE_HUFF_FILE1),
-			FreqTableFiledef(latitudeFreqTable2, COORDINATE_LATITUDE_HUFF_FILE2),
-			FreqTableFiledef(longitudeFreqTable1, COORDINATE_LONGITUDE_HUFF_FILE1),
-			FreqTableFiledef(longitudeFreqTable2, COORDINATE_LONGITUDE_HUFF_FILE2),
+		} coderFiledefs[] = {
+			CoderFiledef(latitudeCoder1, COORDINATE_LATITUDE_HUFF_FILE1),
+			CoderFiledef(latitudeCoder2, COORDINATE_LATITUDE_HUFF_FILE2),
+			CoderFiledef(longitudeCoder1, COORDINATE_LONGITUDE_HUFF_FILE1),
+			CoderFiledef(longitudeCoder2, COORDINATE_LONGITUDE_HUFF_FILE2),
 		};
 
 		for (
-			int freqTableIdx = 0; 
-			freqTableIdx < sizeof(freqTableFiledefs)/sizeof(freqTableFiledefs[0]); 
-			freqTableIdx++
+			int coderIdx = 0; 
+			coderIdx < sizeof(coderFiledefs)/sizeof(coderFiledefs[0]); 
+			coderIdx++
 		) {
 			std::fstream fs;
-			filename = outdir + "/" + freqTableFiledefs[freqTableIdx].filename;
-			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-			if (fs.fail() || !freqTableFiledefs[freqTableIdx].table.Save(fs)) {
+			filename = outdir + "/" + coderFiledefs[coderIdx].filename;
+			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+			if (fs.fail() || !GeoUtil::SaveCodeLengths(coderFiledefs[coderIdx].coder, fs)) {
 				throw TsString("Cannot write " + filename);
 			}
 			fs.close();
 		}
+		timer.EndStage("write");
+		timer.EndLoader();
 	}
 
 
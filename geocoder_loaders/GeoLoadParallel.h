@@ -0,0 +1,277 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// GeoLoadParallel.h:  Helpers for loaders that count and encode in parallel.
+//
+// The chunked files written by the loaders can be built in parallel,
+// because every chunk starts with a key record that is written without
+// reference to the previous record.  A loader splits the chunks into
+// shards, counts Huffman frequencies for each shard on its own thread,
+// merges the counts, encodes each shard into a memory bitstream on its own
+// thread, and then stitches the shards into the output file in order.
+// The records of a shard either come from the loader's copy of the whole
+// input, or, where the input is in record order, are read again from the
+// file by the shard's thread starting at the shard's byte offset, so that
+// only the encoded shards are held in memory.
+
+#ifndef INCL_GeoLoadParallel_H
+#define INCL_GeoLoadParallel_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif
+
+#include <vector>
+#include <iostream>
+#include "../geocommon/GeoBitStream.h"
+#include "../geocommon/GeoFreqTable.h"
+#include "../global/TsString.h"
+#include "../global/Utility.h"
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////////
+	// ByteWriter that collects the bytes of a BitStreamWrite in memory.
+	///////////////////////////////////////////////////////////////////////////////
+	class MemoryBitStreamAdaptor : public ByteWriter {
+	public:
+		MemoryBitStreamAdaptor(std::vector<unsigned char>& bytes_) : bytes(bytes_) {}
+		virtual bool Write(int size, const unsigned char* buffer) {
+			bytes.insert(bytes.end(), buffer, buffer + size);
+			return true;
+		};
+	private:
+		std::vector<unsigned char>& bytes;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// A range of whole chunks, and the output of encoding it.
+	///////////////////////////////////////////////////////////////////////////////
+	struct GeoLoadShard {
+		GeoLoadShard() : firstRecord(0), endRecord(0), nbrBits(0) {}
+
+		// Records [firstRecord, endRecord) belong to this shard
+		int firstRecord;
+		int endRecord;
+
+		// Encoded data, padded to a byte boundary
+		std::vector<unsigned char> bytes;
+		// Number of valid bits in "bytes"
+		__int64 nbrBits;
+		// Bit offset of each chunk, relative to the start of the shard
+		std::vector<__int64> chunkOffsets;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Split records into shards of whole chunks.  Enough shards are made to 
+	// keep every processor busy even if they encode at different rates.
+	// Inputs:
+	//	int		nbrRecords		Total number of records
+	//	int		chunkSize		Records per chunk
+	// Outputs:
+	//	std::vector<GeoLoadShard>&	shards	The shards, in record order
+	///////////////////////////////////////////////////////////////////////////////
+	inline void MakeShards(
+		int nbrRecords,
+		int chunkSize,
+		std::vector<GeoLoadShard>& shards
+	) {
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		int nbrChunks = (nbrRecords + chunkSize - 1) / chunkSize;
+		int targetShards = int(systemInfo.dwNumberOfProcessors) * 4;
+		int chunksPerShard = (nbrChunks + targetShards - 1) / targetShards;
+		if (chunksPerShard < 1) {
+			chunksPerShard = 1;
+		}
+		int recordsPerShard = chunksPerShard * chunkSize;
+		shards.clear();
+		for (int first = 0; first < nbrRecords; first += recordsPerShard) {
+			GeoLoadShard shard;
+			shard.firstRecord = first;
+			shard.endRecord = (nbrRecords - first > recordsPerShard) ? first + recordsPerShard : nbrRecords;
+			shards.push_back(shard);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Run task(i) for i in [0, nbrTasks) on one thread per processor.
+	// TASK must provide "void operator()(int index)"; it may throw TsString,
+	// in which case the first such error is re-thrown once all threads finish.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class TASK> class ParallelRunner {
+	public:
+		ParallelRunner(TASK& task_, int nbrTasks_) : 
+			task(task_), nbrTasks(nbrTasks_), nextTask(-1), failed(0)
+		{}
+
+		void Run() {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			int nbrThreads = int(systemInfo.dwNumberOfProcessors);
+			if (nbrThreads > nbrTasks) {
+				nbrThreads = nbrTasks;
+			}
+			if (nbrThreads > MAXIMUM_WAIT_OBJECTS) {
+				nbrThreads = MAXIMUM_WAIT_OBJECTS;
+			}
+			std::vector<HANDLE> threads;
+			for (int i = 0; i < nbrThreads; i++) {
+				HANDLE thread = CreateThread(NULL, 0, ThreadProc, this, 0, NULL);
+				if (thread == NULL) {
+					break;
+				}
+				threads.push_back(thread);
+			}
+			if (threads.empty()) {
+				// Could not start threads; do the work here.
+				ThreadProc(this);
+			} else {
+				WaitForMultipleObjects(DWORD(threads.size()), &threads[0], TRUE, INFINITE);
+				for (unsigned i = 0; i < threads.size(); i++) {
+					CloseHandle(threads[i]);
+				}
+			}
+			if (failed) {
+				throw errorMsg;
+			}
+		}
+
+	private:
+		static DWORD WINAPI ThreadProc(LPVOID param) {
+			ParallelRunner* runner = (ParallelRunner*)param;
+			for (;;) {
+				int index = InterlockedIncrement(&runner->nextTask);
+				if (index >= runner->nbrTasks || runner->failed) {
+					break;
+				}
+				try {
+					runner->task(index);
+				} catch (const TsString& msg) {
+					if (InterlockedExchange(&runner->failed, 1) == 0) {
+						runner->errorMsg = msg;
+					}
+				}
+			}
+			return 0;
+		}
+
+		TASK& task;
+		int nbrTasks;
+		volatile LONG nextTask;
+		volatile LONG failed;
+		TsString errorMsg;
+	};
+
+	template <class TASK> void RunParallel(TASK& task, int nbrTasks) {
+		ParallelRunner<TASK> runner(task, nbrTasks);
+		runner.Run();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Add the counts of one frequency table to another.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> void MergeFreqTable(FreqTable<T>& dest, const FreqTable<T>& src) 
+	{
+		for (typename FreqTable<T>::const_iterator iter = src.begin(); iter != src.end(); ++iter) {
+			dest.Count(iter->first, iter->second);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Append the encoded shards to the data bitstream, and write the absolute 
+	// bit offset of every chunk to the position-index bitstream.
+	// Inputs:
+	//	const std::vector<GeoLoadShard>&	shards			The encoded shards
+	//	int									indexBitSize	Bits per position-index entry
+	//	const char*							name			Table name, for errors
+	// Outputs:
+	//	BitStreamWrite&		dataBitStream			The data file
+	//	BitStreamWrite&		positionIndexBitStream	The position-index file
+	///////////////////////////////////////////////////////////////////////////////
+	inline void StitchShards(
+		const std::vector<GeoLoadShard>& shards,
+		int indexBitSize,
+		const char* name,
+		BitStreamWrite& dataBitStream,
+		BitStreamWrite& positionIndexBitStream
+	) {
+		if (indexBitSize > 32) {
+			throw TsString(name) + " position index uses " + FormatInteger(indexBitSize) + " bits; must recode to use __int64 variables";
+		}
+		for (unsigned shardIdx = 0; shardIdx < shards.size(); shardIdx++) {
+			const GeoLoadShard& shard = shards[shardIdx];
+			__int64 base = dataBitStream.GetNumberOfBitsWritten();
+			for (unsigned i = 0; i < shard.chunkOffsets.size(); i++) {
+				__int64 bitsWritten = base + shard.chunkOffsets[i];
+				if (bitsWritten >= ((__int64)1 << indexBitSize)) {
+					throw TsString(name) + " position index uses " + FormatInteger(indexBitSize) + " bits but must be larger";
+				}
+				positionIndexBitStream.WriteBitsFromInt(indexBitSize, (int)bitsWritten);
+			}
+			// Append in pieces, since WriteBits() takes an int count.
+			const int pieceBytes = 0x100000;
+			__int64 remaining = shard.nbrBits;
+			const unsigned char* ptr = shard.bytes.empty() ? 0 : &shard.bytes[0];
+			while (remaining > 0) {
+				int bits = (remaining > pieceBytes * 8) ? pieceBytes * 8 : int(remaining);
+				dataBitStream.WriteBits(bits, ptr);
+				ptr += pieceBytes;
+				remaining -= bits;
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Print the time taken by each stage of a loader.
+	///////////////////////////////////////////////////////////////////////////////
+	class GeoLoadStageTimer {
+	public:
+		GeoLoadStageTimer(const char* loaderName_) : 
+			loaderName(loaderName_), 
+			startTicks(GetTickCount()), 
+			stageTicks(startTicks)
+		{}
+
+		// Report the stage that just finished.
+		void EndStage(const char* stageName) {
+			DWORD now = GetTickCount();
+			std::cout << loaderName << ": " << stageName << " " 
+				<< FormatFloat((now - stageTicks) / 1000.0) << " sec\n";
+			stageTicks = now;
+		}
+
+		// Report the total.
+		void EndLoader() {
+			DWORD now = GetTickCount();
+			std::cout << loaderName << ": total " 
+				<< FormatFloat((now - startTicks) / 1000.0) << " sec\n";
+		}
+
+	private:
+		TsString loaderName;
+		DWORD startTicks;
+		DWORD stageTicks;
+	};
+}
+
+#endif
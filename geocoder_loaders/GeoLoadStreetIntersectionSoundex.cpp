@@ -32,46 +32,172 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include "BitStreamAdaptor.h"
+#include "GeoLoadParallel.h"
 
 namespace PortfolioExplorer {
 
 
+	// One intersection record, with the soundex codes packed
+	struct StreetIntersectionRecord {
+		int state;
+		int soundex1;
+		int streetNameID1;
+		unsigned int streetSegmentOffset1;
+		int soundex2;
+		int streetNameID2;
+		unsigned int streetSegmentOffset2;
+	};
+
+	// Frequency tables for one shard
+	struct StreetIntersectionFreqTables {
+		FreqTable<int> state;
+		FreqTable<int> soundex1;
+		FreqTable<int> streetNameID1;
+		FreqTable<int> streetSegmentOffset1;
+		FreqTable<int> soundex2;
+		FreqTable<int> streetNameID2;
+		FreqTable<int> streetSegmentOffset2;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Count the frequencies of one shard.
+	///////////////////////////////////////////////////////////////////////////////
+	class StreetIntersectionCountTask {
+	public:
+		StreetIntersectionCountTask(
+			const std::vector<StreetIntersectionRecord>& records_,
+			const std::vector<GeoLoadShard>& shards_,
+			std::vector<StreetIntersectionFreqTables>& freqTables_
+		) : records(records_), shards(shards_), freqTables(freqTables_) {}
+
+		void operator()(int shardIdx) {
+			const GeoLoadShard& shard = shards[shardIdx];
+			StreetIntersectionFreqTables& tables = freqTables[shardIdx];
+			unsigned char tmpBuf[10];
+			int varIntLength;
+			for (int recordIdx = shard.firstRecord; recordIdx < shard.endRecord; recordIdx++) {
+				const StreetIntersectionRecord& record = records[recordIdx];
+
+				// The segment offsets are not delta-coded, so they are counted
+				// for the key record as well.
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.streetSegmentOffset1, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.streetSegmentOffset1, tmpBuf, varIntLength);
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.streetSegmentOffset2, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.streetSegmentOffset2, tmpBuf, varIntLength);
+
+				if (recordIdx % GeoUtil::StreetIntersectionSoundexChunkSize == 0) {
+					// Key-record 
+					continue;
+				}
+				const StreetIntersectionRecord& prev = records[recordIdx - 1];
+
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.state - prev.state, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.state, tmpBuf, varIntLength);
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.soundex1 - prev.soundex1, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.soundex1, tmpBuf, varIntLength);
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.streetNameID1 - prev.streetNameID1, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.streetNameID1, tmpBuf, varIntLength);
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.soundex2 - prev.soundex2, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.soundex2, tmpBuf, varIntLength);
+				varIntLength = GeoUtil::IntToVarLengthBuf(record.streetNameID2 - prev.streetNameID2, tmpBuf);
+				GeoUtil::AddArrayToFreqTable(tables.streetNameID2, tmpBuf, varIntLength);
+			}
+		}
+
+	private:
+		const std::vector<StreetIntersectionRecord>& records;
+		const std::vector<GeoLoadShard>& shards;
+		std::vector<StreetIntersectionFreqTables>& freqTables;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Encode one shard into memory.  The coders are only read, so they
+	// may be shared by all threads.
+	///////////////////////////////////////////////////////////////////////////////
+	class StreetIntersectionEncodeTask {
+	public:
+		typedef HuffmanCoder<int, std::less<int> > Coder;
+
+		StreetIntersectionEncodeTask(
+			const std::vector<StreetIntersectionRecord>& records_,
+			std::vector<GeoLoadShard>& shards_,
+			Coder& stateCoder_,
+			Coder& soundex1Coder_,
+			Coder& streetNameID1Coder_,
+			Coder& streetSegmentOffset1Coder_,
+			Coder& soundex2Coder_,
+			Coder& streetNameID2Coder_,
+			Coder& streetSegmentOffset2Coder_
+		) : 
+			records(records_), shards(shards_),
+			stateCoder(stateCoder_),
+			soundex1Coder(soundex1Coder_),
+			streetNameID1Coder(streetNameID1Coder_),
+			streetSegmentOffset1Coder(streetSegmentOffset1Coder_),
+			soundex2Coder(soundex2Coder_),
+			streetNameID2Coder(streetNameID2Coder_),
+			streetSegmentOffset2Coder(streetSegmentOffset2Coder_)
+		{}
+
+		void operator()(int shardIdx) {
+			GeoLoadShard& shard = shards[shardIdx];
+			BitStreamWrite dataBitStream(new MemoryBitStreamAdaptor(shard.bytes));
+
+			for (int recordIdx = shard.firstRecord; recordIdx < shard.endRecord; recordIdx++) {
+				const StreetIntersectionRecord& record = records[recordIdx];
+				if (recordIdx % GeoUtil::StreetIntersectionSoundexChunkSize == 0) {
+					shard.chunkOffsets.push_back(dataBitStream.GetNumberOfBitsWritten());
+					dataBitStream.WriteBitsFromInt(GeoUtil::StreetIntersectionStateBitSize, record.state);
+					dataBitStream.WriteBitsFromInt(GeoUtil::StreetIntersectionSoundexBitSize, record.soundex1);
+					dataBitStream.WriteBitsFromInt(GeoUtil::StreetIntersectionStreetNameIDBitSize, record.streetNameID1);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetSegmentOffset1, streetSegmentOffset1Coder, dataBitStream);
+					dataBitStream.WriteBitsFromInt(GeoUtil::StreetIntersectionSoundexBitSize, record.soundex2);
+					dataBitStream.WriteBitsFromInt(GeoUtil::StreetIntersectionStreetNameIDBitSize, record.streetNameID2);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetSegmentOffset2, streetSegmentOffset2Coder, dataBitStream);
+				} else {
+					const StreetIntersectionRecord& prev = records[recordIdx - 1];
+					GeoUtil::CodeVarLengthIntToBitStream(record.state - prev.state, stateCoder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.soundex1 - prev.soundex1, soundex1Coder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetNameID1 - prev.streetNameID1, streetNameID1Coder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetSegmentOffset1, streetSegmentOffset1Coder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.soundex2 - prev.soundex2, soundex2Coder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetNameID2 - prev.streetNameID2, streetNameID2Coder, dataBitStream);
+					GeoUtil::CodeVarLengthIntToBitStream(record.streetSegmentOffset2, streetSegmentOffset2Coder, dataBitStream);
+				}
+			}
+			shard.nbrBits = dataBitStream.GetNumberOfBitsWritten();
+			dataBitStream.Flush();
+		}
+
+	private:
+		const std::vector<StreetIntersectionRecord>& records;
+		std::vector<GeoLoadShard>& shards;
+		Coder& stateCoder;
+		Coder& soundex1Coder;
+		Coder& streetNameID1Coder;
+		Coder& streetSegmentOffset1Coder;
+		Coder& soundex2Coder;
+		Coder& streetNameID2Coder;
+		Coder& streetSegmentOffset2Coder;
+	};
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Process the records for a terminal node.
+	// The input is read once; counting and encoding run in parallel over
+	// shards of whole chunks.
 	// Return value:
 	//	bool		true on success, false on error or abort
 	///////////////////////////////////////////////////////////////////////////////
 	void GeoLoadStreetIntersectionSoundex::Process()
 	{
+		GeoLoadStageTimer timer("StreetIntersectionSoundex");
 		numberOfOutputRecords = 0;
 
-
-		// Get the first record from upstream first, to allow complex processing 
-		// to complete before opening the output file.
 		bool inputOK = m_readCSV.ReadRecord();
 
 		if (!inputOK)
 			throw TsString("No records to read");
 
-		// Frequency-counting tables.
-		FreqTable<int> stateFreqTable;
-		FreqTable<int> soundex1FreqTable;
-		FreqTable<int> streetNameID1FreqTable;
-		FreqTable<int> streetSegmentOffset1FreqTable;
-		FreqTable<int> soundex2FreqTable;
-		FreqTable<int> streetNameID2FreqTable;
-		FreqTable<int> streetSegmentOffset2FreqTable;
-
-		// Some variables used in processing
-		int tmpInt;
-		unsigned int tmpUInt;
-
-		int prevState;
-		int prevSoundex1;
-		int prevStreetNameID1;
-		int prevSoundex2;
-		int prevStreetNameID2;
-
 		// Get local variable equivalents of bound fields.
 		FieldAccessor stateValue = m_mapFieldAccessors["STATE"];
 		FieldAccessor soundex1Value = m_mapFieldAccessors["SOUNDEX1"];
@@ -81,112 +207,47 @@ namespace PortfolioExplorer {
 		FieldAccessor streetNameID2Value = m_mapFieldAccessors["STREET_NAME_ID2"];
 		FieldAccessor streetSegmentOffset2Value = m_mapFieldAccessors["STREET_SEGMENT_OFFSET2"];
 
-		// Read all records and analyze frequency counts for Huffman coding.
-		// Buffer the records to a temp file so we can read them back later.
+		// Read all records.
+		std::vector<StreetIntersectionRecord> records;
+		do {
+			StreetIntersectionRecord record;
+			record.state = stateValue.GetAsInt();
+			record.soundex1 = PackSoundex(soundex1Value.GetAsString().c_str());
+			record.streetNameID1 = streetNameID1Value.GetAsInt();
+			record.streetSegmentOffset1 = streetSegmentOffset1Value.GetAsInt();
+			record.soundex2 = PackSoundex(soundex2Value.GetAsString().c_str());
+			record.streetNameID2 = streetNameID2Value.GetAsInt();
+			record.streetSegmentOffset2 = streetSegmentOffset2Value.GetAsInt();
+			records.push_back(record);
+		} while (m_readCSV.ReadRecord());
+		timer.EndStage("read");
+
+		std::vector<GeoLoadShard> shards;
+		MakeShards(int(records.size()), StreetIntersectionSoundexChunkSize, shards);
+
+		// Analyze frequency counts for Huffman coding, then merge the shards.
+		FreqTable<int> stateFreqTable;
+		FreqTable<int> soundex1FreqTable;
+		FreqTable<int> streetNameID1FreqTable;
+		FreqTable<int> streetSegmentOffset1FreqTable;
+		FreqTable<int> soundex2FreqTable;
+		FreqTable<int> streetNameID2FreqTable;
+		FreqTable<int> streetSegmentOffset2FreqTable;
 		{
-			int chunkCount = 0;
-
-
-
-			do {
-				unsigned char tmpBuf[10];
-				int varIntLength;
-			
-				// State
-				tmpInt = stateValue.GetAsInt();
-				if (chunkCount == 0) {
-					// no freq count
-				} else {
-					int diff = tmpInt - prevState;
-					varIntLength = IntToVarLengthBuf(diff, tmpBuf);
-					AddArrayToFreqTable(stateFreqTable, tmpBuf, varIntLength);
-				}
-
-				// Soundex1
-				tmpInt = PackSoundex(soundex1Value.GetAsString().c_str());
-				if (chunkCount == 0) {
-					// no freq count
-				} else {
-					int diff = tmpInt - prevSoundex1;
-					varIntLength = IntToVarLengthBuf(diff, tmpBuf);
-					AddArrayToFreqTable(soundex1FreqTable, tmpBuf, varIntLength);
-				}
-
-				// StreetNameID1
-				tmpInt = streetNameID1Value.GetAsInt();
-				if (chunkCount == 0) {
-					// no freq count
-				} else {
-					int diff = tmpInt - prevStreetNameID1;
-					varIntLength = IntToVarLengthBuf(diff, tmpBuf);
-					AddArrayToFreqTable(streetNameID1FreqTable, tmpBuf, varIntLength);
-				}
-
-				// StreetSegmentOffset1
-				tmpUInt = streetSegmentOffset1Value.GetAsInt();
-				varIntLength = IntToVarLengthBuf(tmpUInt, tmpBuf);
-				AddArrayToFreqTable(streetSegmentOffset1FreqTable, tmpBuf, varIntLength);
-
-				// Soundex2
-				tmpInt = PackSoundex(soundex2Value.GetAsString().c_str());
-				if (chunkCount == 0) {
-					// no freq count
-				} else {
-					int diff = tmpInt - prevSoundex2;
-					varIntLength = IntToVarLengthBuf(diff, tmpBuf);
-					AddArrayToFreqTable(soundex2FreqTable, tmpBuf, varIntLength);
-				}
-
-				// StreetNameID2
-				tmpInt = streetNameID2Value.GetAsInt();
-				if (chunkCount == 0) {
-					// no freq count
-				} else {
-					int diff = tmpInt - prevStreetNameID2;
-					varIntLength = IntToVarLengthBuf(diff, tmpBuf);
-					AddArrayToFreqTable(streetNameID2FreqTable, tmpBuf, varIntLength);
-				}
-
-				// StreetSegmentOffset2
-				tmpUInt = streetSegmentOffset2Value.GetAsInt();
-				varIntLength = IntToVarLengthBuf(tmpUInt, tmpBuf);
-				AddArrayToFreqTable(streetSegmentOffset2FreqTable, tmpBuf, varIntLength);
-
-				// Save previous values
-				prevState = stateValue.GetAsInt();
-				prevSoundex1 = PackSoundex(soundex1Value.GetAsString().c_str());
-				prevStreetNameID1 = streetNameID1Value.GetAsInt();
-				prevSoundex2 = PackSoundex(soundex2Value.GetAsString().c_str());
-				prevStreetNameID2 = streetNameID2Value.GetAsInt();
-
-				chunkCount++;
-				if (chunkCount == StreetIntersectionSoundexChunkSize) {
-					chunkCount = 0;
-				}
-			} while (m_readCSV.ReadRecord());
-		}
-
-		// Open files
-		File dataFile;
-		TsString filename = outdir + "/" + STREET_INTERSECTION_SOUNDEX_FILE;
-		if (!dataFile.Open(File::CreateAndWrite, filename, FileBufferSize)) {
-			throw TsString(
-				"Cannot open file " + filename + " for output"
-			);
-		}
-		File positionIndexFile;
-		filename = outdir + "/" + STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE;
-		if (!positionIndexFile.Open(File::CreateAndWrite, filename, FileBufferSize)) {
-			throw TsString(
-				"Cannot open file " + filename + " for output"
-			);
+			std::vector<StreetIntersectionFreqTables> shardFreqTables(shards.size());
+			StreetIntersectionCountTask countTask(records, shards, shardFreqTables);
+			RunParallel(countTask, int(shards.size()));
+			for (unsigned i = 0; i < shardFreqTables.size(); i++) {
+				MergeFreqTable(stateFreqTable, shardFreqTables[i].state);
+				MergeFreqTable(soundex1FreqTable, shardFreqTables[i].soundex1);
+				MergeFreqTable(streetNameID1FreqTable, shardFreqTables[i].streetNameID1);
+				MergeFreqTable(streetSegmentOffset1FreqTable, shardFreqTables[i].streetSegmentOffset1);
+				MergeFreqTable(soundex2FreqTable, shardFreqTables[i].soundex2);
+				MergeFreqTable(streetNameID2FreqTable, shardFreqTables[i].streetNameID2);
+				MergeFreqTable(streetSegmentOffset2FreqTable, shardFreqTables[i].streetSegmentOffset2);
+			}
 		}
-
-		// Create an output BitStream for the data file
-		BitStreamWrite dataBitStream(new FileBitStreamAdaptor(dataFile));
-
-		// Create an output BitStream for the position-index file
-		BitStreamWrite positionIndexBitStream(new FileBitStreamAdaptor(positionIndexFile));
+		timer.EndStage("count frequencies");
 
 		// Set up Huffman coding.
 		HuffmanCoder<int, std::less<int> > stateCoder;
@@ -207,129 +268,51 @@ namespace PortfolioExplorer {
 		streetSegmentOffset2Coder.AddEntries(streetSegmentOffset2FreqTable);
 
 		// Generate Huffman codes
-		stateCoder.MakeCodes();
-		soundex1Coder.MakeCodes();
-		streetNameID1Coder.MakeCodes();
-		streetSegmentOffset1Coder.MakeCodes();
-		soundex2Coder.MakeCodes();
-		streetNameID2Coder.MakeCodes();
-		streetSegmentOffset2Coder.MakeCodes();
-
-		int chunkCount = 0;
-
-		m_readCSV.ReOpen();
-		m_readCSV.ReadRecord();
-
-
-		while (m_readCSV.ReadRecord()) 
+		stateCoder.MakeCanonicalCodes();
+		soundex1Coder.MakeCanonicalCodes();
+		streetNameID1Coder.MakeCanonicalCodes();
+		streetSegmentOffset1Coder.MakeCanonicalCodes();
+		soundex2Coder.MakeCanonicalCodes();
+		streetNameID2Coder.MakeCanonicalCodes();
+		streetSegmentOffset2Coder.MakeCanonicalCodes();
+		timer.EndStage("make codes");
+
+		// Encode the shards
 		{
-			// Write position-index records.
-			// Must be written before the data file, to get the correct bit offset.
-			if (chunkCount == 0) {
-				__int64 bitsWritten = dataBitStream.GetNumberOfBitsWritten();
-
-				if (bitsWritten >= ((__int64)1 << StreetIntersectionPositionIndexBitSize)) {
-					throw TsString("StreetIntersectionSoundex position index uses " + FormatInteger(StreetIntersectionPositionIndexBitSize) + " bits but must be larger");
-				}
-
-				if (StreetIntersectionPositionIndexBitSize > 32) {
-					throw TsString("StreetIntersectionSoundex position index uses " + FormatInteger(StreetIntersectionPositionIndexBitSize) + " bits; must recode to use __int64 variables");
-				}
-
-				positionIndexBitStream.WriteBitsFromInt(StreetIntersectionPositionIndexBitSize, (int)bitsWritten);
-			}
-
-			// Write the fields of the data record.
-
-			// state
-			tmpInt = stateValue.GetAsInt();
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(StreetIntersectionStateBitSize, tmpInt);
-			} else {
-				CodeVarLengthIntToBitStream(
-					tmpInt - prevState,
-					stateCoder,
-					dataBitStream
-				);
-			}
-
-			// Soundex1
-			tmpInt = PackSoundex(soundex1Value.GetAsString().c_str());
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(StreetIntersectionSoundexBitSize, tmpInt);
-			} else {
-				CodeVarLengthIntToBitStream(
-					tmpInt - prevSoundex1,
-					soundex1Coder,
-					dataBitStream
-				);
-			}
-
-			// StreetNameID1
-			tmpInt = streetNameID1Value.GetAsInt();
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(StreetIntersectionStreetNameIDBitSize, tmpInt);
-			} else {
-				CodeVarLengthIntToBitStream(
-					tmpInt - prevStreetNameID1,
-					streetNameID1Coder,
-					dataBitStream
-				);
-			}
-
-			// StreetSegmentOffset1
-			tmpUInt = streetSegmentOffset1Value.GetAsInt();
-			CodeVarLengthIntToBitStream(
-				tmpUInt,
-				streetSegmentOffset1Coder,
-				dataBitStream
+			StreetIntersectionEncodeTask encodeTask(
+				records, shards,
+				stateCoder, soundex1Coder, streetNameID1Coder, streetSegmentOffset1Coder,
+				soundex2Coder, streetNameID2Coder, streetSegmentOffset2Coder
 			);
+			RunParallel(encodeTask, int(shards.size()));
+		}
+		timer.EndStage("encode");
 
-			// Soundex2
-			tmpInt = PackSoundex(soundex2Value.GetAsString().c_str());
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(StreetIntersectionSoundexBitSize, tmpInt);
-			} else {
-				CodeVarLengthIntToBitStream(
-					tmpInt - prevSoundex2,
-					soundex2Coder,
-					dataBitStream
-				);
-			}
+		// Open files
+		File dataFile;
+		TsString filename = outdir + "/" + STREET_INTERSECTION_SOUNDEX_FILE;
+		if (!dataFile.Open(File::CreateAndWrite, filename, FileBufferSize)) {
+			throw TsString(
+				"Cannot open file " + filename + " for output"
+			);
+		}
+		File positionIndexFile;
+		filename = outdir + "/" + STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE;
+		if (!positionIndexFile.Open(File::CreateAndWrite, filename, FileBufferSize)) {
+			throw TsString(
+				"Cannot open file " + filename + " for output"
+			);
+		}
 
-			// StreetNameID2
-			tmpInt = streetNameID2Value.GetAsInt();
-			if (chunkCount == 0) {
-				dataBitStream.WriteBitsFromInt(StreetIntersectionStreetNameIDBitSize, tmpInt);
-			} else {
-				CodeVarLengthIntToBitStream(
-					tmpInt - prevStreetNameID2,
-					streetNameID2Coder,
-					dataBitStream
-				);
-			}
+		// Create an output BitStream for the data file
+		BitStreamWrite dataBitStream(new FileBitStreamAdaptor(dataFile));
 
-			// StreetSegmentOffset2
-			tmpUInt = streetSegmentOffset2Value.GetAsInt();
-			CodeVarLengthIntToBitStream(
-				tmpUInt,
-				streetSegmentOffset2Coder,
-				dataBitStream
-			);
+		// Create an output BitStream for the position-index file
+		BitStreamWrite positionIndexBitStream(new FileBitStreamAdaptor(positionIndexFile));
 
-			// Save previous values
-			prevState = stateValue.GetAsInt();
-			prevSoundex1 = PackSoundex(soundex1Value.GetAsString().c_str());
-			prevStreetNameID1 = streetNameID1Value.GetAsInt();
-			prevSoundex2 = PackSoundex(soundex2Value.GetAsString().c_str());
-			prevStreetNameID2 = streetNameID2Value.GetAsInt();
-
-			chunkCount++;
-			numberOfOutputRecords++;
-			if (chunkCount == StreetIntersectionSoundexChunkSize) {
-				chunkCount = 0;
-			}
-		}
+		// Stitch the shards together, writing position-index records as we go.
+		StitchShards(shards, StreetIntersectionPositionIndexBitSize, "StreetIntersectionSoundex", dataBitStream, positionIndexBitStream);
+		numberOfOutputRecords = int(records.size());
 
 		// Flush bitstream to byte-align it.
 		positionIndexBitStream.Flush();
@@ -341,38 +324,40 @@ namespace PortfolioExplorer {
 		dataBitStream.Flush();
 		dataFile.Close();
 
-		// Write out the huffman code tables.
-		struct FreqTableFiledef {
-			FreqTableFiledef(
-				FreqTable<int>& table_,
+		// Write out the huffman code-length tables.
+		struct CoderFiledef {
+			CoderFiledef(
+				HuffmanCoder<int, std::less<int> >& coder_,
 				const char* filename_
-			) : table(table_), filename(filename_)
+			) : coder(coder_), filename(GeoUtil::CodeLengthFilename(filename_))
 			{}
-			FreqTable<int>& table;
+			HuffmanCoder<int, std::less<int> >& coder;
 			TsString filename;
-		} freqTableFiledefs[] = {
-			FreqTableFiledef(stateFreqTable, STREET_INTERSECTION_STATE_HUFF_FILE),
-			FreqTableFiledef(soundex1FreqTable, STREET_INTERSECTION_SOUNDEX1_HUFF_FILE),
-			FreqTableFiledef(streetNameID1FreqTable,STREET_INTERSECTION_STREET_NAME_ID1_HUFF_FILE),
-			FreqTableFiledef(streetSegmentOffset1FreqTable, STREET_INTERSECTION_STREET_SEGMENT_OFFSET1_HUFF_FILE),
-			FreqTableFiledef(soundex2FreqTable, STREET_INTERSECTION_SOUNDEX2_HUFF_FILE),
-			FreqTableFiledef(streetNameID2FreqTable, STREET_INTERSECTION_STREET_NAME_ID2_HUFF_FILE),
-			FreqTableFiledef(streetSegmentOffset2FreqTable, STREET_INTERSECTION_STREET_SEGMENT_OFFSET2_HUFF_FILE)
+		} coderFiledefs[] = {
+			CoderFiledef(stateCoder, STREET_INTERSECTION_STATE_HUFF_FILE),
+			CoderFiledef(soundex1Coder, STREET_INTERSECTION_SOUNDEX1_HUFF_FILE),
+			CoderFiledef(streetNameID1Coder, STREET_INTERSECTION_STREET_NAME_ID1_HUFF_FILE),
+			CoderFiledef(streetSegmentOffset1Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET1_HUFF_FILE),
+			CoderFiledef(soundex2Coder, STREET_INTERSECTION_SOUNDEX2_HUFF_FILE),
+			CoderFiledef(streetNameID2Coder, STREET_INTERSECTION_STREET_NAME_ID2_HUFF_FILE),
+			CoderFiledef(streetSegmentOffset2Coder, STREET_INTERSECTION_STREET_SEGMENT_OFFSET2_HUFF_FILE)
 		};
 
 		for (
-			int freqTableIdx = 0; 
-			freqTableIdx < sizeof(freqTableFiledefs)/sizeof(freqTableFiledefs[0]); 
-			freqTableIdx++
+			int coderIdx = 0; 
+			coderIdx < sizeof(coderFiledefs)/sizeof(coderFiledefs[0]); 
+			coderIdx++
 		) {
 			std::fstream fs;
-			TsString filename = outdir + "/" + freqTableFiledefs[freqTableIdx].filename;
-			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-			if (fs.fail() || !freqTableFiledefs[freqTableIdx].table.Save(fs)) {
+			TsString filename = outdir + "/" + coderFiledefs[coderIdx].filename;
+			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+			if (fs.fail() || !GeoUtil::SaveCodeLengths(coderFiledefs[coderIdx].coder, fs)) {
 				throw TsString("Cannot write " + filename);
 			}
 			fs.close();
 		}
+		timer.EndStage("write");
+		timer.EndLoader();
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
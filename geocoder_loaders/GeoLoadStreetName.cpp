@@ -77,6 +77,11 @@ namespace PortfolioExplorer {
 		if (!inputOK)
 			throw TsString("No records to read");
 
+		if (packedOutput) {
+			ProcessPacked();
+			return;
+		}
+
 		// Frequency-counting tables.
 		FreqTable<int> cityStatePostcodeIDFreqTable;
 		FreqTable<TsString> prefixFreqTable;
@@ -207,14 +212,14 @@ namespace PortfolioExplorer {
 		streetRangeCountCoder.AddEntries(streetRangeCountFreqTable);
 
 		// Generate Huffman codes
-		cityStatePostcodeIDCoder.MakeCodes();
-		prefixCoder.MakeCodes();
-		predirCoder.MakeCodes();
-		streetNameCoder.MakeCodes();
-		suffixCoder.MakeCodes();
-		postdirCoder.MakeCodes();
-		streetRangeIDFirstCoder.MakeCodes();
-		streetRangeCountCoder.MakeCodes();
+		cityStatePostcodeIDCoder.MakeCanonicalCodes();
+		prefixCoder.MakeCanonicalCodes();
+		predirCoder.MakeCanonicalCodes();
+		streetNameCoder.MakeCanonicalCodes();
+		suffixCoder.MakeCanonicalCodes();
+		postdirCoder.MakeCanonicalCodes();
+		streetRangeIDFirstCoder.MakeCanonicalCodes();
+		streetRangeCountCoder.MakeCanonicalCodes();
 
 		int chunkCount = 0;
 
@@ -365,75 +370,150 @@ namespace PortfolioExplorer {
 		dataBitStream.Flush();
 		dataFile.Close();
 
-		// Write out the huffman code tables.
+		// Write out the huffman code-length tables.
 		std::fstream fs;
 
 		// ID
-		filename = outdir + "/" + STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !cityStatePostcodeIDFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(cityStatePostcodeIDCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// Prefix
-		filename = outdir + "/" + STREET_NAME_PREFIX_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !prefixFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_PREFIX_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(prefixCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// Predir
-		filename = outdir + "/" + STREET_NAME_PREDIR_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !predirFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_PREDIR_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(predirCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// Name
-		filename = outdir + "/" + STREET_NAME_NAME_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !streetNameFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_NAME_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(streetNameCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// Suffix
-		filename = outdir + "/" + STREET_NAME_SUFFIX_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !suffixFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_SUFFIX_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(suffixCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// Postdir
-		filename = outdir + "/" + STREET_NAME_POSTDIR_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !postdirFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_POSTDIR_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(postdirCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// StreetRangeIDFirst
-		filename = outdir + "/" + STREET_NAME_STREET_SEGMENT_ID_FIRST_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !streetRangeIDFirstFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_STREET_SEGMENT_ID_FIRST_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(streetRangeIDFirstCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 		// StreetRangeCount
-		filename = outdir + "/" + STREET_NAME_STREET_SEGMENT_COUNT_HUFF_FILE;
-		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-		if (fs.fail() || !streetRangeCountFreqTable.Save(fs)) {
+		filename = outdir + "/" + GeoUtil::CodeLengthFilename(STREET_NAME_STREET_SEGMENT_COUNT_HUFF_FILE);
+		fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (fs.fail() || !GeoUtil::SaveCodeLengths(streetRangeCountCoder, fs)) {
 			throw TsString("Cannot write " + filename);
 		}
 		fs.close();
 
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Write the records as a packed table, a block at a time.
+	// Columns: cityStatePostcodeID (delta), prefix, predir, name, suffix,
+	// postdir (fixed width), streetSegmentIDFirst (delta), 
+	// streetSegmentCount.  QueryImp reads them in the same order.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadStreetName::ProcessPacked()
+	{
+		FieldAccessor cityStatePostcodeIDValue = m_mapFieldAccessors["CITY_STATE_POSTCODE_ID"];
+		FieldAccessor streetNameIDValue = m_mapFieldAccessors["STREET_NAME_ID"];
+		FieldAccessor prefixValue = m_mapFieldAccessors["PREFIX"];
+		FieldAccessor predirValue = m_mapFieldAccessors["PREDIR"];
+		FieldAccessor nameValue = m_mapFieldAccessors["NAME"];
+		FieldAccessor suffixValue = m_mapFieldAccessors["SUFFIX"];
+		FieldAccessor postdirValue = m_mapFieldAccessors["POSTDIR"];
+		FieldAccessor streetRangeIDFirstValue = m_mapFieldAccessors["STREET_SEGMENT_ID_FIRST"];
+		FieldAccessor streetRangeCountValue = m_mapFieldAccessors["STREET_SEGMENT_COUNT"];
+
+		PackedTableWriter writer;
+		OpenPackedTable(writer, STREET_NAME_PACKED_FILE);
+
+		// Columns of the current block.
+		PackedBlockWriter block;
+		std::vector<int> cityStatePostcodeIDs;
+		std::vector<char> prefixes;
+		std::vector<char> predirs;
+		std::vector<char> names;
+		std::vector<char> suffixes;
+		std::vector<char> postdirs;
+		std::vector<int> streetRangeIDFirsts;
+		std::vector<int> streetRangeCounts;
+
+		bool moreInput = true;
+		while (moreInput) {
+			if (streetNameIDValue.GetAsInt() != numberOfOutputRecords) {
+				throw TsString("Street Name ID is out of sequence");
+			}
+			cityStatePostcodeIDs.push_back(cityStatePostcodeIDValue.GetAsInt());
+			AppendCharField(prefixes, prefixValue.GetAsString(), PackedStreetNamePrefixWidth);
+			AppendCharField(predirs, predirValue.GetAsString(), PackedStreetNamePredirWidth);
+			AppendCharField(names, nameValue.GetAsString(), PackedStreetNameNameWidth);
+			AppendCharField(suffixes, suffixValue.GetAsString(), PackedStreetNameSuffixWidth);
+			AppendCharField(postdirs, postdirValue.GetAsString(), PackedStreetNamePostdirWidth);
+			streetRangeIDFirsts.push_back(streetRangeIDFirstValue.GetAsInt());
+			streetRangeCounts.push_back(streetRangeCountValue.GetAsInt());
+			numberOfOutputRecords++;
+
+			moreInput = m_readCSV.ReadRecord();
+			int count = int(cityStatePostcodeIDs.size());
+			if (count == PackedBlockSize || (!moreInput && count > 0)) {
+				block.Clear();
+				block.AddDeltaColumn(&cityStatePostcodeIDs[0], count);
+				block.AddCharColumn(&prefixes[0], PackedStreetNamePrefixWidth, count);
+				block.AddCharColumn(&predirs[0], PackedStreetNamePredirWidth, count);
+				block.AddCharColumn(&names[0], PackedStreetNameNameWidth, count);
+				block.AddCharColumn(&suffixes[0], PackedStreetNameSuffixWidth, count);
+				block.AddCharColumn(&postdirs[0], PackedStreetNamePostdirWidth, count);
+				block.AddDeltaColumn(&streetRangeIDFirsts[0], count);
+				block.AddIntColumn(&streetRangeCounts[0], count);
+				WritePackedBlock(writer, block, count);
+
+				cityStatePostcodeIDs.clear();
+				prefixes.clear();
+				predirs.clear();
+				names.clear();
+				suffixes.clear();
+				postdirs.clear();
+				streetRangeIDFirsts.clear();
+				streetRangeCounts.clear();
+			}
+		}
+		ClosePackedTable(writer, STREET_NAME_PACKED_FILE);
+	}
+
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Get a static array of FieldParameter entries, which will be used to
 	// load up the fieldParameters vector.  The terminating element must
@@ -47,6 +47,12 @@ namespace PortfolioExplorer {
 		virtual void Process();
 
 	private:
+		///////////////////////////////////////////////////////////////////////////////
+		// Write the records as a packed table, starting from the current
+		// input record.
+		///////////////////////////////////////////////////////////////////////////////
+		void ProcessPacked();
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Get a static array of FieldParameter entries, which will be used to
 		// load up the fieldParameters vector.  The terminating element must
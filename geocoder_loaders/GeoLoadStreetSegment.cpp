@@ -104,6 +104,11 @@ namespace PortfolioExplorer {
 		if (!inputOK)
 			throw TsString("No records to read");
 
+		if (packedOutput) {
+			ProcessPacked();
+			return;
+		}
+
 
 		// Frequency-counting tables.
 		FreqTable<int> addrLowKeyFreqTable1;
@@ -357,27 +362,27 @@ namespace PortfolioExplorer {
 		coordinateCountCoder.AddEntries(coordinateCountFreqTable);
 
 		// Generate Huffman codes
-		addrLowKeyCoder1.MakeCodes();
-		addrLowKeyCoder2.MakeCodes();
-		addrLowNonkeyCoder1.MakeCodes();
-		addrLowNonkeyCoder2.MakeCodes();
-		addrHighCoder1.MakeCodes();
-		addrHighCoder2.MakeCodes();
-		countyKeyCoder.MakeCodes();
-		countyNonkeyCoder.MakeCodes();
-		censusTractKeyCoder1.MakeCodes();
-		censusTractKeyCoder2.MakeCodes();
-		censusTractNonkeyCoder1.MakeCodes();
-		censusTractNonkeyCoder2.MakeCodes();
-		censusBlockKeyCoder1.MakeCodes();
-		censusBlockKeyCoder2.MakeCodes();
-		censusBlockNonkeyCoder1.MakeCodes();
-		censusBlockNonkeyCoder2.MakeCodes();
-		postcodeExtKeyCoder.MakeCodes();
-		postcodeExtNonkeyCoder.MakeCodes();
-		coordinateIDCoder1.MakeCodes();
-		coordinateIDCoder2.MakeCodes();
-		coordinateCountCoder.MakeCodes();
+		addrLowKeyCoder1.MakeCanonicalCodes();
+		addrLowKeyCoder2.MakeCanonicalCodes();
+		addrLowNonkeyCoder1.MakeCanonicalCodes();
+		addrLowNonkeyCoder2.MakeCanonicalCodes();
+		addrHighCoder1.MakeCanonicalCodes();
+		addrHighCoder2.MakeCanonicalCodes();
+		countyKeyCoder.MakeCanonicalCodes();
+		countyNonkeyCoder.MakeCanonicalCodes();
+		censusTractKeyCoder1.MakeCanonicalCodes();
+		censusTractKeyCoder2.MakeCanonicalCodes();
+		censusTractNonkeyCoder1.MakeCanonicalCodes();
+		censusTractNonkeyCoder2.MakeCanonicalCodes();
+		censusBlockKeyCoder1.MakeCanonicalCodes();
+		censusBlockKeyCoder2.MakeCanonicalCodes();
+		censusBlockNonkeyCoder1.MakeCanonicalCodes();
+		censusBlockNonkeyCoder2.MakeCanonicalCodes();
+		postcodeExtKeyCoder.MakeCanonicalCodes();
+		postcodeExtNonkeyCoder.MakeCanonicalCodes();
+		coordinateIDCoder1.MakeCanonicalCodes();
+		coordinateIDCoder2.MakeCanonicalCodes();
+		coordinateCountCoder.MakeCanonicalCodes();
 
 		int chunkCount = 0;
 
@@ -547,54 +552,135 @@ namespace PortfolioExplorer {
 		dataBitStream.Flush();
 		dataFile.Close();
 
-		// Write out the huffman code tables.
-		struct FreqTableFiledef {
-			FreqTableFiledef(
-				FreqTable<int>& table_,
+		// Write out the huffman code-length tables.
+		struct CoderFiledef {
+			CoderFiledef(
+				HuffmanCoder<int, std::less<int> >& coder_,
 				const char* filename_
-			) : table(table_), filename(filename_)
+			) : coder(coder_), filename(GeoUtil::CodeLengthFilename(filename_))
 			{}
-			FreqTable<int>& table;
+			HuffmanCoder<int, std::less<int> >& coder;
 			TsString filename;
-		} freqTableFiledefs[] = {
-			FreqTableFiledef(addrLowKeyFreqTable1, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE1),
-			FreqTableFiledef(addrLowKeyFreqTable2, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE2),
-			FreqTableFiledef(addrLowNonkeyFreqTable1,STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE1),
-			FreqTableFiledef(addrLowNonkeyFreqTable2,STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE2),
-			FreqTableFiledef(addrHighFreqTable1, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE1),
-			FreqTableFiledef(addrHighFreqTable2, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE2),
-			FreqTableFiledef(countyKeyFreqTable, STREET_SEGMENT_COUNTY_KEY_HUFF_FILE),
-			FreqTableFiledef(countyNonkeyFreqTable, STREET_SEGMENT_COUNTY_NONKEY_HUFF_FILE),
-			FreqTableFiledef(censusTractKeyFreqTable1, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE1),
-			FreqTableFiledef(censusTractKeyFreqTable2, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE2),
-			FreqTableFiledef(censusTractNonkeyFreqTable1, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE1),
-			FreqTableFiledef(censusTractNonkeyFreqTable2, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE2),
-			FreqTableFiledef(censusBlockKeyFreqTable1, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE1),
-			FreqTableFiledef(censusBlockKeyFreqTable2, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE2),
-			FreqTableFiledef(censusBlockNonkeyFreqTable1, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE1),
-			FreqTableFiledef(censusBlockNonkeyFreqTable2, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE2),
-			FreqTableFiledef(postcodeExtKeyFreqTable, STREET_SEGMENT_POSTCODE_EXT_KEY_HUFF_FILE),
-			FreqTableFiledef(postcodeExtNonkeyFreqTable, STREET_SEGMENT_POSTCODE_EXT_NONKEY_HUFF_FILE),
-			FreqTableFiledef(coordinateIDFreqTable1, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE1),
-			FreqTableFiledef(coordinateIDFreqTable2, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE2),
-			FreqTableFiledef(coordinateCountFreqTable, STREET_SEGMENT_COORDINATE_COUNT_HUFF_FILE),
+		} coderFiledefs[] = {
+			CoderFiledef(addrLowKeyCoder1, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE1),
+			CoderFiledef(addrLowKeyCoder2, STREET_SEGMENT_ADDR_LOW_KEY_HUFF_FILE2),
+			CoderFiledef(addrLowNonkeyCoder1, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE1),
+			CoderFiledef(addrLowNonkeyCoder2, STREET_SEGMENT_ADDR_LOW_NONKEY_HUFF_FILE2),
+			CoderFiledef(addrHighCoder1, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE1),
+			CoderFiledef(addrHighCoder2, STREET_SEGMENT_ADDR_HIGH_HUFF_FILE2),
+			CoderFiledef(countyKeyCoder, STREET_SEGMENT_COUNTY_KEY_HUFF_FILE),
+			CoderFiledef(countyNonkeyCoder, STREET_SEGMENT_COUNTY_NONKEY_HUFF_FILE),
+			CoderFiledef(censusTractKeyCoder1, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE1),
+			CoderFiledef(censusTractKeyCoder2, STREET_SEGMENT_CENSUS_TRACT_KEY_HUFF_FILE2),
+			CoderFiledef(censusTractNonkeyCoder1, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE1),
+			CoderFiledef(censusTractNonkeyCoder2, STREET_SEGMENT_CENSUS_TRACT_NONKEY_HUFF_FILE2),
+			CoderFiledef(censusBlockKeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE1),
+			CoderFiledef(censusBlockKeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_KEY_HUFF_FILE2),
+			CoderFiledef(censusBlockNonkeyCoder1, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE1),
+			CoderFiledef(censusBlockNonkeyCoder2, STREET_SEGMENT_CENSUS_BLOCK_NONKEY_HUFF_FILE2),
+			CoderFiledef(postcodeExtKeyCoder, STREET_SEGMENT_POSTCODE_EXT_KEY_HUFF_FILE),
+			CoderFiledef(postcodeExtNonkeyCoder, STREET_SEGMENT_POSTCODE_EXT_NONKEY_HUFF_FILE),
+			CoderFiledef(coordinateIDCoder1, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE1),
+			CoderFiledef(coordinateIDCoder2, STREET_SEGMENT_COORDINATE_ID_HUFF_FILE2),
+			CoderFiledef(coordinateCountCoder, STREET_SEGMENT_COORDINATE_COUNT_HUFF_FILE),
 		};
 
 		for (
-			int freqTableIdx = 0; 
-			freqTableIdx < sizeof(freqTableFiledefs)/sizeof(freqTableFiledefs[0]); 
-			freqTableIdx++
+			int coderIdx = 0; 
+			coderIdx < sizeof(coderFiledefs)/sizeof(coderFiledefs[0]); 
+			coderIdx++
 		) {
 			std::fstream fs;
-			filename = outdir + "/" + freqTableFiledefs[freqTableIdx].filename;
-			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
-			if (fs.fail() || !freqTableFiledefs[freqTableIdx].table.Save(fs))
+			filename = outdir + "/" + coderFiledefs[coderIdx].filename;
+			fs.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+			if (fs.fail() || !GeoUtil::SaveCodeLengths(coderFiledefs[coderIdx].coder, fs))
 				throw TsString("Cannot write " + filename);
 			fs.close();
 		}
 	}
 
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Write the records as a packed table, a block at a time.
+	// Columns: addrLow, addrHigh (fixed width), leftRight, county,
+	// censusTract, censusBlock, postcodeExt (fixed width), 
+	// coordinateID (delta), coordinateCount.  QueryImp reads them in the
+	// same order.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadStreetSegment::ProcessPacked()
+	{
+		FieldAccessor streetSegmentIDValue = m_mapFieldAccessors["STREET_SEGMENT_ID"];
+		FieldAccessor addrLowValue = m_mapFieldAccessors["ADDR_LOW"];
+		FieldAccessor addrHighValue = m_mapFieldAccessors["ADDR_HIGH"];
+		FieldAccessor leftRightValue = m_mapFieldAccessors["LEFT_RIGHT"];
+		FieldAccessor countyValue = m_mapFieldAccessors["COUNTY"];
+		FieldAccessor censusTractValue = m_mapFieldAccessors["CENSUS_TRACT"];
+		FieldAccessor censusBlockValue = m_mapFieldAccessors["CENSUS_BLOCK"];
+		FieldAccessor postcodeExtValue = m_mapFieldAccessors["POSTCODE_EXT"];
+		FieldAccessor coordinateIDValue = m_mapFieldAccessors["COORDINATE_ID"];
+		FieldAccessor coordinateCountValue = m_mapFieldAccessors["COORDINATE_COUNT"];
+
+		PackedTableWriter writer;
+		OpenPackedTable(writer, STREET_SEGMENT_PACKED_FILE);
+
+		// Columns of the current block.
+		PackedBlockWriter block;
+		std::vector<char> addrLows;
+		std::vector<char> addrHighs;
+		std::vector<int> leftRights;
+		std::vector<int> counties;
+		std::vector<char> censusTracts;
+		std::vector<char> censusBlocks;
+		std::vector<char> postcodeExts;
+		std::vector<int> coordinateIDs;
+		std::vector<int> coordinateCounts;
+
+		bool moreInput = true;
+		while (moreInput) {
+			if ((int)streetSegmentIDValue.GetAsInt() != numberOfOutputRecords) {
+				throw TsString("Street Segment ID is out of sequence");
+			}
+			AppendCharField(addrLows, addrLowValue.GetAsString(), PackedStreetSegmentAddrWidth);
+			AppendCharField(addrHighs, addrHighValue.GetAsString(), PackedStreetSegmentAddrWidth);
+			leftRights.push_back(leftRightValue.GetAsBoolean() ? 1 : 0);
+			counties.push_back(countyValue.GetAsInt());
+			AppendCharField(censusTracts, censusTractValue.GetAsString(), PackedStreetSegmentCensusTractWidth);
+			AppendCharField(censusBlocks, censusBlockValue.GetAsString(), PackedStreetSegmentCensusBlockWidth);
+			AppendCharField(postcodeExts, postcodeExtValue.GetAsString(), PackedStreetSegmentPostcodeExtWidth);
+			coordinateIDs.push_back(coordinateIDValue.GetAsInt());
+			coordinateCounts.push_back(coordinateCountValue.GetAsInt());
+			numberOfOutputRecords++;
+
+			moreInput = m_readCSV.ReadRecord();
+			int count = int(leftRights.size());
+			if (count == PackedBlockSize || (!moreInput && count > 0)) {
+				block.Clear();
+				block.AddCharColumn(&addrLows[0], PackedStreetSegmentAddrWidth, count);
+				block.AddCharColumn(&addrHighs[0], PackedStreetSegmentAddrWidth, count);
+				block.AddIntColumn(&leftRights[0], count);
+				block.AddIntColumn(&counties[0], count);
+				block.AddCharColumn(&censusTracts[0], PackedStreetSegmentCensusTractWidth, count);
+				block.AddCharColumn(&censusBlocks[0], PackedStreetSegmentCensusBlockWidth, count);
+				block.AddCharColumn(&postcodeExts[0], PackedStreetSegmentPostcodeExtWidth, count);
+				block.AddDeltaColumn(&coordinateIDs[0], count);
+				block.AddIntColumn(&coordinateCounts[0], count);
+				WritePackedBlock(writer, block, count);
+
+				addrLows.clear();
+				addrHighs.clear();
+				leftRights.clear();
+				counties.clear();
+				censusTracts.clear();
+				censusBlocks.clear();
+				postcodeExts.clear();
+				coordinateIDs.clear();
+				coordinateCounts.clear();
+			}
+		}
+		ClosePackedTable(writer, STREET_SEGMENT_PACKED_FILE);
+	}
+
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Get a static array of FieldParameter entries, which will be used to
 	// load up the fieldParameters vector.  The terminating element must
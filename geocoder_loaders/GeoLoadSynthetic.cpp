@@ -0,0 +1,832 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoLoadSynthetic.cpp: Deterministic synthetic dataset for benchmarks.
+
+#define _WIN32_WINNT 0x5000
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "GeoLoadSynthetic.h"
+#include "../global/Soundex.h"
+#include "../global/Utility.h"
+
+namespace PortfolioExplorer {
+
+	// Distance between streets, in degrees
+	static const double BlockDegrees = 0.001;
+
+	// Name parts.  City names are <qualifier><prefix><suffix>.
+	static const char* const cityQualifiers[] = {
+		"", "NEW ", "EAST ", "WEST ", "NORTH ", "SOUTH ", "PORT ", "MOUNT ", "LAKE ", "FORT "
+	};
+	static const char* const cityPrefixes[] = {
+		"SPRING", "MAPLE", "CEDAR", "GREEN", "FAIR", "OAK", "RIVER", "LAKE", "HILL", "BROOK",
+		"WEST", "EAST", "NORTH", "PINE", "ASH", "ELM", "STONE", "WOOD", "RED", "BLUE",
+		"SILVER", "GOLD", "CLEAR", "HIGH", "LONG", "NEW", "MILL", "BAY", "ROSE", "SUN"
+	};
+	static const char* const citySuffixes[] = {
+		"FIELD", "VILLE", "TON", "DALE", "WOOD", "BURG", "PORT", "FORD", "VIEW",
+		"HAVEN", "CREST", "MONT", "LAND", "SIDE", "BROOK", "WATER", "RIDGE", "GROVE"
+	};
+	static const int nbrCityQualifiers = sizeof(cityQualifiers) / sizeof(cityQualifiers[0]);
+	static const int nbrCityPrefixes = sizeof(cityPrefixes) / sizeof(cityPrefixes[0]);
+	static const int nbrCitySuffixes = sizeof(citySuffixes) / sizeof(citySuffixes[0]);
+
+	// The first east-west streets of every city: several streets per soundex.
+	struct AmbiguousStreet {
+		const char* predir;
+		const char* name;
+		const char* suffix;
+	};
+	static const AmbiguousStreet ambiguousStreets[] = {
+		{ "N", "MAIN", "ST" },
+		{ "S", "MAIN", "ST" },
+		{ "", "MAIN", "AVE" },
+		{ "", "MAIN", "RD" },
+		{ "", "SMITH", "ST" },
+		{ "", "SMYTH", "ST" }
+	};
+	static const int nbrAmbiguousStreets = sizeof(ambiguousStreets) / sizeof(ambiguousStreets[0]);
+
+	// The other east-west streets
+	static const char* const streetNames[] = {
+		"OAK", "PINE", "MAPLE", "CEDAR", "ELM", "WALNUT", "CHESTNUT", "WASHINGTON", "LINCOLN", "JEFFERSON",
+		"PARK", "LAKE", "HILL", "RIVER", "CHURCH", "SCHOOL", "MILL", "SPRING", "HIGHLAND", "MEADOW"
+	};
+	static const int nbrStreetNames = sizeof(streetNames) / sizeof(streetNames[0]);
+
+	// Suffixes, and how they are spelled out in the typo workload
+	static const char* const streetSuffixes[] = { "ST", "AVE", "DR", "LN", "CT", "BLVD", "WAY", "PL", "RD" };
+	static const char* const streetSuffixWords[] = { "STREET", "AVENUE", "DRIVE", "LANE", "COURT", "BOULEVARD", "WAY", "PLACE", "ROAD" };
+	static const int nbrStreetSuffixes = sizeof(streetSuffixes) / sizeof(streetSuffixes[0]);
+
+	struct StateCode {
+		int code;
+		const char* abbr;
+	};
+	static const StateCode usStates[] = {
+		{ 6, "CA" }, { 36, "NY" }, { 48, "TX" }, { 12, "FL" }, { 17, "IL" }, { 53, "WA" }, { 13, "GA" }, { 39, "OH" }
+	};
+	static const StateCode caProvinces[] = {
+		{ 35, "ON" }, { 59, "BC" }, { 48, "AB" }, { 24, "PQ" }
+	};
+	static const int nbrUsStates = sizeof(usStates) / sizeof(usStates[0]);
+	static const int nbrCaProvinces = sizeof(caProvinces) / sizeof(caProvinces[0]);
+
+	// Letters used in Canadian postal codes
+	static const char caLetters[] = "ABCEGHJKLMNPRSTVXY";
+	static const int nbrCaLetters = sizeof(caLetters) - 1;
+
+	static const int StreetsPerCity = GeoLoadSynthetic::StreetsNorthSouth + GeoLoadSynthetic::StreetsEastWest;
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Local utilities
+	///////////////////////////////////////////////////////////////////////////////
+
+	// 1ST, 2ND, 3RD, 4TH...
+	static TsString Ordinal(int value)
+	{
+		const char* suffix = "TH";
+		if (value % 100 < 11 || value % 100 > 13) {
+			switch (value % 10) {
+			case 1: suffix = "ST"; break;
+			case 2: suffix = "ND"; break;
+			case 3: suffix = "RD"; break;
+			}
+		}
+		return FormatInteger(value) + suffix;
+	}
+
+	// Words joined by single spaces, skipping empty ones
+	static TsString JoinWords(const TsString& a, const TsString& b, const TsString& c)
+	{
+		TsString result = a;
+		if (!b.empty()) {
+			result += result.empty() ? "" : " ";
+			result += b;
+		}
+		if (!c.empty()) {
+			result += result.empty() ? "" : " ";
+			result += c;
+		}
+		return result;
+	}
+
+	// The soundex codes the geocoder searches on
+	static TsString CitySoundexOf(const TsString& city)
+	{
+		char tmp[100], soundex[10];
+		Soundex2(city.c_str(), tmp, soundex);
+		return soundex;
+	}
+	static TsString StreetSoundexOf(const TsString& street)
+	{
+		char tmp[100], soundex[10];
+		Soundex3(street.c_str(), tmp, soundex);
+		return soundex;
+	}
+
+	static TsString FormatDegrees(double value)
+	{
+		char buf[32];
+		sprintf(buf, "%.5f", value);
+		return buf;
+	}
+
+	// Record keyed by a string whose byte order is the table's sort order
+	struct KeyedRecord {
+		TsString key;
+		int id;
+		bool operator<(const KeyedRecord& rhs) const { return key < rhs.key; }
+	};
+
+	struct IntersectionRecord {
+		TsString key;				// state, soundex1, soundex2
+		int state;
+		TsString soundex1;
+		int streetNameID1;
+		int streetSegmentOffset1;
+		TsString soundex2;
+		int streetNameID2;
+		int streetSegmentOffset2;
+		bool operator<(const IntersectionRecord& rhs) const { return key < rhs.key; }
+	};
+
+	struct CentroidRecord {
+		TsString postcode;
+		double latitude;
+		double longitude;
+		bool operator<(const CentroidRecord& rhs) const { return postcode < rhs.postcode; }
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// A text file written in binary mode, so the bytes are the same on every
+	// platform.  Throws TsString on error.
+	///////////////////////////////////////////////////////////////////////////////
+	class SyntheticOutput {
+	public:
+		SyntheticOutput(const TsString& filename_, const char* header) : filename(filename_) {
+			fp = fopen(filename.c_str(), "wb");
+			if (fp == 0) {
+				throw TsString("Cannot open file " + filename + " for output");
+			}
+			if (header != 0) {
+				fprintf(fp, "%s\n", header);
+			}
+		}
+		~SyntheticOutput() {
+			if (fp != 0) {
+				fclose(fp);
+			}
+		}
+		FILE* Get() { return fp; }
+		void Close() {
+			bool failed = ferror(fp) != 0;
+			failed = (fclose(fp) != 0) || failed;
+			fp = 0;
+			if (failed) {
+				throw TsString("Cannot write " + filename);
+			}
+		}
+	private:
+		TsString filename;
+		FILE* fp;
+	};
+
+	// Sort postal codes by text, remembering where each came from
+	struct PostcodeLess {
+		bool operator()(const std::pair<TsString, int>& lhs, const std::pair<TsString, int>& rhs) const {
+			return lhs.first < rhs.first;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// GeoLoadSynthetic
+	///////////////////////////////////////////////////////////////////////////////
+	GeoLoadSynthetic::GeoLoadSynthetic(int nbrCities, unsigned int seed_) :
+		seed(seed_),
+		nbrStreetSegments(0),
+		nbrCoordinates(0)
+	{
+		if (nbrCities < 1 || nbrCities > MaxCities) {
+			throw TsString("Number of cities must be from 1 to ") + FormatInteger(int(MaxCities));
+		}
+		Build(nbrCities);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Lay out the cities, postal codes and streets.  Postal codes are numbered
+	// in postal code order, and streets by postal code, as the loaders expect.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::Build(int nbrCities)
+	{
+		Random random(seed);
+		char buf[32];
+
+		// Cities and their postal codes, unsorted
+		std::vector<Postcode> newPostcodes;
+		int zip = 10000;
+		int nbrCanadian = 0;
+		cities.resize(nbrCities);
+		{for (int i = 0; i < nbrCities; i++) {
+			City& city = cities[i];
+			city.name = TsString(cityQualifiers[(i / (nbrCityPrefixes * nbrCitySuffixes)) % nbrCityQualifiers]) +
+				cityPrefixes[i % nbrCityPrefixes] + citySuffixes[(i / nbrCityPrefixes) % nbrCitySuffixes];
+			bool canadian = (i % 10 == 9);
+			int nbrPostcodes = 1 + random.Next(3);
+			if (canadian) {
+				const StateCode& province = caProvinces[nbrCanadian % nbrCaProvinces];
+				city.country = "CA";
+				city.state = province.code;
+				city.stateAbbr = province.abbr;
+				sprintf(
+					buf, "%c%d%c",
+					caLetters[nbrCanadian % nbrCaLetters],
+					(nbrCanadian / nbrCaLetters) % 10,
+					caLetters[(nbrCanadian / (nbrCaLetters * 10)) % nbrCaLetters]
+				);
+				city.finance = buf;
+				city.latitude = 43.0 + (nbrCanadian % 40) * 0.2;
+				city.longitude = -123.0 + (nbrCanadian / 40) * 0.2;
+				nbrCanadian++;
+			} else {
+				const StateCode& state = usStates[i % nbrUsStates];
+				city.country = "US";
+				city.state = state.code;
+				city.stateAbbr = state.abbr;
+				sprintf(buf, "%06d", 100000 + i);
+				city.finance = buf;
+				city.latitude = 30.0 + (i % 60) * 0.2;
+				city.longitude = -120.0 + (i / 60) * 0.2;
+			}
+			for (int p = 0; p < nbrPostcodes; p++) {
+				Postcode postcode;
+				postcode.cityIdx = i;
+				if (canadian) {
+					sprintf(buf, "%s%c%c%c", city.finance.c_str(), '1' + p, caLetters[random.Next(nbrCaLetters)], '0' + random.Next(10));
+				} else {
+					zip += 1 + random.Next(4);
+					sprintf(buf, "%05d", zip);
+				}
+				postcode.postcode = buf;
+				postcode.latitude = city.latitude + (StreetsEastWest / 2 + p) * BlockDegrees;
+				postcode.longitude = city.longitude + (StreetsNorthSouth / 2 + p) * BlockDegrees;
+				postcode.streetNameIDFirst = 0;
+				postcode.streetNameIDLast = -1;
+				newPostcodes.push_back(postcode);
+			}
+		}}
+
+		// Number the postal codes in postal code order
+		{
+			std::vector<std::pair<TsString, int> > order;
+			for (unsigned i = 0; i < newPostcodes.size(); i++) {
+				order.push_back(std::make_pair(newPostcodes[i].postcode, int(i)));
+			}
+			std::sort(order.begin(), order.end(), PostcodeLess());
+			postcodes.resize(order.size());
+			for (unsigned i = 0; i < order.size(); i++) {
+				postcodes[i] = newPostcodes[order[i].second];
+				cities[postcodes[i].cityIdx].postcodeIdxs.push_back(int(i));
+			}
+		}
+
+		// Streets, spread over the postal codes of their city
+		std::vector<Street> newStreets;
+		{for (int i = 0; i < nbrCities; i++) {
+			const City& city = cities[i];
+			for (int s = 0; s < StreetsPerCity; s++) {
+				Street street;
+				street.cityIdx = i;
+				street.postcodeIdx = city.postcodeIdxs[s % city.postcodeIdxs.size()];
+				street.northSouth = s < StreetsNorthSouth;
+				if (street.northSouth) {
+					street.line = s;
+					street.name = Ordinal(s + 1);
+					street.suffix = "ST";
+				} else {
+					street.line = s - StreetsNorthSouth;
+					if (street.line < nbrAmbiguousStreets) {
+						street.predir = ambiguousStreets[street.line].predir;
+						street.name = ambiguousStreets[street.line].name;
+						street.suffix = ambiguousStreets[street.line].suffix;
+					} else {
+						street.name = streetNames[(street.line + i) % nbrStreetNames];
+						street.suffix = streetSuffixes[(street.line + i) % nbrStreetSuffixes];
+					}
+				}
+				street.streetSegmentIDFirst = 0;
+				street.coordinateIDFirst = 0;
+				newStreets.push_back(street);
+			}
+		}}
+
+		// Number the streets by postal code.  Each postal code holds the
+		// streets of one city, so a counting pass is enough.
+		{
+			std::vector<int> firstOfPostcode(postcodes.size() + 1, 0);
+			for (unsigned i = 0; i < newStreets.size(); i++) {
+				firstOfPostcode[newStreets[i].postcodeIdx + 1]++;
+			}
+			for (unsigned p = 0; p < postcodes.size(); p++) {
+				firstOfPostcode[p + 1] += firstOfPostcode[p];
+				postcodes[p].streetNameIDFirst = firstOfPostcode[p];
+				postcodes[p].streetNameIDLast = firstOfPostcode[p + 1] - 1;
+			}
+			streets.resize(newStreets.size());
+			streetsByCity.resize(newStreets.size());
+			for (unsigned i = 0; i < newStreets.size(); i++) {
+				int id = firstOfPostcode[newStreets[i].postcodeIdx]++;
+				streets[id] = newStreets[i];
+				streetsByCity[i] = id;
+			}
+		}
+
+		// Segments and coordinates follow the street order
+		for (unsigned i = 0; i < streets.size(); i++) {
+			Street& street = streets[i];
+			street.streetSegmentIDFirst = nbrStreetSegments;
+			street.coordinateIDFirst = nbrCoordinates;
+			int nbrBlocks = GetNbrBlocks(street);
+			nbrStreetSegments += 2 * nbrBlocks;
+			for (int block = 0; block < nbrBlocks; block++) {
+				nbrCoordinates += GetNbrBlockPoints(block);
+			}
+		}
+	}
+
+	int GeoLoadSynthetic::GetNbrBlocks(const Street& street) const
+	{
+		return (street.northSouth ? StreetsEastWest : StreetsNorthSouth) - 1;
+	}
+
+	// Every third block has a point in the middle as well as its ends
+	int GeoLoadSynthetic::GetNbrBlockPoints(int block)
+	{
+		return (block % 3 == 2) ? 3 : 2;
+	}
+
+	void GeoLoadSynthetic::GetBlockPoint(
+		const Street& street,
+		int block,
+		double fraction,
+		double& latitude,
+		double& longitude
+	) const {
+		const City& city = cities[street.cityIdx];
+		if (street.northSouth) {
+			latitude = city.latitude + (block + fraction) * BlockDegrees;
+			longitude = city.longitude + street.line * BlockDegrees;
+		} else {
+			latitude = city.latitude + street.line * BlockDegrees;
+			longitude = city.longitude + (block + fraction) * BlockDegrees;
+		}
+	}
+
+	const GeoLoadSynthetic::Street& GeoLoadSynthetic::GetStreet(int cityIdx, bool northSouth, int line) const
+	{
+		return streets[streetsByCity[cityIdx * StreetsPerCity + (northSouth ? 0 : StreetsNorthSouth) + line]];
+	}
+
+	// Canadian postal codes are written with a space: "K1A 0B1"
+	TsString GeoLoadSynthetic::FormatPostcode(const TsString& postcode)
+	{
+		if (postcode.size() == 6) {
+			return postcode.substr(0, 3) + " " + postcode.substr(3);
+		}
+		return postcode;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Loader input
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteLoaderInput(const TsString& indir)
+	{
+		// CityStatePostcode
+		{
+			SyntheticOutput out(indir + "/CityStatePostcode.csv", "CITY_STATE_POSTCODE_ID,COUNTRY,STATE,POSTCODE,CITY_NAME,FINANCE,STREET_NAME_ID_FIRST,STREET_NAME_ID_LAST");
+			for (unsigned i = 0; i < postcodes.size(); i++) {
+				const Postcode& postcode = postcodes[i];
+				const City& city = cities[postcode.cityIdx];
+				fprintf(
+					out.Get(), "%u,%s,%d,%s,%s,%s,%d,%d\n",
+					i, city.country.c_str(), city.state, postcode.postcode.c_str(), city.name.c_str(),
+					city.finance.c_str(), postcode.streetNameIDFirst, postcode.streetNameIDLast
+				);
+			}
+			out.Close();
+		}
+
+		// CityStatePostcodeFaIndex and CitySoundex
+		{
+			std::vector<KeyedRecord> byFinance;
+			std::vector<KeyedRecord> bySoundex;
+			char buf[8];
+			for (unsigned i = 0; i < postcodes.size(); i++) {
+				const City& city = cities[postcodes[i].cityIdx];
+				KeyedRecord record;
+				record.id = int(i);
+				record.key = city.finance;
+				byFinance.push_back(record);
+				sprintf(buf, "%03d", city.state);
+				record.key = buf + CitySoundexOf(city.name);
+				bySoundex.push_back(record);
+			}
+			std::stable_sort(byFinance.begin(), byFinance.end());
+			std::stable_sort(bySoundex.begin(), bySoundex.end());
+
+			SyntheticOutput faOut(indir + "/CityStatePostcodeFaIndex.csv", "FINANCE,CITY_STATE_POSTCODE_ID");
+			for (unsigned i = 0; i < byFinance.size(); i++) {
+				fprintf(faOut.Get(), "%s,%d\n", byFinance[i].key.c_str(), byFinance[i].id);
+			}
+			faOut.Close();
+
+			SyntheticOutput soundexOut(indir + "/CitySoundex.csv", "STATE,CITY_SOUNDEX,CITY_STATE_POSTCODE_ID");
+			for (unsigned i = 0; i < bySoundex.size(); i++) {
+				const City& city = cities[postcodes[bySoundex[i].id].cityIdx];
+				fprintf(soundexOut.Get(), "%d,\"%s\",%d\n", city.state, bySoundex[i].key.substr(3).c_str(), bySoundex[i].id);
+			}
+			soundexOut.Close();
+		}
+
+		// StreetName and StreetNameSoundex.  US finance numbers are all six
+		// digits and Canadian ones three letters and digits, so finance and
+		// soundex concatenated sort as the pair.
+		{
+			SyntheticOutput out(indir + "/StreetName.csv", "CITY_STATE_POSTCODE_ID,STREET_NAME_ID,PREFIX,PREDIR,NAME,SUFFIX,POSTDIR,STREET_SEGMENT_ID_FIRST,STREET_SEGMENT_COUNT");
+			std::vector<KeyedRecord> bySoundex;
+			for (unsigned i = 0; i < streets.size(); i++) {
+				const Street& street = streets[i];
+				fprintf(
+					out.Get(), "%d,%u,,%s,%s,%s,,%d,%d\n",
+					street.postcodeIdx, i, street.predir.c_str(), street.name.c_str(), street.suffix.c_str(),
+					street.streetSegmentIDFirst, 2 * GetNbrBlocks(street)
+				);
+				KeyedRecord record;
+				record.id = int(i);
+				record.key = cities[street.cityIdx].finance + StreetSoundexOf(street.name);
+				bySoundex.push_back(record);
+			}
+			out.Close();
+
+			std::stable_sort(bySoundex.begin(), bySoundex.end());
+			SyntheticOutput soundexOut(indir + "/StreetNameSoundex.csv", "STREET_INDEX_ID,FINANCE_NUMBER,STREET_SOUNDEX,STREET_NAME_ID");
+			for (unsigned i = 0; i < bySoundex.size(); i++) {
+				const TsString& finance = cities[streets[bySoundex[i].id].cityIdx].finance;
+				fprintf(
+					soundexOut.Get(), "%u,%s,\"%s\",%d\n",
+					i, finance.c_str(), bySoundex[i].key.substr(finance.size()).c_str(), bySoundex[i].id
+				);
+			}
+			soundexOut.Close();
+		}
+
+		// StreetSegment and Coordinate.  Both sides of a block share its
+		// coordinates; odd addresses are on the left.
+		{
+			SyntheticOutput segmentOut(indir + "/StreetSegment.csv", "STREET_SEGMENT_ID,ADDR_LOW,ADDR_HIGH,LEFT_RIGHT,COUNTY,CENSUS_TRACT,CENSUS_BLOCK,POSTCODE_EXT,COORDINATE_ID,COORDINATE_COUNT");
+			SyntheticOutput coordinateOut(indir + "/Coordinate.csv", "COORDINATE_ID,LATITUDE,LONGITUDE");
+			int segmentID = 0;
+			int coordinateID = 0;
+			for (unsigned i = 0; i < streets.size(); i++) {
+				const Street& street = streets[i];
+				int county = 1 + 2 * (street.cityIdx % 100);
+				int tract = 100 * (1 + street.cityIdx % 9000) + street.line;
+				int nbrBlocks = GetNbrBlocks(street);
+				for (int block = 0; block < nbrBlocks; block++) {
+					int nbrPoints = GetNbrBlockPoints(block);
+					int base = 100 * (block + 1);
+					int postcodeExt = 1000 + (int(i) * 13 + block) % 9000;
+					for (int right = 0; right < 2; right++) {
+						fprintf(
+							segmentOut.Get(), "%d,%d,%d,%d,%d,%06d,%04d,%04d,%d,%d\n",
+							segmentID, base + 1 - right, base + 99 - right, right, county, tract,
+							1000 + block, postcodeExt, coordinateID, nbrPoints
+						);
+						segmentID++;
+					}
+					for (int point = 0; point < nbrPoints; point++) {
+						double latitude, longitude;
+						GetBlockPoint(street, block, double(point) / (nbrPoints - 1), latitude, longitude);
+						fprintf(coordinateOut.Get(), "%d,%.5f,%.5f\n", coordinateID, latitude, longitude);
+						coordinateID++;
+					}
+				}
+			}
+			segmentOut.Close();
+			coordinateOut.Close();
+		}
+
+		// StreetIntersectionSoundex: every crossing of the grid, once, with
+		// the segments starting there (or ending there, at the far edge).
+		{
+			std::vector<IntersectionRecord> records;
+			char buf[8];
+			for (unsigned c = 0; c < cities.size(); c++) {
+				const City& city = cities[c];
+				sprintf(buf, "%03d", city.state);
+				for (int j = 0; j < StreetsNorthSouth; j++) {
+					const Street& street1 = GetStreet(c, true, j);
+					int streetID1 = streetsByCity[c * StreetsPerCity + j];
+					for (int k = 0; k < StreetsEastWest; k++) {
+						const Street& street2 = GetStreet(c, false, k);
+						IntersectionRecord record;
+						record.state = city.state;
+						record.soundex1 = StreetSoundexOf(street1.name);
+						record.streetNameID1 = streetID1;
+						record.streetSegmentOffset1 = 2 * JHMIN(k, GetNbrBlocks(street1) - 1);
+						record.soundex2 = StreetSoundexOf(street2.name);
+						record.streetNameID2 = streetsByCity[c * StreetsPerCity + StreetsNorthSouth + k];
+						record.streetSegmentOffset2 = 2 * JHMIN(j, GetNbrBlocks(street2) - 1);
+						record.key = buf + record.soundex1 + record.soundex2;
+						records.push_back(record);
+					}
+				}
+			}
+			std::stable_sort(records.begin(), records.end());
+
+			SyntheticOutput out(indir + "/StreetIntersectionSoundex.csv", "STATE,SOUNDEX1,STREET_NAME_ID1,STREET_SEGMENT_OFFSET1,SOUNDEX2,STREET_NAME_ID2,STREET_SEGMENT_OFFSET2");
+			for (unsigned i = 0; i < records.size(); i++) {
+				const IntersectionRecord& record = records[i];
+				fprintf(
+					out.Get(), "%d,\"%s\",%d,%d,\"%s\",%d,%d\n",
+					record.state, record.soundex1.c_str(), record.streetNameID1, record.streetSegmentOffset1,
+					record.soundex2.c_str(), record.streetNameID2, record.streetSegmentOffset2
+				);
+			}
+			out.Close();
+		}
+
+		// PostcodeCentroid: every postal code, and the FSA of each Canadian city
+		{
+			std::vector<CentroidRecord> records;
+			for (unsigned i = 0; i < postcodes.size(); i++) {
+				CentroidRecord record;
+				record.postcode = postcodes[i].postcode;
+				record.latitude = postcodes[i].latitude;
+				record.longitude = postcodes[i].longitude;
+				records.push_back(record);
+			}
+			for (unsigned c = 0; c < cities.size(); c++) {
+				if (cities[c].country == "CA") {
+					CentroidRecord record;
+					record.postcode = cities[c].finance;
+					record.latitude = cities[c].latitude + (StreetsEastWest / 2) * BlockDegrees;
+					record.longitude = cities[c].longitude + (StreetsNorthSouth / 2) * BlockDegrees;
+					records.push_back(record);
+				}
+			}
+			std::sort(records.begin(), records.end());
+
+			SyntheticOutput out(indir + "/PostcodeCentroid.csv", "POSTCODE,LATITUDE,LONGITUDE");
+			for (unsigned i = 0; i < records.size(); i++) {
+				fprintf(out.Get(), "%s,%.5f,%.5f\n", records[i].postcode.c_str(), records[i].latitude, records[i].longitude);
+			}
+			out.Close();
+		}
+
+		// PostcodeAlias: the ZIP codes of a US city with more than one
+		{
+			SyntheticOutput out(indir + "/PostcodeAlias.csv", "POSTCODE,POSTCODE_GROUP");
+			for (unsigned c = 0; c < cities.size(); c++) {
+				const City& city = cities[c];
+				if (city.country != "US" || city.postcodeIdxs.size() < 2) {
+					continue;
+				}
+				const TsString& group = postcodes[city.postcodeIdxs[0]].postcode;
+				for (unsigned p = 0; p < city.postcodeIdxs.size(); p++) {
+					fprintf(out.Get(), "%s,%s\n", postcodes[city.postcodeIdxs[p]].postcode.c_str(), group.c_str());
+				}
+			}
+			out.Close();
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Workloads.  Each has its own generator, so adding one does not change
+	// the others.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteWorkloads(const TsString& outdir, int nbrAddresses)
+	{
+		WriteStreetAddresses(outdir, "clean", nbrAddresses, false);
+		WriteStreetAddresses(outdir, "typo", nbrAddresses, true);
+		WriteCityOnly(outdir, nbrAddresses);
+		WriteIntersections(outdir, nbrAddresses);
+		WritePostcodeOnly(outdir, nbrAddresses);
+		WriteAmbiguous(outdir, nbrAddresses);
+	}
+
+	TsString GeoLoadSynthetic::AddTypo(const TsString& str, Random& random)
+	{
+		if (str.size() < 4) {
+			return str;
+		}
+		TsString result = str;
+		int pos = 1 + random.Next(int(str.size()) - 2);
+		switch (random.Next(4)) {
+		case 0:
+			// Swap two letters
+			std::swap(result[pos], result[pos + 1]);
+			break;
+		case 1:
+			// Drop a letter
+			result.erase(pos, 1);
+			break;
+		case 2:
+			// Double a letter
+			result.insert(result.begin() + pos, result[pos]);
+			break;
+		default:
+			// Wrong letter
+			result[pos] = (result[pos] == 'E') ? 'A' : 'E';
+			break;
+		}
+		return result;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// A random house on a random street: clean, or with a typo in the street
+	// or city, the suffix spelled out, or the postal code left off.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteStreetAddresses(
+		const TsString& outdir,
+		const char* name,
+		int nbrAddresses,
+		bool typos
+	) {
+		Random random(seed + (typos ? 2000 : 1000));
+		SyntheticOutput out(outdir + "/" + name + ".txt", 0);
+		SyntheticOutput expected(outdir + "/" + name + ".expected", 0);
+		for (int a = 0; a < nbrAddresses; a++) {
+			int cityIdx = random.Next(int(cities.size()));
+			const Street& street = streets[streetsByCity[cityIdx * StreetsPerCity + random.Next(StreetsPerCity)]];
+			int block = random.Next(GetNbrBlocks(street));
+			int right = random.Next(2);
+			int addrLow = 100 * (block + 1) + 1 - right;
+			int number = addrLow + 2 * random.Next(50);
+			double latitude, longitude;
+			GetBlockPoint(street, block, (number - addrLow) / 98.0, latitude, longitude);
+
+			TsString streetName = street.name;
+			TsString suffix = street.suffix;
+			TsString cityName = cities[cityIdx].name;
+			bool withPostcode = true;
+			if (typos) {
+				bool numbered = street.northSouth;
+				switch (random.Next(4)) {
+				case 0:
+					if (numbered) {
+						cityName = AddTypo(cityName, random);
+					} else {
+						streetName = AddTypo(streetName, random);
+					}
+					break;
+				case 1:
+					cityName = AddTypo(cityName, random);
+					break;
+				case 2:
+					for (int s = 0; s < nbrStreetSuffixes; s++) {
+						if (suffix == streetSuffixes[s]) {
+							suffix = streetSuffixWords[s];
+							break;
+						}
+					}
+					withPostcode = false;
+					break;
+				default:
+					if (!numbered) {
+						streetName = AddTypo(streetName, random);
+					}
+					withPostcode = false;
+					break;
+				}
+			}
+
+			const Postcode& postcode = postcodes[street.postcodeIdx];
+			TsString lastLine = cityName + " " + cities[cityIdx].stateAbbr;
+			if (withPostcode) {
+				lastLine += " " + FormatPostcode(postcode.postcode);
+			}
+			fprintf(
+				out.Get(), "%d %s\t%s\n",
+				number, JoinWords(street.predir, streetName, suffix).c_str(), lastLine.c_str()
+			);
+			fprintf(expected.Get(), "%s %s\n", FormatDegrees(latitude).c_str(), FormatDegrees(longitude).c_str());
+		}
+		out.Close();
+		expected.Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// City and state only
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteCityOnly(const TsString& outdir, int nbrAddresses)
+	{
+		Random random(seed + 3000);
+		SyntheticOutput out(outdir + "/cityonly.txt", 0);
+		SyntheticOutput expected(outdir + "/cityonly.expected", 0);
+		for (int a = 0; a < nbrAddresses; a++) {
+			const City& city = cities[random.Next(int(cities.size()))];
+			fprintf(out.Get(), "\t%s %s\n", city.name.c_str(), city.stateAbbr.c_str());
+			fprintf(expected.Get(), "-\n");
+		}
+		out.Close();
+		expected.Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// "1ST ST & OAK AVE", either way round, with city and state
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteIntersections(const TsString& outdir, int nbrAddresses)
+	{
+		Random random(seed + 4000);
+		SyntheticOutput out(outdir + "/intersection.txt", 0);
+		SyntheticOutput expected(outdir + "/intersection.expected", 0);
+		for (int a = 0; a < nbrAddresses; a++) {
+			int cityIdx = random.Next(int(cities.size()));
+			const City& city = cities[cityIdx];
+			int j = random.Next(StreetsNorthSouth);
+			int k = random.Next(StreetsEastWest);
+			TsString street1 = JoinWords(GetStreet(cityIdx, true, j).predir, GetStreet(cityIdx, true, j).name, GetStreet(cityIdx, true, j).suffix);
+			TsString street2 = JoinWords(GetStreet(cityIdx, false, k).predir, GetStreet(cityIdx, false, k).name, GetStreet(cityIdx, false, k).suffix);
+			if (random.Next(2) != 0) {
+				std::swap(street1, street2);
+			}
+			fprintf(
+				out.Get(), "%s & %s\t%s %s\n",
+				street1.c_str(), street2.c_str(), city.name.c_str(), city.stateAbbr.c_str()
+			);
+			fprintf(
+				expected.Get(), "%s %s\n",
+				FormatDegrees(city.latitude + k * BlockDegrees).c_str(),
+				FormatDegrees(city.longitude + j * BlockDegrees).c_str()
+			);
+		}
+		out.Close();
+		expected.Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// A US ZIP code or Canadian postal code alone, coded to its centroid
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WritePostcodeOnly(const TsString& outdir, int nbrAddresses)
+	{
+		Random random(seed + 5000);
+		SyntheticOutput out(outdir + "/postcode.txt", 0);
+		SyntheticOutput expected(outdir + "/postcode.expected", 0);
+		for (int a = 0; a < nbrAddresses; a++) {
+			const Postcode& postcode = postcodes[random.Next(int(postcodes.size()))];
+			fprintf(out.Get(), "\t%s\n", FormatPostcode(postcode.postcode).c_str());
+			fprintf(expected.Get(), "%s %s\n", FormatDegrees(postcode.latitude).c_str(), FormatDegrees(postcode.longitude).c_str());
+		}
+		out.Close();
+		expected.Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// "123 MAIN" or "123 SMITH" with city and state only: every city has four
+	// MAIN streets and a SMITH and SMYTH with the same soundex.
+	///////////////////////////////////////////////////////////////////////////////
+	void GeoLoadSynthetic::WriteAmbiguous(const TsString& outdir, int nbrAddresses)
+	{
+		Random random(seed + 6000);
+		SyntheticOutput out(outdir + "/ambiguous.txt", 0);
+		SyntheticOutput expected(outdir + "/ambiguous.expected", 0);
+		for (int a = 0; a < nbrAddresses; a++) {
+			int cityIdx = random.Next(int(cities.size()));
+			const City& city = cities[cityIdx];
+			const Street& street = GetStreet(cityIdx, false, random.Next(nbrAmbiguousStreets));
+			int number = 100 * (1 + random.Next(GetNbrBlocks(street))) + random.Next(100);
+			fprintf(
+				out.Get(), "%d %s\t%s %s\n",
+				number, street.name.c_str(), city.name.c_str(), city.stateAbbr.c_str()
+			);
+			fprintf(expected.Get(), "-\n");
+		}
+		out.Close();
+		expected.Close();
+	}
+}
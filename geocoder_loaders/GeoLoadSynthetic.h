@@ -0,0 +1,175 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoLoadSynthetic.h: Deterministic synthetic dataset for benchmarks.
+//
+// Generates the input files of every loader, <LoaderName>.csv, for a set
+// of made-up cities, and address files to code against the database built
+// from them.  The same number of cities and seed always give the same
+// files, on any platform, so timings from different versions can be
+// compared.
+//
+// Each city is a grid of StreetsNorthSouth numbered streets (1ST ST, 2ND
+// ST...) crossing StreetsEastWest named ones, one block apart, with odd
+// addresses on the left of each block and even on the right.  The first
+// east-west streets of every city are N MAIN ST, S MAIN ST, MAIN AVE,
+// MAIN RD, SMITH ST and SMYTH ST, so a bare "MAIN" or "SMITH" matches
+// several streets.  Every tenth city is Canadian.  US cities have one to
+// three ZIP codes, aliased to each other, and Canadian ones one to three
+// postal codes in one FSA; each has a centroid, and streets are spread
+// over the postal codes of their city.
+
+#ifndef INCL_GeoLoadSynthetic_H
+#define INCL_GeoLoadSynthetic_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif
+
+#include <vector>
+#include "../global/TsString.h"
+
+namespace PortfolioExplorer {
+
+	class GeoLoadSynthetic {
+	public:
+		enum {
+			StreetsNorthSouth = 12,
+			StreetsEastWest = 12,
+			MaxCities = 5000,
+			DefaultSeed = 1
+		};
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Lay out the dataset.  Throws TsString if nbrCities is out of range.
+		// Inputs:
+		//	int				nbrCities		Number of cities, 1 to MaxCities
+		//	unsigned int	seed			Seed of the generator
+		///////////////////////////////////////////////////////////////////////////////
+		GeoLoadSynthetic(int nbrCities, unsigned int seed = DefaultSeed);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Write InDir/<LoaderName>.csv for every loader.  Throws TsString on error.
+		///////////////////////////////////////////////////////////////////////////////
+		void WriteLoaderInput(const TsString& indir);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Write the benchmark workloads to OutDir, each as <name>.txt, one
+		// address per line (street address, a tab, then the last line), and
+		// <name>.expected, the expected latitude and longitude of each address
+		// or "-" where there is no single right answer.  Throws TsString on error.
+		// Inputs:
+		//	const TsString&	outdir			Output directory
+		//	int				nbrAddresses	Addresses per workload
+		///////////////////////////////////////////////////////////////////////////////
+		void WriteWorkloads(const TsString& outdir, int nbrAddresses);
+
+		// Sizes of the dataset, for reports
+		int GetNbrCities() const { return int(cities.size()); }
+		int GetNbrCityStatePostcodes() const { return int(postcodes.size()); }
+		int GetNbrStreetNames() const { return int(streets.size()); }
+		int GetNbrStreetSegments() const { return nbrStreetSegments; }
+		int GetNbrCoordinates() const { return nbrCoordinates; }
+
+	private:
+		// Deterministic generator; the same on every platform.
+		class Random {
+		public:
+			explicit Random(unsigned int seed) : state(seed * 2654435761u + 1) {}
+			// Uniform in [0, n)
+			int Next(int n) {
+				state = state * 1103515245u + 12345u;
+				return int((state >> 8) % unsigned(n));
+			}
+		private:
+			unsigned int state;
+		};
+
+		struct City {
+			TsString name;
+			TsString country;
+			int state;
+			TsString stateAbbr;
+			TsString finance;
+			double latitude;			// south-west corner of the grid
+			double longitude;
+			std::vector<int> postcodeIdxs;	// into postcodes, in postal code order
+		};
+
+		struct Postcode {
+			int cityIdx;
+			TsString postcode;
+			double latitude;			// centroid
+			double longitude;
+			int streetNameIDFirst;
+			int streetNameIDLast;
+		};
+
+		struct Street {
+			int cityIdx;
+			int postcodeIdx;
+			bool northSouth;
+			int line;					// position in the grid
+			TsString predir;
+			TsString name;
+			TsString suffix;
+			int streetSegmentIDFirst;
+			int coordinateIDFirst;
+		};
+
+		// Build the cities, postal codes and streets, in ID order.
+		void Build(int nbrCities);
+
+		// Number of blocks of a street, and of coordinates of a block
+		int GetNbrBlocks(const Street& street) const;
+		static int GetNbrBlockPoints(int block);
+
+		// Coordinates of the point a fraction of the way along a block
+		void GetBlockPoint(const Street& street, int block, double fraction, double& latitude, double& longitude) const;
+
+		// A city's street by its place in the grid
+		const Street& GetStreet(int cityIdx, bool northSouth, int line) const;
+
+		// Postal code as written in an address
+		static TsString FormatPostcode(const TsString& postcode);
+
+		// Workloads
+		void WriteStreetAddresses(const TsString& outdir, const char* name, int nbrAddresses, bool typos);
+		void WriteCityOnly(const TsString& outdir, int nbrAddresses);
+		void WriteIntersections(const TsString& outdir, int nbrAddresses);
+		void WritePostcodeOnly(const TsString& outdir, int nbrAddresses);
+		void WriteAmbiguous(const TsString& outdir, int nbrAddresses);
+
+		// Add a plausible typing error to a name, keeping its first letter
+		static TsString AddTypo(const TsString& str, Random& random);
+
+		unsigned int seed;
+		std::vector<City> cities;
+		std::vector<Postcode> postcodes;	// sorted by postal code; index is the ID
+		std::vector<Street> streets;		// index is the ID
+		std::vector<int> streetsByCity;		// street IDs by city, north-south then east-west
+		int nbrStreetSegments;
+		int nbrCoordinates;
+	};
+}
+
+#endif
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define INCL_Geoload_Utilities_h
 
 #include "io.h"
+#include "../global/File.h"
 
 namespace PortfolioExplorer {
 	
@@ -4,73 +4,261 @@
 
 #include "ReadCSV.h"
 
-namespace PortfolioExplorer 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define READCSV_SSE2
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+namespace PortfolioExplorer
 {
-	inline bool ReadCSV::ReadBuffer()
+	// Size of the mapped view.  Lines longer than this grow the view.
+	static const size_t ViewSize = 0x4000000;
+
+	static const char cDelimeter = ',';
+
+#if defined(READCSV_SSE2)
+	// Index of the lowest set bit of a non-zero mask
+	static inline int LowestBit(int mask)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, (unsigned long)mask);
+		return int(index);
+	#else
+		return __builtin_ctz((unsigned)mask);
+	#endif
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Find the first delimiter or null in [p, pEnd), sixteen bytes at a time.
+	// Return value:
+	//	const char*		the character found, or pEnd
+	///////////////////////////////////////////////////////////////////////////////
+	static inline const char* FindDelimiterOrNull(const char* p, const char* pEnd)
+	{
+#if defined(READCSV_SSE2)
+		const __m128i delimiters = _mm_set1_epi8(cDelimeter);
+		const __m128i nulls = _mm_setzero_si128();
+		while (pEnd - p >= 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*)p);
+			int mask = _mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, delimiters), _mm_cmpeq_epi8(chunk, nulls))
+			);
+			if (mask != 0) {
+				return p + LowestBit(mask);
+			}
+			p += 16;
+		}
+#endif
+		while (p < pEnd && *p != cDelimeter && *p != '\0') {
+			p++;
+		}
+		return p;
+	}
+
+	ReadCSV::ReadCSV()
+		: m_nFileSize(0)
+#if defined(WIN32)
+		, m_hFile(INVALID_HANDLE_VALUE)
+		, m_hMapping(NULL)
+#else
+		, m_nFd(-1)
+#endif
+		, m_nDefaultViewSize(ViewSize)
+		, m_pView(NULL)
+		, m_nViewSize(0)
+		, m_nViewOffset(0)
+		, m_pPos(NULL)
+		, m_pViewEnd(NULL)
+		, m_nScratchUsed(0)
+	{}
+
+	ReadCSV::~ReadCSV()
 	{
-		if (m_bIsEOF)
-			return false;
+		Close();
+	}
 
-		size_t nSize = m_file.Read(sizeof(m_pCurrentBuffer), m_pCurrentBuffer);
-		m_pCurrentBufferPos = m_pCurrentBuffer;
-		if (nSize != sizeof(m_pCurrentBuffer))
+	void ReadCSV::Open(TsString strFile)
+	{
+		Close();
+		m_strFile = strFile;
+
+#if defined(WIN32)
+		m_hFile = CreateFile(
+			m_strFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+		);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			throw TsString("Cannot open input file ") + m_strFile;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_hFile, &fileSize))
 		{
-			m_bIsEOF = true;
-			if (nSize==0)
-				return false;
+			Close();
+			throw TsString("Cannot get size of input file ") + m_strFile;
+		}
+		m_nFileSize = fileSize.QuadPart;
+		if (m_nFileSize != 0)
+		{
+			m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (m_hMapping == NULL)
+			{
+				Close();
+				throw TsString("Cannot map input file ") + m_strFile;
+			}
+		}
+#else
+		m_nFd = open(m_strFile.c_str(), O_RDONLY);
+		if (m_nFd < 0)
+			throw TsString("Cannot open input file ") + m_strFile;
+		struct stat fileStat;
+		if (fstat(m_nFd, &fileStat) != 0)
+		{
+			Close();
+			throw TsString("Cannot get size of input file ") + m_strFile;
+		}
+		m_nFileSize = fileStat.st_size;
+#endif
+		MapView(0, 0);
+	}
 
-			// move it up in the buffer so the end is the end
-			memmove(m_pCurrentBuffer+(sizeof(m_pCurrentBuffer)-nSize), m_pCurrentBuffer, nSize);
-			m_pCurrentBufferPos += (sizeof(m_pCurrentBuffer)-nSize);
+	void ReadCSV::ReOpen()
+	{
+		Open(m_strFile);
+	}
+
+	void ReadCSV::Close()
+	{
+		UnmapView();
+#if defined(WIN32)
+		if (m_hMapping != NULL)
+		{
+			CloseHandle(m_hMapping);
+			m_hMapping = NULL;
+		}
+		if (m_hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_hFile);
+			m_hFile = INVALID_HANDLE_VALUE;
 		}
-		return true;
+#else
+		if (m_nFd >= 0)
+		{
+			close(m_nFd);
+			m_nFd = -1;
+		}
+#endif
+		m_nFileSize = 0;
+		m_vFields.clear();
+	}
+
+	void ReadCSV::Seek(__int64 offset)
+	{
+		m_vFields.clear();
+		MapView(offset, 0);
 	}
 
+	void ReadCSV::UnmapView()
+	{
+		if (m_pView != NULL)
+		{
+#if defined(WIN32)
+			UnmapViewOfFile(m_pView);
+#else
+			munmap((void*)m_pView, m_nViewSize);
+#endif
+		}
+		m_pView = m_pPos = m_pViewEnd = NULL;
+		m_nViewOffset = 0;
+		m_nViewSize = 0;
+	}
 
-	// Returns NULL if EOL or EOF, "" for an empty field
-	bool ReadCSV::GetNextField(TsString & strRet)
+	void ReadCSV::MapView(__int64 offset, size_t minSize)
 	{
-		strRet.resize(0);
-		const char cDelimeter = ',';
+		UnmapView();
+		if (offset >= m_nFileSize)
+		{
+			m_nViewOffset = m_nFileSize;
+			return;
+		}
 
+#if defined(WIN32)
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		__int64 granularity = systemInfo.dwAllocationGranularity;
+#else
+		__int64 granularity = sysconf(_SC_PAGESIZE);
+#endif
+		__int64 alignedOffset = offset - offset % granularity;
+		__int64 size = JHMAX(__int64(m_nDefaultViewSize), __int64(minSize) + (offset - alignedOffset));
+		size = JHMIN(size, m_nFileSize - alignedOffset);
+
+#if defined(WIN32)
+		void* pView = MapViewOfFile(
+			m_hMapping, FILE_MAP_READ,
+			DWORD(alignedOffset >> 32), DWORD(alignedOffset & 0xffffffff), SIZE_T(size)
+		);
+		if (pView == NULL)
+			throw TsString("Cannot map view of input file ") + m_strFile;
+#else
+		void* pView = mmap(NULL, size_t(size), PROT_READ, MAP_PRIVATE, m_nFd, off_t(alignedOffset));
+		if (pView == MAP_FAILED)
+			throw TsString("Cannot map view of input file ") + m_strFile;
+		madvise(pView, size_t(size), MADV_SEQUENTIAL);
+#endif
+		m_pView = (const char*)pView;
+		m_nViewOffset = alignedOffset;
+		m_nViewSize = size_t(size);
+		m_pViewEnd = m_pView + m_nViewSize;
+		m_pPos = m_pView + (offset - alignedOffset);
+	}
+
+	// Parse one field a character at a time into the scratch buffer.  Nulls
+	// are skipped, a field starting with a quote runs to the next quote that
+	// is followed by the delimiter or end of line, and doubled quotes are
+	// escapes.  A field left empty by the end of the file is dropped.
+	// Returns the start of the next field.
+	const char* ReadCSV::ParseCopiedField(const char* p, const char* pEnd, bool bEOF)
+	{
+		char* pOut = &m_vScratch[m_nScratchUsed];
 		char cQuote = 0;
 		// the position of a quote who's staus is in question.
 		// this default condition can not be -1 because nLastQuotePos!=(nCurrentLen-1) would test wrong for position 0
-		int nLastQuotePos = -99; 
+		int nLastQuotePos = -99;
 		int nCurrentLen = 0;
-		bool bStart = cDelimeter!=0;
+		bool bStart = true;
 
-		for ( ; ;m_pCurrentBufferPos++)
+		bool bDelimiter = false;
+		for (; p < pEnd; p++)
 		{
-			if (m_pCurrentBufferPos==m_pCurrentBufferEnd && !ReadBuffer())
-			{
-				if (strRet.empty())
-					return false;
-				else 
-					break;
-			}
-			// trim leading whitespace and look for initial quote
-			char c=*m_pCurrentBufferPos;
+			char c = *p;
 
 			// We treat nulls as white space
 			// and ignore them even in middle of data field
-			if (c == '\0') {
+			if (c == '\0')
 				continue;
-			}
 
 			if (bStart)
 			{
-				if (c=='\n')
-				{
-					m_pCurrentBufferPos++; // increment past the \n for next time
-					return false;
-				}
-
 				// Ignore leading whitespace on a field if it isn't delimeter
 				if (c != cDelimeter && (c==' ' || c=='\t'))
 					continue;
 
-				bStart = false;  
+				bStart = false;
 
 				if (c=='"' || c=='\'')
 				{
@@ -79,16 +267,14 @@ namespace PortfolioExplorer
 				}
 			}
 
-			if (c=='\n')
-				break;
-
 			if ((cQuote==0 || nLastQuotePos>=0) && c==cDelimeter)
 			{
-				m_pCurrentBufferPos++; // increment past the , for next time
+				p++; // increment past the , for next time
+				bDelimiter = true;
 				break;
 			}
 
-			if (c==cQuote && cDelimeter!=0)
+			if (c==cQuote)
 			{
 				if (nLastQuotePos==(nCurrentLen-1))
 				{
@@ -98,55 +284,191 @@ namespace PortfolioExplorer
 				else
 					nLastQuotePos = nCurrentLen; // record it and fall through to append this quote to output
 			}
-			else if (nLastQuotePos>=0 && !isspace(c))
+			else if (nLastQuotePos>=0 && !isspace((unsigned char)c))
 				nLastQuotePos = -99;
 
-			nCurrentLen++;
-			strRet += c;
+			pOut[nCurrentLen++] = c;
 		}
 
-		assert(cQuote==0 || nLastQuotePos>=0);
+		if (bEOF && !bDelimiter && nCurrentLen==0)
+			return p;
 
 		if (nLastQuotePos>=0)
 		{
-			strRet.resize(nLastQuotePos);
+			nCurrentLen = nLastQuotePos;
 		}
-		else if (cDelimeter!=0)
+		else
 		{
-			size_t nNewLen = strRet.length();
-			while(nNewLen!=0 && isspace(strRet[nNewLen-1]))
-				nNewLen--;
-			strRet.resize(nNewLen);
+			while(nCurrentLen!=0 && isspace((unsigned char)pOut[nCurrentLen-1]))
+				nCurrentLen--;
 		}
 
-		return true;
+		Field field;
+		field.ptr = pOut;
+		field.len = nCurrentLen;
+		m_vFields.push_back(field);
+		m_nScratchUsed += nCurrentLen;
+		return p;
 	}
 
 	bool ReadCSV::ReadRecord()
 	{
-		m_vValues.clear();
+		m_vFields.clear();
+		m_nScratchUsed = 0;
 
-		bool bEOL = false;
-		TsString strVal;
-		while(GetNextField(strVal))
-			m_vValues.push_back(strVal);
+		// Find the end of the line.  If the line runs off the end of the view
+		// then map a new view starting at the line.  memchr() is already
+		// vectorized by the runtime library.
+		const char* pLineEnd;
+		for (;;)
+		{
+			if (m_pPos == m_pViewEnd && m_nViewOffset + __int64(m_nViewSize) >= m_nFileSize)
+				return false;
+			pLineEnd = (const char*)memchr(m_pPos, '\n', m_pViewEnd - m_pPos);
+			if (pLineEnd != NULL)
+				break;
+			if (m_nViewOffset + __int64(m_nViewSize) >= m_nFileSize)
+			{
+				pLineEnd = m_pViewEnd;
+				break;
+			}
+			MapView(GetFilePosition(), (m_pViewEnd - m_pPos) * 2 + 1);
+		}
 
-		return m_vValues.size()!=0;
-	}
+		const char* p = m_pPos;
+		bool bEOF = (pLineEnd == m_pViewEnd);
+		m_pPos = bEOF ? pLineEnd : pLineEnd + 1;
 
+		// Unescaped fields can never be longer than the line.
+		if (m_vScratch.size() < size_t(pLineEnd - p) + 1)
+			m_vScratch.resize(pLineEnd - p + 1);
 
-	void ReadCSV::Open(TsString strFile)
-	{
-		m_pCurrentBufferPos = m_pCurrentBuffer+sizeof(m_pCurrentBuffer);
-		m_pCurrentBufferEnd = (m_pCurrentBuffer+sizeof(m_pCurrentBuffer));
-		m_bIsEOF = false;
-		m_strFile = strFile;
-		m_file.Open(File::ReadOnly, m_strFile);
+		for (;;)
+		{
+			// trim leading whitespace; nulls are treated as white space
+			while (p < pLineEnd && (*p==' ' || *p=='\t' || *p=='\0'))
+				p++;
+			if (p == pLineEnd)
+				break;
+
+			if (*p=='"' || *p=='\'')
+			{
+				p = ParseCopiedField(p, pLineEnd, bEOF);
+				continue;
+			}
+
+			const char* pDelimiter = FindDelimiterOrNull(p, pLineEnd);
+			if (pDelimiter != pLineEnd && *pDelimiter == '\0')
+			{
+				// Embedded nulls are dropped, so the field must be copied.
+				p = ParseCopiedField(p, pLineEnd, bEOF);
+				continue;
+			}
+
+			// Point straight at the field, less trailing whitespace.
+			const char* pFieldEnd = pDelimiter;
+			while (pFieldEnd != p && isspace((unsigned char)pFieldEnd[-1]))
+				pFieldEnd--;
+			Field field;
+			field.ptr = p;
+			field.len = int(pFieldEnd - p);
+			m_vFields.push_back(field);
+
+			p = (pDelimiter == pLineEnd) ? pLineEnd : pDelimiter + 1;
+		}
+
+		return m_vFields.size()!=0;
 	}
-	void ReadCSV::ReOpen()
+
+	int ReadCSV::GetAsInt(unsigned nWhich) const
 	{
-		m_file.Close();
-		Open(m_strFile);
+		if (nWhich>=m_vFields.size())
+		{
+			assert(false);
+			return 0;
+		}
+		const char* p = m_vFields[nWhich].ptr;
+		const char* pEnd = p + m_vFields[nWhich].len;
+
+		while (p < pEnd && isspace((unsigned char)*p))
+			p++;
+		bool bNegative = false;
+		if (p < pEnd && (*p=='-' || *p=='+'))
+		{
+			bNegative = (*p=='-');
+			p++;
+		}
+		unsigned int value = 0;
+		for (; p < pEnd && *p>='0' && *p<='9'; p++)
+			value = value * 10 + (*p - '0');
+		return bNegative ? -int(value) : int(value);
 	}
 
+	double ReadCSV::GetAsDouble(unsigned nWhich) const
+	{
+		if (nWhich>=m_vFields.size())
+		{
+			assert(false);
+			return 0.0;
+		}
+		const char* pStart = m_vFields[nWhich].ptr;
+		const char* pEnd = pStart + m_vFields[nWhich].len;
+		const char* p = pStart;
+
+		// Plain decimals with at most 15 significant digits are exact as
+		// mantissa / 10^scale, since both are exactly representable and the
+		// division is correctly rounded.  Anything else goes to atof().
+		static const double powersOf10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		const int maxScale = sizeof(powersOf10) / sizeof(powersOf10[0]) - 1;
+
+		while (p < pEnd && isspace((unsigned char)*p))
+			p++;
+		bool bNegative = false;
+		if (p < pEnd && (*p=='-' || *p=='+'))
+		{
+			bNegative = (*p=='-');
+			p++;
+		}
+		__uint64 mantissa = 0;
+		int nDigits = 0;
+		int nSignificant = 0;
+		int scale = 0;
+		bool bPoint = false;
+		for (; p < pEnd; p++)
+		{
+			if (*p>='0' && *p<='9')
+			{
+				if (nSignificant <= 15)
+					mantissa = mantissa * 10 + (*p - '0');
+				nDigits++;
+				if (mantissa != 0)
+					nSignificant++;
+				if (bPoint)
+					scale++;
+			}
+			else if (*p=='.' && !bPoint)
+				bPoint = true;
+			else
+				break;
+		}
+		if (p == pEnd && nDigits != 0 && nSignificant <= 15 && scale <= maxScale)
+		{
+			double value = double(mantissa) / powersOf10[scale];
+			return bNegative ? -value : value;
+		}
+
+		// Exponents, long mantissas and trailing text
+		char buf[64];
+		size_t len = pEnd - pStart;
+		if (len < sizeof(buf))
+		{
+			memcpy(buf, pStart, len);
+			buf[len] = 0;
+			return atof(buf);
+		}
+		return atof(GetValue(nWhich).c_str());
+	}
 }
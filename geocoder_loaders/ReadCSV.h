@@ -1,48 +1,106 @@
 #ifndef __READCSV_H__
 #define __READCSV_H__
 
-#include "../global/file.h"
+#include "../global/TsString.h"
+#include "../global/Basics.h"
 #include <vector>
+#include <assert.h>
 
-namespace PortfolioExplorer 
+namespace PortfolioExplorer
 {
+	// Reads a comma-separated file through a memory-mapped view.
+	// Fields are returned as pointer/length pairs into the view, so
+	// unquoted fields are never copied; quoted fields are unescaped
+	// into a per-record scratch buffer.  Records are single lines.
 	class ReadCSV
 	{
-		File m_file;
-		bool m_bIsEOF;
-
-		char m_pCurrentBuffer[0x10000];
-		const char * m_pCurrentBufferPos;
-		const char * m_pCurrentBufferEnd;
-
-		inline bool ReadBuffer();
+	public:
+		// A field of the current record.  Valid until the next ReadRecord().
+		struct Field {
+			const char* ptr;
+			int len;
+		};
 
-		// returns NULL for no more on this line (or file)
-		bool GetNextField(TsString & strRet);
-		std::vector<TsString> m_vValues;
-		TsString m_strFile;
+		ReadCSV();
+		~ReadCSV();
 
-	public:
-		inline ReadCSV()
-			: m_pCurrentBufferPos(m_pCurrentBuffer+sizeof(m_pCurrentBuffer))
-			, m_pCurrentBufferEnd(m_pCurrentBuffer+sizeof(m_pCurrentBuffer))
-			, m_bIsEOF(false)
-		{}
+		// Throws TsString if the file cannot be opened.
 		void Open(TsString strFile);
 		void ReOpen();
-		
+		void Close();
+
+		// Continue reading at a byte offset that starts a record, as
+		// returned earlier by GetFilePosition().
+		void Seek(__int64 offset);
+
+		// Map views of this size from now on.  Readers that each cover a
+		// part of a file use smaller views than the default 64MB.
+		void SetViewSize(size_t nViewSize) { m_nDefaultViewSize = nViewSize; }
+
 		// returns false when done
 		bool ReadRecord();
-		size_t GetNumValues() const { return m_vValues.size(); }
+		size_t GetNumValues() const { return m_vFields.size(); }
+		const Field& GetField(unsigned nWhich) const
+		{
+			assert(nWhich<m_vFields.size());
+			return m_vFields[nWhich];
+		}
 		TsString GetValue(unsigned nWhich) const
 		{
-			if (nWhich>=m_vValues.size())
+			if (nWhich>=m_vFields.size())
 			{
 				assert(false);
 				return TsString();
 			}
-			return m_vValues[nWhich];
+			return TsString(m_vFields[nWhich].ptr, m_vFields[nWhich].len);
 		}
+
+		// Numeric conversions done in place, equivalent to atol()/atof()
+		// on the field text.
+		int GetAsInt(unsigned nWhich) const;
+		double GetAsDouble(unsigned nWhich) const;
+
+		// Size of the input file, and how far into it we have read.
+		__int64 GetFileSize() const { return m_nFileSize; }
+		__int64 GetFilePosition() const { return m_nViewOffset + (m_pPos - m_pView); }
+		const TsString& GetFileName() const { return m_strFile; }
+
+	private:
+		// Map a view of the file starting at the given offset (rounded down
+		// to the mapping granularity) of at least the given size.
+		void MapView(__int64 offset, size_t minSize);
+		void UnmapView();
+
+		// Parse a field that must be unescaped into the scratch buffer.
+		const char* ParseCopiedField(const char* p, const char* pEnd, bool bEOF);
+
+		TsString m_strFile;
+		__int64 m_nFileSize;
+
+#if defined(WIN32)
+		HANDLE m_hFile;
+		HANDLE m_hMapping;
+#else
+		int m_nFd;
+#endif
+
+		// Size of the views mapped
+		size_t m_nDefaultViewSize;
+
+		// The current view, and our position in it.
+		const char* m_pView;
+		size_t m_nViewSize;
+		__int64 m_nViewOffset;
+		const char* m_pPos;
+		const char* m_pViewEnd;
+
+		std::vector<Field> m_vFields;
+		std::vector<char> m_vScratch;
+		size_t m_nScratchUsed;
+
+		// not implemented
+		ReadCSV(const ReadCSV&);
+		ReadCSV& operator=(const ReadCSV&);
 	};
 }
 #endif //__READCSV_H__
@@ -39,53 +39,282 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GeoLoadStreetName.h"
 #include "GeoLoadStreetNameSoundex.h"
 #include "GeoLoadStreetSegment.h"
+#include "GeoLoadSynthetic.h"
+#include "ReadCSV.h"
+#include "../geocommon/GeoChecksum.h"
 
 #include "../geocoder/GeocoderVersion.h"
+#include "../geocoder/GeoDataVersion.h"
 
 using namespace PortfolioExplorer;
 
+// Loader names, in the order "All" runs them.
+static const char* const loaderNames[] = {
+	"CitySoundex",
+	"CityStatePostcode",
+	"CityStatePostcodeFaIndex",
+	"Coordinate",
+	"PostcodeAlias",
+	"PostcodeCentroid",
+	"StreetIntersectionSoundex",
+	"StreetName",
+	"StreetNameSoundex",
+	"StreetSegment"
+};
+static const int nbrLoaderNames = sizeof(loaderNames) / sizeof(loaderNames[0]);
+
+// Addresses in each workload of the synthetic dataset
+static const int SyntheticWorkloadSize = 1000;
+
+///////////////////////////////////////////////////////////////////////////////
+// Create the loader of the given name.
+// Return value:
+//	GeoLoadBase*	new loader, or NULL if the name is unknown
+///////////////////////////////////////////////////////////////////////////////
+static GeoLoadBase* CreateLoader(const char* name)
+{
+	if (_stricmp(name, "CitySoundex")==0)
+		return new GeoLoadCitySoundex;
+	else if (_stricmp(name, "CityStatePostcode")==0)
+		return new GeoLoadCityStatePostcode;
+	else if (_stricmp(name, "CityStatePostcodeFaIndex")==0)
+		return new GeoLoadCityStatePostcodeFaIndex;
+	else if (_stricmp(name, "Coordinate")==0)
+		return new GeoLoadCoordinate;
+	else if (_stricmp(name, "PostcodeAlias")==0)
+		return new GeoLoadPostcodeAlias;
+	else if (_stricmp(name, "PostcodeCentroid")==0)
+		return new GeoLoadPostcodeCentroid;
+	else if (_stricmp(name, "StreetIntersectionSoundex")==0)
+		return new GeoLoadStreetIntersectionSoundex;
+	else if (_stricmp(name, "StreetName")==0)
+		return new GeoLoadStreetName;
+	else if (_stricmp(name, "StreetNameSoundex")==0)
+		return new GeoLoadStreetNameSoundex;
+	else if (_stricmp(name, "StreetSegment")==0)
+		return new GeoLoadStreetSegment;
+	return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Format a throughput in megabytes per second.
+///////////////////////////////////////////////////////////////////////////////
+static TsString FormatMBPerSec(__int64 bytes, DWORD ticks)
+{
+	if (ticks == 0) {
+		ticks = 1;
+	}
+	return FormatFloat(bytes / (1024.0 * 1024.0) / (ticks / 1000.0)) + " MB/s";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Measure the CSV reader alone: read every record of a file, converting 
+// every field to a number, the given number of times.
+///////////////////////////////////////////////////////////////////////////////
+static void RunReadBenchmark(const char* filename, int nbrPasses)
+{
+	if (nbrPasses < 1) {
+		throw TsString("Number of passes must be at least 1");
+	}
+	ReadCSV readCSV;
+	DWORD totalTicks = 0;
+	__int64 totalBytes = 0;
+	for (int pass = 0; pass < nbrPasses; pass++) {
+		DWORD startTicks = GetTickCount();
+		readCSV.Open(filename);
+		int nbrRecords = 0;
+		__int64 nbrFields = 0;
+		double checksum = 0;
+		while (readCSV.ReadRecord()) {
+			for (unsigned i = 0; i < readCSV.GetNumValues(); i++) {
+				checksum += readCSV.GetAsInt(i) + readCSV.GetAsDouble(i);
+			}
+			nbrFields += readCSV.GetNumValues();
+			nbrRecords++;
+		}
+		DWORD ticks = GetTickCount() - startTicks;
+		std::cout << "Pass " << (pass + 1) << ": " << nbrRecords << " records, " 
+			<< nbrFields << " fields in " << FormatFloat(ticks / 1000.0) << " sec, " 
+			<< FormatMBPerSec(readCSV.GetFileSize(), ticks) 
+			<< " (checksum " << FormatFloat(checksum) << ")\n";
+		totalTicks += ticks;
+		totalBytes += readCSV.GetFileSize();
+		readCSV.Close();
+	}
+	std::cout << "Average: " << FormatMBPerSec(totalBytes, totalTicks) << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write the data version to the version file, followed by the packed-format
+// flag if the output directory holds packed tables.
+///////////////////////////////////////////////////////////////////////////////
+static void WriteVersionFile(const TsString& outdir, bool packedOutput)
+{
+	TsString filename = outdir + "/" + GeoUtil::VERSION_FILE;
+	FILE* fp = fopen(filename.c_str(), "w");
+	if (fp == 0) {
+		throw TsString("Cannot open file " + filename + " for output");
+	}
+	if (packedOutput) {
+		fprintf(fp, "%d %s\n", GEODATA_VERSION, GeoUtil::PACKED_FORMAT_FLAG);
+	} else {
+		fprintf(fp, "%d\n", GEODATA_VERSION);
+	}
+	if (fclose(fp) != 0) {
+		throw TsString("Cannot write " + filename);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write the checksum manifest covering every file in the output directory.
+// Run after every other file has been written; the geocoder checks the
+// files against it when opened with a verify mode.
+///////////////////////////////////////////////////////////////////////////////
+static void WriteChecksumManifest(const TsString& outdir)
+{
+	DWORD startTicks = GetTickCount();
+	ChecksumManifest manifest;
+	TsString errorMsg;
+	if (
+		!manifest.Build(outdir, errorMsg) ||
+		!manifest.WriteToFile(outdir + "/" + GeoUtil::CHECKSUM_MANIFEST_FILE, errorMsg)
+	) {
+		throw errorMsg;
+	}
+	DWORD ticks = GetTickCount() - startTicks;
+	std::cout << "Checksums: " << manifest.GetFileCount() << " files in " 
+		<< FormatFloat(ticks / 1000.0) << " sec\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Build every table whose input file InDir/<LoaderName>.csv exists.
+// Loaders run one after another; Coordinate and StreetIntersectionSoundex
+// spread their own work across all processors.
+///////////////////////////////////////////////////////////////////////////////
+static void RunAllLoaders(const TsString& indir, const TsString& outdir, bool packedOutput)
+{
+	DWORD startTicks = GetTickCount();
+	int nbrBuilt = 0;
+	for (int i = 0; i < nbrLoaderNames; i++) {
+		TsString filename = indir + "/" + loaderNames[i] + ".csv";
+		if (GetFileAttributes(filename.c_str()) == INVALID_FILE_ATTRIBUTES) {
+			std::cout << loaderNames[i] << ": " << filename << " not found, skipped\n";
+			continue;
+		}
+		DWORD loaderTicks = GetTickCount();
+		std::auto_ptr<GeoLoadBase> pGeoLoad(CreateLoader(loaderNames[i]));
+		pGeoLoad->SetPackedOutput(packedOutput);
+		pGeoLoad->Open(filename.c_str(), outdir.c_str());
+		pGeoLoad->Process();
+		DWORD ticks = GetTickCount() - loaderTicks;
+		std::cout << loaderNames[i] << ": " << pGeoLoad->GetNumberOfOutputRecords() 
+			<< " records written in " << FormatFloat(ticks / 1000.0) << " sec, " 
+			<< FormatMBPerSec(pGeoLoad->GetInputSize(), ticks) << "\n";
+		nbrBuilt++;
+	}
+	if (nbrBuilt == 0) {
+		throw TsString("No loader input files found in ") + indir;
+	}
+	std::cout << nbrBuilt << " tables built in " << FormatFloat((GetTickCount() - startTicks) / 1000.0) << " sec\n";
+}
+
+// Create a directory unless it exists
+static void MakeDirectory(const TsString& dir)
+{
+	if (!CreateDirectory(dir.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+		throw TsString("Cannot create directory ") + dir;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Generate the synthetic benchmark dataset in WorkDir: the loader input in
+// WorkDir/input, the database built from it in WorkDir/database, and the
+// workloads in WorkDir/workloads.
+///////////////////////////////////////////////////////////////////////////////
+
+static void RunSynthetic(int nbrCities, const TsString& workdir, bool packedOutput)
+{
+	DWORD startTicks = GetTickCount();
+	GeoLoadSynthetic synthetic(nbrCities);
+	TsString indir = workdir + "/input";
+	TsString outdir = workdir + "/database";
+	TsString workloadDir = workdir + "/workloads";
+	MakeDirectory(workdir);
+	MakeDirectory(indir);
+	MakeDirectory(outdir);
+	MakeDirectory(workloadDir);
+
+	synthetic.WriteLoaderInput(indir);
+	std::cout << "Synthetic: " << synthetic.GetNbrCities() << " cities, " 
+		<< synthetic.GetNbrCityStatePostcodes() << " postal codes, " 
+		<< synthetic.GetNbrStreetNames() << " streets, " 
+		<< synthetic.GetNbrStreetSegments() << " segments, " 
+		<< synthetic.GetNbrCoordinates() << " coordinates in " 
+		<< FormatFloat((GetTickCount() - startTicks) / 1000.0) << " sec\n";
+
+	RunAllLoaders(indir, outdir, packedOutput);
+	WriteVersionFile(outdir, packedOutput);
+	WriteChecksumManifest(outdir);
+	synthetic.WriteWorkloads(workloadDir, SyntheticWorkloadSize);
+	std::cout << "Workloads: " << SyntheticWorkloadSize << " addresses each in " << workloadDir << "\n";
+}
+
 int main(int argc, char* argv[])
 {
 	std::cout << "PortfolioExplorer Loaders Version " << APP_VERSION << "\n";
 	try
 	{
+		// -packed writes StreetName, StreetSegment and Coordinate as packed tables.
+		bool packedOutput = false;
+		if (argc > 1 && _stricmp(argv[1], "-packed")==0) {
+			packedOutput = true;
+			argc--;
+			argv++;
+		}
+
 		if (argc!=4)
 			throw TsString("Incorrect number of command line arguments");
 
-		std::auto_ptr<GeoLoadBase> pGeoLoad;
-
-		if (_stricmp(argv[1], "CitySoundex")==0)
-			pGeoLoad.reset(new GeoLoadCitySoundex);
-		else if (_stricmp(argv[1], "CityStatePostcode")==0)
-			pGeoLoad.reset(new GeoLoadCityStatePostcode);
-		else if (_stricmp(argv[1], "CityStatePostcodeFaIndex")==0)
-			pGeoLoad.reset(new GeoLoadCityStatePostcodeFaIndex);
-		else if (_stricmp(argv[1], "Coordinate")==0)
-			pGeoLoad.reset(new GeoLoadCoordinate);
-		else if (_stricmp(argv[1], "PostcodeAlias")==0)
-			pGeoLoad.reset(new GeoLoadPostcodeAlias);
-		else if (_stricmp(argv[1], "PostcodeCentroid")==0)
-			pGeoLoad.reset(new GeoLoadPostcodeCentroid);
-		else if (_stricmp(argv[1], "StreetIntersectionSoundex")==0)
-			pGeoLoad.reset(new GeoLoadStreetIntersectionSoundex);
-		else if (_stricmp(argv[1], "StreetName")==0)
-			pGeoLoad.reset(new GeoLoadStreetName);
-		else if (_stricmp(argv[1], "StreetNameSoundex")==0)
-			pGeoLoad.reset(new GeoLoadStreetNameSoundex);
-		else if (_stricmp(argv[1], "StreetSegment")==0)
-			pGeoLoad.reset(new GeoLoadStreetSegment);
-		else if (pGeoLoad.get()==NULL)
+		if (_stricmp(argv[1], "All")==0) {
+			RunAllLoaders(argv[2], argv[3], packedOutput);
+			if (packedOutput) {
+				WriteVersionFile(argv[3], true);
+			}
+			WriteChecksumManifest(argv[3]);
+			return 0;
+		}
+		if (_stricmp(argv[1], "Synthetic")==0) {
+			RunSynthetic(atoi(argv[2]), argv[3], packedOutput);
+			return 0;
+		}
+		if (_stricmp(argv[1], "ReadBenchmark")==0) {
+			RunReadBenchmark(argv[2], atoi(argv[3]));
+			return 0;
+		}
+
+		std::auto_ptr<GeoLoadBase> pGeoLoad(CreateLoader(argv[1]));
+		if (pGeoLoad.get()==NULL)
 			throw TsString("Unknown LoaderName \"") + argv[1];
 		
+		DWORD startTicks = GetTickCount();
+		pGeoLoad->SetPackedOutput(packedOutput);
 		pGeoLoad->Open(argv[2], argv[3]);
 		pGeoLoad->Process();
-		std::cout << pGeoLoad->GetNumberOfOutputRecords() << " records written\n";
+		std::cout << pGeoLoad->GetNumberOfOutputRecords() << " records written, " 
+			<< FormatMBPerSec(pGeoLoad->GetInputSize(), GetTickCount() - startTicks) << "\n";
+		if (packedOutput) {
+			WriteVersionFile(argv[3], true);
+		}
+		WriteChecksumManifest(argv[3]);
 	}
 	catch (const TsString & strError)
 	{
 		std::cout << "There was an error: " << strError << "\n\n";
 		std::cout << "Usage:\n"
-			"	geocoder_loaders LoaderName InFile.csv OutDir\n"
+			"	geocoder_loaders [-packed] LoaderName InFile.csv OutDir\n"
+			"	geocoder_loaders [-packed] All InDir OutDir\n"
+			"	geocoder_loaders [-packed] Synthetic NbrCities WorkDir\n"
+			"	geocoder_loaders ReadBenchmark InFile.csv Passes\n"
 			"Where LoaderName is one of:\n"
 			"	CitySoundex\n"
 			"	CityStatePostcode\n"
@@ -96,10 +325,17 @@ int main(int argc, char* argv[])
 			"	StreetIntersectionSoundex\n"
 			"	StreetName\n"
 			"	StreetNameSoundex\n"
-			"	StreetSegment\n";
+			"	StreetSegment\n"
+			"All runs every loader whose input InDir/LoaderName.csv exists.\n"
+			"Synthetic generates a reproducible dataset of NbrCities made-up cities\n"
+			"(1 to 5000) in WorkDir/input, builds it into WorkDir/database and writes\n"
+			"the benchmark workloads for geobench to WorkDir/workloads.\n"
+			"ReadBenchmark measures CSV reading and field conversion in MB/s.\n"
+			"-packed writes StreetName, StreetSegment and Coordinate as packed tables,\n"
+			"which take more space but decode faster, and marks OutDir/Version.txt.\n"
+			"Every run rewrites OutDir/Checksums.txt, the checksums of all files in OutDir.\n";
 
 		return 1;
 	}
 	return 0;
 }
-
@@ -114,6 +114,7 @@ namespace PortfolioExplorer {
 	// Constructor/destructor
 	///////////////////////////////////////////////////////////////////////////
 	BitStreamRead::BitStreamRead(ByteReaderRef byteReader_) :
+		bitsConsumed(0),
 		byteReader(byteReader_)
 	{
 		bufferSize = DefaultBufferSize;
@@ -156,6 +157,7 @@ namespace PortfolioExplorer {
 			}
 			if (bitsRemain > 0) {
 				// Fill the buffer again.
+				bitsConsumed += current - startPtr;
 				int bytesRead = byteReader->Read(bufferSize, buffer);
 				current = startPtr;
 				endPtr = startPtr + bytesRead * 8;
@@ -180,6 +182,7 @@ namespace PortfolioExplorer {
 		assert(current == endPtr);
 
 		// Reload the buffer
+		bitsConsumed += current - startPtr;
 		current = startPtr;
 		int bytesRead = byteReader->Read(bufferSize, buffer);
 		endPtr = startPtr + bytesRead * 8;
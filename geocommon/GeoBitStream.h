@@ -99,6 +99,30 @@ namespace PortfolioExplorer {
 			}
 		}
 
+		///////////////////////////////////////////////////////////////////////////
+		// Look at the next N bits without consuming them.  Only bits already
+		// in the buffer are examined; call Skip() to consume them.
+		// Inputs:
+		//	int				nbrBits		The number of bits wanted, at most 32.
+		// Outputs:
+		//	unsigned int&	value		The bits, with the first bit read in the
+		//								most-significant of the nbrBits positions.
+		// Return value:
+		//	int			nbrBits if the bits were available, zero otherwise.
+		///////////////////////////////////////////////////////////////////////////
+		int PeekBits(int nbrBits, unsigned int& value) {
+			if (endPtr - current < nbrBits) {
+				return 0;
+			}
+			BitPtr ptr(current);
+			value = 0;
+			for (int i = 0; i < nbrBits; i++) {
+				value = (value << 1) | (int)*ptr;
+				++ptr;
+			}
+			return nbrBits;
+		}
+
 		///////////////////////////////////////////////////////////////////////////
 		// Read N bits into a signed integer.  If the MSB is set, then the
 		// value will be interpreted as a negative number and sign-extended.
@@ -169,6 +193,14 @@ namespace PortfolioExplorer {
 			return (__int64)byteReader->GetPosition() * 8 + (current - startPtr);
 		}
 
+		///////////////////////////////////////////////////////////////////////////
+		// Returns the number of bits passed over in the buffer since the
+		// stream was made, by reads and short skips.  For profiling.
+		///////////////////////////////////////////////////////////////////////////
+		__int64 GetBitsRead() const {
+			return bitsConsumed + (current - startPtr);
+		}
+
 		///////////////////////////////////////////////////////////////////////////
 		// Skip forward the given number of bits.
 		///////////////////////////////////////////////////////////////////////////
@@ -203,6 +235,7 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////
 		bool SyncReader() {
 			// Force buffer to be reloaded before next read
+			bitsConsumed += current - startPtr;
 			current = BitPtr(buffer, 0);
 			endPtr = current;
 			return true;
@@ -225,6 +258,9 @@ namespace PortfolioExplorer {
 		BitPtr current;
 		BitPtr endPtr;
 
+		// Bits passed over in buffers that have been reloaded
+		__int64 bitsConsumed;
+
 		// Object from which bytes are read
 		ByteReaderRef byteReader;
 
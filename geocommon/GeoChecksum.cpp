@@ -0,0 +1,555 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoChecksum.cpp:  Checksums of the database files.
+
+#ifdef WIN32
+#pragma warning(disable:4786)
+#endif
+
+#include "Geocoder_Headers.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "GeoChecksum.h"
+#include "GeoUtil.h"
+#include "../global/Filesys.h"
+#include "../global/Utility.h"
+
+#if defined(WIN32)
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////
+	// CRC32C (Castagnoli polynomial, reflected), computed eight bytes at a
+	// time with the "slicing-by-8" tables.  The tables are built during
+	// static initialization, before any thread can use them.
+	///////////////////////////////////////////////////////////////////////////
+	static unsigned int crcTables[8][256];
+
+	static struct CrcTableInit {
+		CrcTableInit() {
+			for (unsigned int i = 0; i < 256; i++) {
+				unsigned int crc = i;
+				for (int bit = 0; bit < 8; bit++) {
+					crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+				}
+				crcTables[0][i] = crc;
+			}
+			for (unsigned int i = 0; i < 256; i++) {
+				for (int slice = 1; slice < 8; slice++) {
+					unsigned int prev = crcTables[slice - 1][i];
+					crcTables[slice][i] = (prev >> 8) ^ crcTables[0][prev & 0xFF];
+				}
+			}
+		}
+	} crcTableInit;
+
+	unsigned int ChecksumManifest::Crc32c(const unsigned char* data, unsigned int size, unsigned int crc)
+	{
+		crc = ~crc;
+		while (size >= 8) {
+			unsigned int lo = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | (unsigned(data[3]) << 24));
+			unsigned int hi = data[4] | (data[5] << 8) | (data[6] << 16) | (unsigned(data[7]) << 24);
+			crc =
+				crcTables[7][lo & 0xFF] ^
+				crcTables[6][(lo >> 8) & 0xFF] ^
+				crcTables[5][(lo >> 16) & 0xFF] ^
+				crcTables[4][lo >> 24] ^
+				crcTables[3][hi & 0xFF] ^
+				crcTables[2][(hi >> 8) & 0xFF] ^
+				crcTables[1][(hi >> 16) & 0xFF] ^
+				crcTables[0][hi >> 24];
+			data += 8;
+			size -= 8;
+		}
+		while (size > 0) {
+			crc = (crc >> 8) ^ crcTables[0][(crc ^ *data) & 0xFF];
+			data++;
+			size--;
+		}
+		return ~crc;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Is the path a regular file?
+	///////////////////////////////////////////////////////////////////////////
+	static bool IsRegularFile(const TsString& path)
+	{
+#if defined(WIN32)
+		struct _stat st;
+		return _stat(path.c_str(), &st) == 0 && (st.st_mode & _S_IFREG) != 0;
+#else
+		struct stat st;
+		return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Read one group of a file and compute its CRC.
+	// Return value:
+	//	bool	false if the group cannot be read in full.
+	///////////////////////////////////////////////////////////////////////////
+	static bool ReadGroupCrc(
+		FILE* fp,
+		unsigned int fileSize,
+		unsigned int groupSize,
+		unsigned int group,
+		std::vector<unsigned char>& buffer,
+		unsigned int& crcReturn
+	) {
+		unsigned int pos = group * groupSize;
+		unsigned int count = JHMIN(groupSize, fileSize - pos);
+		buffer.resize(groupSize);
+		if (
+			fseek(fp, long(pos), SEEK_SET) != 0 ||
+			fread(&buffer[0], 1, count, fp) != count
+		) {
+			return false;
+		}
+		crcReturn = ChecksumManifest::Crc32c(&buffer[0], count);
+		return true;
+	}
+
+	// Number of groups in a file of the given size.
+	static unsigned int GroupCount(unsigned int fileSize, unsigned int groupSize)
+	{
+		return (fileSize + groupSize - 1) / groupSize;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Construction and destruction
+	///////////////////////////////////////////////////////////////////////////
+	ChecksumManifest::ChecksumManifest() :
+		groupSize(GeoUtil::ChecksumGroupSize)
+	{}
+
+	ChecksumManifest::~ChecksumManifest()
+	{}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Checksum every file of a database directory.
+	///////////////////////////////////////////////////////////////////////////
+	bool ChecksumManifest::Build(const TsString& dir, TsString& errorMsg)
+	{
+		errorMsg = "";
+		files.clear();
+		groupSize = GeoUtil::ChecksumGroupSize;
+
+		std::vector<TsString> paths = FileSys::ExpandWildcards(dir + "/*");
+		std::vector<unsigned char> buffer;
+		for (unsigned i = 0; i < paths.size(); i++) {
+			TsString::size_type slash = paths[i].find_last_of("/\\");
+			TsString name = slash == TsString::npos ? paths[i] : paths[i].substr(slash + 1);
+			if (
+				name == GeoUtil::CHECKSUM_MANIFEST_FILE ||
+				name == GeoUtil::DELTA_FILE ||
+				!IsRegularFile(paths[i])
+			) {
+				continue;
+			}
+
+			FILE* fp = fopen(paths[i].c_str(), "rb");
+			if (fp == 0) {
+				errorMsg = "Cannot open " + paths[i];
+				return false;
+			}
+			fseek(fp, 0, SEEK_END);
+			long size = ftell(fp);
+
+			FileEntry entry;
+			entry.name = name;
+			entry.size = unsigned(size);
+			unsigned int nbrGroups = GroupCount(entry.size, groupSize);
+			entry.crcs.resize(nbrGroups);
+			for (unsigned int group = 0; group < nbrGroups; group++) {
+				if (!ReadGroupCrc(fp, entry.size, groupSize, group, buffer, entry.crcs[group])) {
+					fclose(fp);
+					errorMsg = "Cannot read " + paths[i];
+					return false;
+				}
+			}
+			fclose(fp);
+			files.push_back(entry);
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Write the manifest file.
+	///////////////////////////////////////////////////////////////////////////
+	bool ChecksumManifest::WriteToFile(const TsString& filename, TsString& errorMsg) const
+	{
+		FILE* fp = fopen(filename.c_str(), "w");
+		if (fp == 0) {
+			errorMsg = "Cannot create checksum manifest '" + filename + "'";
+			return false;
+		}
+		fprintf(fp, "GEOCHECKSUM\t%d\t%u\n", int(Version), groupSize);
+		for (unsigned i = 0; i < files.size(); i++) {
+			fprintf(fp, "%s\t%u\t", files[i].name.c_str(), files[i].size);
+			for (unsigned group = 0; group < files[i].crcs.size(); group++) {
+				fprintf(fp, group == 0 ? "%08x" : " %08x", files[i].crcs[group]);
+			}
+			fputc('\n', fp);
+		}
+		bool ok = !ferror(fp);
+		ok = fclose(fp) == 0 && ok;
+		if (!ok) {
+			errorMsg = "Cannot write checksum manifest '" + filename + "'";
+		}
+		return ok;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Read the manifest file.
+	///////////////////////////////////////////////////////////////////////////
+	bool ChecksumManifest::LoadFromFile(const TsString& filename, TsString& errorMsg)
+	{
+		errorMsg = "";
+		files.clear();
+		std::ifstream fs(filename.c_str());
+		if (fs.fail()) {
+			errorMsg = "Cannot open checksum manifest '" + filename + "'";
+			return false;
+		}
+
+		bool haveHeader = false;
+		int lineNumber = 0;
+		std::string line;
+		while (std::getline(fs, line)) {
+			lineNumber++;
+			if (!line.empty() && line[line.size() - 1] == '\r') {
+				line.erase(line.size() - 1);
+			}
+			if (line.empty()) {
+				continue;
+			}
+
+			if (!haveHeader) {
+				int version;
+				unsigned int size;
+				char tag[16];
+				if (sscanf(line.c_str(), "%15s %d %u", tag, &version, &size) != 3 || strcmp(tag, "GEOCHECKSUM") != 0 || size == 0) {
+					errorMsg = "Checksum manifest '" + filename + "' does not start with a GEOCHECKSUM header";
+					return false;
+				}
+				if (version != Version) {
+					errorMsg = "Checksum manifest '" + filename + "' has version " + FormatInteger(version) +
+						", expected " + FormatInteger(int(Version));
+					return false;
+				}
+				groupSize = size;
+				haveHeader = true;
+				continue;
+			}
+
+			FileEntry entry;
+			std::string::size_type tab1 = line.find('\t');
+			std::string::size_type tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+			char* end;
+			if (tab2 != std::string::npos) {
+				entry.name = line.substr(0, tab1).c_str();
+				entry.size = unsigned(strtoul(line.c_str() + tab1 + 1, &end, 10));
+			}
+			if (tab2 == std::string::npos || end != line.c_str() + tab2) {
+				errorMsg = "Error on line " + FormatInteger(lineNumber) + " of checksum manifest '" + filename + "'";
+				return false;
+			}
+			const char* p = line.c_str() + tab2 + 1;
+			while (*p != 0) {
+				entry.crcs.push_back(unsigned(strtoul(p, &end, 16)));
+				if (end == p) {
+					break;
+				}
+				p = end;
+			}
+			if (*p != 0 || entry.crcs.size() != GroupCount(entry.size, groupSize)) {
+				errorMsg = "Error on line " + FormatInteger(lineNumber) + " of checksum manifest '" + filename + "'";
+				return false;
+			}
+			files.push_back(entry);
+		}
+
+		if (!haveHeader) {
+			errorMsg = "Checksum manifest '" + filename + "' does not start with a GEOCHECKSUM header";
+			return false;
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Work for one verification thread: a contiguous run of groups, in file
+	// order.  Each group is identified by its file and group index.
+	///////////////////////////////////////////////////////////////////////////
+	struct VerifyGroupRef {
+		int fileIdx;
+		unsigned int group;
+	};
+	struct VerifyTask {
+		const ChecksumManifest* manifest;
+		const TsString* dir;
+		const VerifyGroupRef* groups;
+		int nbrGroups;
+		// First failing group of this run, or -1
+		int failedGroup;
+		bool readError;
+	};
+
+	static void RunVerifyTask(VerifyTask& task)
+	{
+		task.failedGroup = -1;
+		task.readError = false;
+		std::vector<unsigned char> buffer;
+		FILE* fp = 0;
+		int openFileIdx = -1;
+		for (int i = 0; i < task.nbrGroups; i++) {
+			const VerifyGroupRef& ref = task.groups[i];
+			const ChecksumManifest::FileEntry& entry = task.manifest->GetFile(ref.fileIdx);
+			if (ref.fileIdx != openFileIdx) {
+				if (fp != 0) {
+					fclose(fp);
+				}
+				fp = fopen((*task.dir + "/" + entry.name).c_str(), "rb");
+				openFileIdx = ref.fileIdx;
+			}
+			unsigned int crc;
+			if (fp == 0 || !ReadGroupCrc(fp, entry.size, task.manifest->GetGroupSize(), ref.group, buffer, crc)) {
+				task.failedGroup = i;
+				task.readError = true;
+				break;
+			}
+			if (crc != entry.crcs[ref.group]) {
+				task.failedGroup = i;
+				break;
+			}
+		}
+		if (fp != 0) {
+			fclose(fp);
+		}
+	}
+
+#if defined(WIN32)
+	static unsigned __stdcall VerifyThreadProc(void* arg)
+	{
+		RunVerifyTask(*(VerifyTask*)arg);
+		return 0;
+	}
+#else
+	static void* VerifyThreadProc(void* arg)
+	{
+		RunVerifyTask(*(VerifyTask*)arg);
+		return 0;
+	}
+#endif
+
+	int ChecksumManifest::GetProcessorCount()
+	{
+#if defined(WIN32)
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		return JHMAX(int(systemInfo.dwNumberOfProcessors), 1);
+#else
+		return JHMAX(int(sysconf(_SC_NPROCESSORS_ONLN)), 1);
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Check the files of a database directory against the manifest.
+	///////////////////////////////////////////////////////////////////////////
+	bool ChecksumManifest::Verify(
+		const TsString& dir,
+		int nbrThreads,
+		const std::set<TsString>& skipFiles,
+		TsString& errorMsg
+	) const {
+		errorMsg = "";
+
+		// Sizes are checked up front: a truncated file is the common case
+		// and needs no reading.
+		std::vector<VerifyGroupRef> groups;
+		for (unsigned fileIdx = 0; fileIdx < files.size(); fileIdx++) {
+			const FileEntry& entry = files[fileIdx];
+			if (skipFiles.find(entry.name) != skipFiles.end()) {
+				continue;
+			}
+			TsString path = dir + "/" + entry.name;
+			FILE* fp = fopen(path.c_str(), "rb");
+			if (fp == 0) {
+				errorMsg = "Cannot open " + path;
+				return false;
+			}
+			fseek(fp, 0, SEEK_END);
+			long size = ftell(fp);
+			fclose(fp);
+			if (unsigned(size) != entry.size) {
+				errorMsg = "Size of " + path + " is " + FormatInteger(unsigned(size)) +
+					" bytes, expected " + FormatInteger(entry.size);
+				return false;
+			}
+			for (unsigned int group = 0; group < entry.crcs.size(); group++) {
+				VerifyGroupRef ref;
+				ref.fileIdx = int(fileIdx);
+				ref.group = group;
+				groups.push_back(ref);
+			}
+		}
+		if (groups.empty()) {
+			return true;
+		}
+
+		if (nbrThreads <= 0) {
+			nbrThreads = GetProcessorCount();
+		}
+		nbrThreads = JHMIN(nbrThreads, int(groups.size()));
+
+		std::vector<VerifyTask> tasks(nbrThreads);
+		int groupsPerThread = (int(groups.size()) + nbrThreads - 1) / nbrThreads;
+		for (int t = 0; t < nbrThreads; t++) {
+			int first = JHMIN(t * groupsPerThread, int(groups.size()));
+			tasks[t].manifest = this;
+			tasks[t].dir = &dir;
+			tasks[t].groups = &groups[0] + first;
+			tasks[t].nbrGroups = JHMIN(groupsPerThread, int(groups.size()) - first);
+			tasks[t].failedGroup = -1;
+			tasks[t].readError = false;
+		}
+
+		// The calling thread takes the first run itself.
+#if defined(WIN32)
+		std::vector<HANDLE> threads;
+		for (int t = 1; t < nbrThreads; t++) {
+			HANDLE h = (HANDLE)_beginthreadex(0, 0, VerifyThreadProc, &tasks[t], 0, 0);
+			if (h == 0) {
+				RunVerifyTask(tasks[t]);
+			} else {
+				threads.push_back(h);
+			}
+		}
+		RunVerifyTask(tasks[0]);
+		for (unsigned i = 0; i < threads.size(); i++) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+#else
+		std::vector<pthread_t> threads;
+		std::vector<int> started(nbrThreads, 0);
+		threads.resize(nbrThreads);
+		for (int t = 1; t < nbrThreads; t++) {
+			if (pthread_create(&threads[t], 0, VerifyThreadProc, &tasks[t]) == 0) {
+				started[t] = 1;
+			} else {
+				RunVerifyTask(tasks[t]);
+			}
+		}
+		RunVerifyTask(tasks[0]);
+		for (int t = 1; t < nbrThreads; t++) {
+			if (started[t]) {
+				pthread_join(threads[t], 0);
+			}
+		}
+#endif
+
+		for (int t = 0; t < nbrThreads; t++) {
+			if (tasks[t].failedGroup >= 0) {
+				const VerifyGroupRef& ref = tasks[t].groups[tasks[t].failedGroup];
+				const FileEntry& entry = files[ref.fileIdx];
+				errorMsg = (tasks[t].readError ? "Cannot read " : "Checksum mismatch in ") +
+					dir + "/" + entry.name + " at byte " + FormatInteger(ref.group * groupSize);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Look up the entry of a file.
+	///////////////////////////////////////////////////////////////////////////
+	const ChecksumManifest::FileEntry* ChecksumManifest::FindFile(const TsString& name) const
+	{
+		for (unsigned i = 0; i < files.size(); i++) {
+			if (files[i].name == name) {
+				return &files[i];
+			}
+		}
+		return 0;
+	}
+
+	__int64 ChecksumManifest::GetTotalSize() const
+	{
+		__int64 total = 0;
+		for (unsigned i = 0; i < files.size(); i++) {
+			total += files[i].size;
+		}
+		return total;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// LazyChecksum
+	///////////////////////////////////////////////////////////////////////////
+	LazyChecksum::LazyChecksum(
+		const ChecksumManifest::FileEntry& entry,
+		unsigned int groupSize_,
+		ChecksumErrorListener* listener_
+	) :
+		name(entry.name),
+		size(entry.size),
+		groupSize(groupSize_),
+		crcs(entry.crcs),
+		state(entry.crcs.size(), (unsigned char)GroupUnchecked),
+		listener(listener_)
+	{}
+
+	LazyChecksum::~LazyChecksum()
+	{}
+
+	bool LazyChecksum::VerifyGroup(FILE* fp, unsigned int group)
+	{
+		if (state[group] == GroupFailed) {
+			return false;
+		}
+		long pos = ftell(fp);
+		unsigned int crc;
+		bool ok = ReadGroupCrc(fp, size, groupSize, group, buffer, crc) && crc == crcs[group];
+		fseek(fp, pos, SEEK_SET);
+		if (ok) {
+			state[group] = GroupVerified;
+		} else {
+			state[group] = GroupFailed;
+			if (listener != 0) {
+				listener->ChecksumError("Checksum mismatch in " + name + " at byte " + FormatInteger(group * groupSize));
+			}
+		}
+		return ok;
+	}
+
+}
@@ -0,0 +1,217 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoChecksum.h:  Checksums of the database files.
+//
+// Every file of a database directory is divided into groups of
+// GeoUtil::ChecksumGroupSize bytes, and the CRC32C of each group is kept
+// in a manifest (GeoUtil::CHECKSUM_MANIFEST_FILE) written by the loaders.
+// The manifest is a text file:
+//
+//	GEOCHECKSUM <version> <group size>
+//	<filename>	<file size>	<group CRC> <group CRC> ...
+//
+// with one line per file and the CRCs in hexadecimal.  The manifest and
+// the delta file are not covered.  A database can be verified in full,
+// spread over several threads, or a group at a time as it is first read
+// (see LazyChecksum).
+
+#ifndef INCL_GEOCHECKSUM_H
+#define INCL_GEOCHECKSUM_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "Geocoder_DllExport.h"
+#include "../global/TsString.h"
+#include "../global/RefPtr.h"
+#include <stdio.h>
+#include <set>
+#include <vector>
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////
+	// The checksums of the files of a database directory.
+	///////////////////////////////////////////////////////////////////////////
+	class ChecksumManifest : public VRefCount {
+	public:
+		// Version of the manifest format.
+		enum { Version = 1 };
+
+		// Checksums of one file
+		struct FileEntry {
+			TsString name;					// Name within the database directory
+			unsigned int size;				// Size in bytes
+			std::vector<unsigned int> crcs;	// CRC32C of each group
+		};
+
+		ChecksumManifest();
+		virtual ~ChecksumManifest();
+
+		///////////////////////////////////////////////////////////////////////
+		// Compute the CRC32C of a buffer.
+		// Inputs:
+		//	const unsigned char*	data	The bytes
+		//	unsigned int			size	Number of bytes
+		//	unsigned int			crc		CRC of the preceding bytes, to
+		//									continue a running CRC
+		// Return value:
+		//	unsigned int	The CRC.
+		///////////////////////////////////////////////////////////////////////
+		static unsigned int Crc32c(const unsigned char* data, unsigned int size, unsigned int crc = 0);
+
+		///////////////////////////////////////////////////////////////////////
+		// Checksum every file of a database directory, except the manifest
+		// and delta files.
+		// Inputs:
+		//	const TsString&	dir			The database directory
+		// Outputs:
+		//	TsString&		errorMsg	If false is returned, this is the error message.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool Build(const TsString& dir, TsString& errorMsg);
+
+		///////////////////////////////////////////////////////////////////////
+		// Write and read the manifest file.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool WriteToFile(const TsString& filename, TsString& errorMsg) const;
+		bool LoadFromFile(const TsString& filename, TsString& errorMsg);
+
+		///////////////////////////////////////////////////////////////////////
+		// Check the files of a database directory against the manifest.
+		// The groups are divided among the threads in contiguous runs, so
+		// that each thread reads its part of the files sequentially.
+		// Inputs:
+		//	const TsString&				dir			The database directory
+		//	int							nbrThreads	Number of threads to use;
+		//											0 for one per processor
+		//	const std::set<TsString>&	skipFiles	Files not to check here
+		// Outputs:
+		//	TsString&		errorMsg	If false is returned, this is the error message.
+		// Return value:
+		//	bool		true if every file matches, false otherwise.
+		///////////////////////////////////////////////////////////////////////
+		bool Verify(
+			const TsString& dir,
+			int nbrThreads,
+			const std::set<TsString>& skipFiles,
+			TsString& errorMsg
+		) const;
+
+		///////////////////////////////////////////////////////////////////////
+		// Look up the entry of a file, or return 0 if it is not covered.
+		///////////////////////////////////////////////////////////////////////
+		const FileEntry* FindFile(const TsString& name) const;
+
+		unsigned int GetGroupSize() const { return groupSize; }
+		int GetFileCount() const { return int(files.size()); }
+		const FileEntry& GetFile(int idx) const { return files[idx]; }
+
+		// Total size in bytes of the files covered.
+		__int64 GetTotalSize() const;
+
+		// Number of processors, the default thread count for Verify().
+		static int GetProcessorCount();
+
+	private:
+		unsigned int groupSize;
+		std::vector<FileEntry> files;
+	};
+	typedef refcnt_ptr<ChecksumManifest> ChecksumManifestRef;
+
+	///////////////////////////////////////////////////////////////////////////
+	// Receives the checksum failures found by LazyChecksum.
+	///////////////////////////////////////////////////////////////////////////
+	class ChecksumErrorListener {
+	public:
+		virtual ~ChecksumErrorListener() {}
+		virtual void ChecksumError(const TsString& msg) = 0;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Checks the groups of one open file as they are first read.  A group
+	// that does not match stays failed, and reads from it fail.
+	///////////////////////////////////////////////////////////////////////////
+	class LazyChecksum : public VRefCount {
+	public:
+		///////////////////////////////////////////////////////////////////////
+		// Inputs:
+		//	const ChecksumManifest::FileEntry&	entry		The file's checksums
+		//	unsigned int						groupSize	Bytes per group
+		//	ChecksumErrorListener*				listener	Told of each failed
+		//													group; may be 0
+		///////////////////////////////////////////////////////////////////////
+		LazyChecksum(
+			const ChecksumManifest::FileEntry& entry,
+			unsigned int groupSize,
+			ChecksumErrorListener* listener
+		);
+		virtual ~LazyChecksum();
+
+		///////////////////////////////////////////////////////////////////////
+		// Check the groups holding a range of bytes of the file, if they have
+		// not been checked yet.  The file position is left unchanged.
+		// Inputs:
+		//	FILE*		fp		The open file
+		//	int			pos		Start of the range
+		//	int			size	Number of bytes in the range
+		// Return value:
+		//	bool		true if every group of the range matches.
+		///////////////////////////////////////////////////////////////////////
+		bool VerifyRange(FILE* fp, int pos, int size) {
+			if (size <= 0 || pos < 0) {
+				return true;
+			}
+			unsigned int firstGroup = unsigned(pos) / groupSize;
+			unsigned int lastGroup = (unsigned(pos) + unsigned(size) - 1) / groupSize;
+			for (unsigned int group = firstGroup; group <= lastGroup && group < state.size(); group++) {
+				if (state[group] != GroupVerified && !VerifyGroup(fp, group)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		enum { GroupUnchecked, GroupVerified, GroupFailed };
+
+		// Read and check one group.
+		bool VerifyGroup(FILE* fp, unsigned int group);
+
+		TsString name;
+		unsigned int size;
+		unsigned int groupSize;
+		std::vector<unsigned int> crcs;
+		std::vector<unsigned char> state;
+		std::vector<unsigned char> buffer;
+		ChecksumErrorListener* listener;
+	};
+	typedef refcnt_ptr<LazyChecksum> LazyChecksumRef;
+
+}
+
+#endif
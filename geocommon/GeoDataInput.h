@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <stdio.h>
 #include "GeoAbstractByteIO.h"
 #include "GeoUtil.h"
+#include "GeoChecksum.h"
 
 namespace PortfolioExplorer {
 
@@ -39,8 +40,13 @@ namespace PortfolioExplorer {
 		FileByteReader() : fp(0) {}
 		~FileByteReader() {}
 		void SetFile(FILE* fp_) { fp = fp_; }
+		// Check bytes against their checksums as they are first read; 0 for none.
+		void SetChecksums(const LazyChecksumRef& checksums_) { checksums = checksums_; }
 		// Returns the number of bytes actually read
 		virtual int Read(int size, unsigned char* buffer) {
+			if (checksums.get() != 0 && !checksums->VerifyRange(fp, int(ftell(fp)), size)) {
+				return 0;
+			}
 			return int(fread(buffer, 1, size, fp));
 		}
 		// Returns true on success, false on failure
@@ -49,6 +55,7 @@ namespace PortfolioExplorer {
 		virtual int GetPosition() { return ftell(fp); }
 	private:
 		FILE* fp;
+		LazyChecksumRef checksums;
 	};
 	typedef refcnt_ptr<FileByteReader> FileByteReaderRef;
 
@@ -65,6 +72,10 @@ namespace PortfolioExplorer {
 			reader(new FileByteReader),
 			bitStream(reader.get())
 		{
+			// Room for the longest string field, so decoding never grows them.
+			tmpVec1.reserve(TmpVecReserve);
+			tmpVec2.reserve(TmpVecReserve);
+			tmpVec3.reserve(TmpVecReserve);
 		}
 		~DataInput() { Close(); }
 		bool IsOpen() { return fp != 0; }
@@ -89,12 +100,17 @@ namespace PortfolioExplorer {
 		void Close() {
 			if (IsOpen()) {
 				reader->SetFile(0);
+				reader->SetChecksums(0);
 				fclose(fp);
 			}
 			fp = 0;
 			filename = "";
 		}
 
+		// Verify each group of the file against its checksum when it is first
+		// read.  Reads from a group that does not match fail.
+		void SetChecksums(const LazyChecksumRef& checksums) { reader->SetChecksums(checksums); }
+
 		// Use for bit-oriented I/O
 		BitStreamRead& GetBitStream() { return bitStream; }
 
@@ -492,6 +508,8 @@ namespace PortfolioExplorer {
 		BitStreamRead bitStream;
 		int fileSize;
 		GeoUtil::VarLengthBufToInt varLengthBufToInt;
+		// Scratch space for the string decoders, reused from call to call
+		enum { TmpVecReserve = 256 };
 		std::vector<int> tmpVec1;
 		std::vector<int> tmpVec2;
 		std::vector<int> tmpVec3;
@@ -49,16 +49,31 @@ namespace PortfolioExplorer {
 	// object being coded, and will be the "key" of the count table.
 	// 
 	// The type T must support the comparison operator <
+	//
+	// Codes can be made in two ways.  MakeCodes() builds the original code
+	// tree from the counts; databases built before code-length tables were
+	// introduced are coded this way.  MakeCanonicalCodes() computes
+	// length-limited code lengths and assigns canonical codes: within each
+	// length, codes are consecutive in value order.  A canonical code is
+	// fully described by its code lengths (GetCodeLengths/SetCodeLengths),
+	// and is decoded with lookup tables rather than by walking a tree.
 	///////////////////////////////////////////////////////////////////////////////
 	template <class T, class CMP > class HuffmanCoder : public VRefCount {
 	public:
+		// Longest code produced by MakeCanonicalCodes(), and the number of
+		// bits resolved by a single table lookup when decoding.
+		enum { MaxCanonicalCodeLength = 24, LookupBits = 8 };
+
 		// Constructor/destructor
 		HuffmanCoder(CMP cmp_ = CMP()) : 
 			codeTree(0), 
 			valueMap(cmp_),
 			maxCodeLength(0), 
 			decodePtr(0),
-			cmp(cmp_)
+			cmp(cmp_),
+			canonical(false),
+			decodeCode(0),
+			decodeLength(0)
 		{}
 		~HuffmanCoder() {}
 
@@ -67,6 +82,9 @@ namespace PortfolioExplorer {
 			valueMap.clear();
 			codeTree = 0;
 			freqTable.clear();
+			canonical = false;
+			canonicalValues.clear();
+			maxCodeLength = 0;
 		}			
 
 		// Add another entry to the code count table
@@ -75,6 +93,40 @@ namespace PortfolioExplorer {
 		// Generate codes from the count table
 		void MakeCodes();
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Generate canonical codes from the count table.  The result depends
+		// only on the counts and values, not on the order of entry.
+		// Inputs:
+		//	int		maxLength	The longest code allowed, at most MaxCanonicalCodeLength.
+		///////////////////////////////////////////////////////////////////////////////
+		void MakeCanonicalCodes(int maxLength = MaxCanonicalCodeLength);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Replace the table with a canonical code having the given code lengths.
+		// Inputs:
+		//	const std::vector<T>&	values		The values
+		//	const std::vector<int>&	lengths		Code length of each value
+		// Return value:
+		//	bool		true on success, false if the values are not unique or the
+		//				lengths do not form a complete prefix code.
+		///////////////////////////////////////////////////////////////////////////////
+		bool SetCodeLengths(
+			const std::vector<T>& values,
+			const std::vector<int>& lengths
+		);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Get the values and their code lengths in canonical order (by length,
+		// then value).  Only valid after MakeCanonicalCodes() or SetCodeLengths().
+		///////////////////////////////////////////////////////////////////////////////
+		void GetCodeLengths(
+			std::vector<T>& valuesReturn,
+			std::vector<int>& lengthsReturn
+		) const;
+
+		// True if the codes are canonical.
+		bool IsCanonical() const { return canonical; }
+
 		// Add entries using the given frequency table.
 		// Type parameter of the freq table must match that of Huffman table.
 		void AddEntries(const FreqTable<T>& counts);
@@ -127,19 +179,25 @@ namespace PortfolioExplorer {
 		//	const T*&		valueReturn		If the return code is true, then the code is 
 		// Return value:
 		//	bool		true if a valid value was read, false o/w
+		// ReadCode() keeps no decoding state in the coder, so several threads
+		// may read through one coder at once.
 		///////////////////////////////////////////////////////////////////////////////
 		bool ReadCode(
 			BitStreamRead& bitStream,
 			const T*& valueReturn
-		) {
-			int bit;
-			bool finished = StartDecode(valueReturn);
-			while (!finished) {
+		) const {
+			if (canonical) {
+				return ReadCanonicalCode(bitStream, valueReturn);
+			}
+			const Entry* node = codeTree.get();
+			while (node->IsInterior()) {
+				int bit;
 				if (!bitStream.NextBit(bit)) {
 					return false;
 				}
-				finished = Decode(bit, valueReturn);
+				node = (bit ? node->right.get() : node->left.get());
 			}
+			valueReturn = &node->value;
 			return true;
 		}
 
@@ -154,6 +212,12 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////////
 		bool StartDecode(const T*& valueReturn) 
 		{ 
+			if (canonical) {
+				decodeCode = 0;
+				decodeLength = 0;
+				valueReturn = &canonicalValues[0];
+				return maxCodeLength == 0;
+			}
 			decodePtr = codeTree.get();
 			valueReturn = &decodePtr->value;
 			return decodePtr->left == 0;
@@ -175,6 +239,16 @@ namespace PortfolioExplorer {
 			int bit,
 			const T*& valueReturn
 		) {
+			if (canonical) {
+				decodeCode = (decodeCode << 1) | bit;
+				decodeLength++;
+				unsigned int offset = decodeCode - firstCode[decodeLength];
+				if (offset < (unsigned int)lengthCount[decodeLength]) {
+					valueReturn = &canonicalValues[firstIndex[decodeLength] + offset];
+					return true;
+				}
+				return false;
+			}
 			decodePtr = (bit ? decodePtr->right.get() : decodePtr->left.get());
 			if (decodePtr->IsLeaf()) {
 				valueReturn = &decodePtr->value;
@@ -186,6 +260,52 @@ namespace PortfolioExplorer {
 
 
 	private:
+		///////////////////////////////////////////////////////////////////////////////
+		// Read a canonical code, using the lookup table for short codes and
+		// the per-length tables for the rest.
+		///////////////////////////////////////////////////////////////////////////////
+		bool ReadCanonicalCode(
+			BitStreamRead& bitStream,
+			const T*& valueReturn
+		) const {
+			if (maxCodeLength == 0) {
+				valueReturn = &canonicalValues[0];
+				return true;
+			}
+			unsigned int code = 0;
+			int length = 0;
+			if (bitStream.PeekBits(LookupBits, code) == LookupBits) {
+				const LookupEntry& entry = lookup[code];
+				if (entry.length != 0) {
+					bitStream.Skip(entry.length);
+					valueReturn = &canonicalValues[entry.index];
+					return true;
+				}
+				// Code is longer than the lookup; continue after those bits.
+				bitStream.Skip(LookupBits);
+				length = LookupBits;
+			} else {
+				code = 0;
+			}
+			while (length < maxCodeLength) {
+				int bit;
+				if (!bitStream.NextBit(bit)) {
+					return false;
+				}
+				code = (code << 1) | bit;
+				length++;
+				unsigned int offset = code - firstCode[length];
+				if (offset < (unsigned int)lengthCount[length]) {
+					valueReturn = &canonicalValues[firstIndex[length] + offset];
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Assign canonical codes from the code lengths held in the entries.
+		void AssignCanonicalCodes();
+
 		// Structure used to hold count table and build the code tree.
 		struct Entry;
 		typedef refcnt_ptr<Entry> EntryRef;
@@ -195,7 +315,9 @@ namespace PortfolioExplorer {
 				count(count_),
 				left(0),
 				right(0),
-				parent(0)
+				parent(0),
+				code(0),
+				codeLength(0)
 			{}
 			bool IsInterior() const { return left != 0; }
 			bool IsLeaf() const { return left == 0; }
@@ -206,6 +328,8 @@ namespace PortfolioExplorer {
 			EntryRef right;
 			Entry* parent;		// Parent pointer for building code tree.
 								// This must be a dumb pointer to avoid circular refs.
+			unsigned int code;	// Canonical code and its length
+			int codeLength;
 
 		};
 
@@ -253,9 +377,40 @@ namespace PortfolioExplorer {
 		// Comparator object used for ordering values.
 		CMP cmp;
 
-		// Table of shortcuts.  Each entry contains a "jump" to a 
-		// code-tree node, given the next eight bits of bitstream.
-		const Entry* shortcuts[256];
+		// Canonical code tables.  Values are held in canonical order, and
+		// for each code length we keep the number of codes, the first code
+		// and the index of its value.
+		bool canonical;
+		std::vector<T> canonicalValues;
+		int lengthCount[MaxCanonicalCodeLength + 1];
+		unsigned int firstCode[MaxCanonicalCodeLength + 1];
+		int firstIndex[MaxCanonicalCodeLength + 1];
+
+		// Given the next LookupBits bits of bitstream, the length and value
+		// index of the code they start with.  Length is zero if the code
+		// is longer than LookupBits.
+		struct LookupEntry {
+			int length;
+			int index;
+		};
+		LookupEntry lookup[1 << LookupBits];
+
+		// Canonical code state during bit-by-bit decoding.
+		unsigned int decodeCode;
+		int decodeLength;
+
+		// Orders entries by code length, then value.
+		struct CanonicalEntryCmp {
+			CanonicalEntryCmp(CMP cmp_) : cmp(cmp_) {}
+			bool operator()(const Entry* lhs, const Entry* rhs) const {
+				if (lhs->codeLength != rhs->codeLength) {
+					return lhs->codeLength < rhs->codeLength;
+				} else {
+					return cmp(lhs->value, rhs->value);
+				}
+			}
+			CMP cmp;
+		};
 
 		// To avoid typename problems
 		typedef typename FreqTable<T>::const_iterator FT_const_iterator;
@@ -299,6 +454,7 @@ namespace PortfolioExplorer {
 		// Invalidate previous code tables
 		valueMap.clear();
 		codeTree = 0;
+		canonical = false;
 
 		freqTable.push_back(new Entry(value, count));
 	}
@@ -319,6 +475,7 @@ namespace PortfolioExplorer {
 		{for (unsigned i = 0; i < freqTable.size(); i++) {
 		  valueMap.insert( std::make_pair( freqTable[i]->value, freqTable[i] ) );
 		}}
+		canonical = false;
 
 #if 0
 // Old method using sorted vector.
@@ -432,6 +589,14 @@ namespace PortfolioExplorer {
 		}
 
 		Entry* entry = (*iter).second.get();
+		if (canonical) {
+			// Code bits go out most-significant first.
+			lengthReturn = entry->codeLength;
+			for (int bitNbr = 0; bitNbr < lengthReturn; bitNbr++) {
+				SetCodeBit(bytesReturn, bitNbr, (entry->code >> (lengthReturn - 1 - bitNbr)) & 1);
+			}
+			return true;
+		}
 		lengthReturn = CodeLength(entry);
 		int bitNbr = lengthReturn - 1;
 		while (!entry->IsRoot()) {
@@ -468,6 +633,217 @@ namespace PortfolioExplorer {
 		return true;
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Calculate length-limited canonical codes for the table entries
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T, class CMP> void HuffmanCoder<T, CMP>::MakeCanonicalCodes(
+		int maxLength
+	) {
+		assert(maxLength > 0 && maxLength <= MaxCanonicalCodeLength);
+
+		// If the freq table is empty then fake something.
+		if (freqTable.empty()) {
+			T t;
+			AddEntry(t, 1);
+		}
+
+		// Order the entries from lowest to highest count, breaking ties by
+		// value, so that the codes do not depend on the order of entry.
+		std::vector<EntryRef> leaves(freqTable);
+		std::sort(leaves.begin(), leaves.end(), HuffmanEntryPtrCmp(cmp));
+		std::reverse(leaves.begin(), leaves.end());
+		const int nbrLeaves = int(leaves.size());
+		assert(nbrLeaves <= (1 << maxLength));
+
+		// Find the Huffman code lengths with the two-queue method: leaves are
+		// taken in count order, and combined nodes are created in count order,
+		// so the two lowest are always at the head of one of the two queues.
+		std::vector<int> lengths(nbrLeaves, 0);
+		if (nbrLeaves > 1) {
+			const int nbrNodes = 2 * nbrLeaves - 1;
+			std::vector<__int64> weight(nbrNodes, 0);
+			std::vector<int> parent(nbrNodes, -1);
+			{for (int i = 0; i < nbrLeaves; i++) {
+				weight[i] = leaves[i]->count;
+			}}
+			int nextLeaf = 0;
+			int nextNode = nbrLeaves;
+			{for (int node = nbrLeaves; node < nbrNodes; node++) {
+				for (int child = 0; child < 2; child++) {
+					int pick;
+					if (nextLeaf < nbrLeaves && (nextNode >= node || weight[nextLeaf] <= weight[nextNode])) {
+						pick = nextLeaf++;
+					} else {
+						pick = nextNode++;
+					}
+					weight[node] += weight[pick];
+					parent[pick] = node;
+				}
+			}}
+			std::vector<int> depth(nbrNodes, 0);
+			{for (int i = nbrNodes - 2; i >= 0; i--) {
+				depth[i] = depth[parent[i]] + 1;
+			}}
+
+			// Count codes of each length, folding overlong codes into the
+			// longest allowed length.
+			std::vector<int> countByLength(maxLength + 1, 0);
+			{for (int i = 0; i < nbrLeaves; i++) {
+				countByLength[depth[i] < maxLength ? depth[i] : maxLength]++;
+			}}
+
+			// Folding may over-subscribe the code space.  Restore it by moving
+			// one code from the longest length up to a shorter one, splitting
+			// the deepest shorter code into two, until the code is complete.
+			unsigned int total = 0;
+			{for (int len = 1; len <= maxLength; len++) {
+				total += (unsigned int)countByLength[len] << (maxLength - len);
+			}}
+			while (total != (1U << maxLength)) {
+				countByLength[maxLength]--;
+				for (int len = maxLength - 1; len > 0; len--) {
+					if (countByLength[len] != 0) {
+						countByLength[len]--;
+						countByLength[len + 1] += 2;
+						break;
+					}
+				}
+				total--;
+			}
+
+			// Give the shortest codes to the most frequent values.
+			int leaf = nbrLeaves - 1;
+			{for (int len = 1; len <= maxLength; len++) {
+				for (int i = 0; i < countByLength[len]; i++) {
+					lengths[leaf--] = len;
+				}
+			}}
+			assert(leaf == -1);
+		}
+
+		// Populate the value map and assign the codes.
+		valueMap.clear();
+		{for (int i = 0; i < nbrLeaves; i++) {
+			leaves[i]->codeLength = lengths[i];
+			valueMap.insert( std::make_pair( leaves[i]->value, leaves[i] ) );
+		}}
+		AssignCanonicalCodes();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Replace the table with a canonical code having the given code lengths.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T, class CMP> bool HuffmanCoder<T, CMP>::SetCodeLengths(
+		const std::vector<T>& values,
+		const std::vector<int>& lengths
+	) {
+		Clear();
+		if (values.empty() || values.size() != lengths.size()) {
+			return false;
+		}
+
+		// A single value has an empty code.  Otherwise every value needs
+		// a code, and together the codes must fill the code space exactly.
+		unsigned int total = 0;
+		{for (unsigned i = 0; i < values.size(); i++) {
+			int length = lengths[i];
+			if (values.size() == 1 ? length != 0 : (length < 1 || length > MaxCanonicalCodeLength)) {
+				return false;
+			}
+			if (length != 0) {
+				total += 1U << (MaxCanonicalCodeLength - length);
+			}
+			EntryRef entry = new Entry(values[i], 0);
+			entry->codeLength = length;
+			if (!valueMap.insert( std::make_pair( values[i], entry ) ).second) {
+				Clear();
+				return false;
+			}
+			freqTable.push_back(entry);
+		}}
+		if (values.size() > 1 && total != (1U << MaxCanonicalCodeLength)) {
+			Clear();
+			return false;
+		}
+		AssignCanonicalCodes();
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Get the values and their code lengths in canonical order.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T, class CMP> void HuffmanCoder<T, CMP>::GetCodeLengths(
+		std::vector<T>& valuesReturn,
+		std::vector<int>& lengthsReturn
+	) const {
+		assert(canonical);
+		valuesReturn = canonicalValues;
+		lengthsReturn.clear();
+		{for (int len = 0; len <= maxCodeLength; len++) {
+			lengthsReturn.insert(lengthsReturn.end(), lengthCount[len], len);
+		}}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Assign canonical codes from the code lengths held in the entries,
+	// and build the decoding tables.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T, class CMP> void HuffmanCoder<T, CMP>::AssignCanonicalCodes()
+	{
+		std::vector<Entry*> order;
+		{for (unsigned i = 0; i < freqTable.size(); i++) {
+			order.push_back(freqTable[i].get());
+		}}
+		std::sort(order.begin(), order.end(), CanonicalEntryCmp(cmp));
+
+		maxCodeLength = 0;
+		std::fill(lengthCount, lengthCount + MaxCanonicalCodeLength + 1, 0);
+		canonicalValues.clear();
+		{for (unsigned i = 0; i < order.size(); i++) {
+			lengthCount[order[i]->codeLength]++;
+			canonicalValues.push_back(order[i]->value);
+			if (order[i]->codeLength > maxCodeLength) {
+				maxCodeLength = order[i]->codeLength;
+			}
+		}}
+
+		// Codes of each length follow on from the codes of the length before.
+		unsigned int code = 0;
+		int index = lengthCount[0];
+		firstCode[0] = 0;
+		firstIndex[0] = 0;
+		{for (int len = 1; len <= MaxCanonicalCodeLength; len++) {
+			firstCode[len] = code;
+			firstIndex[len] = index;
+			code = (code + lengthCount[len]) << 1;
+			index += lengthCount[len];
+		}}
+		{for (unsigned i = 0; i < order.size(); i++) {
+			int len = order[i]->codeLength;
+			order[i]->code = firstCode[len] + (i - firstIndex[len]);
+		}}
+
+		// Fill the lookup table for codes of up to LookupBits bits.
+		{for (int i = 0; i < (1 << LookupBits); i++) {
+			lookup[i].length = 0;
+			lookup[i].index = 0;
+		}}
+		{for (unsigned i = 0; i < order.size(); i++) {
+			int len = order[i]->codeLength;
+			if (len == 0 || len > LookupBits) {
+				continue;
+			}
+			unsigned int first = order[i]->code << (LookupBits - len);
+			for (unsigned int k = 0; k < (1U << (LookupBits - len)); k++) {
+				lookup[first + k].length = len;
+				lookup[first + k].index = int(i);
+			}
+		}}
+
+		codeTree = 0;
+		canonical = true;
+	}
+
 	// Add entries using the given frequency table.
 	// Type parameter of the freq table must match that of Huffman table.
 	template <class T, class CMP> void HuffmanCoder<T, CMP>::AddEntries(
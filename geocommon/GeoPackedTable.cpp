@@ -0,0 +1,390 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoPackedTable.cpp:  Byte-aligned block format for fast decoding.
+
+#ifdef WIN32
+#pragma warning(disable:4786)
+#pragma warning(disable:4503)
+#endif
+
+#include "Geocoder_Headers.h"
+#include "GeoPackedTable.h"
+#include <string.h>
+
+namespace PortfolioExplorer {
+
+	// Identifies a packed table, and its format version.
+	static const char PackedMagic[4] = { 'G', 'P', 'A', 'K' };
+	enum { PackedFormatVersion = 1, PackedTrailerSize = 20 };
+
+	///////////////////////////////////////////////////////////////////////////
+	// Number of bits needed to hold the given value.
+	///////////////////////////////////////////////////////////////////////////
+	static int BitWidth(unsigned int value)
+	{
+		int width = 0;
+		while (value != 0) {
+			width++;
+			value >>= 1;
+		}
+		return width;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Store and load 32-bit little-endian integers.
+	///////////////////////////////////////////////////////////////////////////
+	static void StoreInt(unsigned char* ptr, unsigned int value)
+	{
+		ptr[0] = (unsigned char)value;
+		ptr[1] = (unsigned char)(value >> 8);
+		ptr[2] = (unsigned char)(value >> 16);
+		ptr[3] = (unsigned char)(value >> 24);
+	}
+	static unsigned int LoadInt(const unsigned char* ptr)
+	{
+		return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((unsigned int)ptr[3] << 24);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// PackedBlockWriter
+	///////////////////////////////////////////////////////////////////////////
+
+	void PackedBlockWriter::PutInt(unsigned int value)
+	{
+		unsigned char buf[4];
+		StoreInt(buf, value);
+		bytes.insert(bytes.end(), buf, buf + 4);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Column layout: base (the minimum), one byte of bit width, then the
+	// values less the base, packed low bit first into 32-bit words.  A
+	// zero word follows the values, so that the reader can always load
+	// the word after the one holding the start of a value.
+	///////////////////////////////////////////////////////////////////////////
+	void PackedBlockWriter::AddIntColumn(const int* values, int count)
+	{
+		int base = 0;
+		unsigned int maxOffset = 0;
+		if (count > 0) {
+			base = values[0];
+			for (int i = 1; i < count; i++) {
+				if (values[i] < base) {
+					base = values[i];
+				}
+			}
+			for (int i = 0; i < count; i++) {
+				unsigned int offset = (unsigned int)values[i] - (unsigned int)base;
+				if (offset > maxOffset) {
+					maxOffset = offset;
+				}
+			}
+		}
+		int width = BitWidth(maxOffset);
+		PutInt((unsigned int)base);
+		bytes.push_back((unsigned char)width);
+
+		int nbrWords = int(((__int64)count * width + 31) / 32) + 1;
+		std::vector<unsigned int> words(nbrWords, 0);
+		__int64 bitPos = 0;
+		for (int i = 0; i < count; i++) {
+			unsigned int offset = (unsigned int)values[i] - (unsigned int)base;
+			int wordIdx = int(bitPos >> 5);
+			int shift = int(bitPos & 31);
+			words[wordIdx] |= offset << shift;
+			if (shift != 0 && shift + width > 32) {
+				words[wordIdx + 1] |= offset >> (32 - shift);
+			}
+			bitPos += width;
+		}
+		for (int i = 0; i < nbrWords; i++) {
+			PutInt(words[i]);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Column layout: the first value, then an integer column holding the
+	// count-1 differences between successive values.
+	///////////////////////////////////////////////////////////////////////////
+	void PackedBlockWriter::AddDeltaColumn(const int* values, int count)
+	{
+		PutInt(count > 0 ? (unsigned int)values[0] : 0);
+		std::vector<int> diffs(count > 1 ? count - 1 : 0);
+		for (int i = 1; i < count; i++) {
+			diffs[i - 1] = int((unsigned int)values[i] - (unsigned int)values[i - 1]);
+		}
+		AddIntColumn(diffs.empty() ? 0 : &diffs[0], int(diffs.size()));
+	}
+
+	void PackedBlockWriter::AddCharColumn(const char* values, int width, int count)
+	{
+		bytes.insert(bytes.end(), (const unsigned char*)values, (const unsigned char*)values + width * count);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// PackedBlockReader
+	///////////////////////////////////////////////////////////////////////////
+
+	bool PackedBlockReader::GetInt(unsigned int& valueReturn)
+	{
+		if (pos + 4 > size) {
+			return false;
+		}
+		valueReturn = LoadInt(data + pos);
+		pos += 4;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Unpack a frame-of-reference column.  The loop body has no branches
+	// that depend on the data, so the compiler is free to unroll and
+	// vectorize it.
+	///////////////////////////////////////////////////////////////////////////
+	bool PackedBlockReader::UnpackColumn(int* valuesReturn, int count)
+	{
+		unsigned int base;
+		if (!GetInt(base) || pos + 1 > size) {
+			return false;
+		}
+		int width = data[pos++];
+		if (width > 32) {
+			return false;
+		}
+		unsigned int nbrWords = unsigned(((__int64)count * width + 31) / 32) + 1;
+		if (pos + nbrWords * 4 > size) {
+			return false;
+		}
+		const unsigned char* words = data + pos;
+		pos += nbrWords * 4;
+
+		if (width == 0) {
+			for (int i = 0; i < count; i++) {
+				valuesReturn[i] = int(base);
+			}
+			return true;
+		}
+
+		// Mask of the low "width" bits, computed without shifting by 32.
+		unsigned int mask = 0xFFFFFFFFu >> (32 - width);
+		unsigned int bitPos = 0;
+		for (int i = 0; i < count; i++) {
+			const unsigned char* word = words + (bitPos >> 5) * 4;
+			unsigned int shift = bitPos & 31;
+			// Assemble 64 bits from two words; the trailing zero word
+			// written by AddIntColumn() makes the second load safe.
+			__uint64 pair = LoadInt(word) | ((__uint64)LoadInt(word + 4) << 32);
+			valuesReturn[i] = int(base + ((unsigned int)(pair >> shift) & mask));
+			bitPos += width;
+		}
+		return true;
+	}
+
+	bool PackedBlockReader::ReadIntColumn(int* valuesReturn, int count)
+	{
+		return UnpackColumn(valuesReturn, count);
+	}
+
+	bool PackedBlockReader::ReadDeltaColumn(int* valuesReturn, int count)
+	{
+		unsigned int first;
+		if (!GetInt(first)) {
+			return false;
+		}
+		if (count <= 0) {
+			return UnpackColumn(valuesReturn, 0);
+		}
+		valuesReturn[0] = int(first);
+		if (!UnpackColumn(valuesReturn + 1, count - 1)) {
+			return false;
+		}
+		// Prefix sum of the differences.
+		for (int i = 1; i < count; i++) {
+			valuesReturn[i] = int((unsigned int)valuesReturn[i] + (unsigned int)valuesReturn[i - 1]);
+		}
+		return true;
+	}
+
+	bool PackedBlockReader::ReadCharColumn(char* valuesReturn, int width, int count)
+	{
+		unsigned int nbrBytes = unsigned(width * count);
+		if (pos + nbrBytes > size) {
+			return false;
+		}
+		memcpy(valuesReturn, data + pos, nbrBytes);
+		pos += nbrBytes;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// PackedTableWriter
+	///////////////////////////////////////////////////////////////////////////
+
+	PackedTableWriter::~PackedTableWriter()
+	{
+		if (fp != 0) {
+			fclose(fp);
+		}
+	}
+
+	bool PackedTableWriter::Open(const TsString& filename, int blockSize_)
+	{
+		if (blockSize_ <= 0) {
+			return false;
+		}
+		fp = fopen(filename.c_str(), "wb");
+		if (fp == 0) {
+			return false;
+		}
+		blockSize = blockSize_;
+		recordCount = 0;
+		blockOffsets.clear();
+		blockOffsets.push_back(0);
+		return true;
+	}
+
+	bool PackedTableWriter::WriteBlock(const PackedBlockWriter& block, int nbrRecords)
+	{
+		if (fp == 0 || nbrRecords <= 0 || nbrRecords > blockSize) {
+			return false;
+		}
+		// Only the last block may be short.
+		if (recordCount % blockSize != 0) {
+			return false;
+		}
+		const std::vector<unsigned char>& bytes = block.GetBytes();
+		if (!bytes.empty() && fwrite(&bytes[0], 1, bytes.size(), fp) != bytes.size()) {
+			return false;
+		}
+		blockOffsets.push_back(blockOffsets.back() + unsigned(bytes.size()));
+		recordCount += nbrRecords;
+		return true;
+	}
+
+	bool PackedTableWriter::Close()
+	{
+		if (fp == 0) {
+			return false;
+		}
+		std::vector<unsigned char> tail((blockOffsets.size() * 4) + PackedTrailerSize);
+		unsigned char* ptr = &tail[0];
+		for (unsigned i = 0; i < blockOffsets.size(); i++, ptr += 4) {
+			StoreInt(ptr, blockOffsets[i]);
+		}
+		memcpy(ptr, PackedMagic, 4);
+		StoreInt(ptr + 4, PackedFormatVersion);
+		StoreInt(ptr + 8, recordCount);
+		StoreInt(ptr + 12, unsigned(blockSize));
+		StoreInt(ptr + 16, unsigned(blockOffsets.size() - 1));
+		bool ok = fwrite(&tail[0], 1, tail.size(), fp) == tail.size();
+		ok = (fclose(fp) == 0) && ok;
+		fp = 0;
+		return ok;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// PackedTableReader
+	///////////////////////////////////////////////////////////////////////////
+
+	bool PackedTableReader::Open(const TsString& filename)
+	{
+		Close();
+		if (!input.Open(filename)) {
+			return false;
+		}
+		int fileSize = input.GetFileSize();
+		unsigned char trailer[PackedTrailerSize];
+		if (
+			fileSize < PackedTrailerSize ||
+			!input.Seek(fileSize - PackedTrailerSize) ||
+			input.Read(PackedTrailerSize, trailer) != PackedTrailerSize ||
+			memcmp(trailer, PackedMagic, 4) != 0 ||
+			LoadInt(trailer + 4) != PackedFormatVersion
+		) {
+			Close();
+			return false;
+		}
+		unsigned int nbrRecords = LoadInt(trailer + 8);
+		unsigned int size = LoadInt(trailer + 12);
+		unsigned int blockCount = LoadInt(trailer + 16);
+
+		// Check the trailer against the file before trusting it.
+		__int64 offsetTableSize = ((__int64)blockCount + 1) * 4;
+		if (
+			size == 0 ||
+			size > 0x7FFFFFFF ||
+			offsetTableSize + PackedTrailerSize > fileSize ||
+			(__int64)blockCount * size < nbrRecords ||
+			(blockCount > 0 && (__int64)(blockCount - 1) * size >= nbrRecords)
+		) {
+			Close();
+			return false;
+		}
+
+		std::vector<unsigned char> table((size_t)offsetTableSize);
+		int tablePos = fileSize - PackedTrailerSize - int(offsetTableSize);
+		if (
+			!input.Seek(tablePos) ||
+			input.Read(int(offsetTableSize), &table[0]) != int(offsetTableSize)
+		) {
+			Close();
+			return false;
+		}
+		blockOffsets.resize(blockCount + 1);
+		for (unsigned i = 0; i <= blockCount; i++) {
+			blockOffsets[i] = LoadInt(&table[i * 4]);
+			if (
+				(i > 0 && blockOffsets[i] < blockOffsets[i - 1]) ||
+				blockOffsets[i] > unsigned(tablePos)
+			) {
+				Close();
+				return false;
+			}
+		}
+		recordCount = nbrRecords;
+		blockSize = int(size);
+		return true;
+	}
+
+	void PackedTableReader::Close()
+	{
+		input.Close();
+		blockOffsets.clear();
+		recordCount = 0;
+		blockSize = 0;
+	}
+
+	bool PackedTableReader::ReadBlock(int blockIdx, std::vector<unsigned char>& bytesReturn)
+	{
+		if (blockIdx < 0 || unsigned(blockIdx) + 1 >= blockOffsets.size()) {
+			return false;
+		}
+		int start = int(blockOffsets[blockIdx]);
+		int length = int(blockOffsets[blockIdx + 1] - blockOffsets[blockIdx]);
+		bytesReturn.resize(length);
+		if (length == 0) {
+			return true;
+		}
+		return input.Seek(start) && input.Read(length, &bytesReturn[0]) == length;
+	}
+
+}
@@ -0,0 +1,203 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// GeoPackedTable.h:  Byte-aligned block format for fast decoding.
+//
+// A packed table is an alternative to the Huffman-coded data and position
+// index files of a table.  It trades roughly twice the disk space for much
+// cheaper decoding: records are grouped into blocks, and each block stores
+// its fields column by column.  Integer columns are frame-of-reference
+// coded (the minimum, then each value less the minimum in a fixed number
+// of bits, packed into 32-bit little-endian words), optionally after
+// taking differences from the previous value.  Character columns are
+// stored at their fixed width.  Every column starts on a byte boundary,
+// so a column is decoded by a simple loop with no data-dependent branches.
+//
+// File layout:
+//	block 0, block 1, ...
+//	block offset table: (blockCount + 1) 32-bit byte offsets
+//	trailer: "GPAK", format version, record count, block size, block count
+// All integers are 32-bit little-endian.
+
+#ifndef INCL_GEOPACKEDTABLE_H
+#define INCL_GEOPACKEDTABLE_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include "Geocoder_DllExport.h"
+#include "../global/TsString.h"
+#include "GeoDataInput.h"
+#include <stdio.h>
+#include <vector>
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////
+	// Builds the bytes of one block, a column at a time.
+	///////////////////////////////////////////////////////////////////////////
+	class PackedBlockWriter {
+	public:
+		// Start a new block.
+		void Clear() { bytes.clear(); }
+
+		///////////////////////////////////////////////////////////////////////
+		// Add a frame-of-reference coded integer column.
+		// Inputs:
+		//	const int*	values		The column values
+		//	int			count		Number of values
+		///////////////////////////////////////////////////////////////////////
+		void AddIntColumn(const int* values, int count);
+
+		///////////////////////////////////////////////////////////////////////
+		// Add an integer column coded as its first value followed by the
+		// frame-of-reference coded differences between successive values.
+		// Use for columns that change slowly from record to record.
+		///////////////////////////////////////////////////////////////////////
+		void AddDeltaColumn(const int* values, int count);
+
+		///////////////////////////////////////////////////////////////////////
+		// Add a fixed-width character column.
+		// Inputs:
+		//	const char*	values		count * width bytes, one field after another
+		//	int			width		Width of a field in bytes
+		//	int			count		Number of values
+		///////////////////////////////////////////////////////////////////////
+		void AddCharColumn(const char* values, int width, int count);
+
+		const std::vector<unsigned char>& GetBytes() const { return bytes; }
+
+	private:
+		void PutInt(unsigned int value);
+		std::vector<unsigned char> bytes;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Decodes the columns of one block, in the order they were written.
+	// Each Read function returns false if the block is too short.
+	///////////////////////////////////////////////////////////////////////////
+	class PackedBlockReader {
+	public:
+		PackedBlockReader(const unsigned char* data_, unsigned int size_) :
+			data(data_), size(size_), pos(0)
+		{}
+
+		bool ReadIntColumn(int* valuesReturn, int count);
+		bool ReadDeltaColumn(int* valuesReturn, int count);
+		bool ReadCharColumn(char* valuesReturn, int width, int count);
+
+	private:
+		bool GetInt(unsigned int& valueReturn);
+		bool UnpackColumn(int* valuesReturn, int count);
+
+		const unsigned char* data;
+		unsigned int size;
+		unsigned int pos;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Writes a packed table file.
+	///////////////////////////////////////////////////////////////////////////
+	class PackedTableWriter {
+	public:
+		PackedTableWriter() : fp(0), blockSize(0), recordCount(0) {}
+		~PackedTableWriter();
+
+		///////////////////////////////////////////////////////////////////////
+		// Create the file.
+		// Inputs:
+		//	const TsString&	filename	The file to create
+		//	int				blockSize	Number of records in each block but the last
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool Open(const TsString& filename, int blockSize);
+
+		///////////////////////////////////////////////////////////////////////
+		// Append a block holding the given number of records.  Every block
+		// but the last must hold blockSize records.
+		///////////////////////////////////////////////////////////////////////
+		bool WriteBlock(const PackedBlockWriter& block, int nbrRecords);
+
+		///////////////////////////////////////////////////////////////////////
+		// Write the block offset table and trailer, and close the file.
+		///////////////////////////////////////////////////////////////////////
+		bool Close();
+
+	private:
+		FILE* fp;
+		int blockSize;
+		unsigned int recordCount;
+		std::vector<unsigned int> blockOffsets;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Reads blocks of a packed table file.
+	///////////////////////////////////////////////////////////////////////////
+	class PackedTableReader {
+	public:
+		PackedTableReader() : recordCount(0), blockSize(0) {}
+
+		///////////////////////////////////////////////////////////////////////
+		// Open the file and load its block offset table.
+		// Return value:
+		//	bool		true on success, false if the file cannot be read or
+		//				is not a packed table.
+		///////////////////////////////////////////////////////////////////////
+		bool Open(const TsString& filename);
+		void Close();
+
+		unsigned int GetRecordCount() const { return recordCount; }
+		int GetBlockSize() const { return blockSize; }
+		int GetFileSize() { return input.GetFileSize(); }
+
+		// Number of blocks, and the size in bytes of one of them.
+		int GetBlockCount() const { return blockOffsets.empty() ? 0 : int(blockOffsets.size()) - 1; }
+		unsigned int GetBlockLength(int blockIdx) const {
+			return blockOffsets[blockIdx + 1] - blockOffsets[blockIdx];
+		}
+
+		// Verify the blocks against their checksums as they are first read.
+		void SetChecksums(const LazyChecksumRef& checksums) { input.SetChecksums(checksums); }
+
+		///////////////////////////////////////////////////////////////////////
+		// Read the bytes of a block.
+		// Inputs:
+		//	int						blockIdx	The block to read
+		// Outputs:
+		//	std::vector<unsigned char>&	bytesReturn	The bytes of the block
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////
+		bool ReadBlock(int blockIdx, std::vector<unsigned char>& bytesReturn);
+
+	private:
+		DataInput input;
+		unsigned int recordCount;
+		int blockSize;
+		std::vector<unsigned int> blockOffsets;
+	};
+
+}
+
+#endif
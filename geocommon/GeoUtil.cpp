@@ -53,6 +53,15 @@ namespace PortfolioExplorer {
 	const char* GeoUtil::STREET_INTERSECTION_SOUNDEX_FILE = "StreetIntersectionSoundex.dat";
 	const char* GeoUtil::STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE = "StreetIntersectionSoundexPostitionIndex.dat";
 	const char* GeoUtil::POSTCODE_CENTROID_FILE = "PostcodeCentroid.dat";
+	const char* GeoUtil::DELTA_FILE = "GeoDelta.txt";
+	const char* GeoUtil::VERSION_FILE = "Version.txt";
+	const char* GeoUtil::CHECKSUM_MANIFEST_FILE = "Checksums.txt";
+
+	// Packed tables
+	const char* GeoUtil::STREET_NAME_PACKED_FILE = "StreetName.pak";
+	const char* GeoUtil::STREET_SEGMENT_PACKED_FILE = "StreetSegment.pak";
+	const char* GeoUtil::COORDINATE_PACKED_FILE = "CoordinatePoint.pak";
+	const char* GeoUtil::PACKED_FORMAT_FLAG = "packed";
 
 	// Huffman frequency tables
 	const char* GeoUtil::STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE = "StreetNameCityStatePostcodeIDHuff.txt";
@@ -497,5 +506,191 @@ namespace PortfolioExplorer {
 		}
 	}
 
+	///////////////////////////////////////////////////////////////////////////
+	// Code-length tables
+	///////////////////////////////////////////////////////////////////////////
+
+	namespace {
+		const char CodeLengthMagic[4] = { 'G', 'H', 'C', 'L' };
+		enum {
+			CodeLengthFormatVersion = 1,
+			CodeLengthIntValues = 0,
+			CodeLengthStringValues = 1
+		};
+
+		// Append a variable-length unsigned integer to a buffer.
+		void PutVarLength(std::vector<unsigned char>& buf, unsigned int value)
+		{
+			unsigned char tmpBuf[8];
+			int length = GeoUtil::IntToVarLengthBuf(value, tmpBuf);
+			buf.insert(buf.end(), tmpBuf, tmpBuf + length);
+		}
+
+		// Read a variable-length unsigned integer from a buffer.
+		bool GetVarLength(const std::vector<unsigned char>& buf, unsigned& pos, unsigned int& valueReturn)
+		{
+			GeoUtil::VarLengthBufToInt converter;
+			if (pos >= buf.size()) {
+				return false;
+			}
+			bool more = converter.FirstByte(buf[pos++]);
+			while (more) {
+				if (pos >= buf.size()) {
+					return false;
+				}
+				more = converter.NextByte(buf[pos++]);
+			}
+			valueReturn = converter.GetUnsignedValue();
+			return true;
+		}
+
+		// Value encoding for each value type.  Integers are stored as the
+		// difference from the previous value with the sign folded into bit 0.
+		void PutValue(std::vector<unsigned char>& buf, const int& value, int& prev)
+		{
+			int diff = int((unsigned int)value - (unsigned int)prev);
+			PutVarLength(buf, ((unsigned int)diff << 1) ^ (unsigned int)(diff >> 31));
+			prev = value;
+		}
+		bool GetValue(const std::vector<unsigned char>& buf, unsigned& pos, int& valueReturn, int& prev)
+		{
+			unsigned int folded;
+			if (!GetVarLength(buf, pos, folded)) {
+				return false;
+			}
+			unsigned int diff = (folded >> 1) ^ (0U - (folded & 1));
+			valueReturn = int((unsigned int)prev + diff);
+			prev = valueReturn;
+			return true;
+		}
+		void PutValue(std::vector<unsigned char>& buf, const TsString& value, int&)
+		{
+			PutVarLength(buf, unsigned(value.size()));
+			buf.insert(buf.end(), value.begin(), value.end());
+		}
+		bool GetValue(const std::vector<unsigned char>& buf, unsigned& pos, TsString& valueReturn, int&)
+		{
+			unsigned int length;
+			if (!GetVarLength(buf, pos, length) || length > buf.size() - pos) {
+				return false;
+			}
+			valueReturn.assign((const char*)&buf[0] + pos, length);
+			pos += length;
+			return true;
+		}
+
+		template <class T, class CMP> bool SaveCodeLengthsImp(
+			const HuffmanCoder<T, CMP>& coder,
+			int valueType,
+			std::ostream& os
+		) {
+			std::vector<T> values;
+			std::vector<int> lengths;
+			coder.GetCodeLengths(values, lengths);
+			int maxLength = lengths.empty() ? 0 : lengths.back();
+
+			std::vector<unsigned char> buf(CodeLengthMagic, CodeLengthMagic + sizeof(CodeLengthMagic));
+			buf.push_back((unsigned char)CodeLengthFormatVersion);
+			buf.push_back((unsigned char)valueType);
+			buf.push_back((unsigned char)maxLength);
+			{for (int len = 0, idx = 0; len <= maxLength; len++) {
+				unsigned int count = 0;
+				for (; idx < int(lengths.size()) && lengths[idx] == len; idx++) {
+					count++;
+				}
+				PutVarLength(buf, count);
+			}}
+			int prev = 0;
+			{for (unsigned i = 0; i < values.size(); i++) {
+				PutValue(buf, values[i], prev);
+			}}
+			os.write((const char*)&buf[0], std::streamsize(buf.size()));
+			return os.good();
+		}
+
+		template <class T, class CMP> bool LoadCodeLengthsImp(
+			HuffmanCoder<T, CMP>& coder,
+			int valueType,
+			std::istream& is
+		) {
+			std::vector<unsigned char> buf;
+			char tmpBuf[4096];
+			while (is.good()) {
+				is.read(tmpBuf, sizeof(tmpBuf));
+				buf.insert(buf.end(), tmpBuf, tmpBuf + is.gcount());
+			}
+			if (!is.eof()) {
+				return false;
+			}
+
+			unsigned pos = sizeof(CodeLengthMagic) + 3;
+			if (
+				buf.size() < pos ||
+				memcmp(&buf[0], CodeLengthMagic, sizeof(CodeLengthMagic)) != 0 ||
+				buf[4] != CodeLengthFormatVersion ||
+				buf[5] != valueType ||
+				buf[6] > HuffmanCoder<T, CMP>::MaxCanonicalCodeLength
+			) {
+				return false;
+			}
+			int maxLength = buf[6];
+
+			std::vector<int> lengths;
+			{for (int len = 0; len <= maxLength; len++) {
+				unsigned int count;
+				if (!GetVarLength(buf, pos, count) || count > buf.size()) {
+					return false;
+				}
+				lengths.insert(lengths.end(), count, len);
+			}}
+			std::vector<T> values(lengths.size());
+			int prev = 0;
+			{for (unsigned i = 0; i < values.size(); i++) {
+				if (!GetValue(buf, pos, values[i], prev)) {
+					return false;
+				}
+			}}
+			return pos == buf.size() && coder.SetCodeLengths(values, lengths);
+		}
+	}
+
+	TsString GeoUtil::CodeLengthFilename(const char* freqTableFilename)
+	{
+		TsString filename(freqTableFilename);
+		TsString::size_type dot = filename.rfind('.');
+		if (dot != TsString::npos) {
+			filename.erase(dot);
+		}
+		return filename + ".hcl";
+	}
+
+	bool GeoUtil::SaveCodeLengths(
+		const HuffmanCoder<int, std::less<int> >& coder,
+		std::ostream& os
+	) {
+		return SaveCodeLengthsImp(coder, CodeLengthIntValues, os);
+	}
+
+	bool GeoUtil::SaveCodeLengths(
+		const HuffmanCoder<TsString, std::less<TsString> >& coder,
+		std::ostream& os
+	) {
+		return SaveCodeLengthsImp(coder, CodeLengthStringValues, os);
+	}
+
+	bool GeoUtil::LoadCodeLengths(
+		HuffmanCoder<int, std::less<int> >& coder,
+		std::istream& is
+	) {
+		return LoadCodeLengthsImp(coder, CodeLengthIntValues, is);
+	}
+
+	bool GeoUtil::LoadCodeLengths(
+		HuffmanCoder<TsString, std::less<TsString> >& coder,
+		std::istream& is
+	) {
+		return LoadCodeLengthsImp(coder, CodeLengthStringValues, is);
+	}
+
 
 }
@@ -54,6 +54,17 @@ namespace PortfolioExplorer {
 		static const char* STREET_INTERSECTION_SOUNDEX_FILE;
 		static const char* STREET_INTERSECTION_SOUNDEX_POSITION_INDEX_FILE;
 		static const char* POSTCODE_CENTROID_FILE;
+		static const char* DELTA_FILE;
+		static const char* VERSION_FILE;
+		static const char* CHECKSUM_MANIFEST_FILE;
+
+		// Packed tables, which replace the data file, position index and
+		// Huffman tables of a table when the version file carries
+		// PACKED_FORMAT_FLAG after the data version.
+		static const char* STREET_NAME_PACKED_FILE;
+		static const char* STREET_SEGMENT_PACKED_FILE;
+		static const char* COORDINATE_PACKED_FILE;
+		static const char* PACKED_FORMAT_FLAG;
 
 		// Huffman frequency tables
 		static const char* STREET_NAME_CITY_STATE_POSTCODE_ID_HUFF_FILE;
@@ -154,6 +165,22 @@ namespace PortfolioExplorer {
 			CoordinateLongitudeBitSize = 26,
 			CoordinateChunkSize = 40,
 
+			ChecksumGroupSize = 65536,	// bytes covered by each checksum in the manifest
+
+			PackedBlockSize = 128,		// records per block of a packed table
+			// Widths of the fixed-width string columns of packed tables,
+			// including the terminator.  These match the StreetName and
+			// StreetSegment record fields.
+			PackedStreetNamePrefixWidth = 7,
+			PackedStreetNamePredirWidth = 3,
+			PackedStreetNameNameWidth = StreetNameNameFieldLength + 1,
+			PackedStreetNameSuffixWidth = 7,
+			PackedStreetNamePostdirWidth = 3,
+			PackedStreetSegmentAddrWidth = 11,
+			PackedStreetSegmentCensusTractWidth = 7,
+			PackedStreetSegmentCensusBlockWidth = 5,
+			PackedStreetSegmentPostcodeExtWidth = 5,
+
 			StreetIntersectionStateBitSize = 8, 
 			StreetIntersectionSoundexBitSize = 16,
 			StreetIntersectionStreetNameIDBitSize = 23,
@@ -461,6 +488,54 @@ namespace PortfolioExplorer {
 			BitStreamWrite& bitStream
 		);
 
+		///////////////////////////////////////////////////////////////////////////
+		// Name of the code-length table that replaces a frequency table file:
+		// the ".txt" extension is replaced by ".hcl".
+		///////////////////////////////////////////////////////////////////////////
+		static TsString CodeLengthFilename(const char* freqTableFilename);
+
+		///////////////////////////////////////////////////////////////////////////
+		// Save the code lengths of a canonical Huffman coder in binary form.
+		// The table starts with the magic "GHCL", a format version byte, a
+		// value-type byte (0 = integer, 1 = string) and the maximum code length.
+		// Then follow variable-length counts of the codes of each length from
+		// zero to the maximum, and the values in canonical order: integers as
+		// sign-folded variable-length differences from the previous value,
+		// strings as a variable-length byte count and the bytes.
+		// Inputs:
+		//	const HuffmanCoder&	coder	A coder made with MakeCanonicalCodes()
+		//	std::ostream&		os		The stream to write, opened in binary mode
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////////
+		static bool SaveCodeLengths(
+			const HuffmanCoder<int, std::less<int> >& coder,
+			std::ostream& os
+		);
+		static bool SaveCodeLengths(
+			const HuffmanCoder<TsString, std::less<TsString> >& coder,
+			std::ostream& os
+		);
+
+		///////////////////////////////////////////////////////////////////////////
+		// Load a code-length table saved by SaveCodeLengths() and set up the
+		// coder with the canonical codes it describes.
+		// Inputs:
+		//	std::istream&		is		The stream to read, opened in binary mode
+		// Outputs:
+		//	HuffmanCoder&		coder	The coder to set up
+		// Return value:
+		//	bool		true on success, false if the table is malformed.
+		///////////////////////////////////////////////////////////////////////////
+		static bool LoadCodeLengths(
+			HuffmanCoder<int, std::less<int> >& coder,
+			std::istream& is
+		);
+		static bool LoadCodeLengths(
+			HuffmanCoder<TsString, std::less<TsString> >& coder,
+			std::istream& is
+		);
+
 		///////////////////////////////////////////////////////////////////////////
 		// Class to convert variable-length buffers to signed/unsigned integers.
 		///////////////////////////////////////////////////////////////////////////
@@ -60,6 +60,20 @@ namespace PortfolioExplorer {
 		return imp->GetForPuertoRico();
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Share the caller's allocator (must be done before Open())
+	//////////////////////////////////////////////////////////////////////
+	void AddressParserFirstLine::SetBulkAllocator(const BulkAllocatorRef& bulkAllocator) {
+		imp->SetBulkAllocator(bulkAllocator);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Share the caller's table image (must be done before Open())
+	//////////////////////////////////////////////////////////////////////
+	void AddressParserFirstLine::SetParserTableImage(const ParserTableImageRef& image) {
+		imp->SetParserTableImage(image);
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Initialize the address parser.
 	//	const char*			dataDir		The directory containing data files.
@@ -107,6 +121,27 @@ namespace PortfolioExplorer {
 		return imp->Parse(addressLine, parseCandidate, replaceAliases);
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Build a parse candidate from address components that the caller
+	// has already separated.
+	//////////////////////////////////////////////////////////////////////
+	bool AddressParserFirstLine::ParseFields(
+		const char* number,
+		const char* predir,
+		const char* street,
+		const char* suffix,
+		const char* postdir,
+		const char* unitDesignator,
+		const char* unitNumber,
+		ParseCandidate& parseCandidate, 
+		bool replaceAliases
+	) {
+		return imp->ParseFields(
+			number, predir, street, suffix, postdir, unitDesignator, unitNumber,
+			parseCandidate, replaceAliases
+		);
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Perform permutations on the address.
 	// Inputs:
@@ -37,6 +37,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include "RefPtr.h"
+#include "BulkAllocator.h"
+#include "ParserTableImage.h"
 #include "Global_DllExport.h"
 
 namespace PortfolioExplorer {
@@ -320,6 +322,22 @@ namespace PortfolioExplorer {
 		void SetForPuertoRico(bool forPuertoRico_);
 		bool GetForPuertoRico() const;
 
+		//////////////////////////////////////////////////////////////////////
+		// Allocate working storage from the given allocator rather than one
+		// of the parser's own, so that one allocator serves a whole request.
+		// The caller owns it and must Reset() it between addresses; the
+		// parser never does.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetBulkAllocator(const BulkAllocatorRef& bulkAllocator);
+
+		//////////////////////////////////////////////////////////////////////
+		// Load the tables from an image the caller has opened, so that
+		// parsers opened together read the image file once.  Without one,
+		// Open() opens the image in the data directory itself.  Must be done
+		// before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetParserTableImage(const ParserTableImageRef& image);
+
 		//////////////////////////////////////////////////////////////////////
 		// Initialize the address parser.
 		// Inputs:
@@ -358,6 +376,39 @@ namespace PortfolioExplorer {
 			bool replaceAliases
 		);
 
+		//////////////////////////////////////////////////////////////////////
+		// Build a parse candidate from address components that the caller
+		// has already separated.  No tokenizing or pattern matching is done;
+		// the components are converted to upper case and, if requested, the
+		// directionals, suffix and unit designator are replaced by their
+		// standard aliases.  No permutations are available afterwards.
+		// Inputs:
+		//	const char*			number				address number
+		//	const char*			predir				predirectional
+		//	const char*			street				street name
+		//	const char*			suffix				street suffix
+		//	const char*			postdir				postdirectional
+		//	const char*			unitDesignator		unit designator
+		//	const char*			unitNumber			unit number
+		//	bool				replaceAliases		substitute standard aliases
+		// Any component may be null.
+		// Outputs:
+		//	ParseCandidate&		parseCandidate		The resulting parsed address
+		// Return value:
+		//	bool				true on success, false if there is no street name.
+		//////////////////////////////////////////////////////////////////////
+		bool ParseFields(
+			const char* number,
+			const char* predir,
+			const char* street,
+			const char* suffix,
+			const char* postdir,
+			const char* unitDesignator,
+			const char* unitNumber,
+			ParseCandidate& parseCandidate, 
+			bool replaceAliases
+		);
+
 		//////////////////////////////////////////////////////////////////////
 		// Create permutations of the original address parse.
 		// Inputs:
@@ -71,6 +71,34 @@ namespace PortfolioExplorer {
 		}
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Given a single address component, an output buffer, and an alias
+	// table, normalize the component to the output buffer, transforming 
+	// via the alias table if requested and possible.
+	// Return value:
+	//	bool		true if the component was replaced with a standard alias,
+	//				false if the component was output directly.
+	//////////////////////////////////////////////////////////////////////
+	static bool DeAliasFieldToBuffer(
+		char* buffer,
+		int bufSize,
+		LookupTableRef aliasTable,
+		const char* field,
+		bool replaceAliases
+	) {
+		char tmpBuf[100];
+		const char *tmpPtr;
+
+		CopyNormalizedField(tmpBuf, sizeof(tmpBuf), field);
+		if (replaceAliases && tmpBuf[0] != 0 && aliasTable->Find(tmpBuf, tmpPtr)) {
+			CopyNormalizedField(buffer, bufSize, tmpPtr);
+			return true;
+		} else {
+			CopyNormalizedField(buffer, bufSize, tmpBuf);
+			return false;
+		}
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// A useful function for reversing the text of a token
 	//////////////////////////////////////////////////////////////////////
@@ -177,6 +205,9 @@ namespace PortfolioExplorer {
 	// Initialize the address parser.
 	// Inputs:
 	//	const TsString&	dataDir		The directory containing data files.
+	//	ParserTableImageRef	image	Source of pre-built tables.  If zero,
+	//								the shared image is used if set, and
+	//								otherwise the image in dataDir if present.
 	// Outputs:
 	//	std::String&		errorMsg	The message if an error occured.
 	// Return value:
@@ -184,11 +215,22 @@ namespace PortfolioExplorer {
 	//////////////////////////////////////////////////////////////////////
 	bool AddressParserFirstLineImp::Open(
 		const TsString& dataDir_,
-		TsString& errorMsg
+		TsString& errorMsg,
+		ParserTableImageRef image
 	) {
 		dataDir = dataDir_;
 
-		bulkAllocator = new BulkAllocator;
+		bulkAllocator = sharedAllocator != 0 ? sharedAllocator : new BulkAllocator;
+
+		if (image == 0) {
+			image = sharedImage;
+		}
+		if (image == 0) {
+			// No image is fine; tables are read from their files.
+			TsString imageErrorMsg;
+			image = new ParserTableImage;
+			image->Open(dataDir, imageErrorMsg);
+		}
 
 		regularExprWrapper = new RegularExprWrapper;
 
@@ -196,94 +238,85 @@ namespace PortfolioExplorer {
 			// Load alias translation tables and lexicons
 
 			// unabbreviated directionals 
-			directionalsLexicon = new Lexicon;
-			if (!directionalsLexicon->LoadFromFile(dataDir + "/" + directionalsFile, errorMsg)) {
+			if (!image->LoadLexicon(directionalsFile, directionalsLexicon, errorMsg)) {
 				throw 1;
 			}
 
 			// reversed unabbreviated directionals 
-			reverseDirectionalsLexicon = new Lexicon;
-			if (!reverseDirectionalsLexicon->LoadFromFile(dataDir + "/" + reverseDirectionalsFile, errorMsg)) {
+			if (!image->LoadLexicon(reverseDirectionalsFile, reverseDirectionalsLexicon, errorMsg)) {
 				throw 1;
 			}
 
 			// reversed suffixes
-			reverseSuffixesLexicon = new Lexicon;
-			if (!reverseSuffixesLexicon->LoadFromFile(dataDir + "/" + reverseSuffixesFile, errorMsg)) {
+			if (!image->LoadLexicon(reverseSuffixesFile, reverseSuffixesLexicon, errorMsg)) {
 				throw 1;
 			}
 
 			// suffix aliases
-			suffixAliasTable = new LookupTable;
-			if (!suffixAliasTable->LoadFromFile(dataDir + "/" + suffixAliasFile, errorMsg)) {
+			if (!image->LoadLookupTable(suffixAliasFile, suffixAliasTable, errorMsg)) {
 				throw 1;
 			}
 
 			// directional aliases
-			directionalAliasTable = new LookupTable;
-			if (!directionalAliasTable->LoadFromFile(dataDir + "/" + directionalAliasFile, errorMsg)) {
+			if (!image->LoadLookupTable(directionalAliasFile, directionalAliasTable, errorMsg)) {
 				throw 1;
 			}
 
 			// unit designator aliases
-			unitDesignatorAliasTable = new LookupTable;
-			if (!unitDesignatorAliasTable->LoadFromFile(dataDir + "/" + unitDesignatorAliasFile, errorMsg)) {
+			if (!image->LoadLookupTable(unitDesignatorAliasFile, unitDesignatorAliasTable, errorMsg)) {
 				throw 1;
 			}
 
 			// address token symbols
 			{
-				addressTokenTable = new LookupTable;
 				TsString addressTokenFile = forPuertoRico ? addressTokenFilePr : addressTokenFileNonPr;
-				if( !addressTokenTable->LoadFromFile(dataDir + "/" + addressTokenFile, errorMsg) ) {
+				if( !image->LoadLookupTable(addressTokenFile, addressTokenTable, errorMsg) ) {
 					throw 1;
 				}
 			}
 
 			// Streetname aliases
-			streetnameAliasesTable = new LookupTable;
-			if( !streetnameAliasesTable->LoadFromFile(dataDir + "/" + streetnameAliasesFile, errorMsg) ) {
+			if( !image->LoadLookupTable(streetnameAliasesFile, streetnameAliasesTable, errorMsg) ) {
 				throw 1;
 			}
 
 			// Leading-token lexicon for multi-token streetname alias
-			streetnameMultiwordAliasesLexicon = new Lexicon;
-			if( !streetnameMultiwordAliasesLexicon->LoadFromFile(dataDir + "/" + streetnameMultiwordSearchAliasesFile, errorMsg) ) {
+			if( !image->LoadLexicon(streetnameMultiwordSearchAliasesFile, streetnameMultiwordAliasesLexicon, errorMsg) ) {
 				throw 1;
 			}
 
 			// LookupTable containing multiword street aliases
-			streetnameMultiwordAliasesTable = new LookupTable;
-			if( !streetnameMultiwordAliasesTable->LoadFromFile(dataDir + "/" + streetnameMultiwordAliasesFile, errorMsg) ) {
+			if( !image->LoadLookupTable(streetnameMultiwordAliasesFile, streetnameMultiwordAliasesTable, errorMsg) ) {
 				throw 1;
 			}
 
 			// LookupTable containing street name prefix aliases
-			streetNamePrefixAliasesTable = new LookupTable;
-			if (!streetNamePrefixAliasesTable->LoadFromFile(dataDir + "/" + streetNamePrefixAliasesFile, errorMsg) ) {
+			if (!image->LoadLookupTable(streetNamePrefixAliasesFile, streetNamePrefixAliasesTable, errorMsg) ) {
 				throw 1;
 			}
 
 			// Create and bind the pattern matching tools
 			{
 				TsString patternsConfigurationFile = forPuertoRico ? patternsConfigurationFilePr : patternsConfigurationFileNonPr;
-				if( !regularExprWrapper->ReadPatternToolConfiguration(dataDir_ + "/" + patternsConfigurationFile, errorMsg) ) {
+				DataItemRef patternsConfiguration;
+				if (
+					!image->LoadPatternConfiguration(patternsConfigurationFile, patternsConfiguration, errorMsg) ||
+					!regularExprWrapper->BindPatternTools(patternsConfiguration, errorMsg)
+				) {
 					throw 1;
 				}
 			}
 
 			// Number aliases
-			numberAliasTable = new LookupTable;
-			if (!numberAliasTable->LoadFromFile(dataDir + "/" + numberAliasFile, errorMsg)) {
+			if (!image->LoadLookupTable(numberAliasFile, numberAliasTable, errorMsg)) {
 				// Ignore this error; older distributions lack this file.
 				// throw 1
 			}
 
 			// magnet street words
-			streetNameMagnetWordsLexicon = new Lexicon;
 			// Allow this load to fail.  Old address parsers did not ship with this lexicon so
 			// we want to allow that.
-			streetNameMagnetWordsLexicon->LoadFromFile(dataDir + "/" + streetNameMagnetWordsFile, errorMsg);
+			image->LoadLexicon(streetNameMagnetWordsFile, streetNameMagnetWordsLexicon, errorMsg);
 
 
 			// Build our lookup tries
@@ -333,7 +366,9 @@ namespace PortfolioExplorer {
 		bool replaceAliases
 	) {
 		// Reset the allocator and free memory used by last parse
-		bulkAllocator->Reset();
+		if (sharedAllocator == 0) {
+			bulkAllocator->Reset();
+		}
 		hashedCandidates.Clear();
 		addressParse.clear();
 
@@ -365,7 +400,7 @@ namespace PortfolioExplorer {
 		std::vector<TokSymCls>::iterator it;
 		const char *tmpPtr;
 		for(it = addressParse.begin(); it != addressParse.end(); it++) {
-			if (addressTokenTable->Find((*it).token.c_str(), tmpPtr)) {
+			if (addressTokenTable->Find((*it).token, tmpPtr)) {
 				(*it).symbol = tmpPtr;
 			}
 		}
@@ -390,6 +425,96 @@ namespace PortfolioExplorer {
 		return true;
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Build a parse candidate from address components that the caller
+	// has already separated.
+	// Inputs:
+	//	const char*			number				address number
+	//	const char*			predir				predirectional
+	//	const char*			street				street name
+	//	const char*			suffix				street suffix
+	//	const char*			postdir				postdirectional
+	//	const char*			unitDesignator		unit designator
+	//	const char*			unitNumber			unit number
+	//	bool				replaceAliases		substitute standard aliases
+	// Outputs:
+	//	ParseCandidate&		parseCandidate		The resulting parsed address
+	// Return value:
+	//	bool				true on success, false if there is no street name.
+	//////////////////////////////////////////////////////////////////////
+	bool AddressParserFirstLineImp::ParseFields(
+		const char* number,
+		const char* predir,
+		const char* street,
+		const char* suffix,
+		const char* postdir,
+		const char* unitDesignator,
+		const char* unitNumber,
+		AddressParserFirstLine::ParseCandidate& parseCandidate, 
+		bool replaceAliases
+	) {
+		// Forget the last parse, so that NextAddressPermutation() returns nothing.
+		if (sharedAllocator == 0) {
+			bulkAllocator->Reset();
+		}
+		hashedCandidates.Clear();
+		addressParse.clear();
+		parsedTokens.clear();
+		nextCandidateIdx = 1;
+
+		parseCandidate.isIntersection = false;
+		parseCandidate.permutations = 0;
+		parseCandidate.numberOfMods = 0;
+
+		bool aliased = false;
+		aliased |= DeAliasFieldToBuffer(
+			parseCandidate.predir, 
+			sizeof(parseCandidate.predir),
+			directionalAliasTable,
+			predir,
+			replaceAliases
+		);
+		aliased |= DeAliasFieldToBuffer(
+			parseCandidate.suffix, 
+			sizeof(parseCandidate.suffix),
+			suffixAliasTable,
+			suffix,
+			replaceAliases
+		);
+		aliased |= DeAliasFieldToBuffer(
+			parseCandidate.postdir, 
+			sizeof(parseCandidate.postdir),
+			directionalAliasTable,
+			postdir,
+			replaceAliases
+		);
+		DeAliasFieldToBuffer(
+			parseCandidate.unitDesignator, 
+			sizeof(parseCandidate.unitDesignator),
+			unitDesignatorAliasTable,
+			unitDesignator,
+			replaceAliases
+		);
+		if (aliased) {
+			parseCandidate.permutations |= AddressParserFirstLine::PermuteAlias;
+		}
+
+		CopyNormalizedField(parseCandidate.number, sizeof(parseCandidate.number), number);
+		CopyNormalizedField(parseCandidate.street, sizeof(parseCandidate.street), street);
+		CopyNormalizedField(parseCandidate.unitNumber, sizeof(parseCandidate.unitNumber), unitNumber);
+
+		// Components that cannot be supplied separately
+		parseCandidate.prefix[0] = 0;
+		parseCandidate.pmbDesignator[0] = 0;
+		parseCandidate.pmbNumber[0] = 0;
+		parseCandidate.predir2[0] = 0;
+		parseCandidate.street2[0] = 0;
+		parseCandidate.suffix2[0] = 0;
+		parseCandidate.postdir2[0] = 0;
+
+		return parseCandidate.street[0] != 0;
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Fill the assembly trie with the proper assemBridging structs
 	//////////////////////////////////////////////////////////////////////
@@ -489,22 +614,22 @@ namespace PortfolioExplorer {
 		SymbolFlagMapRef symbol;
 		int flags;
 		for(it = addressParse.begin(); it != addressParse.end(); it++) {
-			tmp = assemblyTrie.Find((*it).token_class.c_str());
+			tmp = assemblyTrie.Find((*it).token_class);
 			if( tmp != 0 ) {
-				symbol = symbolFlagTrie.Find((*it).symbol.c_str());
+				symbol = symbolFlagTrie.Find((*it).symbol);
 				if( symbol != 0 ) {
 					flags = symbol->tokenFlag;
 				} else {
 					flags = 0;
 				}
 				// Special-case the HasDigits flag, which can't be bound to a token type.
-				for (const char* textPtr = (*it).token.c_str(); *textPtr != 0; textPtr++) {
+				for (const char* textPtr = (*it).token; *textPtr != 0; textPtr++) {
 					if (isdigit(*textPtr)) {
 						flags |= Token::HasDigit;
 						break;
 					}
 				}
-				tmp->outputList->push_back(Token((*it).token.c_str(), flags));
+				tmp->outputList->push_back(Token((*it).token, flags));
 			} else {
 				// Invalid class.  This occurs for the PMB unit designator token.
 				// Ignore it.
@@ -48,6 +48,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "AddressParserFirstLine.h"
 #include "AddressToken.h"
 #include "LookupTable.h"
+#include "ParserTableImage.h"
 #include "Global_DllExport.h"
 
 
@@ -73,10 +74,26 @@ namespace PortfolioExplorer {
 		void SetForPuertoRico(bool forPuertoRico_) { forPuertoRico = forPuertoRico_; }
 		bool GetForPuertoRico() const { return forPuertoRico; }
 
+		//////////////////////////////////////////////////////////////////////
+		// Allocate working storage from the given allocator rather than one
+		// of the parser's own.  The caller owns it and resets it between
+		// addresses; the parser never does.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetBulkAllocator(const BulkAllocatorRef& bulkAllocator_) { sharedAllocator = bulkAllocator_; }
+
+		//////////////////////////////////////////////////////////////////////
+		// Load the tables from the given image, already opened by the
+		// caller, when Open() is not passed one.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetParserTableImage(const ParserTableImageRef& image) { sharedImage = image; }
+
 		//////////////////////////////////////////////////////////////////////
 		// Initialize the address parser.
 		// Inputs:
 		//	const TsString&	dataDir		The directory containing data files.
+		//	ParserTableImageRef	image	Source of pre-built tables.  If zero,
+		//								the shared image is used if set, and
+		//								otherwise the image in dataDir if present.
 		// Outputs:
 		//	std::String&		errorMsg	The message if an error occured.
 		// Return value:
@@ -84,7 +101,8 @@ namespace PortfolioExplorer {
 		//////////////////////////////////////////////////////////////////////
 		bool Open(
 			const TsString& dataDir,
-			TsString& errorMsg
+			TsString& errorMsg,
+			ParserTableImageRef image = 0
 		);
 
 		///////////////////////////////////////////////////////////////////////////////
@@ -102,6 +120,22 @@ namespace PortfolioExplorer {
 			bool replaceAliases
 		);
 
+		//////////////////////////////////////////////////////////////////////
+		// Build a parse candidate from address components that the caller
+		// has already separated.
+		//////////////////////////////////////////////////////////////////////
+		bool ParseFields(
+			const char* number,
+			const char* predir,
+			const char* street,
+			const char* suffix,
+			const char* postdir,
+			const char* unitDesignator,
+			const char* unitNumber,
+			AddressParserFirstLine::ParseCandidate& parseCandidate, 
+			bool replaceAliases
+		);
+
 		//////////////////////////////////////////////////////////////////////
 		// Perform permutations on the address.
 		// Inputs:
@@ -161,7 +195,7 @@ namespace PortfolioExplorer {
 
 		//Struct to assist in assembling parsed address tokens into address
 		struct AssemBridging : public VRefCount {
-			AssemBridging(TsString tokenClass_, TokenList* outputList_) :
+			AssemBridging(const TsString& tokenClass_, TokenList* outputList_) :
 				tokenClass(tokenClass_), outputList(outputList_)
 			{}
 			~AssemBridging() {}
@@ -178,7 +212,7 @@ namespace PortfolioExplorer {
 
 		//Struct to assist in setting token flags based on symbol
 		struct SymbolFlagMap : public VRefCount {
-			SymbolFlagMap(TsString symbol_, int tokenFlag_) :
+			SymbolFlagMap(const TsString& symbol_, int tokenFlag_) :
 				symbol(symbol_), tokenFlag(tokenFlag_)
 			{}
 			~SymbolFlagMap() {}
@@ -323,6 +357,10 @@ namespace PortfolioExplorer {
 
 		// Object used to allocate memory for token text.
 		BulkAllocatorRef bulkAllocator;
+		// The caller's allocator, if it is shared
+		BulkAllocatorRef sharedAllocator;
+		// The caller's table image, if it is shared
+		ParserTableImageRef sharedImage;
 
 		VectorNoDestruct<TokSymCls> addressParse;
 		Trie<AssemBridgingRef> assemblyTrie;
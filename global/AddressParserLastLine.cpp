@@ -59,6 +59,20 @@ namespace PortfolioExplorer {
 		delete [] errorMsgPtr;
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Share the caller's allocator (must be done before Open())
+	//////////////////////////////////////////////////////////////////////
+	void AddressParserLastLine::SetBulkAllocator(const BulkAllocatorRef& bulkAllocator) {
+		imp->SetBulkAllocator(bulkAllocator);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Share the caller's table image (must be done before Open())
+	//////////////////////////////////////////////////////////////////////
+	void AddressParserLastLine::SetParserTableImage(const ParserTableImageRef& image) {
+		imp->SetParserTableImage(image);
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Initialize the address parser.
 	// Inputs:
@@ -106,6 +120,20 @@ namespace PortfolioExplorer {
 		return imp->Parse(addressLine, parseCandidate, replaceAliases);
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Build a parse candidate from a city, state and postcode that the
+	// caller has already separated.
+	//////////////////////////////////////////////////////////////////////
+	bool AddressParserLastLine::ParseFields(
+		const char* city,
+		const char* state,
+		const char* postcode,
+		AddressParserLastLine::ParseCandidate& parseCandidate, 
+		bool replaceAliases
+	) {
+		return imp->ParseFields(city, state, postcode, parseCandidate, replaceAliases);
+	}
+
 
 
 	//////////////////////////////////////////////////////////////////////
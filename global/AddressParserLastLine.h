@@ -37,6 +37,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include "RefPtr.h"
+#include "BulkAllocator.h"
+#include "ParserTableImage.h"
 #include "Global_DllExport.h"
 
 namespace PortfolioExplorer {
@@ -89,6 +91,22 @@ namespace PortfolioExplorer {
 		//////////////////////////////////////////////////////////////////////
 		virtual ~AddressParserLastLine();
 
+		//////////////////////////////////////////////////////////////////////
+		// Allocate working storage from the given allocator rather than one
+		// of the parser's own, so that one allocator serves a whole request.
+		// The caller owns it and must Reset() it between addresses; the
+		// parser never does.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetBulkAllocator(const BulkAllocatorRef& bulkAllocator);
+
+		//////////////////////////////////////////////////////////////////////
+		// Load the tables from an image the caller has opened, so that
+		// parsers opened together read the image file once.  Without one,
+		// Open() opens the image in the data directory itself.  Must be done
+		// before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetParserTableImage(const ParserTableImageRef& image);
+
 		//////////////////////////////////////////////////////////////////////
 		// Initialize the address parser.
 		// Inputs:
@@ -121,6 +139,32 @@ namespace PortfolioExplorer {
 			bool replaceAliases
 		);
 
+		//////////////////////////////////////////////////////////////////////
+		// Build a parse candidate from a city, state and postcode that the
+		// caller has already separated.  No tokenizing is done; the 
+		// components are converted to upper case, a ZIP+4 or six-character
+		// Canadian postcode is split into postcode and extension, and if
+		// requested the state is replaced by its standard abbreviation.
+		// No permutations are available afterwards.
+		// Inputs:
+		//	const char*			city				city name
+		//	const char*			state				state name or abbreviation
+		//	const char*			postcode			postcode, with or without extension
+		//	bool				replaceAliases		substitute standard aliases
+		// Any component may be null.
+		// Outputs:
+		//	ParseCandidate&		parseCandidate		The resulting parsed address
+		// Return value:
+		//	bool				true on success, false if all components are empty.
+		//////////////////////////////////////////////////////////////////////
+		bool ParseFields(
+			const char* city,
+			const char* state,
+			const char* postcode,
+			ParseCandidate& parseCandidate, 
+			bool replaceAliases
+		);
+
 		// Permuation flags
 		enum {
 			PermuteShortenLongCityName = 0x1,
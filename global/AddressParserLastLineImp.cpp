@@ -61,6 +61,9 @@ namespace PortfolioExplorer {
 	// Initialize the address parser.
 	// Inputs:
 	//	const TsString&	dataDir		The directory containing data files.
+	//	ParserTableImageRef	image	Source of pre-built tables.  If zero,
+	//								the shared image is used if set, and
+	//								otherwise the image in dataDir if present.
 	// Outputs:
 	//	std::String&		errorMsg	The message if an error occured.
 	// Return value:
@@ -68,29 +71,38 @@ namespace PortfolioExplorer {
 	//////////////////////////////////////////////////////////////////////
 	bool AddressParserLastLineImp::Open(
 		const TsString& dataDir_,
-		TsString& errorMsg
+		TsString& errorMsg,
+		ParserTableImageRef image
 	) {
 		dataDir = dataDir_;
 
-		bulkAllocator = new BulkAllocator;
+		bulkAllocator = sharedAllocator != 0 ? sharedAllocator : new BulkAllocator;
+
+		if (image == 0) {
+			image = sharedImage;
+		}
+		if (image == 0) {
+			// No image is fine; tables are read from their files.
+			TsString imageErrorMsg;
+			image = new ParserTableImage;
+			image->Open(dataDir, imageErrorMsg);
+		}
 
 		// Load alias translation tables and lexicons
 
 		// state aliases
-		stateAliasTable = new LookupTable;
-		if (!stateAliasTable->LoadFromFile(dataDir + "/" + stateAliasFile, errorMsg)) {
+		if (!image->LoadLookupTable(stateAliasFile, stateAliasTable, errorMsg)) {
 			Close();
 			return false;
 		}
 
 		// city component aliases.
-		cityComponentAliasTable = new LookupTable;
-		if (!cityComponentAliasTable->LoadFromFile(dataDir + "/" + cityComponentAliasFile, errorMsg)) {
+		if (!image->LoadLookupTable(cityComponentAliasFile, cityComponentAliasTable, errorMsg)) {
 			// This is OK,  This table is optional.
 		}
 
 		addressTokenizer = new AddressTokenizer();
-		if (!addressTokenizer->Init(dataDir, bulkAllocator, errorMsg)) {
+		if (!addressTokenizer->Init(dataDir, bulkAllocator, errorMsg, image)) {
 			Close();
 			return false;
 		}
@@ -125,7 +137,9 @@ namespace PortfolioExplorer {
 		bool replaceAliases
 	) {
 		// Reset the allocator and free memory used by last parse
-		bulkAllocator->Reset();
+		if (sharedAllocator == 0) {
+			bulkAllocator->Reset();
+		}
 		// Clear other data structures
 		inputTokenLists.clear();
 
@@ -326,6 +340,120 @@ namespace PortfolioExplorer {
 	}
 
 
+	//////////////////////////////////////////////////////////////////////
+	// Split a numeric ZIP or ZIP+4 into the padded ZIP and the extension.
+	//////////////////////////////////////////////////////////////////////
+	void AddressParserLastLineImp::NormalizeZip(
+		const char* digits,
+		char* zip,
+		char* ext
+	) {
+		int len = int(strlen(digits));
+		if (len > 9) {
+			len = 9;
+		}
+		ext[0] = 0;
+		if (len > 5) {
+			// Drop last four characters of the ZIP
+			// Note we always subtact four because e.g. 21641234 should become 02164-1234
+			// Dropped chars become extension.
+			memcpy(ext, digits + len - 4, 4);
+			ext[4] = 0;
+			// Remaining characters become postcode
+			len -= 4;
+		}
+
+		// Pad with leading zeros up to length five
+		memset(zip, '0', 5 - len);
+		memcpy(zip + 5 - len, digits, len);
+		zip[5] = 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Build a parse candidate from a city, state and postcode that the
+	// caller has already separated.
+	// Inputs:
+	//	const char*			city				city name
+	//	const char*			state				state name or abbreviation
+	//	const char*			postcode			postcode, with or without extension
+	//	bool				replaceAliases		substitute standard aliases
+	// Outputs:
+	//	ParseCandidate&		parseCandidate		The resulting parsed address
+	// Return value:
+	//	bool				true on success, false if all components are empty.
+	//////////////////////////////////////////////////////////////////////
+	bool AddressParserLastLineImp::ParseFields(
+		const char* city,
+		const char* state,
+		const char* postcode,
+		AddressParserLastLine::ParseCandidate& parseCandidate, 
+		bool replaceAliases
+	) {
+		// Forget the last parse, so that NextAddressPermutation() returns nothing.
+		if (sharedAllocator == 0) {
+			bulkAllocator->Reset();
+		}
+		inputTokenLists.clear();
+		parsedTokens.clear();
+		nextCandidateIdx = 1;
+
+		parseCandidate.flags = AddressParserLastLine::ParseCandidate::None;
+		parseCandidate.numberOfMods = 0;
+
+		CopyNormalizedField(parseCandidate.city, sizeof(parseCandidate.city), city);
+
+		// State
+		char tmpBuf[100];
+		const char* stateAlias;
+		CopyNormalizedField(tmpBuf, sizeof(tmpBuf), state);
+		if (replaceAliases && tmpBuf[0] != 0 && stateAliasTable->Find(tmpBuf, stateAlias)) {
+			if (strlen(tmpBuf) != 2) {
+				parseCandidate.flags |= AddressParserLastLine::ParseCandidate::StateAlias;
+				parseCandidate.numberOfMods++;
+			}
+			CopyNormalizedField(parseCandidate.state, sizeof(parseCandidate.state), stateAlias);
+		} else {
+			CopyNormalizedField(parseCandidate.state, sizeof(parseCandidate.state), tmpBuf);
+		}
+
+		// Postcode: drop separators, then split off the extension.
+		CopyNormalizedField(tmpBuf, sizeof(tmpBuf), postcode);
+		char* out = tmpBuf;
+		bool allDigits = true;
+		{for (const char* in = tmpBuf; *in != 0; in++) {
+			if (*in != ' ' && *in != '-') {
+				allDigits &= ISDIGIT(*in);
+				*out++ = *in;
+			}
+		}}
+		*out = 0;
+		int length = int(out - tmpBuf);
+		if (allDigits && length > 0) {
+			// ZIP or ZIP+4, padded as Parse() pads it.
+			NormalizeZip(tmpBuf, parseCandidate.postcode, parseCandidate.postcodeExt);
+		} else {
+			int postcodeLength = length;
+			if (length == 6) {
+				postcodeLength = 3;			// Canadian FSA + LDU
+			}
+			if (postcodeLength >= int(sizeof(parseCandidate.postcode))) {
+				postcodeLength = int(sizeof(parseCandidate.postcode)) - 1;
+			}
+			memcpy(parseCandidate.postcode, tmpBuf, postcodeLength);
+			parseCandidate.postcode[postcodeLength] = 0;
+			CopyNormalizedField(
+				parseCandidate.postcodeExt, 
+				sizeof(parseCandidate.postcodeExt), 
+				tmpBuf + postcodeLength
+			);
+		}
+
+		return 
+			parseCandidate.city[0] != 0 || 
+			parseCandidate.state[0] != 0 ||
+			parseCandidate.postcode[0] != 0;
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Retrieve the next address permutation.
 	// Return value:
@@ -460,33 +588,20 @@ namespace PortfolioExplorer {
 					// Use the previous number instead
 					nIndex--;
 				}
-				char buf[10];
-				strncpy(buf, tokenList[nIndex].text, sizeof(buf));
-				buf[sizeof(buf) - 1] = 0;
-
-				int len = int(strlen(buf));
-				if (len > 5) {
-					// Drop last four characters of the ZIP
-					// Note we always subtact four because e.g. 21641234 should become 02164-1234
+				char zip[6];
+				char ext[5];
+				NormalizeZip(tokenList[nIndex].text, zip, ext);
+				if (ext[0] != 0) {
 					// Dropped chars become extension.
 					Token newToken(tokenList[nIndex]);
-					SetTokenText(newToken, buf + len - 4);
+					SetTokenText(newToken, ext);
 					parsedTokens.postcodeExt.clear();
 					parsedTokens.postcodeExt.push_back(newToken);
-					// Remaining characters become postcode
-					len -= 4;
 				}
 
-				// Pad with leading zeros up to length five
-				char buf2[6];
-				assert(len <= 5);
-				memset(buf2, '0', 5 - len);
-				memcpy(buf2 + 5 - len, buf, len);
-				buf2[5] = 0;
-
 				foundZip = true;
 				Token newToken(tokenList[nIndex]);
-				SetTokenText(newToken, buf2, 5);
+				SetTokenText(newToken, zip, 5);
 				parsedTokens.postcode.push_back(newToken);
 				nIndex--;
 				break;
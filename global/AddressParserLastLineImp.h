@@ -62,10 +62,26 @@ namespace PortfolioExplorer {
 		//////////////////////////////////////////////////////////////////////
 		virtual ~AddressParserLastLineImp();
 
+		//////////////////////////////////////////////////////////////////////
+		// Allocate working storage from the given allocator rather than one
+		// of the parser's own.  The caller owns it and resets it between
+		// addresses; the parser never does.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetBulkAllocator(const BulkAllocatorRef& bulkAllocator_) { sharedAllocator = bulkAllocator_; }
+
+		//////////////////////////////////////////////////////////////////////
+		// Load the tables from the given image, already opened by the
+		// caller, when Open() is not passed one.  Must be done before Open().
+		//////////////////////////////////////////////////////////////////////
+		void SetParserTableImage(const ParserTableImageRef& image) { sharedImage = image; }
+
 		//////////////////////////////////////////////////////////////////////
 		// Initialize the address parser.
 		// Inputs:
 		//	const TsString&	dataDir		The directory containing data files.
+		//	ParserTableImageRef	image	Source of pre-built tables.  If zero,
+		//								the shared image is used if set, and
+		//								otherwise the image in dataDir if present.
 		// Outputs:
 		//	std::String&		errorMsg	The message if an error occured.
 		// Return value:
@@ -73,7 +89,8 @@ namespace PortfolioExplorer {
 		//////////////////////////////////////////////////////////////////////
 		bool Open(
 			const TsString& dataDir,
-			TsString& errorMsg
+			TsString& errorMsg,
+			ParserTableImageRef image = 0
 		);
 
 		///////////////////////////////////////////////////////////////////////////////
@@ -91,6 +108,18 @@ namespace PortfolioExplorer {
 			bool replaceAliases
 		);
 
+		//////////////////////////////////////////////////////////////////////
+		// Build a parse candidate from a city, state and postcode that the
+		// caller has already separated.
+		//////////////////////////////////////////////////////////////////////
+		bool ParseFields(
+			const char* city,
+			const char* state,
+			const char* postcode,
+			AddressParserLastLine::ParseCandidate& parseCandidate, 
+			bool replaceAliases
+		);
+
 		//////////////////////////////////////////////////////////////////////
 		// Perform permutations on the address.
 		// Inputs:
@@ -134,6 +163,19 @@ namespace PortfolioExplorer {
 			addressTokenizer->SetTokenText(token, text, size);
 		}	
 
+		//////////////////////////////////////////////////////////////////////
+		// Split a numeric ZIP or ZIP+4 into the ZIP, padded with leading
+		// zeros to five digits, and the extension.  More than five digits
+		// means the last four are the extension, so 21641234 becomes 02164
+		// and 1234.  Digits beyond the ninth are ignored.
+		// Inputs:
+		//	const char*		digits	The ZIP, digits only, separators removed
+		// Outputs:
+		//	char*			zip		The five-digit ZIP; six bytes
+		//	char*			ext		The extension, or empty; five bytes
+		//////////////////////////////////////////////////////////////////////
+		static void NormalizeZip(const char* digits, char* zip, char* ext);
+
 		//////////////////////////////////////////////////////////////////////
 		// Stores a TokenList plus modification flags
 		//////////////////////////////////////////////////////////////////////
@@ -240,6 +282,10 @@ namespace PortfolioExplorer {
 		// Object used to allocate memory for token text.
 		// Shared with the AddressTokenizer.
 		BulkAllocatorRef bulkAllocator;
+		// The caller's allocator, if it is shared
+		BulkAllocatorRef sharedAllocator;
+		// The caller's table image, if it is shared
+		ParserTableImageRef sharedImage;
 
 		// Table of state aliases.
 		LookupTableRef stateAliasTable;
@@ -77,6 +77,8 @@ namespace PortfolioExplorer {
 	//	BulkAllocatorRef	builkAllocator
 	//									Object used to quickly allocate variable-
 	//									length memory blocks during record processing.
+	//	ParserTableImageRef	image		Source of pre-built lexicons.  If zero,
+	//									the image in dataDir is used if present.
 	// Outputs:
 	//	TsString&		errorMsg	If an error occurs during Init(), this
 	//									string will hold the error message.
@@ -86,18 +88,25 @@ namespace PortfolioExplorer {
 	bool AddressTokenizer::Init(
 		const TsString& dataDir,
 		BulkAllocatorRef bulkAllocator_,
-		TsString& errorMsg
+		TsString& errorMsg,
+		ParserTableImageRef image
 	) {
 		// Get the bulk-allocator to be used for token fragments.
 		bulkAllocator = bulkAllocator_;
 
+		if (image == 0) {
+			// No image is fine; tables are read from their files.
+			TsString imageErrorMsg;
+			image = new ParserTableImage;
+			image->Open(dataDir, imageErrorMsg);
+		}
+
 		// Load lexicons for each token type.
 		try {
 			TsString tmpStr;
 
 			// Lexicon for directionals
-			directionalsLexicon = new Lexicon;
-			if (!directionalsLexicon->LoadFromFile(dataDir + "/" + directionalsFile, tmpStr)) {
+			if (!image->LoadLexicon(directionalsFile, directionalsLexicon, tmpStr)) {
 				throw directionalsFile;
 			}
 
@@ -126,8 +135,7 @@ namespace PortfolioExplorer {
 			//}
 
 			// Lexicon for state names
-			stateNamesLexicon = new Lexicon;
-			if (!stateNamesLexicon->LoadFromFile(dataDir + "/" + stateNamesFile, tmpStr)) {
+			if (!image->LoadLexicon(stateNamesFile, stateNamesLexicon, tmpStr)) {
 				throw stateNamesFile;
 			}
 		} catch (const char* badFileName) {
@@ -39,6 +39,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "LookupTable.h"
 #include "Lexicon.h"
+#include "ParserTableImage.h"
 #include "BulkAllocator.h"
 #include "AddressToken.h"
 #include "Global_DllExport.h"
@@ -66,6 +67,8 @@ namespace PortfolioExplorer {
 		//	BulkAllocatorRef	builkAllocator
 		//									Object used to quickly allocate variable-
 		//									length memory blocks during record processing.
+		//	ParserTableImageRef	image		Source of pre-built lexicons.  If zero,
+		//									the image in dataDir is used if present.
 		// Outputs:
 		//	TsString&		errorMsg	If an error occurs during Init(), this
 		//									string will hold the error message.
@@ -75,7 +78,8 @@ namespace PortfolioExplorer {
 		bool Init(
 			const TsString& dataDir,
 			BulkAllocatorRef bulkAllocator,
-			TsString& errorMsg
+			TsString& errorMsg,
+			ParserTableImageRef image = 0
 		);
 
 		//////////////////////////////////////////////////////////////////////
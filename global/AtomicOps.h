@@ -0,0 +1,79 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// AtomicOps.h: The few atomic operations used by the lock-free structures,
+// on a long, with the memory ordering each needs.  Interlocked functions on
+// Win32; GCC __atomic builtins elsewhere, so that C++03 compilers work.
+
+#ifndef INCL_ATOMICOPS_H
+#define INCL_ATOMICOPS_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+namespace PortfolioExplorer {
+
+#if defined(WIN32)
+	typedef volatile long AtomicLong;
+
+	// On x86, loads have acquire and stores release semantics; only the
+	// compiler must be kept from reordering them.
+	inline long AtomicLoadRelaxed(const AtomicLong& x) { return x; }
+	inline long AtomicLoadAcquire(const AtomicLong& x) { long value = x; _ReadWriteBarrier(); return value; }
+	inline void AtomicStoreRelease(AtomicLong& x, long value) { _ReadWriteBarrier(); x = value; }
+	inline long AtomicFetchAdd(AtomicLong& x, long value) { return ::InterlockedExchangeAdd(&x, value); }
+	inline bool AtomicCompareExchange(AtomicLong& x, long& expected, long desired) {
+		long old = ::InterlockedCompareExchange(&x, desired, expected);
+		if (old == expected) {
+			return true;
+		}
+		expected = old;
+		return false;
+	}
+	inline void AtomicFence() { ::MemoryBarrier(); }
+	inline void CpuRelax() { YieldProcessor(); }
+#else
+	typedef long AtomicLong;
+
+	inline long AtomicLoadRelaxed(const AtomicLong& x) { return __atomic_load_n(&x, __ATOMIC_RELAXED); }
+	inline long AtomicLoadAcquire(const AtomicLong& x) { return __atomic_load_n(&x, __ATOMIC_ACQUIRE); }
+	inline void AtomicStoreRelease(AtomicLong& x, long value) { __atomic_store_n(&x, value, __ATOMIC_RELEASE); }
+	inline long AtomicFetchAdd(AtomicLong& x, long value) { return __atomic_fetch_add(&x, value, __ATOMIC_SEQ_CST); }
+	// Acquire-release on success, so that the winner of a race sees what
+	// the previous winner published.
+	inline bool AtomicCompareExchange(AtomicLong& x, long& expected, long desired) {
+		return __atomic_compare_exchange_n(&x, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+	}
+	// Full fence, for "publish, then check for sleepers" handshakes.
+	inline void AtomicFence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+	// Hint to the processor that this is a spin-wait loop.
+	inline void CpuRelax() {
+	#if defined(__i386__) || defined(__x86_64__)
+		__asm__ __volatile__("pause");
+	#endif
+	}
+#endif
+
+}
+
+#endif
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "Global_Headers.h"
 #include "BulkAllocator.h"
+#include <algorithm>
 
 namespace PortfolioExplorer {
 
@@ -38,38 +39,180 @@ namespace PortfolioExplorer {
 		int blockSize_
 	) : 
 		blockSize(blockSize_),
-		maxFragmentSize(blockSize_ / 8)
+		maxFragmentSize(blockSize_ / 8),
+		nbrBlocksUsed(1),
+		largeBytesInUse(0),
+		largeBytesReserved(0),
+		highWater(0),
+		resets(0),
+		heapAllocations(1),
+		largeReused(0),
+		resetsSinceTrim(0),
+		blocksNeeded(1),
+		largeClassesNeeded(0)
 	{
 		lastBlock = new Block(blockSize);
 		blocks.push_back(lastBlock);
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Destructor
+	///////////////////////////////////////////////////////////////////////////////
+	BulkAllocator::~BulkAllocator()
+	{
+		Trim();
+	}
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Out-of-line version of New()
 	///////////////////////////////////////////////////////////////////////////////
 	void* BulkAllocator::SlowNew(size_t size)
 	{
 		if (size > maxFragmentSize) {
-			// Allocate using new
-			char* ptr = new char[size];
-			// Remember to delete it at the end.
-			allocations.push_back(ptr);
-			return ptr;
+			return NewLarge(size);
 		}
 
-		// Try to allocate from existing blocks.
-		for (unsigned i = 0; i < blocks.size(); i++) {
+		// Try to allocate from the blocks in use.
+		for (unsigned i = 0; i < nbrBlocksUsed; i++) {
 			if (size <= blocks[i]->Available()) {
 				return blocks[i]->New(size);
 			}
 		}
 
-		// Get a new block and allocate from that.
-		lastBlock = new Block(blockSize);
-		blocks.push_back(lastBlock);
+		// Move on to a spare block, or get a new one.
+		if (nbrBlocksUsed < blocks.size()) {
+			lastBlock = blocks[nbrBlocksUsed];
+			lastBlock->Reset();
+		} else {
+			lastBlock = new Block(blockSize);
+			blocks.push_back(lastBlock);
+			heapAllocations++;
+		}
+		nbrBlocksUsed++;
 		return lastBlock->New(size);
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Allocate a request too large for a block.  It is rounded up to its size
+	// class, so that the buffer can be reused for any request of that class.
+	///////////////////////////////////////////////////////////////////////////////
+	void* BulkAllocator::NewLarge(size_t size)
+	{
+		LargeBuffer buffer;
+		buffer.sizeClass = -1;
+		buffer.size = size;
+		for (int sizeClass = 0; sizeClass < NbrSizeClasses; sizeClass++) {
+			size_t classSize = maxFragmentSize << (sizeClass + 1);
+			if (size <= classSize) {
+				buffer.sizeClass = sizeClass;
+				buffer.size = classSize;
+				break;
+			}
+		}
+
+		if (buffer.sizeClass >= 0 && !freeLarge[buffer.sizeClass].empty()) {
+			buffer.ptr = freeLarge[buffer.sizeClass].back();
+			freeLarge[buffer.sizeClass].pop_back();
+			largeReused++;
+		} else {
+			buffer.ptr = new char[buffer.size];
+			largeBytesReserved += buffer.size;
+			heapAllocations++;
+		}
+		if (buffer.sizeClass >= 0) {
+			largeClassesNeeded |= 1u << buffer.sizeClass;
+		}
+		largeBytesInUse += buffer.size;
+		allocations.push_back(buffer);
+		return buffer.ptr;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Free all memory, keeping the blocks and large buffers for reuse.
+	///////////////////////////////////////////////////////////////////////////////
+	void BulkAllocator::Reset()
+	{
+		highWater = std::max(highWater, BytesInUse());
+		blocksNeeded = std::max(blocksNeeded, nbrBlocksUsed);
+		resets++;
+
+		blocks[0]->Reset();
+		nbrBlocksUsed = 1;
+		lastBlock = blocks[0];
+		for (unsigned i = 0; i < allocations.size(); i++) {
+			const LargeBuffer& buffer = allocations[i];
+			if (buffer.sizeClass >= 0) {
+				freeLarge[buffer.sizeClass].push_back(buffer.ptr);
+			} else {
+				delete [] buffer.ptr;
+				largeBytesReserved -= buffer.size;
+			}
+		}
+		allocations.clear();
+		largeBytesInUse = 0;
+
+		// Give back what the last interval did without.
+		if (++resetsSinceTrim == TrimInterval) {
+			if (blocks.size() > blocksNeeded) {
+				blocks.resize(blocksNeeded);
+			}
+			FreeLarge(largeClassesNeeded);
+			resetsSinceTrim = 0;
+			blocksNeeded = 1;
+			largeClassesNeeded = 0;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Free all memory, and give back everything but the first block.
+	///////////////////////////////////////////////////////////////////////////////
+	void BulkAllocator::Trim()
+	{
+		Reset();
+		blocks.resize(1);
+		FreeLarge(0);
+		resetsSinceTrim = 0;
+		blocksNeeded = 1;
+		largeClassesNeeded = 0;
+	}
+
+	void BulkAllocator::FreeLarge(unsigned keepClasses)
+	{
+		for (int sizeClass = 0; sizeClass < NbrSizeClasses; sizeClass++) {
+			if ((keepClasses & (1u << sizeClass)) != 0) {
+				continue;
+			}
+			std::vector<char*>& buffers = freeLarge[sizeClass];
+			for (unsigned i = 0; i < buffers.size(); i++) {
+				delete [] buffers[i];
+			}
+			largeBytesReserved -= buffers.size() * (maxFragmentSize << (sizeClass + 1));
+			buffers.clear();
+		}
+	}
+
+	size_t BulkAllocator::BytesInUse() const
+	{
+		size_t bytes = largeBytesInUse;
+		for (unsigned i = 0; i < nbrBlocksUsed; i++) {
+			bytes += blocks[i]->Used();
+		}
+		return bytes;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Get the usage figures.
+	///////////////////////////////////////////////////////////////////////////////
+	void BulkAllocator::GetStats(Stats& statsReturn) const
+	{
+		statsReturn.bytesInUse = BytesInUse();
+		statsReturn.highWater = std::max(highWater, statsReturn.bytesInUse);
+		statsReturn.bytesReserved = blocks.size() * blockSize + largeBytesReserved;
+		statsReturn.resets = resets;
+		statsReturn.heapAllocations = heapAllocations;
+		statsReturn.largeReused = largeReused;
+	}
+
 	// Table for 4-byte alignment
 	int BulkAllocator::Roundup[4] = { 0, 3, 2, 1 };
 
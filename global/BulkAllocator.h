@@ -43,6 +43,17 @@ namespace PortfolioExplorer {
 
 	class BulkAllocator : public VRefCount {
 	public:
+		// Usage figures, for choosing the block size and checking that
+		// memory is recycled rather than taken from the heap.
+		struct Stats {
+			size_t bytesInUse;				// allocated since the last Reset()
+			size_t highWater;				// most bytes in use between Resets
+			size_t bytesReserved;			// held in blocks and large buffers
+			unsigned long resets;			// calls to Reset()
+			unsigned long heapAllocations;	// blocks and large buffers from new
+			unsigned long largeReused;		// large requests met by a recycled buffer
+		};
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Constructor
 		// Inputs:
@@ -53,9 +64,7 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////////
 		// Destructor
 		///////////////////////////////////////////////////////////////////////////////
-		virtual ~BulkAllocator() {
-			Reset();
-		}
+		virtual ~BulkAllocator();
 
 		///////////////////////////////////////////////////////////////////////////////
 		// Allocate some memory
@@ -80,25 +89,42 @@ namespace PortfolioExplorer {
 		}
 
 		///////////////////////////////////////////////////////////////////////////////
-		// Free all memory, but keep first allocated block around because we
-		// are going to do more allocation
+		// Free all memory.  The blocks and large buffers are kept for the
+		// allocations that follow, so a steady load allocates nothing from
+		// the heap.  Those that have not been needed for TrimInterval resets
+		// are given back.
 		///////////////////////////////////////////////////////////////////////////////
-		void Reset() {
-			lastBlock = blocks[0];
-			blocks.resize(1);
-			blocks[0]->Reset();
-			for (unsigned i = 0; i < allocations.size(); i++) {
-				delete [] allocations[i];
-			}
-			allocations.clear();
-		}
+		void Reset();
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Free all memory, and give back everything but the first block.
+		///////////////////////////////////////////////////////////////////////////////
+		void Trim();
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Get the usage figures.  highWater includes the current use.
+		///////////////////////////////////////////////////////////////////////////////
+		void GetStats(Stats& statsReturn) const;
 
 	private:
+		// Copy/assign not allowed
+		BulkAllocator(const BulkAllocator& rhs);
+		BulkAllocator& operator=(const BulkAllocator& rhs);
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Out-of-line version of New()
 		///////////////////////////////////////////////////////////////////////////////
 		void* SlowNew(size_t size);
 
+		// Allocate a request too large for a block, reusing a buffer if possible.
+		void* NewLarge(size_t size);
+
+		// Give back the recycled large buffers of the size classes not in keepClasses.
+		void FreeLarge(unsigned keepClasses);
+
+		// Bytes allocated since the last Reset()
+		size_t BytesInUse() const;
+
 		// Data structure describing a block
 		class Block : public VRefCount {
 		public:
@@ -110,6 +136,7 @@ namespace PortfolioExplorer {
 			}
 			virtual ~Block() { delete [] ptr; }
 			size_t Available() const { return endPtr - current; }
+			size_t Used() const { return current - ptr; }
 			void* New(size_t amount) { 
 				assert(amount <= Available());
 				void* p = current;
@@ -127,16 +154,45 @@ namespace PortfolioExplorer {
 		};
 		typedef refcnt_ptr<Block> BlockRef;
 
+		// A request too large for a block.  Buffers of size class c hold
+		// up to maxFragmentSize << (c + 1) bytes; larger ones have class -1
+		// and are not recycled.
+		struct LargeBuffer {
+			char* ptr;
+			int sizeClass;
+			size_t size;
+		};
+		enum { NbrSizeClasses = 16 };
+		// Resets between releases of memory that was not needed
+		enum { TrimInterval = 1024 };
+
 		// Block size
 		size_t blockSize;
 		// Largest fragment to be allocated from a block
 		size_t maxFragmentSize;
-		// List of active blocks
+		// List of blocks.  The first nbrBlocksUsed have been allocated from
+		// since the last Reset(); the rest are spares.
 		std::vector<BlockRef> blocks;
-		// The last block in the list
+		size_t nbrBlocksUsed;
+		// The block being allocated from
 		BlockRef lastBlock;
-		// List of allocations that were made with new because they were too large.
-		std::vector<char*> allocations;
+		// Large buffers allocated since the last Reset().
+		std::vector<LargeBuffer> allocations;
+		// Recycled large buffers, by size class
+		std::vector<char*> freeLarge[NbrSizeClasses];
+
+		// Statistics
+		size_t largeBytesInUse;
+		size_t largeBytesReserved;
+		size_t highWater;
+		unsigned long resets;
+		unsigned long heapAllocations;
+		unsigned long largeReused;
+
+		// Needs over the current trim interval
+		unsigned long resetsSinceTrim;
+		size_t blocksNeeded;
+		unsigned largeClassesNeeded;
 
 		// Table for 4-byte alignment
 		static int Roundup[4];
@@ -0,0 +1,248 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// CritSec.cpp: Lock slow paths, event counts, and the list of named locks
+
+#include "Global_Headers.h"
+#include "CritSec.h"
+#include <algorithm>
+#include <limits.h>
+
+#if defined(CRITSEC_USE_FUTEX)
+	#include <unistd.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+#endif
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////
+	// The list of named locks.  The lock guarding it is itself unnamed, so
+	// it is not on the list.  It is created by the first named lock, which
+	// in practice is during single-threaded startup.
+	///////////////////////////////////////////////////////////////////////////
+	static LockCounters* namedLocks = 0;
+
+	static CritSecInfo& NamedLocksLock()
+	{
+		static CritSecInfo lock;
+		return lock;
+	}
+
+	LockCounters::LockCounters(const char* name, bool readerWriter) :
+		m_name(name),
+		m_readerWriter(readerWriter),
+		m_acquisitions(0),
+		m_contended(0),
+		m_waits(0),
+		m_sharedAcquisitions(0),
+		m_sharedContended(0),
+		m_prev(0),
+		m_next(0)
+	{
+		if (m_name != 0) {
+			CritSec critSec(NamedLocksLock());
+			m_next = namedLocks;
+			if (m_next != 0) {
+				m_next->m_prev = this;
+			}
+			namedLocks = this;
+		}
+	}
+
+	LockCounters::~LockCounters()
+	{
+		if (m_name != 0) {
+			CritSec critSec(NamedLocksLock());
+			if (m_prev != 0) {
+				m_prev->m_next = m_next;
+			} else {
+				namedLocks = m_next;
+			}
+			if (m_next != 0) {
+				m_next->m_prev = m_prev;
+			}
+		}
+	}
+
+	void LockCounters::GetStats(LockStats& statsReturn) const
+	{
+		statsReturn.name = m_name;
+		statsReturn.readerWriter = m_readerWriter;
+		statsReturn.acquisitions = Load(m_acquisitions);
+		statsReturn.contended = Load(m_contended);
+		statsReturn.waits = Load(m_waits);
+		statsReturn.sharedAcquisitions = Load(m_sharedAcquisitions);
+		statsReturn.sharedContended = Load(m_sharedContended);
+	}
+
+	static bool MoreContended(const LockStats& lhs, const LockStats& rhs)
+	{
+		return lhs.contended + lhs.sharedContended > rhs.contended + rhs.sharedContended;
+	}
+
+	void LockCounters::GetAllStats(std::vector<LockStats>& statsReturn)
+	{
+		statsReturn.clear();
+		{
+			CritSec critSec(NamedLocksLock());
+			for (LockCounters* lock = namedLocks; lock != 0; lock = lock->m_next) {
+				LockStats stats;
+				lock->GetStats(stats);
+				statsReturn.push_back(stats);
+			}
+		}
+		std::stable_sort(statsReturn.begin(), statsReturn.end(), MoreContended);
+	}
+
+#if defined(CRITSEC_USE_FUTEX)
+	// Number of times to poll a held lock before sleeping.  A poll with the
+	// pause instruction takes tens of nanoseconds, so this covers a short
+	// critical section without wasting a time slice on a long one.
+	static const int spinCount = 100;
+
+	void CritSecInfo::LockContended()
+	{
+		// Spin while the holder is running and no one is asleep.
+		for (int spin = 0; spin < spinCount; spin++) {
+			CpuRelax();
+			int state = __atomic_load_n(&m_state, __ATOMIC_RELAXED);
+			if (state == 0) {
+				int expected = 0;
+				if (__atomic_compare_exchange_n(&m_state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+					CountContended();
+					return;
+				}
+			} else if (state == 2) {
+				break;
+			}
+		}
+		// Mark the lock as having sleepers and sleep until it is released.
+		// The lock is left marked when acquired here, as other threads may
+		// still be asleep; that costs at most one unneeded wake-up.
+		long waits = 0;
+		while (__atomic_exchange_n(&m_state, 2, __ATOMIC_ACQUIRE) != 0) {
+			syscall(SYS_futex, &m_state, FUTEX_WAIT_PRIVATE, 2, 0, 0, 0);
+			waits++;
+		}
+		CountContended();
+		CountWaits(waits);
+	}
+
+	void CritSecInfo::WakeOne()
+	{
+		syscall(SYS_futex, &m_state, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+	}
+#endif
+
+	EventCount::EventCount() : m_epoch(0)
+	{
+#if defined(WIN32)
+		::InitializeCriticalSection(&m_criticalSection);
+		::InitializeConditionVariable(&m_condition);
+#elif defined(CRITSEC_USE_PTHREAD)
+		pthread_mutex_init(&m_mutex, 0);
+		pthread_cond_init(&m_condition, 0);
+#endif
+	}
+
+	EventCount::~EventCount()
+	{
+#if defined(WIN32)
+		::DeleteCriticalSection(&m_criticalSection);
+#elif defined(CRITSEC_USE_PTHREAD)
+		pthread_cond_destroy(&m_condition);
+		pthread_mutex_destroy(&m_mutex);
+#endif
+	}
+
+	void EventCount::Wait(long key)
+	{
+#if defined(WIN32)
+		::EnterCriticalSection(&m_criticalSection);
+		while (AtomicLoadAcquire(m_epoch) == key) {
+			::SleepConditionVariableCS(&m_condition, &m_criticalSection, INFINITE);
+		}
+		::LeaveCriticalSection(&m_criticalSection);
+#elif defined(CRITSEC_USE_FUTEX)
+		// The futex word is the low 32 bits of the epoch.  FUTEX_WAIT
+		// returns at once if it no longer holds the key.
+		int* word = reinterpret_cast<int*>(&m_epoch);
+	#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		word += sizeof(long) / sizeof(int) - 1;
+	#endif
+		while (AtomicLoadAcquire(m_epoch) == key) {
+			syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, int(key), 0, 0, 0);
+		}
+#else
+		pthread_mutex_lock(&m_mutex);
+		while (AtomicLoadAcquire(m_epoch) == key) {
+			pthread_cond_wait(&m_condition, &m_mutex);
+		}
+		pthread_mutex_unlock(&m_mutex);
+#endif
+	}
+
+	void EventCount::WakeAll()
+	{
+#if defined(WIN32)
+		// Taking the lock orders the wake after any waiter's epoch check.
+		::EnterCriticalSection(&m_criticalSection);
+		::WakeAllConditionVariable(&m_condition);
+		::LeaveCriticalSection(&m_criticalSection);
+#elif defined(CRITSEC_USE_FUTEX)
+		int* word = reinterpret_cast<int*>(&m_epoch);
+	#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		word += sizeof(long) / sizeof(int) - 1;
+	#endif
+		syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+#else
+		pthread_mutex_lock(&m_mutex);
+		pthread_cond_broadcast(&m_condition);
+		pthread_mutex_unlock(&m_mutex);
+#endif
+	}
+
+	RWCritSecInfo::RWCritSecInfo(const char* name) : LockCounters(name, true)
+	{
+#if defined(WIN32)
+		::InitializeSRWLock(&m_lock);
+#else
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init(&attr);
+	#if defined(__GLIBC__)
+		// glibc lets new readers pass a waiting writer by default.
+		pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	#endif
+		pthread_rwlock_init(&m_lock, &attr);
+		pthread_rwlockattr_destroy(&attr);
+#endif
+	}
+
+	RWCritSecInfo::~RWCritSecInfo()
+	{
+#if !defined(WIN32)
+		pthread_rwlock_destroy(&m_lock);
+#endif
+	}
+
+}
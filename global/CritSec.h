@@ -32,15 +32,122 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // class TMutex<TCriticalSection>
 // typdef TMutex<SrcCriticalSection> SrcMutex
 // typdef TMutex<CCriticalSection> Mutex
+// class RWCritSecInfo
+// class SharedCritSec, ExclusiveCritSec
+// class EventCount
 //
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifndef __MUTEX_H__
 #define __MUTEX_H__
 
+#include <vector>
+#include "AtomicOps.h"
+
+// Lock implementation.  Linux uses a futex; other UNIX systems use pthreads.
+#if defined(WIN32)
+	// CRITICAL_SECTION and SRWLOCK, from windows.h
+#elif defined(__linux__)
+	#define CRITSEC_USE_FUTEX
+	#include <pthread.h>
+#else
+	#define CRITSEC_USE_PTHREAD
+	#include <pthread.h>
+#endif
+
 namespace PortfolioExplorer
 {
 
+//*****************************************************************************
+//*
+//*	struct LockStats
+//*
+//* Counters of one lock, to find the locks that threads wait on under load.
+//* A contended acquisition is one that found the lock held.
+//*
+//*****************************************************************************
+struct LockStats {
+	const char* name;				// Name given to the lock, or 0
+	bool readerWriter;				// RWCritSecInfo rather than CritSecInfo?
+	long acquisitions;				// Exclusive acquisitions
+	long contended;					// ... that found the lock held
+	long waits;						// Times a thread slept on the lock (futex only)
+	long sharedAcquisitions;		// Shared acquisitions of a reader-writer lock
+	long sharedContended;			// ... that found the lock held
+};
+
+//*****************************************************************************
+//*
+//*	class LockCounters
+//*
+//* Contention counters, common to CritSecInfo and RWCritSecInfo.  A lock
+//* constructed with a name is also entered in a process-wide list, which
+//* GetAllStats() reports.  The name is not copied; use a string literal.
+//*
+//* The exclusive counters are only updated while the lock is held, so they
+//* cost a plain store.  The shared counters are updated atomically.  Reading
+//* the counters of a busy lock gives a recent, not an exact, value.
+//*
+//*****************************************************************************
+class LockCounters
+{
+private:
+	// Copy ctor and op= are not implemented.
+	LockCounters(const LockCounters & );
+	LockCounters & operator=(const LockCounters & );
+
+public:
+	const char* GetName() const { return m_name; }
+
+	// Get the counters of this lock.
+	void GetStats(LockStats& statsReturn) const;
+
+	///////////////////////////////////////////////////////////////////////////
+	// Get the counters of every named lock in the process.
+	// Outputs:
+	//	std::vector<LockStats>&	statsReturn		One entry per lock, most
+	//											contended first
+	///////////////////////////////////////////////////////////////////////////
+	static void GetAllStats(std::vector<LockStats>& statsReturn);
+
+protected:
+	LockCounters(const char* name, bool readerWriter);
+	~LockCounters();
+
+	// Call with the lock held exclusively.
+	inline void CountExclusive() { Store(m_acquisitions, Load(m_acquisitions) + 1); }
+	inline void CountContended() { Store(m_contended, Load(m_contended) + 1); }
+	inline void CountWaits(long waits) { Store(m_waits, Load(m_waits) + waits); }
+	// Call with the lock held shared.
+	inline void CountShared() { Add(m_sharedAcquisitions); }
+	inline void CountSharedContended() { Add(m_sharedContended); }
+
+private:
+#if defined(WIN32)
+	static inline long Load(const volatile long& x) { return x; }
+	static inline void Store(volatile long& x, long value) { x = value; }
+	static inline void Add(volatile long& x) { ::InterlockedIncrement(&x); }
+	typedef volatile long Counter;
+#else
+	static inline long Load(const long& x) { return __atomic_load_n(&x, __ATOMIC_RELAXED); }
+	static inline void Store(long& x, long value) { __atomic_store_n(&x, value, __ATOMIC_RELAXED); }
+	static inline void Add(long& x) { __atomic_fetch_add(&x, 1, __ATOMIC_RELAXED); }
+	typedef long Counter;
+#endif
+
+	const char* m_name;
+	bool m_readerWriter;
+	Counter m_acquisitions;
+	Counter m_contended;
+	Counter m_waits;
+	Counter m_sharedAcquisitions;
+	Counter m_sharedContended;
+
+	// Links in the list of named locks
+	LockCounters* m_prev;
+	LockCounters* m_next;
+};
+
 //*****************************************************************************
 //*
 //*	class SrcCriticalSection
@@ -48,8 +155,18 @@ namespace PortfolioExplorer
 //* A wrapper for a Windows CRITICAL_SECTION object, handling initialization 
 //* and deletion automatically in the ctor and dtor.  
 //*
+//* On Linux, a futex-based mutex: the lock word is 0 when free, 1 when held,
+//* and 2 when held with threads possibly asleep on it.  An uncontended Lock()
+//* or Unlock() is a single atomic instruction with no system call.  A thread
+//* that finds the lock held spins briefly before sleeping in the kernel, as
+//* the critical sections guarded here are short.
+//*
+//* Like a CRITICAL_SECTION, the lock is recursive on every platform: the
+//* thread holding it may lock it again, and must unlock it as many times.
+//* File::Open(), for one, calls Close() with the lock held.
+//*
 //*****************************************************************************
-class CritSecInfo
+class CritSecInfo : public LockCounters
 {
 private:
 	// Copy ctor and op= are not implemented.
@@ -57,27 +174,76 @@ private:
 	CritSecInfo & operator=(const CritSecInfo & );
 
 public:
-	inline CritSecInfo() { 
+	///////////////////////////////////////////////////////////////////////////
+	// Inputs:
+	//	const char*		name		If not 0, report this lock's counters
+	//								in LockCounters::GetAllStats()
+	///////////////////////////////////////////////////////////////////////////
+	inline CritSecInfo(const char* name = 0) : LockCounters(name, false) { 
 #if defined(WIN32)
 	  ::InitializeCriticalSection( &m_criticalSection); 
+#elif defined(CRITSEC_USE_FUTEX)
+	  m_state = 0;
+	  m_owner = 0;
+	  m_recursion = 0;
+#else
+	  pthread_mutexattr_t attr;
+	  pthread_mutexattr_init(&attr);
+	  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	  pthread_mutex_init(&m_mutex, &attr);
+	  pthread_mutexattr_destroy(&attr);
 #endif
 	}
 
 	inline ~CritSecInfo() { 
 #if defined(WIN32)
 	  ::DeleteCriticalSection(&m_criticalSection);
+#elif defined(CRITSEC_USE_PTHREAD)
+	  pthread_mutex_destroy(&m_mutex);
 #endif
 	}
 	inline void Lock() { 
-
 #if defined(WIN32)
-	  ::EnterCriticalSection( &m_criticalSection);
+	  if (!::TryEnterCriticalSection( &m_criticalSection)) {
+		  ::EnterCriticalSection( &m_criticalSection);
+		  CountContended();
+	  }
+#elif defined(CRITSEC_USE_FUTEX)
+	  // Only this thread can have stored its own ID as the owner.
+	  pthread_t self = pthread_self();
+	  if (__atomic_load_n(&m_owner, __ATOMIC_RELAXED) == self) {
+		  m_recursion++;
+		  CountExclusive();
+		  return;
+	  }
+	  int expected = 0;
+	  if (!__atomic_compare_exchange_n(&m_state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		  LockContended();
+	  }
+	  __atomic_store_n(&m_owner, self, __ATOMIC_RELAXED);
+	  m_recursion = 1;
+#else
+	  if (pthread_mutex_trylock(&m_mutex) != 0) {
+		  pthread_mutex_lock(&m_mutex);
+		  CountContended();
+	  }
 #endif
+	  CountExclusive();
 	}
 
 	inline void Unlock() { 
 #if defined(WIN32)
 	  ::LeaveCriticalSection(&m_criticalSection);
+#elif defined(CRITSEC_USE_FUTEX)
+	  if (--m_recursion != 0) {
+		  return;
+	  }
+	  __atomic_store_n(&m_owner, pthread_t(0), __ATOMIC_RELAXED);
+	  if (__atomic_exchange_n(&m_state, 0, __ATOMIC_RELEASE) == 2) {
+		  WakeOne();
+	  }
+#else
+	  pthread_mutex_unlock(&m_mutex);
 #endif
 	}
 
@@ -85,6 +251,17 @@ private:
 
 #if defined(WIN32)
 	CRITICAL_SECTION m_criticalSection;
+#elif defined(CRITSEC_USE_FUTEX)
+	// Spin, then sleep, until the lock is acquired.  Counts the
+	// contention once it holds the lock.
+	void LockContended();
+	// Wake a thread sleeping in LockContended().
+	void WakeOne();
+	int m_state;
+	pthread_t m_owner;				// Holder, or 0 when free
+	int m_recursion;				// Times the holder has locked it
+#else
+	pthread_mutex_t m_mutex;
 #endif
 
 }; // SrcCriticalSection
@@ -126,6 +303,210 @@ private:
 //*****************************************************************************
 typedef TMutex<CritSecInfo> CritSec;
 
+//*****************************************************************************
+//*
+//*	class RWCritSecInfo
+//*
+//* A shared/exclusive lock, for read-mostly structures such as caches and
+//* lookup tables: any number of threads may hold it shared at once, or one
+//* thread exclusively.  Waiting writers take precedence over new readers, so
+//* a steady stream of readers cannot starve an update.
+//*
+//* Uses an SRWLOCK on Windows and a pthread rwlock elsewhere.  Neither is
+//* recursive.
+//*
+//*****************************************************************************
+class RWCritSecInfo : public LockCounters
+{
+private:
+	// Copy ctor and op= are not implemented.
+	RWCritSecInfo(const RWCritSecInfo & );
+	RWCritSecInfo & operator=(const RWCritSecInfo & );
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// Inputs:
+	//	const char*		name		If not 0, report this lock's counters
+	//								in LockCounters::GetAllStats()
+	///////////////////////////////////////////////////////////////////////////
+	RWCritSecInfo(const char* name = 0);
+	~RWCritSecInfo();
+
+	inline void LockShared() {
+#if defined(WIN32)
+		if (!::TryAcquireSRWLockShared(&m_lock)) {
+			::AcquireSRWLockShared(&m_lock);
+			CountSharedContended();
+		}
+#else
+		if (pthread_rwlock_tryrdlock(&m_lock) != 0) {
+			pthread_rwlock_rdlock(&m_lock);
+			CountSharedContended();
+		}
+#endif
+		CountShared();
+	}
+
+	inline void UnlockShared() {
+#if defined(WIN32)
+		::ReleaseSRWLockShared(&m_lock);
+#else
+		pthread_rwlock_unlock(&m_lock);
+#endif
+	}
+
+	inline void LockExclusive() {
+#if defined(WIN32)
+		if (!::TryAcquireSRWLockExclusive(&m_lock)) {
+			::AcquireSRWLockExclusive(&m_lock);
+			CountContended();
+		}
+#else
+		if (pthread_rwlock_trywrlock(&m_lock) != 0) {
+			pthread_rwlock_wrlock(&m_lock);
+			CountContended();
+		}
+#endif
+		CountExclusive();
+	}
+
+	inline void UnlockExclusive() {
+#if defined(WIN32)
+		::ReleaseSRWLockExclusive(&m_lock);
+#else
+		pthread_rwlock_unlock(&m_lock);
+#endif
+	}
+
+private:
+#if defined(WIN32)
+	SRWLOCK m_lock;
+#else
+	pthread_rwlock_t m_lock;
+#endif
+
+}; // RWCritSecInfo
+
+//*****************************************************************************
+//*
+//*	class SharedCritSec, ExclusiveCritSec
+//*
+//* Hold an RWCritSecInfo shared or exclusively for the life of the object,
+//* as CritSec does for a CritSecInfo.
+//*
+//*****************************************************************************
+class SharedCritSec
+{
+private:
+	// Copy ctor and op= are not implemented.
+	SharedCritSec(const SharedCritSec & );
+	SharedCritSec & operator=(const SharedCritSec & );
+
+public:
+	inline SharedCritSec(RWCritSecInfo & lock) : m_lock(lock) { m_lock.LockShared(); }
+	inline ~SharedCritSec() { m_lock.UnlockShared(); }
+
+private:
+	RWCritSecInfo & m_lock;
+
+}; // SharedCritSec
+
+class ExclusiveCritSec
+{
+private:
+	// Copy ctor and op= are not implemented.
+	ExclusiveCritSec(const ExclusiveCritSec & );
+	ExclusiveCritSec & operator=(const ExclusiveCritSec & );
+
+public:
+	inline ExclusiveCritSec(RWCritSecInfo & lock) : m_lock(lock) { m_lock.LockExclusive(); }
+	inline ~ExclusiveCritSec() { m_lock.UnlockExclusive(); }
+
+private:
+	RWCritSecInfo & m_lock;
+
+}; // ExclusiveCritSec
+
+//*****************************************************************************
+//*
+//*	class EventCount
+//*
+//* Lets threads sleep until a condition that is tested without a lock, such
+//* as "the queue is not empty", may have become true.  A waiter does
+//*
+//*	while (!condition) {
+//*		long key = eventCount.PrepareWait();
+//*		if (condition) {
+//*			eventCount.CancelWait();
+//*			break;
+//*		}
+//*		eventCount.Wait(key);
+//*	}
+//*
+//* and a thread that makes the condition true then calls NotifyAll().  When
+//* no thread is waiting, NotifyAll() is a fence and a load, with no system
+//* call and no write to a shared cache line.
+//*
+//* The low bit of the epoch says that a thread may be waiting.  The first
+//* NotifyAll() after it is set clears it and wakes everyone, so a burst of
+//* notifications costs one system call, not one each.
+//*
+//*****************************************************************************
+class EventCount
+{
+private:
+	// Copy ctor and op= are not implemented.
+	EventCount(const EventCount & );
+	EventCount & operator=(const EventCount & );
+
+public:
+	EventCount();
+	~EventCount();
+
+	// Announce an intent to wait.  Test the condition again afterwards.
+	inline long PrepareWait() {
+		long epoch = AtomicLoadRelaxed(m_epoch);
+		while ((epoch & 1) == 0 && !AtomicCompareExchange(m_epoch, epoch, epoch | 1)) {
+		}
+		AtomicFence();
+		return epoch | 1;
+	}
+
+	// Withdraw a PrepareWait() when the condition turned out to be true.
+	// The waiting bit is left set; it costs at most one needless wake-up.
+	inline void CancelWait() {}
+
+	// Sleep until NotifyAll() is called after the PrepareWait() that
+	// returned the key.
+	void Wait(long key);
+
+	// Wake every waiting thread.
+	inline void NotifyAll() {
+		AtomicFence();
+		long epoch = AtomicLoadRelaxed(m_epoch);
+		while ((epoch & 1) != 0) {
+			if (AtomicCompareExchange(m_epoch, epoch, epoch + 1)) {
+				WakeAll();
+				break;
+			}
+		}
+	}
+
+private:
+	void WakeAll();
+
+	// Low bit set by PrepareWait(); NotifyAll() clears it by adding 1
+	AtomicLong m_epoch;
+#if defined(WIN32)
+	CRITICAL_SECTION m_criticalSection;
+	CONDITION_VARIABLE m_condition;
+#elif defined(CRITSEC_USE_PTHREAD)
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_condition;
+#endif
+
+}; // EventCount
+
 } // namespace PortfolioExplorer
 
 
@@ -0,0 +1,130 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// ImageBuffer.h: Helpers for writing and reading the flat binary images
+// used to save pre-built tables (see ParserTableImage.h).  Integers are
+// stored little-endian regardless of the host byte order.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef INCL_IMAGEBUFFER_H
+#define INCL_IMAGEBUFFER_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif
+
+#include <vector>
+#include <string.h>
+#include "TsString.h"
+#include "Global_DllExport.h"
+
+namespace PortfolioExplorer {
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Appends binary values to a byte vector.
+	///////////////////////////////////////////////////////////////////////////////
+	class ImageWriter {
+	public:
+		ImageWriter(std::vector<unsigned char>& buffer_) : buffer(buffer_) {}
+
+		// Append a 32-bit unsigned integer
+		void PutInt(unsigned int value) {
+			buffer.push_back((unsigned char)(value));
+			buffer.push_back((unsigned char)(value >> 8));
+			buffer.push_back((unsigned char)(value >> 16));
+			buffer.push_back((unsigned char)(value >> 24));
+		}
+
+		// Append raw bytes
+		void PutBytes(const void* data, size_t size) {
+			const unsigned char* ptr = (const unsigned char*)data;
+			buffer.insert(buffer.end(), ptr, ptr + size);
+		}
+
+		// Append a length-prefixed string
+		void PutString(const TsString& str) {
+			PutInt((unsigned int)str.size());
+			PutBytes(str.c_str(), str.size());
+		}
+
+		// Current size of the buffer
+		size_t Size() const { return buffer.size(); }
+
+	private:
+		std::vector<unsigned char>& buffer;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Reads binary values written by ImageWriter.  Every Get method returns
+	// false instead of reading past the end of the buffer.
+	///////////////////////////////////////////////////////////////////////////////
+	class ImageReader {
+	public:
+		ImageReader(const unsigned char* data, size_t size) :
+			ptr(data), end(data + size)
+		{}
+
+		// Read a 32-bit unsigned integer
+		bool GetInt(unsigned int& value) {
+			if (end - ptr < 4) {
+				return false;
+			}
+			value = 
+				(unsigned int)ptr[0] | ((unsigned int)ptr[1] << 8) | 
+				((unsigned int)ptr[2] << 16) | ((unsigned int)ptr[3] << 24);
+			ptr += 4;
+			return true;
+		}
+
+		// Return a pointer to the next size bytes and skip over them
+		bool GetBytes(const unsigned char*& data, size_t size) {
+			if ((size_t)(end - ptr) < size) {
+				return false;
+			}
+			data = ptr;
+			ptr += size;
+			return true;
+		}
+
+		// Read a length-prefixed string
+		bool GetString(TsString& str) {
+			unsigned int size;
+			const unsigned char* data;
+			if (!GetInt(size) || !GetBytes(data, size)) {
+				return false;
+			}
+			str.assign((const char*)data, size);
+			return true;
+		}
+
+		// Has the whole buffer been read?
+		bool AtEnd() const { return ptr == end; }
+
+	private:
+		const unsigned char* ptr;
+		const unsigned char* end;
+	};
+
+}
+
+#endif
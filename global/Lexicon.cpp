@@ -86,6 +86,13 @@ namespace PortfolioExplorer {
 		return implementation.FindLongestKeyPrefix(key, length);
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Convert the lexicon to its read-only lookup layout.
+	///////////////////////////////////////////////////////////////////////////////
+	void Lexicon::Freeze() {
+		implementation.Freeze();
+	}
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Clear the lookup table.
 	///////////////////////////////////////////////////////////////////////////////
@@ -93,6 +100,41 @@ namespace PortfolioExplorer {
 		implementation.Clear();
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Image encoding of the (unused) trie data.
+	///////////////////////////////////////////////////////////////////////////////
+	struct LexiconDataCoder {
+		unsigned int operator()(char data) { return (unsigned char)data; }
+		char operator()(unsigned int code) { return (char)code; }
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Save the lexicon to a binary image.
+	///////////////////////////////////////////////////////////////////////////////
+	void Lexicon::WriteImage(
+		std::vector<unsigned char>& buffer
+	) {
+		ImageWriter writer(buffer);
+		LexiconDataCoder coder;
+		implementation.WriteFrozen(writer, coder);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Replace the lexicon contents with an image saved by WriteImage().
+	///////////////////////////////////////////////////////////////////////////////
+	bool Lexicon::ReadImage(
+		const unsigned char* data,
+		size_t size
+	) {
+		ImageReader reader(data, size);
+		LexiconDataCoder coder;
+		if (!implementation.ReadFrozen(reader, coder) || !reader.AtEnd()) {
+			implementation.Clear();
+			return false;
+		}
+		return true;
+	}
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Insert an element into the lexicon
 	// Inputs:
@@ -140,6 +182,7 @@ namespace PortfolioExplorer {
 			Insert(tmpStr.c_str());
 		}
 		fclose(fp);
+		implementation.Freeze();
 		return true;
 	}
 }
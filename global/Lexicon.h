@@ -109,11 +109,35 @@ namespace PortfolioExplorer {
 			Insert((const char*)key);
 		}
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Convert the lexicon to its read-only lookup layout (see Trie::Freeze).
+		// LoadFromFile() does this automatically; call it after building a lexicon
+		// with Insert().  A later Insert() reverts to the slower layout.
+		///////////////////////////////////////////////////////////////////////////////
+		void Freeze();
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Clear the lexicon
 		///////////////////////////////////////////////////////////////////////////////
 		void Clear();
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Save the lexicon to a binary image (see ParserTableImage.h).
+		// Outputs:
+		//	std::vector<unsigned char>&	buffer	The image is appended to this.
+		///////////////////////////////////////////////////////////////////////////////
+		void WriteImage(std::vector<unsigned char>& buffer);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Replace the lexicon contents with an image saved by WriteImage().
+		// Inputs:
+		//	const unsigned char*	data	The image
+		//	size_t					size	Size of the image
+		// Return value:
+		//	bool		true on success, false if the image is malformed.
+		///////////////////////////////////////////////////////////////////////////////
+		bool ReadImage(const unsigned char* data, size_t size);
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Initialize from a file
 		// Inputs:
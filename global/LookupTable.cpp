@@ -104,6 +104,13 @@ namespace PortfolioExplorer {
 		return !key.empty() && !value.empty();
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Convert the table to its read-only lookup layout.
+	///////////////////////////////////////////////////////////////////////////////
+	void LookupTable::Freeze() {
+		implementation.Freeze();
+	}
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Clear the lookup table.
 	///////////////////////////////////////////////////////////////////////////////
@@ -197,6 +204,89 @@ namespace PortfolioExplorer {
 		return true;
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Image encoding of the trie data: each length-prefixed value is copied to
+	// a values buffer and replaced by its offset plus one (zero is null).
+	///////////////////////////////////////////////////////////////////////////////
+	struct LookupTableValueEncoder {
+		LookupTableValueEncoder(std::vector<unsigned char>& values_) : values(values_) {}
+		unsigned int operator()(const unsigned char* ptr) {
+			if (ptr == 0) {
+				return 0;
+			}
+			unsigned int offset = (unsigned int)values.size();
+			values.insert(values.end(), ptr, ptr + 2 + ((ptr[0] << 8) | ptr[1]));
+			return offset + 1;
+		}
+		std::vector<unsigned char>& values;
+	};
+
+	struct LookupTableValueDecoder {
+		LookupTableValueDecoder(const unsigned char* values_, unsigned int size_) : 
+			values(values_), size(size_), error(false)
+		{}
+		const unsigned char* operator()(unsigned int code) {
+			if (code == 0) {
+				return 0;
+			}
+			const unsigned char* ptr = values + code - 1;
+			if (code + 1 > size || code + 1 + ((ptr[0] << 8) | ptr[1]) > size) {
+				error = true;
+				return 0;
+			}
+			return ptr;
+		}
+		const unsigned char* values;
+		unsigned int size;
+		bool error;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Save the table to a binary image.
+	///////////////////////////////////////////////////////////////////////////////
+	void LookupTable::WriteImage(
+		std::vector<unsigned char>& buffer
+	) {
+		std::vector<unsigned char> values;
+		std::vector<unsigned char> trieImage;
+		ImageWriter trieWriter(trieImage);
+		LookupTableValueEncoder encoder(values);
+		implementation.WriteFrozen(trieWriter, encoder);
+
+		ImageWriter writer(buffer);
+		writer.PutInt((unsigned int)values.size());
+		if (!values.empty()) {
+			writer.PutBytes(&values[0], values.size());
+		}
+		writer.PutBytes(&trieImage[0], trieImage.size());
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Replace the table contents with an image saved by WriteImage().
+	///////////////////////////////////////////////////////////////////////////////
+	bool LookupTable::ReadImage(
+		const unsigned char* data,
+		size_t size
+	) {
+		Clear();
+		ImageReader reader(data, size);
+		unsigned int valuesSize;
+		const unsigned char* valuesPtr;
+		if (!reader.GetInt(valuesSize) || !reader.GetBytes(valuesPtr, valuesSize)) {
+			return false;
+		}
+
+		// Values live in the bulk allocator, as they do for Insert().
+		unsigned char* values = (unsigned char*)bulkAllocator.New(valuesSize);
+		memcpy(values, valuesPtr, valuesSize);
+		LookupTableValueDecoder decoder(values, valuesSize);
+		if (!implementation.ReadFrozen(reader, decoder) || decoder.error || !reader.AtEnd()) {
+			Clear();
+			return false;
+		}
+		return true;
+	}
+
 	//////////////////////////////////////////////////////////////////////
 	// Load a table from a comma- or tab-separated file.  This is simple
 	// and does not handle quotes or escapement!
@@ -244,6 +334,7 @@ namespace PortfolioExplorer {
 		}
 
 		fclose(fp);
+		implementation.Freeze();
 		return true;
 	}
 
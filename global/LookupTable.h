@@ -136,11 +136,35 @@ namespace PortfolioExplorer {
 
 
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Convert the table to its read-only lookup layout (see Trie::Freeze).
+		// LoadFromFile() does this automatically; call it after building a table
+		// with Insert().  A later Insert() reverts to the slower layout.
+		///////////////////////////////////////////////////////////////////////////////
+		void Freeze();
+
 		///////////////////////////////////////////////////////////////////////////////
 		// Clear the lookup table.
 		///////////////////////////////////////////////////////////////////////////////
 		void Clear();
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Save the table to a binary image (see ParserTableImage.h).
+		// Outputs:
+		//	std::vector<unsigned char>&	buffer	The image is appended to this.
+		///////////////////////////////////////////////////////////////////////////////
+		void WriteImage(std::vector<unsigned char>& buffer);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Replace the table contents with an image saved by WriteImage().
+		// Inputs:
+		//	const unsigned char*	data	The image
+		//	size_t					size	Size of the image
+		// Return value:
+		//	bool		true on success, false if the image is malformed.
+		///////////////////////////////////////////////////////////////////////////////
+		bool ReadImage(const unsigned char* data, size_t size);
+
 		//////////////////////////////////////////////////////////////////////
 		// Load a table from a comma- or tab-separated file.  This is simple
 		// and does not handle quotes or escapement!
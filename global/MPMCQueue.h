@@ -0,0 +1,299 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// MPMCQueue.h: Bounded multi-producer, multi-consumer queue.
+//
+// A ring buffer of cells, each with a sequence number that says whether it
+// is ready to be written or read on the current lap.  A producer claims the
+// next cell by advancing the enqueue position with a compare-and-swap, fills
+// it and then publishes it by setting its sequence number; consumers do the
+// same with the dequeue position.  No lock is taken and nothing is allocated
+// after construction.  The two positions are on separate cache lines, so
+// producers and consumers do not invalidate each other's line on every call.
+//
+// The blocking calls spin briefly, then sleep on an EventCount until the
+// other side makes progress.  Push() blocks while the queue is full, which
+// is what throttles a fast stage in front of a slow one; blocked producers
+// resume when the queue is half empty.  Pop() resumes on the next push.
+//
+// T is copied in and out, so should be cheap to copy: a pointer or a small
+// struct.  A popped item's copy stays in its cell until the cell is reused.
+
+#ifndef INCL_MPMCQUEUE_H
+#define INCL_MPMCQUEUE_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif // _MSC_VER >= 1000
+
+#include <stddef.h>
+#include "AtomicOps.h"
+#include "CritSec.h"
+
+namespace PortfolioExplorer {
+
+	template <class T> class MPMCQueue {
+	public:
+		///////////////////////////////////////////////////////////////////////
+		// Inputs:
+		//	size_t		capacity	Most items held; rounded up to a power of 2
+		///////////////////////////////////////////////////////////////////////
+		MPMCQueue(size_t capacity) : closed(0), enqueuePos(0), dequeuePos(0)
+		{
+			size_t size = 2;
+			while (size < capacity) {
+				size *= 2;
+			}
+			mask = (unsigned long)(size - 1);
+			cells = new Cell[size];
+			for (size_t i = 0; i < size; i++) {
+				cells[i].sequence = long(i);
+			}
+		}
+
+		~MPMCQueue() { delete [] cells; }
+
+		size_t GetCapacity() const { return size_t(mask) + 1; }
+
+		// Number of items queued.  Only a hint while other threads are active.
+		size_t GetCountApprox() const {
+			long count = AtomicLoadRelaxed(enqueuePos) - AtomicLoadRelaxed(dequeuePos);
+			return count > 0 ? size_t(count) : 0;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Add as many of the given items as there is room for, without
+		// waiting.  The items added are consecutive in the queue.
+		// Inputs:
+		//	const T*	items		The items to add
+		//	size_t		count		Number of items
+		// Return value:
+		//	size_t		The number of leading items added; 0 if full.
+		///////////////////////////////////////////////////////////////////////
+		size_t TryPushBatch(const T* items, size_t count) {
+			if (count == 0) {
+				return 0;
+			}
+			long pos = AtomicLoadRelaxed(enqueuePos);
+			for (;;) {
+				// Count the cells from pos that are free on this lap.
+				size_t nbrFree = 0;
+				long diff = 0;
+				while (nbrFree < count) {
+					diff = AtomicLoadAcquire(CellAt(pos + long(nbrFree)).sequence) - (pos + long(nbrFree));
+					if (diff != 0) {
+						break;
+					}
+					nbrFree++;
+				}
+				if (nbrFree == 0) {
+					if (diff < 0) {
+						return 0;		// Full
+					}
+					pos = AtomicLoadRelaxed(enqueuePos);	// Another producer got there first
+					continue;
+				}
+				if (AtomicCompareExchange(enqueuePos, pos, pos + long(nbrFree))) {
+					for (size_t i = 0; i < nbrFree; i++) {
+						Cell& cell = CellAt(pos + long(i));
+						cell.item = items[i];
+						AtomicStoreRelease(cell.sequence, pos + long(i) + 1);
+					}
+					notEmpty.NotifyAll();
+					return nbrFree;
+				}
+				// pos now holds the current enqueue position; try again.
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Remove up to maxCount items, without waiting.
+		// Outputs:
+		//	T*			itemsReturn		Receives the items, oldest first
+		// Return value:
+		//	size_t		The number of items removed; 0 if empty.
+		///////////////////////////////////////////////////////////////////////
+		size_t TryPopBatch(T* itemsReturn, size_t maxCount) {
+			if (maxCount == 0) {
+				return 0;
+			}
+			long pos = AtomicLoadRelaxed(dequeuePos);
+			for (;;) {
+				// Count the cells from pos that have been published on this lap.
+				size_t nbrReady = 0;
+				long diff = 0;
+				while (nbrReady < maxCount) {
+					diff = AtomicLoadAcquire(CellAt(pos + long(nbrReady)).sequence) - (pos + long(nbrReady) + 1);
+					if (diff != 0) {
+						break;
+					}
+					nbrReady++;
+				}
+				if (nbrReady == 0) {
+					if (diff < 0) {
+						return 0;		// Empty
+					}
+					pos = AtomicLoadRelaxed(dequeuePos);	// Another consumer got there first
+					continue;
+				}
+				if (AtomicCompareExchange(dequeuePos, pos, pos + long(nbrReady))) {
+					for (size_t i = 0; i < nbrReady; i++) {
+						Cell& cell = CellAt(pos + long(i));
+						itemsReturn[i] = cell.item;
+						AtomicStoreRelease(cell.sequence, pos + long(i) + long(mask) + 1);
+					}
+					// Producers blocked on a full queue are woken once it is
+					// half empty, so that each wake-up buys them many pushes.
+					// Measure from the current dequeue position, not pos: if
+					// other consumers have since drained the queue, the cells
+					// released here may be the ones a producer is waiting on.
+					AtomicFence();
+					if (AtomicLoadRelaxed(enqueuePos) - AtomicLoadRelaxed(dequeuePos) <= long(mask / 2) + 1) {
+						notFull.NotifyAll();
+					}
+					return nbrReady;
+				}
+			}
+		}
+
+		bool TryPush(const T& item) { return TryPushBatch(&item, 1) == 1; }
+		bool TryPop(T& itemReturn) { return TryPopBatch(&itemReturn, 1) == 1; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Add all of the given items, waiting for room as needed.
+		// Return value:
+		//	size_t		The number of items added; less than count only if
+		//				the queue was closed.
+		///////////////////////////////////////////////////////////////////////
+		size_t PushBatch(const T* items, size_t count) {
+			size_t nbrPushed = 0;
+			int spin = 0;
+			while (nbrPushed < count && !IsClosed()) {
+				size_t n = TryPushBatch(items + nbrPushed, count - nbrPushed);
+				if (n != 0) {
+					nbrPushed += n;
+					spin = 0;
+				} else if (spin < SpinCount) {
+					spin++;
+					CpuRelax();
+				} else {
+					// Try again after announcing the wait, so that a pop
+					// between the two is either seen here or wakes us.
+					long key = notFull.PrepareWait();
+					n = IsClosed() ? 0 : TryPushBatch(items + nbrPushed, count - nbrPushed);
+					if (n != 0 || IsClosed()) {
+						notFull.CancelWait();
+						nbrPushed += n;
+					} else {
+						notFull.Wait(key);
+					}
+				}
+			}
+			return nbrPushed;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Remove up to maxCount items, waiting until there is at least one.
+		// Return value:
+		//	size_t		The number of items removed; 0 once the queue is
+		//				closed and empty.
+		///////////////////////////////////////////////////////////////////////
+		size_t PopBatch(T* itemsReturn, size_t maxCount) {
+			for (int spin = 0; ; ) {
+				size_t n = TryPopBatch(itemsReturn, maxCount);
+				if (n != 0) {
+					return n;
+				}
+				if (IsClosed()) {
+					// Items pushed before Close() are visible now.
+					return TryPopBatch(itemsReturn, maxCount);
+				}
+				if (spin < SpinCount) {
+					spin++;
+					CpuRelax();
+				} else {
+					long key = notEmpty.PrepareWait();
+					n = TryPopBatch(itemsReturn, maxCount);
+					if (n != 0 || IsClosed()) {
+						notEmpty.CancelWait();
+						if (n != 0) {
+							return n;
+						}
+					} else {
+						notEmpty.Wait(key);
+					}
+				}
+			}
+		}
+
+		// Add one item, waiting for room.  Returns false if the queue was closed.
+		bool Push(const T& item) { return PushBatch(&item, 1) == 1; }
+		// Remove one item, waiting for one.  Returns false once closed and empty.
+		bool Pop(T& itemReturn) { return PopBatch(&itemReturn, 1) == 1; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Refuse further pushes, and let consumers return once the queue is
+		// empty.  Items already queued can still be popped.
+		///////////////////////////////////////////////////////////////////////
+		void Close() {
+			AtomicStoreRelease(closed, 1);
+			notEmpty.NotifyAll();
+			notFull.NotifyAll();
+		}
+
+		bool IsClosed() const { return AtomicLoadAcquire(closed) != 0; }
+
+	private:
+		// Copy ctor and op= are not implemented.
+		MPMCQueue(const MPMCQueue&);
+		MPMCQueue& operator=(const MPMCQueue&);
+
+		struct Cell {
+			AtomicLong sequence;
+			T item;
+		};
+
+		// Polls of a full or empty queue before sleeping
+		enum { SpinCount = 64 };
+		enum { CacheLineSize = 64 };
+
+		Cell& CellAt(long pos) { return cells[(unsigned long)pos & mask]; }
+
+		// Read-only after construction, except closed
+		Cell* cells;
+		unsigned long mask;
+		AtomicLong closed;
+		char pad0[CacheLineSize];
+		// Written by producers
+		AtomicLong enqueuePos;
+		char pad1[CacheLineSize - sizeof(AtomicLong)];
+		// Written by consumers
+		AtomicLong dequeuePos;
+		char pad2[CacheLineSize - sizeof(AtomicLong)];
+		EventCount notEmpty;
+		char pad3[CacheLineSize];
+		EventCount notFull;
+	};
+
+}
+
+#endif
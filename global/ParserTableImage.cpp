@@ -0,0 +1,544 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+// ParserTableImage.cpp: A single binary file holding the pre-built lookup
+// tables, lexicons and pattern configuration used by the address parsers.
+
+#include "Global_Headers.h"
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined(WIN32)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+#include "ParserTableImage.h"
+#include "ImageBuffer.h"
+#include "RegularExprWrapper.h"
+
+namespace PortfolioExplorer {
+
+	// Name of the image file within the table directory
+	const char* const ParserTableImage::FileName = "address_parser_tables.img";
+
+	// Leading bytes of every image file
+	static const char imageMagic[4] = { 'P', 'E', 'P', 'T' };
+
+	// Nesting limit when reading a configuration tree
+	static const int maxDataItemDepth = 64;
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Save a configuration tree.
+	///////////////////////////////////////////////////////////////////////////////
+	static void WriteDataItem(
+		ImageWriter& writer,
+		DataItemRef item
+	) {
+		writer.PutInt((unsigned int)item->GetType());
+		writer.PutInt((unsigned int)item->GetLine());
+		switch (item->GetType()) {
+		case DataItem::Value:
+			writer.PutString(TsString(*item));
+			break;
+		case DataItem::Association:
+			{
+				DataItemAssociationRef association = item.toAssociation();
+				std::vector<TsString> keys;
+				std::vector<DataItemRef> values;
+				TsString key;
+				DataItemRef value;
+				for (
+					association->FirstElement(); 
+					(value = association->GetElement(key)) != 0; 
+					association->NextElement()
+				) {
+					keys.push_back(key);
+					values.push_back(value);
+				}
+				writer.PutInt((unsigned int)keys.size());
+				for (unsigned int i = 0; i < keys.size(); i++) {
+					writer.PutString(keys[i]);
+					WriteDataItem(writer, values[i]);
+				}
+			}
+			break;
+		case DataItem::Array:
+			writer.PutInt((unsigned int)item->GetSize());
+			for (int i = 0; i < item->GetSize(); i++) {
+				WriteDataItem(writer, (*item)[i]);
+			}
+			break;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Restore a configuration tree saved by WriteDataItem().
+	// Return value:
+	//	DataItemRef		The tree, or zero if the image is malformed.
+	///////////////////////////////////////////////////////////////////////////////
+	static DataItemRef ReadDataItem(
+		ImageReader& reader,
+		int depth
+	) {
+		unsigned int type;
+		unsigned int line;
+		if (depth > maxDataItemDepth || !reader.GetInt(type) || !reader.GetInt(line)) {
+			return 0;
+		}
+		switch (type) {
+		case DataItem::Value:
+			{
+				TsString text;
+				if (!reader.GetString(text)) {
+					return 0;
+				}
+				return new DataItemValue(text, (int)line);
+			}
+		case DataItem::Association:
+			{
+				unsigned int count;
+				if (!reader.GetInt(count)) {
+					return 0;
+				}
+				DataItemAssociationRef association = new DataItemAssociation((int)line);
+				for (unsigned int i = 0; i < count; i++) {
+					TsString key;
+					DataItemRef value;
+					if (!reader.GetString(key) || (value = ReadDataItem(reader, depth + 1)) == 0) {
+						return 0;
+					}
+					association->AddItem(key, value);
+				}
+				return association;
+			}
+		case DataItem::Array:
+			{
+				unsigned int count;
+				if (!reader.GetInt(count)) {
+					return 0;
+				}
+				DataItemArrayRef array = new DataItemArray((int)line);
+				for (unsigned int i = 0; i < count; i++) {
+					DataItemRef value = ReadDataItem(reader, depth + 1);
+					if (value == 0) {
+						return 0;
+					}
+					array->AppendItem(value);
+				}
+				return array;
+			}
+		}
+		return 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Constructor
+	///////////////////////////////////////////////////////////////////////////////
+	ParserTableImage::ParserTableImage() :
+		imageData(0),
+		imageSize(0),
+		imageMapped(false),
+#if defined(WIN32)
+		mappingHandle(0),
+#endif
+		recording(false)
+	{
+	}
+
+	ParserTableImage::~ParserTableImage()
+	{
+		UnmapImage();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Map the image file into memory, or read it if it cannot be mapped.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::MapImage(
+		const TsString& filename
+	) {
+		UnmapImage();
+#if defined(WIN32)
+		HANDLE fileHandle = ::CreateFile(
+			filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0
+		);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		DWORD sizeHigh = 0;
+		DWORD sizeLow = ::GetFileSize(fileHandle, &sizeHigh);
+		if (sizeLow != INVALID_FILE_SIZE && sizeHigh == 0 && sizeLow > 0) {
+			mappingHandle = ::CreateFileMapping(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+			if (mappingHandle != 0) {
+				imageData = (const unsigned char*)::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+				if (imageData != 0) {
+					imageSize = sizeLow;
+					imageMapped = true;
+				} else {
+					::CloseHandle(mappingHandle);
+					mappingHandle = 0;
+				}
+			}
+		}
+		::CloseHandle(fileHandle);
+		if (imageMapped) {
+			return true;
+		}
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* view = mmap(0, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (view != MAP_FAILED) {
+				imageData = (const unsigned char*)view;
+				imageSize = size_t(info.st_size);
+				imageMapped = true;
+			}
+		}
+		close(fd);
+		if (imageMapped) {
+			return true;
+		}
+#endif
+		// Mapping failed; read the file instead.
+		FILE* fp = fopen(filename.c_str(), "rb");
+		if (fp == 0) {
+			return false;
+		}
+		fseek(fp, 0, SEEK_END);
+		long fileSize = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		if (fileSize > 0) {
+			imageCopy.resize(fileSize);
+			if (fread(&imageCopy[0], 1, fileSize, fp) != (size_t)fileSize) {
+				imageCopy.clear();
+			}
+		}
+		fclose(fp);
+		imageData = imageCopy.empty() ? 0 : &imageCopy[0];
+		imageSize = imageCopy.size();
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Release the loaded image.
+	///////////////////////////////////////////////////////////////////////////////
+	void ParserTableImage::UnmapImage()
+	{
+		if (imageMapped) {
+#if defined(WIN32)
+			::UnmapViewOfFile(imageData);
+			::CloseHandle(mappingHandle);
+			mappingHandle = 0;
+#else
+			munmap((void*)imageData, imageSize);
+#endif
+		}
+		imageMapped = false;
+		imageCopy.clear();
+		imageData = 0;
+		imageSize = 0;
+		entries.clear();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Load the image from the table directory, if there is one.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::Open(
+		const TsString& dataDir_,
+		TsString& errorMsg
+	) {
+		dataDir = dataDir_;
+		recording = false;
+		lookupTables.clear();
+		lexicons.clear();
+		patternConfigurations.clear();
+
+		TsString filename = dataDir + "/" + FileName;
+		if (!MapImage(filename)) {
+			errorMsg = "Cannot open parser table image '" + filename + "'";
+			return false;
+		}
+
+		// Header
+		ImageReader reader(imageData, imageSize);
+		const unsigned char* magic;
+		unsigned int version;
+		unsigned int count;
+		if (
+			!reader.GetBytes(magic, sizeof(imageMagic)) ||
+			memcmp(magic, imageMagic, sizeof(imageMagic)) != 0 ||
+			!reader.GetInt(version)
+		) {
+			errorMsg = "Parser table image '" + filename + "' is not valid";
+			UnmapImage();
+			return false;
+		}
+		if (version != ImageVersion || !reader.GetInt(count)) {
+			errorMsg = "Parser table image '" + filename + "' has the wrong version";
+			UnmapImage();
+			return false;
+		}
+
+		// Index the entries
+		for (unsigned int i = 0; i < count; i++) {
+			TsString name;
+			Entry entry;
+			unsigned int size;
+			const unsigned char* data;
+			if (
+				!reader.GetInt(entry.kind) ||
+				!reader.GetString(name) ||
+				!reader.GetInt(entry.sourceSize) ||
+				!reader.GetInt(entry.sourceTime) ||
+				!reader.GetInt(size) ||
+				!reader.GetBytes(data, size)
+			) {
+				errorMsg = "Parser table image '" + filename + "' is truncated";
+				UnmapImage();
+				return false;
+			}
+			entry.offset = data - imageData;
+			entry.size = size;
+			entries[name] = entry;
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Start a new image.
+	///////////////////////////////////////////////////////////////////////////////
+	void ParserTableImage::Record(
+		const TsString& dataDir_
+	) {
+		dataDir = dataDir_;
+		UnmapImage();
+		recording = true;
+		recorded.clear();
+		recordedNames.clear();
+		lookupTables.clear();
+		lexicons.clear();
+		patternConfigurations.clear();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Write the recorded tables to an image file.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::Write(
+		const TsString& filename,
+		TsString& errorMsg
+	) {
+		std::vector<unsigned char> header;
+		ImageWriter writer(header);
+		writer.PutBytes(imageMagic, sizeof(imageMagic));
+		writer.PutInt(ImageVersion);
+		writer.PutInt((unsigned int)recordedNames.size());
+
+		FILE* fp = fopen(filename.c_str(), "wb");
+		if (fp == 0) {
+			errorMsg = "Cannot create parser table image '" + filename + "'";
+			return false;
+		}
+		bool ok = fwrite(&header[0], 1, header.size(), fp) == header.size();
+		if (ok && !recorded.empty()) {
+			ok = fwrite(&recorded[0], 1, recorded.size(), fp) == recorded.size();
+		}
+		if (fclose(fp) != 0 || !ok) {
+			errorMsg = "Error writing parser table image '" + filename + "'";
+			return false;
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Get the size and modification time of a source file.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::GetSourceStamp(
+		const TsString& name,
+		unsigned int& size,
+		unsigned int& time
+	) {
+		struct stat info;
+		if (stat((dataDir + "/" + name).c_str(), &info) != 0) {
+			return false;
+		}
+		size = (unsigned int)info.st_size;
+		time = (unsigned int)info.st_mtime;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Find an up-to-date entry of the given kind.
+	///////////////////////////////////////////////////////////////////////////////
+	const ParserTableImage::Entry* ParserTableImage::FindEntry(
+		unsigned int kind,
+		const TsString& name
+	) {
+		std::map<TsString, Entry>::const_iterator iter = entries.find(name);
+		if (iter == entries.end() || iter->second.kind != kind) {
+			return 0;
+		}
+		// A missing source file is fine (the image may be deployed alone),
+		// but a changed one means the image is stale.
+		unsigned int size;
+		unsigned int time;
+		if (
+			GetSourceStamp(name, size, time) &&
+			(size != iter->second.sourceSize || time != iter->second.sourceTime)
+		) {
+			return 0;
+		}
+		return &iter->second;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Add a recorded entry.
+	///////////////////////////////////////////////////////////////////////////////
+	void ParserTableImage::AddEntry(
+		unsigned int kind,
+		const TsString& name,
+		const std::vector<unsigned char>& data
+	) {
+		// Tables shared by several parser components are saved once.
+		if (!recordedNames.insert(name).second) {
+			return;
+		}
+
+		unsigned int size = 0;
+		unsigned int time = 0;
+		GetSourceStamp(name, size, time);
+
+		ImageWriter writer(recorded);
+		writer.PutInt(kind);
+		writer.PutString(name);
+		writer.PutInt(size);
+		writer.PutInt(time);
+		writer.PutInt((unsigned int)data.size());
+		if (!data.empty()) {
+			writer.PutBytes(&data[0], data.size());
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Load a lookup table from the image, or from its CSV file.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::LoadLookupTable(
+		const TsString& name,
+		LookupTableRef& table,
+		TsString& errorMsg
+	) {
+		CritSec critSec(loadLock);
+		std::map<TsString, LookupTableRef>::iterator iter = lookupTables.find(name);
+		if (iter != lookupTables.end()) {
+			table = iter->second;
+			return true;
+		}
+		table = new LookupTable;
+		const Entry* entry = FindEntry(LookupTableEntry, name);
+		if (entry == 0 || !table->ReadImage(imageData + entry->offset, entry->size)) {
+			table->Clear();
+			if (!table->LoadFromFile(dataDir + "/" + name, errorMsg)) {
+				table = new LookupTable;
+				return false;
+			}
+			if (recording) {
+				std::vector<unsigned char> data;
+				table->WriteImage(data);
+				AddEntry(LookupTableEntry, name, data);
+			}
+		}
+		lookupTables[name] = table;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Load a lexicon from the image, or from its text file.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::LoadLexicon(
+		const TsString& name,
+		LexiconRef& lexicon,
+		TsString& errorMsg
+	) {
+		CritSec critSec(loadLock);
+		std::map<TsString, LexiconRef>::iterator iter = lexicons.find(name);
+		if (iter != lexicons.end()) {
+			lexicon = iter->second;
+			return true;
+		}
+		lexicon = new Lexicon;
+		const Entry* entry = FindEntry(LexiconEntry, name);
+		if (entry == 0 || !lexicon->ReadImage(imageData + entry->offset, entry->size)) {
+			lexicon->Clear();
+			if (!lexicon->LoadFromFile(dataDir + "/" + name, errorMsg)) {
+				lexicon = new Lexicon;
+				return false;
+			}
+			if (recording) {
+				std::vector<unsigned char> data;
+				lexicon->WriteImage(data);
+				AddEntry(LexiconEntry, name, data);
+			}
+		}
+		lexicons[name] = lexicon;
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Load the pattern tool configuration from the image, or from its XML file.
+	///////////////////////////////////////////////////////////////////////////////
+	bool ParserTableImage::LoadPatternConfiguration(
+		const TsString& name,
+		DataItemRef& config,
+		TsString& errorMsg
+	) {
+		CritSec critSec(loadLock);
+		std::map<TsString, DataItemRef>::iterator iter = patternConfigurations.find(name);
+		if (iter != patternConfigurations.end()) {
+			config = iter->second;
+			return true;
+		}
+		const Entry* entry = FindEntry(DataItemEntry, name);
+		if (entry != 0) {
+			ImageReader reader(imageData + entry->offset, entry->size);
+			config = ReadDataItem(reader, 0);
+			if (config != 0 && reader.AtEnd()) {
+				patternConfigurations[name] = config;
+				return true;
+			}
+		}
+		if (!RegularExprWrapper::ReadPatternConfigurationFile(dataDir + "/" + name, config, errorMsg)) {
+			return false;
+		}
+		if (recording) {
+			std::vector<unsigned char> data;
+			ImageWriter writer(data);
+			WriteDataItem(writer, config);
+			AddEntry(DataItemEntry, name, data);
+		}
+		patternConfigurations[name] = config;
+		return true;
+	}
+
+}
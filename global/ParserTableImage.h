@@ -0,0 +1,242 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$ 
+# $Date$ 
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// ParserTableImage.h: A single binary file holding the pre-built lookup
+// tables, lexicons and pattern configuration used by the address parsers.
+//
+// Without an image, every Open() of the parsers reads a dozen CSV files
+// character-by-character, builds a trie for each, and parses the XML
+// pattern configuration with Xerces.  The ParserTableCompiler program does
+// that once and saves the frozen tries (see Trie::Freeze) and the parsed
+// configuration tree to "address_parser_tables.img" in the table directory.
+// When the image is present, Open() copies the tables straight out of it.
+// Each table is loaded once per ParserTableImage and the same read-only
+// object is handed to every parser that asks for it, so geocoders given
+// one image (see GeocoderPool) hold one copy of the tables between them.
+//
+// The image file is mapped into memory rather than read.  A Geocoder opens
+// it once and hands the same ParserTableImage to both address parsers and
+// the tokenizer.  Xerces is started only to parse a pattern configuration
+// that is not in the image.  The pattern engines themselves are still built
+// from the stored configuration tree at each Open(), as they keep scratch
+// state while matching and cannot be shared.
+//
+// Each entry remembers the size and modification time of its source file.
+// If the source file has changed since the image was compiled, the entry
+// is ignored and the source file is read instead, so a stale image can
+// never hide an edited table.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef INCL_PARSERTABLEIMAGE_H
+#define INCL_PARSERTABLEIMAGE_H
+
+#if _MSC_VER >= 1000
+#pragma once
+#endif
+
+#include <map>
+#include <set>
+#include <vector>
+#include "TsString.h"
+#include "LookupTable.h"
+#include "Lexicon.h"
+#include "DataItem.h"
+#include "CritSec.h"
+#include "Global_DllExport.h"
+
+namespace PortfolioExplorer {
+
+	class ParserTableImage : public VRefCount {
+	public:
+		// Name of the image file within the table directory
+		static const char* const FileName;
+
+		// Version of the image format.  Images with any other version are ignored.
+		enum { ImageVersion = 2 };
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Constructor/destructor
+		///////////////////////////////////////////////////////////////////////////////
+		ParserTableImage();
+		virtual ~ParserTableImage();
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Load the image from the table directory, if there is one.
+		// Inputs:
+		//	const TsString&	dataDir_	The directory containing data files.
+		// Outputs:
+		//	TsString&		errorMsg	Reason the image could not be used.
+		// Return value:
+		//	bool		true if an image was loaded.  On false the Load methods
+		//				simply read the source files.
+		///////////////////////////////////////////////////////////////////////////////
+		bool Open(const TsString& dataDir_, TsString& errorMsg);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Start a new image.  Every table subsequently loaded through this object
+		// is read from its source file and kept for Write().
+		// Inputs:
+		//	const TsString&	dataDir_	The directory containing data files.
+		///////////////////////////////////////////////////////////////////////////////
+		void Record(const TsString& dataDir_);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Write the recorded tables to an image file.
+		// Inputs:
+		//	const TsString&	filename	The image file to write.
+		// Outputs:
+		//	TsString&		errorMsg	The error message on failure.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////////////
+		bool Write(const TsString& filename, TsString& errorMsg);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Load a lookup table from the image, or from its CSV file.  A table
+		// already loaded through this object is shared rather than loaded again,
+		// and must not be changed.
+		// Inputs:
+		//	const TsString&	name		Name of the CSV file in the table directory.
+		// Outputs:
+		//	LookupTableRef&	table		The table.  On failure, an empty table.
+		//	TsString&		errorMsg	The error message on failure.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////////////
+		bool LoadLookupTable(
+			const TsString& name,
+			LookupTableRef& table,
+			TsString& errorMsg
+		);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Load a lexicon from the image, or from its text file.  A lexicon
+		// already loaded through this object is shared rather than loaded again,
+		// and must not be changed.
+		// Inputs:
+		//	const TsString&	name		Name of the file in the table directory.
+		// Outputs:
+		//	LexiconRef&		lexicon		The lexicon.  On failure, an empty lexicon.
+		//	TsString&		errorMsg	The error message on failure.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////////////
+		bool LoadLexicon(
+			const TsString& name,
+			LexiconRef& lexicon,
+			TsString& errorMsg
+		);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Load the pattern tool configuration from the image, or from its XML file.
+		// A configuration already loaded through this object is shared rather
+		// than parsed again, and must not be changed.
+		// Inputs:
+		//	const TsString&	name		Name of the file in the table directory.
+		// Outputs:
+		//	DataItemRef&	config		The configuration tree.
+		//	TsString&		errorMsg	The error message on failure.
+		// Return value:
+		//	bool		true on success, false on error.
+		///////////////////////////////////////////////////////////////////////////////
+		bool LoadPatternConfiguration(
+			const TsString& name,
+			DataItemRef& config,
+			TsString& errorMsg
+		);
+
+	private:
+		// Kinds of image entries
+		enum EntryKind { LookupTableEntry = 1, LexiconEntry = 2, DataItemEntry = 3 };
+
+		// Location of an entry within the loaded image
+		struct Entry {
+			unsigned int kind;
+			unsigned int sourceSize;
+			unsigned int sourceTime;
+			size_t offset;
+			size_t size;
+		};
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Find an up-to-date entry of the given kind.
+		// Return value:
+		//	const Entry*	The entry, or zero if it is absent or stale.
+		///////////////////////////////////////////////////////////////////////////////
+		const Entry* FindEntry(unsigned int kind, const TsString& name);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Add a recorded entry.
+		///////////////////////////////////////////////////////////////////////////////
+		void AddEntry(unsigned int kind, const TsString& name, const std::vector<unsigned char>& data);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Get the size and modification time of a source file.
+		// Return value:
+		//	bool		false if the file cannot be found.
+		///////////////////////////////////////////////////////////////////////////////
+		bool GetSourceStamp(const TsString& name, unsigned int& size, unsigned int& time);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Map the image file into memory, or read it if it cannot be mapped.
+		// Return value:
+		//	bool		false if the file cannot be opened.
+		///////////////////////////////////////////////////////////////////////////////
+		bool MapImage(const TsString& filename);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Release the loaded image.
+		///////////////////////////////////////////////////////////////////////////////
+		void UnmapImage();
+
+		// Directory containing the source files
+		TsString dataDir;
+
+		// Loaded image and its index.  The image is a mapped view of the
+		// file, or a copy in imageCopy if mapping failed.
+		const unsigned char* imageData;
+		size_t imageSize;
+		bool imageMapped;
+		std::vector<unsigned char> imageCopy;
+#if defined(WIN32)
+		HANDLE mappingHandle;
+#endif
+		std::map<TsString, Entry> entries;
+
+		// Tables loaded so far, by name.  Parsers on several threads may load
+		// through one image, so loading is serialized.
+		CritSecInfo loadLock;
+		std::map<TsString, LookupTableRef> lookupTables;
+		std::map<TsString, LexiconRef> lexicons;
+		std::map<TsString, DataItemRef> patternConfigurations;
+
+		// Recorded image, in file format, and the names of the entries in it
+		bool recording;
+		std::vector<unsigned char> recorded;
+		std::set<TsString> recordedNames;
+	};
+	typedef refcnt_ptr<ParserTableImage> ParserTableImageRef;
+
+}
+
+#endif
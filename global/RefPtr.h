@@ -35,6 +35,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // InterlockedIncrement and InterlockedDecrement, which perform atomic
 // increment and decrements.
 //
+// On UNIX the count is a std::atomic, or uses the GCC atomic builtins for
+// pre-C++11 compilers.  Increments are relaxed: a new reference can only be
+// made from an existing one, so nothing need be ordered before it.
+// Decrements are acquire-release, so that every use of the object through
+// other references happens before the delete by the last owner.
+//
+// An atomic operation still pulls the count's cache line into the core that
+// performs it.  Where an object is shared between threads, pass refcnt_ptr by
+// const reference, or a plain pointer whose lifetime is held by a reference
+// elsewhere, so that hot loops do not touch the count at all.
+//
 // Note: When porting to a new platform, we should use ACE_Atomic_Op
 ////////////////////////////////////////////////////////////////////////////
 
@@ -49,7 +60,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	// multithreaded under Win32
 	#define REFCOUNT_USE_WIN32_INTERLOCK
 #elif defined(UNIX)
-        //no lock
+	#if __cplusplus >= 201103L
+		#define REFCOUNT_USE_STD_ATOMIC
+	#else
+		#define REFCOUNT_USE_GCC_ATOMIC
+	#endif
 #else
 	#define REFCOUNT_USE_ACE_ATOMIC_OP
 #endif
@@ -60,6 +75,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	//#include <afxwin.h>         // MFC core and standard components
 #elif defined(REFCOUNT_USE_ACE_ATOMIC_OP)
 	#include "ace/Atomic_Op.h"
+#elif defined(REFCOUNT_USE_STD_ATOMIC)
+	#include <atomic>
 #endif
 
 ////////////////////////////////////////////////////////////////////////////
@@ -82,7 +99,7 @@ private:
 	// Counting interface
 	// Allow refcount operations on const objects
 	// All ref/deref return the resulting new refcount
-	// For Win32 multithreading, use the atomic increment-and-check
+	// For Win32 and UNIX multithreading, use the atomic increment-and-check
 	// or decrement-and-check operations.
 	#ifdef REFCOUNT_USE_WIN32_INTERLOCK
 		typedef long REFCOUNT_TYPE;
@@ -100,6 +117,24 @@ private:
 		long deref() const { return --refcount; }
 		// Note: nref is NOT mutex-protected.
 		long nref() const { return refcount.value_i(); }
+	#elif defined(REFCOUNT_USE_STD_ATOMIC)
+		typedef std::atomic<long> REFCOUNT_TYPE;
+		long ref() const {
+			return refcount.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+		long deref() const {
+			return refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+		}
+		long nref() const { return refcount.load(std::memory_order_relaxed); }
+	#elif defined(REFCOUNT_USE_GCC_ATOMIC)
+		typedef long REFCOUNT_TYPE;
+		long ref() const {
+			return __atomic_add_fetch(&refcount, 1, __ATOMIC_RELAXED);
+		}
+		long deref() const {
+			return __atomic_sub_fetch(&refcount, 1, __ATOMIC_ACQ_REL);
+		}
+		long nref() const { return __atomic_load_n(&refcount, __ATOMIC_RELAXED); }
 	#else
 		typedef long REFCOUNT_TYPE;
 		// Non-multi-thread versions
@@ -251,7 +251,7 @@ namespace PortfolioExplorer {
 	int PatternMatcher::Process(
 		const std::vector<unsigned char*>& symbols,
 		std::vector<char*>& classesReturn,
-		BulkAllocatorRef bulkAllocator    
+		const BulkAllocatorRef& bulkAllocator    
 	) {
 		int exprNumber;
 		int endPosition;
@@ -308,7 +308,7 @@ namespace PortfolioExplorer {
 	int PatternMatcher::MultiProcess(
 		const VectorNoDestruct<std::vector<unsigned char*> >& symbols,
 		std::vector<char*>& classesReturn,
-		BulkAllocatorRef bulkAllocator    
+		const BulkAllocatorRef& bulkAllocator    
 	) {
 		int exprNumber;
 		int endPosition;
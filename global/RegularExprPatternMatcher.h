@@ -131,7 +131,7 @@ namespace PortfolioExplorer {
 		int Process(
 			const std::vector<unsigned char*>& symbols,
 			std::vector<char*>& classesReturn,
-			BulkAllocatorRef bulkAllocator    
+			const BulkAllocatorRef& bulkAllocator    
 		);
 	
 		///////////////////////////////////////////////////////////////////////////////
@@ -156,7 +156,7 @@ namespace PortfolioExplorer {
 		int MultiProcess(
 			const VectorNoDestruct<std::vector<unsigned char*> >& symbols,
 			std::vector<char*>& classesReturn,
-			BulkAllocatorRef bulkAllocator    
+			const BulkAllocatorRef& bulkAllocator    
 		);
 	
 	private:
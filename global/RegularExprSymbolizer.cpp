@@ -206,7 +206,7 @@ namespace PortfolioExplorer {
     void Symbolizer::Process(
             const std::vector<const char*>& tokens,
             std::vector<const char*>& symbolsReturn,
-			BulkAllocatorRef bulkAllocator    
+			const BulkAllocatorRef& bulkAllocator    
     )
 	{
 		// Vector to hold tokens during processing 
@@ -235,7 +235,7 @@ namespace PortfolioExplorer {
 	//////////////////////////////////////////////////////////////////////
 	const char* Symbolizer::MatchString(
 		const char* text, 
-		BulkAllocatorRef allocator
+		const BulkAllocatorRef& allocator
 	)
 	{
 		assert(engine != 0);
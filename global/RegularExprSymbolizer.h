@@ -109,7 +109,7 @@ namespace PortfolioExplorer {
         void Process(
                 const std::vector<const char*>& tokens,
                 std::vector<const char*>& symbolsReturn,
-				BulkAllocatorRef bulkAllocator    
+				const BulkAllocatorRef& bulkAllocator    
         );
 	
 		///////////////////////////////////////////////////////////////////////////////
@@ -156,7 +156,7 @@ namespace PortfolioExplorer {
 		//////////////////////////////////////////////////////////////////////
 		const char* MatchString(
 			const char* text, 
-			BulkAllocatorRef allocator
+			const BulkAllocatorRef& allocator
 		);
 
 	private:
@@ -195,6 +195,9 @@ namespace PortfolioExplorer {
 
 		//Setup the Regular Expression engine and make sure all of the patterns compile
 		bound = BindRegExpEngine(splitApartPatterns, noSplitPatterns, listener);
+		noSplitTrie.Freeze();
+		splitTrie.Freeze();
+		splitReverseTrie.Freeze();
 		return bound;
 
 	}
@@ -298,7 +301,7 @@ namespace PortfolioExplorer {
     void Tokenizer::Process(
         const char* text,
         std::vector<const char*>& tokensReturn,
-		BulkAllocatorRef bulkAllocator    
+		const BulkAllocatorRef& bulkAllocator    
     ) {
 		tempTokens.clear();
 		actions.clear();
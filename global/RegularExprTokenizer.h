@@ -126,7 +126,7 @@ namespace PortfolioExplorer {
         void Process(
                 const char* text,
                 std::vector<const char*>& tokensReturn,
-				BulkAllocatorRef bulkAllocator    
+				const BulkAllocatorRef& bulkAllocator    
         );
 		
 	private:
@@ -34,12 +34,19 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DomHelper.h"
 #include "ListenerNull.h"
 #include "Filesys.h"
+#include "CritSec.h"
 #include <xercesc/dom/DOMDocument.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
 
 XERCES_CPP_NAMESPACE_USE
 
 namespace PortfolioExplorer {
 
+	// Xerces may not be initialized, used and terminated on several threads
+	// at once, and geocoders may be opened side by side (see GeocoderPool).
+	// Defined at namespace scope so that it exists before any thread starts.
+	static CritSecInfo xercesLock;
+
 	//////////////////////////////////////////////////////////////////////
 	// Initialize the parser.
 	// Inputs:
@@ -52,6 +59,20 @@ namespace PortfolioExplorer {
 	bool RegularExprWrapper::ReadPatternToolConfiguration(
 		const TsString& patternsConfigurationFile,
 		TsString& errorMsg
+	) {
+		DataItemRef config;
+		return
+			ReadPatternConfigurationFile(patternsConfigurationFile, config, errorMsg) &&
+			BindPatternTools(config, errorMsg);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Read the XML pattern tool configuration into a configuration tree.
+	//////////////////////////////////////////////////////////////////////
+	bool RegularExprWrapper::ReadPatternConfigurationFile(
+		const TsString& patternsConfigurationFile,
+		DataItemRef& config,
+		TsString& errorMsg
 	) {
 		// Deserialize a configuration
 		TsString configStr;
@@ -61,7 +82,31 @@ namespace PortfolioExplorer {
 			return false;
 		}
 		
+		// Xerces is only started here, so that opening from a parser table
+		// image never touches it.  Initialize() and Terminate() nest.
+		CritSec critSec(xercesLock);
+		try {
+			XMLPlatformUtils::Initialize();
+		} catch (const XMLException&) {
+			errorMsg = "Xerces XML initialization failed";
+			return false;
+		}
+		bool ok = ParsePatternConfiguration(configStr, config, errorMsg);
+		XMLPlatformUtils::Terminate();
+		return ok;
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Parse the XML pattern tool configuration text.  Xerces must be
+	// initialized, and all DOM objects are released before returning.
+	//////////////////////////////////////////////////////////////////////
+	bool RegularExprWrapper::ParsePatternConfiguration(
+		const TsString& configStr,
+		DataItemRef& config,
+		TsString& errorMsg
+	) {
 		// New-style XML configuration
+		TsString errorMsg2;
 		DomHelper helper;
 		DOMDocument* doc = helper.DomParseString(configStr.c_str(), errorMsg2);
 		if (doc == 0) {
@@ -69,12 +114,21 @@ namespace PortfolioExplorer {
 			return false;
 		}
 		XMLToDataItem convertor(doc);
-		DataItemRef config = convertor.MakeDataItem();
+		config = convertor.MakeDataItem();
 		if (config == 0) {
 			errorMsg = "Error reading address pattern file.";
 			return false;
 		}
+		return true;
+	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Create and bind the pattern tools from a configuration tree.
+	//////////////////////////////////////////////////////////////////////
+	bool RegularExprWrapper::BindPatternTools(
+		DataItemRef config,
+		TsString& errorMsg
+	) {
 		// Get all process node configs and walk them
 		DataItemRef processNodeConfigs = config["PROCESS_NODES"];
 		if (processNodeConfigs == 0 || processNodeConfigs->GetType() != DataItem::Array) {
@@ -142,7 +196,7 @@ namespace PortfolioExplorer {
 	void RegularExprWrapper::ProduceTokens(
 		char const* value, 
 		VectorNoDestruct<TokSymCls>& result, 
-		BulkAllocatorRef bulkAllocator
+		const BulkAllocatorRef& bulkAllocator
 	) {
 		
 		// Turn the raw input into tokens.
@@ -155,6 +209,8 @@ namespace PortfolioExplorer {
 		for(it = tokens.begin(); it != tokens.end(); it++) {
 			TokSymCls& tmp = result.UseExtraOnEnd();
 			tmp.token = (*it);
+			tmp.symbol = "";
+			tmp.token_class = "";
 		}
 	}
 
@@ -163,7 +219,7 @@ namespace PortfolioExplorer {
 	//////////////////////////////////////////////////////////////////////
 	void RegularExprWrapper::ProduceSymbols(
 		VectorNoDestruct<TokSymCls>& result, 
-		BulkAllocatorRef bulkAllocator
+		const BulkAllocatorRef& bulkAllocator
 	) {
 		assert(Open());
 		
@@ -172,10 +228,7 @@ namespace PortfolioExplorer {
 
 		std::vector<TokSymCls>::iterator it;
 		for(it = result.begin(); it < result.end(); it++) {
-			tokens.push_back(
-				(char*)bulkAllocator->NewString(
-				(const char*)(*it).token.c_str())
-			);
+			tokens.push_back((*it).token);
 		}
 		symbolizer->Process(tokens, symbols, bulkAllocator);
 		assert(result.size() == symbols.size());
@@ -190,7 +243,7 @@ namespace PortfolioExplorer {
 	//////////////////////////////////////////////////////////////////////
 	void RegularExprWrapper::ProduceClasses(
 		VectorNoDestruct<TokSymCls>& result, 
-		BulkAllocatorRef bulkAllocator
+		const BulkAllocatorRef& bulkAllocator
 	) {
 		assert(Open());
 
@@ -198,10 +251,7 @@ namespace PortfolioExplorer {
 		classes.clear();
 		std::vector<TokSymCls>::iterator it;
 		for(it = result.begin(); it < result.end(); it++) {
-			uSymbols.push_back(
-				(unsigned char*)bulkAllocator->NewString(
-				(const char*)(*it).symbol.c_str())
-			);
+			uSymbols.push_back((unsigned char*)(*it).symbol);
 		}
 		patternMatcher->Process(uSymbols, classes, bulkAllocator);
 		assert(result.size() == classes.size());
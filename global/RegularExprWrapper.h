@@ -49,11 +49,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 namespace PortfolioExplorer {
 
+	// A token with the symbol and class assigned to it.  The strings are not
+	// owned: they belong to the bulk allocator passed to the Produce*()
+	// methods, or to the pattern tools, and last until the allocator is reset.
 	struct TokSymCls {
-		TsString orginalTokenVal;
-		TsString token;
-		TsString symbol;
-		TsString token_class;
+		TokSymCls() : token(""), symbol(""), token_class("") {}
+		const char* token;
+		const char* symbol;
+		const char* token_class;
 	};
 
 	class RegularExprWrapper : public VRefCount {
@@ -83,6 +86,38 @@ namespace PortfolioExplorer {
 			TsString& errorMsg
 		);
 
+		//////////////////////////////////////////////////////////////////////
+		// Read the XML pattern tool configuration into a configuration tree,
+		// without binding any tools.
+		// Inputs:
+		//	const TsString&	patternsConfigurationFile	The XML file.
+		// Outputs:
+		//	DataItemRef&		config		The configuration tree.
+		//	std::String&		errorMsg	The message if an error occured.
+		// Return value:
+		//	bool	true on success, false on error.
+		//////////////////////////////////////////////////////////////////////
+		static bool ReadPatternConfigurationFile(
+			const TsString& patternsConfigurationFile,
+			DataItemRef& config,
+			TsString& errorMsg
+		);
+
+		//////////////////////////////////////////////////////////////////////
+		// Create and bind the tokenizer, symbolizer and pattern matcher
+		// from a configuration tree.
+		// Inputs:
+		//	DataItemRef		config		The configuration tree.
+		// Outputs:
+		//	std::String&		errorMsg	The message if an error occured.
+		// Return value:
+		//	bool	true on success, false on error.
+		//////////////////////////////////////////////////////////////////////
+		bool BindPatternTools(
+			DataItemRef config,
+			TsString& errorMsg
+		);
+
 		//////////////////////////////////////////////////////////////////////
 		// Initialize the RegularExprWrapper
 		//////////////////////////////////////////////////////////////////////
@@ -101,20 +136,30 @@ namespace PortfolioExplorer {
 		void ProduceTokens(
 			char const* value, 
 			VectorNoDestruct<TokSymCls>& result, 
-			BulkAllocatorRef bulkAllocator
+			const BulkAllocatorRef& bulkAllocator
 		);
 
 		//////////////////////////////////////////////////////////////////////
 		// Produce symbols and add them to the result vector
 		//////////////////////////////////////////////////////////////////////
-		void ProduceSymbols(VectorNoDestruct<TokSymCls>& result, BulkAllocatorRef bulkAllocator);
+		void ProduceSymbols(VectorNoDestruct<TokSymCls>& result, const BulkAllocatorRef& bulkAllocator);
 
 		//////////////////////////////////////////////////////////////////////
 		// Produce classes and add them to the result vector
 		//////////////////////////////////////////////////////////////////////
-		void ProduceClasses(VectorNoDestruct<TokSymCls>& result, BulkAllocatorRef bulkAllocator);
+		void ProduceClasses(VectorNoDestruct<TokSymCls>& result, const BulkAllocatorRef& bulkAllocator);
 
 	private:
+		//////////////////////////////////////////////////////////////////////
+		// Parse the XML pattern tool configuration text into a tree.
+		// Xerces must already be initialized.
+		//////////////////////////////////////////////////////////////////////
+		static bool ParsePatternConfiguration(
+			const TsString& configStr,
+			DataItemRef& config,
+			TsString& errorMsg
+		);
+
 		// Intermediate vector of tokens used during processing.
 		std::vector<const char*> tokens;
 		std::vector<const char*> symbols;
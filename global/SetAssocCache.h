@@ -99,12 +99,9 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////
 		SetAssocCache(
 			int size_
-		)
-		#ifndef NDEBUG
-			: 
+		) :
 			hits(0),
 			misses(0)
-		#endif
 		{
 			size = NextPrime(size_ / N + 1);
 			if (size <= 0) {
@@ -131,18 +128,11 @@ namespace PortfolioExplorer {
 		// Is the given item in the cache?
 		bool Present(const Key& key)
 		{
-			const Entry& entry = table[(unsigned int)key.Hash() % size];
-			for (int i = 0; i < entry.filled; i++) {
-				if (entry.bucket[i].key == key) {
-					#ifndef NDEBUG
-						hits++;
-					#endif
-					return true;
-				}
+			if (Contains(key)) {
+				hits++;
+				return true;
 			}
-			#ifndef NDEBUG
-				misses++;
-			#endif
+			misses++;
 			return false;
 		}
 
@@ -156,15 +146,11 @@ namespace PortfolioExplorer {
 					// Make next entry go into following bucket.  This
 					// rewards recently-accessed items.
 					entry.next = char((i + 1) % N);
-					#ifndef NDEBUG
-						hits++;
-					#endif
+					hits++;
 					return true;
 				}
 			}
-			#ifndef NDEBUG
-				misses++;
-			#endif
+			misses++;
 			return false;
 		}
 
@@ -173,10 +159,7 @@ namespace PortfolioExplorer {
 		// Do not add duplicates!
 		void Enter(const Key& key, const Data& data) 
 		{
-			if (Present(key)) {
-				#ifndef NDEBUG
-					misses--;	// don't screw up counts...
-				#endif
+			if (Contains(key)) {
 				return;
 			}
 			Entry& entry = table[(unsigned int)key.Hash() % size];
@@ -192,10 +175,7 @@ namespace PortfolioExplorer {
 		// Similar to Enter, but it returns the object to be replaced so it can be recycled
         Data & Change(const Key& key) 
         {
-			#ifndef NDEBUG
-				assert(!Present(key));
-				misses--;   // don't screw up counts...
-			#endif
+			assert(!Contains(key));
 			Entry& entry = table[key.Hash() % size];
 			entry.bucket[entry.next].key = key;
 			Data & ret = entry.bucket[entry.next].data;
@@ -216,7 +196,25 @@ namespace PortfolioExplorer {
 			}
 		}
 
+		// Number of lookups by Present() and Fetch() that found, or did not
+		// find, their key since the cache was made.  Enter() and Change()
+		// are not counted.
+		long GetHits() const { return hits; }
+		long GetMisses() const { return misses; }
+
 	private:
+		// Lookup that does not count as a hit or miss
+		bool Contains(const Key& key) const
+		{
+			const Entry& entry = table[(unsigned int)key.Hash() % size];
+			for (int i = 0; i < entry.filled; i++) {
+				if (entry.bucket[i].key == key) {
+					return true;
+				}
+			}
+			return false;
+		}
+
 		struct Entry {
 			Entry() : next(0), filled(0) {}
 			struct Bucket {
@@ -230,10 +228,8 @@ namespace PortfolioExplorer {
 		};
 		int size;			// Number of entries
 		Entry* table;
-		#ifndef NDEBUG
-			int hits;
-			int misses;
-		#endif
+		long hits;
+		long misses;
 	};
 
 }
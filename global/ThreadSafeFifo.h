@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 // TSFIFO.h: A thread-safe FIFO queue template.
 // Uses the critical-section facility in CritSec.h
+// For bounded queues between pipeline threads, see MPMCQueue.h.
 
 #ifndef INCL_TSFIFO_H
 #define INCL_TSFIFO_H
@@ -39,7 +40,7 @@ namespace PortfolioExplorer {
 
 	template <class T> class ThreadSafeFIFO {
 	public:
-		ThreadSafeFIFO() {}
+		ThreadSafeFIFO() : lock("ThreadSafeFIFO") {}
 		virtual ~ThreadSafeFIFO() {}
 		void add(const T& t) {
 			CritSec critSec(lock);	// Serialize access to this object
@@ -52,6 +53,17 @@ namespace PortfolioExplorer {
 			implementation.pop_front();
 			return t;
 		}
+		// Remove the oldest item if there is one.  Unlike count() followed
+		// by remove(), this is safe with several consumers.
+		bool try_remove(T& t) {
+			CritSec critSec(lock);	// Serialize access to this object
+			if (implementation.empty()) {
+				return false;
+			}
+			t = implementation.front();
+			implementation.pop_front();
+			return true;
+		}
 		void clear() {
 			CritSec critSec(lock);	// Serialize access to this object
 			implementation.clear();
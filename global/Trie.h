@@ -32,8 +32,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include <string.h>
+#include <vector>
+#include <algorithm>
 #include "RefPtr.h"
 #include "Freelist.h"
+#include "ImageBuffer.h"
 
 #ifndef NDEBUG
 	#include <iostream>
@@ -59,9 +62,11 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////////
 		Trie() :
 			rootData(T(0)),
-			nullData(T(0))
+			nullData(T(0)),
+			haveNodes(true)
 		{
 			memset(roots, 0, sizeof(roots));
+			memset(flatRoots, 0, sizeof(flatRoots));
 			trieNodeAllocator = new FreeList<TrieNode>;
 		}
 
@@ -181,12 +186,159 @@ namespace PortfolioExplorer {
 		///////////////////////////////////////////////////////////////////////////////
 		void Clear() 
 		{
+			Thaw();
+			haveNodes = true;
 			Free();
 			memset(roots, 0, sizeof(roots));
 			trieNodeAllocator = new FreeList<TrieNode>;
 			rootData = nullData;
 		}
 
+		///////////////////////////////////////////////////////////////////////////////
+		// Build a read-only copy of the trie in contiguous arrays, with the children
+		// of each node stored together and sorted by letter.  All Find methods use
+		// the frozen copy until the next Insert() or Clear().  Call this once the
+		// trie has been fully loaded.
+		///////////////////////////////////////////////////////////////////////////////
+		void Freeze();
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Has Freeze() been called since the last modification?
+		///////////////////////////////////////////////////////////////////////////////
+		bool IsFrozen() const { return !flatNodes.empty(); }
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Node of the frozen trie.  Each flat node stands for exactly one letter;
+		// the letter itself is kept in the parallel flatLabels array so that a
+		// child search only touches consecutive bytes.
+		///////////////////////////////////////////////////////////////////////////////
+		struct FlatNode {
+			// Index of the first child in flatNodes.  Children are contiguous
+			// and sorted by letter.
+			unsigned int firstChild;
+			// Number of children.
+			unsigned int childCount;
+		};
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Access to the frozen arrays, for saving a frozen trie to a binary image.
+		// Only valid when IsFrozen().  Node zero is a placeholder.
+		///////////////////////////////////////////////////////////////////////////////
+		unsigned int GetFrozenSize() const { return (unsigned int)flatNodes.size(); }
+		const FlatNode& GetFrozenNode(unsigned int idx) const { return flatNodes[idx]; }
+		unsigned char GetFrozenLabel(unsigned int idx) const { return flatLabels[idx]; }
+		bool GetFrozenEnd(unsigned int idx) const { return flatEnds[idx] != 0; }
+		T GetFrozenData(unsigned int idx) const { return flatData[idx]; }
+		unsigned int GetFrozenRoot(unsigned char c) const { return flatRoots[c]; }
+		T GetRootData() const { return rootData; }
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Replace the contents of the trie with frozen arrays saved by the accessors
+		// above.  The node form is rebuilt from the arrays only if Insert() is
+		// called later.
+		// Inputs:
+		//	const std::vector<FlatNode>&		nodes	Frozen nodes
+		//	const std::vector<unsigned char>&	labels	Letter of each node
+		//	const std::vector<unsigned char>&	ends	Nonzero if a node's letter
+		//											ends a compressed node
+		//	const std::vector<T>&				data	Data of each node
+		//	const unsigned int*					roots	256 root node indexes
+		//	T									rootData_	Empty-string data
+		///////////////////////////////////////////////////////////////////////////////
+		void SetFrozen(
+			const std::vector<FlatNode>& nodes,
+			const std::vector<unsigned char>& labels,
+			const std::vector<unsigned char>& ends,
+			const std::vector<T>& data,
+			const unsigned int* roots_,
+			T rootData_
+		) {
+			Clear();
+			flatNodes = nodes;
+			flatLabels = labels;
+			flatEnds = ends;
+			flatData = data;
+			memcpy(flatRoots, roots_, sizeof(flatRoots));
+			rootData = rootData_;
+			haveNodes = false;
+		}
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Save the frozen trie to a binary image.  Freezes the trie if necessary.
+		// Inputs:
+		//	ImageWriter&	writer		Destination of the image
+		//	Encoder&		encode		Function object converting T to an
+		//								unsigned int.  Must map the null value to 0.
+		///////////////////////////////////////////////////////////////////////////////
+		template <class Encoder> void WriteFrozen(ImageWriter& writer, Encoder& encode) {
+			Freeze();
+			writer.PutInt((unsigned int)flatNodes.size());
+			for (unsigned int i = 0; i < flatNodes.size(); i++) {
+				writer.PutInt(flatNodes[i].firstChild);
+				writer.PutInt(flatNodes[i].childCount);
+				writer.PutInt(encode(flatData[i]));
+			}
+			writer.PutBytes(&flatLabels[0], flatLabels.size());
+			writer.PutBytes(&flatEnds[0], flatEnds.size());
+			for (unsigned int c = 0; c < 256; c++) {
+				writer.PutInt(flatRoots[c]);
+			}
+			writer.PutInt(encode(rootData));
+		}
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Replace the contents of the trie with an image saved by WriteFrozen().
+		// Inputs:
+		//	ImageReader&	reader		Source of the image
+		//	Decoder&		decode		Function object converting the unsigned int
+		//								written by the encoder back to T.
+		// Return value:
+		//	bool		true on success, false if the image is malformed.
+		///////////////////////////////////////////////////////////////////////////////
+		template <class Decoder> bool ReadFrozen(ImageReader& reader, Decoder& decode) {
+			unsigned int size;
+			if (!reader.GetInt(size) || size == 0) {
+				return false;
+			}
+			std::vector<FlatNode> nodes(size);
+			std::vector<T> data(size, nullData);
+			for (unsigned int i = 0; i < size; i++) {
+				unsigned int code;
+				if (
+					!reader.GetInt(nodes[i].firstChild) ||
+					!reader.GetInt(nodes[i].childCount) ||
+					!reader.GetInt(code) ||
+					nodes[i].firstChild > size ||
+					nodes[i].childCount > size - nodes[i].firstChild
+				) {
+					return false;
+				}
+				data[i] = decode(code);
+			}
+			const unsigned char* labelPtr;
+			if (!reader.GetBytes(labelPtr, size)) {
+				return false;
+			}
+			std::vector<unsigned char> labels(labelPtr, labelPtr + size);
+			const unsigned char* endPtr;
+			if (!reader.GetBytes(endPtr, size)) {
+				return false;
+			}
+			std::vector<unsigned char> ends(endPtr, endPtr + size);
+			unsigned int rootIndexes[256];
+			for (unsigned int c = 0; c < 256; c++) {
+				if (!reader.GetInt(rootIndexes[c]) || rootIndexes[c] >= size) {
+					return false;
+				}
+			}
+			unsigned int rootCode;
+			if (!reader.GetInt(rootCode)) {
+				return false;
+			}
+			SetFrozen(nodes, labels, ends, data, rootIndexes, decode(rootCode));
+			return true;
+		}
+
 	#ifndef NDEBUG
 		///////////////////////////////////////////////////////////////////////////////
 		// Dump the trie to a stream
@@ -261,6 +413,61 @@ namespace PortfolioExplorer {
 
 		};
 
+		// Orders TrieNodes by their first letter.
+		struct CompareFirstLetter {
+			bool operator()(const TrieNode* lhs, const TrieNode* rhs) const {
+				return lhs->c[0] < rhs->c[0];
+			}
+		};
+
+		// Above this many children, FlatFindChild uses a binary search.
+		enum { FlatLinearSearchMax = 8 };
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Find a child of a frozen node
+		// Inputs:
+		//	unsigned int	node	Index of the parent node.
+		//	unsigned char	c		The letter of the child to find.
+		// Return value:
+		//	unsigned int	Index of the child found, or zero if none.
+		///////////////////////////////////////////////////////////////////////////////
+		unsigned int FlatFindChild(unsigned int node, unsigned char c) const {
+			const FlatNode& flatNode = flatNodes[node];
+			const unsigned char* first = &flatLabels[0] + flatNode.firstChild;
+			const unsigned char* last = first + flatNode.childCount;
+			if (flatNode.childCount <= FlatLinearSearchMax) {
+				for (const unsigned char* ptr = first; ptr != last; ++ptr) {
+					if (*ptr >= c) {
+						return *ptr == c ? (unsigned int)(ptr - &flatLabels[0]) : 0;
+					}
+				}
+				return 0;
+			}
+			const unsigned char* ptr = std::lower_bound(first, last, c);
+			return (ptr != last && *ptr == c) ? (unsigned int)(ptr - &flatLabels[0]) : 0;
+		}
+
+		// Discard the frozen copy.
+		void Thaw() {
+			flatNodes.clear();
+			flatLabels.clear();
+			flatEnds.clear();
+			flatData.clear();
+			memset(flatRoots, 0, sizeof(flatRoots));
+		}
+
+		// Insert into the node form only.
+		void InsertNode(const unsigned char* key, T data);
+
+		// Rebuild the node form from the frozen arrays, after SetFrozen().
+		void RebuildNodes(unsigned int node, std::vector<unsigned char>& key);
+
+		// Frozen-trie versions of the lookup methods
+		T FlatFind(const unsigned char* key);
+		bool FlatFindTriePrefix(const unsigned char* key, int& length);
+		bool FlatFindKeyPrefix(const unsigned char* key, T& result, int& length);
+		bool FlatFindLongestKeyPrefix(const unsigned char* key, T& result, int& length);
+
 		// Split the node at the given key position, creating a child node
 		// in the process.
 		void SplitNode(TrieNode* node, int position) {
@@ -310,6 +517,22 @@ namespace PortfolioExplorer {
 
 		// Null data value
 		T nullData;
+
+		// Frozen trie.  Node zero is a placeholder, so that index zero can mean
+		// "no node".  All four vectors are empty unless the trie is frozen.
+		// flatEnds marks the letters that end a compressed TrieNode, so that
+		// FindTriePrefix() answers exactly as it does on the node form.
+		std::vector<FlatNode> flatNodes;
+		std::vector<unsigned char> flatLabels;
+		std::vector<unsigned char> flatEnds;
+		std::vector<T> flatData;
+
+		// Frozen root nodes, indexed by first letter.  Zero if none.
+		unsigned int flatRoots[256];
+
+		// False if the trie was loaded with SetFrozen() and the node form has
+		// not been rebuilt yet.
+		bool haveNodes;
 	};
 
 
@@ -325,6 +548,29 @@ namespace PortfolioExplorer {
 	template<class T> void Trie<T>::Insert(
 		const unsigned char* key, 
 		T data
+	) {
+		// Any modification invalidates the frozen copy.
+		if (IsFrozen()) {
+			if (!haveNodes) {
+				std::vector<unsigned char> tmpKey;
+				for (unsigned int c = 0; c < 256; c++) {
+					if (flatRoots[c] != 0) {
+						RebuildNodes(flatRoots[c], tmpKey);
+					}
+				}
+				haveNodes = true;
+			}
+			Thaw();
+		}
+		InsertNode(key, data);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Insert a key and value into the node form of the trie
+	///////////////////////////////////////////////////////////////////////////////
+	template<class T> void Trie<T>::InsertNode(
+		const unsigned char* key, 
+		T data
 	) {
 		if (*key == 0) {
 			// Empty-string data
@@ -392,6 +638,10 @@ namespace PortfolioExplorer {
 	template <class T> T Trie<T>::Find(
 		const unsigned char* key
 	) {
+		if (IsFrozen()) {
+			return FlatFind(key);
+		}
+
 		if (*key == 0) {
 			return rootData;
 		}
@@ -433,6 +683,10 @@ namespace PortfolioExplorer {
 		const unsigned char* key,
 		int& length
 	) {
+		if (IsFrozen()) {
+			return FlatFindTriePrefix(key, length);
+		}
+
 		if (*key == 0) {
 			return true;
 		}
@@ -477,6 +731,11 @@ namespace PortfolioExplorer {
 		const unsigned char* key,
 		int& length
 	) {
+		if (IsFrozen()) {
+			T result(nullData);
+			return FlatFindKeyPrefix(key, result, length);
+		}
+
 		if (*key == 0) {
 			return rootData != nullData;
 		}
@@ -525,6 +784,11 @@ namespace PortfolioExplorer {
 		const unsigned char* key,
 		int& length
 	) {
+		if (IsFrozen()) {
+			T result(nullData);
+			return FlatFindLongestKeyPrefix(key, result, length);
+		}
+
 		if (*key == 0) {
 			return rootData != nullData;
 		}
@@ -580,6 +844,10 @@ namespace PortfolioExplorer {
 		T& result,
 		int& length
 	) {
+		if (IsFrozen()) {
+			return FlatFindKeyPrefix(key, result, length);
+		}
+
 		if (*key == 0) {
 			return rootData != nullData;
 		}
@@ -630,6 +898,10 @@ namespace PortfolioExplorer {
 		T& result,
 		int& length
 	) {
+		if (IsFrozen()) {
+			return FlatFindLongestKeyPrefix(key, result, length);
+		}
+
 		if (*key == 0) {
 			return rootData != nullData;
 		}
@@ -678,6 +950,210 @@ namespace PortfolioExplorer {
 		return length != 0;
 	}
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Build the frozen copy of the trie.  Nodes are laid out breadth-first so
+	// that the children of each node are adjacent; compressed TrieNodes are
+	// expanded into one flat node per letter.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> void Trie<T>::Freeze()
+	{
+		if (!haveNodes) {
+			// Loaded with SetFrozen(); already frozen.
+			return;
+		}
+		Thaw();
+
+		// Pending flat node: the TrieNode it came from and the letter offset
+		// within that node.
+		struct Pending {
+			unsigned int index;
+			TrieNode* node;
+			int offset;
+		};
+		std::vector<Pending> queue;
+
+		// Placeholder node zero.
+		FlatNode placeholder = { 0, 0 };
+		flatNodes.push_back(placeholder);
+		flatLabels.push_back(0);
+		flatEnds.push_back(0);
+		flatData.push_back(nullData);
+
+		for (unsigned int c = 0; c < 256; c++) {
+			if (roots[c] != 0) {
+				Pending pending = { (unsigned int)flatNodes.size(), roots[c], 0 };
+				queue.push_back(pending);
+				flatRoots[c] = pending.index;
+				flatNodes.push_back(placeholder);
+				flatLabels.push_back((unsigned char)c);
+				flatEnds.push_back(0);
+				flatData.push_back(nullData);
+			}
+		}
+
+		std::vector<TrieNode*> children;
+		for (unsigned int head = 0; head < queue.size(); head++) {
+			Pending current = queue[head];
+			FlatNode& flatNode = flatNodes[current.index];
+			flatNode.firstChild = (unsigned int)flatNodes.size();
+
+			bool lastLetter = 
+				current.offset + 1 == TrieNode::MaxCompression || 
+				current.node->c[current.offset + 1] == 0;
+			if (!lastLetter) {
+				// The next letter of a compressed node is the only child.
+				flatNode.childCount = 1;
+				Pending pending = { (unsigned int)flatNodes.size(), current.node, current.offset + 1 };
+				queue.push_back(pending);
+				flatNodes.push_back(placeholder);
+				flatLabels.push_back(current.node->c[current.offset + 1]);
+				flatEnds.push_back(0);
+				flatData.push_back(nullData);
+				continue;
+			}
+
+			// Data is attached to the last letter of a node.
+			flatEnds[current.index] = 1;
+			flatData[current.index] = current.node->data;
+
+			// Sort the sibling list by letter.
+			children.clear();
+			for (TrieNode* child = current.node->child; child != 0; child = child->sibling) {
+				children.push_back(child);
+			}
+			std::sort(children.begin(), children.end(), CompareFirstLetter());
+			flatNode.childCount = (unsigned int)children.size();
+			for (unsigned int i = 0; i < children.size(); i++) {
+				Pending pending = { (unsigned int)flatNodes.size(), children[i], 0 };
+				queue.push_back(pending);
+				flatNodes.push_back(placeholder);
+				flatLabels.push_back(children[i]->c[0]);
+				flatEnds.push_back(0);
+				flatData.push_back(nullData);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Insert all keys below a frozen node into the node form.
+	// Inputs:
+	//	unsigned int			node	The frozen node
+	//	std::vector<unsigned char>&	key		The letters leading to the node's parent
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> void Trie<T>::RebuildNodes(
+		unsigned int node,
+		std::vector<unsigned char>& key
+	) {
+		key.push_back(flatLabels[node]);
+		if (flatData[node] != nullData) {
+			key.push_back(0);
+			InsertNode(&key[0], flatData[node]);
+			key.pop_back();
+		}
+		const FlatNode& flatNode = flatNodes[node];
+		for (unsigned int i = 0; i < flatNode.childCount; i++) {
+			RebuildNodes(flatNode.firstChild + i, key);
+		}
+		key.pop_back();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Find the value associated with a key in the frozen trie.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> T Trie<T>::FlatFind(
+		const unsigned char* key
+	) {
+		if (*key == 0) {
+			return rootData;
+		}
+		unsigned int node = flatRoots[*key++];
+		while (node != 0 && *key != 0) {
+			node = FlatFindChild(node, *key++);
+		}
+		return node != 0 ? flatData[node] : nullData;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Determine if the given key exists as a prefix of a key in the frozen trie.
+	// As in the node form, the key must end where a compressed node ends.
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> bool Trie<T>::FlatFindTriePrefix(
+		const unsigned char* key,
+		int& length
+	) {
+		if (*key == 0) {
+			return true;
+		}
+		length = 0;
+		unsigned int node = flatRoots[*key];
+		while (node != 0) {
+			key++;
+			length++;
+			if (*key == 0) {
+				return flatEnds[node] != 0;
+			}
+			node = FlatFindChild(node, *key);
+		}
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Find the shortest key in the frozen trie that is a prefix of the given key
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> bool Trie<T>::FlatFindKeyPrefix(
+		const unsigned char* key,
+		T& result,
+		int& length
+	) {
+		if (*key == 0) {
+			return rootData != nullData;
+		}
+		length = 0;
+		unsigned int node = flatRoots[*key];
+		while (node != 0) {
+			key++;
+			length++;
+			if (flatData[node] != nullData) {
+				result = flatData[node];
+				return true;
+			}
+			if (*key == 0) {
+				return false;
+			}
+			node = FlatFindChild(node, *key);
+		}
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Find the longest key in the frozen trie that is a prefix of the given key
+	///////////////////////////////////////////////////////////////////////////////
+	template <class T> bool Trie<T>::FlatFindLongestKeyPrefix(
+		const unsigned char* key,
+		T& result,
+		int& length
+	) {
+		if (*key == 0) {
+			return rootData != nullData;
+		}
+		int tmpLength = 0;
+		length = 0;
+		unsigned int node = flatRoots[*key];
+		while (node != 0) {
+			key++;
+			tmpLength++;
+			if (flatData[node] != nullData) {
+				result = flatData[node];
+				length = tmpLength;
+			}
+			if (*key == 0) {
+				break;
+			}
+			node = FlatFindChild(node, *key);
+		}
+		return length != 0;
+	}
+
 }
 
 #endif
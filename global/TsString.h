@@ -31,6 +31,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // 6) It uses no traits
 
 // *Go read the C++ ARM if you want to know about POD
+//
+// TsString is std::string unless TSSTRING_COW is defined on Windows.  The
+// standard string keeps short strings inline (most address tokens fit), is
+// moved rather than copied by C++11 compilers, and is thread-safe for
+// separate objects without a shared reference count.  TsString_T puts even
+// short strings on the heap, pays a reference count update for every copy
+// and copies the body on a write to a shared one; it is kept only for code
+// that depends on sharing.
 
 #if _MSC_VER > 1000
 #pragma once
@@ -39,7 +47,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef INCL_TSSTRING_H
 #define INCL_TSSTRING_H
 
-#if defined(UNIX)
+#if defined(UNIX) || !defined(TSSTRING_COW)
 	#include <string>
 	namespace PortfolioExplorer {
 	typedef std::string TsString;
@@ -163,6 +163,40 @@ namespace PortfolioExplorer {
 	{ 
 		return StripLeadingSpace(StripTrailingSpace(str)); 
 	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Copy an address field into a fixed-size buffer, converting it to upper
+	// case and normalizing white space.
+	// Inputs:
+	//	const char*		str			The field to copy; may be null.
+	//	int				bufSize		Size of the output buffer, including termination
+	// Outputs:
+	//	char*			buffer		The normalized field
+	///////////////////////////////////////////////////////////////////////////////
+	void CopyNormalizedField(char* buffer, int bufSize, const char* str)
+	{
+		int length = 0;
+		bool pendingSpace = false;
+		for (; str != 0 && *str != 0 && length < bufSize - 1; str++) {
+			if (isspace((unsigned char)*str)) {
+				pendingSpace = (length > 0);
+				continue;
+			}
+			if (pendingSpace) {
+				buffer[length++] = ' ';
+				pendingSpace = false;
+				if (length == bufSize - 1) {
+					break;
+				}
+			}
+			buffer[length++] = TOUPPER(*str);
+		}
+		// Do not leave a blank at the end of a truncated field
+		while (length > 0 && buffer[length - 1] == ' ') {
+			length--;
+		}
+		buffer[length] = 0;
+	}
 	
 	///////////////////////////////////////////////////////////////////////////////
 	// Separate a multi-line message into parts.
@@ -204,6 +204,18 @@ namespace PortfolioExplorer {
 	///////////////////////////////////////////////////////////////////////////////
 	TsString TrimSpaces(const TsString& str);
 
+	///////////////////////////////////////////////////////////////////////////////
+	// Copy an address field into a fixed-size buffer, converting it to upper
+	// case, removing leading and trailing space and collapsing runs of space
+	// to a single blank.  The result is truncated to fit and always terminated.
+	// Inputs:
+	//	const char*		str			The field to copy; may be null.
+	//	int				bufSize		Size of the output buffer, including termination
+	// Outputs:
+	//	char*			buffer		The normalized field
+	///////////////////////////////////////////////////////////////////////////////
+	void CopyNormalizedField(char* buffer, int bufSize, const char* str);
+
 	///////////////////////////////////////////////////////////////////////////////
 	// Separate a multi-line message into parts.
 	// Inputs:
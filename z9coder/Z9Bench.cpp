@@ -0,0 +1,136 @@
+/********************************************************************
+Copyright (C) 1998-2006 SRC, LLC
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License version 2.1 as published by the Free Software Foundation
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*********************************************************************/
+
+/*
+# $Rev$
+# $Date$
+*/
+
+// Z9Bench.cpp: Compares the lookup rate of DeCompressZip4::Find, one key at
+// a time, with FindBatch over the same keys, and checks that both return
+// the same results.  Build as a console program with Z9CoderImp.cpp.
+//
+//	z9bench <zip9 file> [number of keys]
+//
+// The keys are taken from random records of the file, in random order; one
+// in ten has a Zip4 outside its record's range, so that misses are timed too.
+
+#include "GeoCoder_Headers.h"
+#include "Z9CoderImp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+using namespace PortfolioExplorer;
+
+static double Seconds(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double PerSecond(int count, double seconds)
+{
+	return seconds > 0 ? count / seconds : 0.0;
+}
+
+static bool SameResults(const DeCompressZip4::Results& a, const DeCompressZip4::Results& b)
+{
+	return
+		strcmp(a.censusIDResultBuffer, b.censusIDResultBuffer) == 0 &&
+		strcmp(a.recTypeResultBuffer, b.recTypeResultBuffer) == 0 &&
+		strcmp(a.cenTypeResultBuffer, b.cenTypeResultBuffer) == 0 &&
+		a.m_dLatResult == b.m_dLatResult &&
+		a.m_dLongResult == b.m_dLongResult;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <zip9 file> [number of keys]\n", argv[0]);
+		return 1;
+	}
+	int nKeys = argc == 3 ? atoi(argv[2]) : 100000;
+
+	try {
+		// Each pass gets its own decoder, so neither finds the other's
+		// chunks in the cache.
+		DeCompressZip4Ref sampler = new DeCompressZip4;
+		DeCompressZip4Ref single = new DeCompressZip4;
+		DeCompressZip4Ref batch = new DeCompressZip4;
+		clock_t start = clock();
+		single->Open(argv[1]);
+		printf("Open: %.3f sec, %u records\n", Seconds(start), single->GetRecordCount());
+		sampler->Open(argv[1]);
+		batch->Open(argv[1]);
+		if (single->GetRecordCount() == 0 || nKeys <= 0) {
+			return 0;
+		}
+
+		std::vector<int> aZip5(nKeys), aZip4(nKeys);
+		srand(1);
+		for (int i = 0; i < nKeys; i++) {
+			int nRecord = int((unsigned(rand()) * (unsigned(RAND_MAX) + 1) + unsigned(rand())) % sampler->GetRecordCount());
+			int nZip5, nZip4Lo, nZip4Hi;
+			sampler->GetRecordKey(nRecord, nZip5, nZip4Lo, nZip4Hi);
+			aZip5[i] = nZip5;
+			aZip4[i] = i % 10 == 9 ? (nZip4Hi + 1) % 10000 : nZip4Lo + rand() % (nZip4Hi - nZip4Lo + 1);
+		}
+
+		std::vector<DeCompressZip4::Results> aSingleResults(nKeys);
+		std::vector<char> aSingleFound(nKeys);
+		start = clock();
+		for (int i = 0; i < nKeys; i++) {
+			aSingleFound[i] = single->Find(aZip5[i], aZip4[i], aSingleResults[i]);
+		}
+		double dSingleSeconds = Seconds(start);
+
+		std::vector<DeCompressZip4::Results> aBatchResults(nKeys);
+		bool* aBatchFound = new bool[nKeys];
+		start = clock();
+		batch->FindBatch(&aZip5[0], &aZip4[0], nKeys, &aBatchResults[0], aBatchFound);
+		double dBatchSeconds = Seconds(start);
+
+		int nFound = 0, nMismatches = 0;
+		for (int i = 0; i < nKeys; i++) {
+			if (
+				bool(aSingleFound[i]) != aBatchFound[i] ||
+				(aBatchFound[i] && !SameResults(aSingleResults[i], aBatchResults[i]))
+			) {
+				nMismatches++;
+			}
+			nFound += aBatchFound[i] ? 1 : 0;
+		}
+		delete [] aBatchFound;
+
+		printf("%d keys, %d found\n", nKeys, nFound);
+		printf("Find:      %.3f sec, %.0f lookups/sec\n", dSingleSeconds, PerSecond(nKeys, dSingleSeconds));
+		printf("FindBatch: %.3f sec, %.0f lookups/sec\n", dBatchSeconds, PerSecond(nKeys, dBatchSeconds));
+		if (dBatchSeconds > 0) {
+			printf("Speedup:   %.1fx\n", dSingleSeconds / dBatchSeconds);
+		}
+		if (nMismatches != 0) {
+			printf("%d results differ between Find and FindBatch\n", nMismatches);
+			return 1;
+		}
+	}
+	catch (const ErrorException& ex) {
+		fprintf(stderr, "%s\n", ex.message.c_str());
+		return 1;
+	}
+	return 0;
+}
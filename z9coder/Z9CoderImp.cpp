@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "GeoAbstractByteIO.h"
 #include "Z9CoderImp.h"
 #include "Z9Coder.h"
+#include <algorithm>
 
 namespace PortfolioExplorer
 {
@@ -435,33 +436,25 @@ namespace PortfolioExplorer
 	{
 	}
 
-	void DeCompressZip4::ReadChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData)
+	void DeCompressZip4::ReadChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData, unsigned nNumFields /*=NUM_FIELDS*/)
 	{
-		int nNumRecordsInChunk = nChunkNumber==(m_fileHeader.m_nNumRecords/CHUNK_SIZE) ? m_fileHeader.m_nNumRecords%CHUNK_SIZE : CHUNK_SIZE;
-		
-		m_fileInput.Seek(m_fileHeader.m_nChunkIndexFileOffset + nChunkNumber*sizeof(unsigned));
-		unsigned nPosChunk;
-		m_fileInput.Read(&nPosChunk, sizeof(nPosChunk));
-
-		m_pBitStreamReader->Seek(nPosChunk);
+		m_pBitStreamReader->Seek(m_vChunkIndex[nChunkNumber]);
 
 		if (rChunkData==NULL)
 			rChunkData = new ChunkCachedData;
 
-		for (unsigned x=0; x<NUM_FIELDS; ++x)
+		int nNumRecordsInChunk = NumRecordsInChunk(nChunkNumber);
+		for (unsigned x=0; x<nNumFields; ++x)
 		{
 			m_aCompressFields[x].ReadChunk(*m_pBitStreamReader, nNumRecordsInChunk, rChunkData->aValues[x]);
 		}
 	}
 	
-	void DeCompressZip4::GetRecord(int nRecord, ChunkCachedDataRef & rChunkData, int &rChunkRecordOffset)
+	void DeCompressZip4::GetChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData)
 	{
-		assert(unsigned(nRecord)<m_fileHeader.m_nNumRecords);
+		assert(nChunkNumber<GetChunkCount());
 
-		rChunkRecordOffset = nRecord%CHUNK_SIZE;
-		int nChunkNumber = nRecord/CHUNK_SIZE;
 		IntKey chunkKey(nChunkNumber);
-		
 		if (!m_CachedChuncks.Fetch(chunkKey, rChunkData))
 		{
 			ChunkCachedDataRef &pChunkDataChange = m_CachedChuncks.Change(chunkKey);
@@ -486,33 +479,69 @@ namespace PortfolioExplorer
 
 		for (unsigned x=0; x<NUM_FIELDS; ++x)
 			m_aCompressFields[x].ReadStatistics(m_fileInput);
+
+		LoadChunkIndex();
 	}
 
-	bool DeCompressZip4::CompareForLowerBound::operator ()(int nRec, const Zip9Key &zip9Key) const
+	void DeCompressZip4::LoadChunkIndex()
 	{
+		unsigned nNumChunks = (m_fileHeader.m_nNumRecords + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		m_vChunkIndex.resize(nNumChunks);
+		m_vChunkFirstKey.resize(nNumChunks);
+		if (nNumChunks==0)
+			return;
+
+		m_fileInput.Seek(m_fileHeader.m_nChunkIndexFileOffset);
+		m_fileInput.Read(&m_vChunkIndex[0], nNumChunks*sizeof(unsigned));
+
+		// One pass over the file, decoding only the key fields.  The chunks
+		// are stored in order, so this reads the file sequentially.
 		ChunkCachedDataRef pChunkData;
-		int nChunkRecordOffset;
-		m_decompressZip4.GetRecord(nRec, pChunkData, nChunkRecordOffset);
-		int nRecZip5 = pChunkData->aValues[0][nChunkRecordOffset];
-		int nRecZip4Lo = pChunkData->aValues[1][nChunkRecordOffset];
-		int nRecZip4Hi = nRecZip4Lo + pChunkData->aValues[2][nChunkRecordOffset];
-		if (nRecZip5!=zip9Key.m_nZip5)
-			return nRecZip5<zip9Key.m_nZip5;
-		else
-			return nRecZip4Hi<zip9Key.m_nZip4;
-	}
-	bool DeCompressZip4::CompareForLowerBound::operator ()(const Zip9Key &zip9Key, int nRec) const
+		for (unsigned nChunk=0; nChunk<nNumChunks; ++nChunk)
+		{
+			ReadChunk(nChunk, pChunkData, 3);
+			m_vChunkFirstKey[nChunk] = RecordKey(*pChunkData, 0);
+		}
+	}
+
+	unsigned DeCompressZip4::FindChunk(int nKey) const
+	{
+		// The last chunk whose first key is less than nKey: the records
+		// before it are all less than nKey, and the first record of the next
+		// chunk is not.
+		unsigned nChunk = unsigned(std::lower_bound(m_vChunkFirstKey.begin(), m_vChunkFirstKey.end(), nKey) - m_vChunkFirstKey.begin());
+		return nChunk>0 ? nChunk-1 : 0;
+	}
+
+	int DeCompressZip4::LowerBoundInChunk(const ChunkCachedData &chunkData, unsigned nChunkNumber, int nKey) const
+	{
+		int nNumRecords = NumRecordsInChunk(nChunkNumber);
+		for (int nOffset=0; nOffset<nNumRecords; ++nOffset)
+		{
+			if (RecordKey(chunkData, nOffset)>=nKey)
+				return nOffset;
+		}
+		return -1;
+	}
+
+	bool DeCompressZip4::Match(const ChunkCachedData &chunkData, int nOffset, int nZip5, int nZip4) const
 	{
+		int nRecZip5 = chunkData.aValues[0][nOffset];
+		int nRecZip4Lo = chunkData.aValues[1][nOffset];
+		int nRecZip4Hi = nRecZip4Lo + chunkData.aValues[2][nOffset];
+		return nZip5==nRecZip5 && nZip4>=nRecZip4Lo && nZip4<=nRecZip4Hi;
+	}
+
+	void DeCompressZip4::GetRecordKey(int nRecord, int &rZip5, int &rZip4Lo, int &rZip4Hi)
+	{
+		assert(unsigned(nRecord)<m_fileHeader.m_nNumRecords);
+
 		ChunkCachedDataRef pChunkData;
-		int nChunkRecordOffset;
-		m_decompressZip4.GetRecord(nRec, pChunkData, nChunkRecordOffset);
-		int nRecZip5 = pChunkData->aValues[0][nChunkRecordOffset];
-		int nRecZip4Lo = pChunkData->aValues[1][nChunkRecordOffset];
-		int nRecZip4Hi = nRecZip4Lo + pChunkData->aValues[2][nChunkRecordOffset];
-		if (nRecZip5!=zip9Key.m_nZip5)
-			return nRecZip5>zip9Key.m_nZip5;
-		else
-			return nRecZip4Hi>zip9Key.m_nZip4;
+		GetChunk(nRecord/CHUNK_SIZE, pChunkData);
+		int nOffset = nRecord%CHUNK_SIZE;
+		rZip5 = pChunkData->aValues[0][nOffset];
+		rZip4Lo = pChunkData->aValues[1][nOffset];
+		rZip4Hi = rZip4Lo + pChunkData->aValues[2][nOffset];
 	}
 
 	DeCompressZip4::Results::Results()
@@ -539,21 +568,83 @@ namespace PortfolioExplorer
 	bool DeCompressZip4::Find(int nZip5, int nZip4, Results & rResults, bool bReturnFipsCodes /*=true*/)
 	{
 		rResults.Reset();
-
-		Zip9Key key(nZip5, nZip4);
-		unsigned nRecord = std::lower_bound(FakeIntIterator(0), FakeIntIterator(m_fileHeader.m_nNumRecords), key, CompareForLowerBound(*this));
-		if (nRecord==m_fileHeader.m_nNumRecords)
+		if (GetChunkCount()==0)
 			return false;
 
+		int nKey = MakeKey(nZip5, nZip4);
+		unsigned nChunk = FindChunk(nKey);
 		ChunkCachedDataRef pChunkData;
-		int nChunkRecordOffset;
-		GetRecord(nRecord, pChunkData, nChunkRecordOffset);
-		int nRecZip5 = pChunkData->aValues[0][nChunkRecordOffset];
-		int nRecZip4Lo = pChunkData->aValues[1][nChunkRecordOffset];
-		int nRecZip4Hi = nRecZip4Lo + pChunkData->aValues[2][nChunkRecordOffset];
-		if (nZip5!=nRecZip5 || nZip4<nRecZip4Lo || nZip4>nRecZip4Hi)
+		GetChunk(nChunk, pChunkData);
+		int nOffset = LowerBoundInChunk(*pChunkData, nChunk, nKey);
+		if (nOffset<0)
+		{
+			if (++nChunk==GetChunkCount())
+				return false;
+			GetChunk(nChunk, pChunkData);
+			nOffset = 0;
+		}
+		if (!Match(*pChunkData, nOffset, nZip5, nZip4))
 			return false;
 
+		FillResults(*pChunkData, nOffset, rResults, bReturnFipsCodes);
+		return true;
+	}
+
+	void DeCompressZip4::FindBatch(
+		const int *aZip5,
+		const int *aZip4,
+		int nCount,
+		Results *aResults,
+		bool *aFound,
+		bool bReturnFipsCodes /*=true*/
+	)
+	{
+		// Sort (key, position) pairs so the chunks are visited in order.
+		std::vector<std::pair<int, int> > vOrder(nCount);
+		for (int i=0; i<nCount; ++i)
+		{
+			aResults[i].Reset();
+			aFound[i] = false;
+			vOrder[i] = std::make_pair(MakeKey(aZip5[i], aZip4[i]), i);
+		}
+		std::sort(vOrder.begin(), vOrder.end());
+
+		// The one chunk decoded at a time.  Every record of the chunks before
+		// it is less than the keys still to come.
+		ChunkCachedDataRef pChunkData;
+		int nCurrentChunk = -1;
+		for (int i=0; i<nCount && GetChunkCount()>0; ++i)
+		{
+			int nKey = vOrder[i].first;
+			int nPos = vOrder[i].second;
+
+			unsigned nChunk = FindChunk(nKey);
+			if (int(nChunk)<nCurrentChunk)
+				nChunk = nCurrentChunk;
+			if (int(nChunk)!=nCurrentChunk)
+			{
+				ReadChunk(nChunk, pChunkData);
+				nCurrentChunk = nChunk;
+			}
+			int nOffset = LowerBoundInChunk(*pChunkData, nChunk, nKey);
+			if (nOffset<0)
+			{
+				if (++nChunk==GetChunkCount())
+					break;	// this key and all that follow are past the last record
+				ReadChunk(nChunk, pChunkData);
+				nCurrentChunk = nChunk;
+				nOffset = 0;
+			}
+			if (Match(*pChunkData, nOffset, aZip5[nPos], aZip4[nPos]))
+			{
+				FillResults(*pChunkData, nOffset, aResults[nPos], bReturnFipsCodes);
+				aFound[nPos] = true;
+			}
+		}
+	}
+
+	void DeCompressZip4::FillResults(const ChunkCachedData &chunkData, int nOffset, Results & rResults, bool bReturnFipsCodes) const
+	{
 		// Zip5
 		// Zip4Lo
 		// Zip4Hi - Zip4Lo
@@ -565,22 +656,21 @@ namespace PortfolioExplorer
 		// Long*100000
 		// RecType
 		// CentroidType
-		// we have a match
 		if (bReturnFipsCodes)
 		{
-			sprintf(rResults.stateFipsResultBuffer, "%02d", pChunkData->aValues[3][nChunkRecordOffset]);
-			sprintf(rResults.countyFipsResultBuffer, "%03d", pChunkData->aValues[4][nChunkRecordOffset]);
-			sprintf(rResults.tractResultBuffer, "%06d", pChunkData->aValues[5][nChunkRecordOffset]);
-			sprintf(rResults.blockResultBuffer, "%04d", pChunkData->aValues[6][nChunkRecordOffset]);
+			sprintf(rResults.stateFipsResultBuffer, "%02d", chunkData.aValues[3][nOffset]);
+			sprintf(rResults.countyFipsResultBuffer, "%03d", chunkData.aValues[4][nOffset]);
+			sprintf(rResults.tractResultBuffer, "%06d", chunkData.aValues[5][nOffset]);
+			sprintf(rResults.blockResultBuffer, "%04d", chunkData.aValues[6][nOffset]);
 			memcpy(rResults.censusIDResultBuffer, rResults.stateFipsResultBuffer, 2);
 			memcpy(rResults.censusIDResultBuffer+2, rResults.countyFipsResultBuffer, 3);
 			memcpy(rResults.censusIDResultBuffer+5, rResults.tractResultBuffer, 6);
 			memcpy(rResults.censusIDResultBuffer+11, rResults.blockResultBuffer, 4);
-			rResults.censusIDResultBuffer[15]=NULL;
+			rResults.censusIDResultBuffer[15]=0;
 		}
 
-		rResults.m_dLatResult = double(pChunkData->aValues[7][nChunkRecordOffset])/100000.0;
-		rResults.m_dLongResult = double(pChunkData->aValues[8][nChunkRecordOffset])/100000.0;
+		rResults.m_dLatResult = double(chunkData.aValues[7][nOffset])/100000.0;
+		rResults.m_dLongResult = double(chunkData.aValues[8][nOffset])/100000.0;
 
 
 
@@ -592,17 +682,15 @@ namespace PortfolioExplorer
 			// G - general delivery
 			// Z  GDT 5-digit ZIP
 		static const char aRecTypes[] = {'H', 'F', 'S', 'R', 'P', 'G', 'Z'};
-		assert(pChunkData->aValues[9][nChunkRecordOffset]<7);
-		rResults.recTypeResultBuffer[0] = aRecTypes[pChunkData->aValues[9][nChunkRecordOffset] ];
+		assert(chunkData.aValues[9][nOffset]<7);
+		rResults.recTypeResultBuffer[0] = aRecTypes[chunkData.aValues[9][nOffset] ];
 		rResults.recTypeResultBuffer[1] = 0;
 
 
 		static const char aCentroidTypes[] = {'0', '9', '7', '5'};
-		assert(pChunkData->aValues[10][nChunkRecordOffset]<4);
-		rResults.cenTypeResultBuffer[0] = aCentroidTypes[pChunkData->aValues[10][nChunkRecordOffset] ];
+		assert(chunkData.aValues[10][nOffset]<4);
+		rResults.cenTypeResultBuffer[0] = aCentroidTypes[chunkData.aValues[10][nOffset] ];
 		rResults.cenTypeResultBuffer[1] = 0;
-
-		return true;
 	}
 
 }
@@ -37,6 +37,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #pragma warning(disable:4275)
 
 #include <typeinfo>
+#include <vector>
 #include <assert.h>
 
 // Utility headers from the Geocoder
@@ -286,56 +287,9 @@ namespace PortfolioExplorer
 	// class DeCompressZip4
 	class DeCompressZip4 : public RefCount
 	{
-		struct Zip9Key
-		{
-			int m_nZip5;
-			int m_nZip4;
-
-			inline Zip9Key(int nZip5, int nZip4)
-				: m_nZip5(nZip5), m_nZip4(nZip4)
-			{}
-
-		};
-
-		class FakeIntIterator : 
-			public std::iterator<std::random_access_iterator_tag, int, int>
-		{
-			int m_val;
-		public:
-			inline FakeIntIterator(int val=0)
-				: m_val(val)
-			{
-			}
-
-			inline FakeIntIterator & operator =(int val)	{	m_val = val; return *this; }
-
-			// Access to "value" pointed at by iterator.
-			inline int & operator*() { return m_val; }
-			
-			// and just let everything like postfix ++, etc just default to using the int methods
-			inline operator int &() { return m_val; }
-		};
-
-		class CompareForLowerBound
-		{
-			DeCompressZip4 &m_decompressZip4;
-
-//			CompareForLowerBound(CompareForLowerBound &);
-			CompareForLowerBound & operator =(CompareForLowerBound &);
+	public:
+		struct Results;
 
-		public:
-			inline CompareForLowerBound(DeCompressZip4 &decompressZip4)
-				: m_decompressZip4(decompressZip4)
-			{
-			}
-			inline bool operator ()(int nRecA, int nRecB) const
-			{
-				return nRecA<nRecB;
-			}
-			bool operator ()(int nRec, const Zip9Key &zip9Key) const;
-			bool operator ()(const Zip9Key &zip9Key, int nRec) const;
-		};
-		friend class CompareForLowerBound;
 	protected:
 
 		struct ChunkCachedData : public RefCount
@@ -356,8 +310,46 @@ namespace PortfolioExplorer
 
 		SetAssocCache<IntKey, ChunkCachedDataRef, 4> m_CachedChuncks;
 
-		void ReadChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData);
-		void GetRecord(int nRecord, ChunkCachedDataRef & rChunkData, int &rChunkRecordOffset);
+		// Records are searched by a single integer key, Zip5*10000 plus the
+		// Zip4: a record's key uses its Zip4Hi, so the first record whose key
+		// is not less than the search key is the only one that can match.
+		static inline int MakeKey(int nZip5, int nZip4)
+		{
+			return nZip5*10000 + nZip4;
+		}
+		static inline int RecordKey(const ChunkCachedData &chunkData, int nOffset)
+		{
+			return MakeKey(chunkData.aValues[0][nOffset], chunkData.aValues[1][nOffset] + chunkData.aValues[2][nOffset]);
+		}
+
+		inline unsigned GetChunkCount() const
+		{
+			return unsigned(m_vChunkIndex.size());
+		}
+		inline int NumRecordsInChunk(unsigned nChunkNumber) const
+		{
+			return nChunkNumber==(m_fileHeader.m_nNumRecords/CHUNK_SIZE) ? m_fileHeader.m_nNumRecords%CHUNK_SIZE : CHUNK_SIZE;
+		}
+
+		// Decode the first nNumFields fields of a chunk; the fields are stored
+		// one after another, so the key fields alone are cheaper to read.
+		void ReadChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData, unsigned nNumFields = NUM_FIELDS);
+		// Get a chunk through the cache.
+		void GetChunk(unsigned nChunkNumber, ChunkCachedDataRef & rChunkData);
+
+		// Read the chunk index and build the sparse key index.
+		void LoadChunkIndex();
+
+		// The chunk that holds the first record whose key is not less than
+		// nKey, or whose successor holds it as its first record.
+		unsigned FindChunk(int nKey) const;
+
+		// Offset in a chunk of the first record whose key is not less than
+		// nKey, or -1 if there is none in the chunk.
+		int LowerBoundInChunk(const ChunkCachedData &chunkData, unsigned nChunkNumber, int nKey) const;
+
+		bool Match(const ChunkCachedData &chunkData, int nOffset, int nZip5, int nZip4) const;
+		void FillResults(const ChunkCachedData &chunkData, int nOffset, Results & rResults, bool bReturnFipsCodes) const;
 
 		GeoFile  m_fileInput;
 		BitStreamReadRef m_pBitStreamReader;
@@ -365,6 +357,11 @@ namespace PortfolioExplorer
 
 		RelCompressInt m_aCompressFields[NUM_FIELDS];
 
+		// Bit offset of each chunk, and the key of its first record.  This
+		// is the sparse index that replaces a binary search over the file.
+		std::vector<unsigned> m_vChunkIndex;
+		std::vector<int> m_vChunkFirstKey;
+
 	public:
 		DeCompressZip4(int nCachePages=100);
 
@@ -426,6 +423,37 @@ namespace PortfolioExplorer
 			Results & rResults, 
 			bool bReturnFipsCodes=true
 		);
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Function name	: FindBatch
+		// Description: Look up many ZIP+4 codes at once.  The keys are sorted and
+		//	the chunks walked in order, so each chunk is decoded at most once for
+		//	all of the keys that fall in it, without going through the cache.
+		// Inputs:
+		//	const int*	aZip5		Five-digit ZIPs
+		//	const int*	aZip4		Four-digit ZIP extensions
+		//	int			nCount		Number of keys
+		//	bool		returnFips	true to return FIPS codes
+		// Outputs:
+		//	Results*	aResults	nCount results, in the order of the keys
+		//	bool*		aFound		nCount flags, true where a record was found
+		// throws Z9CoderException on error
+		///////////////////////////////////////////////////////////////////////////////
+		void FindBatch(
+			const int *aZip5,
+			const int *aZip4,
+			int nCount,
+			Results *aResults,
+			bool *aFound,
+			bool bReturnFipsCodes=true
+		);
+
+		// Number of records, and the key fields of a record by number.
+		inline unsigned GetRecordCount() const
+		{
+			return m_fileHeader.m_nNumRecords;
+		}
+		void GetRecordKey(int nRecord, int &rZip5, int &rZip4Lo, int &rZip4Hi);
 	};
 	typedef refcnt_ptr<DeCompressZip4> DeCompressZip4Ref;
 